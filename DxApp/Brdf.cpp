@@ -0,0 +1,289 @@
+#include "Brdf.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iterator>
+#include <random>
+#include <vector>
+#if defined(CPU_FEATURES_X86)
+#include <immintrin.h>
+#endif
+
+
+using namespace SimdMath;
+
+
+namespace Brdf
+{
+	namespace
+	{
+		Float3 Load(const float* const (&arrays)[3], uint32_t index)
+		{
+			return Float3(arrays[0][index], arrays[1][index], arrays[2][index]);
+		}
+
+		float Dot(const Float3& a, const Float3& b)
+		{
+			return a.x * b.x + a.y * b.y + a.z * b.z;
+		}
+
+		void EvaluateScalar(const Samples& samples, uint32_t begin)
+		{
+			for (uint32_t i = begin; i < samples.count; i++)
+			{
+				const Float3 brdf = GetBrdf(Load(samples.normal, i), Load(samples.view, i), Load(samples.light, i),
+					Load(samples.F0, i), Load(samples.rho, i), samples.roughness[i]);
+				samples.brdf[0][i] = brdf.x;
+				samples.brdf[1][i] = brdf.y;
+				samples.brdf[2][i] = brdf.z;
+			}
+		}
+
+#if defined(CPU_FEATURES_X86)
+CPU_FEATURES_TARGET_BEGIN("avx2")
+		namespace Avx2
+		{
+			struct Ops
+			{
+				using Vector = __m256;
+				using Mask = __m256;
+				static constexpr uint32_t kWidth = 8;
+
+				static Vector Load(const float* source) { return _mm256_loadu_ps(source); }
+				static void Store(float* destination, Vector value) { _mm256_storeu_ps(destination, value); }
+				static Vector Set(float value) { return _mm256_set1_ps(value); }
+				static Vector Add(Vector a, Vector b) { return _mm256_add_ps(a, b); }
+				static Vector Subtract(Vector a, Vector b) { return _mm256_sub_ps(a, b); }
+				static Vector Multiply(Vector a, Vector b) { return _mm256_mul_ps(a, b); }
+				static Vector Divide(Vector a, Vector b) { return _mm256_div_ps(a, b); }
+				static Vector Sqrt(Vector value) { return _mm256_sqrt_ps(value); }
+				static Vector Max(Vector a, Vector b) { return _mm256_max_ps(a, b); }
+				static Vector Abs(Vector value) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), value); }
+				static Mask Greater(Vector a, Vector b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+				static Mask And(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+				// 1 where the mask is set, 0 elsewhere
+				static Vector ToFloat(Mask mask) { return _mm256_and_ps(mask, _mm256_set1_ps(1.0f)); }
+			};
+
+#include "BrdfWide.h"
+		}
+CPU_FEATURES_TARGET_END
+
+CPU_FEATURES_TARGET_BEGIN("avx512f")
+		namespace Avx512
+		{
+			struct Ops
+			{
+				using Vector = __m512;
+				using Mask = __mmask16;
+				static constexpr uint32_t kWidth = 16;
+
+				static Vector Load(const float* source) { return _mm512_loadu_ps(source); }
+				static void Store(float* destination, Vector value) { _mm512_storeu_ps(destination, value); }
+				static Vector Set(float value) { return _mm512_set1_ps(value); }
+				static Vector Add(Vector a, Vector b) { return _mm512_add_ps(a, b); }
+				static Vector Subtract(Vector a, Vector b) { return _mm512_sub_ps(a, b); }
+				static Vector Multiply(Vector a, Vector b) { return _mm512_mul_ps(a, b); }
+				static Vector Divide(Vector a, Vector b) { return _mm512_div_ps(a, b); }
+				// Full masks, GCC 12 warns about the undefined source of the unmasked forms in target regions
+				static Vector Sqrt(Vector value) { return _mm512_maskz_sqrt_ps(0xffff, value); }
+				static Vector Max(Vector a, Vector b) { return _mm512_maskz_max_ps(0xffff, a, b); }
+				static Vector Abs(Vector value) { return _mm512_abs_ps(value); }
+				static Mask Greater(Vector a, Vector b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+				static Mask And(Mask a, Mask b) { return static_cast<Mask>(a & b); }
+				static Vector ToFloat(Mask mask) { return _mm512_maskz_mov_ps(mask, _mm512_set1_ps(1.0f)); }
+			};
+
+#include "BrdfWide.h"
+		}
+CPU_FEATURES_TARGET_END
+#endif
+
+		double GetMilliseconds(std::chrono::high_resolution_clock::time_point start)
+		{
+			return std::chrono::duration<double, std::chrono::milliseconds::period>(
+				std::chrono::high_resolution_clock::now() - start).count();
+		}
+	}
+
+
+	Float3 GetFresnelReflectance(const Float3& n, const Float3& l, const Float3& F0)
+	{
+		const float NdotL = Dot(n, l);
+		const float factor = std::pow(1.0f - std::max(0.0f, NdotL), 5.0f);
+		return Float3(F0.x + (1.0f - F0.x) * factor, F0.y + (1.0f - F0.y) * factor, F0.z + (1.0f - F0.z) * factor);
+	}
+
+
+	float GetMaskingShadowing(const Float3& l, const Float3& v, const Float3& m, float roughness)
+	{
+		const float MdotV = Dot(m, v);
+		const float MdotL = Dot(m, l);
+		const float sqrMdotV = MdotV * MdotV;
+		const float numerator = static_cast<float>(MdotV > 0.0f && MdotL > 0.0f);
+
+		return numerator / std::sqrt(1.0f + roughness * roughness * (1.0f - sqrMdotV) / sqrMdotV);
+	}
+
+
+	float GetNormalDistribution(const Float3& n, const Float3& m, float roughness)
+	{
+		const float NdotM = Dot(n, m);
+		const float sqrAlpha = roughness * roughness;
+
+		const float temp = 1.0f + NdotM * NdotM * (sqrAlpha - 1.0f);
+		return static_cast<float>(NdotM > 0.0f) * sqrAlpha / (kPi * temp * temp);
+	}
+
+
+	Float3 GetBrdf(const Float3& n, const Float3& v, const Float3& l, const Float3& F0, const Float3& rho,
+		float roughness)
+	{
+		Float3 h(l.x + v.x, l.y + v.y, l.z + v.z);
+		const float inverseLength = 1.0f / std::sqrt(Dot(h, h));
+		h = Float3(h.x * inverseLength, h.y * inverseLength, h.z * inverseLength);
+
+		const Float3 F = GetFresnelReflectance(n, l, F0);
+		const float G = GetMaskingShadowing(l, v, h, roughness);
+		const float D = GetNormalDistribution(n, h, roughness);
+
+		const float specularScale = G * D / (4.0f * std::max(1e-7f, std::abs(Dot(n, l))) * std::abs(Dot(n, v)));
+		return Float3(F.x * specularScale + (1.0f - F.x) * rho.x * (1.0f / kPi),
+			F.y * specularScale + (1.0f - F.y) * rho.y * (1.0f / kPi),
+			F.z * specularScale + (1.0f - F.z) * rho.z * (1.0f / kPi));
+	}
+
+
+	uint32_t GetBatchWidth(InstructionSet instructionSet)
+	{
+		switch (instructionSet)
+		{
+		case InstructionSet::Avx2:
+			return 8;
+		case InstructionSet::Avx512:
+			return 16;
+		default:
+			return 1;
+		}
+	}
+
+
+	const char* GetName(InstructionSet instructionSet)
+	{
+		switch (instructionSet)
+		{
+		case InstructionSet::Avx2:
+			return "AVX2";
+		case InstructionSet::Avx512:
+			return "AVX-512";
+		default:
+			return "scalar";
+		}
+	}
+
+
+	void Evaluate(const Samples& samples, InstructionSet instructionSet)
+	{
+		instructionSet = std::min(instructionSet, GetSupportedInstructionSet());
+
+		uint32_t evaluatedCount = 0;
+		switch (instructionSet)
+		{
+#if defined(CPU_FEATURES_X86)
+		case InstructionSet::Avx512:
+			evaluatedCount = Avx512::EvaluateWide(samples);
+			break;
+		case InstructionSet::Avx2:
+			evaluatedCount = Avx2::EvaluateWide(samples);
+			break;
+#endif
+		default:
+			break;
+		}
+		EvaluateScalar(samples, evaluatedCount);
+	}
+
+
+	BenchmarkReport Benchmark(uint32_t samplesCount)
+	{
+		constexpr uint32_t kRepeatsCount = 32;
+
+		std::mt19937 generator(0);
+		std::uniform_real_distribution<float> signedDistribution(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> unitDistribution(0.0f, 1.0f);
+		std::uniform_real_distribution<float> roughnessDistribution(0.05f, 1.0f);
+
+		const auto getDirection = [&]() {
+			Float3 direction;
+			do
+			{
+				direction = Float3(signedDistribution(generator), signedDistribution(generator),
+					signedDistribution(generator));
+			} while (Dot(direction, direction) < 1e-4f || Dot(direction, direction) > 1.0f);
+			StoreFloat3(direction, Vector3Normalize(LoadFloat3(direction)));
+			return direction;
+		};
+
+		// 3 components of normal, view, light, F0, rho and brdf
+		std::vector<float> arrays[6][3];
+		for (auto& vectorArrays : arrays)
+			for (auto& array : vectorArrays)
+				array.resize(samplesCount);
+		std::vector<float> roughness(samplesCount);
+		for (uint32_t i = 0; i < samplesCount; i++)
+		{
+			const Float3 normal = getDirection();
+			Float3 directions[2] = { getDirection(), getDirection() };
+			for (auto& direction : directions)
+			{
+				if (Dot(direction, normal) < 0.0f)
+					direction = Float3(-direction.x, -direction.y, -direction.z);
+			}
+			const Float3 vectors[] = {
+				normal, directions[0], directions[1],
+				Float3(unitDistribution(generator), unitDistribution(generator), unitDistribution(generator)),
+				Float3(unitDistribution(generator), unitDistribution(generator), unitDistribution(generator))
+			};
+			for (uint32_t v = 0; v < std::size(vectors); v++)
+			{
+				arrays[v][0][i] = vectors[v].x;
+				arrays[v][1][i] = vectors[v].y;
+				arrays[v][2][i] = vectors[v].z;
+			}
+			roughness[i] = roughnessDistribution(generator);
+		}
+
+		Samples samples;
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			samples.normal[c] = arrays[0][c].data();
+			samples.view[c] = arrays[1][c].data();
+			samples.light[c] = arrays[2][c].data();
+			samples.F0[c] = arrays[3][c].data();
+			samples.rho[c] = arrays[4][c].data();
+		}
+		for (uint32_t c = 0; c < 3; c++)
+			samples.brdf[c] = arrays[5][c].data();
+		samples.roughness = roughness.data();
+		samples.count = samplesCount;
+
+		BenchmarkReport report;
+		report.samplesCount = samplesCount;
+		for (uint32_t set = 0; set < static_cast<uint32_t>(InstructionSet::Count); set++)
+		{
+			const auto instructionSet = static_cast<InstructionSet>(set);
+			auto& result = report.results[set];
+			result.isSupported = instructionSet <= GetSupportedInstructionSet();
+			if (!result.isSupported)
+				continue;
+
+			const auto startTime = std::chrono::high_resolution_clock::now();
+			for (uint32_t repeat = 0; repeat < kRepeatsCount; repeat++)
+				Evaluate(samples, instructionSet);
+			result.samplesPerSecond = static_cast<double>(samplesCount) * kRepeatsCount * 1000.0
+				/ std::max(GetMilliseconds(startTime), 1e-3);
+		}
+		return report;
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include "CpuFeatures.h"
+#include "SimdMath.h"
+
+
+// C++ port of the BRDF of Lighting.hlsli for CPU baking, reference rendering and validation.
+// The scalar functions mirror the shader ones, Evaluate runs them over structures of arrays 8 samples at a time
+// with AVX2 and 16 with AVX-512, the tail and the CPUs without either fall back to the scalar functions.
+namespace Brdf
+{
+	static constexpr float kPi = 3.1415926538f;
+
+	// https://en.wikipedia.org/wiki/Schlick%27s_approximation
+	SimdMath::Float3 GetFresnelReflectance(const SimdMath::Float3& n, const SimdMath::Float3& l,
+		const SimdMath::Float3& F0);
+	float GetMaskingShadowing(const SimdMath::Float3& l, const SimdMath::Float3& v, const SimdMath::Float3& m,
+		float roughness);
+	float GetNormalDistribution(const SimdMath::Float3& n, const SimdMath::Float3& m, float roughness);
+	SimdMath::Float3 GetBrdf(const SimdMath::Float3& n, const SimdMath::Float3& v, const SimdMath::Float3& l,
+		const SimdMath::Float3& F0, const SimdMath::Float3& rho, float roughness);
+
+	using CpuFeatures::InstructionSet;
+	using CpuFeatures::GetSupportedInstructionSet;
+	uint32_t GetBatchWidth(InstructionSet instructionSet);
+	const char* GetName(InstructionSet instructionSet);
+
+	// Structures of arrays of count samples, x y z arrays of the vectors. Directions are normalized.
+	// Not owned, the outputs may not alias the inputs.
+	struct Samples
+	{
+		const float* normal[3] = {};
+		const float* view[3] = {};
+		const float* light[3] = {};
+		const float* F0[3] = {};
+		const float* rho[3] = {};
+		const float* roughness = nullptr;
+		float* brdf[3] = {};
+		uint32_t count = 0;
+	};
+
+	// Instruction sets the CPU does not support fall back to the supported one
+	void Evaluate(const Samples& samples, InstructionSet instructionSet = GetSupportedInstructionSet());
+
+	struct BenchmarkReport
+	{
+		struct Result
+		{
+			bool isSupported = false;
+			// One thread
+			double samplesPerSecond = 0.0;
+		};
+
+		uint32_t samplesCount = 0;
+		Result results[static_cast<uint32_t>(InstructionSet::Count)];
+	};
+
+	// Random samples in the upper hemisphere of the normal, every supported instruction set on the calling thread.
+	// Timing only, BrdfTests.cpp checks the values.
+	BenchmarkReport Benchmark(uint32_t samplesCount);
+}
@@ -0,0 +1,78 @@
+// Evaluate over the vectors of the Ops of the including namespace. No include guard, Brdf.cpp includes it
+// once per instruction set, between the CPU_FEATURES_TARGET_BEGIN and CPU_FEATURES_TARGET_END of the set.
+
+using Vector = Ops::Vector;
+
+
+Vector Dot(const Vector (&a)[3], const Vector (&b)[3])
+{
+	return Ops::Add(Ops::Add(Ops::Multiply(a[0], b[0]), Ops::Multiply(a[1], b[1])), Ops::Multiply(a[2], b[2]));
+}
+
+
+// Same operations in the same order as the scalar functions, without FMA contractions,
+// pow(x, 5) is the only difference
+uint32_t EvaluateWide(const Samples& samples)
+{
+	const Vector zero = Ops::Set(0.0f);
+	const Vector one = Ops::Set(1.0f);
+	const Vector pi = Ops::Set(kPi);
+	const Vector inversePi = Ops::Set(1.0f / kPi);
+
+	uint32_t i = 0;
+	for (; i + Ops::kWidth <= samples.count; i += Ops::kWidth)
+	{
+		Vector n[3], v[3], l[3], F0[3], rho[3];
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			n[c] = Ops::Load(samples.normal[c] + i);
+			v[c] = Ops::Load(samples.view[c] + i);
+			l[c] = Ops::Load(samples.light[c] + i);
+			F0[c] = Ops::Load(samples.F0[c] + i);
+			rho[c] = Ops::Load(samples.rho[c] + i);
+		}
+		const Vector roughness = Ops::Load(samples.roughness + i);
+
+		Vector h[3] = { Ops::Add(l[0], v[0]), Ops::Add(l[1], v[1]), Ops::Add(l[2], v[2]) };
+		const Vector inverseLength = Ops::Divide(one, Ops::Sqrt(Dot(h, h)));
+		for (auto& component : h)
+			component = Ops::Multiply(component, inverseLength);
+
+		// GetFresnelReflectance
+		const Vector NdotL = Dot(n, l);
+		const Vector base = Ops::Subtract(one, Ops::Max(zero, NdotL));
+		const Vector sqrBase = Ops::Multiply(base, base);
+		const Vector factor = Ops::Multiply(Ops::Multiply(sqrBase, sqrBase), base);
+		Vector F[3];
+		for (uint32_t c = 0; c < 3; c++)
+			F[c] = Ops::Add(F0[c], Ops::Multiply(Ops::Subtract(one, F0[c]), factor));
+
+		// GetMaskingShadowing
+		const Vector MdotV = Dot(h, v);
+		const Vector MdotL = Dot(h, l);
+		const Vector sqrMdotV = Ops::Multiply(MdotV, MdotV);
+		const Vector maskingNumerator = Ops::ToFloat(Ops::And(Ops::Greater(MdotV, zero),
+			Ops::Greater(MdotL, zero)));
+		const Vector sqrRoughness = Ops::Multiply(roughness, roughness);
+		const Vector G = Ops::Divide(maskingNumerator, Ops::Sqrt(Ops::Add(one,
+			Ops::Divide(Ops::Multiply(sqrRoughness, Ops::Subtract(one, sqrMdotV)), sqrMdotV))));
+
+		// GetNormalDistribution
+		const Vector NdotM = Dot(n, h);
+		const Vector temp = Ops::Add(one, Ops::Multiply(Ops::Multiply(NdotM, NdotM),
+			Ops::Subtract(sqrRoughness, one)));
+		const Vector D = Ops::Divide(Ops::Multiply(Ops::ToFloat(Ops::Greater(NdotM, zero)), sqrRoughness),
+			Ops::Multiply(Ops::Multiply(pi, temp), temp));
+
+		const Vector specularDenominator = Ops::Multiply(Ops::Multiply(Ops::Set(4.0f),
+			Ops::Max(Ops::Set(1e-7f), Ops::Abs(NdotL))), Ops::Abs(Dot(n, v)));
+		const Vector specularScale = Ops::Divide(Ops::Multiply(G, D), specularDenominator);
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			const Vector specular = Ops::Multiply(F[c], specularScale);
+			const Vector diffuse = Ops::Multiply(Ops::Multiply(Ops::Subtract(one, F[c]), rho[c]), inversePi);
+			Ops::Store(samples.brdf[c] + i, Ops::Add(specular, diffuse));
+		}
+	}
+	return i;
+}
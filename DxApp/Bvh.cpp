@@ -0,0 +1,512 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <random>
+
+
+using namespace SimdMath;
+
+
+namespace
+{
+	constexpr uint32_t kBinsCount = 16;
+	constexpr uint32_t kMaxLeafItemsCount = 8;
+	constexpr float kNodeCost = 1.0f;
+	constexpr float kItemCost = 1.0f;
+
+	double GetMilliseconds(std::chrono::high_resolution_clock::time_point startTime)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime)
+			.count();
+	}
+
+	float GetSurfaceArea(Vector minCorner, Vector maxCorner)
+	{
+		Float3 size;
+		StoreFloat3(size, VectorSubtract(maxCorner, minCorner));
+		// Empty boxes
+		if (size.x < 0.0f || size.y < 0.0f || size.z < 0.0f)
+			return 0.0f;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	float GetSurfaceArea(const Aabb& box)
+	{
+		return GetSurfaceArea(LoadFloat3(box.minCorner), LoadFloat3(box.maxCorner));
+	}
+
+	bool IsVisible(const Aabb& box, const Float4* planes, uint32_t planesCount)
+	{
+		const Vector minCorner = LoadFloat3(box.minCorner);
+		const Vector maxCorner = LoadFloat3(box.maxCorner);
+		const Vector half = VectorReplicate(0.5f);
+		return AabbIntersectsPlanes(VectorMultiply(VectorAdd(minCorner, maxCorner), half),
+			VectorMultiply(VectorSubtract(maxCorner, minCorner), half), planes, planesCount);
+	}
+
+	struct BuildEntry
+	{
+		uint32_t node;
+		uint32_t begin;
+		uint32_t end;
+	};
+
+	struct Bins
+	{
+		Vector minCorners[kBinsCount];
+		Vector maxCorners[kBinsCount];
+		uint32_t itemsCounts[kBinsCount];
+	};
+}
+
+
+void Bvh::Build(const std::vector<Aabb>& boxes)
+{
+	const uint32_t itemsCount = static_cast<uint32_t>(boxes.size());
+	m_items.resize(itemsCount);
+	for (uint32_t i = 0; i < itemsCount; i++)
+		m_items[i] = i;
+	m_itemLeaves.resize(itemsCount);
+	m_nodes.clear();
+	m_parents.clear();
+	m_cost = 0.0;
+	if (itemsCount == 0)
+		return;
+	m_nodes.reserve(2 * itemsCount);
+	m_parents.reserve(2 * itemsCount);
+
+	// Twice the centers, the bins only need their ratios
+	std::vector<Float3> centers(itemsCount);
+	for (uint32_t i = 0; i < itemsCount; i++)
+		StoreFloat3(centers[i], VectorAdd(LoadFloat3(boxes[i].minCorner), LoadFloat3(boxes[i].maxCorner)));
+
+	m_nodes.push_back(Node());
+	m_parents.push_back(UINT32_MAX);
+	std::vector<BuildEntry> stack = { { 0, 0, itemsCount } };
+	while (!stack.empty())
+	{
+		const BuildEntry entry = stack.back();
+		stack.pop_back();
+		const uint32_t count = entry.end - entry.begin;
+
+		Vector minCorner = VectorReplicate(FLT_MAX);
+		Vector maxCorner = VectorReplicate(-FLT_MAX);
+		Vector centerMin = VectorReplicate(FLT_MAX);
+		Vector centerMax = VectorReplicate(-FLT_MAX);
+		for (uint32_t i = entry.begin; i < entry.end; i++)
+		{
+			const uint32_t item = m_items[i];
+			minCorner = VectorMin(minCorner, LoadFloat3(boxes[item].minCorner));
+			maxCorner = VectorMax(maxCorner, LoadFloat3(boxes[item].maxCorner));
+			const Vector center = LoadFloat3(centers[item]);
+			centerMin = VectorMin(centerMin, center);
+			centerMax = VectorMax(centerMax, center);
+		}
+		StoreFloat3(m_nodes[entry.node].bounds.minCorner, minCorner);
+		StoreFloat3(m_nodes[entry.node].bounds.maxCorner, maxCorner);
+
+		// Binned SAH over the centers, every axis in one pass
+		Float3 binOrigin;
+		Float3 binScale;
+		StoreFloat3(binOrigin, centerMin);
+		StoreFloat3(binScale, VectorSubtract(centerMax, centerMin));
+		for (float* scale : { &binScale.x, &binScale.y, &binScale.z })
+			*scale = *scale > 0.0f ? kBinsCount / *scale : 0.0f;
+		const auto getBin = [&](const Float3& center, uint32_t axis) {
+			const float position = (&center.x)[axis] - (&binOrigin.x)[axis];
+			return std::min(static_cast<uint32_t>(position * (&binScale.x)[axis]), kBinsCount - 1);
+		};
+
+		const float leafCost = kItemCost * count;
+		float bestCost = FLT_MAX;
+		uint32_t bestAxis = 0;
+		uint32_t bestSplit = 0;
+		if (count > 2)
+		{
+			Bins bins[3];
+			for (auto& axisBins : bins)
+			{
+				for (uint32_t bin = 0; bin < kBinsCount; bin++)
+				{
+					axisBins.minCorners[bin] = VectorReplicate(FLT_MAX);
+					axisBins.maxCorners[bin] = VectorReplicate(-FLT_MAX);
+					axisBins.itemsCounts[bin] = 0;
+				}
+			}
+			for (uint32_t i = entry.begin; i < entry.end; i++)
+			{
+				const uint32_t item = m_items[i];
+				const Vector itemMin = LoadFloat3(boxes[item].minCorner);
+				const Vector itemMax = LoadFloat3(boxes[item].maxCorner);
+				for (uint32_t axis = 0; axis < 3; axis++)
+				{
+					const uint32_t bin = getBin(centers[item], axis);
+					bins[axis].minCorners[bin] = VectorMin(bins[axis].minCorners[bin], itemMin);
+					bins[axis].maxCorners[bin] = VectorMax(bins[axis].maxCorners[bin], itemMax);
+					bins[axis].itemsCounts[bin]++;
+				}
+			}
+
+			const float boundsArea = std::max(GetSurfaceArea(minCorner, maxCorner), FLT_MIN);
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				if ((&binScale.x)[axis] == 0.0f)
+					continue;
+				const Bins& axisBins = bins[axis];
+
+				// Areas and counts right of every split, then left of it while sweeping
+				float rightAreas[kBinsCount];
+				uint32_t rightCounts[kBinsCount];
+				Vector rightMin = VectorReplicate(FLT_MAX);
+				Vector rightMax = VectorReplicate(-FLT_MAX);
+				uint32_t rightCount = 0;
+				for (uint32_t bin = kBinsCount - 1; bin > 0; bin--)
+				{
+					rightMin = VectorMin(rightMin, axisBins.minCorners[bin]);
+					rightMax = VectorMax(rightMax, axisBins.maxCorners[bin]);
+					rightCount += axisBins.itemsCounts[bin];
+					rightAreas[bin] = GetSurfaceArea(rightMin, rightMax);
+					rightCounts[bin] = rightCount;
+				}
+				Vector leftMin = VectorReplicate(FLT_MAX);
+				Vector leftMax = VectorReplicate(-FLT_MAX);
+				uint32_t leftCount = 0;
+				for (uint32_t split = 1; split < kBinsCount; split++)
+				{
+					leftMin = VectorMin(leftMin, axisBins.minCorners[split - 1]);
+					leftMax = VectorMax(leftMax, axisBins.maxCorners[split - 1]);
+					leftCount += axisBins.itemsCounts[split - 1];
+					if (leftCount == 0 || rightCounts[split] == 0)
+						continue;
+					const float cost = kNodeCost + kItemCost
+						* (GetSurfaceArea(leftMin, leftMax) * leftCount + rightAreas[split] * rightCounts[split])
+						/ boundsArea;
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestSplit = split;
+					}
+				}
+			}
+		}
+
+		// Leaf while it stays at the begin
+		uint32_t middle = entry.begin;
+		if (bestCost < FLT_MAX && (bestCost < leafCost || count > kMaxLeafItemsCount))
+		{
+			middle = static_cast<uint32_t>(std::partition(m_items.begin() + entry.begin, m_items.begin() + entry.end,
+				[&](uint32_t item) { return getBin(centers[item], bestAxis) < bestSplit; }) - m_items.begin());
+		}
+		if ((middle == entry.begin || middle == entry.end) && count > kMaxLeafItemsCount)
+		{
+			// Same centers, any split is as good
+			middle = entry.begin + count / 2;
+		}
+
+		if (middle == entry.begin || middle == entry.end)
+		{
+			m_nodes[entry.node].first = entry.begin;
+			m_nodes[entry.node].itemsCount = count;
+			for (uint32_t i = entry.begin; i < entry.end; i++)
+				m_itemLeaves[m_items[i]] = entry.node;
+			continue;
+		}
+
+		const uint32_t left = static_cast<uint32_t>(m_nodes.size());
+		m_nodes[entry.node].first = left;
+		m_nodes[entry.node].itemsCount = 0;
+		m_nodes.resize(left + 2);
+		m_parents.resize(left + 2, entry.node);
+		stack.push_back({ left, entry.begin, middle });
+		stack.push_back({ left + 1, middle, entry.end });
+	}
+
+	for (const auto& node : m_nodes)
+		m_cost += GetNodeCost(node);
+	m_refitFlags.assign(m_nodes.size(), 0);
+}
+
+
+void Bvh::Refit(const std::vector<Aabb>& boxes, const std::vector<uint32_t>& movedItems)
+{
+	// Every node anyway
+	if (movedItems.size() * 8 > m_itemLeaves.size())
+	{
+		RefitAll(boxes);
+		return;
+	}
+
+	// The leaves of the moved items and their ancestors, once each
+	m_refitNodes.clear();
+	for (const uint32_t item : movedItems)
+	{
+		for (uint32_t node = m_itemLeaves[item]; node != UINT32_MAX && !m_refitFlags[node]; node = m_parents[node])
+		{
+			m_refitFlags[node] = 1;
+			m_refitNodes.push_back(node);
+		}
+	}
+	// Children follow their parents
+	std::sort(m_refitNodes.begin(), m_refitNodes.end(), std::greater<uint32_t>());
+	for (const uint32_t node : m_refitNodes)
+	{
+		RefitNode(node, boxes);
+		m_refitFlags[node] = 0;
+	}
+}
+
+
+void Bvh::RefitAll(const std::vector<Aabb>& boxes)
+{
+	for (uint32_t node = static_cast<uint32_t>(m_nodes.size()); node-- > 0;)
+		RefitNode(node, boxes);
+}
+
+
+void Bvh::Insert(const std::vector<Aabb>& boxes)
+{
+	if (m_nodes.empty())
+	{
+		Build(boxes);
+		return;
+	}
+
+	for (uint32_t item = GetItemsCount(); item < boxes.size(); item++)
+	{
+		const Aabb& box = boxes[item];
+		uint32_t node = 0;
+		while (m_nodes[node].itemsCount == 0)
+		{
+			const uint32_t left = m_nodes[node].first;
+			const auto getGrowth = [&](uint32_t child) {
+				const Aabb& bounds = m_nodes[child].bounds;
+				return GetSurfaceArea(AabbMerge(bounds, box)) - GetSurfaceArea(bounds);
+			};
+			node = getGrowth(left) <= getGrowth(left + 1) ? left : left + 1;
+		}
+
+		// Costs of the changed nodes are added back by their refits
+		uint32_t leaf = node;
+		m_cost -= GetNodeCost(m_nodes[node]);
+		if (m_nodes[node].itemsCount < kMaxLeafItemsCount)
+		{
+			// Moved to the end of the items, the range it leaves stays unused until the next Build
+			const Node value = m_nodes[node];
+			if (value.first + value.itemsCount != m_items.size())
+			{
+				m_nodes[node].first = static_cast<uint32_t>(m_items.size());
+				for (uint32_t i = value.first; i < value.first + value.itemsCount; i++)
+					m_items.push_back(m_items[i]);
+			}
+			m_nodes[node].itemsCount++;
+			m_nodes[node].bounds = AabbEmpty();
+		}
+		else
+		{
+			// Full leaf, becomes the parent of its items and of a leaf of the new item
+			const uint32_t left = static_cast<uint32_t>(m_nodes.size());
+			m_nodes.push_back(m_nodes[node]);
+			m_nodes.push_back({ AabbEmpty(), static_cast<uint32_t>(m_items.size()), 1 });
+			m_nodes[node] = { AabbEmpty(), left, 0 };
+			m_parents.resize(left + 2, node);
+			m_cost += GetNodeCost(m_nodes[left]);
+			for (uint32_t i = m_nodes[left].first; i < m_nodes[left].first + m_nodes[left].itemsCount; i++)
+				m_itemLeaves[m_items[i]] = left;
+			leaf = left + 1;
+		}
+		m_items.push_back(item);
+		m_itemLeaves.push_back(leaf);
+
+		for (uint32_t ancestor = leaf; ancestor != UINT32_MAX; ancestor = m_parents[ancestor])
+			RefitNode(ancestor, boxes);
+	}
+	m_refitFlags.resize(m_nodes.size(), 0);
+}
+
+
+float Bvh::GetSahCost() const
+{
+	if (m_nodes.empty())
+		return 0.0f;
+	return static_cast<float>(m_cost / std::max(GetSurfaceArea(m_nodes[0].bounds), FLT_MIN));
+}
+
+
+void Bvh::Cull(const std::vector<Aabb>& boxes, const Float4* planes, uint32_t planesCount,
+	std::vector<uint32_t>& visibleItems) const
+{
+	visibleItems.clear();
+	if (GetItemsCount() == 0)
+		return;
+
+	std::vector<uint32_t> stack = { 0 };
+	while (!stack.empty())
+	{
+		const Node& node = m_nodes[stack.back()];
+		stack.pop_back();
+		if (!IsVisible(node.bounds, planes, planesCount))
+			continue;
+
+		if (node.itemsCount == 0)
+		{
+			stack.push_back(node.first);
+			stack.push_back(node.first + 1);
+			continue;
+		}
+		for (uint32_t i = node.first; i < node.first + node.itemsCount; i++)
+		{
+			if (IsVisible(boxes[m_items[i]], planes, planesCount))
+				visibleItems.push_back(m_items[i]);
+		}
+	}
+}
+
+
+void Bvh::RefitNode(uint32_t node, const std::vector<Aabb>& boxes)
+{
+	Node& value = m_nodes[node];
+	m_cost -= GetNodeCost(value);
+	if (value.itemsCount > 0)
+	{
+		value.bounds = AabbEmpty();
+		for (uint32_t i = value.first; i < value.first + value.itemsCount; i++)
+			value.bounds = AabbMerge(value.bounds, boxes[m_items[i]]);
+	}
+	else
+	{
+		value.bounds = AabbMerge(m_nodes[value.first].bounds, m_nodes[value.first + 1].bounds);
+	}
+	m_cost += GetNodeCost(value);
+}
+
+
+double Bvh::GetNodeCost(const Node& node) const
+{
+	return GetSurfaceArea(node.bounds) * (node.itemsCount > 0 ? kItemCost * node.itemsCount : kNodeCost);
+}
+
+
+void DynamicBvh::Build(const std::vector<Aabb>& boxes)
+{
+	// The rebuild in progress is of older boxes
+	if (m_rebuild.valid())
+		m_rebuild.wait();
+	m_rebuild = {};
+
+	m_bvh->Build(boxes);
+	m_builtCost = m_bvh->GetSahCost();
+}
+
+
+void DynamicBvh::Update(const std::vector<Aabb>& boxes, const std::vector<uint32_t>& movedItems)
+{
+	if (boxes.size() < m_bvh->GetItemsCount())
+	{
+		Build(boxes);
+		return;
+	}
+
+	if (m_rebuild.valid() && m_rebuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+	{
+		auto [bvh, builtCost] = m_rebuild.get();
+		m_bvh = std::move(bvh);
+		m_builtCost = builtCost;
+		m_rebuildsCount++;
+		// Built from the boxes of the Update that started it
+		m_bvh->Insert(boxes);
+		m_bvh->RefitAll(boxes);
+	}
+	else
+	{
+		// The added items raise the cost, a rebuild follows once they are too many
+		m_bvh->Insert(boxes);
+		m_bvh->Refit(boxes, movedItems);
+	}
+
+	if (!m_rebuild.valid() && GetCostRatio() > m_rebuildCostRatio)
+	{
+		m_rebuild = std::async(std::launch::async, [boxes]() {
+			auto bvh = std::make_unique<Bvh>();
+			bvh->Build(boxes);
+			const float cost = bvh->GetSahCost();
+			return std::make_pair(std::move(bvh), cost);
+		});
+	}
+}
+
+
+float DynamicBvh::GetCostRatio() const
+{
+	return m_builtCost > 0.0f ? m_bvh->GetSahCost() / m_builtCost : 1.0f;
+}
+
+
+DynamicBvh::BenchmarkReport DynamicBvh::Benchmark(uint32_t itemsCount, uint32_t framesCount)
+{
+	constexpr float kSceneSize = 1000.0f;
+	constexpr float kSpeed = 5.0f;
+	const float movingShares[] = { 0.01f, 0.02f, 0.05f, 0.1f, 0.25f, 0.5f };
+
+	BenchmarkReport report;
+	report.itemsCount = itemsCount;
+	report.framesCount = framesCount;
+
+	for (const float movingShare : movingShares)
+	{
+		std::mt19937 generator(0);
+		std::uniform_real_distribution<float> positionDistribution(0.0f, kSceneSize);
+		std::uniform_real_distribution<float> sizeDistribution(0.5f, 5.0f);
+		std::uniform_real_distribution<float> directionDistribution(-1.0f, 1.0f);
+
+		std::vector<Aabb> boxes(itemsCount);
+		for (auto& box : boxes)
+		{
+			const Float3 center(positionDistribution(generator), positionDistribution(generator),
+				positionDistribution(generator));
+			const float size = sizeDistribution(generator);
+			box = { Float3(center.x - size, center.y - size, center.z - size),
+				Float3(center.x + size, center.y + size, center.z + size) };
+		}
+
+		// The first items move, the order of the boxes is random
+		const uint32_t movingCount = static_cast<uint32_t>(itemsCount * movingShare);
+		std::vector<uint32_t> movedItems(movingCount);
+		std::vector<Float3> velocities(movingCount);
+		for (uint32_t i = 0; i < movingCount; i++)
+		{
+			movedItems[i] = i;
+			velocities[i] = Float3(directionDistribution(generator) * kSpeed, directionDistribution(generator) * kSpeed,
+				directionDistribution(generator) * kSpeed);
+		}
+
+		BenchmarkReport::Result result;
+		result.movingShare = movingShare;
+
+		Bvh bvh;
+		auto startTime = std::chrono::high_resolution_clock::now();
+		bvh.Build(boxes);
+		result.rebuildMilliseconds = GetMilliseconds(startTime);
+		const float builtCost = bvh.GetSahCost();
+
+		double refitMilliseconds = 0.0;
+		for (uint32_t frame = 0; frame < framesCount; frame++)
+		{
+			for (uint32_t i = 0; i < movingCount; i++)
+			{
+				const Vector velocity = LoadFloat3(velocities[i]);
+				StoreFloat3(boxes[i].minCorner, VectorAdd(LoadFloat3(boxes[i].minCorner), velocity));
+				StoreFloat3(boxes[i].maxCorner, VectorAdd(LoadFloat3(boxes[i].maxCorner), velocity));
+			}
+			startTime = std::chrono::high_resolution_clock::now();
+			bvh.Refit(boxes, movedItems);
+			refitMilliseconds += GetMilliseconds(startTime);
+		}
+		result.refitMilliseconds = refitMilliseconds / std::max(framesCount, 1u);
+		result.costRatio = builtCost > 0.0f ? bvh.GetSahCost() / builtCost : 1.0f;
+		report.results.push_back(result);
+	}
+	return report;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stdint.h>
+#include <future>
+#include <memory>
+#include <vector>
+#include "SimdMath.h"
+
+
+// Binary bounding volume hierarchy over boxes, the items, built with binned SAH. Both children of an inner node
+// are stored together after their parent, refits go bottom-up from the moved items.
+class Bvh
+{
+public:
+	struct Node
+	{
+		SimdMath::Aabb bounds;
+		// Leaves: first index of GetItems, inner nodes: left child, the right one follows it
+		uint32_t first = 0;
+		// 0 for inner nodes
+		uint32_t itemsCount = 0;
+	};
+
+	void Build(const std::vector<SimdMath::Aabb>& boxes);
+	// The boxes of movedItems changed since the last Build or Refit
+	void Refit(const std::vector<SimdMath::Aabb>& boxes, const std::vector<uint32_t>& movedItems);
+	void RefitAll(const std::vector<SimdMath::Aabb>& boxes);
+	// Adds the boxes past GetItemsCount to the leaves whose bounds grow the least, full leaves are split.
+	// Cheaper than a Build, the tree degrades until the next one.
+	void Insert(const std::vector<SimdMath::Aabb>& boxes);
+
+	// Expected cost of a random ray query: node and item areas relative to the root, inner nodes cost 1, items 1
+	float GetSahCost() const;
+
+	// Items whose boxes are not fully behind one of the planes, boxes of the last Build or Refit
+	void Cull(const std::vector<SimdMath::Aabb>& boxes, const SimdMath::Float4* planes, uint32_t planesCount,
+		std::vector<uint32_t>& visibleItems) const;
+
+	const std::vector<Node>& GetNodes() const { return m_nodes; }
+	// Item indices of the leaves
+	const std::vector<uint32_t>& GetItems() const { return m_items; }
+	uint32_t GetItemsCount() const { return static_cast<uint32_t>(m_itemLeaves.size()); }
+
+private:
+	std::vector<Node> m_nodes;
+	std::vector<uint32_t> m_parents;
+	std::vector<uint32_t> m_items;
+	std::vector<uint32_t> m_itemLeaves;
+	// Sum of the node costs, the SAH cost without the division by the root area
+	double m_cost = 0.0;
+
+	std::vector<uint8_t> m_refitFlags;
+	std::vector<uint32_t> m_refitNodes;
+
+	// Updates the bounds of the node from its items or children
+	void RefitNode(uint32_t node, const std::vector<SimdMath::Aabb>& boxes);
+	double GetNodeCost(const Node& node) const;
+};
+
+
+// Bvh of moving items: refitted by every Update and rebuilt on a worker thread once the refits degrade
+// its SAH cost past a ratio of the cost out of the last build. The owner thread swaps the rebuilt tree in
+// at an Update, queries never see a partial tree.
+class DynamicBvh
+{
+public:
+	static constexpr float kDefaultRebuildCostRatio = 1.3f;
+
+	DynamicBvh() = default;
+	DynamicBvh(const DynamicBvh&) = delete;
+	DynamicBvh& operator=(const DynamicBvh&) = delete;
+	// Waits for the rebuild in progress
+	~DynamicBvh() = default;
+
+	// On the calling thread
+	void Build(const std::vector<SimdMath::Aabb>& boxes);
+	// Boxes added past the count of the last Update are inserted and covered by the next rebuild,
+	// fewer boxes are built on the calling thread
+	void Update(const std::vector<SimdMath::Aabb>& boxes, const std::vector<uint32_t>& movedItems);
+
+	const Bvh& GetBvh() const { return *m_bvh; }
+	// Current SAH cost over the one of the last build
+	float GetCostRatio() const;
+	void SetRebuildCostRatio(float ratio) { m_rebuildCostRatio = ratio; }
+	bool IsRebuilding() const { return m_rebuild.valid(); }
+	uint32_t GetRebuildsCount() const { return m_rebuildsCount; }
+
+	struct BenchmarkReport
+	{
+		struct Result
+		{
+			float movingShare = 0.0f;
+			// Per frame, averaged
+			double refitMilliseconds = 0.0;
+			// Of the whole tree, what the worker thread spends
+			double rebuildMilliseconds = 0.0;
+			// SAH cost after the frames over the one of the build
+			float costRatio = 0.0f;
+		};
+
+		uint32_t itemsCount = 0;
+		uint32_t framesCount = 0;
+		std::vector<Result> results;
+	};
+
+	// Random boxes, a share of them moving at a constant velocity for framesCount refits, from 1% to 50%.
+	// Timing only, BvhTests.cpp checks the trees.
+	static BenchmarkReport Benchmark(uint32_t itemsCount, uint32_t framesCount);
+
+private:
+	std::unique_ptr<Bvh> m_bvh = std::make_unique<Bvh>();
+	float m_builtCost = 0.0f;
+	float m_rebuildCostRatio = kDefaultRebuildCostRatio;
+	uint32_t m_rebuildsCount = 0;
+
+	// The tree and its SAH cost right after the build
+	std::future<std::pair<std::unique_ptr<Bvh>, float>> m_rebuild;
+};
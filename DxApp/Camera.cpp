@@ -1,65 +1,66 @@
 #include <algorithm>
+#include <cmath>
 
 #include "Camera.h"
 
 
-Camera::Camera(const XMFLOAT3 position)
+Camera::Camera(const Float3 position)
 {
 	m_position = position;
 	m_pitch = 0.0f;
-	m_yaw = -XM_PIDIV2;
+	m_yaw = -kPiDiv2;
 
 	UpdateOrientation();
 }
 
 
-void Camera::Translate(const XMFLOAT3 offset)
+void Camera::Translate(const Float3 offset)
 {
-	const XMVECTOR positionVec = XMLoadFloat3(&m_position);
-	const XMVECTOR rightVec = XMLoadFloat3(&m_right);
-	const XMVECTOR upVec = XMLoadFloat3(&m_up);
-	const XMVECTOR forwardVec = XMLoadFloat3(&m_forward);
+	const Vector positionVec = LoadFloat3(m_position);
+	const Vector rightVec = LoadFloat3(m_right);
+	const Vector upVec = LoadFloat3(m_up);
+	const Vector forwardVec = LoadFloat3(m_forward);
 
-	XMStoreFloat3(&m_position, positionVec + offset.x * rightVec + offset.y * upVec + offset.z * forwardVec);
+	StoreFloat3(m_position, positionVec + offset.x * rightVec + offset.y * upVec + offset.z * forwardVec);
 }
 
 
-void Camera::Rotate(const XMFLOAT2 angles)
+void Camera::Rotate(const Float2 angles)
 {
 	m_yaw += angles.x;
-	if (m_yaw > XM_PI)
-		m_yaw -= XM_2PI;
-	if (m_yaw <= -XM_PI)
-		m_yaw += XM_2PI;
+	if (m_yaw > kPi)
+		m_yaw -= k2Pi;
+	if (m_yaw <= -kPi)
+		m_yaw += k2Pi;
 
-	m_pitch = std::clamp(m_pitch + angles.y, -XM_PIDIV2 + kEpsilon, XM_PIDIV2 - kEpsilon);
+	m_pitch = std::clamp(m_pitch + angles.y, -kPiDiv2 + kEpsilon, kPiDiv2 - kEpsilon);
 
 	UpdateOrientation();
 }
 
 
 // TODO LH?
-XMFLOAT4X4 Camera::GetViewMatrix() const
+Float4x4 Camera::GetViewMatrix() const
 {
-	const XMVECTOR positionVec = XMLoadFloat3(&m_position);
-	const XMVECTOR upVec = XMLoadFloat3(&m_up);
-	const XMVECTOR forwardVec = XMLoadFloat3(&m_forward);
+	const Vector positionVec = LoadFloat3(m_position);
+	const Vector upVec = LoadFloat3(m_up);
+	const Vector forwardVec = LoadFloat3(m_forward);
 
-	XMFLOAT4X4 viewMatrix = {};
-	XMStoreFloat4x4(&viewMatrix, XMMatrixLookAtRH(positionVec, positionVec + forwardVec, upVec));
+	Float4x4 viewMatrix = {};
+	StoreFloat4x4(viewMatrix, MatrixLookAtRH(positionVec, positionVec + forwardVec, upVec));
 	return viewMatrix;
 }
 
 
-XMFLOAT4X4 Camera::GetProjectionMatrix(const float appAspect) const
+Float4x4 Camera::GetProjectionMatrix(const float appAspect) const
 {
-	XMFLOAT4X4 projectionMatrix = {};
-	XMStoreFloat4x4(&projectionMatrix, XMMatrixPerspectiveFovRH(kFovY, appAspect, kNearClipPlane, kFarClipPlane));
+	Float4x4 projectionMatrix = {};
+	StoreFloat4x4(projectionMatrix, MatrixPerspectiveFovRH(kFovY, appAspect, kNearClipPlane, kFarClipPlane));
 	return projectionMatrix;
 }
 
 
-XMFLOAT3 Camera::GetPosition() const
+Float3 Camera::GetPosition() const
 {
 	return m_position;
 }
@@ -67,15 +68,15 @@ XMFLOAT3 Camera::GetPosition() const
 
 void Camera::UpdateOrientation()
 {
-	const XMVECTORF32 forwardVec = {
-		XMScalarCos(m_yaw) * XMScalarCos(m_pitch),
-		XMScalarSin(m_pitch),
-		XMScalarSin(m_yaw) * XMScalarCos(m_pitch),
+	const Vector forwardVec = VectorSet(
+		std::cos(m_yaw) * std::cos(m_pitch),
+		std::sin(m_pitch),
+		std::sin(m_yaw) * std::cos(m_pitch),
 		1.0f
-	};
-	XMStoreFloat3(&m_forward, forwardVec);
+	);
+	StoreFloat3(m_forward, forwardVec);
 
-	XMStoreFloat3(&m_right, XMVector3Normalize(XMVector3Cross(forwardVec, kDefaultUp)));
-	const XMVECTOR rightVec = XMLoadFloat3(&m_right);
-	XMStoreFloat3(&m_up, XMVector3Normalize(XMVector3Cross(rightVec, forwardVec)));
+	StoreFloat3(m_right, Vector3Normalize(Vector3Cross(forwardVec, LoadFloat4(kDefaultUp))));
+	const Vector rightVec = LoadFloat3(m_right);
+	StoreFloat3(m_up, Vector3Normalize(Vector3Cross(rightVec, forwardVec)));
 }
@@ -1,36 +1,38 @@
 #pragma once
 
-#include <DirectXMath.h>
+#include "SimdMath.h"
 
 
-using namespace DirectX;
+using namespace SimdMath;
 
 class Camera
 {
 public:
-	Camera(XMFLOAT3 position);
+	Camera(Float3 position);
 	Camera() = delete;
 
-	void Translate(XMFLOAT3 offset);
-	void Rotate(XMFLOAT2 angles);
+	void Translate(Float3 offset);
+	void Rotate(Float2 angles);
 
-	XMFLOAT4X4 GetViewMatrix() const;
-	XMFLOAT4X4 GetProjectionMatrix(float appAspect) const;
-	XMFLOAT3 GetPosition() const;
+	Float4x4 GetViewMatrix() const;
+	Float4x4 GetProjectionMatrix(float appAspect) const;
+	Float3 GetPosition() const;
+	float GetNearClipPlane() const { return kNearClipPlane; }
+	float GetFarClipPlane() const { return kFarClipPlane; }
 
 private:
-	XMFLOAT3 m_position{};
+	Float3 m_position{};
 
 	float m_pitch;
 	float m_yaw;
 
-	XMFLOAT3 m_forward{};
-	XMFLOAT3 m_up{};
-	XMFLOAT3 m_right{};
+	Float3 m_forward{};
+	Float3 m_up{};
+	Float3 m_right{};
 
-	const XMVECTORF32 kDefaultUp = { 0.0f, 1.0f, 0.0f, 1.0f };
-	const float kEpsilon = XM_PI / 180.0f;
-	const float kFovY = XMConvertToRadians(60.0f);
+	const Float4 kDefaultUp = { 0.0f, 1.0f, 0.0f, 1.0f };
+	const float kEpsilon = kPi / 180.0f;
+	const float kFovY = ConvertToRadians(60.0f);
 	const float kNearClipPlane = 0.1f;
 	const float kFarClipPlane = 1000.0f;
 
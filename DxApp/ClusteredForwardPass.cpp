@@ -0,0 +1,322 @@
+#include "ClusteredForwardPass.h"
+
+#include <cstring>
+
+#include "RendererForwards.h"
+#include "DrawStateFilter.h"
+#include "DxHelpers.h"
+#include "Scene.h"
+#include "ShaderCache.h"
+
+using namespace SimdMath;
+using namespace Microsoft::WRL;
+
+namespace
+{
+	// uint2 per cluster, then the light indices
+	constexpr uint32_t kLightGridSize = ClusteredLightCulling::kClustersCount * sizeof(ClusteredLightCulling::ClusterLights);
+	constexpr uint32_t kLightIndicesSize = ClusteredLightCulling::kMaxLightIndicesCount * sizeof(uint32_t);
+
+	// ClusterConstants of ForwardPass_ps.hlsl
+	struct ClusterConstants
+	{
+		uint32_t gridSize[3];
+		float depthSliceScale;
+		float screenSize[2];
+		float depthSliceBias;
+	};
+
+	// Referenced by the PSO desc until the asynchronous PSO creation is done
+	const D3D12_INPUT_ELEMENT_DESC kInputElementDescs[] = {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT,
+			D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT,
+			D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+	};
+}
+
+
+ClusteredForwardPass::ClusteredForwardPass(ID3D12Device* device, ShaderCache& shaderCache,
+	PipelineStateCache& pipelineStateCache)
+{
+	Initialize(device, shaderCache, pipelineStateCache);
+}
+
+
+void ClusteredForwardPass::Initialize(ID3D12Device* device, ShaderCache& shaderCache,
+	PipelineStateCache& pipelineStateCache)
+{
+	m_shaderCache = &shaderCache;
+	m_pipelineStateCache = &pipelineStateCache;
+
+	CreateRootSignature(device);
+	ResolvePermutationKeys();
+	UpdatePermutation();
+
+	m_cbvSrvUavDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+
+void ClusteredForwardPass::CreateResources(GpuHeapAllocator& heapAllocator, uint32_t framesCount,
+	uint32_t windowWidth, uint32_t windowHeight)
+{
+	m_windowWidth = windowWidth;
+	m_windowHeight = windowHeight;
+
+	m_lightGridBuffers.resize(framesCount);
+	m_lightGridAllocations.resize(framesCount);
+	m_lightGridData.resize(framesCount);
+	for (uint32_t i = 0; i < framesCount; i++)
+	{
+		m_lightGridAllocations[i] = heapAllocator.CreateResource(GpuHeapCategory::Upload,
+			CD3DX12_RESOURCE_DESC::Buffer(kLightGridSize + kLightIndicesSize), D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr, m_lightGridBuffers[i]);
+		m_lightGridBuffers[i]->SetName(L"ClusteredForwardPass::LightGrid");
+
+		const auto readRange = CD3DX12_RANGE(0, 0);
+		DxVerify(m_lightGridBuffers[i]->Map(0, &readRange, reinterpret_cast<void**>(&m_lightGridData[i])));
+	}
+}
+
+
+void ClusteredForwardPass::DestroyResources(GpuHeapAllocator& heapAllocator)
+{
+	for (uint32_t i = 0; i < m_lightGridBuffers.size(); i++)
+	{
+		m_lightGridBuffers[i]->Unmap(0, nullptr);
+		m_lightGridBuffers[i].Reset();
+		heapAllocator.Free(m_lightGridAllocations[i]);
+	}
+	m_lightGridBuffers.clear();
+	m_lightGridAllocations.clear();
+	m_lightGridData.clear();
+}
+
+
+void ClusteredForwardPass::SetScene(Scene* scene)
+{
+	m_scene = scene;
+	UpdatePermutation();
+}
+
+
+void ClusteredForwardPass::SetFalloff(LightFalloff falloff)
+{
+	m_falloff = falloff;
+	UpdatePermutation();
+}
+
+
+void ClusteredForwardPass::UpdatePermutation()
+{
+	// No scene yet, the variant without lights is the cheapest to prepare
+	static const LightSources kDefaultLightSources;
+	const auto& lightSources = m_scene ? m_scene->GetLightSources() : kDefaultLightSources;
+
+	// Point and spot lights come from the light grid, there are no GBuffer modes
+	m_permutationKey = LightingPass::SelectPermutationKey(m_permutationKeys, lightSources, m_falloff,
+		GBufferMode::Standard);
+
+	auto& pipelineStateObjects = m_pipelineStateObjects[m_permutationKey];
+	if (!pipelineStateObjects.withPrePass.valid())
+	{
+		const D3D12_SHADER_BYTECODE pixelShader = m_shaderCache->GetShader("ForwardPass_ps", m_permutationKey);
+		pipelineStateObjects.withPrePass = CreatePipelineStateObject(pixelShader, true);
+		pipelineStateObjects.withoutPrePass = CreatePipelineStateObject(pixelShader, false);
+	}
+}
+
+
+void ClusteredForwardPass::SetupRootResourceDescriptors(ID3D12Device* device,
+	CD3DX12_CPU_DESCRIPTOR_HANDLE rootParameters, D3D12_GPU_VIRTUAL_ADDRESS lightingDataAddress,
+	uint32_t lightingDataSize, uint32_t frameIndex) const
+{
+	D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
+	cbvDesc.BufferLocation = lightingDataAddress;
+	cbvDesc.SizeInBytes = lightingDataSize;
+	device->CreateConstantBufferView(&cbvDesc, rootParameters);
+	rootParameters.Offset(1, m_cbvSrvUavDescriptorSize);
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = ClusteredLightCulling::kClustersCount;
+	srvDesc.Buffer.StructureByteStride = sizeof(ClusteredLightCulling::ClusterLights);
+	device->CreateShaderResourceView(m_lightGridBuffers[frameIndex].Get(), &srvDesc, rootParameters);
+	rootParameters.Offset(1, m_cbvSrvUavDescriptorSize);
+
+	srvDesc.Buffer.FirstElement = kLightGridSize / sizeof(uint32_t);
+	srvDesc.Buffer.NumElements = ClusteredLightCulling::kMaxLightIndicesCount;
+	srvDesc.Buffer.StructureByteStride = sizeof(uint32_t);
+	device->CreateShaderResourceView(m_lightGridBuffers[frameIndex].Get(), &srvDesc, rootParameters);
+}
+
+
+void ClusteredForwardPass::UpdateRootResources(uint32_t frameIndex, float appAspect)
+{
+	const auto& camera = m_scene->GetCamera();
+	if (m_clusterBoundsAspect != appAspect)
+	{
+		const Float4x4 projection = camera.GetProjectionMatrix(appAspect);
+		Float4x4 inverseProjection;
+		StoreFloat4x4(inverseProjection, MatrixInverse(LoadFloat4x4(projection)));
+
+		m_clusterBounds = ClusteredLightCulling::ComputeClusterBounds(inverseProjection, camera.GetNearClipPlane(),
+			camera.GetFarClipPlane());
+		m_depthSlicing = ClusteredLightCulling::GetDepthSlicing(camera.GetNearClipPlane(), camera.GetFarClipPlane());
+		m_clusterBoundsAspect = appAspect;
+	}
+
+	ClusteredLightCulling::BuildLightGrid(m_scene->GetLightSources(), m_falloff == LightFalloff::Linear,
+		camera.GetViewMatrix(), m_clusterBounds, m_lightGrid);
+
+	uint8_t* data = m_lightGridData[frameIndex];
+	memcpy(data, m_lightGrid.clusters.data(), kLightGridSize);
+	memcpy(data + kLightGridSize, m_lightGrid.lightIndices.data(), m_lightGrid.lightIndices.size() * sizeof(uint32_t));
+}
+
+
+void ClusteredForwardPass::Setup(ID3D12GraphicsCommandList* commandList) const
+{
+	commandList->SetGraphicsRootSignature(m_rootSignature.Get());
+}
+
+
+uint32_t ClusteredForwardPass::Draw(ID3D12GraphicsCommandList* commandList,
+	CD3DX12_GPU_DESCRIPTOR_HANDLE objectParameters, CD3DX12_GPU_DESCRIPTOR_HANDLE rootParameters,
+	const std::vector<uint32_t>& order, bool depthPrePass) const
+{
+	const auto& pipelineStateObjects = m_pipelineStateObjects.at(m_permutationKey);
+	commandList->SetPipelineState(depthPrePass
+		? pipelineStateObjects.withPrePass.get().Get()
+		: pipelineStateObjects.withoutPrePass.get().Get());
+	commandList->SetGraphicsRootDescriptorTable(1, rootParameters);
+
+	const ClusterConstants constants = {
+		{ ClusteredLightCulling::kClustersX, ClusteredLightCulling::kClustersY, ClusteredLightCulling::kClustersZ },
+		m_depthSlicing.scale,
+		{ static_cast<float>(m_windowWidth), static_cast<float>(m_windowHeight) },
+		m_depthSlicing.bias
+	};
+	commandList->SetGraphicsRoot32BitConstants(2, sizeof(ClusterConstants) / sizeof(uint32_t), &constants, 0);
+
+	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	DrawStateFilter stateFilter(commandList);
+	const auto& objectMeshes = m_scene->GetObjectMeshes();
+	for (const uint32_t objectIndex : order)
+	{
+		const auto& mesh = m_scene->GetMesh(objectMeshes[objectIndex]);
+		stateFilter.SetGraphicsRootDescriptorTable(0,
+			CD3DX12_GPU_DESCRIPTOR_HANDLE(objectParameters, objectIndex, m_cbvSrvUavDescriptorSize));
+
+		stateFilter.SetVertexBuffer(mesh.GetVertexBufferView());
+		stateFilter.SetIndexBuffer(mesh.GetIndexBufferView());
+
+		commandList->DrawIndexedInstanced(mesh.GetIndicesCount(), 1, 0, 0, 0);
+	}
+	return stateFilter.GetSkippedCallsCount();
+}
+
+
+uint32_t ClusteredForwardPass::GetDescriptorTablesDescriptorsCount() const
+{
+	// Lighting constant buffer, light grid, light indices
+	return 3;
+}
+
+
+void ClusteredForwardPass::CreateRootSignature(ID3D12Device* device)
+{
+	D3D12_DESCRIPTOR_RANGE objectRanges[1] = {};
+	objectRanges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+	objectRanges[0].NumDescriptors = 1;
+	objectRanges[0].BaseShaderRegister = 0;
+	objectRanges[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+	objectRanges[0].RegisterSpace = 0;
+
+	D3D12_DESCRIPTOR_RANGE lightingRanges[2] = {};
+	lightingRanges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+	lightingRanges[0].NumDescriptors = 1;
+	lightingRanges[0].BaseShaderRegister = 0;
+	lightingRanges[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+	lightingRanges[0].RegisterSpace = 0;
+
+	// t0-t3 are the GBuffer textures Lighting.hlsli declares, unused here
+	lightingRanges[1].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+	lightingRanges[1].NumDescriptors = 2;
+	lightingRanges[1].BaseShaderRegister = 4;
+	lightingRanges[1].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+	lightingRanges[1].RegisterSpace = 0;
+
+	// The vertex and the pixel shader both read b0, the object and the lighting constant buffers
+	D3D12_ROOT_PARAMETER rootParameters[3] = {};
+	rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+	rootParameters[0].DescriptorTable = { _countof(objectRanges), objectRanges };
+	rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+
+	rootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+	rootParameters[1].DescriptorTable = { _countof(lightingRanges), lightingRanges };
+	rootParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	rootParameters[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	rootParameters[2].Constants.ShaderRegister = 1;
+	rootParameters[2].Constants.RegisterSpace = 0;
+	rootParameters[2].Constants.Num32BitValues = sizeof(ClusterConstants) / sizeof(uint32_t);
+	rootParameters[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
+	rootSignatureDesc.Init(_countof(rootParameters), rootParameters, 0, nullptr,
+		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+	ComPtr<ID3DBlob> signature;
+	ComPtr<ID3DBlob> error;
+
+	DxVerify(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature,
+		&error));
+	DxVerify(device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
+		IID_PPV_ARGS(&m_rootSignature)));
+	m_rootSignatureHash = PipelineStateCache::HashRootSignature(signature->GetBufferPointer(), signature->GetBufferSize());
+}
+
+
+void ClusteredForwardPass::ResolvePermutationKeys()
+{
+	m_permutationKeys = LightingPermutation::ResolveKeys(m_shaderCache->GetPermutationLayout("ForwardPass_ps"));
+}
+
+
+PipelineStateFuture ClusteredForwardPass::CreatePipelineStateObject(const D3D12_SHADER_BYTECODE& pixelShader,
+	bool depthPrePass)
+{
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+
+	// GeometryPass_vs computes depth the same way as DepthPrePass_vs
+	psoDesc.InputLayout = { kInputElementDescs, _countof(kInputElementDescs) };
+	psoDesc.pRootSignature = m_rootSignature.Get();
+	psoDesc.VS = m_shaderCache->GetShader("GeometryPass_vs");
+	psoDesc.PS = pixelShader;
+
+	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+	psoDesc.RasterizerState.FrontCounterClockwise = true;
+	psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+
+	// Shading after the pre-pass only touches the visible pixels and leaves depth as it is
+	psoDesc.DepthStencilState.DepthEnable = true;
+	psoDesc.DepthStencilState.DepthFunc = depthPrePass ? D3D12_COMPARISON_FUNC_EQUAL : D3D12_COMPARISON_FUNC_LESS;
+	psoDesc.DepthStencilState.DepthWriteMask = depthPrePass ? D3D12_DEPTH_WRITE_MASK_ZERO : D3D12_DEPTH_WRITE_MASK_ALL;
+	psoDesc.DepthStencilState.StencilEnable = false;
+
+	psoDesc.DSVFormat = kDsFormat;
+	psoDesc.SampleMask = UINT_MAX;
+	psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+
+	psoDesc.NumRenderTargets = 1;
+	psoDesc.RTVFormats[0] = kSwapChainFormat;
+	psoDesc.SampleDesc.Count = 1;
+
+	return m_pipelineStateCache->CreateGraphicsPipelineStateAsync(psoDesc, m_rootSignatureHash);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+#include <d3d12.h>
+#include <d3dx12.h>
+#include <wrl.h>
+
+#include "ClusteredLightCulling.h"
+#include "GpuHeapAllocator.h"
+#include "LightingPass.h"
+#include "PipelineStateCache.h"
+
+
+class Scene;
+class ShaderCache;
+
+// Clustered forward shading straight into the swap chain buffer, an alternative to the GBuffer and lighting passes.
+// Light lists are built on the CPU every frame, see ClusteredLightCulling.h, and read from upload buffers.
+// After the optional DepthPrePass the shading tests depth EQUAL.
+class ClusteredForwardPass
+{
+public:
+	ClusteredForwardPass() = default;
+	explicit ClusteredForwardPass(ID3D12Device* device, ShaderCache& shaderCache,
+		PipelineStateCache& pipelineStateCache);
+	// PSOs are created asynchronously, the first Setup with a new permutation waits for it.
+	// Caches have to outlive the pass.
+	void Initialize(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache);
+	~ClusteredForwardPass() = default;
+
+	// A persistently mapped light grid buffer per frame in flight
+	void CreateResources(GpuHeapAllocator& heapAllocator, uint32_t framesCount, uint32_t windowWidth,
+		uint32_t windowHeight);
+	void DestroyResources(GpuHeapAllocator& heapAllocator);
+
+	void SetScene(Scene* scene);
+	void SetFalloff(LightFalloff falloff);
+	// Picks the shader variant for the current light sources, has to be called before Setup when lights change
+	void UpdatePermutation();
+	// lightingDataAddress is the LightingPass constant buffer, the passes share it
+	void SetupRootResourceDescriptors(ID3D12Device* device, CD3DX12_CPU_DESCRIPTOR_HANDLE rootParameters,
+		D3D12_GPU_VIRTUAL_ADDRESS lightingDataAddress, uint32_t lightingDataSize, uint32_t frameIndex) const;
+	// Builds the light grid of the frame, the frame buffer has to be unused by the GPU
+	void UpdateRootResources(uint32_t frameIndex, float appAspect);
+	void Setup(ID3D12GraphicsCommandList* commandList) const;
+	// objectParameters are the GeometryPass object tables, order indexes the scene objects.
+	// Depth has to be filled by DepthPrePass when depthPrePass is set. Returns the redundant state calls skipped.
+	uint32_t Draw(ID3D12GraphicsCommandList* commandList, CD3DX12_GPU_DESCRIPTOR_HANDLE objectParameters,
+		CD3DX12_GPU_DESCRIPTOR_HANDLE rootParameters, const std::vector<uint32_t>& order, bool depthPrePass) const;
+
+	[[nodiscard]] uint32_t GetDescriptorTablesDescriptorsCount() const;
+	// Light indices of the last UpdateRootResources, all the clusters together
+	[[nodiscard]] uint32_t GetLightIndicesCount() const
+	{
+		return static_cast<uint32_t>(m_lightGrid.lightIndices.size());
+	}
+
+private:
+	struct PipelineStates
+	{
+		PipelineStateFuture withPrePass;
+		PipelineStateFuture withoutPrePass;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D12RootSignature> m_rootSignature;
+	uint64_t m_rootSignatureHash = 0;
+	Scene* m_scene = nullptr;
+
+	ShaderCache* m_shaderCache = nullptr;
+	PipelineStateCache* m_pipelineStateCache = nullptr;
+	LightingPass::PermutationKeys m_permutationKeys;
+	LightFalloff m_falloff = LightFalloff::Square;
+	uint32_t m_permutationKey = 0;
+	std::unordered_map<uint32_t, PipelineStates> m_pipelineStateObjects;
+
+	// Cluster bounds only change with the projection
+	std::vector<TiledLightCulling::Aabb> m_clusterBounds;
+	float m_clusterBoundsAspect = 0.0f;
+	ClusteredLightCulling::DepthSlicing m_depthSlicing;
+	ClusteredLightCulling::LightGrid m_lightGrid;
+
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> m_lightGridBuffers;
+	std::vector<GpuAllocation> m_lightGridAllocations;
+	std::vector<uint8_t*> m_lightGridData;
+	uint32_t m_windowWidth = 0;
+	uint32_t m_windowHeight = 0;
+
+	uint32_t m_cbvSrvUavDescriptorSize = 0;
+
+	void CreateRootSignature(ID3D12Device* device);
+	void ResolvePermutationKeys();
+	PipelineStateFuture CreatePipelineStateObject(const D3D12_SHADER_BYTECODE& pixelShader, bool depthPrePass);
+};
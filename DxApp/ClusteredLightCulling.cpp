@@ -0,0 +1,212 @@
+#include "ClusteredLightCulling.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+
+
+using namespace SimdMath;
+
+
+namespace
+{
+	float Distance(const Float3& a, const Float3& b)
+	{
+		const float x = a.x - b.x;
+		const float y = a.y - b.y;
+		const float z = a.z - b.z;
+		return std::sqrt(x * x + y * y + z * z);
+	}
+
+	Float3 TransformPosition(const Float4& position, const Float4x4& matrix)
+	{
+		Float3 result;
+		StoreFloat3(result, Vector3TransformCoord(VectorSet(position.x, position.y, position.z, 1.0f),
+			LoadFloat4x4(matrix)));
+		return result;
+	}
+
+	// View space point of the far plane behind the normalized device coordinates
+	Float3 GetViewRay(float ndcX, float ndcY, const Float4x4& inverseProjection)
+	{
+		return TransformPosition({ ndcX, ndcY, 1.0f, 1.0f }, inverseProjection);
+	}
+
+	// Point of the ray at the view distance, the view looks along -z
+	Float3 GetRayPoint(const Float3& ray, float viewDistance)
+	{
+		const float scale = viewDistance / -ray.z;
+		return { ray.x * scale, ray.y * scale, ray.z * scale };
+	}
+
+	float GetSliceDistance(uint32_t slice, float nearClipPlane, float farClipPlane)
+	{
+		using namespace ClusteredLightCulling;
+		return nearClipPlane * std::pow(farClipPlane / nearClipPlane,
+			static_cast<float>(slice) / static_cast<float>(kClustersZ));
+	}
+
+	struct ViewLight
+	{
+		uint32_t index;
+		Float3 position;
+		float range;
+	};
+
+	// Point lights first, then spot lights
+	std::vector<ViewLight> GetViewLights(const LightSources& lightSources, bool linearFalloff, const Float4x4& view)
+	{
+		std::vector<ViewLight> lights;
+		for (uint32_t i = 0; i < lightSources.GetPointLightSourcesCount(); i++)
+		{
+			const auto& lightSource = lightSources.GetPointLightSource(i);
+			lights.push_back({ i, TransformPosition(lightSource.position, view),
+				TiledLightCulling::GetLightRange(lightSource.color, linearFalloff) });
+		}
+		for (uint32_t i = 0; i < lightSources.GetSpotLightSourcesCount(); i++)
+		{
+			const auto& lightSource = lightSources.GetSpotLightSource(i);
+			lights.push_back({ lightSources.GetPointLightSourcesCount() + i, TransformPosition(lightSource.position, view),
+				TiledLightCulling::GetLightRange(lightSource.color, linearFalloff) });
+		}
+		return lights;
+	}
+}
+
+
+namespace ClusteredLightCulling
+{
+	DepthSlicing GetDepthSlicing(float nearClipPlane, float farClipPlane)
+	{
+		const float logDepthRange = std::log(farClipPlane / nearClipPlane);
+		return { static_cast<float>(kClustersZ) / logDepthRange,
+			-static_cast<float>(kClustersZ) * std::log(nearClipPlane) / logDepthRange };
+	}
+
+
+	uint32_t GetDepthSlice(float viewDistance, const DepthSlicing& slicing)
+	{
+		const float slice = std::floor(std::log(std::max(viewDistance, FLT_MIN)) * slicing.scale + slicing.bias);
+		return static_cast<uint32_t>(std::clamp(slice, 0.0f, static_cast<float>(kClustersZ - 1)));
+	}
+
+
+	uint32_t GetClusterIndex(uint32_t x, uint32_t y, uint32_t z)
+	{
+		return x + (y + z * kClustersY) * kClustersX;
+	}
+
+
+	std::vector<TiledLightCulling::Aabb> ComputeClusterBounds(const Float4x4& inverseProjection, float nearClipPlane,
+		float farClipPlane)
+	{
+		std::vector<TiledLightCulling::Aabb> bounds(kClustersCount);
+
+		for (uint32_t z = 0; z < kClustersZ; z++)
+		{
+			// The first slice reaches the camera, float rounding may put a pixel before the near plane
+			const float minDistance = z == 0 ? 0.0f : GetSliceDistance(z, nearClipPlane, farClipPlane);
+			const float maxDistance = GetSliceDistance(z + 1, nearClipPlane, farClipPlane);
+
+			for (uint32_t y = 0; y < kClustersY; y++)
+			{
+				for (uint32_t x = 0; x < kClustersX; x++)
+				{
+					auto& clusterBounds = bounds[GetClusterIndex(x, y, z)];
+					clusterBounds = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+
+					for (uint32_t i = 0; i < 8; i++)
+					{
+						// y goes down the screen
+						const float ndcX = -1.0f + 2.0f * static_cast<float>(x + (i & 1)) / static_cast<float>(kClustersX);
+						const float ndcY = 1.0f - 2.0f * static_cast<float>(y + ((i >> 1) & 1)) / static_cast<float>(kClustersY);
+						const float distance = (i & 4) ? maxDistance : minDistance;
+						const Float3 corner = GetRayPoint(GetViewRay(ndcX, ndcY, inverseProjection), distance);
+
+						clusterBounds.minCorner = { std::min(clusterBounds.minCorner.x, corner.x),
+							std::min(clusterBounds.minCorner.y, corner.y), std::min(clusterBounds.minCorner.z, corner.z) };
+						clusterBounds.maxCorner = { std::max(clusterBounds.maxCorner.x, corner.x),
+							std::max(clusterBounds.maxCorner.y, corner.y), std::max(clusterBounds.maxCorner.z, corner.z) };
+					}
+				}
+			}
+		}
+
+		return bounds;
+	}
+
+
+	void BuildLightGrid(const LightSources& lightSources, bool linearFalloff, const Float4x4& view,
+		const std::vector<TiledLightCulling::Aabb>& clusterBounds, LightGrid& grid)
+	{
+		const auto lights = GetViewLights(lightSources, linearFalloff, view);
+
+		grid.clusters.resize(kClustersCount);
+		grid.lightIndices.clear();
+		for (uint32_t i = 0; i < kClustersCount; i++)
+		{
+			auto& cluster = grid.clusters[i];
+			cluster.offset = static_cast<uint32_t>(grid.lightIndices.size());
+			for (const auto& light : lights)
+			{
+				if (TiledLightCulling::SphereIntersectsAabb(light.position, light.range, clusterBounds[i]))
+					grid.lightIndices.push_back(light.index);
+			}
+			cluster.count = static_cast<uint32_t>(grid.lightIndices.size()) - cluster.offset;
+		}
+	}
+
+
+	ValidationReport Validate(const LightSources& lightSources, bool linearFalloff, const Float4x4& view,
+		const Float4x4& projection, float nearClipPlane, float farClipPlane, uint32_t samplesCount)
+	{
+		ValidationReport report;
+		report.samplesCount = samplesCount;
+
+		Float4x4 inverseProjection;
+		StoreFloat4x4(inverseProjection, MatrixInverse(LoadFloat4x4(projection)));
+		const auto clusterBounds = ComputeClusterBounds(inverseProjection, nearClipPlane, farClipPlane);
+
+		LightGrid grid;
+		BuildLightGrid(lightSources, linearFalloff, view, clusterBounds, grid);
+		for (const auto& cluster : grid.clusters)
+		{
+			report.nonEmptyClustersRatio += cluster.count > 0 ? 1.0f : 0.0f;
+			report.lightsPerCluster += static_cast<float>(cluster.count);
+		}
+		report.nonEmptyClustersRatio /= static_cast<float>(kClustersCount);
+		report.lightsPerCluster /= static_cast<float>(kClustersCount);
+
+		const auto lights = GetViewLights(lightSources, linearFalloff, view);
+		const DepthSlicing slicing = GetDepthSlicing(nearClipPlane, farClipPlane);
+
+		std::mt19937 generator(0);
+		std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+		for (uint32_t i = 0; i < samplesCount; i++)
+		{
+			// Exponential distance, as the slices
+			const float ndcX = distribution(generator) * 2.0f - 1.0f;
+			const float ndcY = distribution(generator) * 2.0f - 1.0f;
+			const float distance = nearClipPlane * std::pow(farClipPlane / nearClipPlane, distribution(generator));
+			const Float3 position = GetRayPoint(GetViewRay(ndcX, ndcY, inverseProjection), distance);
+
+			// Same cluster lookup as the shader
+			const uint32_t x = std::min(static_cast<uint32_t>((ndcX * 0.5f + 0.5f) * kClustersX), kClustersX - 1);
+			const uint32_t y = std::min(static_cast<uint32_t>((0.5f - ndcY * 0.5f) * kClustersY), kClustersY - 1);
+			const auto& cluster = grid.clusters[GetClusterIndex(x, y, GetDepthSlice(distance, slicing))];
+			const auto clusterLightsBegin = grid.lightIndices.begin() + cluster.offset;
+			const auto clusterLightsEnd = clusterLightsBegin + cluster.count;
+
+			for (const auto& light : lights)
+			{
+				if (Distance(position, light.position) > light.range)
+					continue;
+				if (std::find(clusterLightsBegin, clusterLightsEnd, light.index) == clusterLightsEnd)
+					report.missedLightsCount++;
+			}
+		}
+
+		return report;
+	}
+} // namespace ClusteredLightCulling
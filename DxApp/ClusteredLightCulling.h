@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "SimdMath.h"
+
+#include "LightSources.h"
+#include "TiledLightCulling.h"
+
+
+// Light lists of the clustered forward path, built on the CPU every frame and read by ForwardPass_ps.hlsl.
+// Clusters split the screen into kClustersX x kClustersY tiles and the view distance into kClustersZ exponential
+// slices between the camera clip planes. Light indices are point lights first, then spot lights.
+namespace ClusteredLightCulling
+{
+	static constexpr uint32_t kClustersX = 16;
+	static constexpr uint32_t kClustersY = 9;
+	static constexpr uint32_t kClustersZ = 24;
+	static constexpr uint32_t kClustersCount = kClustersX * kClustersY * kClustersZ;
+	// Every light in every cluster, the index list never overflows
+	static constexpr uint32_t kMaxLightIndicesCount = kClustersCount
+		* (LightSources::kMaxPointLightSourcesCount + LightSources::kMaxSpotLightSourcesCount);
+
+	// slice = floor(log(distance) * scale + bias)
+	struct DepthSlicing
+	{
+		float scale = 0.0f;
+		float bias = 0.0f;
+	};
+
+	DepthSlicing GetDepthSlicing(float nearClipPlane, float farClipPlane);
+	// Clamped to the slices, distances out of the clip planes land in the first or the last one
+	uint32_t GetDepthSlice(float viewDistance, const DepthSlicing& slicing);
+	// Cluster index of x + y * kClustersX + z * kClustersX * kClustersY
+	uint32_t GetClusterIndex(uint32_t x, uint32_t y, uint32_t z);
+
+	// View space bounds of every cluster, SimdMath row vector convention, right handed view looking along -z
+	std::vector<TiledLightCulling::Aabb> ComputeClusterBounds(const SimdMath::Float4x4& inverseProjection,
+		float nearClipPlane, float farClipPlane);
+
+	// uint2 of the shader
+	struct ClusterLights
+	{
+		uint32_t offset = 0;
+		uint32_t count = 0;
+	};
+
+	struct LightGrid
+	{
+		std::vector<ClusterLights> clusters;
+		std::vector<uint32_t> lightIndices;
+	};
+
+	// Spot lights are culled by the sphere of their range
+	void BuildLightGrid(const LightSources& lightSources, bool linearFalloff, const SimdMath::Float4x4& view,
+		const std::vector<TiledLightCulling::Aabb>& clusterBounds, LightGrid& grid);
+
+	struct ValidationReport
+	{
+		uint32_t samplesCount = 0;
+		// Samples a light reaches while their cluster does not list it. Has to be 0.
+		uint32_t missedLightsCount = 0;
+		// Averages over the clusters
+		float nonEmptyClustersRatio = 0.0f;
+		float lightsPerCluster = 0.0f;
+	};
+
+	// Checks random points of random clusters against every light
+	ValidationReport Validate(const LightSources& lightSources, bool linearFalloff, const SimdMath::Float4x4& view,
+		const SimdMath::Float4x4& projection, float nearClipPlane, float farClipPlane, uint32_t samplesCount);
+} // namespace ClusteredLightCulling
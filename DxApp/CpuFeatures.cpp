@@ -0,0 +1,60 @@
+#include "CpuFeatures.h"
+
+#if defined(CPU_FEATURES_X86) && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+
+namespace CpuFeatures
+{
+	namespace
+	{
+		InstructionSet DetectInstructionSet()
+		{
+#if !defined(CPU_FEATURES_X86)
+			return InstructionSet::Scalar;
+#elif defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return InstructionSet::Scalar;
+
+			__cpuid(info, 1);
+			const bool hasOsXSave = (info[2] & (1 << 27)) != 0;
+			const bool hasFma = (info[2] & (1 << 12)) != 0;
+			if (!hasOsXSave || !hasFma)
+				return InstructionSet::Scalar;
+			// YMM and ZMM states saved by the OS
+			const uint64_t xcr0 = _xgetbv(0);
+			const bool hasYmmState = (xcr0 & 0x6) == 0x6;
+			const bool hasZmmState = (xcr0 & 0xe6) == 0xe6;
+
+			__cpuidex(info, 7, 0);
+			const bool hasAvx2 = (info[1] & (1 << 5)) != 0;
+			const bool hasAvx512 = (info[1] & (1 << 16)) != 0;
+#else
+			// Checks the states saved by the OS too
+			__builtin_cpu_init();
+			const bool hasYmmState = true;
+			const bool hasZmmState = true;
+			const bool hasAvx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+			const bool hasAvx512 = __builtin_cpu_supports("avx512f");
+#endif
+#if defined(CPU_FEATURES_X86)
+			if (hasAvx512 && hasZmmState)
+				return InstructionSet::Avx512;
+			if (hasAvx2 && hasYmmState)
+				return InstructionSet::Avx2;
+			return InstructionSet::Scalar;
+#endif
+		}
+	}
+
+
+	InstructionSet GetSupportedInstructionSet()
+	{
+		static const InstructionSet instructionSet = DetectInstructionSet();
+		return instructionSet;
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_FEATURES_X86 1
+#endif
+
+// Code between CPU_FEATURES_TARGET_BEGIN("avx2") and CPU_FEATURES_TARGET_END may use the intrinsics of the
+// instruction set without enabling it for the whole translation unit, the callers dispatch on
+// GetSupportedInstructionSet. MSVC compiles the intrinsics of any instruction set anyway.
+#define CPU_FEATURES_PRAGMA(text) _Pragma(#text)
+#if defined(CPU_FEATURES_X86) && defined(__clang__)
+#define CPU_FEATURES_TARGET_BEGIN(instructionSet) \
+	CPU_FEATURES_PRAGMA(clang attribute push(__attribute__((target(instructionSet))), apply_to = function))
+#define CPU_FEATURES_TARGET_END CPU_FEATURES_PRAGMA(clang attribute pop)
+#elif defined(CPU_FEATURES_X86) && defined(__GNUC__)
+#define CPU_FEATURES_TARGET_BEGIN(instructionSet) \
+	CPU_FEATURES_PRAGMA(GCC push_options) CPU_FEATURES_PRAGMA(GCC target(instructionSet))
+#define CPU_FEATURES_TARGET_END CPU_FEATURES_PRAGMA(GCC pop_options)
+#else
+#define CPU_FEATURES_TARGET_BEGIN(instructionSet)
+#define CPU_FEATURES_TARGET_END
+#endif
+
+
+namespace CpuFeatures
+{
+	// Every CPU with an instruction set has the previous ones
+	enum class InstructionSet : uint32_t
+	{
+		Scalar,
+		Avx2,
+		Avx512,
+		Count
+	};
+
+	// Widest instruction set of the CPU and the OS, detected once. Scalar on other CPUs than x86.
+	InstructionSet GetSupportedInstructionSet();
+}
@@ -0,0 +1,46 @@
+#include "DeferredReleaseQueue.h"
+
+#include <algorithm>
+#include <vector>
+
+
+DeferredReleaseQueue::~DeferredReleaseQueue()
+{
+	Flush();
+}
+
+
+void DeferredReleaseQueue::Enqueue(uint64_t fenceValue, ReleaseFunction release)
+{
+	// Usually appended to the end, values come from a monotonic fence
+	const auto position = std::upper_bound(m_entries.begin(), m_entries.end(), fenceValue,
+		[](uint64_t value, const Entry& entry) { return value < entry.fenceValue; });
+	m_entries.insert(position, { fenceValue, std::move(release) });
+}
+
+
+uint32_t DeferredReleaseQueue::Process(uint64_t completedFenceValue)
+{
+	// Taken out before running, a release is allowed to enqueue new entries
+	std::vector<ReleaseFunction> releases;
+	while (!m_entries.empty() && m_entries.front().fenceValue <= completedFenceValue)
+	{
+		releases.push_back(std::move(m_entries.front().release));
+		m_entries.pop_front();
+	}
+
+	for (auto& release : releases)
+	{
+		if (release)
+			release();
+	}
+
+	return static_cast<uint32_t>(releases.size());
+}
+
+
+void DeferredReleaseQueue::Flush()
+{
+	while (!m_entries.empty())
+		Process(UINT64_MAX);
+}
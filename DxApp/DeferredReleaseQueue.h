@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+
+// Releases are postponed until the GPU passes the fence value of the last frame that used the object.
+// Works with plain fence values, so it can be driven by the renderer fence or by a simulated one.
+class DeferredReleaseQueue
+{
+public:
+	using ReleaseFunction = std::function<void()>;
+
+	DeferredReleaseQueue() = default;
+	~DeferredReleaseQueue();
+
+	void Enqueue(uint64_t fenceValue, ReleaseFunction release);
+	// Runs every release with fenceValue <= completedFenceValue, returns how many were run
+	uint32_t Process(uint64_t completedFenceValue);
+	// Runs everything, the caller guarantees the GPU is idle
+	void Flush();
+
+	[[nodiscard]] size_t GetSize() const { return m_entries.size(); }
+
+private:
+	struct Entry
+	{
+		uint64_t fenceValue;
+		ReleaseFunction release;
+	};
+
+	// Sorted by fenceValue
+	std::deque<Entry> m_entries;
+};
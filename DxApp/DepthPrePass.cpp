@@ -0,0 +1,114 @@
+#include "DepthPrePass.h"
+
+#include "RendererForwards.h"
+#include "DrawStateFilter.h"
+#include "DxHelpers.h"
+#include "Scene.h"
+#include "ShaderCache.h"
+
+using namespace Microsoft::WRL;
+
+namespace
+{
+	// Referenced by the PSO desc until the asynchronous PSO creation is done
+	const D3D12_INPUT_ELEMENT_DESC kInputElementDescs[] = {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+	};
+}
+
+DepthPrePass::DepthPrePass(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache)
+{
+	Initialize(device, shaderCache, pipelineStateCache);
+}
+
+void DepthPrePass::Initialize(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache)
+{
+	CreateRootSignature(device);
+	CreatePipelineStateObject(shaderCache, pipelineStateCache);
+
+	m_cbvSrvUavDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+void DepthPrePass::Setup(ID3D12GraphicsCommandList* commandList) const
+{
+	commandList->SetPipelineState(m_pipelineStateObject.get().Get());
+	commandList->SetGraphicsRootSignature(m_rootSignature.Get());
+}
+
+uint32_t DepthPrePass::Draw(ID3D12GraphicsCommandList* commandList, CD3DX12_GPU_DESCRIPTOR_HANDLE objectParameters,
+	Scene* scene, const std::vector<uint32_t>& order) const
+{
+	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	DrawStateFilter stateFilter(commandList);
+	const auto& objectMeshes = scene->GetObjectMeshes();
+	for (const uint32_t objectIndex : order)
+	{
+		const auto& mesh = scene->GetMesh(objectMeshes[objectIndex]);
+		stateFilter.SetGraphicsRootDescriptorTable(0,
+			CD3DX12_GPU_DESCRIPTOR_HANDLE(objectParameters, objectIndex, m_cbvSrvUavDescriptorSize));
+
+		stateFilter.SetVertexBuffer(mesh.GetPositionBufferView());
+		stateFilter.SetIndexBuffer(mesh.GetIndexBufferView());
+
+		commandList->DrawIndexedInstanced(mesh.GetIndicesCount(), 1, 0, 0, 0);
+	}
+	return stateFilter.GetSkippedCallsCount();
+}
+
+void DepthPrePass::CreateRootSignature(ID3D12Device* device)
+{
+	D3D12_DESCRIPTOR_RANGE descriptorRanges[1] = {};
+	descriptorRanges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+	descriptorRanges[0].NumDescriptors = 1;
+	descriptorRanges[0].BaseShaderRegister = 0;
+	descriptorRanges[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+	descriptorRanges[0].RegisterSpace = 0;
+
+	D3D12_ROOT_PARAMETER rootParameters[1] = {};
+	rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+	rootParameters[0].DescriptorTable = { _countof(descriptorRanges), descriptorRanges };
+	rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+
+	CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
+	rootSignatureDesc.Init(_countof(rootParameters), rootParameters, 0, nullptr,
+		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+	ComPtr<ID3DBlob> signature;
+	ComPtr<ID3DBlob> error;
+
+	DxVerify(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature,
+		&error));
+	DxVerify(device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
+		IID_PPV_ARGS(&m_rootSignature)));
+	m_rootSignatureHash = PipelineStateCache::HashRootSignature(signature->GetBufferPointer(), signature->GetBufferSize());
+}
+
+void DepthPrePass::CreatePipelineStateObject(ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache)
+{
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+
+	psoDesc.InputLayout = { kInputElementDescs, _countof(kInputElementDescs) };
+	psoDesc.pRootSignature = m_rootSignature.Get();
+	psoDesc.VS = shaderCache.GetShader("DepthPrePass_vs");
+
+	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+	psoDesc.RasterizerState.FrontCounterClockwise = true;
+	psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+
+	// Stencil is written by the pass testing EQUAL after it
+	psoDesc.DepthStencilState.DepthEnable = true;
+	psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+	psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+	psoDesc.DepthStencilState.StencilEnable = false;
+
+	psoDesc.DSVFormat = kDsFormat;
+	psoDesc.SampleMask = UINT_MAX;
+	psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+
+	psoDesc.NumRenderTargets = 0;
+	psoDesc.SampleDesc.Count = 1;
+
+	m_pipelineStateObject = pipelineStateCache.CreateGraphicsPipelineStateAsync(psoDesc, m_rootSignatureHash);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <d3d12.h>
+#include <d3dx12.h>
+#include <wrl.h>
+
+#include "PipelineStateCache.h"
+
+
+class Scene;
+class ShaderCache;
+
+// Depth only draw of the scene from the position streams, the passes after it test depth EQUAL
+// and shade every pixel once. Shares the GeometryPass object tables.
+class DepthPrePass
+{
+public:
+	DepthPrePass() = default;
+	explicit DepthPrePass(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache);
+	// PSO is created asynchronously, the first Setup waits for it
+	void Initialize(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache);
+	~DepthPrePass() = default;
+
+	void Setup(ID3D12GraphicsCommandList* commandList) const;
+	// objectParameters are the GeometryPass object tables, order indexes the scene objects,
+	// a writable depth stencil view has to be bound. Returns the redundant state calls skipped.
+	uint32_t Draw(ID3D12GraphicsCommandList* commandList, CD3DX12_GPU_DESCRIPTOR_HANDLE objectParameters, Scene* scene,
+		const std::vector<uint32_t>& order) const;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12RootSignature> m_rootSignature;
+	uint64_t m_rootSignatureHash = 0;
+	PipelineStateFuture m_pipelineStateObject;
+
+	uint32_t m_cbvSrvUavDescriptorSize = 0;
+
+	void CreateRootSignature(ID3D12Device* device);
+	void CreatePipelineStateObject(ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache);
+};
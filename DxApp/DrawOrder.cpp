@@ -0,0 +1,224 @@
+#include "DrawOrder.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+
+
+using namespace SimdMath;
+
+
+namespace
+{
+	struct ClipVertex
+	{
+		float x;
+		float y;
+		float z;
+		float w;
+	};
+
+	struct ScreenVertex
+	{
+		float x;
+		float y;
+		float depth;
+	};
+
+	// Corner i of a box has x from bit 0, y from bit 1 and z from bit 2. The winding does not matter,
+	// every item keeps its nearest fragment per pixel.
+	constexpr uint32_t kBoxTriangles[12][3] = {
+		{ 0, 1, 3 }, { 0, 3, 2 }, { 4, 6, 7 }, { 4, 7, 5 },
+		{ 0, 4, 5 }, { 0, 5, 1 }, { 2, 3, 7 }, { 2, 7, 6 },
+		{ 0, 2, 6 }, { 0, 6, 4 }, { 1, 5, 7 }, { 1, 7, 3 }
+	};
+
+	ClipVertex Lerp(const ClipVertex& a, const ClipVertex& b, float t)
+	{
+		return { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t };
+	}
+
+	// Clips the triangle by the z >= 0 near plane, returns the vertices count of the convex polygon left
+	uint32_t ClipNear(const ClipVertex (&triangle)[3], ClipVertex (&polygon)[4])
+	{
+		uint32_t count = 0;
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			const ClipVertex& a = triangle[i];
+			const ClipVertex& b = triangle[(i + 1) % 3];
+			if (a.z >= 0.0f)
+				polygon[count++] = a;
+			if ((a.z >= 0.0f) != (b.z >= 0.0f))
+				polygon[count++] = Lerp(a, b, a.z / (a.z - b.z));
+		}
+		return count;
+	}
+
+	ScreenVertex ToScreen(const ClipVertex& vertex)
+	{
+		// y goes down the screen
+		const float inverseW = 1.0f / std::max(vertex.w, FLT_MIN);
+		return { (vertex.x * inverseW * 0.5f + 0.5f) * static_cast<float>(DrawOrder::kRasterWidth),
+			(0.5f - vertex.y * inverseW * 0.5f) * static_cast<float>(DrawOrder::kRasterHeight),
+			vertex.z * inverseW };
+	}
+
+	float EdgeFunction(const ScreenVertex& a, const ScreenVertex& b, float x, float y)
+	{
+		return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+	}
+
+	// Keeps the nearest depth per pixel center, touched collects the pixels written the first time
+	void RasterizeTriangle(const ScreenVertex& a, const ScreenVertex& b, const ScreenVertex& c,
+		std::vector<float>& depths, std::vector<uint32_t>& touched)
+	{
+		const float area = EdgeFunction(a, b, c.x, c.y);
+		if (std::abs(area) < 1e-6f)
+			return;
+
+		const float minX = std::max(std::min({ a.x, b.x, c.x }), 0.0f);
+		const float minY = std::max(std::min({ a.y, b.y, c.y }), 0.0f);
+		const float maxX = std::min(std::max({ a.x, b.x, c.x }), static_cast<float>(DrawOrder::kRasterWidth));
+		const float maxY = std::min(std::max({ a.y, b.y, c.y }), static_cast<float>(DrawOrder::kRasterHeight));
+		if (minX >= maxX || minY >= maxY)
+			return;
+
+		for (uint32_t y = static_cast<uint32_t>(minY); y < static_cast<uint32_t>(std::ceil(maxY)); y++)
+		{
+			for (uint32_t x = static_cast<uint32_t>(minX); x < static_cast<uint32_t>(std::ceil(maxX)); x++)
+			{
+				const float centerX = static_cast<float>(x) + 0.5f;
+				const float centerY = static_cast<float>(y) + 0.5f;
+				const float weightA = EdgeFunction(b, c, centerX, centerY) / area;
+				const float weightB = EdgeFunction(c, a, centerX, centerY) / area;
+				const float weightC = 1.0f - weightA - weightB;
+				if (weightA < 0.0f || weightB < 0.0f || weightC < 0.0f)
+					continue;
+
+				// Depth over w is linear in screen space, past the far plane is clipped
+				const float depth = weightA * a.depth + weightB * b.depth + weightC * c.depth;
+				if (depth > 1.0f)
+					continue;
+
+				float& pixelDepth = depths[x + y * DrawOrder::kRasterWidth];
+				if (pixelDepth == FLT_MAX)
+					touched.push_back(x + y * DrawOrder::kRasterWidth);
+				pixelDepth = std::min(pixelDepth, std::max(depth, 0.0f));
+			}
+		}
+	}
+}
+
+
+namespace DrawOrder
+{
+	float OverdrawEstimate::GetOverdraw() const
+	{
+		return coveredPixelsCount > 0
+			? static_cast<float>(shadedPixelsCount) / static_cast<float>(coveredPixelsCount)
+			: 0.0f;
+	}
+
+
+	float GetViewDepth(const DrawItem& item, const Float4x4& view)
+	{
+		const Vector center = VectorScale(VectorAdd(LoadFloat3(item.boundsMin), LoadFloat3(item.boundsMax)),
+			0.5f);
+		const Matrix modelView = MatrixMultiply(LoadFloat4x4(item.model), LoadFloat4x4(view));
+		return -VectorGetZ(Vector3TransformCoord(center, modelView));
+	}
+
+
+	void SortFrontToBack(const std::vector<DrawItem>& items, const Float4x4& view, std::vector<uint32_t>& order)
+	{
+		std::vector<float> depths(items.size());
+		for (uint32_t i = 0; i < items.size(); i++)
+			depths[i] = GetViewDepth(items[i], view);
+
+		order.resize(items.size());
+		std::iota(order.begin(), order.end(), 0);
+		// Stable, objects at the same depth keep the import order between frames
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return depths[a] < depths[b]; });
+	}
+
+
+	OverdrawEstimate EstimateOverdraw(const std::vector<DrawItem>& items, const std::vector<uint32_t>& order,
+		const Float4x4& viewProjection)
+	{
+		OverdrawEstimate estimate;
+
+		std::vector<float> depthBuffer(kRasterWidth * kRasterHeight, FLT_MAX);
+		std::vector<float> itemDepths(kRasterWidth * kRasterHeight, FLT_MAX);
+		std::vector<uint32_t> touched;
+
+		for (const uint32_t itemIndex : order)
+		{
+			const DrawItem& item = items[itemIndex];
+			estimate.verticesCount += item.verticesCount;
+
+			const Matrix modelViewProjection = MatrixMultiply(LoadFloat4x4(item.model),
+				LoadFloat4x4(viewProjection));
+			ClipVertex corners[8];
+			for (uint32_t i = 0; i < 8; i++)
+			{
+				const Vector corner = VectorSet((i & 1) ? item.boundsMax.x : item.boundsMin.x,
+					(i & 2) ? item.boundsMax.y : item.boundsMin.y, (i & 4) ? item.boundsMax.z : item.boundsMin.z, 1.0f);
+				Float4 clipCorner;
+				StoreFloat4(clipCorner, Vector4Transform(corner, modelViewProjection));
+				corners[i] = { clipCorner.x, clipCorner.y, clipCorner.z, clipCorner.w };
+			}
+
+			touched.clear();
+			for (const auto& triangleIndices : kBoxTriangles)
+			{
+				const ClipVertex triangle[3] = { corners[triangleIndices[0]], corners[triangleIndices[1]],
+					corners[triangleIndices[2]] };
+				ClipVertex polygon[4];
+				const uint32_t polygonSize = ClipNear(triangle, polygon);
+
+				for (uint32_t i = 2; i < polygonSize; i++)
+				{
+					RasterizeTriangle(ToScreen(polygon[0]), ToScreen(polygon[i - 1]), ToScreen(polygon[i]), itemDepths,
+						touched);
+				}
+			}
+
+			for (const uint32_t pixel : touched)
+			{
+				estimate.rasterizedPixelsCount++;
+				if (depthBuffer[pixel] == FLT_MAX)
+					estimate.coveredPixelsCount++;
+				// LESS, as the GBuffer pass without the pre-pass
+				if (itemDepths[pixel] < depthBuffer[pixel])
+				{
+					estimate.shadedPixelsCount++;
+					depthBuffer[pixel] = itemDepths[pixel];
+				}
+				itemDepths[pixel] = FLT_MAX;
+			}
+		}
+
+		return estimate;
+	}
+
+
+	DepthPrePassCost EstimateDepthPrePassCost(const OverdrawEstimate& estimate, uint32_t gBufferBytesPerPixel,
+		uint32_t depthBytesPerPixel, uint32_t screenPixelsCount)
+	{
+		const double scale = static_cast<double>(screenPixelsCount) / static_cast<double>(kRasterWidth * kRasterHeight);
+		const double rasterized = static_cast<double>(estimate.rasterizedPixelsCount) * scale;
+		const double shaded = static_cast<double>(estimate.shadedPixelsCount) * scale;
+		const double covered = static_cast<double>(estimate.coveredPixelsCount) * scale;
+
+		DepthPrePassCost cost;
+		// Every fragment reads depth, the passing ones write depth and the GBuffer
+		cost.withoutPrePass = rasterized * depthBytesPerPixel + shaded * (gBufferBytesPerPixel + depthBytesPerPixel);
+		// The pre-pass reads the positions and resolves depth, then every fragment is tested EQUAL once more
+		// and the GBuffer is written once per pixel
+		cost.withPrePass = static_cast<double>(estimate.verticesCount * kPrePassVertexSize)
+			+ rasterized * depthBytesPerPixel + shaded * depthBytesPerPixel
+			+ rasterized * depthBytesPerPixel + covered * gBufferBytesPerPixel;
+		return cost;
+	}
+} // namespace DrawOrder
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "SimdMath.h"
+
+
+// Front to back ordering of the scene draws and a software raster of their bounds estimating the overdraw,
+// which decides whether the depth pre-pass pays off. Matrices follow SimdMath row vector convention.
+namespace DrawOrder
+{
+	// Low resolution raster, the estimate is scaled to the screen
+	static constexpr uint32_t kRasterWidth = 160;
+	static constexpr uint32_t kRasterHeight = 90;
+	// Position only stream of the depth pre-pass
+	static constexpr uint32_t kPrePassVertexSize = 3 * sizeof(float);
+
+	struct DrawItem
+	{
+		// Object space bounds
+		SimdMath::Float3 boundsMin;
+		SimdMath::Float3 boundsMax;
+		SimdMath::Float4x4 model;
+		uint32_t verticesCount = 0;
+	};
+
+	// Distance along the view direction to the bounds center, the view looks along -z
+	float GetViewDepth(const DrawItem& item, const SimdMath::Float4x4& view);
+	// Indices of the items, the nearest first
+	void SortFrontToBack(const std::vector<DrawItem>& items, const SimdMath::Float4x4& view,
+		std::vector<uint32_t>& order);
+
+	struct OverdrawEstimate
+	{
+		// Raster pixels any bounds cover
+		uint32_t coveredPixelsCount = 0;
+		// Front faces of every bounds, the fragments the depth pre-pass rasterizes
+		uint32_t rasterizedPixelsCount = 0;
+		// Fragments passing the depth test in the draw order, the GBuffer writes without the pre-pass
+		uint32_t shadedPixelsCount = 0;
+		uint64_t verticesCount = 0;
+
+		// GBuffer writes per covered pixel, 1 with the pre-pass
+		[[nodiscard]] float GetOverdraw() const;
+	};
+
+	// Bounds are drawn as boxes, clipped by the near plane
+	OverdrawEstimate EstimateOverdraw(const std::vector<DrawItem>& items, const std::vector<uint32_t>& order,
+		const SimdMath::Float4x4& viewProjection);
+
+	// Bytes the geometry stage moves with and without the pre-pass, the raster is scaled to screenPixelsCount
+	struct DepthPrePassCost
+	{
+		double withoutPrePass = 0.0;
+		double withPrePass = 0.0;
+
+		[[nodiscard]] bool PaysOff() const { return withPrePass < withoutPrePass; }
+	};
+
+	DepthPrePassCost EstimateDepthPrePassCost(const OverdrawEstimate& estimate, uint32_t gBufferBytesPerPixel,
+		uint32_t depthBytesPerPixel, uint32_t screenPixelsCount);
+} // namespace DrawOrder
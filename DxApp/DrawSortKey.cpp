@@ -0,0 +1,166 @@
+#include "DrawSortKey.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+
+namespace
+{
+	constexpr uint32_t kDigitBits = 8;
+	constexpr uint32_t kDigitsCount = 64 / kDigitBits;
+	constexpr uint32_t kBucketsCount = 1 << kDigitBits;
+
+	constexpr uint64_t GetMask(uint32_t bits)
+	{
+		return (1ull << bits) - 1;
+	}
+
+	uint32_t GetField(uint64_t key, uint32_t shift, uint32_t bits)
+	{
+		return static_cast<uint32_t>((key >> shift) & GetMask(bits));
+	}
+
+	uint32_t GetDigit(uint64_t key, uint32_t digit)
+	{
+		return static_cast<uint32_t>(key >> (digit * kDigitBits)) & (kBucketsCount - 1);
+	}
+
+	double GetMilliseconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::chrono::milliseconds::period>(
+			std::chrono::high_resolution_clock::now() - start).count();
+	}
+}
+
+
+namespace DrawSortKey
+{
+	uint64_t Encode(const Fields& fields)
+	{
+		return (static_cast<uint64_t>(fields.pass) & GetMask(kPassBits)) << kPassShift
+			| (static_cast<uint64_t>(fields.pipeline) & GetMask(kPipelineBits)) << kPipelineShift
+			| (static_cast<uint64_t>(fields.material) & GetMask(kMaterialBits)) << kMaterialShift
+			| (static_cast<uint64_t>(fields.mesh) & GetMask(kMeshBits)) << kMeshShift
+			| (static_cast<uint64_t>(fields.depthBucket) & GetMask(kDepthBucketBits)) << kDepthBucketShift;
+	}
+
+
+	Fields Decode(uint64_t key)
+	{
+		Fields fields;
+		fields.pass = static_cast<Pass>(GetField(key, kPassShift, kPassBits));
+		fields.pipeline = GetField(key, kPipelineShift, kPipelineBits);
+		fields.material = GetField(key, kMaterialShift, kMaterialBits);
+		fields.mesh = GetField(key, kMeshShift, kMeshBits);
+		fields.depthBucket = GetField(key, kDepthBucketShift, kDepthBucketBits);
+		return fields;
+	}
+
+
+	uint32_t QuantizeDepth(float viewDepth, float nearClipPlane, float farClipPlane)
+	{
+		const float normalized = std::clamp((viewDepth - nearClipPlane) / (farClipPlane - nearClipPlane), 0.0f, 1.0f);
+		return static_cast<uint32_t>(normalized * static_cast<float>(GetMask(kDepthBucketBits)));
+	}
+
+
+	void RadixSorter::Sort(std::vector<SortItem>& items)
+	{
+		// Every digit histogram in one pass over the keys
+		uint32_t histograms[kDigitsCount][kBucketsCount] = {};
+		for (const auto& item : items)
+		{
+			for (uint32_t digit = 0; digit < kDigitsCount; digit++)
+				histograms[digit][GetDigit(item.key, digit)]++;
+		}
+
+		m_scratch.resize(items.size());
+		auto* source = &items;
+		auto* destination = &m_scratch;
+		for (uint32_t digit = 0; digit < kDigitsCount; digit++)
+		{
+			auto& histogram = histograms[digit];
+			if (items.empty() || histogram[GetDigit((*source)[0].key, digit)] == items.size())
+				continue;
+
+			uint32_t offsets[kBucketsCount];
+			uint32_t offset = 0;
+			for (uint32_t bucket = 0; bucket < kBucketsCount; bucket++)
+			{
+				offsets[bucket] = offset;
+				offset += histogram[bucket];
+			}
+
+			for (const auto& item : *source)
+				(*destination)[offsets[GetDigit(item.key, digit)]++] = item;
+			std::swap(source, destination);
+		}
+
+		if (source != &items)
+			items.swap(m_scratch);
+	}
+
+
+	StateChanges CountStateChanges(const std::vector<SortItem>& items)
+	{
+		StateChanges changes;
+		for (uint32_t i = 0; i < items.size(); i++)
+		{
+			const Fields fields = Decode(items[i].key);
+			// The first draw sets every state
+			const Fields previous = i > 0 ? Decode(items[i - 1].key) : Fields();
+			if (i == 0 || fields.pass != previous.pass || fields.pipeline != previous.pipeline)
+				changes.pipelinesCount++;
+			if (i == 0 || fields.material != previous.material)
+				changes.materialsCount++;
+			if (i == 0 || fields.mesh != previous.mesh)
+				changes.meshesCount++;
+		}
+		return changes;
+	}
+
+
+	BenchmarkReport Benchmark(uint32_t drawsCount, uint32_t pipelinesCount, uint32_t materialsCount,
+		uint32_t meshesCount, uint32_t iterationsCount)
+	{
+		BenchmarkReport report;
+		report.drawsCount = drawsCount;
+
+		std::mt19937 generator(0);
+		std::vector<SortItem> items(drawsCount);
+		for (uint32_t i = 0; i < drawsCount; i++)
+		{
+			Fields fields;
+			fields.pipeline = generator() % pipelinesCount;
+			fields.material = generator() % materialsCount;
+			fields.mesh = generator() % meshesCount;
+			fields.depthBucket = generator();
+			items[i] = { Encode(fields), i };
+		}
+		report.unsortedStateChanges = CountStateChanges(items);
+
+		RadixSorter sorter;
+		std::vector<SortItem> radixSorted;
+		std::vector<SortItem> stdSorted;
+		report.radixSortMilliseconds = HUGE_VAL;
+		report.stdSortMilliseconds = HUGE_VAL;
+		for (uint32_t i = 0; i < iterationsCount; i++)
+		{
+			radixSorted = items;
+			auto start = std::chrono::high_resolution_clock::now();
+			sorter.Sort(radixSorted);
+			report.radixSortMilliseconds = std::min(report.radixSortMilliseconds, GetMilliseconds(start));
+
+			stdSorted = items;
+			start = std::chrono::high_resolution_clock::now();
+			std::stable_sort(stdSorted.begin(), stdSorted.end(),
+				[](const SortItem& a, const SortItem& b) { return a.key < b.key; });
+			report.stdSortMilliseconds = std::min(report.stdSortMilliseconds, GetMilliseconds(start));
+		}
+
+		report.sortedStateChanges = CountStateChanges(radixSorted);
+		return report;
+	}
+} // namespace DrawSortKey
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+
+// 64-bit draw sort keys and the radix sort ordering the draws of a frame before they are recorded.
+// Fields from the most significant: pass, pipeline, material, mesh, depth bucket, so the most expensive
+// state changes the least often and the draws sharing state end up consecutive.
+namespace DrawSortKey
+{
+	static constexpr uint32_t kPassBits = 4;
+	static constexpr uint32_t kPipelineBits = 10;
+	static constexpr uint32_t kMaterialBits = 10;
+	static constexpr uint32_t kMeshBits = 16;
+	static constexpr uint32_t kDepthBucketBits = 24;
+
+	static constexpr uint32_t kDepthBucketShift = 0;
+	static constexpr uint32_t kMeshShift = kDepthBucketShift + kDepthBucketBits;
+	static constexpr uint32_t kMaterialShift = kMeshShift + kMeshBits;
+	static constexpr uint32_t kPipelineShift = kMaterialShift + kMaterialBits;
+	static constexpr uint32_t kPassShift = kPipelineShift + kPipelineBits;
+	static_assert(kPassShift + kPassBits == 64);
+
+	enum class Pass : uint32_t
+	{
+		DepthPrePass,
+		Geometry,
+		Forward
+	};
+
+	// Values wider than their field are masked
+	struct Fields
+	{
+		Pass pass = Pass::Geometry;
+		uint32_t pipeline = 0;
+		uint32_t material = 0;
+		uint32_t mesh = 0;
+		uint32_t depthBucket = 0;
+	};
+
+	uint64_t Encode(const Fields& fields);
+	Fields Decode(uint64_t key);
+	// Linear between the clip planes, the nearest first, clamped out of them
+	uint32_t QuantizeDepth(float viewDepth, float nearClipPlane, float farClipPlane);
+
+	struct SortItem
+	{
+		uint64_t key = 0;
+		uint32_t drawIndex = 0;
+	};
+
+	// Least significant digit first radix sort of 8 bit digits, stable.
+	// The digits every key shares are skipped, so the unused fields cost one histogram pass.
+	class RadixSorter
+	{
+	public:
+		void Sort(std::vector<SortItem>& items);
+
+	private:
+		// Kept between the frames
+		std::vector<SortItem> m_scratch;
+	};
+
+	// Changes between consecutive draws, a mesh change sets the vertex and the index buffers
+	struct StateChanges
+	{
+		uint32_t pipelinesCount = 0;
+		uint32_t materialsCount = 0;
+		uint32_t meshesCount = 0;
+
+		[[nodiscard]] uint32_t GetTotal() const { return pipelinesCount + materialsCount + meshesCount; }
+	};
+
+	StateChanges CountStateChanges(const std::vector<SortItem>& items);
+
+	struct BenchmarkReport
+	{
+		uint32_t drawsCount = 0;
+		double radixSortMilliseconds = 0.0;
+		double stdSortMilliseconds = 0.0;
+		StateChanges unsortedStateChanges;
+		StateChanges sortedStateChanges;
+	};
+
+	// Random keys of pipelinesCount x materialsCount x meshesCount states, the best time of iterationsCount sorts.
+	// Timing only, DrawSortKeyTests.cpp checks the order.
+	BenchmarkReport Benchmark(uint32_t drawsCount, uint32_t pipelinesCount, uint32_t materialsCount,
+		uint32_t meshesCount, uint32_t iterationsCount);
+} // namespace DrawSortKey
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include <d3d12.h>
+
+
+// Records the input assembler and root descriptor table calls of a draw loop, skipping the ones repeating
+// the state already set. Draws sorted by DrawSortKey share their state with the previous one the most.
+// Only for the loops setting nothing else in between.
+class DrawStateFilter
+{
+public:
+	explicit DrawStateFilter(ID3D12GraphicsCommandList* commandList) : m_commandList(commandList) { }
+
+	void SetGraphicsRootDescriptorTable(uint32_t rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE table)
+	{
+		if (m_rootParameterIndex == rootParameterIndex && m_rootTable.ptr == table.ptr)
+		{
+			m_skippedCallsCount++;
+			return;
+		}
+		m_commandList->SetGraphicsRootDescriptorTable(rootParameterIndex, table);
+		m_rootParameterIndex = rootParameterIndex;
+		m_rootTable = table;
+	}
+
+	void SetVertexBuffer(const D3D12_VERTEX_BUFFER_VIEW& view)
+	{
+		if (m_vertexBuffer.BufferLocation == view.BufferLocation && m_vertexBuffer.SizeInBytes == view.SizeInBytes
+			&& m_vertexBuffer.StrideInBytes == view.StrideInBytes)
+		{
+			m_skippedCallsCount++;
+			return;
+		}
+		m_commandList->IASetVertexBuffers(0, 1, &view);
+		m_vertexBuffer = view;
+	}
+
+	void SetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW& view)
+	{
+		if (m_indexBuffer.BufferLocation == view.BufferLocation && m_indexBuffer.SizeInBytes == view.SizeInBytes
+			&& m_indexBuffer.Format == view.Format)
+		{
+			m_skippedCallsCount++;
+			return;
+		}
+		m_commandList->IASetIndexBuffer(&view);
+		m_indexBuffer = view;
+	}
+
+	[[nodiscard]] uint32_t GetSkippedCallsCount() const { return m_skippedCallsCount; }
+
+private:
+	ID3D12GraphicsCommandList* m_commandList;
+	// Nothing is set yet
+	uint32_t m_rootParameterIndex = UINT32_MAX;
+	D3D12_GPU_DESCRIPTOR_HANDLE m_rootTable = {};
+	D3D12_VERTEX_BUFFER_VIEW m_vertexBuffer = {};
+	D3D12_INDEX_BUFFER_VIEW m_indexBuffer = {};
+	uint32_t m_skippedCallsCount = 0;
+};
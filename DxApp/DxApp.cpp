@@ -2,14 +2,18 @@
 //
 
 #include <chrono>
+#include <format>
+#include <string>
+#include <vector>
 
 #include <d3d12.h>
-#include <DirectXMath.h>
+#include "SimdMath.h"
 
 #include "framework.h"
 #include "DxApp.h"
 #include "Renderer.h"
 #include "Scene.h"
+#include "SoftwareRenderer.h"
 
 
 #define MAX_LOADSTRING 100
@@ -28,10 +32,36 @@ struct AppState
 
 	float mouseXPosDelta;
 	float mouseYPosDelta;
+
+	// LightingDebugView, selected with the 0-4 keys
+	uint32_t debugView;
+
+	// One shot requests, handled by the render loop: F switches the render path, P the depth pre-pass,
+	// B starts the render path benchmark, N adds an object with a point light to the live scene, M removes it
+	bool renderPathSwitchRequested;
+	bool depthPrePassSwitchRequested;
+	bool benchmarkRequested;
+	bool spawnRequested;
+	bool despawnRequested;
 };
 
 
 static const char* kScenePath = "Scenes/Plane.glb";
+// Baseline pipeline, the Compact GBuffer, VisibilityBuffer / GBufferIndirect geometry and TiledCompute / LightVolumes
+// lighting are opt-in
+static constexpr GBufferMode kGBufferMode = GBufferMode::Standard;
+static constexpr GeometryMode kGeometryMode = GeometryMode::GBuffer;
+static constexpr LightingMode kLightingMode = LightingMode::PixelShader;
+static constexpr RenderPath kRenderPath = RenderPath::Deferred;
+// Checks the light culling, the overdraw estimate and the indirect arguments of every scene against their CPU
+// references and prints them to the debug output, see Renderer.h
+static constexpr bool kReportDiagnostics = false;
+// Merges the scene objects into clusters on load, see StaticBatching.h. Opt-in: merged objects can not move
+// or be culled one by one anymore.
+static constexpr bool kBatchStaticGeometry = false;
+
+// "DxApp.exe --headless image.ppm" renders the scene with SoftwareRenderer and exits without a window
+static const wchar_t* kHeadlessArgument = L"--headless";
 
 // FULL HD
 static constexpr uint32_t kWindowWidth = 1920;
@@ -62,6 +92,52 @@ static void UpdateGlobalConstants()
 }
 
 
+static Scene* LoadScene()
+{
+	auto* scene = new Scene(kScenePath);
+	if (kBatchStaticGeometry)
+	{
+		const auto statistics = scene->BatchStaticObjects(StaticBatching::Settings());
+		OutputDebugStringA(std::format("Scene batching: {} objects into {} clusters in {} ms\n",
+			statistics.sourcesCount, statistics.clustersCount, statistics.milliseconds).c_str());
+	}
+	return scene;
+}
+
+
+// Returns false when the command line does not ask for the headless mode
+static bool RenderHeadless(const std::wstring& commandLine, int& exitCode)
+{
+	const std::wstring argument = kHeadlessArgument;
+	if (commandLine.compare(0, argument.size(), argument) != 0)
+		return false;
+
+	std::wstring imagePath = commandLine.substr(argument.size());
+	std::erase(imagePath, L'"');
+	imagePath.erase(0, imagePath.find_first_not_of(L' '));
+	imagePath.erase(imagePath.find_last_not_of(L' ') + 1);
+	if (imagePath.empty())
+		imagePath = L"Headless.ppm";
+
+	Scene* scene = LoadScene();
+	const Camera& camera = scene->GetCamera();
+	SoftwareRenderer::View view;
+	StoreFloat4x4(view.viewProjection, MatrixMultiply(LoadFloat4x4(camera.GetViewMatrix()),
+		LoadFloat4x4(camera.GetProjectionMatrix(static_cast<float>(kWindowWidth) / kWindowHeight))));
+	view.position = camera.GetPosition();
+	SoftwareRenderer softwareRenderer(kWindowWidth, kWindowHeight);
+	softwareRenderer.Render(scene->GetObjectSources(), scene->GetLightSources(), view);
+	const auto& timings = softwareRenderer.GetTimings();
+	OutputDebugStringA(std::format(
+		"Software renderer: {} triangles, transform {:.2f} ms, binning {:.2f} ms, tiles {:.2f} ms, total {:.2f} ms\n",
+		softwareRenderer.GetTrianglesCount(), timings.transformMilliseconds, timings.binningMilliseconds,
+		timings.tilesMilliseconds, timings.GetTotalMilliseconds()).c_str());
+	exitCode = softwareRenderer.WriteImage(imagePath) ? 0 : 1;
+	delete scene;
+	return true;
+}
+
+
 inline AppState* GetAppState(HWND hwnd)
 {
 	LONG_PTR ptr = GetWindowLongPtr(hwnd, GWLP_USERDATA);
@@ -87,7 +163,9 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
 	_In_ int nCmdShow)
 {
 	UNREFERENCED_PARAMETER(hPrevInstance);
-	UNREFERENCED_PARAMETER(lpCmdLine);
+
+	if (int exitCode = 0; RenderHeadless(lpCmdLine, exitCode))
+		return exitCode;
 
 	// Инициализация глобальных строк
 	LoadStringW(hInstance, IDS_APP_TITLE, szTitle, MAX_LOADSTRING);
@@ -103,12 +181,24 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
 
 	HACCEL hAccelTable = LoadAccelerators(hInstance, MAKEINTRESOURCE(IDC_DXAPP));
 
-	auto* scene = new Scene(kScenePath);
-	auto* baseRenderer = new Renderer(hwnd, kWindowWidth, kWindowHeight);
+	auto* scene = LoadScene();
+	auto* baseRenderer = new Renderer(hwnd, kWindowWidth, kWindowHeight, kGBufferMode, kGeometryMode, kLightingMode,
+		kReportDiagnostics);
+	baseRenderer->SetRenderPath(kRenderPath);
 	baseRenderer->SetScene(scene);
 
 	auto lastFrameTime = std::chrono::high_resolution_clock::now();
 
+	// Objects of the N key, removed last in first out with their point lights. RemovePoint moves the last point
+	// light to the removed index, the spawned light there follows it.
+	constexpr uint32_t kNoLight = UINT32_MAX;
+	struct SpawnedObject
+	{
+		SceneObjectHandle handle;
+		uint32_t pointLight;
+	};
+	std::vector<SpawnedObject> spawnedObjects;
+
 	MSG msg{};
 	while (true)
 	{
@@ -130,8 +220,8 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
 			const float cameraOffset = kCameraSpeed * GDeltaTime;
 
 			Camera& camera = scene->GetCamera();
-			XMFLOAT3 cameraTranslation;
-			XMStoreFloat3(&cameraTranslation, XMVectorZero());
+			Float3 cameraTranslation;
+			StoreFloat3(cameraTranslation, VectorZero());
 			if (pState->upPressed)
 				cameraTranslation.z += cameraOffset;
 			if (pState->downPressed)
@@ -145,11 +235,74 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
 
 			if (pState->secondaryMBPressed)
 			{
-				camera.Rotate(XMFLOAT2(pState->mouseXPosDelta * kCameraRotationSpeed, -pState->mouseYPosDelta * kCameraRotationSpeed));
+				camera.Rotate(Float2(pState->mouseXPosDelta * kCameraRotationSpeed, -pState->mouseYPosDelta * kCameraRotationSpeed));
 				pState->mouseXPosDelta = 0.0f;
 				pState->mouseYPosDelta = 0.0f;
 			}
 
+			baseRenderer->SetLightingDebugView(static_cast<LightingDebugView>(pState->debugView));
+
+			if (pState->renderPathSwitchRequested)
+			{
+				baseRenderer->SetRenderPath(baseRenderer->GetRenderPath() == RenderPath::Deferred
+					? RenderPath::ClusteredForward
+					: RenderPath::Deferred);
+				pState->renderPathSwitchRequested = false;
+			}
+			if (pState->depthPrePassSwitchRequested)
+			{
+				// Off, on, auto
+				const uint32_t mode = static_cast<uint32_t>(baseRenderer->GetDepthPrePassMode());
+				baseRenderer->SetDepthPrePassMode(static_cast<DepthPrePassMode>(
+					(mode + 1) % static_cast<uint32_t>(DepthPrePassMode::Count)));
+				pState->depthPrePassSwitchRequested = false;
+			}
+			if (pState->benchmarkRequested)
+			{
+				baseRenderer->StartRenderPathBenchmark();
+				pState->benchmarkRequested = false;
+			}
+			if (pState->spawnRequested && scene->GetMeshesCount() > 0)
+			{
+				// A row along x, the renderer picks the edits up with the next frame
+				const float x = 2.0f * static_cast<float>(spawnedObjects.size() + 1);
+				Float4x4 model;
+				StoreFloat4x4(model, MatrixTranslation(x, 0.0f, 0.0f));
+				// Invalid once the scene is at the object limit of the geometry mode
+				const SceneObjectHandle handle = scene->AddObject(
+					static_cast<uint32_t>(spawnedObjects.size() % scene->GetMeshesCount()), model);
+				if (scene->IsValid(handle))
+				{
+					auto& lightSources = scene->GetLightSources();
+					uint32_t pointLight = kNoLight;
+					if (lightSources.GetPointLightSourcesCount() < LightSources::kMaxPointLightSourcesCount)
+					{
+						pointLight = lightSources.GetPointLightSourcesCount();
+						lightSources.AddPoint(PointLightSource(Float4(5.0f, 5.0f, 5.0f, 1.0f),
+							Float4(x, 1.0f, 0.0f, 1.0f)));
+					}
+					spawnedObjects.push_back({ handle, pointLight });
+				}
+			}
+			if (pState->despawnRequested && !spawnedObjects.empty())
+			{
+				const SpawnedObject spawned = spawnedObjects.back();
+				spawnedObjects.pop_back();
+				scene->RemoveObject(spawned.handle);
+				auto& lightSources = scene->GetLightSources();
+				if (spawned.pointLight != kNoLight && spawned.pointLight < lightSources.GetPointLightSourcesCount())
+				{
+					const uint32_t lastLight = lightSources.GetPointLightSourcesCount() - 1;
+					lightSources.RemovePoint(spawned.pointLight);
+					for (auto& other : spawnedObjects)
+					{
+						if (other.pointLight == lastLight)
+							other.pointLight = spawned.pointLight;
+					}
+				}
+			}
+			pState->spawnRequested = false;
+			pState->despawnRequested = false;
 		}
 
 		constexpr D3D12_VIEWPORT viewport = {
@@ -296,6 +449,28 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 		case 'D':
 			pState->rightPressed = true;
 			break;
+		case '0':
+		case '1':
+		case '2':
+		case '3':
+		case '4':
+			pState->debugView = static_cast<uint32_t>(wParam - '0');
+			break;
+		case 'F':
+			pState->renderPathSwitchRequested = true;
+			break;
+		case 'P':
+			pState->depthPrePassSwitchRequested = true;
+			break;
+		case 'B':
+			pState->benchmarkRequested = true;
+			break;
+		case 'N':
+			pState->spawnRequested = true;
+			break;
+		case 'M':
+			pState->despawnRequested = true;
+			break;
 		}
 
 		return 0;
@@ -34,6 +34,12 @@ namespace DxHelper
 		return (size + temp) & ~temp;
 	}
 
+	inline uint64_t Align(const uint64_t size, const uint64_t alignment)
+	{
+		const uint64_t temp = alignment - 1;
+		return (size + temp) & ~temp;
+	}
+
 	inline void SetRenderTarget(ID3D12GraphicsCommandList* commandList,
 		D3D12_VIEWPORT									   viewport)
 	{
@@ -1,11 +1,55 @@
 #include "GBuffer.h"
+
+#include <cassert>
+
 #include "DxHelpers.h"
 
 
-void GBuffer::CreateResources(ID3D12Device* device, uint32_t windowWidth, uint32_t windowHeight)
+namespace
 {
+	const wchar_t* kStandardRtNames[] = {
+		L"GBuffer::SurfaceColorRt",
+		L"GBuffer::PositionRoughnessRt",
+		L"GBuffer::NormalMetalnessRt",
+		L"GBuffer::FresnelIndicesRt"
+	};
+	const wchar_t* kCompactRtNames[] = {
+		L"GBuffer::SurfaceColorMaterialRt",
+		L"GBuffer::NormalRt",
+		L"GBuffer::RoughnessMetalnessRt"
+	};
+	static_assert(std::size(kStandardRtNames) == std::size(GBuffer::kStandardRtFormats));
+	static_assert(std::size(kCompactRtNames) == std::size(GBuffer::kCompactRtFormats));
+
+	uint32_t GetFormatSize(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+			case DXGI_FORMAT_R8G8_UNORM:
+				return 2;
+			case DXGI_FORMAT_R8G8B8A8_UNORM:
+			case DXGI_FORMAT_R16G16_SNORM:
+				return 4;
+			case DXGI_FORMAT_R16G16B16A16_FLOAT:
+				return 8;
+			default:
+				assert(false);
+				return 0;
+		}
+	}
+}
+
+
+void GBuffer::CreateResources(ID3D12Device* device, GpuHeapAllocator& heapAllocator, GBufferMode mode,
+	uint32_t windowWidth, uint32_t windowHeight)
+{
+	m_mode = mode;
+	const uint32_t rtCount = GetRtCount();
+	const DXGI_FORMAT* rtFormats = GetRtFormats(mode);
+	const wchar_t* const* rtNames = mode == GBufferMode::Compact ? kCompactRtNames : kStandardRtNames;
+
 	D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {};
-	rtvHeapDesc.NumDescriptors = kRtCount;
+	rtvHeapDesc.NumDescriptors = rtCount;
 	rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
 	rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
 	DxVerify(device->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&m_rtvHeap)));
@@ -13,67 +57,73 @@ void GBuffer::CreateResources(ID3D12Device* device, uint32_t windowWidth, uint32
 	auto rtvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_rtvHeap->GetCPUDescriptorHandleForHeapStart());
 	const uint32_t rtvDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
 
-	auto resourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, windowWidth, windowHeight,
-		1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
-	D3D12_CLEAR_VALUE clearValue = { DXGI_FORMAT_R8G8B8A8_UNORM, {0.0f, 0.0f, 0.0f, 1.0f} };
-
-	const CD3DX12_HEAP_PROPERTIES gBufferHeapProperties(D3D12_HEAP_TYPE_DEFAULT);
-
-	DxVerify(device->CreateCommittedResource(&gBufferHeapProperties,
-		D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES, &resourceDesc,
-		D3D12_RESOURCE_STATE_GENERIC_READ, &clearValue,
-		IID_PPV_ARGS(&m_surfaceColorRt)));
-	m_surfaceColorRt->SetName(TEXT("GBuffer::SurfaceColorRt"));
-	device->CreateRenderTargetView(m_surfaceColorRt.Get(), nullptr, rtvHandle);
-	rtvHandle.Offset(1, rtvDescriptorSize);
-
-	resourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R16G16B16A16_FLOAT, windowWidth, windowHeight,
-		1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
-	clearValue.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
-
-	DxVerify(device->CreateCommittedResource(&gBufferHeapProperties,
-		D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES, &resourceDesc,
-		D3D12_RESOURCE_STATE_GENERIC_READ, &clearValue,
-		IID_PPV_ARGS(&m_positionRoughnessRt)));
-	m_positionRoughnessRt->SetName(TEXT("GBuffer::PositionRoughnessRt"));
-	device->CreateRenderTargetView(m_positionRoughnessRt.Get(), nullptr, rtvHandle);
-	rtvHandle.Offset(1, rtvDescriptorSize);
-
-	DxVerify(device->CreateCommittedResource(&gBufferHeapProperties,
-		D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES, &resourceDesc,
-		D3D12_RESOURCE_STATE_GENERIC_READ, &clearValue,
-		IID_PPV_ARGS(&m_normalMetalnessRt)));
-	m_normalMetalnessRt->SetName(TEXT("GBuffer::NormalMetalnessRt"));
-	device->CreateRenderTargetView(m_normalMetalnessRt.Get(), nullptr, rtvHandle);
-	rtvHandle.Offset(1, rtvDescriptorSize);
-
-	resourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, windowWidth, windowHeight,
-		1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
-	clearValue.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-
-	DxVerify(device->CreateCommittedResource(&gBufferHeapProperties,
-		D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES, &resourceDesc,
-		D3D12_RESOURCE_STATE_GENERIC_READ, &clearValue,
-		IID_PPV_ARGS(&m_fresnelIndicesRt)));
-	m_fresnelIndicesRt->SetName(TEXT("GBuffer::FresnelIndicesRt"));
-	device->CreateRenderTargetView(m_fresnelIndicesRt.Get(), nullptr, rtvHandle);
-	rtvHandle.Offset(1, rtvDescriptorSize);
+	for (uint32_t i = 0; i < rtCount; i++)
+	{
+		const auto resourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(rtFormats[i], windowWidth, windowHeight,
+			1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+		const D3D12_CLEAR_VALUE clearValue = { rtFormats[i], {0.0f, 0.0f, 0.0f, 1.0f} };
+
+		m_allocations[i] = heapAllocator.CreateResource(GpuHeapCategory::RenderTargets, resourceDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ, &clearValue, m_renderTargets[i]);
+		m_renderTargets[i]->SetName(rtNames[i]);
+		device->CreateRenderTargetView(m_renderTargets[i].Get(), nullptr, rtvHandle);
+		rtvHandle.Offset(1, rtvDescriptorSize);
+	}
 }
 
 
-void GBuffer::AddBarriers(CD3DX12_RESOURCE_BARRIER* array, D3D12_RESOURCE_STATES stateBefore,
+void GBuffer::DestroyResources(GpuHeapAllocator& heapAllocator)
+{
+	for (auto& renderTarget : m_renderTargets)
+		renderTarget.Reset();
+
+	for (auto& allocation : m_allocations)
+		heapAllocator.Free(allocation);
+}
+
+
+uint32_t GBuffer::AddBarriers(CD3DX12_RESOURCE_BARRIER* array, D3D12_RESOURCE_STATES stateBefore,
 	D3D12_RESOURCE_STATES stateAfter) const
 {
-	array[0] = CD3DX12_RESOURCE_BARRIER::Transition(m_surfaceColorRt.Get(),
-		stateBefore,
-		stateAfter);
-	array[1] = CD3DX12_RESOURCE_BARRIER::Transition(m_positionRoughnessRt.Get(),
-		stateBefore,
-		stateAfter);
-	array[2] = CD3DX12_RESOURCE_BARRIER::Transition(m_normalMetalnessRt.Get(),
-		stateBefore,
-		stateAfter);
-	array[3] = CD3DX12_RESOURCE_BARRIER::Transition(m_fresnelIndicesRt.Get(),
-		stateBefore,
-		stateAfter);
+	const uint32_t rtCount = GetRtCount();
+	for (uint32_t i = 0; i < rtCount; i++)
+	{
+		array[i] = CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[i].Get(),
+			stateBefore,
+			stateAfter);
+	}
+
+	return rtCount;
+}
+
+
+uint32_t GBuffer::GetRtCount(GBufferMode mode)
+{
+	return mode == GBufferMode::Compact
+		? static_cast<uint32_t>(std::size(kCompactRtFormats))
+		: static_cast<uint32_t>(std::size(kStandardRtFormats));
+}
+
+
+const DXGI_FORMAT* GBuffer::GetRtFormats(GBufferMode mode)
+{
+	return mode == GBufferMode::Compact ? kCompactRtFormats : kStandardRtFormats;
+}
+
+
+uint32_t GBuffer::GetBytesPerPixel(GBufferMode mode)
+{
+	const DXGI_FORMAT* rtFormats = GetRtFormats(mode);
+
+	uint32_t size = 0;
+	for (uint32_t i = 0; i < GetRtCount(mode); i++)
+		size += GetFormatSize(rtFormats[i]);
+
+	return size;
+}
+
+
+const char* GBuffer::GetModeName(GBufferMode mode)
+{
+	return mode == GBufferMode::Compact ? "Compact" : "Standard";
 }
@@ -5,26 +5,59 @@
 #include <d3dx12.h>
 #include <wrl.h>
 
+#include "GpuHeapAllocator.h"
+
+
+enum class GBufferMode : uint32_t
+{
+	// Surface color, position + roughness, normal + metalness, fresnel indices
+	Standard,
+	// Surface color + material index, octahedral normal, roughness + metalness.
+	// Position is reconstructed from the depth buffer, fresnel indices come from the material table.
+	Compact,
+	Count
+};
+
 
 class GBuffer
 {
 public:
-	static constexpr DXGI_FORMAT kRtFormats[] = {
+	static constexpr DXGI_FORMAT kStandardRtFormats[] = {
 		DXGI_FORMAT_R8G8B8A8_UNORM,
 		DXGI_FORMAT_R16G16B16A16_FLOAT,
 		DXGI_FORMAT_R16G16B16A16_FLOAT,
 		DXGI_FORMAT_R8G8B8A8_UNORM
 	};
-	static constexpr uint32_t kRtCount = static_cast<uint32_t>(std::size(kRtFormats));
+	static constexpr DXGI_FORMAT kCompactRtFormats[] = {
+		DXGI_FORMAT_R8G8B8A8_UNORM,
+		DXGI_FORMAT_R16G16_SNORM,
+		DXGI_FORMAT_R8G8_UNORM
+	};
+	static constexpr uint32_t kMaxRtCount = static_cast<uint32_t>(std::size(kStandardRtFormats));
+	// Textures the lighting pass reads in every mode, compact mode reads the depth buffer in the place of the 4th target
+	static constexpr uint32_t kSrvCount = 4;
 
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
-	Microsoft::WRL::ComPtr<ID3D12Resource> m_surfaceColorRt;
-	Microsoft::WRL::ComPtr<ID3D12Resource> m_positionRoughnessRt;
-	Microsoft::WRL::ComPtr<ID3D12Resource> m_normalMetalnessRt;
-	Microsoft::WRL::ComPtr<ID3D12Resource> m_fresnelIndicesRt;
 
-	void CreateResources(ID3D12Device* device, uint32_t windowWidth, uint32_t windowHeight);
-	void AddBarriers(CD3DX12_RESOURCE_BARRIER* array, D3D12_RESOURCE_STATES stateBefore,
+	void CreateResources(ID3D12Device* device, GpuHeapAllocator& heapAllocator, GBufferMode mode,
+		uint32_t windowWidth, uint32_t windowHeight);
+	void DestroyResources(GpuHeapAllocator& heapAllocator);
+	// Returns the count of the written barriers, at most kMaxRtCount
+	uint32_t AddBarriers(CD3DX12_RESOURCE_BARRIER* array, D3D12_RESOURCE_STATES stateBefore,
 		D3D12_RESOURCE_STATES stateAfter) const;
-};
 
+	[[nodiscard]] GBufferMode GetMode() const { return m_mode; }
+	[[nodiscard]] uint32_t GetRtCount() const { return GetRtCount(m_mode); }
+	[[nodiscard]] ID3D12Resource* GetRt(uint32_t index) const { return m_renderTargets[index].Get(); }
+
+	static uint32_t GetRtCount(GBufferMode mode);
+	static const DXGI_FORMAT* GetRtFormats(GBufferMode mode);
+	// Render targets only, the depth buffer is shared by the modes
+	static uint32_t GetBytesPerPixel(GBufferMode mode);
+	static const char* GetModeName(GBufferMode mode);
+
+private:
+	GBufferMode m_mode = GBufferMode::Standard;
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_renderTargets[kMaxRtCount];
+	GpuAllocation m_allocations[kMaxRtCount];
+};
@@ -0,0 +1,181 @@
+#include "GBufferEncoding.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+using namespace SimdMath;
+
+
+namespace
+{
+	float SignNotZero(float value)
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	float Length(const Float3& vector)
+	{
+		return std::sqrt(vector.x * vector.x + vector.y * vector.y + vector.z * vector.z);
+	}
+
+	// Row vector times matrix, same as mul(matrix, vector) in the shaders with column major packing
+	Float4 Transform(const Float4& vector, const Float4x4& matrix)
+	{
+		Float4 result;
+		result.x = vector.x * matrix._11 + vector.y * matrix._21 + vector.z * matrix._31 + vector.w * matrix._41;
+		result.y = vector.x * matrix._12 + vector.y * matrix._22 + vector.z * matrix._32 + vector.w * matrix._42;
+		result.z = vector.x * matrix._13 + vector.y * matrix._23 + vector.z * matrix._33 + vector.w * matrix._43;
+		result.w = vector.x * matrix._14 + vector.y * matrix._24 + vector.z * matrix._34 + vector.w * matrix._44;
+		return result;
+	}
+
+	// D3D float to SNORM: clamp, scale, round to nearest
+	int16_t FloatToSnorm16(float value)
+	{
+		return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	// -32768 and -32767 both map to -1
+	float Snorm16ToFloat(int16_t value)
+	{
+		return std::max(static_cast<float>(value) / 32767.0f, -1.0f);
+	}
+
+	uint8_t FloatToUnorm8(float value)
+	{
+		return static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+	}
+
+	float Unorm8ToFloat(uint8_t value)
+	{
+		return static_cast<float>(value) / 255.0f;
+	}
+}
+
+
+namespace GBufferEncoding
+{
+	Float2 EncodeOctahedralNormal(const Float3& normal)
+	{
+		const float invL1Norm = 1.0f / (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z));
+		const float x = normal.x * invL1Norm;
+		const float y = normal.y * invL1Norm;
+
+		// Lower hemisphere is folded over the diagonals
+		if (normal.z >= 0.0f)
+			return { x, y };
+		return { (1.0f - std::abs(y)) * SignNotZero(x), (1.0f - std::abs(x)) * SignNotZero(y) };
+	}
+
+
+	Float3 DecodeOctahedralNormal(const Float2& encoded)
+	{
+		Float3 normal = { encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y) };
+		const float fold = std::max(-normal.z, 0.0f);
+		normal.x += normal.x >= 0.0f ? -fold : fold;
+		normal.y += normal.y >= 0.0f ? -fold : fold;
+
+		const float invLength = 1.0f / Length(normal);
+		return { normal.x * invLength, normal.y * invLength, normal.z * invLength };
+	}
+
+
+	uint32_t PackSnorm16x2(const Float2& value)
+	{
+		const auto x = static_cast<uint16_t>(FloatToSnorm16(value.x));
+		const auto y = static_cast<uint16_t>(FloatToSnorm16(value.y));
+		return static_cast<uint32_t>(x) | (static_cast<uint32_t>(y) << 16);
+	}
+
+
+	Float2 UnpackSnorm16x2(uint32_t packed)
+	{
+		return { Snorm16ToFloat(static_cast<int16_t>(packed & 0xffff)), Snorm16ToFloat(static_cast<int16_t>(packed >> 16)) };
+	}
+
+
+	uint16_t PackUnorm8x2(const Float2& value)
+	{
+		return static_cast<uint16_t>(FloatToUnorm8(value.x) | (FloatToUnorm8(value.y) << 8));
+	}
+
+
+	Float2 UnpackUnorm8x2(uint16_t packed)
+	{
+		return { Unorm8ToFloat(static_cast<uint8_t>(packed & 0xff)), Unorm8ToFloat(static_cast<uint8_t>(packed >> 8)) };
+	}
+
+
+	float EncodeMaterialIndex(uint32_t materialIndex)
+	{
+		return static_cast<float>(materialIndex) / 255.0f;
+	}
+
+
+	uint32_t DecodeMaterialIndex(float encoded)
+	{
+		return static_cast<uint32_t>(encoded * 255.0f + 0.5f);
+	}
+
+
+	Float3 ReconstructPosition(const Float2& uv, float depth, const Float4x4& inverseViewProjection)
+	{
+		const Float4 clipPosition = { uv.x * 2.0f - 1.0f, 1.0f - uv.y * 2.0f, depth, 1.0f };
+		const Float4 position = Transform(clipPosition, inverseViewProjection);
+
+		return { position.x / position.w, position.y / position.w, position.z / position.w };
+	}
+
+
+	PrecisionReport MeasurePrecision(const Float4x4& viewProjection, const Float4x4& inverseViewProjection,
+		const Float3& cameraPosition, uint32_t samplesCount)
+	{
+		PrecisionReport report;
+
+		const float goldenAngle = kPi * (3.0f - std::sqrt(5.0f));
+		for (uint32_t i = 0; i < samplesCount; i++)
+		{
+			// Fibonacci sphere
+			const float z = 1.0f - 2.0f * (static_cast<float>(i) + 0.5f) / static_cast<float>(samplesCount);
+			const float radius = std::sqrt(1.0f - z * z);
+			const float angle = goldenAngle * static_cast<float>(i);
+			const Float3 normal = { radius * std::cos(angle), radius * std::sin(angle), z };
+
+			const Float3 decodedNormal = DecodeOctahedralNormal(UnpackSnorm16x2(PackSnorm16x2(
+				EncodeOctahedralNormal(normal))));
+			const float cosine = normal.x * decodedNormal.x + normal.y * decodedNormal.y + normal.z * decodedNormal.z;
+			report.maxNormalError = std::max(report.maxNormalError, std::acos(std::min(cosine, 1.0f)));
+
+			const Float2 roughnessMetalness = {
+				static_cast<float>(i) / static_cast<float>(samplesCount),
+				1.0f - static_cast<float>(i) / static_cast<float>(samplesCount)
+			};
+			const Float2 decodedRoughnessMetalness = UnpackUnorm8x2(PackUnorm8x2(roughnessMetalness));
+			report.maxRoughnessMetalnessError = std::max({ report.maxRoughnessMetalnessError,
+				std::abs(roughnessMetalness.x - decodedRoughnessMetalness.x),
+				std::abs(roughnessMetalness.y - decodedRoughnessMetalness.y) });
+
+			// Point of the frustum, then the depth buffer round trip
+			const Float2 uv = { (static_cast<float>(i % 64) + 0.5f) / 64.0f,
+				(static_cast<float>((i / 64) % 64) + 0.5f) / 64.0f };
+			const float depth = (static_cast<float>(i) + 0.5f) / static_cast<float>(samplesCount);
+			const Float3 position = ReconstructPosition(uv, depth, inverseViewProjection);
+
+			const Float4 clipPosition = Transform({ position.x, position.y, position.z, 1.0f }, viewProjection);
+			const Float2 projectedUv = { clipPosition.x / clipPosition.w * 0.5f + 0.5f,
+				0.5f - clipPosition.y / clipPosition.w * 0.5f };
+			const Float3 reconstructedPosition = ReconstructPosition(projectedUv, clipPosition.z / clipPosition.w,
+				inverseViewProjection);
+
+			const Float3 error = { reconstructedPosition.x - position.x, reconstructedPosition.y - position.y,
+				reconstructedPosition.z - position.z };
+			const Float3 offset = { position.x - cameraPosition.x, position.y - cameraPosition.y,
+				position.z - cameraPosition.z };
+			report.maxRelativePositionError = std::max(report.maxRelativePositionError,
+				Length(error) / std::max(Length(offset), 1e-6f));
+		}
+
+		return report;
+	}
+} // namespace GBufferEncoding
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include "SimdMath.h"
+
+
+// CPU reference of the compact GBuffer encoding, Shaders/Deferred/GBufferEncoding.hlsli has to stay in sync.
+// Packing functions reproduce the D3D format conversion rules, so values match what the shaders read back.
+namespace GBufferEncoding
+{
+	// Material constants of GBufferEncoding.hlsli, every object uses material 0
+	static constexpr uint32_t kMaterialIndex = 0;
+	static constexpr float kRoughness = 0.1f;
+	static constexpr float kMetalness = 0.0f;
+	static constexpr SimdMath::Float3 kMaterialFresnelIndices[] = { SimdMath::Float3(0.6f, 0.7f, 0.8f) };
+
+	// Octahedral mapping of a unit vector to [-1, 1]^2
+	SimdMath::Float2 EncodeOctahedralNormal(const SimdMath::Float3& normal);
+	SimdMath::Float3 DecodeOctahedralNormal(const SimdMath::Float2& encoded);
+
+	// DXGI_FORMAT_R16G16_SNORM texel
+	uint32_t PackSnorm16x2(const SimdMath::Float2& value);
+	SimdMath::Float2 UnpackSnorm16x2(uint32_t packed);
+
+	// DXGI_FORMAT_R8G8_UNORM texel, roughness in x, metalness in y
+	uint16_t PackUnorm8x2(const SimdMath::Float2& value);
+	SimdMath::Float2 UnpackUnorm8x2(uint16_t packed);
+
+	// Material index in the alpha of the R8G8B8A8_UNORM surface color target
+	float EncodeMaterialIndex(uint32_t materialIndex);
+	uint32_t DecodeMaterialIndex(float encoded);
+
+	// uv of the pixel center in [0, 1] with y down, depth as stored in the depth buffer.
+	// Matrices follow SimdMath row vector convention.
+	SimdMath::Float3 ReconstructPosition(const SimdMath::Float2& uv, float depth,
+		const SimdMath::Float4x4& inverseViewProjection);
+
+	struct PrecisionReport
+	{
+		// Radians
+		float maxNormalError = 0.0f;
+		float maxRoughnessMetalnessError = 0.0f;
+		// World units, relative to the distance from the camera
+		float maxRelativePositionError = 0.0f;
+	};
+
+	// Round trips normals from a fibonacci sphere, roughness/metalness ramps and positions over the view frustum
+	PrecisionReport MeasurePrecision(const SimdMath::Float4x4& viewProjection,
+		const SimdMath::Float4x4& inverseViewProjection, const SimdMath::Float3& cameraPosition,
+		uint32_t samplesCount);
+} // namespace GBufferEncoding
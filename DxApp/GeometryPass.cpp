@@ -1,24 +1,41 @@
 #include "GeometryPass.h"
 
-#include <d3dcompiler.h>
+#include <algorithm>
 
 #include "RendererForwards.h"
+#include "DrawStateFilter.h"
 #include "DxHelpers.h"
 #include "GBuffer.h"
 #include "GeometryPassObjectConstantBuffer.h"
+#include "ObjectTransforms.h"
 #include "Scene.h"
+#include "ShaderCache.h"
 
 using namespace Microsoft::WRL;
 
-GeometryPass::GeometryPass(ID3D12Device* device)
+namespace
 {
-	Initialize(device);
+	// Referenced by the PSO desc until the asynchronous PSO creation is done
+	const D3D12_INPUT_ELEMENT_DESC kInputElementDescs[] = {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT,
+			D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT,
+			D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+	};
 }
 
-void GeometryPass::Initialize(ID3D12Device* device)
+GeometryPass::GeometryPass(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache,
+	GBufferMode gBufferMode)
+{
+	Initialize(device, shaderCache, pipelineStateCache, gBufferMode);
+}
+
+void GeometryPass::Initialize(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache,
+	GBufferMode gBufferMode)
 {
 	CreateRootSignature(device);
-	CreatePipelineStateObject(device);
+	CreatePipelineStateObjects(shaderCache, pipelineStateCache, gBufferMode);
 
 	m_cbvSrvUavDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 }
@@ -31,7 +48,8 @@ void GeometryPass::SetScene(Scene* scene)
 void GeometryPass::SetupRootResourceDescriptors(ID3D12Device* device, CD3DX12_CPU_DESCRIPTOR_HANDLE rootParameters,
 	D3D12_GPU_VIRTUAL_ADDRESS dataAddress) const
 {
-	for (uint32_t j = 0; j < m_scene->GetSceneObjectsCount(); j++)
+	// One per slot, the dead and unused slots keep theirs for the next objects
+	for (uint32_t j = 0; j < m_objectsCapacity; j++)
 	{
 		D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
 		cbvDesc.BufferLocation = dataAddress;
@@ -45,59 +63,51 @@ void GeometryPass::SetupRootResourceDescriptors(ID3D12Device* device, CD3DX12_CP
 
 void GeometryPass::UpdateRootResources(uint8_t* cbData, float appAspect) const
 {
-	for (uint32_t i = 0; i < m_scene->GetSceneObjects().size(); i++)
-	{
-		new (cbData) GeometryPassObjectConstantBuffer();
-		auto& sceneObjectData = *reinterpret_cast<GeometryPassObjectConstantBuffer*>(cbData);
-
-		sceneObjectData.model = m_scene->GetSceneObjects()[i].GetTransformMatrix();
-		sceneObjectData.view = m_scene->GetCamera().GetViewMatrix();
-		sceneObjectData.projection = m_scene->GetCamera().GetProjectionMatrix(appAspect);
-
-		const XMMATRIX modelMatrix = XMLoadFloat4x4(&sceneObjectData.model);
-		const XMMATRIX viewMatrix = XMLoadFloat4x4(&sceneObjectData.view);
-		XMMATRIX	   projectionMatrix = XMLoadFloat4x4(&sceneObjectData.projection);
-
-		XMMATRIX vpMatrix = XMMatrixMultiply(viewMatrix, projectionMatrix);
-
-		XMStoreFloat4x4(&sceneObjectData.vp, vpMatrix);
-		XMStoreFloat4x4(&sceneObjectData.mvp, XMMatrixMultiply(modelMatrix, vpMatrix));
-
-		cbData += GeometryPassObjectConstantBuffer::GetAlignedSize();
-	}
+	// A scene loaded past the object limit of the geometry mode only has its first slots drawn
+	const uint32_t objectsCount = std::min(m_scene->GetObjectSlotsCount(), m_objectsCapacity);
+	const auto& camera = m_scene->GetCamera();
+	ObjectTransforms::WriteObjectData(m_scene->GetTransforms(), objectsCount, camera.GetViewMatrix(),
+		camera.GetProjectionMatrix(appAspect), cbData, GeometryPassObjectConstantBuffer::GetAlignedSize());
 }
 
-void GeometryPass::Setup(ID3D12GraphicsCommandList* commandList) const
+void GeometryPass::Setup(ID3D12GraphicsCommandList* commandList, bool depthPrePass) const
 {
-	commandList->SetPipelineState(m_pipelineStateObject.Get());
+	commandList->SetPipelineState(depthPrePass
+		? m_depthEqualPipelineStateObject.get().Get()
+		: m_pipelineStateObject.get().Get());
 	commandList->SetGraphicsRootSignature(m_rootSignature.Get());
 }
 
-void GeometryPass::Draw(ID3D12GraphicsCommandList* commandList, CD3DX12_GPU_DESCRIPTOR_HANDLE rootParameters, Scene* scene) const
+uint32_t GeometryPass::Draw(ID3D12GraphicsCommandList* commandList, CD3DX12_GPU_DESCRIPTOR_HANDLE rootParameters, Scene* scene,
+	const std::vector<uint32_t>& order) const
 {
 	commandList->OMSetStencilRef(kGeometryStencilRef);
 	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-	for (auto& sceneObject : scene->GetSceneObjects())
+	DrawStateFilter stateFilter(commandList);
+	const auto& objectMeshes = scene->GetObjectMeshes();
+	for (const uint32_t objectIndex : order)
 	{
-		commandList->SetGraphicsRootDescriptorTable(0, rootParameters);
-		rootParameters.Offset(1, m_cbvSrvUavDescriptorSize);
+		const auto& mesh = scene->GetMesh(objectMeshes[objectIndex]);
+		stateFilter.SetGraphicsRootDescriptorTable(0,
+			CD3DX12_GPU_DESCRIPTOR_HANDLE(rootParameters, objectIndex, m_cbvSrvUavDescriptorSize));
 
-		commandList->IASetVertexBuffers(0, 1, &sceneObject.GetVertexBufferView());
-		commandList->IASetIndexBuffer(&sceneObject.GetIndexBufferView());
+		stateFilter.SetVertexBuffer(mesh.GetVertexBufferView());
+		stateFilter.SetIndexBuffer(mesh.GetIndexBufferView());
 
-		commandList->DrawIndexedInstanced(sceneObject.GetIndicesCount(), 1, 0, 0, 0);
+		commandList->DrawIndexedInstanced(mesh.GetIndicesCount(), 1, 0, 0, 0);
 	}
+	return stateFilter.GetSkippedCallsCount();
 }
 
 uint32_t GeometryPass::GetDescriptorTablesDescriptorsCount() const
 {
-	return m_scene->GetSceneObjectsCount();
+	return m_objectsCapacity;
 }
 
 uint32_t GeometryPass::GetRootResourcesSize() const
 {
-	return GeometryPassObjectConstantBuffer::GetAlignedSize() * m_scene->GetSceneObjectsCount();
+	return GeometryPassObjectConstantBuffer::GetAlignedSize() * m_objectsCapacity;
 }
 
 void GeometryPass::CreateRootSignature(ID3D12Device* device)
@@ -129,43 +139,25 @@ void GeometryPass::CreateRootSignature(ID3D12Device* device)
 		&error));
 	DxVerify(device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
 		IID_PPV_ARGS(&m_rootSignature)));
+	m_rootSignatureHash = PipelineStateCache::HashRootSignature(signature->GetBufferPointer(), signature->GetBufferSize());
 }
 
-void GeometryPass::CreatePipelineStateObject(ID3D12Device* device)
+void GeometryPass::CreatePipelineStateObjects(ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache,
+	GBufferMode gBufferMode)
 {
-	ComPtr<ID3DBlob> vertexShader;
-	ComPtr<ID3DBlob> pixelShader;
-
-#if defined(_DEBUG)
-	// Enable better shader debugging with the graphics debugging tools.
-	uint32_t compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION | D3DCOMPILE_PACK_MATRIX_COLUMN_MAJOR;
-#else
-	uint32_t compileFlags = D3DCOMPILE_PACK_MATRIX_COLUMN_MAJOR;
-#endif
-
-	DxVerify(D3DCompileFromFile(L"Shaders/Deferred/GeometryPass_vs.hlsl", nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-		"vs_main",
-		"vs_5_0",
-		compileFlags, 0, &vertexShader, nullptr));
-	DxVerify(D3DCompileFromFile(L"Shaders/Deferred/GeometryPass_ps.hlsl", nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-		"ps_main",
-		"ps_5_0",
-		compileFlags, 0, &pixelShader, nullptr));
-
-	D3D12_INPUT_ELEMENT_DESC inputElementDescs[] = {
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT,
-			D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT,
-			D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-	};
+	const uint32_t pixelShaderKey = gBufferMode == GBufferMode::Compact
+		? shaderCache.GetPermutationLayout("GeometryPass_ps").GetDefineKey("COMPACT_GBUFFER")
+		: 0;
+
+	const D3D12_SHADER_BYTECODE vertexShader = shaderCache.GetShader("GeometryPass_vs");
+	const D3D12_SHADER_BYTECODE pixelShader = shaderCache.GetShader("GeometryPass_ps", pixelShaderKey);
 
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
 
-	psoDesc.InputLayout = { inputElementDescs, _countof(inputElementDescs) };
+	psoDesc.InputLayout = { kInputElementDescs, _countof(kInputElementDescs) };
 	psoDesc.pRootSignature = m_rootSignature.Get();
-	psoDesc.VS = { static_cast<uint8_t*>(vertexShader->GetBufferPointer()), vertexShader->GetBufferSize() };
-	psoDesc.PS = { static_cast<uint8_t*>(pixelShader->GetBufferPointer()), pixelShader->GetBufferSize() };
+	psoDesc.VS = vertexShader;
+	psoDesc.PS = pixelShader;
 
 	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
 	psoDesc.RasterizerState.FrontCounterClockwise = true;
@@ -191,9 +183,14 @@ void GeometryPass::CreatePipelineStateObject(ID3D12Device* device)
 	psoDesc.SampleMask = UINT_MAX;
 	psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
 
-	psoDesc.NumRenderTargets = GBuffer::kRtCount;
-	memcpy(psoDesc.RTVFormats, GBuffer::kRtFormats, sizeof(DXGI_FORMAT) * GBuffer::kRtCount);
+	psoDesc.NumRenderTargets = GBuffer::GetRtCount(gBufferMode);
+	memcpy(psoDesc.RTVFormats, GBuffer::GetRtFormats(gBufferMode), sizeof(DXGI_FORMAT) * psoDesc.NumRenderTargets);
 	psoDesc.SampleDesc.Count = 1;
 
-	DxVerify(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_pipelineStateObject)));
+	m_pipelineStateObject = pipelineStateCache.CreateGraphicsPipelineStateAsync(psoDesc, m_rootSignatureHash);
+
+	// Every pixel is written once after the depth pre-pass, the stencil is still replaced where depth passes
+	psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_EQUAL;
+	psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+	m_depthEqualPipelineStateObject = pipelineStateCache.CreateGraphicsPipelineStateAsync(psoDesc, m_rootSignatureHash);
 }
@@ -1,39 +1,59 @@
 #pragma once
 
 #include <stdint.h>
+#include <vector>
 #include <d3d12.h>
 #include <d3dx12.h>
 #include <dxgi1_4.h>
 #include <wrl.h>
 
+#include "GBuffer.h"
+#include "PipelineStateCache.h"
+
 
 class Scene;
+class ShaderCache;
 
 class GeometryPass
 {
 public:
 	GeometryPass() = default;
-	explicit GeometryPass(ID3D12Device* device);
-	void Initialize(ID3D12Device* device);
+	explicit GeometryPass(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache,
+		GBufferMode gBufferMode);
+	// PSO is created asynchronously, the first Setup waits for it
+	void Initialize(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache,
+		GBufferMode gBufferMode);
 	~GeometryPass() = default;
 
 	void SetScene(Scene* scene);
+	// Object slots the constant buffers and descriptors are laid out for, past the slots count of the scene so
+	// added objects reuse them
+	void SetObjectsCapacity(uint32_t objectsCapacity) { m_objectsCapacity = objectsCapacity; }
+	[[nodiscard]] uint32_t GetObjectsCapacity() const { return m_objectsCapacity; }
 	void SetupRootResourceDescriptors(ID3D12Device* device, CD3DX12_CPU_DESCRIPTOR_HANDLE rootParameters,
 	                                  D3D12_GPU_VIRTUAL_ADDRESS dataAddress) const;
+	// Streams the constant buffers of every object, cbData is write only and 32 byte aligned
 	void UpdateRootResources(uint8_t* cbData, float appAspect) const;
-	void Setup(ID3D12GraphicsCommandList* commandList) const;
-	void Draw(ID3D12GraphicsCommandList* commandList, CD3DX12_GPU_DESCRIPTOR_HANDLE rootParameters, Scene* scene) const;
+	// With depthPrePass the depth is filled by DepthPrePass, the pass tests it EQUAL without writing
+	void Setup(ID3D12GraphicsCommandList* commandList, bool depthPrePass = false) const;
+	// order indexes the scene objects, returns the redundant state calls skipped
+	uint32_t Draw(ID3D12GraphicsCommandList* commandList, CD3DX12_GPU_DESCRIPTOR_HANDLE rootParameters, Scene* scene,
+		const std::vector<uint32_t>& order) const;
 
 	[[nodiscard]] uint32_t GetDescriptorTablesDescriptorsCount() const;
 	[[nodiscard]] uint32_t GetRootResourcesSize() const;
 
 private:
 	Microsoft::WRL::ComPtr<ID3D12RootSignature> m_rootSignature;
-	Microsoft::WRL::ComPtr<ID3D12PipelineState> m_pipelineStateObject;
+	uint64_t m_rootSignatureHash = 0;
+	PipelineStateFuture m_pipelineStateObject;
+	PipelineStateFuture m_depthEqualPipelineStateObject;
 	Scene* m_scene = nullptr;
+	uint32_t m_objectsCapacity = 0;
 
 	uint32_t m_cbvSrvUavDescriptorSize = 0;
 
 	void CreateRootSignature(ID3D12Device* device);
-	void CreatePipelineStateObject(ID3D12Device* device);
+	void CreatePipelineStateObjects(ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache,
+		GBufferMode gBufferMode);
 };
@@ -1,18 +1,10 @@
 #pragma once
 
-#include <DirectXMath.h>
+#include "SimdMath.h"
 
-using namespace DirectX;
+#include "Shaders/Shared/SceneObjectData.h"
 
-struct GeometryPassObjectConstantBuffer
-{
-	static uint32_t GetAlignedSize() { return (sizeof(GeometryPassObjectConstantBuffer) + 255) & ~255; }
+using namespace SimdMath;
 
-	XMFLOAT4X4 model;
-	XMFLOAT4X4 view;
-	XMFLOAT4X4 projection;
-
-	XMFLOAT4X4 mvp;
-
-	XMFLOAT4X4 vp;
-};
\ No newline at end of file
+// Layout is shared with the shaders, see Shaders/Shared/SceneObjectData.h
+using GeometryPassObjectConstantBuffer = ShaderInterop::SceneObjectData;
@@ -0,0 +1,194 @@
+#include "GpuHeapAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "DxHelpers.h"
+
+
+using namespace Microsoft::WRL;
+
+
+float GpuHeapCategoryStatistics::GetFragmentation() const
+{
+	const uint64_t freeSize = reservedSize - usedSize;
+	if (freeSize == 0)
+		return 0.0f;
+
+	return 1.0f - static_cast<float>(static_cast<double>(largestFreeBlockSize) / static_cast<double>(freeSize));
+}
+
+
+void GpuHeapAllocator::Initialize(ID3D12Device* device, const CategoryDesc (&categoryDescs)[kCategoriesCount])
+{
+	m_device = device;
+
+	for (uint32_t i = 0; i < kCategoriesCount; i++)
+		m_categories[i].desc = categoryDescs[i];
+}
+
+
+GpuAllocation GpuHeapAllocator::CreateResource(GpuHeapCategory category, const D3D12_RESOURCE_DESC& resourceDesc,
+	D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue, ComPtr<ID3D12Resource>& resource)
+{
+	auto& categoryData = m_categories[static_cast<uint32_t>(category)];
+	const auto allocationInfo = m_device->GetResourceAllocationInfo(0, 1, &resourceDesc);
+
+	GpuAllocation allocation;
+	allocation.category = category;
+
+	// Existing heaps first
+	for (uint32_t i = 0; i < categoryData.heaps.size() && !allocation.range.IsValid(); i++)
+	{
+		if (!categoryData.heaps[i].heap)
+			continue;
+
+		allocation.range = categoryData.heaps[i].allocator.Allocate(allocationInfo.SizeInBytes,
+			allocationInfo.Alignment);
+		allocation.heapIndex = i;
+	}
+
+	// New heap, resources bigger than the default heap size get a dedicated one
+	if (!allocation.range.IsValid())
+	{
+		const uint64_t heapSize = std::max(categoryData.desc.heapSize,
+			DxHelper::Align(allocationInfo.SizeInBytes, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT));
+
+		if (categoryData.reservedSize + heapSize <= categoryData.desc.budget)
+		{
+			allocation.heapIndex = CreateHeap(category, heapSize);
+			allocation.range = categoryData.heaps[allocation.heapIndex].allocator.Allocate(
+				allocationInfo.SizeInBytes, allocationInfo.Alignment);
+		}
+	}
+
+	if (!allocation.range.IsValid())
+	{
+		// Out of budget, don't fail, but make it visible in the statistics
+		allocation.heapIndex = GpuAllocation::kCommittedHeapIndex;
+		categoryData.committedFallbacksCount++;
+
+		const CD3DX12_HEAP_PROPERTIES heapProperties(GetHeapType(category));
+		DxVerify(m_device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc,
+			initialState, clearValue, IID_PPV_ARGS(&resource)));
+		return allocation;
+	}
+
+	DxVerify(m_device->CreatePlacedResource(categoryData.heaps[allocation.heapIndex].heap.Get(),
+		allocation.range.offset, &resourceDesc, initialState, clearValue, IID_PPV_ARGS(&resource)));
+
+	return allocation;
+}
+
+
+void GpuHeapAllocator::Free(GpuAllocation& allocation)
+{
+	if (!allocation.IsValid())
+		return;
+
+	auto& categoryData = m_categories[static_cast<uint32_t>(allocation.category)];
+
+	if (allocation.IsPlaced())
+	{
+		auto& heap = categoryData.heaps[allocation.heapIndex];
+		heap.allocator.Free(allocation.range.handle);
+
+		// Keep the first heap of a category around, release the rest as soon as they are empty
+		if (heap.allocator.IsEmpty() && allocation.heapIndex != 0)
+		{
+			categoryData.reservedSize -= heap.allocator.GetSize();
+			heap.heap.Reset();
+		}
+	}
+	else
+	{
+		categoryData.committedFallbacksCount--;
+	}
+
+	allocation = {};
+}
+
+
+void GpuHeapAllocator::FreeDeferred(DeferredReleaseQueue& releaseQueue, uint64_t fenceValue,
+	ComPtr<ID3D12Resource>& resource, GpuAllocation& allocation)
+{
+	releaseQueue.Enqueue(fenceValue, [this, resource = std::move(resource), allocation]() mutable {
+		resource.Reset();
+		Free(allocation);
+	});
+	allocation = {};
+}
+
+
+GpuHeapCategoryStatistics GpuHeapAllocator::GetStatistics(GpuHeapCategory category) const
+{
+	const auto& categoryData = m_categories[static_cast<uint32_t>(category)];
+
+	GpuHeapCategoryStatistics statistics;
+	statistics.reservedSize = categoryData.reservedSize;
+	statistics.committedFallbacksCount = categoryData.committedFallbacksCount;
+
+	for (const auto& heap : categoryData.heaps)
+	{
+		if (!heap.heap)
+			continue;
+
+		const auto heapStatistics = heap.allocator.GetStatistics();
+		statistics.heapsCount++;
+		statistics.usedSize += heapStatistics.usedSize;
+		statistics.allocationsCount += heapStatistics.allocationsCount;
+		statistics.freeBlocksCount += heapStatistics.freeBlocksCount;
+		statistics.largestFreeBlockSize = std::max(statistics.largestFreeBlockSize,
+			heapStatistics.largestFreeBlockSize);
+	}
+
+	return statistics;
+}
+
+
+D3D12_HEAP_TYPE GpuHeapAllocator::GetHeapType(GpuHeapCategory category)
+{
+	return category == GpuHeapCategory::Upload ? D3D12_HEAP_TYPE_UPLOAD : D3D12_HEAP_TYPE_DEFAULT;
+}
+
+
+D3D12_HEAP_FLAGS GpuHeapAllocator::GetHeapFlags(GpuHeapCategory category)
+{
+	switch (category)
+	{
+		case GpuHeapCategory::Buffers:
+		case GpuHeapCategory::Upload:
+			return D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+		case GpuHeapCategory::RenderTargets:
+			return D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+		case GpuHeapCategory::Textures:
+			return D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+		default:
+			assert(false);
+			return D3D12_HEAP_FLAG_NONE;
+	}
+}
+
+
+uint32_t GpuHeapAllocator::CreateHeap(GpuHeapCategory category, uint64_t size)
+{
+	auto& categoryData = m_categories[static_cast<uint32_t>(category)];
+
+	const CD3DX12_HEAP_DESC heapDesc(size, GetHeapType(category), D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+		GetHeapFlags(category));
+
+	// Reuse a released slot, so heap indices of the live allocations stay valid
+	uint32_t heapIndex = 0;
+	while (heapIndex < categoryData.heaps.size() && categoryData.heaps[heapIndex].heap)
+		heapIndex++;
+	if (heapIndex == categoryData.heaps.size())
+		categoryData.heaps.emplace_back();
+
+	auto& heap = categoryData.heaps[heapIndex];
+	DxVerify(m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap.heap)));
+	heap.allocator.Reset(size);
+
+	categoryData.reservedSize += size;
+
+	return heapIndex;
+}
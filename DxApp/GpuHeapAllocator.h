@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <d3d12.h>
+#include <d3dx12.h>
+#include <wrl.h>
+
+#include "DeferredReleaseQueue.h"
+#include "TlsfAllocator.h"
+
+
+enum class GpuHeapCategory : uint32_t
+{
+	Buffers,
+	RenderTargets,
+	Textures,
+	Upload,
+	Count
+};
+
+
+struct GpuAllocation
+{
+	static constexpr uint32_t kCommittedHeapIndex = UINT32_MAX;
+
+	GpuHeapCategory category = GpuHeapCategory::Count;
+	uint32_t heapIndex = kCommittedHeapIndex;
+	TlsfAllocator::Allocation range;
+
+	bool IsValid() const { return category != GpuHeapCategory::Count; }
+	bool IsPlaced() const { return heapIndex != kCommittedHeapIndex; }
+};
+
+
+struct GpuHeapCategoryStatistics
+{
+	uint32_t heapsCount = 0;
+	uint64_t reservedSize = 0;
+	uint64_t usedSize = 0;
+	uint32_t allocationsCount = 0;
+	uint32_t freeBlocksCount = 0;
+	uint64_t largestFreeBlockSize = 0;
+	// Resources that did not fit the budget and were created as committed ones
+	uint32_t committedFallbacksCount = 0;
+
+	float GetFragmentation() const;
+};
+
+
+// Places resources into a few large ID3D12Heaps instead of one committed allocation per resource.
+// Categories follow resource heap tier 1 rules, so buffers, rt/ds textures and other textures never share a heap.
+class GpuHeapAllocator
+{
+public:
+	static constexpr uint32_t kCategoriesCount = static_cast<uint32_t>(GpuHeapCategory::Count);
+	static constexpr uint64_t kDefaultHeapSize = 64 * 1024 * 1024;
+
+	struct CategoryDesc
+	{
+		uint64_t heapSize;
+		// Heaps of the category are never created past this size
+		uint64_t budget;
+	};
+
+	static constexpr CategoryDesc kDefaultCategoryDescs[kCategoriesCount] = {
+		{ kDefaultHeapSize, 512 * 1024 * 1024 },
+		{ kDefaultHeapSize, 256 * 1024 * 1024 },
+		{ kDefaultHeapSize, 512 * 1024 * 1024 },
+		{ kDefaultHeapSize, 256 * 1024 * 1024 }
+	};
+
+	GpuHeapAllocator() = default;
+
+	void Initialize(ID3D12Device* device, const CategoryDesc (&categoryDescs)[kCategoriesCount] = kDefaultCategoryDescs);
+
+	GpuAllocation CreateResource(GpuHeapCategory category, const D3D12_RESOURCE_DESC& resourceDesc,
+		D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue,
+		Microsoft::WRL::ComPtr<ID3D12Resource>& resource);
+	// Resource has to be released and unused by the GPU before its range is freed
+	void Free(GpuAllocation& allocation);
+	// Releases the resource and frees its range once the GPU passes fenceValue
+	void FreeDeferred(DeferredReleaseQueue& releaseQueue, uint64_t fenceValue,
+		Microsoft::WRL::ComPtr<ID3D12Resource>& resource, GpuAllocation& allocation);
+
+	[[nodiscard]] GpuHeapCategoryStatistics GetStatistics(GpuHeapCategory category) const;
+
+private:
+	struct Heap
+	{
+		Microsoft::WRL::ComPtr<ID3D12Heap> heap;
+		TlsfAllocator allocator;
+	};
+
+	struct Category
+	{
+		std::vector<Heap> heaps;
+		CategoryDesc desc;
+		uint64_t reservedSize = 0;
+		uint32_t committedFallbacksCount = 0;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+	Category m_categories[kCategoriesCount];
+
+	static D3D12_HEAP_TYPE GetHeapType(GpuHeapCategory category);
+	static D3D12_HEAP_FLAGS GetHeapFlags(GpuHeapCategory category);
+
+	uint32_t CreateHeap(GpuHeapCategory category, uint64_t size);
+};
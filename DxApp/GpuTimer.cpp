@@ -0,0 +1,59 @@
+#include "GpuTimer.h"
+
+#include "DxHelpers.h"
+
+using namespace Microsoft::WRL;
+
+
+void GpuTimer::Initialize(ID3D12Device* device, ID3D12CommandQueue* commandQueue, uint32_t framesCount)
+{
+	D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+	queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	queryHeapDesc.Count = 2 * framesCount;
+	DxVerify(device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_queryHeap)));
+
+	// A few bytes, GpuHeapAllocator has no readback category
+	const CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_READBACK);
+	const auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(queryHeapDesc.Count * sizeof(uint64_t));
+	DxVerify(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m_readbackBuffer)));
+	m_readbackBuffer->SetName(L"GpuTimer::ReadbackBuffer");
+
+	// Readback buffers may stay mapped, the CPU only reads the frames the GPU completed
+	DxVerify(m_readbackBuffer->Map(0, nullptr, reinterpret_cast<void**>(&m_timestamps)));
+
+	DxVerify(commandQueue->GetTimestampFrequency(&m_frequency));
+	m_resolved.assign(framesCount, false);
+}
+
+
+GpuTimer::~GpuTimer()
+{
+	if (m_readbackBuffer)
+		m_readbackBuffer->Unmap(0, nullptr);
+}
+
+
+void GpuTimer::Begin(ID3D12GraphicsCommandList* commandList, uint32_t frameIndex)
+{
+	commandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 2 * frameIndex);
+}
+
+
+void GpuTimer::End(ID3D12GraphicsCommandList* commandList, uint32_t frameIndex)
+{
+	commandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 2 * frameIndex + 1);
+	commandList->ResolveQueryData(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 2 * frameIndex, 2,
+		m_readbackBuffer.Get(), 2 * frameIndex * sizeof(uint64_t));
+	m_resolved[frameIndex] = true;
+}
+
+
+double GpuTimer::GetMilliseconds(uint32_t frameIndex) const
+{
+	if (!m_resolved[frameIndex] || m_frequency == 0)
+		return -1.0;
+
+	const uint64_t ticks = m_timestamps[2 * frameIndex + 1] - m_timestamps[2 * frameIndex];
+	return 1000.0 * static_cast<double>(ticks) / static_cast<double>(m_frequency);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <d3d12.h>
+#include <d3dx12.h>
+#include <wrl.h>
+
+
+// Measures the GPU time between Begin and End with timestamp queries, one pair per frame in flight.
+// A frame's time is readable once the GPU completed it, i.e. when its frame index is recorded again.
+class GpuTimer
+{
+public:
+	GpuTimer() = default;
+	// Timestamps are converted with the frequency of the queue the command lists are executed on
+	void Initialize(ID3D12Device* device, ID3D12CommandQueue* commandQueue, uint32_t framesCount);
+	~GpuTimer();
+
+	void Begin(ID3D12GraphicsCommandList* commandList, uint32_t frameIndex);
+	// Resolves the pair into the readback buffer
+	void End(ID3D12GraphicsCommandList* commandList, uint32_t frameIndex);
+
+	// Milliseconds between Begin and End of the last completed frame with this index, negative before the first one
+	[[nodiscard]] double GetMilliseconds(uint32_t frameIndex) const;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12QueryHeap> m_queryHeap;
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_readbackBuffer;
+	uint64_t* m_timestamps = nullptr;
+	uint64_t m_frequency = 0;
+	std::vector<bool> m_resolved;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+
+namespace Hash
+{
+	static constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+	static constexpr uint64_t kFnvPrime = 1099511628211ull;
+
+	// 64-bit FNV-1a, Shaders/CompileShaders.py uses the same function, keep them in sync
+	inline uint64_t Fnv1a64(const void* data, size_t size, uint64_t hash)
+	{
+		const auto* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= kFnvPrime;
+		}
+		return hash;
+	}
+
+	inline uint64_t Fnv1a64(std::string_view string, uint64_t hash = kFnvOffsetBasis)
+	{
+		return Fnv1a64(string.data(), string.size(), hash);
+	}
+} // namespace Hash
@@ -0,0 +1,410 @@
+#include "IndirectGeometryPass.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+#include "RendererForwards.h"
+#include "DeferredReleaseQueue.h"
+#include "DxHelpers.h"
+#include "Scene.h"
+#include "ShaderCache.h"
+#include "UploadService.h"
+
+using namespace SimdMath;
+using namespace Microsoft::WRL;
+
+namespace
+{
+	// CullingConstants of InstanceCulling_cs.hlsl
+	struct CullingConstants
+	{
+		Float4 frustumPlanes[6];
+		uint32_t objectDataAddress[2];
+		uint32_t instancesCount;
+	};
+
+	// Referenced by the PSO desc until the asynchronous PSO creation is done
+	const D3D12_INPUT_ELEMENT_DESC kInputElementDescs[] = {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT,
+			D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT,
+			D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+	};
+
+	using InstanceCulling::IndirectCommand;
+	static_assert(offsetof(IndirectCommand, vertexBufferLocation) == sizeof(D3D12_GPU_VIRTUAL_ADDRESS));
+	static_assert(offsetof(IndirectCommand, indexBufferLocation)
+		== offsetof(IndirectCommand, vertexBufferLocation) + sizeof(D3D12_VERTEX_BUFFER_VIEW));
+	static_assert(offsetof(IndirectCommand, indexCountPerInstance)
+		== offsetof(IndirectCommand, indexBufferLocation) + sizeof(D3D12_INDEX_BUFFER_VIEW));
+	static_assert(offsetof(IndirectCommand, padding)
+		== offsetof(IndirectCommand, indexCountPerInstance) + sizeof(D3D12_DRAW_INDEXED_ARGUMENTS));
+
+	// Dead slots draw nothing whether culled or not
+	InstanceCulling::Instance CreateSlotInstance(const Scene& scene, uint32_t slot, uint32_t objectDataOffset)
+	{
+		IndirectCommand command;
+		const auto& bounds = scene.GetObjectBounds()[slot];
+		if (scene.IsObjectDrawn(slot))
+		{
+			const auto& mesh = scene.GetMesh(scene.GetObjectMeshes()[slot]);
+			const auto& vertexBufferView = mesh.GetVertexBufferView();
+			const auto& indexBufferView = mesh.GetIndexBufferView();
+
+			command.vertexBufferLocation = vertexBufferView.BufferLocation;
+			command.vertexBufferSize = vertexBufferView.SizeInBytes;
+			command.vertexBufferStride = vertexBufferView.StrideInBytes;
+			command.indexBufferLocation = indexBufferView.BufferLocation;
+			command.indexBufferSize = indexBufferView.SizeInBytes;
+			command.indexBufferFormat = indexBufferView.Format;
+			command.indexCountPerInstance = mesh.GetIndicesCount();
+			command.instanceCount = 1;
+		}
+
+		return InstanceCulling::CreateInstance(bounds.minCorner, bounds.maxCorner, scene.GetTransforms().Get(slot),
+			objectDataOffset, command);
+	}
+}
+
+IndirectGeometryPass::IndirectGeometryPass(ID3D12Device* device, ShaderCache& shaderCache,
+	PipelineStateCache& pipelineStateCache, GBufferMode gBufferMode)
+{
+	Initialize(device, shaderCache, pipelineStateCache, gBufferMode);
+}
+
+void IndirectGeometryPass::Initialize(ID3D12Device* device, ShaderCache& shaderCache,
+	PipelineStateCache& pipelineStateCache, GBufferMode gBufferMode)
+{
+	CreateRootSignatures(device);
+	CreateCommandSignature(device);
+	CreatePipelineStateObjects(shaderCache, pipelineStateCache, gBufferMode);
+
+	// Source of the count reset, the groups of Cull append to it
+	const CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_UPLOAD);
+	const auto countResetDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(uint32_t));
+	DxVerify(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &countResetDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_countResetBuffer)));
+	m_countResetBuffer->SetName(L"IndirectGeometryPass::CountReset");
+	uint32_t* count = nullptr;
+	const auto readRange = CD3DX12_RANGE(0, 0);
+	DxVerify(m_countResetBuffer->Map(0, &readRange, reinterpret_cast<void**>(&count)));
+	*count = 0;
+	m_countResetBuffer->Unmap(0, nullptr);
+}
+
+uint64_t IndirectGeometryPass::CreateSceneResources(ID3D12Device* device, GpuHeapAllocator& heapAllocator,
+	UploadService& uploadService, Scene* scene, uint32_t objectDataStride, uint32_t instancesCapacity,
+	uint32_t framesCount)
+{
+	assert(scene->GetObjectSlotsCount() <= instancesCapacity);
+	m_instancesCapacity = instancesCapacity;
+	m_objectDataStride = objectDataStride;
+
+	// One per slot, like the object constant buffers
+	m_instances.resize(scene->GetObjectSlotsCount());
+	for (uint32_t i = 0; i < m_instances.size(); i++)
+		m_instances[i] = CreateSlotInstance(*scene, i, i * objectDataStride);
+
+	// An empty scene still gets valid buffers
+	const uint64_t instancesSize = std::max(m_instancesCapacity, 1u) * sizeof(InstanceCulling::Instance);
+	m_instancesBuffers.resize(framesCount);
+	for (auto& instancesBuffer : m_instancesBuffers)
+	{
+		instancesBuffer.allocation = heapAllocator.CreateResource(GpuHeapCategory::Buffers,
+			CD3DX12_RESOURCE_DESC::Buffer(instancesSize), D3D12_RESOURCE_STATE_COMMON, nullptr,
+			instancesBuffer.resource);
+		instancesBuffer.resource->SetName(L"IndirectGeometryPass::Instances");
+		instancesBuffer.staleSlots.clear();
+		uploadService.UploadBuffer(instancesBuffer.resource.Get(), 0, m_instances.data(),
+			m_instances.size() * sizeof(InstanceCulling::Instance));
+	}
+
+	const uint64_t argumentsSize = GetCountOffset() + sizeof(uint32_t);
+	m_argumentsAllocation = heapAllocator.CreateResource(GpuHeapCategory::Buffers,
+		CD3DX12_RESOURCE_DESC::Buffer(argumentsSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+		D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, nullptr, m_argumentsBuffer);
+	m_argumentsBuffer->SetName(L"IndirectGeometryPass::Arguments");
+
+	// Debug copy of the arguments, GpuHeapAllocator has no readback category
+	const CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_READBACK);
+	const auto readbackDesc = CD3DX12_RESOURCE_DESC::Buffer(argumentsSize);
+	DxVerify(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &readbackDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m_readbackBuffer)));
+	m_readbackBuffer->SetName(L"IndirectGeometryPass::Readback");
+
+	return uploadService.Flush();
+}
+
+void IndirectGeometryPass::DestroySceneResources(GpuHeapAllocator& heapAllocator)
+{
+	for (auto& instancesBuffer : m_instancesBuffers)
+	{
+		instancesBuffer.resource.Reset();
+		heapAllocator.Free(instancesBuffer.allocation);
+	}
+	m_instancesBuffers.clear();
+	m_argumentsBuffer.Reset();
+	heapAllocator.Free(m_argumentsAllocation);
+	m_readbackBuffer.Reset();
+	m_instances.clear();
+}
+
+void IndirectGeometryPass::ReleaseSceneResources(GpuHeapAllocator& heapAllocator, DeferredReleaseQueue& releaseQueue,
+	uint64_t fenceValue)
+{
+	for (auto& instancesBuffer : m_instancesBuffers)
+		heapAllocator.FreeDeferred(releaseQueue, fenceValue, instancesBuffer.resource, instancesBuffer.allocation);
+	m_instancesBuffers.clear();
+	heapAllocator.FreeDeferred(releaseQueue, fenceValue, m_argumentsBuffer, m_argumentsAllocation);
+	releaseQueue.Enqueue(fenceValue, [readbackBuffer = std::move(m_readbackBuffer)]() mutable {
+		readbackBuffer.Reset();
+	});
+	m_instances.clear();
+}
+
+bool IndirectGeometryPass::UpdateInstances(UploadService& uploadService, Scene* scene,
+	const std::vector<uint32_t>& changedObjects, uint32_t frameIndex)
+{
+	assert(scene->GetObjectSlotsCount() <= m_instancesCapacity);
+	m_instances.resize(scene->GetObjectSlotsCount());
+	for (const uint32_t slot : changedObjects)
+		m_instances[slot] = CreateSlotInstance(*scene, slot, slot * m_objectDataStride);
+	for (auto& instancesBuffer : m_instancesBuffers)
+		instancesBuffer.staleSlots.insert(instancesBuffer.staleSlots.end(), changedObjects.begin(), changedObjects.end());
+
+	// The slots changed by the frames since the last use of the buffer
+	auto& instancesBuffer = m_instancesBuffers[frameIndex];
+	auto& slots = instancesBuffer.staleSlots;
+	if (slots.empty())
+		return false;
+	std::sort(slots.begin(), slots.end());
+	slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+	for (uint32_t i = 0; i < slots.size();)
+	{
+		// One copy per run of consecutive objects, the objects of a subtree are
+		uint32_t runEnd = i + 1;
+		while (runEnd < slots.size() && slots[runEnd] == slots[runEnd - 1] + 1)
+			runEnd++;
+		uploadService.UploadBuffer(instancesBuffer.resource.Get(), slots[i] * sizeof(InstanceCulling::Instance),
+			&m_instances[slots[i]], (runEnd - i) * sizeof(InstanceCulling::Instance));
+		i = runEnd;
+	}
+	slots.clear();
+	return true;
+}
+
+void IndirectGeometryPass::Cull(ID3D12GraphicsCommandList* commandList, const InstanceCulling::Frustum& frustum,
+	D3D12_GPU_VIRTUAL_ADDRESS objectDataAddress, uint32_t frameIndex)
+{
+	m_frustum = frustum;
+	m_objectDataAddress = objectDataAddress;
+
+	const auto toCopyDest = CD3DX12_RESOURCE_BARRIER::Transition(m_argumentsBuffer.Get(),
+		D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_COPY_DEST);
+	commandList->ResourceBarrier(1, &toCopyDest);
+	commandList->CopyBufferRegion(m_argumentsBuffer.Get(), GetCountOffset(), m_countResetBuffer.Get(), 0,
+		sizeof(uint32_t));
+
+	const auto toUnorderedAccess = CD3DX12_RESOURCE_BARRIER::Transition(m_argumentsBuffer.Get(),
+		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	commandList->ResourceBarrier(1, &toUnorderedAccess);
+
+	commandList->SetPipelineState(m_cullingPipelineStateObject.get().Get());
+	commandList->SetComputeRootSignature(m_cullingRootSignature.Get());
+
+	CullingConstants constants = {};
+	std::copy(std::begin(frustum.planes), std::end(frustum.planes), constants.frustumPlanes);
+	constants.objectDataAddress[0] = static_cast<uint32_t>(objectDataAddress);
+	constants.objectDataAddress[1] = static_cast<uint32_t>(objectDataAddress >> 32);
+	constants.instancesCount = static_cast<uint32_t>(m_instances.size());
+	commandList->SetComputeRoot32BitConstants(0, sizeof(CullingConstants) / sizeof(uint32_t), &constants, 0);
+	commandList->SetComputeRootShaderResourceView(1, m_instancesBuffers[frameIndex].resource->GetGPUVirtualAddress());
+	commandList->SetComputeRootUnorderedAccessView(2, m_argumentsBuffer->GetGPUVirtualAddress());
+	commandList->SetComputeRootUnorderedAccessView(3, m_argumentsBuffer->GetGPUVirtualAddress() + GetCountOffset());
+
+	// One thread per instance, the groups append in any order, see InstanceCulling_cs.hlsl
+	const uint32_t groupsCount = (constants.instancesCount + InstanceCulling::kGroupSize - 1)
+		/ InstanceCulling::kGroupSize;
+	if (groupsCount > 0)
+		commandList->Dispatch(groupsCount, 1, 1);
+
+	const auto toIndirectArgument = CD3DX12_RESOURCE_BARRIER::Transition(m_argumentsBuffer.Get(),
+		D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+	commandList->ResourceBarrier(1, &toIndirectArgument);
+}
+
+void IndirectGeometryPass::Draw(ID3D12GraphicsCommandList* commandList) const
+{
+	commandList->SetPipelineState(m_pipelineStateObject.get().Get());
+	commandList->SetGraphicsRootSignature(m_rootSignature.Get());
+	commandList->OMSetStencilRef(kGeometryStencilRef);
+	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	commandList->ExecuteIndirect(m_commandSignature.Get(), static_cast<uint32_t>(m_instances.size()),
+		m_argumentsBuffer.Get(), 0, m_argumentsBuffer.Get(), GetCountOffset());
+}
+
+void IndirectGeometryPass::CopyArgumentsForValidation(ID3D12GraphicsCommandList* commandList)
+{
+	m_copiedFrustum = m_frustum;
+	m_copiedObjectDataAddress = m_objectDataAddress;
+
+	const auto toCopySource = CD3DX12_RESOURCE_BARRIER::Transition(m_argumentsBuffer.Get(),
+		D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_COPY_SOURCE);
+	commandList->ResourceBarrier(1, &toCopySource);
+
+	commandList->CopyResource(m_readbackBuffer.Get(), m_argumentsBuffer.Get());
+
+	const auto toIndirectArgument = CD3DX12_RESOURCE_BARRIER::Transition(m_argumentsBuffer.Get(),
+		D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+	commandList->ResourceBarrier(1, &toIndirectArgument);
+}
+
+uint32_t IndirectGeometryPass::ValidateArguments() const
+{
+	std::vector<IndirectCommand> referenceCommands;
+	const uint32_t referenceCount = InstanceCulling::Cull(m_instances, m_copiedFrustum, m_copiedObjectDataAddress,
+		referenceCommands);
+
+	uint8_t* data = nullptr;
+	const auto readRange = CD3DX12_RANGE(0, GetCountOffset() + sizeof(uint32_t));
+	DxVerify(m_readbackBuffer->Map(0, &readRange, reinterpret_cast<void**>(&data)));
+
+	const auto* commandsData = reinterpret_cast<const IndirectCommand*>(data);
+	// A broken count must not read past the commands
+	const uint32_t count = std::min(*reinterpret_cast<const uint32_t*>(data + GetCountOffset()),
+		std::max(m_instancesCapacity, 1u));
+	std::vector<IndirectCommand> commands(commandsData, commandsData + count);
+
+	const auto writtenRange = CD3DX12_RANGE(0, 0);
+	m_readbackBuffer->Unmap(0, &writtenRange);
+
+	// The groups of the shader append in any order
+	referenceCommands.resize(referenceCount);
+	return InstanceCulling::CountMismatches(commands, referenceCommands);
+}
+
+uint64_t IndirectGeometryPass::GetCountOffset() const
+{
+	// The culled commands of every slot the buffers fit
+	return std::max(m_instancesCapacity, 1u) * sizeof(IndirectCommand);
+}
+
+void IndirectGeometryPass::CreateRootSignatures(ID3D12Device* device)
+{
+	// Object constant buffer of the draw, changed by the command signature
+	D3D12_ROOT_PARAMETER rootParameters[1] = {};
+	rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+	rootParameters[0].Descriptor = { 0, 0 };
+	rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+
+	CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
+	rootSignatureDesc.Init(_countof(rootParameters), rootParameters, 0, nullptr,
+		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+	ComPtr<ID3DBlob> signature;
+	ComPtr<ID3DBlob> error;
+
+	DxVerify(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature,
+		&error));
+	DxVerify(device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
+		IID_PPV_ARGS(&m_rootSignature)));
+	m_rootSignatureHash = PipelineStateCache::HashRootSignature(signature->GetBufferPointer(), signature->GetBufferSize());
+
+	// Constants, instances, commands, commands count. Root views need no descriptor heap.
+	D3D12_ROOT_PARAMETER cullingRootParameters[4] = {};
+	cullingRootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	cullingRootParameters[0].Constants = { 0, 0, sizeof(CullingConstants) / sizeof(uint32_t) };
+	cullingRootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+	cullingRootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	cullingRootParameters[1].Descriptor = { 0, 0 };
+	cullingRootParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+	cullingRootParameters[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+	cullingRootParameters[2].Descriptor = { 0, 0 };
+	cullingRootParameters[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+	cullingRootParameters[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+	cullingRootParameters[3].Descriptor = { 1, 0 };
+	cullingRootParameters[3].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	CD3DX12_ROOT_SIGNATURE_DESC cullingRootSignatureDesc;
+	cullingRootSignatureDesc.Init(_countof(cullingRootParameters), cullingRootParameters, 0, nullptr,
+		D3D12_ROOT_SIGNATURE_FLAG_NONE);
+
+	DxVerify(D3D12SerializeRootSignature(&cullingRootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature,
+		&error));
+	DxVerify(device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
+		IID_PPV_ARGS(&m_cullingRootSignature)));
+	m_cullingRootSignatureHash = PipelineStateCache::HashRootSignature(signature->GetBufferPointer(),
+		signature->GetBufferSize());
+}
+
+void IndirectGeometryPass::CreateCommandSignature(ID3D12Device* device)
+{
+	D3D12_INDIRECT_ARGUMENT_DESC argumentDescs[4] = {};
+	argumentDescs[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT_BUFFER_VIEW;
+	argumentDescs[0].ConstantBufferView.RootParameterIndex = 0;
+	argumentDescs[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_VERTEX_BUFFER_VIEW;
+	argumentDescs[1].VertexBuffer.Slot = 0;
+	argumentDescs[2].Type = D3D12_INDIRECT_ARGUMENT_TYPE_INDEX_BUFFER_VIEW;
+	argumentDescs[3].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+	D3D12_COMMAND_SIGNATURE_DESC commandSignatureDesc = {};
+	commandSignatureDesc.ByteStride = sizeof(IndirectCommand);
+	commandSignatureDesc.NumArgumentDescs = _countof(argumentDescs);
+	commandSignatureDesc.pArgumentDescs = argumentDescs;
+
+	// The root signature is needed as the commands change a root argument
+	DxVerify(device->CreateCommandSignature(&commandSignatureDesc, m_rootSignature.Get(),
+		IID_PPV_ARGS(&m_commandSignature)));
+}
+
+void IndirectGeometryPass::CreatePipelineStateObjects(ShaderCache& shaderCache,
+	PipelineStateCache& pipelineStateCache, GBufferMode gBufferMode)
+{
+	const uint32_t pixelShaderKey = gBufferMode == GBufferMode::Compact
+		? shaderCache.GetPermutationLayout("GeometryPass_ps").GetDefineKey("COMPACT_GBUFFER")
+		: 0;
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+
+	// Same state as GeometryPass
+	psoDesc.InputLayout = { kInputElementDescs, _countof(kInputElementDescs) };
+	psoDesc.pRootSignature = m_rootSignature.Get();
+	psoDesc.VS = shaderCache.GetShader("GeometryPass_vs");
+	psoDesc.PS = shaderCache.GetShader("GeometryPass_ps", pixelShaderKey);
+
+	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+	psoDesc.RasterizerState.FrontCounterClockwise = true;
+	psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+
+	psoDesc.DepthStencilState.DepthEnable = true;
+	psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+	psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+	psoDesc.DepthStencilState.StencilEnable = true;
+	psoDesc.DepthStencilState.StencilReadMask = 0xff;
+	psoDesc.DepthStencilState.StencilWriteMask = 0xff;
+	psoDesc.DepthStencilState.FrontFace.StencilFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+	psoDesc.DepthStencilState.FrontFace.StencilPassOp = D3D12_STENCIL_OP_REPLACE;
+	psoDesc.DepthStencilState.FrontFace.StencilFailOp = D3D12_STENCIL_OP_REPLACE;
+	psoDesc.DepthStencilState.FrontFace.StencilDepthFailOp = D3D12_STENCIL_OP_KEEP;
+	psoDesc.DepthStencilState.BackFace = psoDesc.DepthStencilState.FrontFace;
+
+	psoDesc.DSVFormat = kDsFormat;
+	psoDesc.SampleMask = UINT_MAX;
+	psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+
+	psoDesc.NumRenderTargets = GBuffer::GetRtCount(gBufferMode);
+	memcpy(psoDesc.RTVFormats, GBuffer::GetRtFormats(gBufferMode), sizeof(DXGI_FORMAT) * psoDesc.NumRenderTargets);
+	psoDesc.SampleDesc.Count = 1;
+
+	m_pipelineStateObject = pipelineStateCache.CreateGraphicsPipelineStateAsync(psoDesc, m_rootSignatureHash);
+
+	D3D12_COMPUTE_PIPELINE_STATE_DESC cullingPsoDesc = {};
+	cullingPsoDesc.pRootSignature = m_cullingRootSignature.Get();
+	cullingPsoDesc.CS = shaderCache.GetShader("InstanceCulling_cs");
+	m_cullingPipelineStateObject = pipelineStateCache.CreateComputePipelineStateAsync(cullingPsoDesc,
+		m_cullingRootSignatureHash);
+}
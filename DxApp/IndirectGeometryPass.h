@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <d3d12.h>
+#include <d3dx12.h>
+#include <wrl.h>
+
+#include "GBuffer.h"
+#include "GpuHeapAllocator.h"
+#include "InstanceCulling.h"
+#include "PipelineStateCache.h"
+
+
+class DeferredReleaseQueue;
+class Scene;
+class ShaderCache;
+class UploadService;
+
+// GPU driven GBuffer fill: the scene instances are uploaded once, InstanceCulling_cs.hlsl culls them into
+// an indirect argument buffer and one ExecuteIndirect draws the visible ones, whatever the objects count.
+// Same shaders and output as GeometryPass, the object constant buffers are bound as root views.
+class IndirectGeometryPass
+{
+public:
+	IndirectGeometryPass() = default;
+	explicit IndirectGeometryPass(ID3D12Device* device, ShaderCache& shaderCache,
+		PipelineStateCache& pipelineStateCache, GBufferMode gBufferMode);
+	// PSOs are created asynchronously, the first Cull and Draw wait for them
+	void Initialize(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache,
+		GBufferMode gBufferMode);
+	~IndirectGeometryPass() = default;
+
+	// Instances of the scene object slots, objectDataStride apart in the object constant buffers. The buffers fit
+	// instancesCapacity slots, one instances buffer per frame in flight. Returns the copy fence value of the upload.
+	uint64_t CreateSceneResources(ID3D12Device* device, GpuHeapAllocator& heapAllocator, UploadService& uploadService,
+		Scene* scene, uint32_t objectDataStride, uint32_t instancesCapacity, uint32_t framesCount);
+	void DestroySceneResources(GpuHeapAllocator& heapAllocator);
+	// Resources may be still in use until fenceValue
+	void ReleaseSceneResources(GpuHeapAllocator& heapAllocator, DeferredReleaseQueue& releaseQueue,
+		uint64_t fenceValue);
+	// Recomputes the instances of the changed slots, the added slots included, and records the upload of the slots
+	// the buffer of frameIndex misses. The last frame reading that buffer has to be completed. Returns false when
+	// the buffer was up to date and nothing was recorded.
+	bool UpdateInstances(UploadService& uploadService, Scene* scene, const std::vector<uint32_t>& changedObjects,
+		uint32_t frameIndex);
+
+	// objectDataAddress is the first object constant buffer of the frame
+	void Cull(ID3D12GraphicsCommandList* commandList, const InstanceCulling::Frustum& frustum,
+		D3D12_GPU_VIRTUAL_ADDRESS objectDataAddress, uint32_t frameIndex);
+	// GBuffer targets and a writable depth stencil view have to be bound
+	void Draw(ID3D12GraphicsCommandList* commandList) const;
+
+	// Copies the arguments of the last Cull to the readback buffer
+	void CopyArgumentsForValidation(ID3D12GraphicsCommandList* commandList);
+	// Commands of the copied arguments and of the CPU reference of the same Cull without an equal one in the other,
+	// compared as sorted lists. The copy has to be completed.
+	[[nodiscard]] uint32_t ValidateArguments() const;
+
+	[[nodiscard]] const std::vector<InstanceCulling::Instance>& GetInstances() const { return m_instances; }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12RootSignature> m_rootSignature;
+	uint64_t m_rootSignatureHash = 0;
+	Microsoft::WRL::ComPtr<ID3D12RootSignature> m_cullingRootSignature;
+	uint64_t m_cullingRootSignatureHash = 0;
+	Microsoft::WRL::ComPtr<ID3D12CommandSignature> m_commandSignature;
+	PipelineStateFuture m_pipelineStateObject;
+	PipelineStateFuture m_cullingPipelineStateObject;
+
+	std::vector<InstanceCulling::Instance> m_instances;
+	uint32_t m_instancesCapacity = 0;
+	uint32_t m_objectDataStride = 0;
+	struct InstancesBuffer
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+		GpuAllocation allocation;
+		// Slots the buffer still misses, uploaded once the GPU is done with its frame
+		std::vector<uint32_t> staleSlots;
+	};
+	std::vector<InstancesBuffer> m_instancesBuffers;
+	// Commands, then their count. In the indirect argument state out of Cull.
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_argumentsBuffer;
+	GpuAllocation m_argumentsAllocation;
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_readbackBuffer;
+	// Zero copied to the count before each Cull
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_countResetBuffer;
+
+	// Inputs of the last Cull, for the CPU reference
+	InstanceCulling::Frustum m_frustum = {};
+	D3D12_GPU_VIRTUAL_ADDRESS m_objectDataAddress = 0;
+	// Inputs of the copied arguments, later Culls change the ones above
+	InstanceCulling::Frustum m_copiedFrustum = {};
+	D3D12_GPU_VIRTUAL_ADDRESS m_copiedObjectDataAddress = 0;
+
+	void CreateRootSignatures(ID3D12Device* device);
+	void CreateCommandSignature(ID3D12Device* device);
+	void CreatePipelineStateObjects(ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache,
+		GBufferMode gBufferMode);
+	[[nodiscard]] uint64_t GetCountOffset() const;
+};
@@ -0,0 +1,97 @@
+#include "InstanceCulling.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+using namespace SimdMath;
+
+
+namespace InstanceCulling
+{
+	Frustum ExtractFrustum(const Float4x4& viewProjection)
+	{
+		Frustum frustum;
+		ExtractFrustumPlanes(viewProjection, frustum.planes);
+		return frustum;
+	}
+
+
+	Instance CreateInstance(const Float3& boundsMin, const Float3& boundsMax, const Float4x4& model,
+		uint32_t objectDataOffset, const IndirectCommand& command)
+	{
+		Vector center;
+		Vector extents;
+		AabbTransform({ boundsMin, boundsMax }, LoadFloat4x4(model), center, extents);
+
+		Instance instance;
+		StoreFloat3(instance.center, center);
+		StoreFloat3(instance.extents, extents);
+		instance.objectDataOffset = objectDataOffset;
+		instance.command = command;
+		return instance;
+	}
+
+
+	bool IsVisible(const Instance& instance, const Frustum& frustum)
+	{
+		const Float3& c = instance.center;
+		const Float3& e = instance.extents;
+		for (const Float4& plane : frustum.planes)
+		{
+			// Same operation order as the shader
+			const float distance = plane.x * c.x + plane.y * c.y + plane.z * c.z + plane.w;
+			const float radius = std::abs(plane.x) * e.x + std::abs(plane.y) * e.y + std::abs(plane.z) * e.z;
+			if (distance + radius < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+
+	uint32_t Cull(const std::vector<Instance>& instances, const Frustum& frustum, uint64_t objectDataAddress,
+		std::vector<IndirectCommand>& commands)
+	{
+		commands.resize(instances.size());
+		uint32_t count = 0;
+		for (const Instance& instance : instances)
+		{
+			if (!IsVisible(instance, frustum))
+				continue;
+
+			commands[count] = instance.command;
+			commands[count].objectDataAddress = objectDataAddress + instance.objectDataOffset;
+			count++;
+		}
+		return count;
+	}
+
+
+	uint32_t CountMismatches(std::vector<IndirectCommand>& commands, std::vector<IndirectCommand>& referenceCommands)
+	{
+		std::sort(commands.begin(), commands.end());
+		std::sort(referenceCommands.begin(), referenceCommands.end());
+
+		// Merge of the sorted lists, every command without an equal one in the other list counts
+		uint32_t mismatchesCount = 0;
+		size_t i = 0;
+		size_t j = 0;
+		while (i < commands.size() && j < referenceCommands.size())
+		{
+			if (commands[i] == referenceCommands[j])
+			{
+				i++;
+				j++;
+			}
+			else
+			{
+				mismatchesCount++;
+				if (commands[i] < referenceCommands[j])
+					i++;
+				else
+					j++;
+			}
+		}
+		return mismatchesCount + static_cast<uint32_t>(commands.size() - i + referenceCommands.size() - j);
+	}
+} // namespace InstanceCulling
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <compare>
+#include <vector>
+#include "SimdMath.h"
+
+
+// CPU reference of the GPU driven geometry instance culling, Shaders/Deferred/InstanceCulling_cs.hlsl has to
+// stay in sync. The reference compacts the visible instances in the instance order, the shader group by group in
+// the order the groups finish: both write the same commands, CountMismatches compares them as sorted lists.
+namespace InstanceCulling
+{
+	// Indirect arguments of one draw, the layout of the IndirectGeometryPass command signature:
+	// root constant buffer view, vertex buffer view, index buffer view and indexed draw arguments
+	struct IndirectCommand
+	{
+		uint64_t objectDataAddress = 0;
+		uint64_t vertexBufferLocation = 0;
+		uint32_t vertexBufferSize = 0;
+		uint32_t vertexBufferStride = 0;
+		uint64_t indexBufferLocation = 0;
+		uint32_t indexBufferSize = 0;
+		uint32_t indexBufferFormat = 0;
+		uint32_t indexCountPerInstance = 0;
+		uint32_t instanceCount = 0;
+		uint32_t startIndexLocation = 0;
+		int32_t baseVertexLocation = 0;
+		uint32_t startInstanceLocation = 0;
+		// Stride of the argument buffer is 64 bytes
+		uint32_t padding = 0;
+
+		// Field by field, the object data address first: unique per instance
+		auto operator<=>(const IndirectCommand&) const = default;
+	};
+	static_assert(sizeof(IndirectCommand) == 64);
+
+	// Instances per group of the culling shader, one thread each
+	static constexpr uint32_t kGroupSize = 256;
+
+	// Uploaded once per scene. The object constant buffers move between the frames in flight,
+	// the culling adds objectDataOffset to the address of the frame.
+	struct Instance
+	{
+		// World space bounds
+		SimdMath::Float3 center;
+		uint32_t objectDataOffset = 0;
+		SimdMath::Float3 extents;
+		uint32_t padding = 0;
+		IndirectCommand command;
+	};
+	static_assert(sizeof(Instance) == 96);
+
+	// Left, right, bottom, top, near, far. Not normalized, only the sign of the distance matters.
+	struct Frustum
+	{
+		SimdMath::Float4 planes[6];
+	};
+
+	// SimdMath row vector convention, depth in [0, 1]
+	Frustum ExtractFrustum(const SimdMath::Float4x4& viewProjection);
+	// Bounds of the object space box transformed by model
+	Instance CreateInstance(const SimdMath::Float3& boundsMin, const SimdMath::Float3& boundsMax,
+		const SimdMath::Float4x4& model, uint32_t objectDataOffset, const IndirectCommand& command);
+
+	bool IsVisible(const Instance& instance, const Frustum& frustum);
+	// Writes the commands of the visible instances to the front of commands, returns their count
+	uint32_t Cull(const std::vector<Instance>& instances, const Frustum& frustum, uint64_t objectDataAddress,
+		std::vector<IndirectCommand>& commands);
+	// Commands of the one list missing from the other, whatever their order. Sorts both.
+	uint32_t CountMismatches(std::vector<IndirectCommand>& commands, std::vector<IndirectCommand>& referenceCommands);
+} // namespace InstanceCulling
@@ -1,28 +1,51 @@
 #include "LightSources.h"
 
+#include <cassert>
+
 
 void LightSources::SetAmbient(AmbientLightSource lightSource)
 {
-	m_ambient = lightSource;
+	m_data.ambient = lightSource;
 }
 
 
 void LightSources::AddDirectional(DirectionalLightSource lightSource)
 {
-	assert(m_directionalLightSourcesCount < kMaxDirectionalLightSourcesCount);
-	m_directionalSources[m_directionalLightSourcesCount++] = lightSource;
+	assert(m_data.directionalLightSourcesCount < kMaxDirectionalLightSourcesCount);
+	m_data.directionalSources[m_data.directionalLightSourcesCount++] = lightSource;
 }
 
 
 void LightSources::AddPoint(PointLightSource lightSource)
 {
-	assert(m_pointLightSourcesCount < kMaxPointLightSourcesCount);
-	m_pointLightSources[m_pointLightSourcesCount++] = lightSource;
+	assert(m_data.pointLightSourcesCount < kMaxPointLightSourcesCount);
+	m_data.pointLightSources[m_data.pointLightSourcesCount++] = lightSource;
 }
 
 
 void LightSources::AddSpot(SpotLightSource lightSource)
 {
-	assert(m_spotLightSourcesCount < kMaxSpotLightSourcesCount);
-	m_spotLightSources[m_spotLightSourcesCount++] = lightSource;
+	assert(m_data.spotLightSourcesCount < kMaxSpotLightSourcesCount);
+	m_data.spotLightSources[m_data.spotLightSourcesCount++] = lightSource;
+}
+
+
+void LightSources::RemoveDirectional(uint32_t index)
+{
+	assert(index < m_data.directionalLightSourcesCount);
+	m_data.directionalSources[index] = m_data.directionalSources[--m_data.directionalLightSourcesCount];
+}
+
+
+void LightSources::RemovePoint(uint32_t index)
+{
+	assert(index < m_data.pointLightSourcesCount);
+	m_data.pointLightSources[index] = m_data.pointLightSources[--m_data.pointLightSourcesCount];
+}
+
+
+void LightSources::RemoveSpot(uint32_t index)
+{
+	assert(index < m_data.spotLightSourcesCount);
+	m_data.spotLightSources[index] = m_data.spotLightSources[--m_data.spotLightSourcesCount];
 }
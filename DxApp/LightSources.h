@@ -1,127 +1,58 @@
 #pragma once
 
-#include <DirectXMath.h>
+#include "SimdMath.h"
 
+#include "Shaders/Shared/LightSourcesData.h"
 
-struct LightSource
-{
-	// w unused
-	DirectX::XMFLOAT4 color;
 
-	LightSource() : color(0.0f, 0.0f, 0.0f, 1.0f)
-	{
-	};
+using ShaderInterop::AmbientLightSource;
+using ShaderInterop::DirectionalLightSource;
+using ShaderInterop::PointLightSource;
+using ShaderInterop::SpotLightSource;
+using ShaderInterop::RectLightSource;
 
-	LightSource(DirectX::XMFLOAT4 lightColor) :
-		color(lightColor)
-	{
-	};
-};
 
-
-struct AmbientLightSource : LightSource
+// Layout and limits are shared with the shaders, see Shaders/Shared/LightSourcesData.h
+class LightSources
 {
-	AmbientLightSource() = default;
-
-	AmbientLightSource(DirectX::XMFLOAT4 lightColor) :
-		LightSource(lightColor)
-	{
-	}
-};
+public:
+	static constexpr uint32_t kMaxDirectionalLightSourcesCount =
+		ShaderInterop::LightSourcesStruct::kMaxDirectionalLightSourcesCount;
+	static constexpr uint32_t kMaxPointLightSourcesCount = ShaderInterop::LightSourcesStruct::kMaxPointLightSourcesCount;
+	static constexpr uint32_t kMaxSpotLightSourcesCount = ShaderInterop::LightSourcesStruct::kMaxSpotLightSourcesCount;
 
+	LightSources() = default;
 
-struct DirectionalLightSource : LightSource
-{
-	// w unused
-	DirectX::XMFLOAT4 direction;
+	void SetAmbient(AmbientLightSource lightSource);
+	void AddDirectional(DirectionalLightSource lightSource);
+	void AddPoint(PointLightSource lightSource);
+	void AddSpot(SpotLightSource lightSource);
+	// The last light source of the kind takes the index
+	void RemoveDirectional(uint32_t index);
+	void RemovePoint(uint32_t index);
+	void RemoveSpot(uint32_t index);
 
-	DirectionalLightSource() : direction(0.0f, 0.0f, 0.0f, 1.0f)
-	{
-	};
+	[[nodiscard]] uint32_t GetDirectionalLightSourcesCount() const { return m_data.directionalLightSourcesCount; }
+	[[nodiscard]] uint32_t GetPointLightSourcesCount() const { return m_data.pointLightSourcesCount; }
+	[[nodiscard]] uint32_t GetSpotLightSourcesCount() const { return m_data.spotLightSourcesCount; }
 
-	DirectionalLightSource(DirectX::XMFLOAT4 lightColor, DirectX::XMFLOAT4 lightDirection) :
-		LightSource(lightColor), direction(lightDirection)
+	[[nodiscard]] const AmbientLightSource& GetAmbient() const { return m_data.ambient; }
+	[[nodiscard]] const DirectionalLightSource& GetDirectionalLightSource(uint32_t index) const
 	{
+		return m_data.directionalSources[index];
 	}
-};
-
-
-struct PointLightSource : LightSource
-{
-	// w unused
-	DirectX::XMFLOAT4 position;
-
-	PointLightSource() : position(0.0f, 0.0f, 0.0f, 1.0f)
-	{
-	};
-
-	PointLightSource(DirectX::XMFLOAT4 lightColor, DirectX::XMFLOAT4 lightPosition) :
-		LightSource(lightColor), position(lightPosition)
+	[[nodiscard]] const PointLightSource& GetPointLightSource(uint32_t index) const
 	{
+		return m_data.pointLightSources[index];
 	}
-};
-
-
-struct SpotLightSource : LightSource
-{
-	// w unused
-	DirectX::XMFLOAT4 position;
-	DirectX::XMFLOAT3 direction;
-	float minLdotDir;
-
-	SpotLightSource() : position(0.0f, 0.0f, 0.0f, 1.0f), direction(1.0f, 0.0f, 0.0f), minLdotDir(0.0f)
-	{
-	};
-
-	// angle in radians from [0, pi]
-	SpotLightSource(DirectX::XMFLOAT4 lightColor, DirectX::XMFLOAT4 lightPosition, DirectX::XMFLOAT4 lightDirection,
-	                float angle) :
-		LightSource(lightColor), position(lightPosition),
-		direction(lightDirection.x, lightDirection.y, lightDirection.z), minLdotDir(cosf(angle))
-	{
-	}
-};
-
-
-// RectLightSource really
-struct RectLightSource : LightSource
-{
-	// w unused
-	DirectX::XMFLOAT4 vertexPositions[4] = {DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f)};
-
-	RectLightSource() = default;
-
-	RectLightSource(DirectX::XMFLOAT4 lightColor, DirectX::XMFLOAT4 lightVertexPositions[4]) :
-		LightSource(lightColor)
+	[[nodiscard]] const SpotLightSource& GetSpotLightSource(uint32_t index) const
 	{
-		for (uint32_t i = 0; i < 4; i++)
-			vertexPositions[i] = lightVertexPositions[i];
+		return m_data.spotLightSources[index];
 	}
-};
-
 
-// TODO sync these constants with shaders automatically 
-class LightSources
-{
-public:
-	static constexpr uint32_t kMaxDirectionalLightSourcesCount = 2;
-	static constexpr uint32_t kMaxPointLightSourcesCount = 4;
-	static constexpr uint32_t kMaxSpotLightSourcesCount = 4;
-
-	LightSources() = default;
-
-	void SetAmbient(AmbientLightSource lightSource);
-	void AddDirectional(DirectionalLightSource lightSource);
-	void AddPoint(PointLightSource lightSource);
-	void AddSpot(SpotLightSource lightSource);
+	// LightSourcesStruct of the lighting constant buffers
+	[[nodiscard]] const ShaderInterop::LightSourcesStruct& GetData() const { return m_data; }
 
 private:
-	AmbientLightSource m_ambient;
-	DirectionalLightSource m_directionalSources[kMaxDirectionalLightSourcesCount];
-	PointLightSource m_pointLightSources[kMaxPointLightSourcesCount];
-	SpotLightSource m_spotLightSources[kMaxSpotLightSourcesCount];
-
-	uint32_t m_directionalLightSourcesCount = 0;
-	uint32_t m_pointLightSourcesCount = 0;
-	uint32_t m_spotLightSourcesCount = 0;
+	ShaderInterop::LightSourcesStruct m_data = {};
 };
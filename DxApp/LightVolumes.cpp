@@ -0,0 +1,282 @@
+#include "LightVolumes.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+
+#include "LightSources.h"
+
+
+using namespace SimdMath;
+
+
+namespace
+{
+	// Samples on the exact surface may land on a face up to the float rounding
+	constexpr float kInsideTolerance = 1e-5f;
+
+	Float3 Subtract(const Float3& a, const Float3& b)
+	{
+		return { a.x - b.x, a.y - b.y, a.z - b.z };
+	}
+
+	Float3 Cross(const Float3& a, const Float3& b)
+	{
+		return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+
+	float Dot(const Float3& a, const Float3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	float Length(const Float3& vector)
+	{
+		return std::sqrt(Dot(vector, vector));
+	}
+
+	// Convex mesh, inside of every face plane
+	bool IsInside(const LightVolumes::Mesh& mesh, const Float3& point)
+	{
+		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		{
+			const Float3& v0 = mesh.vertices[mesh.indices[i]];
+			const Float3 normal = Cross(Subtract(mesh.vertices[mesh.indices[i + 1]], v0),
+				Subtract(mesh.vertices[mesh.indices[i + 2]], v0));
+			if (Dot(normal, Subtract(point, v0)) > kInsideTolerance * Length(normal))
+				return false;
+		}
+		return true;
+	}
+
+	// Divergence theorem over the triangles
+	float ComputeVolume(const LightVolumes::Mesh& mesh)
+	{
+		float volume = 0.0f;
+		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		{
+			volume += Dot(mesh.vertices[mesh.indices[i]],
+				Cross(mesh.vertices[mesh.indices[i + 1]], mesh.vertices[mesh.indices[i + 2]])) / 6.0f;
+		}
+		return volume;
+	}
+
+	// Smallest distance from the origin to a face plane
+	float GetMinFaceDistance(const LightVolumes::Mesh& mesh)
+	{
+		float minDistance = FLT_MAX;
+		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		{
+			const Float3& v0 = mesh.vertices[mesh.indices[i]];
+			const Float3 normal = Cross(Subtract(mesh.vertices[mesh.indices[i + 1]], v0),
+				Subtract(mesh.vertices[mesh.indices[i + 2]], v0));
+			minDistance = std::min(minDistance, Dot(normal, v0) / Length(normal));
+		}
+		return minDistance;
+	}
+
+	Float3 Normalize(const Float3& vector)
+	{
+		const float invLength = 1.0f / Length(vector);
+		return { vector.x * invLength, vector.y * invLength, vector.z * invLength };
+	}
+
+	// Rows are the scaled axes, then the position
+	Float4x4 ComposeTransform(const Float3& x, const Float3& y, const Float3& z, const Float4& position)
+	{
+		return {
+			x.x, x.y, x.z, 0.0f,
+			y.x, y.y, y.z, 0.0f,
+			z.x, z.y, z.z, 0.0f,
+			position.x, position.y, position.z, 1.0f
+		};
+	}
+
+	Float3 GetRandomDirection(std::mt19937& generator)
+	{
+		std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+		const float z = distribution(generator);
+		const float angle = distribution(generator) * kPi;
+		const float radius = std::sqrt(1.0f - z * z);
+		return { radius * std::cos(angle), radius * std::sin(angle), z };
+	}
+}
+
+
+namespace LightVolumes
+{
+	Mesh CreateSphere(uint32_t ringsCount, uint32_t segmentsCount)
+	{
+		Mesh mesh;
+
+		// Poles and the rings between them
+		mesh.vertices.push_back({ 0.0f, 0.0f, 1.0f });
+		for (uint32_t ring = 1; ring < ringsCount; ring++)
+		{
+			const float polarAngle = kPi * static_cast<float>(ring) / static_cast<float>(ringsCount);
+			for (uint32_t segment = 0; segment < segmentsCount; segment++)
+			{
+				const float azimuth = 2.0f * kPi * static_cast<float>(segment) / static_cast<float>(segmentsCount);
+				mesh.vertices.push_back({ std::sin(polarAngle) * std::cos(azimuth),
+					std::sin(polarAngle) * std::sin(azimuth), std::cos(polarAngle) });
+			}
+		}
+		mesh.vertices.push_back({ 0.0f, 0.0f, -1.0f });
+
+		const uint32_t bottomPole = static_cast<uint32_t>(mesh.vertices.size()) - 1;
+		const auto ringVertex = [segmentsCount](uint32_t ring, uint32_t segment) {
+			return 1 + (ring - 1) * segmentsCount + segment % segmentsCount;
+		};
+
+		for (uint32_t segment = 0; segment < segmentsCount; segment++)
+		{
+			mesh.indices.insert(mesh.indices.end(), { 0, ringVertex(1, segment), ringVertex(1, segment + 1) });
+
+			for (uint32_t ring = 1; ring + 1 < ringsCount; ring++)
+			{
+				mesh.indices.insert(mesh.indices.end(), { ringVertex(ring, segment), ringVertex(ring + 1, segment),
+					ringVertex(ring + 1, segment + 1) });
+				mesh.indices.insert(mesh.indices.end(), { ringVertex(ring, segment), ringVertex(ring + 1, segment + 1),
+					ringVertex(ring, segment + 1) });
+			}
+
+			mesh.indices.insert(mesh.indices.end(), { bottomPole, ringVertex(ringsCount - 1, segment + 1),
+				ringVertex(ringsCount - 1, segment) });
+		}
+
+		// Faces cut into the sphere, push them out until the closest one touches it
+		const float scale = 1.0f / GetMinFaceDistance(mesh);
+		for (auto& vertex : mesh.vertices)
+			vertex = { vertex.x * scale, vertex.y * scale, vertex.z * scale };
+
+		return mesh;
+	}
+
+
+	Mesh CreateCone(uint32_t segmentsCount)
+	{
+		Mesh mesh;
+
+		// Base polygon circumscribes the unit circle
+		const float baseRadius = 1.0f / std::cos(kPi / static_cast<float>(segmentsCount));
+		mesh.vertices.push_back({ 0.0f, 0.0f, 0.0f });
+		mesh.vertices.push_back({ 0.0f, 0.0f, 1.0f });
+		for (uint32_t segment = 0; segment < segmentsCount; segment++)
+		{
+			const float azimuth = 2.0f * kPi * static_cast<float>(segment) / static_cast<float>(segmentsCount);
+			mesh.vertices.push_back({ baseRadius * std::cos(azimuth), baseRadius * std::sin(azimuth), 1.0f });
+		}
+
+		for (uint32_t segment = 0; segment < segmentsCount; segment++)
+		{
+			const uint32_t current = 2 + segment;
+			const uint32_t next = 2 + (segment + 1) % segmentsCount;
+			// Side, then base
+			mesh.indices.insert(mesh.indices.end(), { 0, next, current });
+			mesh.indices.insert(mesh.indices.end(), { 1, current, next });
+		}
+
+		return mesh;
+	}
+
+
+	Float4x4 GetPointLightTransform(const PointLightSource& lightSource, float range)
+	{
+		return ComposeTransform({ range, 0.0f, 0.0f }, { 0.0f, range, 0.0f }, { 0.0f, 0.0f, range },
+			lightSource.position);
+	}
+
+
+	Float4x4 GetSpotLightTransform(const SpotLightSource& lightSource, float range)
+	{
+		if (UseSphereForSpotLight(lightSource))
+		{
+			return ComposeTransform({ range, 0.0f, 0.0f }, { 0.0f, range, 0.0f }, { 0.0f, 0.0f, range },
+				lightSource.position);
+		}
+
+		// Right handed basis around the direction keeps the triangles counter clockwise
+		const Float3 direction = Normalize(lightSource.direction);
+		const Float3 up = std::abs(direction.y) < 0.99f ? Float3(0.0f, 1.0f, 0.0f) : Float3(1.0f, 0.0f, 0.0f);
+		const Float3 tangent = Normalize(Cross(up, direction));
+		const Float3 bitangent = Cross(direction, tangent);
+
+		const float baseRadius = range * std::sqrt(1.0f - lightSource.minLdotDir * lightSource.minLdotDir)
+			/ lightSource.minLdotDir;
+		return ComposeTransform(
+			{ tangent.x * baseRadius, tangent.y * baseRadius, tangent.z * baseRadius },
+			{ bitangent.x * baseRadius, bitangent.y * baseRadius, bitangent.z * baseRadius },
+			{ direction.x * range, direction.y * range, direction.z * range },
+			lightSource.position);
+	}
+
+
+	bool UseSphereForSpotLight(const SpotLightSource& lightSource)
+	{
+		return lightSource.minLdotDir <= kMinConeLdotDir;
+	}
+
+
+	bool IsPointInside(const Mesh& mesh, const Float4x4& transform, const Float3& point, float margin)
+	{
+		const Float3 origin = { transform._41, transform._42, transform._43 };
+
+		float radius = 0.0f;
+		for (const auto& vertex : mesh.vertices)
+		{
+			// Mesh origin is inside, the farthest vertex bounds it
+			const Float3 offset = {
+				vertex.x * transform._11 + vertex.y * transform._21 + vertex.z * transform._31,
+				vertex.x * transform._12 + vertex.y * transform._22 + vertex.z * transform._32,
+				vertex.x * transform._13 + vertex.y * transform._23 + vertex.z * transform._33
+			};
+			radius = std::max(radius, Length(offset));
+		}
+
+		return Length(Subtract(point, origin)) <= radius + margin;
+	}
+
+
+	CoverageReport ValidateSphere(const Mesh& mesh, uint32_t samplesCount)
+	{
+		CoverageReport report;
+		report.samplesCount = samplesCount;
+
+		std::mt19937 generator(0);
+		std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+		for (uint32_t i = 0; i < samplesCount; i++)
+		{
+			// Every other sample on the surface, where the faces are the closest
+			const float radius = i % 2 == 0 ? 1.0f : std::cbrt(distribution(generator));
+			const Float3 direction = GetRandomDirection(generator);
+			if (!IsInside(mesh, { direction.x * radius, direction.y * radius, direction.z * radius }))
+				report.uncoveredSamplesCount++;
+		}
+
+		report.volumeRatio = ComputeVolume(mesh) / (4.0f / 3.0f * kPi);
+		return report;
+	}
+
+
+	CoverageReport ValidateCone(const Mesh& mesh, uint32_t samplesCount)
+	{
+		CoverageReport report;
+		report.samplesCount = samplesCount;
+
+		std::mt19937 generator(0);
+		std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+		for (uint32_t i = 0; i < samplesCount; i++)
+		{
+			const float azimuth = 2.0f * kPi * distribution(generator);
+			// Every other sample on the side surface or the base rim
+			const float height = i % 4 == 0 ? 1.0f : std::cbrt(distribution(generator));
+			const float radius = height * (i % 2 == 0 ? 1.0f : std::sqrt(distribution(generator)));
+			if (!IsInside(mesh, { radius * std::cos(azimuth), radius * std::sin(azimuth), height }))
+				report.uncoveredSamplesCount++;
+		}
+
+		report.volumeRatio = ComputeVolume(mesh) / (kPi / 3.0f);
+		return report;
+	}
+} // namespace LightVolumes
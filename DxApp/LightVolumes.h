@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "SimdMath.h"
+
+
+namespace ShaderInterop
+{
+	struct PointLightSource;
+	struct SpotLightSource;
+}
+using ShaderInterop::PointLightSource;
+using ShaderInterop::SpotLightSource;
+
+// Low poly proxies of the point and spot light volumes, LightVolumesPass.hlsl scales them to the light range.
+// Triangles are counter clockwise seen from outside.
+namespace LightVolumes
+{
+	struct Mesh
+	{
+		std::vector<SimdMath::Float3> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	// Tessellation of the meshes LightVolumesPass draws.
+	// 168 triangles, 8% over the sphere volume
+	static constexpr uint32_t kSphereRingsCount = 8;
+	static constexpr uint32_t kSphereSegmentsCount = 12;
+	// 24 triangles, 2% over the cone volume
+	static constexpr uint32_t kConeSegmentsCount = 12;
+
+	// Convex polyhedron containing the unit sphere
+	Mesh CreateSphere(uint32_t ringsCount, uint32_t segmentsCount);
+	// Pyramid containing the cone with the apex at the origin, axis +z, height 1 and base radius 1
+	Mesh CreateCone(uint32_t segmentsCount);
+
+	// Spot lights wider than this get the sphere, the cone would not fit them
+	static constexpr float kMinConeLdotDir = 0.2f;
+
+	// World transforms of the meshes in SimdMath row vector convention, range from TiledLightCulling::GetLightRange
+	SimdMath::Float4x4 GetPointLightTransform(const PointLightSource& lightSource, float range);
+	SimdMath::Float4x4 GetSpotLightTransform(const SpotLightSource& lightSource, float range);
+	bool UseSphereForSpotLight(const SpotLightSource& lightSource);
+
+	// Conservative, tests the bounding sphere of the transformed mesh grown by the margin
+	bool IsPointInside(const Mesh& mesh, const SimdMath::Float4x4& transform, const SimdMath::Float3& point,
+		float margin);
+
+	struct CoverageReport
+	{
+		uint32_t samplesCount = 0;
+		// Samples of the true volume outside of the mesh. Has to be 0.
+		uint32_t uncoveredSamplesCount = 0;
+		// Mesh volume over the true volume, the pixels shaded in vain
+		float volumeRatio = 0.0f;
+	};
+
+	// Samples the inside and the surface of the unit sphere
+	CoverageReport ValidateSphere(const Mesh& mesh, uint32_t samplesCount);
+	// Samples the inside and the surface of the unit cone
+	CoverageReport ValidateCone(const Mesh& mesh, uint32_t samplesCount);
+} // namespace LightVolumes
@@ -0,0 +1,456 @@
+#include "LightVolumesPass.h"
+
+#include "RendererForwards.h"
+#include "DxHelpers.h"
+#include "Scene.h"
+#include "ShaderCache.h"
+#include "TiledLightCulling.h"
+#include "UploadService.h"
+
+using namespace Microsoft::WRL;
+
+namespace
+{
+	// GBuffer targets, then the accumulated radiance the resolve reads
+	constexpr uint32_t kSrvCount = GBuffer::kSrvCount + 1;
+	// Light index after the transform
+	constexpr uint32_t kVolumeConstantsCount = 16 + 1;
+	// Camera near plane corners stay out of the volume the camera is considered outside of
+	constexpr float kCameraNearMargin = 0.5f;
+
+	// Referenced by the PSO desc until the asynchronous PSO creation is done
+	const D3D12_INPUT_ELEMENT_DESC kInputElementDescs[] = {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+	};
+
+	constexpr D3D12_DEPTH_STENCILOP_DESC kMarkStencilOp = {
+		D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_REPLACE, D3D12_COMPARISON_FUNC_EQUAL
+	};
+	// Clears the mark whether the front face passes the depth test or not
+	constexpr D3D12_DEPTH_STENCILOP_DESC kShadeOutsideStencilOp = {
+		D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_ZERO, D3D12_STENCIL_OP_ZERO, D3D12_COMPARISON_FUNC_EQUAL
+	};
+	constexpr D3D12_DEPTH_STENCILOP_DESC kShadeInsideStencilOp = {
+		D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_COMPARISON_FUNC_EQUAL
+	};
+}
+
+
+LightVolumesPass::LightVolumesPass(ID3D12Device* device, ShaderCache& shaderCache,
+	PipelineStateCache& pipelineStateCache, GBufferMode gBufferMode)
+{
+	Initialize(device, shaderCache, pipelineStateCache, gBufferMode);
+}
+
+
+void LightVolumesPass::Initialize(ID3D12Device* device, ShaderCache& shaderCache,
+	PipelineStateCache& pipelineStateCache, GBufferMode gBufferMode)
+{
+	m_shaderCache = &shaderCache;
+	m_pipelineStateCache = &pipelineStateCache;
+	m_gBufferMode = gBufferMode;
+
+	CreateRootSignature(device);
+	ResolvePermutationKeys();
+
+	// Marking has no pixel shader and the resolve has no permutations
+	m_markPipelineStateObject = CreateVolumePipelineStateObject({ nullptr, 0 }, D3D12_CULL_MODE_FRONT,
+		D3D12_COMPARISON_FUNC_GREATER_EQUAL, kMarkStencilOp, kGeometryStencilRef, kLightVolumeStencilBit);
+	m_resolvePipelineStateObject = CreateFullscreenPipelineStateObject("LightVolumeResolve_ps", 0, kSwapChainFormat,
+		false);
+	UpdatePermutation();
+
+	m_cbvSrvUavDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+
+void LightVolumesPass::CreateResources(ID3D12Device* device, GpuHeapAllocator& heapAllocator, uint32_t windowWidth,
+	uint32_t windowHeight)
+{
+	D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {};
+	rtvHeapDesc.NumDescriptors = 1;
+	rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+	rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+	DxVerify(device->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&m_rtvHeap)));
+
+	const auto resourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(kAccumulationFormat, windowWidth, windowHeight,
+		1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+	const D3D12_CLEAR_VALUE clearValue = { kAccumulationFormat, {0.0f, 0.0f, 0.0f, 1.0f} };
+
+	m_accumulationAllocation = heapAllocator.CreateResource(GpuHeapCategory::RenderTargets, resourceDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ, &clearValue, m_accumulationRt);
+	m_accumulationRt->SetName(L"LightVolumesPass::AccumulationRt");
+	device->CreateRenderTargetView(m_accumulationRt.Get(), nullptr, m_rtvHeap->GetCPUDescriptorHandleForHeapStart());
+}
+
+
+uint64_t LightVolumesPass::CreateMeshes(GpuHeapAllocator& heapAllocator, UploadService& uploadService)
+{
+	m_sphereMesh = LightVolumes::CreateSphere(LightVolumes::kSphereRingsCount, LightVolumes::kSphereSegmentsCount);
+	m_coneMesh = LightVolumes::CreateCone(LightVolumes::kConeSegmentsCount);
+
+	// One buffer each, the cone follows the sphere
+	m_sphere = { static_cast<uint32_t>(m_sphereMesh.indices.size()), 0, 0 };
+	m_cone = { static_cast<uint32_t>(m_coneMesh.indices.size()), m_sphere.indicesCount,
+		static_cast<int32_t>(m_sphereMesh.vertices.size()) };
+
+	const uint32_t sphereVerticesSize = static_cast<uint32_t>(m_sphereMesh.vertices.size() * sizeof(SimdMath::Float3));
+	const uint32_t coneVerticesSize = static_cast<uint32_t>(m_coneMesh.vertices.size() * sizeof(SimdMath::Float3));
+	const uint32_t sphereIndicesSize = m_sphere.indicesCount * sizeof(uint32_t);
+	const uint32_t coneIndicesSize = m_cone.indicesCount * sizeof(uint32_t);
+
+	// Created in the common state, promoted to the copy dest and then to the vertex/index buffer states
+	m_vertexBufferAllocation = heapAllocator.CreateResource(GpuHeapCategory::Buffers,
+		CD3DX12_RESOURCE_DESC::Buffer(sphereVerticesSize + coneVerticesSize), D3D12_RESOURCE_STATE_COMMON, nullptr,
+		m_vertexBuffer);
+	m_indexBufferAllocation = heapAllocator.CreateResource(GpuHeapCategory::Buffers,
+		CD3DX12_RESOURCE_DESC::Buffer(sphereIndicesSize + coneIndicesSize), D3D12_RESOURCE_STATE_COMMON, nullptr,
+		m_indexBuffer);
+	m_vertexBuffer->SetName(L"LightVolumesPass::VertexBuffer");
+	m_indexBuffer->SetName(L"LightVolumesPass::IndexBuffer");
+
+	uploadService.UploadBuffer(m_vertexBuffer.Get(), 0, m_sphereMesh.vertices.data(), sphereVerticesSize);
+	uploadService.UploadBuffer(m_vertexBuffer.Get(), sphereVerticesSize, m_coneMesh.vertices.data(), coneVerticesSize);
+	uploadService.UploadBuffer(m_indexBuffer.Get(), 0, m_sphereMesh.indices.data(), sphereIndicesSize);
+	uploadService.UploadBuffer(m_indexBuffer.Get(), sphereIndicesSize, m_coneMesh.indices.data(), coneIndicesSize);
+
+	m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
+	m_vertexBufferView.SizeInBytes = sphereVerticesSize + coneVerticesSize;
+	m_vertexBufferView.StrideInBytes = sizeof(SimdMath::Float3);
+
+	m_indexBufferView.BufferLocation = m_indexBuffer->GetGPUVirtualAddress();
+	m_indexBufferView.SizeInBytes = sphereIndicesSize + coneIndicesSize;
+	m_indexBufferView.Format = DXGI_FORMAT_R32_UINT;
+
+	return uploadService.Flush();
+}
+
+
+void LightVolumesPass::DestroyResources(GpuHeapAllocator& heapAllocator)
+{
+	m_accumulationRt.Reset();
+	heapAllocator.Free(m_accumulationAllocation);
+
+	m_vertexBuffer.Reset();
+	heapAllocator.Free(m_vertexBufferAllocation);
+	m_indexBuffer.Reset();
+	heapAllocator.Free(m_indexBufferAllocation);
+}
+
+
+void LightVolumesPass::SetScene(Scene* scene)
+{
+	m_scene = scene;
+	UpdatePermutation();
+}
+
+
+void LightVolumesPass::SetFalloff(LightFalloff falloff)
+{
+	m_falloff = falloff;
+	UpdatePermutation();
+}
+
+
+void LightVolumesPass::UpdatePermutation()
+{
+	// No scene yet, prepare the variants for the lights a scene has the most often
+	static const LightSources kDefaultLightSources = [] {
+		LightSources lightSources;
+		lightSources.AddDirectional(DirectionalLightSource());
+		lightSources.AddPoint(PointLightSource());
+		return lightSources;
+	}();
+	const auto& lightSources = m_scene ? m_scene->GetLightSources() : kDefaultLightSources;
+
+	m_ambientPermutationKey = LightingPass::SelectPermutationKey(m_ambientPermutationKeys, lightSources, m_falloff,
+		m_gBufferMode);
+	auto& ambientPipelineStateObject = m_ambientPipelineStateObjects[m_ambientPermutationKey];
+	if (!ambientPipelineStateObject.valid())
+	{
+		ambientPipelineStateObject = CreateFullscreenPipelineStateObject("LightVolumeAmbient_ps",
+			m_ambientPermutationKey, kAccumulationFormat, true);
+	}
+
+	m_lightPermutationKey = LightingPass::SelectPermutationKey(m_lightPermutationKeys, lightSources, m_falloff,
+		m_gBufferMode);
+	auto& lightPipelineStateObjects = m_lightPipelineStateObjects[m_lightPermutationKey];
+	if (!lightPipelineStateObjects.outside.valid())
+	{
+		const D3D12_SHADER_BYTECODE pixelShader = m_shaderCache->GetShader("LightVolume_ps", m_lightPermutationKey);
+		constexpr uint8_t kStencilRef = kGeometryStencilRef | kLightVolumeStencilBit;
+		lightPipelineStateObjects.outside = CreateVolumePipelineStateObject(pixelShader, D3D12_CULL_MODE_BACK,
+			D3D12_COMPARISON_FUNC_LESS_EQUAL, kShadeOutsideStencilOp, kStencilRef, kLightVolumeStencilBit);
+		lightPipelineStateObjects.inside = CreateVolumePipelineStateObject(pixelShader, D3D12_CULL_MODE_FRONT,
+			D3D12_COMPARISON_FUNC_GREATER_EQUAL, kShadeInsideStencilOp, kGeometryStencilRef, 0);
+	}
+}
+
+
+void LightVolumesPass::SetupRootResourceDescriptors(ID3D12Device* device,
+	CD3DX12_CPU_DESCRIPTOR_HANDLE rootParameters, D3D12_GPU_VIRTUAL_ADDRESS lightingDataAddress,
+	uint32_t lightingDataSize, const GBuffer& gBuffer, ID3D12Resource* depthStencil) const
+{
+	D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
+	cbvDesc.BufferLocation = lightingDataAddress;
+	cbvDesc.SizeInBytes = lightingDataSize;
+	device->CreateConstantBufferView(&cbvDesc, rootParameters);
+	rootParameters.Offset(1, m_cbvSrvUavDescriptorSize);
+
+	for (uint32_t i = 0; i < gBuffer.GetRtCount(); i++)
+	{
+		device->CreateShaderResourceView(gBuffer.GetRt(i), nullptr, rootParameters);
+		rootParameters.Offset(1, m_cbvSrvUavDescriptorSize);
+	}
+
+	// Compact mode has a target less and reads depth in the place of the 4th one, as LightingPass does
+	if (gBuffer.GetMode() == GBufferMode::Compact)
+	{
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = kDepthSrvFormat;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Texture2D.MipLevels = 1;
+		device->CreateShaderResourceView(depthStencil, &srvDesc, rootParameters);
+	}
+	rootParameters.Offset(GBuffer::kSrvCount - gBuffer.GetRtCount(), m_cbvSrvUavDescriptorSize);
+
+	device->CreateShaderResourceView(m_accumulationRt.Get(), nullptr, rootParameters);
+}
+
+
+void LightVolumesPass::Setup(ID3D12GraphicsCommandList* commandList) const
+{
+	commandList->SetGraphicsRootSignature(m_rootSignature.Get());
+}
+
+
+void LightVolumesPass::DrawLights(ID3D12GraphicsCommandList* commandList,
+	CD3DX12_GPU_DESCRIPTOR_HANDLE rootParameters) const
+{
+	commandList->SetGraphicsRootDescriptorTable(0, rootParameters);
+
+	// Ambient and directional lights overwrite every geometry pixel
+	commandList->SetPipelineState(m_ambientPipelineStateObjects.at(m_ambientPermutationKey).get().Get());
+	commandList->OMSetStencilRef(kGeometryStencilRef);
+	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	commandList->DrawInstanced(6, 1, 0, 0);
+
+	commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
+	commandList->IASetIndexBuffer(&m_indexBufferView);
+
+	const auto& lightSources = m_scene->GetLightSources();
+	const auto& lightPipelineStateObjects = m_lightPipelineStateObjects.at(m_lightPermutationKey);
+	const SimdMath::Float3 cameraPosition = m_scene->GetCamera().GetPosition();
+	const bool linearFalloff = m_falloff == LightFalloff::Linear;
+
+	const uint32_t pointLightsCount = lightSources.GetPointLightSourcesCount();
+	const uint32_t lightsCount = pointLightsCount + lightSources.GetSpotLightSourcesCount();
+	for (uint32_t lightIndex = 0; lightIndex < lightsCount; lightIndex++)
+	{
+		SimdMath::Float4x4 transform;
+		const MeshRange* mesh = &m_sphere;
+		const LightVolumes::Mesh* cpuMesh = &m_sphereMesh;
+		if (lightIndex < pointLightsCount)
+		{
+			const auto& lightSource = lightSources.GetPointLightSource(lightIndex);
+			transform = LightVolumes::GetPointLightTransform(lightSource,
+				TiledLightCulling::GetLightRange(lightSource.color, linearFalloff));
+		}
+		else
+		{
+			const auto& lightSource = lightSources.GetSpotLightSource(lightIndex - pointLightsCount);
+			transform = LightVolumes::GetSpotLightTransform(lightSource,
+				TiledLightCulling::GetLightRange(lightSource.color, linearFalloff));
+			if (!LightVolumes::UseSphereForSpotLight(lightSource))
+			{
+				mesh = &m_cone;
+				cpuMesh = &m_coneMesh;
+			}
+		}
+
+		commandList->SetGraphicsRoot32BitConstants(1, 16, &transform, 0);
+		commandList->SetGraphicsRoot32BitConstant(1, lightIndex, 16);
+
+		if (LightVolumes::IsPointInside(*cpuMesh, transform, cameraPosition, kCameraNearMargin))
+		{
+			commandList->SetPipelineState(lightPipelineStateObjects.inside.get().Get());
+			commandList->OMSetStencilRef(kGeometryStencilRef);
+			commandList->DrawIndexedInstanced(mesh->indicesCount, 1, mesh->startIndex, mesh->baseVertex, 0);
+			continue;
+		}
+
+		commandList->OMSetStencilRef(kGeometryStencilRef | kLightVolumeStencilBit);
+		commandList->SetPipelineState(m_markPipelineStateObject.get().Get());
+		commandList->DrawIndexedInstanced(mesh->indicesCount, 1, mesh->startIndex, mesh->baseVertex, 0);
+		commandList->SetPipelineState(lightPipelineStateObjects.outside.get().Get());
+		commandList->DrawIndexedInstanced(mesh->indicesCount, 1, mesh->startIndex, mesh->baseVertex, 0);
+	}
+}
+
+
+void LightVolumesPass::Resolve(ID3D12GraphicsCommandList* commandList,
+	CD3DX12_GPU_DESCRIPTOR_HANDLE rootParameters) const
+{
+	commandList->SetPipelineState(m_resolvePipelineStateObject.get().Get());
+	commandList->SetGraphicsRootDescriptorTable(0, rootParameters);
+
+	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	commandList->DrawInstanced(6, 1, 0, 0);
+}
+
+
+uint32_t LightVolumesPass::GetDescriptorTablesDescriptorsCount() const
+{
+	return 1 + kSrvCount;
+}
+
+
+void LightVolumesPass::CreateRootSignature(ID3D12Device* device)
+{
+	D3D12_DESCRIPTOR_RANGE descriptorRanges[2] = {};
+	descriptorRanges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+	descriptorRanges[0].NumDescriptors = 1;
+	descriptorRanges[0].BaseShaderRegister = 0;
+	descriptorRanges[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+	descriptorRanges[0].RegisterSpace = 0;
+
+	descriptorRanges[1].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+	descriptorRanges[1].NumDescriptors = kSrvCount;
+	descriptorRanges[1].BaseShaderRegister = 0;
+	descriptorRanges[1].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+	descriptorRanges[1].RegisterSpace = 0;
+
+	D3D12_ROOT_DESCRIPTOR_TABLE descriptorTable = {};
+	descriptorTable.NumDescriptorRanges = _countof(descriptorRanges);
+	descriptorTable.pDescriptorRanges = descriptorRanges;
+
+	// Vertex shader reads the view projection from the same constant buffer
+	D3D12_ROOT_PARAMETER rootParameters[2] = {};
+	rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+	rootParameters[0].DescriptorTable = descriptorTable;
+	rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	// Volume transform and light index
+	rootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	rootParameters[1].Constants.ShaderRegister = 1;
+	rootParameters[1].Constants.RegisterSpace = 0;
+	rootParameters[1].Constants.Num32BitValues = kVolumeConstantsCount;
+	rootParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
+	rootSignatureDesc.Init(_countof(rootParameters), rootParameters, 0, nullptr,
+		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+	ComPtr<ID3DBlob> signature;
+	ComPtr<ID3DBlob> error;
+
+	DxVerify(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature,
+		&error));
+	DxVerify(device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
+		IID_PPV_ARGS(&m_rootSignature)));
+	m_rootSignatureHash = PipelineStateCache::HashRootSignature(signature->GetBufferPointer(), signature->GetBufferSize());
+}
+
+
+void LightVolumesPass::ResolvePermutationKeys()
+{
+	m_ambientPermutationKeys = LightingPermutation::ResolveKeys(
+		m_shaderCache->GetPermutationLayout("LightVolumeAmbient_ps"));
+	// One light per draw, the light type is picked by the index, so only the falloff and the GBuffer defines
+	m_lightPermutationKeys = LightingPermutation::ResolveKeys(m_shaderCache->GetPermutationLayout("LightVolume_ps"));
+}
+
+
+PipelineStateFuture LightVolumesPass::CreateFullscreenPipelineStateObject(const char* pixelShaderName,
+	uint32_t permutationKey, DXGI_FORMAT rtFormat, bool stencilTest)
+{
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+
+	psoDesc.InputLayout = { nullptr, 0 };
+	psoDesc.pRootSignature = m_rootSignature.Get();
+	psoDesc.VS = m_shaderCache->GetShader("LightingPass_vs");
+	psoDesc.PS = m_shaderCache->GetShader(pixelShaderName, permutationKey);
+
+	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+	psoDesc.RasterizerState.FrontCounterClockwise = true;
+	psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+
+	psoDesc.DepthStencilState.DepthEnable = false;
+	psoDesc.DepthStencilState.StencilEnable = stencilTest;
+	if (stencilTest)
+	{
+		psoDesc.DepthStencilState.StencilReadMask = kGeometryStencilRef;
+		psoDesc.DepthStencilState.StencilWriteMask = 0;
+		psoDesc.DepthStencilState.FrontFace = kShadeInsideStencilOp;
+		psoDesc.DepthStencilState.BackFace = kShadeInsideStencilOp;
+		psoDesc.DSVFormat = kDsFormat;
+	}
+
+	psoDesc.SampleMask = UINT_MAX;
+	psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+
+	psoDesc.NumRenderTargets = 1;
+	psoDesc.RTVFormats[0] = rtFormat;
+	psoDesc.SampleDesc.Count = 1;
+
+	return m_pipelineStateCache->CreateGraphicsPipelineStateAsync(psoDesc, m_rootSignatureHash);
+}
+
+
+PipelineStateFuture LightVolumesPass::CreateVolumePipelineStateObject(const D3D12_SHADER_BYTECODE& pixelShader,
+	D3D12_CULL_MODE cullMode, D3D12_COMPARISON_FUNC depthFunc, const D3D12_DEPTH_STENCILOP_DESC& stencilOp,
+	uint8_t stencilReadMask, uint8_t stencilWriteMask)
+{
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+
+	psoDesc.InputLayout = { kInputElementDescs, _countof(kInputElementDescs) };
+	psoDesc.pRootSignature = m_rootSignature.Get();
+	psoDesc.VS = m_shaderCache->GetShader("LightVolume_vs");
+	psoDesc.PS = pixelShader;
+
+	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+	psoDesc.RasterizerState.FrontCounterClockwise = true;
+	psoDesc.RasterizerState.CullMode = cullMode;
+	// Clamped instead of clipped: back faces past the far plane still mark, front faces before the near plane still shade
+	psoDesc.RasterizerState.DepthClipEnable = false;
+
+	// Lights add up, the marking writes stencil only
+	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+	auto& blendDesc = psoDesc.BlendState.RenderTarget[0];
+	if (pixelShader.pShaderBytecode)
+	{
+		blendDesc.BlendEnable = true;
+		blendDesc.SrcBlend = D3D12_BLEND_ONE;
+		blendDesc.DestBlend = D3D12_BLEND_ONE;
+		blendDesc.BlendOp = D3D12_BLEND_OP_ADD;
+		blendDesc.SrcBlendAlpha = D3D12_BLEND_ONE;
+		blendDesc.DestBlendAlpha = D3D12_BLEND_ONE;
+		blendDesc.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+	}
+	else
+	{
+		blendDesc.RenderTargetWriteMask = 0;
+	}
+
+	// Depth is bound read only, it stays readable by the compact GBuffer shaders
+	psoDesc.DepthStencilState.DepthEnable = true;
+	psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+	psoDesc.DepthStencilState.DepthFunc = depthFunc;
+	psoDesc.DepthStencilState.StencilEnable = true;
+	psoDesc.DepthStencilState.StencilReadMask = stencilReadMask;
+	psoDesc.DepthStencilState.StencilWriteMask = stencilWriteMask;
+	psoDesc.DepthStencilState.FrontFace = stencilOp;
+	psoDesc.DepthStencilState.BackFace = stencilOp;
+
+	psoDesc.DSVFormat = kDsFormat;
+	psoDesc.SampleMask = UINT_MAX;
+	psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+
+	psoDesc.NumRenderTargets = 1;
+	psoDesc.RTVFormats[0] = kAccumulationFormat;
+	psoDesc.SampleDesc.Count = 1;
+
+	return m_pipelineStateCache->CreateGraphicsPipelineStateAsync(psoDesc, m_rootSignatureHash);
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdint.h>
+#include <unordered_map>
+#include <d3d12.h>
+#include <d3dx12.h>
+#include <wrl.h>
+
+#include "GBuffer.h"
+#include "GpuHeapAllocator.h"
+#include "LightingPass.h"
+#include "LightVolumes.h"
+#include "PipelineStateCache.h"
+
+
+class Scene;
+class ShaderCache;
+class UploadService;
+
+// Deferred lighting by light volumes: a sphere per point light, a cone per spot light, see LightVolumes.h.
+// Radiance is accumulated in a float target, the ambient and the directional lights are a fullscreen draw.
+// Outside of a volume the back faces mark kLightVolumeStencilBit where the surface is in front of them,
+// the front faces shade the marked pixels behind them and clear the bit. Inside of it the back faces shade alone.
+class LightVolumesPass
+{
+public:
+	static constexpr DXGI_FORMAT kAccumulationFormat = DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
+
+	LightVolumesPass() = default;
+	explicit LightVolumesPass(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache,
+		GBufferMode gBufferMode);
+	// PSOs are created asynchronously, the first Setup with a new permutation waits for it.
+	// Caches have to outlive the pass.
+	void Initialize(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache,
+		GBufferMode gBufferMode);
+	~LightVolumesPass() = default;
+
+	// Accumulation target is created in the generic read state
+	void CreateResources(ID3D12Device* device, GpuHeapAllocator& heapAllocator, uint32_t windowWidth,
+		uint32_t windowHeight);
+	// Volume meshes are uploaded through the copy queue, they can be drawn once the returned fence value completes
+	uint64_t CreateMeshes(GpuHeapAllocator& heapAllocator, UploadService& uploadService);
+	void DestroyResources(GpuHeapAllocator& heapAllocator);
+
+	void SetScene(Scene* scene);
+	void SetFalloff(LightFalloff falloff);
+	// Picks the shader variants for the current light sources, has to be called before Setup when lights change
+	void UpdatePermutation();
+	// lightingDataAddress is the LightingPass constant buffer, the passes share it.
+	// Depth has to be in a pixel shader resource state during DrawLights in GBufferMode::Compact.
+	void SetupRootResourceDescriptors(ID3D12Device* device, CD3DX12_CPU_DESCRIPTOR_HANDLE rootParameters,
+		D3D12_GPU_VIRTUAL_ADDRESS lightingDataAddress, uint32_t lightingDataSize, const GBuffer& gBuffer,
+		ID3D12Resource* depthStencil) const;
+	void Setup(ID3D12GraphicsCommandList* commandList) const;
+	// Accumulation target and a depth stencil view with read only depth have to be bound
+	void DrawLights(ID3D12GraphicsCommandList* commandList, CD3DX12_GPU_DESCRIPTOR_HANDLE rootParameters) const;
+	// Accumulation target has to be readable, writes the swap chain buffer without depth stencil
+	void Resolve(ID3D12GraphicsCommandList* commandList, CD3DX12_GPU_DESCRIPTOR_HANDLE rootParameters) const;
+
+	[[nodiscard]] uint32_t GetDescriptorTablesDescriptorsCount() const;
+	[[nodiscard]] ID3D12Resource* GetAccumulationRt() const { return m_accumulationRt.Get(); }
+
+private:
+	struct MeshRange
+	{
+		uint32_t indicesCount = 0;
+		uint32_t startIndex = 0;
+		int32_t baseVertex = 0;
+	};
+
+	struct LightPipelineStates
+	{
+		// Camera outside of the volume, front faces test the marked pixels
+		PipelineStateFuture outside;
+		// Camera inside of the volume, back faces test the geometry pixels
+		PipelineStateFuture inside;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D12RootSignature> m_rootSignature;
+	uint64_t m_rootSignatureHash = 0;
+	Scene* m_scene = nullptr;
+
+	ShaderCache* m_shaderCache = nullptr;
+	PipelineStateCache* m_pipelineStateCache = nullptr;
+	LightingPass::PermutationKeys m_ambientPermutationKeys;
+	LightingPass::PermutationKeys m_lightPermutationKeys;
+	GBufferMode m_gBufferMode = GBufferMode::Standard;
+	LightFalloff m_falloff = LightFalloff::Square;
+	uint32_t m_ambientPermutationKey = 0;
+	uint32_t m_lightPermutationKey = 0;
+	std::unordered_map<uint32_t, PipelineStateFuture> m_ambientPipelineStateObjects;
+	std::unordered_map<uint32_t, LightPipelineStates> m_lightPipelineStateObjects;
+	PipelineStateFuture m_markPipelineStateObject;
+	PipelineStateFuture m_resolvePipelineStateObject;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_accumulationRt;
+	GpuAllocation m_accumulationAllocation;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_vertexBuffer;
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_indexBuffer;
+	GpuAllocation m_vertexBufferAllocation;
+	GpuAllocation m_indexBufferAllocation;
+	D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView = {};
+	D3D12_INDEX_BUFFER_VIEW m_indexBufferView = {};
+	MeshRange m_sphere;
+	MeshRange m_cone;
+	// Bounding spheres of the meshes are measured on them
+	LightVolumes::Mesh m_sphereMesh;
+	LightVolumes::Mesh m_coneMesh;
+
+	uint32_t m_cbvSrvUavDescriptorSize = 0;
+
+	void CreateRootSignature(ID3D12Device* device);
+	void ResolvePermutationKeys();
+	PipelineStateFuture CreateFullscreenPipelineStateObject(const char* pixelShaderName, uint32_t permutationKey,
+		DXGI_FORMAT rtFormat, bool stencilTest);
+	PipelineStateFuture CreateVolumePipelineStateObject(const D3D12_SHADER_BYTECODE& pixelShader,
+		D3D12_CULL_MODE cullMode, D3D12_COMPARISON_FUNC depthFunc, const D3D12_DEPTH_STENCILOP_DESC& stencilOp,
+		uint8_t stencilReadMask, uint8_t stencilWriteMask);
+};
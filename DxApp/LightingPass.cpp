@@ -1,35 +1,62 @@
 #include "LightingPass.h"
 
-#include <d3dcompiler.h>
+#include <chrono>
 
 #include "RendererForwards.h"
 #include "DxHelpers.h"
 #include "GBuffer.h"
 #include "GeometryPassObjectConstantBuffer.h"
 #include "Scene.h"
+#include "ShaderCache.h"
 
 namespace
 {
 	struct LightingPassConstantBuffer
 	{
-		XMFLOAT4 cameraPosition;
-		LightSources lightSources;
+		Float4 cameraPosition;
+		// Before lightSources, its size is not a multiple of the 16 bytes HLSL aligns matrices to
+		Float4x4 inverseViewProjection;
+		// Light volumes are rasterized with it
+		Float4x4 viewProjection;
+		ShaderInterop::LightSourcesStruct lightSources;
 
 		static uint32_t GetAlignedSize() { return (sizeof(LightingPassConstantBuffer) + 255) & ~255; }
 	};
+
+	constexpr const char* kDebugViewDefines[] = {
+		nullptr,
+		"DEBUG_VIEW_SURFACE_COLOR",
+		"DEBUG_VIEW_NORMAL",
+		"DEBUG_VIEW_ROUGHNESS",
+		"DEBUG_VIEW_METALNESS"
+	};
+	static_assert(std::size(kDebugViewDefines) == static_cast<size_t>(LightingDebugView::Count));
 }
 
 
-LightingPass::LightingPass(ID3D12Device* device)
+LightingPass::LightingPass(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache,
+	GBufferMode gBufferMode)
 {
-	Initialize(device);
+	Initialize(device, shaderCache, pipelineStateCache, gBufferMode);
 }
 
 
-void LightingPass::Initialize(ID3D12Device* device)
+void LightingPass::Initialize(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache,
+	GBufferMode gBufferMode)
 {
+	m_shaderCache = &shaderCache;
+	m_pipelineStateCache = &pipelineStateCache;
+	m_gBufferMode = gBufferMode;
+
 	CreateRootSignature(device);
-	CreatePipelineStateObject(device);
+	ResolvePermutationKeys();
+	// Stand-ins while a new permutation is created, the falloff can change at any time
+	for (const LightFalloff falloff : { LightFalloff::Square, LightFalloff::Linear })
+	{
+		const uint32_t key = GetSupersetPermutationKey(m_permutationKeys, falloff, m_gBufferMode);
+		m_pipelineStateObjects[key] = CreatePipelineStateObject("LightingPass_ps", key);
+	}
+	UpdatePermutation();
 
 	m_cbvSrvUavDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 }
@@ -38,11 +65,58 @@ void LightingPass::Initialize(ID3D12Device* device)
 void LightingPass::SetScene(Scene* scene)
 {
 	m_scene = scene;
+	UpdatePermutation();
+}
+
+
+void LightingPass::SetFalloff(LightFalloff falloff)
+{
+	m_falloff = falloff;
+	UpdatePermutation();
+}
+
+
+void LightingPass::SetDebugView(LightingDebugView debugView)
+{
+	m_debugView = debugView;
+	UpdatePermutation();
+}
+
+
+void LightingPass::UpdatePermutation()
+{
+	if (m_debugView != LightingDebugView::None)
+	{
+		auto& pipelineStateObject = m_debugViewPipelineStateObjects[static_cast<uint32_t>(m_debugView)];
+		if (!pipelineStateObject.valid())
+		{
+			const auto& layout = m_shaderCache->GetPermutationLayout("LightingPassDebug_ps");
+			uint32_t key = layout.GetDefineKey(kDebugViewDefines[static_cast<uint32_t>(m_debugView)]);
+			if (m_gBufferMode == GBufferMode::Compact)
+				key |= layout.GetDefineKey("COMPACT_GBUFFER");
+			pipelineStateObject = CreatePipelineStateObject("LightingPassDebug_ps", key);
+		}
+		return;
+	}
+
+	// No scene yet, prepare the variant for the lights a scene has the most often
+	static const LightSources kDefaultLightSources = [] {
+		LightSources lightSources;
+		lightSources.AddDirectional(DirectionalLightSource());
+		return lightSources;
+	}();
+	const auto& lightSources = m_scene ? m_scene->GetLightSources() : kDefaultLightSources;
+
+	m_permutationKey = SelectPermutationKey(m_permutationKeys, lightSources, m_falloff, m_gBufferMode);
+
+	auto& pipelineStateObject = m_pipelineStateObjects[m_permutationKey];
+	if (!pipelineStateObject.valid())
+		pipelineStateObject = CreatePipelineStateObject("LightingPass_ps", m_permutationKey);
 }
 
 
 void LightingPass::SetupRootResourceDescriptors(ID3D12Device* device, CD3DX12_CPU_DESCRIPTOR_HANDLE rootParameters,
-	D3D12_GPU_VIRTUAL_ADDRESS dataAddress, const GBuffer& gBuffer) const
+	D3D12_GPU_VIRTUAL_ADDRESS dataAddress, const GBuffer& gBuffer, ID3D12Resource* depthStencil) const
 {
 	D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
 	cbvDesc.BufferLocation = dataAddress;
@@ -50,33 +124,54 @@ void LightingPass::SetupRootResourceDescriptors(ID3D12Device* device, CD3DX12_CP
 	device->CreateConstantBufferView(&cbvDesc, rootParameters);
 	rootParameters.Offset(1, m_cbvSrvUavDescriptorSize);
 
-	device->CreateShaderResourceView(gBuffer.m_surfaceColorRt.Get(), nullptr, rootParameters);
-	rootParameters.Offset(1, m_cbvSrvUavDescriptorSize);
-	device->CreateShaderResourceView(gBuffer.m_positionRoughnessRt.Get(), nullptr, rootParameters);
-	rootParameters.Offset(1, m_cbvSrvUavDescriptorSize);
-	device->CreateShaderResourceView(gBuffer.m_normalMetalnessRt.Get(), nullptr, rootParameters);
-	rootParameters.Offset(1, m_cbvSrvUavDescriptorSize);
-	device->CreateShaderResourceView(gBuffer.m_fresnelIndicesRt.Get(), nullptr, rootParameters);
-	rootParameters.Offset(1, m_cbvSrvUavDescriptorSize);
+	for (uint32_t i = 0; i < gBuffer.GetRtCount(); i++)
+	{
+		device->CreateShaderResourceView(gBuffer.GetRt(i), nullptr, rootParameters);
+		rootParameters.Offset(1, m_cbvSrvUavDescriptorSize);
+	}
+
+	if (gBuffer.GetMode() == GBufferMode::Compact)
+	{
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = kDepthSrvFormat;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Texture2D.MipLevels = 1;
+		device->CreateShaderResourceView(depthStencil, &srvDesc, rootParameters);
+		rootParameters.Offset(1, m_cbvSrvUavDescriptorSize);
+	}
 }
 
 
-void LightingPass::UpdateRootResources(uint8_t* cbData) const
+void LightingPass::UpdateRootResources(uint8_t* cbData, float appAspect) const
 {
 	new(cbData) LightingPassConstantBuffer();
 	auto& lightingPassData = *reinterpret_cast<LightingPassConstantBuffer*>(cbData);
 
 	const auto cameraPositionVector3 = m_scene->GetCamera().GetPosition();
-	lightingPassData.cameraPosition = XMFLOAT4(cameraPositionVector3.x, cameraPositionVector3.y,
+	lightingPassData.cameraPosition = Float4(cameraPositionVector3.x, cameraPositionVector3.y,
 		cameraPositionVector3.z, 1.0f);
 
-	lightingPassData.lightSources = m_scene->GetLightSources();
+	const auto& camera = m_scene->GetCamera();
+	const Float4x4 view = camera.GetViewMatrix();
+	const Float4x4 projection = camera.GetProjectionMatrix(appAspect);
+	const Matrix viewProjection = MatrixMultiply(LoadFloat4x4(view), LoadFloat4x4(projection));
+	StoreFloat4x4(lightingPassData.inverseViewProjection, MatrixInverse(viewProjection));
+	StoreFloat4x4(lightingPassData.viewProjection, viewProjection);
+
+	lightingPassData.lightSources = m_scene->GetLightSources().GetData();
 }
 
 
 void LightingPass::Setup(ID3D12GraphicsCommandList* commandList) const
 {
-	commandList->SetPipelineState(m_pipelineStateObject.Get());
+	const PipelineStateFuture* pipelineStateObject = &m_pipelineStateObjects.at(m_permutationKey);
+	if (m_debugView != LightingDebugView::None)
+		pipelineStateObject = &m_debugViewPipelineStateObjects[static_cast<uint32_t>(m_debugView)];
+	else if (pipelineStateObject->wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		pipelineStateObject = &m_pipelineStateObjects.at(GetSupersetPermutationKey(m_permutationKeys, m_falloff,
+			m_gBufferMode));
+	commandList->SetPipelineState(pipelineStateObject->get().Get());
 	commandList->SetGraphicsRootSignature(m_rootSignature.Get());
 }
 
@@ -94,7 +189,7 @@ void LightingPass::Draw(ID3D12GraphicsCommandList* commandList, CD3DX12_GPU_DESC
 
 uint32_t LightingPass::GetDescriptorTablesDescriptorsCount() const
 {
-	return 1 + GBuffer::kRtCount;
+	return 1 + GBuffer::kSrvCount;
 }
 
 
@@ -104,6 +199,20 @@ uint32_t LightingPass::GetRootResourcesSize() const
 }
 
 
+uint32_t LightingPass::SelectPermutationKey(const PermutationKeys& keys, const LightSources& lightSources,
+	LightFalloff falloff, GBufferMode gBufferMode)
+{
+	return LightingPermutation::SelectKey(keys, lightSources, falloff, gBufferMode == GBufferMode::Compact);
+}
+
+
+uint32_t LightingPass::GetSupersetPermutationKey(const PermutationKeys& keys, LightFalloff falloff,
+	GBufferMode gBufferMode)
+{
+	return LightingPermutation::GetSupersetKey(keys, falloff, gBufferMode == GBufferMode::Compact);
+}
+
+
 void LightingPass::CreateRootSignature(ID3D12Device* device)
 {
 	D3D12_DESCRIPTOR_RANGE descriptorRanges[2] = {};
@@ -114,7 +223,7 @@ void LightingPass::CreateRootSignature(ID3D12Device* device)
 	descriptorRanges[0].RegisterSpace = 0;
 
 	descriptorRanges[1].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-	descriptorRanges[1].NumDescriptors = GBuffer::kRtCount;
+	descriptorRanges[1].NumDescriptors = GBuffer::kSrvCount;
 	descriptorRanges[1].BaseShaderRegister = 0;
 	descriptorRanges[1].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
 	descriptorRanges[1].RegisterSpace = 0;
@@ -146,36 +255,27 @@ void LightingPass::CreateRootSignature(ID3D12Device* device)
 		&error));
 	DxVerify(device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
 		IID_PPV_ARGS(&m_rootSignature)));
+	m_rootSignatureHash = PipelineStateCache::HashRootSignature(signature->GetBufferPointer(), signature->GetBufferSize());
 }
 
 
-void LightingPass::CreatePipelineStateObject(ID3D12Device* device)
+void LightingPass::ResolvePermutationKeys()
 {
-	ComPtr<ID3DBlob> vertexShader;
-	ComPtr<ID3DBlob> pixelShader;
+	m_permutationKeys = LightingPermutation::ResolveKeys(m_shaderCache->GetPermutationLayout("LightingPass_ps"));
+}
 
-#if defined(_DEBUG)
-	// Enable better shader debugging with the graphics debugging tools.
-	uint32_t compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION | D3DCOMPILE_PACK_MATRIX_COLUMN_MAJOR;
-#else
-	uint32_t compileFlags = D3DCOMPILE_PACK_MATRIX_COLUMN_MAJOR;
-#endif
 
-	DxVerify(D3DCompileFromFile(L"Shaders/Deferred/LightingPass_vs.hlsl", nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-		"vs_main",
-		"vs_5_0",
-		compileFlags, 0, &vertexShader, nullptr));
-	DxVerify(D3DCompileFromFile(L"Shaders/Deferred/LightingPass_ps.hlsl", nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-		"ps_main",
-		"ps_5_0",
-		compileFlags, 0, &pixelShader, nullptr));
+PipelineStateFuture LightingPass::CreatePipelineStateObject(const char* pixelShaderName, uint32_t permutationKey)
+{
+	const D3D12_SHADER_BYTECODE vertexShader = m_shaderCache->GetShader("LightingPass_vs");
+	const D3D12_SHADER_BYTECODE pixelShader = m_shaderCache->GetShader(pixelShaderName, permutationKey);
 
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
 
 	psoDesc.InputLayout = { nullptr, 0 };
 	psoDesc.pRootSignature = m_rootSignature.Get();
-	psoDesc.VS = { static_cast<uint8_t*>(vertexShader->GetBufferPointer()), vertexShader->GetBufferSize() };
-	psoDesc.PS = { static_cast<uint8_t*>(pixelShader->GetBufferPointer()), pixelShader->GetBufferSize() };
+	psoDesc.VS = vertexShader;
+	psoDesc.PS = pixelShader;
 
 	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
 	psoDesc.RasterizerState.FrontCounterClockwise = true;
@@ -185,7 +285,8 @@ void LightingPass::CreatePipelineStateObject(ID3D12Device* device)
 	psoDesc.DepthStencilState.DepthEnable = false;
 	psoDesc.DepthStencilState.StencilEnable = true;
 	psoDesc.DepthStencilState.StencilReadMask = 0xff;
-	psoDesc.DepthStencilState.StencilWriteMask = 0xff;
+	// Depth stencil is bound read only
+	psoDesc.DepthStencilState.StencilWriteMask = 0;
 	psoDesc.DepthStencilState.FrontFace.StencilFunc = D3D12_COMPARISON_FUNC_EQUAL;
 	psoDesc.DepthStencilState.FrontFace.StencilPassOp = D3D12_STENCIL_OP_KEEP;
 	psoDesc.DepthStencilState.FrontFace.StencilFailOp = D3D12_STENCIL_OP_KEEP;
@@ -203,5 +304,5 @@ void LightingPass::CreatePipelineStateObject(ID3D12Device* device)
 	psoDesc.RTVFormats[0] = kSwapChainFormat;
 	psoDesc.SampleDesc.Count = 1;
 
-	DxVerify(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_pipelineStateObject)));
+	return m_pipelineStateCache->CreateGraphicsPipelineStateAsync(psoDesc, m_rootSignatureHash);
 }
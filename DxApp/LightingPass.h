@@ -1,40 +1,91 @@
 #pragma once
 
 #include <stdint.h>
+#include <unordered_map>
 #include <d3d12.h>
 #include <d3dx12.h>
 #include <dxgi1_4.h>
 #include <wrl.h>
 
+#include "GBuffer.h"
+#include "LightingPermutation.h"
+#include "PipelineStateCache.h"
+
 
 class Scene;
-class GBuffer;
+class LightSources;
+class ShaderCache;
+
+
+// Order matches the DEBUG_VIEW_* group of LightingPassDebug_ps in ShaderList.txt
+enum class LightingDebugView : uint32_t
+{
+	None,
+	SurfaceColor,
+	Normal,
+	Roughness,
+	Metalness,
+	Count
+};
+
 
 class LightingPass
 {
 public:
 	LightingPass() = default;
-	explicit LightingPass(ID3D12Device* device);
-	void Initialize(ID3D12Device* device);
+	explicit LightingPass(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache,
+		GBufferMode gBufferMode);
+	// PSOs are created asynchronously. Until the PSO of a new permutation is ready Setup binds the superset variant
+	// of the falloff, created here, the first Setup waits for it. Caches have to outlive the pass.
+	void Initialize(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache,
+		GBufferMode gBufferMode);
 	~LightingPass() = default;
 
 	void SetScene(Scene* scene);
-	void SetupRootResourceDescriptors(ID3D12Device* device, CD3DX12_CPU_DESCRIPTOR_HANDLE rootParameters, D3D12_GPU_VIRTUAL_ADDRESS dataAddress, const GBuffer& gBuffer) const;
-	void UpdateRootResources(uint8_t* cbData) const;
+	void SetFalloff(LightFalloff falloff);
+	void SetDebugView(LightingDebugView debugView);
+	[[nodiscard]] LightingDebugView GetDebugView() const { return m_debugView; }
+	// Picks the shader variant for the current light sources, has to be called before Setup when lights change
+	void UpdatePermutation();
+	// depthStencil is read in GBufferMode::Compact, it has to be in a shader resource state during Draw
+	void SetupRootResourceDescriptors(ID3D12Device* device, CD3DX12_CPU_DESCRIPTOR_HANDLE rootParameters, D3D12_GPU_VIRTUAL_ADDRESS dataAddress, const GBuffer& gBuffer,
+		ID3D12Resource* depthStencil) const;
+	void UpdateRootResources(uint8_t* cbData, float appAspect) const;
 	void Setup(ID3D12GraphicsCommandList* commandList) const;
 	void Draw(ID3D12GraphicsCommandList* commandList, CD3DX12_GPU_DESCRIPTOR_HANDLE rootParameters) const;
 
 	[[nodiscard]] uint32_t GetDescriptorTablesDescriptorsCount() const;
 	[[nodiscard]] uint32_t GetRootResourcesSize() const;
 
+	// Permutation key bits of LightingPass_ps, resolved from the shader layout by their defines
+	using PermutationKeys = LightingPermutation::Keys;
+
+	// See LightingPermutation::SelectKey and GetSupersetKey
+	static uint32_t SelectPermutationKey(const PermutationKeys& keys, const LightSources& lightSources,
+		LightFalloff falloff, GBufferMode gBufferMode);
+	static uint32_t GetSupersetPermutationKey(const PermutationKeys& keys, LightFalloff falloff,
+		GBufferMode gBufferMode);
+
 private:
 	Microsoft::WRL::ComPtr<ID3D12RootSignature> m_rootSignature;
-	Microsoft::WRL::ComPtr<ID3D12PipelineState> m_pipelineStateObject;
+	uint64_t m_rootSignatureHash = 0;
 	Scene* m_scene = nullptr;
 
+	ShaderCache* m_shaderCache = nullptr;
+	PipelineStateCache* m_pipelineStateCache = nullptr;
+	PermutationKeys m_permutationKeys;
+	GBufferMode m_gBufferMode = GBufferMode::Standard;
+	LightFalloff m_falloff = LightFalloff::Square;
+	LightingDebugView m_debugView = LightingDebugView::None;
+	uint32_t m_permutationKey = 0;
+	std::unordered_map<uint32_t, PipelineStateFuture> m_pipelineStateObjects;
+	// LightingPassDebug_ps variants, created on the first use
+	PipelineStateFuture m_debugViewPipelineStateObjects[static_cast<uint32_t>(LightingDebugView::Count)];
+
 	uint32_t m_cbvSrvUavDescriptorSize = 0;
 
 	void CreateRootSignature(ID3D12Device* device);
-	void CreatePipelineStateObject(ID3D12Device* device);
+	void ResolvePermutationKeys();
+	PipelineStateFuture CreatePipelineStateObject(const char* pixelShaderName, uint32_t permutationKey);
 };
 
@@ -0,0 +1,55 @@
+#include "LightingPermutation.h"
+
+#include "LightSources.h"
+#include "ShaderPermutationLayout.h"
+
+
+namespace LightingPermutation
+{
+	Keys ResolveKeys(const ShaderPermutationLayout& layout)
+	{
+		const auto getKey = [&layout](std::string_view define) {
+			return layout.HasDefine(define) ? layout.GetDefineKey(define) : 0;
+		};
+
+		Keys keys;
+		keys.directionalLights = getKey("DIRECTIONAL_LIGHTS");
+		keys.pointLights = getKey("POINT_LIGHTS");
+		keys.spotLights = getKey("SPOT_LIGHTS");
+		keys.linearFalloff = getKey("LINEAR_FALOFF");
+		keys.compactGBuffer = getKey("COMPACT_GBUFFER");
+		return keys;
+	}
+
+
+	uint32_t SelectKey(const Keys& keys, const LightSources& lightSources, LightFalloff falloff,
+		bool isCompactGBuffer)
+	{
+		uint32_t key = isCompactGBuffer ? keys.compactGBuffer : 0;
+		if (lightSources.GetDirectionalLightSourcesCount() > 0)
+			key |= keys.directionalLights;
+		if (lightSources.GetPointLightSourcesCount() > 0)
+			key |= keys.pointLights;
+		if (lightSources.GetSpotLightSourcesCount() > 0)
+			key |= keys.spotLights;
+
+		// Falloff only matters for the lights with a position
+		const bool hasAttenuatedLights = lightSources.GetPointLightSourcesCount() > 0
+			|| lightSources.GetSpotLightSourcesCount() > 0;
+		if (falloff == LightFalloff::Linear && hasAttenuatedLights)
+			key |= keys.linearFalloff;
+
+		return key;
+	}
+
+
+	uint32_t GetSupersetKey(const Keys& keys, LightFalloff falloff, bool isCompactGBuffer)
+	{
+		uint32_t key = keys.directionalLights | keys.pointLights | keys.spotLights;
+		if (isCompactGBuffer)
+			key |= keys.compactGBuffer;
+		if (falloff == LightFalloff::Linear)
+			key |= keys.linearFalloff;
+		return key;
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+
+
+class LightSources;
+class ShaderPermutationLayout;
+
+
+enum class LightFalloff : uint32_t
+{
+	Square,
+	Linear
+};
+
+
+// Permutation keys of the lighting shaders, chosen from the light sources of the scene.
+// Without D3D, the lighting passes resolve the keys from their shader layouts and pick the variants here.
+namespace LightingPermutation
+{
+	// Key bits of the lighting defines, 0 for the ones a shader does not have
+	struct Keys
+	{
+		uint32_t directionalLights = 0;
+		uint32_t pointLights = 0;
+		uint32_t spotLights = 0;
+		uint32_t linearFalloff = 0;
+		uint32_t compactGBuffer = 0;
+	};
+
+	// Defines of LightingPass_ps, see Shaders/ShaderList.txt. Other lighting shaders have a part of them.
+	Keys ResolveKeys(const ShaderPermutationLayout& layout);
+
+	// Smallest variant that lights all the sources
+	uint32_t SelectKey(const Keys& keys, const LightSources& lightSources, LightFalloff falloff,
+		bool isCompactGBuffer);
+	// Variant lighting every source type, a valid stand-in for any key of SelectKey with the same falloff
+	uint32_t GetSupersetKey(const Keys& keys, LightFalloff falloff, bool isCompactGBuffer);
+}
@@ -0,0 +1,264 @@
+#include "ObjectTransforms.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <new>
+#include <random>
+
+#include "CpuFeatures.h"
+#if defined(CPU_FEATURES_X86)
+#include <immintrin.h>
+#endif
+#include "Shaders/Shared/SceneObjectData.h"
+
+
+using namespace SimdMath;
+using ShaderInterop::SceneObjectData;
+
+
+namespace ObjectTransforms
+{
+	namespace
+	{
+		double GetMilliseconds(std::chrono::high_resolution_clock::time_point startTime)
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime)
+				.count();
+		}
+
+		void WriteScalar(const Transforms& models, uint32_t first, uint32_t count, const Float4x4& view,
+			const Float4x4& projection, const Float4x4& vp, uint8_t* destination, uint32_t stride)
+		{
+			const Matrix vpMatrix = LoadFloat4x4(vp);
+			for (uint32_t i = first; i < count; i++)
+			{
+				auto& data = *new (destination + static_cast<size_t>(i) * stride) SceneObjectData;
+				data.model = models.Get(i);
+				data.view = view;
+				data.projection = projection;
+				data.vp = vp;
+				StoreFloat4x4(data.mvp, MatrixMultiply(LoadFloat4x4(data.model), vpMatrix));
+			}
+		}
+
+#if defined(CPU_FEATURES_X86)
+CPU_FEATURES_TARGET_BEGIN("avx2")
+		// Lane j of rows[i] to lane i of rows[j]
+		void Transpose8x8(__m256 (&rows)[8])
+		{
+			__m256 pairs[8];
+			for (uint32_t i = 0; i < 8; i += 2)
+			{
+				pairs[i] = _mm256_unpacklo_ps(rows[i], rows[i + 1]);
+				pairs[i + 1] = _mm256_unpackhi_ps(rows[i], rows[i + 1]);
+			}
+			__m256 quads[8];
+			for (uint32_t i = 0; i < 8; i += 4)
+			{
+				quads[i] = _mm256_shuffle_ps(pairs[i], pairs[i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+				quads[i + 1] = _mm256_shuffle_ps(pairs[i], pairs[i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+				quads[i + 2] = _mm256_shuffle_ps(pairs[i + 1], pairs[i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+				quads[i + 3] = _mm256_shuffle_ps(pairs[i + 1], pairs[i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+			}
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				rows[i] = _mm256_permute2f128_ps(quads[i], quads[i + 4], 0x20);
+				rows[i + 4] = _mm256_permute2f128_ps(quads[i], quads[i + 4], 0x31);
+			}
+		}
+
+		// Lane j of elements[e] is element e of the matrix of object j, streamed to offset of the 8 objects
+		void StreamMatrices(const __m256 (&elements)[16], uint8_t* destination, uint32_t stride, size_t offset)
+		{
+			__m256 low[8];
+			__m256 high[8];
+			std::copy(elements, elements + 8, low);
+			std::copy(elements + 8, elements + 16, high);
+			Transpose8x8(low);
+			Transpose8x8(high);
+			for (uint32_t j = 0; j < 8; j++)
+			{
+				auto* matrix = reinterpret_cast<float*>(destination + static_cast<size_t>(j) * stride + offset);
+				_mm256_stream_ps(matrix, low[j]);
+				_mm256_stream_ps(matrix + 8, high[j]);
+			}
+		}
+
+		// Returns the written objects count, a multiple of 8
+		uint32_t WriteAvx2(const Transforms& models, uint32_t count, const Float4x4& view,
+			const Float4x4& projection, const Float4x4& vp, uint8_t* destination, uint32_t stride)
+		{
+			// The same for every object, two halves of every matrix
+			const Float4x4* constants[] = { &view, &projection, &vp };
+			const size_t constantOffsets[] = {
+				offsetof(SceneObjectData, view), offsetof(SceneObjectData, projection), offsetof(SceneObjectData, vp)
+			};
+			__m256 constantHalves[3][2];
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				constantHalves[c][0] = _mm256_loadu_ps(&constants[c]->m[0][0]);
+				constantHalves[c][1] = _mm256_loadu_ps(&constants[c]->m[2][0]);
+			}
+			__m256 vpElements[16];
+			for (uint32_t e = 0; e < 16; e++)
+				vpElements[e] = _mm256_set1_ps(vp.m[e / 4][e % 4]);
+
+			const uint32_t vectorCount = count & ~7u;
+			for (uint32_t first = 0; first < vectorCount; first += 8)
+			{
+				uint8_t* objects = destination + static_cast<size_t>(first) * stride;
+
+				__m256 model[16];
+				for (uint32_t e = 0; e < 16; e++)
+					model[e] = _mm256_loadu_ps(models.GetElements(e) + first);
+
+				// Row r of the model times the view projection, in the order of SimdMath::Vector4Transform
+				__m256 mvp[16];
+				for (uint32_t r = 0; r < 4; r++)
+				{
+					for (uint32_t c = 0; c < 4; c++)
+					{
+						__m256 value = _mm256_mul_ps(model[r * 4], vpElements[c]);
+						value = _mm256_add_ps(value, _mm256_mul_ps(model[r * 4 + 1], vpElements[4 + c]));
+						value = _mm256_add_ps(value, _mm256_mul_ps(model[r * 4 + 2], vpElements[8 + c]));
+						mvp[r * 4 + c] = _mm256_add_ps(value, _mm256_mul_ps(model[r * 4 + 3], vpElements[12 + c]));
+					}
+				}
+
+				StreamMatrices(model, objects, stride, offsetof(SceneObjectData, model));
+				StreamMatrices(mvp, objects, stride, offsetof(SceneObjectData, mvp));
+				for (uint32_t j = 0; j < 8; j++)
+				{
+					uint8_t* object = objects + static_cast<size_t>(j) * stride;
+					for (uint32_t c = 0; c < 3; c++)
+					{
+						auto* matrix = reinterpret_cast<float*>(object + constantOffsets[c]);
+						_mm256_stream_ps(matrix, constantHalves[c][0]);
+						_mm256_stream_ps(matrix + 8, constantHalves[c][1]);
+					}
+				}
+			}
+			// Orders the streamed stores before the following ones, the GPU reads after the Unmap
+			_mm_sfence();
+			return vectorCount;
+		}
+CPU_FEATURES_TARGET_END
+#endif
+	}
+
+
+	Kernel GetSupportedKernel()
+	{
+		// Every CPU with AVX-512 has AVX2
+		return CpuFeatures::GetSupportedInstructionSet() >= CpuFeatures::InstructionSet::Avx2
+			? Kernel::Avx2
+			: Kernel::Scalar;
+	}
+
+
+	const char* GetName(Kernel kernel)
+	{
+		return kernel == Kernel::Avx2 ? "AVX2" : "scalar";
+	}
+
+
+	void Transforms::Resize(uint32_t count)
+	{
+		for (auto& elements : m_elements)
+			elements.resize(count);
+	}
+
+
+	void Transforms::Set(uint32_t index, const Float4x4& model)
+	{
+		for (uint32_t e = 0; e < 16; e++)
+			m_elements[e][index] = model.m[e / 4][e % 4];
+	}
+
+
+	Float4x4 Transforms::Get(uint32_t index) const
+	{
+		Float4x4 model;
+		for (uint32_t e = 0; e < 16; e++)
+			model.m[e / 4][e % 4] = m_elements[e][index];
+		return model;
+	}
+
+
+	void WriteObjectData(const Transforms& models, uint32_t count, const Float4x4& view, const Float4x4& projection,
+		uint8_t* destination, uint32_t stride, Kernel kernel)
+	{
+		assert(count <= models.GetCount());
+		kernel = std::min(kernel, GetSupportedKernel());
+
+		Float4x4 vp;
+		StoreFloat4x4(vp, MatrixMultiply(LoadFloat4x4(view), LoadFloat4x4(projection)));
+
+		uint32_t writtenCount = 0;
+#if defined(CPU_FEATURES_X86)
+		if (kernel == Kernel::Avx2)
+			writtenCount = WriteAvx2(models, count, view, projection, vp, destination, stride);
+#endif
+		WriteScalar(models, writtenCount, count, view, projection, vp, destination, stride);
+	}
+
+
+	BenchmarkReport Benchmark(uint32_t objectsCount)
+	{
+		constexpr uint32_t kRepeatsCount = 16;
+
+		std::mt19937 generator(0);
+		std::uniform_real_distribution<float> positionDistribution(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> scaleDistribution(0.1f, 10.0f);
+		std::uniform_real_distribution<float> angleDistribution(0.0f, k2Pi);
+
+		Transforms models;
+		models.Resize(objectsCount);
+		for (uint32_t i = 0; i < objectsCount; i++)
+		{
+			const Matrix model = MatrixScaling(scaleDistribution(generator), scaleDistribution(generator),
+				scaleDistribution(generator)) * MatrixRotationY(angleDistribution(generator))
+				* MatrixTranslation(positionDistribution(generator), positionDistribution(generator),
+					positionDistribution(generator));
+			Float4x4 value;
+			StoreFloat4x4(value, model);
+			models.Set(i, value);
+		}
+
+		Float4x4 view;
+		Float4x4 projection;
+		StoreFloat4x4(view, MatrixLookAtRH(VectorSet(-150.0f, 50.0f, 20.0f, 1.0f), VectorZero(),
+			VectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+		StoreFloat4x4(projection, MatrixPerspectiveFovRH(ConvertToRadians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f));
+
+		// Aligned as the constant buffers
+		const uint32_t stride = SceneObjectData::GetAlignedSize();
+		std::vector<uint8_t> buffer(static_cast<size_t>(objectsCount) * stride + stride);
+		uint8_t* output = buffer.data() + (stride - reinterpret_cast<uintptr_t>(buffer.data()) % stride);
+
+		BenchmarkReport report;
+		report.objectsCount = objectsCount;
+		for (uint32_t k = 0; k < static_cast<uint32_t>(Kernel::Count); k++)
+		{
+			const auto kernel = static_cast<Kernel>(k);
+			auto& result = report.results[k];
+			result.isSupported = kernel <= GetSupportedKernel();
+			if (!result.isSupported)
+				continue;
+
+			double bestMilliseconds = 0.0;
+			for (uint32_t repeat = 0; repeat < kRepeatsCount; repeat++)
+			{
+				const auto startTime = std::chrono::high_resolution_clock::now();
+				WriteObjectData(models, objectsCount, view, projection, output, stride, kernel);
+				const double milliseconds = GetMilliseconds(startTime);
+				bestMilliseconds = repeat == 0 ? milliseconds : std::min(bestMilliseconds, milliseconds);
+			}
+			result.objectsPerMillisecond = objectsCount / std::max(bestMilliseconds, 1e-6);
+		}
+		return report;
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "SimdMath.h"
+
+
+// Model matrices of the scene objects as structures of arrays, one array per matrix element, and the kernels
+// writing the per object constant buffers of the geometry pass from them. The AVX2 kernel multiplies the model
+// matrices of 8 objects by the view projection at a time and streams the constant buffers to the upload memory
+// with non-temporal stores, the tail and the CPUs without AVX2 use SimdMath one object at a time.
+namespace ObjectTransforms
+{
+	enum class Kernel : uint32_t
+	{
+		Scalar,
+		Avx2,
+		Count
+	};
+
+	// Widest kernel the CPU and the OS support, detected once
+	Kernel GetSupportedKernel();
+	const char* GetName(Kernel kernel);
+
+	class Transforms
+	{
+	public:
+		void Resize(uint32_t count);
+		uint32_t GetCount() const { return static_cast<uint32_t>(m_elements[0].size()); }
+
+		void Set(uint32_t index, const SimdMath::Float4x4& model);
+		SimdMath::Float4x4 Get(uint32_t index) const;
+		// Element row * 4 + column of every matrix
+		const float* GetElements(uint32_t element) const { return m_elements[element].data(); }
+
+	private:
+		std::vector<float> m_elements[16];
+	};
+
+	// Writes the ShaderInterop::SceneObjectData of the first count models, stride bytes apart: destination fits
+	// count objects, count is at most the models count. destination and stride are 32 byte aligned. The memory
+	// is only written, as the write-combined upload heaps want.
+	// Kernels the CPU does not support fall back to the supported one.
+	void WriteObjectData(const Transforms& models, uint32_t count, const SimdMath::Float4x4& view,
+		const SimdMath::Float4x4& projection, uint8_t* destination, uint32_t stride,
+		Kernel kernel = GetSupportedKernel());
+
+	struct BenchmarkReport
+	{
+		struct Result
+		{
+			bool isSupported = false;
+			// One thread
+			double objectsPerMillisecond = 0.0;
+		};
+
+		uint32_t objectsCount = 0;
+		Result results[static_cast<uint32_t>(Kernel::Count)];
+	};
+
+	// Random scale, rotation and translation models written to cached memory with every supported kernel.
+	// Timing only, ObjectTransformsTests.cpp checks the written data.
+	BenchmarkReport Benchmark(uint32_t objectsCount);
+}
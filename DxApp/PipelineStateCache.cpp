@@ -0,0 +1,196 @@
+#include "PipelineStateCache.h"
+
+#include <filesystem>
+#include <fstream>
+
+#include "DxHelpers.h"
+
+
+using namespace Microsoft::WRL;
+
+
+PipelineStateCache::~PipelineStateCache()
+{
+	Save();
+}
+
+
+void PipelineStateCache::Initialize(ID3D12Device* device, const std::string& libraryPath)
+{
+	m_device = device;
+	m_libraryPath = libraryPath;
+
+	ComPtr<ID3D12Device1> device1;
+	if (SUCCEEDED(m_device.As(&device1)))
+		ReadLibrary(device1.Get());
+}
+
+
+void PipelineStateCache::Save()
+{
+	std::vector<PipelineStateFuture> pendingPipelineStates;
+	{
+		std::lock_guard lock(m_mutex);
+		pendingPipelineStates.swap(m_pendingPipelineStates);
+	}
+	for (auto& pipelineState : pendingPipelineStates)
+		pipelineState.wait();
+
+	std::lock_guard lock(m_mutex);
+	if (!m_library || !m_keys.IsDirty())
+		return;
+
+	std::vector<uint8_t> data(m_library->GetSerializedSize());
+	DxVerify(m_library->Serialize(data.data(), data.size()));
+
+	std::filesystem::create_directories(std::filesystem::path(m_libraryPath).parent_path());
+	std::ofstream file(m_libraryPath, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+	m_keys.OnSaved();
+}
+
+
+PipelineStateFuture PipelineStateCache::CreateGraphicsPipelineStateAsync(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+	uint64_t rootSignatureHash)
+{
+	const uint64_t hash = HashGraphicsPipelineDesc(desc, rootSignatureHash);
+
+	PipelineStateFuture pipelineState = m_workers.Submit([this, desc, hash]() {
+		return CreateGraphicsPipelineState(desc, hash);
+	}).share();
+
+	std::lock_guard lock(m_mutex);
+	m_pendingPipelineStates.push_back(pipelineState);
+
+	return pipelineState;
+}
+
+
+PipelineStateFuture PipelineStateCache::CreateComputePipelineStateAsync(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc,
+	uint64_t rootSignatureHash)
+{
+	const uint64_t hash = HashComputePipelineDesc(desc, rootSignatureHash);
+
+	PipelineStateFuture pipelineState = m_workers.Submit([this, desc, hash]() {
+		return CreateComputePipelineState(desc, hash);
+	}).share();
+
+	std::lock_guard lock(m_mutex);
+	m_pendingPipelineStates.push_back(pipelineState);
+
+	return pipelineState;
+}
+
+
+PipelineStateCache::Statistics PipelineStateCache::GetStatistics() const
+{
+	std::lock_guard lock(m_mutex);
+	return m_keys.GetStatistics();
+}
+
+
+uint64_t PipelineStateCache::HashRootSignature(const void* serializedRootSignature, size_t size)
+{
+	return PipelineStateKey::HashRootSignature(serializedRootSignature, size);
+}
+
+
+uint64_t PipelineStateCache::HashGraphicsPipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+	uint64_t rootSignatureHash)
+{
+	return PipelineStateKey::HashGraphicsDesc(desc, rootSignatureHash);
+}
+
+
+uint64_t PipelineStateCache::HashComputePipelineDesc(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc,
+	uint64_t rootSignatureHash)
+{
+	return PipelineStateKey::HashComputeDesc(desc, rootSignatureHash);
+}
+
+
+void PipelineStateCache::ReadLibrary(ID3D12Device1* device)
+{
+	std::ifstream file(m_libraryPath, std::ios::binary | std::ios::ate);
+	if (file)
+	{
+		m_libraryData.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(m_libraryData.data()), static_cast<std::streamsize>(m_libraryData.size()));
+
+		// Fails after a driver or adapter change, start from an empty library then
+		if (FAILED(device->CreatePipelineLibrary(m_libraryData.data(), m_libraryData.size(), IID_PPV_ARGS(&m_library))))
+			m_libraryData.clear();
+	}
+
+	if (!m_library)
+	{
+		DxVerify(device->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&m_library)));
+	}
+}
+
+
+ComPtr<ID3D12PipelineState> PipelineStateCache::CreateGraphicsPipelineState(
+	const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t hash)
+{
+	ComPtr<ID3D12PipelineState> pipelineState;
+	const std::wstring name = PipelineStateKey::GetName(hash);
+
+	if (LoadPipelineState(hash, [&](ID3D12PipelineLibrary* library) {
+		return library->LoadGraphicsPipeline(name.c_str(), &desc, IID_PPV_ARGS(&pipelineState));
+	}))
+	{
+		return pipelineState;
+	}
+
+	DxVerify(m_device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pipelineState)));
+	OnPipelineStateCreated(pipelineState.Get(), hash, name);
+
+	return pipelineState;
+}
+
+
+ComPtr<ID3D12PipelineState> PipelineStateCache::CreateComputePipelineState(
+	const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, uint64_t hash)
+{
+	ComPtr<ID3D12PipelineState> pipelineState;
+	const std::wstring name = PipelineStateKey::GetName(hash);
+
+	if (LoadPipelineState(hash, [&](ID3D12PipelineLibrary* library) {
+		return library->LoadComputePipeline(name.c_str(), &desc, IID_PPV_ARGS(&pipelineState));
+	}))
+	{
+		return pipelineState;
+	}
+
+	DxVerify(m_device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&pipelineState)));
+	OnPipelineStateCreated(pipelineState.Get(), hash, name);
+
+	return pipelineState;
+}
+
+
+bool PipelineStateCache::LoadPipelineState(uint64_t hash,
+	const std::function<HRESULT(ID3D12PipelineLibrary*)>& load)
+{
+	std::lock_guard lock(m_mutex);
+	if (!m_library || FAILED(load(m_library.Get())))
+		return false;
+
+	m_keys.OnLoaded(hash);
+	return true;
+}
+
+
+void PipelineStateCache::OnPipelineStateCreated(ID3D12PipelineState* pipelineState, uint64_t hash,
+	const std::wstring& name)
+{
+	std::lock_guard lock(m_mutex);
+	// Storing the same name twice fails, equal descs may be created in parallel
+	if (m_keys.OnCreated(hash) && m_library && pipelineState &&
+		SUCCEEDED(m_library->StorePipeline(name.c_str(), pipelineState)))
+	{
+		m_keys.OnStored();
+	}
+}
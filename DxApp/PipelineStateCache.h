@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <d3d12.h>
+#include <wrl.h>
+
+#include "PipelineStateKey.h"
+#include "WorkerPool.h"
+
+
+using PipelineStateFuture = std::shared_future<Microsoft::WRL::ComPtr<ID3D12PipelineState>>;
+
+
+// Creates PSOs on a fixed pool of worker threads and persists them in an ID3D12PipelineLibrary on disk.
+// PSOs are keyed by a hash of the pipeline description, so a changed shader or state gets a new entry,
+// see PipelineStateKey.
+class PipelineStateCache
+{
+public:
+	static constexpr const char* kDefaultLibraryPath = "ShaderCache/PipelineLibrary.bin";
+
+	using Statistics = PipelineStateKey::Registry::Statistics;
+
+	PipelineStateCache() = default;
+	~PipelineStateCache();
+
+	void Initialize(ID3D12Device* device, const std::string& libraryPath = kDefaultLibraryPath);
+	// Waits for the pending PSOs and writes the library if anything was added
+	void Save();
+
+	// Pointers inside desc (shaders, input layout, root signature) have to outlive the returned future.
+	// rootSignatureHash identifies desc.pRootSignature, see HashRootSignature.
+	PipelineStateFuture CreateGraphicsPipelineStateAsync(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+		uint64_t rootSignatureHash);
+	PipelineStateFuture CreateComputePipelineStateAsync(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc,
+		uint64_t rootSignatureHash);
+
+	[[nodiscard]] Statistics GetStatistics() const;
+
+	static uint64_t HashRootSignature(const void* serializedRootSignature, size_t size);
+	static uint64_t HashGraphicsPipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash);
+	static uint64_t HashComputePipelineDesc(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash);
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+	// Null if the device does not support pipeline libraries, PSOs are still created in parallel
+	Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> m_library;
+	// Library references this memory for its whole lifetime
+	std::vector<uint8_t> m_libraryData;
+	std::string m_libraryPath;
+
+	// Also guards m_library, its loads and stores are not synchronized
+	mutable std::mutex m_mutex;
+	std::vector<PipelineStateFuture> m_pendingPipelineStates;
+	PipelineStateKey::Registry m_keys;
+	// Last, joined before the members the tasks use are destroyed
+	WorkerPool m_workers;
+
+	void ReadLibrary(ID3D12Device1* device);
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> CreateGraphicsPipelineState(
+		const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t hash);
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> CreateComputePipelineState(
+		const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, uint64_t hash);
+	// Counts a hit if load succeeds, load runs under m_mutex
+	bool LoadPipelineState(uint64_t hash, const std::function<HRESULT(ID3D12PipelineLibrary*)>& load);
+	// Counts the miss and stores the new PSO in the library, once per hash
+	void OnPipelineStateCreated(ID3D12PipelineState* pipelineState, uint64_t hash, const std::wstring& name);
+};
@@ -0,0 +1,50 @@
+#include "PipelineStateKey.h"
+
+#include <cstring>
+
+
+namespace PipelineStateKey
+{
+	void Hasher::AddBytes(const void* data, size_t size)
+	{
+		Add(static_cast<uint64_t>(size));
+		if (size > 0)
+			m_hash = Hash::Fnv1a64(data, size, m_hash);
+	}
+
+
+	void Hasher::AddString(const char* string)
+	{
+		AddBytes(string, string ? std::strlen(string) : 0);
+	}
+
+
+	uint64_t HashRootSignature(const void* serializedRootSignature, size_t size)
+	{
+		return Hash::Fnv1a64(serializedRootSignature, size, Hash::kFnvOffsetBasis);
+	}
+
+
+	std::wstring GetName(uint64_t key)
+	{
+		constexpr wchar_t kDigits[] = L"0123456789abcdef";
+		std::wstring name(16, L'0');
+		for (uint32_t i = 0; i < 16; i++)
+			name[15 - i] = kDigits[(key >> (i * 4)) & 0xf];
+		return name;
+	}
+
+
+	void Registry::OnLoaded(uint64_t key)
+	{
+		m_keys.insert(key);
+		m_statistics.hitsCount++;
+	}
+
+
+	bool Registry::OnCreated(uint64_t key)
+	{
+		m_statistics.missesCount++;
+		return m_keys.insert(key).second;
+	}
+} // namespace PipelineStateKey
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <unordered_set>
+
+#include "Hash.h"
+
+
+// Keys of the PSOs in the pipeline library and the bookkeeping of PipelineStateCache, without D3D.
+// Descriptions are hashed field by field, the state structs have padding. The hash functions are templates over
+// the description: PipelineStateCache instantiates them with the D3D12 structs, the tests with mirrors of them.
+namespace PipelineStateKey
+{
+	// 64-bit FNV-1a over the fields in order
+	class Hasher
+	{
+	public:
+		explicit Hasher(uint64_t rootSignatureHash) { Add(rootSignatureHash); }
+
+		template <typename T>
+		void Add(const T& value)
+		{
+			static_assert(std::is_scalar_v<T>);
+			m_hash = Hash::Fnv1a64(&value, sizeof(T), m_hash);
+		}
+
+		// Sizes are hashed too, so neighbouring fields cannot trade bytes
+		void AddBytes(const void* data, size_t size);
+		// Null hashes as an empty string
+		void AddString(const char* string);
+
+		[[nodiscard]] uint64_t GetHash() const { return m_hash; }
+
+	private:
+		uint64_t m_hash = Hash::kFnvOffsetBasis;
+	};
+
+	template <typename ShaderBytecode>
+	void AddBytecode(Hasher& hasher, const ShaderBytecode& bytecode)
+	{
+		hasher.AddBytes(bytecode.pShaderBytecode, bytecode.pShaderBytecode ? bytecode.BytecodeLength : 0);
+	}
+
+	template <typename DepthStencilOpDesc>
+	void AddDepthStencilOp(Hasher& hasher, const DepthStencilOpDesc& desc)
+	{
+		hasher.Add(desc.StencilFailOp);
+		hasher.Add(desc.StencilDepthFailOp);
+		hasher.Add(desc.StencilPassOp);
+		hasher.Add(desc.StencilFunc);
+	}
+
+	template <typename GraphicsPipelineDesc>
+	uint64_t HashGraphicsDesc(const GraphicsPipelineDesc& desc, uint64_t rootSignatureHash)
+	{
+		Hasher hasher(rootSignatureHash);
+
+		AddBytecode(hasher, desc.VS);
+		AddBytecode(hasher, desc.PS);
+		AddBytecode(hasher, desc.DS);
+		AddBytecode(hasher, desc.HS);
+		AddBytecode(hasher, desc.GS);
+
+		hasher.Add(desc.StreamOutput.NumEntries);
+		for (uint32_t i = 0; i < desc.StreamOutput.NumEntries; i++)
+		{
+			const auto& entry = desc.StreamOutput.pSODeclaration[i];
+			hasher.Add(entry.Stream);
+			hasher.AddString(entry.SemanticName);
+			hasher.Add(entry.SemanticIndex);
+			hasher.Add(entry.StartComponent);
+			hasher.Add(entry.ComponentCount);
+			hasher.Add(entry.OutputSlot);
+		}
+		hasher.Add(desc.StreamOutput.NumStrides);
+		for (uint32_t i = 0; i < desc.StreamOutput.NumStrides; i++)
+			hasher.Add(desc.StreamOutput.pBufferStrides[i]);
+		hasher.Add(desc.StreamOutput.RasterizedStream);
+
+		hasher.Add(desc.BlendState.AlphaToCoverageEnable);
+		hasher.Add(desc.BlendState.IndependentBlendEnable);
+		for (const auto& renderTarget : desc.BlendState.RenderTarget)
+		{
+			hasher.Add(renderTarget.BlendEnable);
+			hasher.Add(renderTarget.LogicOpEnable);
+			hasher.Add(renderTarget.SrcBlend);
+			hasher.Add(renderTarget.DestBlend);
+			hasher.Add(renderTarget.BlendOp);
+			hasher.Add(renderTarget.SrcBlendAlpha);
+			hasher.Add(renderTarget.DestBlendAlpha);
+			hasher.Add(renderTarget.BlendOpAlpha);
+			hasher.Add(renderTarget.LogicOp);
+			hasher.Add(renderTarget.RenderTargetWriteMask);
+		}
+		hasher.Add(desc.SampleMask);
+
+		const auto& rasterizer = desc.RasterizerState;
+		hasher.Add(rasterizer.FillMode);
+		hasher.Add(rasterizer.CullMode);
+		hasher.Add(rasterizer.FrontCounterClockwise);
+		hasher.Add(rasterizer.DepthBias);
+		hasher.Add(rasterizer.DepthBiasClamp);
+		hasher.Add(rasterizer.SlopeScaledDepthBias);
+		hasher.Add(rasterizer.DepthClipEnable);
+		hasher.Add(rasterizer.MultisampleEnable);
+		hasher.Add(rasterizer.AntialiasedLineEnable);
+		hasher.Add(rasterizer.ForcedSampleCount);
+		hasher.Add(rasterizer.ConservativeRaster);
+
+		const auto& depthStencil = desc.DepthStencilState;
+		hasher.Add(depthStencil.DepthEnable);
+		hasher.Add(depthStencil.DepthWriteMask);
+		hasher.Add(depthStencil.DepthFunc);
+		hasher.Add(depthStencil.StencilEnable);
+		hasher.Add(depthStencil.StencilReadMask);
+		hasher.Add(depthStencil.StencilWriteMask);
+		AddDepthStencilOp(hasher, depthStencil.FrontFace);
+		AddDepthStencilOp(hasher, depthStencil.BackFace);
+
+		hasher.Add(desc.InputLayout.NumElements);
+		for (uint32_t i = 0; i < desc.InputLayout.NumElements; i++)
+		{
+			const auto& element = desc.InputLayout.pInputElementDescs[i];
+			hasher.AddString(element.SemanticName);
+			hasher.Add(element.SemanticIndex);
+			hasher.Add(element.Format);
+			hasher.Add(element.InputSlot);
+			hasher.Add(element.AlignedByteOffset);
+			hasher.Add(element.InputSlotClass);
+			hasher.Add(element.InstanceDataStepRate);
+		}
+
+		hasher.Add(desc.IBStripCutValue);
+		hasher.Add(desc.PrimitiveTopologyType);
+		hasher.Add(desc.NumRenderTargets);
+		for (uint32_t i = 0; i < desc.NumRenderTargets; i++)
+			hasher.Add(desc.RTVFormats[i]);
+		hasher.Add(desc.DSVFormat);
+		hasher.Add(desc.SampleDesc.Count);
+		hasher.Add(desc.SampleDesc.Quality);
+		hasher.Add(desc.NodeMask);
+		hasher.Add(desc.Flags);
+
+		return hasher.GetHash();
+	}
+
+	template <typename ComputePipelineDesc>
+	uint64_t HashComputeDesc(const ComputePipelineDesc& desc, uint64_t rootSignatureHash)
+	{
+		Hasher hasher(rootSignatureHash);
+		AddBytecode(hasher, desc.CS);
+		hasher.Add(desc.NodeMask);
+		hasher.Add(desc.Flags);
+		return hasher.GetHash();
+	}
+
+	uint64_t HashRootSignature(const void* serializedRootSignature, size_t size);
+
+	// Name of the PSO in the library, 16 hex digits
+	std::wstring GetName(uint64_t key);
+
+	// Keys loaded from the library or created in this run. Not synchronized, PipelineStateCache locks around it.
+	class Registry
+	{
+	public:
+		struct Statistics
+		{
+			uint32_t hitsCount = 0;
+			uint32_t missesCount = 0;
+		};
+
+		void OnLoaded(uint64_t key);
+		// Counts the miss, returns whether the PSO has to be stored: false if an equal desc was created already
+		bool OnCreated(uint64_t key);
+		// The library has changed since the last save
+		void OnStored() { m_isDirty = true; }
+		void OnSaved() { m_isDirty = false; }
+
+		[[nodiscard]] bool IsKnown(uint64_t key) const { return m_keys.contains(key); }
+		[[nodiscard]] bool IsDirty() const { return m_isDirty; }
+		[[nodiscard]] const Statistics& GetStatistics() const { return m_statistics; }
+
+	private:
+		std::unordered_set<uint64_t> m_keys;
+		Statistics m_statistics;
+		bool m_isDirty = false;
+	};
+} // namespace PipelineStateKey
@@ -6,22 +6,53 @@
 #include <d3d12sdklayers.h>
 #include <d3dx12.h>
 #include <d3dcompiler.h>
-#include <DirectXMath.h>
+#include "SimdMath.h"
 
 #include "DxHelpers.h"
 #include "Ltcs.h"
 #include "Renderer.h"
 
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <chrono>
+#include <format>
+#include <numeric>
 
+#include "ClusteredLightCulling.h"
 #include "GeometryPassObjectConstantBuffer.h"
 #include "RendererForwards.h"
+#include "TiledLightCulling.h"
+#include "VisibilityBuffer.h"
 
 
-using namespace DirectX;
+using namespace SimdMath;
 using namespace Microsoft::WRL;
 
 
+// Depth stencil state while the lighting pass samples depth and tests stencil through a read only view
+static constexpr D3D12_RESOURCE_STATES kDepthReadStates =
+	D3D12_RESOURCE_STATE_DEPTH_READ | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+// Depth stencil state while the tiled lighting reads depth
+static constexpr D3D12_RESOURCE_STATES kDepthComputeReadStates =
+	D3D12_RESOURCE_STATE_DEPTH_READ | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+
+
+struct BenchmarkConfiguration
+{
+	RenderPath renderPath;
+	DepthPrePassMode depthPrePassMode;
+	const char* name;
+};
+
+static constexpr BenchmarkConfiguration kBenchmarkConfigurations[] = {
+	{ RenderPath::Deferred, DepthPrePassMode::Off, "deferred" },
+	{ RenderPath::Deferred, DepthPrePassMode::On, "deferred with depth pre-pass" },
+	{ RenderPath::ClusteredForward, DepthPrePassMode::On, "clustered forward with depth pre-pass" },
+	{ RenderPath::ClusteredForward, DepthPrePassMode::Off, "clustered forward" }
+};
+
+
 //TODO
 
 // add debug light draw
@@ -61,8 +92,10 @@ static void GetHardwareAdapter(IDXGIFactory* factory, IDXGIAdapter** adapter)
 }
 
 
-Renderer::Renderer(HWND hwnd, uint32_t windowWidth, uint32_t windowHeight) : m_windowWidth(windowWidth),
-                                                                             m_windowHeight(windowHeight)
+Renderer::Renderer(HWND hwnd, uint32_t windowWidth, uint32_t windowHeight, GBufferMode gBufferMode,
+	GeometryMode geometryMode, LightingMode lightingMode, bool reportDiagnostics) :
+	m_windowWidth(windowWidth), m_windowHeight(windowHeight), m_reportDiagnostics(reportDiagnostics),
+	m_gBufferMode(gBufferMode), m_geometryMode(geometryMode), m_lightingMode(lightingMode)
 {
 	LoadPipeline(hwnd);
 	LoadAssets();
@@ -74,17 +107,62 @@ Renderer::Renderer(HWND hwnd, uint32_t windowWidth, uint32_t windowHeight) : m_w
 Renderer::~Renderer()
 {
 	WaitForGpu();
+	m_releaseQueue.Flush();
+	m_pipelineStateCache.Save();
+	m_uploadService.Destroy(m_heapAllocator);
 	CloseHandle(m_fenceEvent);
-	m_scene->DestroyRendererResources();
+	for (const auto& superseded : m_supersededScenes)
+		superseded.scene->DestroyRendererResources(m_heapAllocator);
+	if (m_pendingScene && m_pendingScene != m_scene)
+		m_pendingScene->DestroyRendererResources(m_heapAllocator);
+	if (m_scene)
+		m_scene->DestroyRendererResources(m_heapAllocator);
+
+	m_gBuffer.DestroyResources(m_heapAllocator);
+	if (m_geometryMode == GeometryMode::VisibilityBuffer)
+		m_visibilityPass.DestroyResources(m_heapAllocator);
+	if (m_geometryMode == GeometryMode::GBufferIndirect)
+		m_indirectGeometryPass.DestroySceneResources(m_heapAllocator);
+	if (m_lightingMode == LightingMode::TiledCompute)
+		m_tiledLightingPass.DestroyResources(m_heapAllocator);
+	if (m_lightingMode == LightingMode::LightVolumes)
+		m_lightVolumesPass.DestroyResources(m_heapAllocator);
+	m_clusteredForwardPass.DestroyResources(m_heapAllocator);
+	for (uint32_t i = 0; i < kSwapChainBuffersCount; i++)
+	{
+		m_depthStencilResources[i].Reset();
+		m_heapAllocator.Free(m_depthStencilAllocations[i]);
+		m_constantBufferUploadHeaps[i].Reset();
+		m_heapAllocator.Free(m_constantBufferUploadAllocations[i]);
+	}
 }
 
 
 void Renderer::RenderScene(D3D12_VIEWPORT viewport)
 {
+	m_releaseQueue.Process(m_fence->GetCompletedValue());
+	ReleaseSupersededScenes();
+	ActivatePendingScene();
+	ActivatePendingMeshes();
+	m_uploadService.Retire();
+	UpdateRenderPathBenchmark();
+
+	const auto cpuStartTime = std::chrono::high_resolution_clock::now();
+
 	UpdateData(viewport.Width / viewport.Height);
 
 	PopulateCommandList(viewport);
 
+	const int32_t benchmarkConfiguration = m_frameBenchmarkConfigurations[m_frameIndex];
+	if (m_benchmarkConfiguration >= 0 && benchmarkConfiguration >= 0)
+	{
+		auto& result = m_benchmarkResults[benchmarkConfiguration];
+		result.cpuMilliseconds += std::chrono::duration<double, std::chrono::milliseconds::period>(
+			std::chrono::high_resolution_clock::now() - cpuStartTime).count();
+		result.cpuFramesCount++;
+		result.skippedStateCallsCount += m_skippedStateCallsCount;
+	}
+
 	ID3D12CommandList* commandLists[] = {m_commandList.Get()};
 	m_commandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
 
@@ -99,27 +177,78 @@ void Renderer::RenderScene(D3D12_VIEWPORT viewport)
 
 void Renderer::SetScene(Scene* scene)
 {
-	m_scene = scene;
+	if (scene == m_pendingScene)
+		return;
+
+	// A scene replaced before its activation was never used by the frames, only its uploads have to complete
+	if (m_pendingScene)
+		m_supersededScenes.push_back({m_pendingScene, m_pendingSceneUploadFenceValue});
+	m_pendingScene = nullptr;
+	if (scene == m_scene)
+		return;
+
+	// Set again before its release, its uploads are still valid
+	const auto superseded = std::ranges::find(m_supersededScenes, scene, &SupersededScene::scene);
+	if (superseded != m_supersededScenes.end())
+	{
+		m_pendingScene = scene;
+		m_pendingSceneUploadFenceValue = superseded->uploadFenceValue;
+		m_supersededScenes.erase(superseded);
+		return;
+	}
 
-	// Loading mesh data to the GPU
-	DxVerify(m_commandAllocators[m_frameIndex]->Reset());
-	DxVerify(m_commandList->Reset(m_commandAllocators[m_frameIndex].Get(), nullptr));
+	// Loading mesh data to the GPU through the copy queue
+	scene->CreateRendererResources(m_heapAllocator, m_uploadService);
 
-	m_scene->CreateRendererResources(m_device.Get(), m_commandList.Get());
+	m_pendingScene = scene;
+	m_pendingSceneUploadFenceValue = m_uploadService.Flush();
+}
 
-	DxVerify(m_commandList->Close());
 
-	ID3D12CommandList* commandLists[] = {m_commandList.Get()};
-	m_commandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
-	WaitForGpu();
+uint32_t Renderer::AddMesh(SceneObject&& mesh)
+{
+	// Before the first scene is activated there is nothing to add the mesh to
+	assert(m_scene);
+	if (!m_scene)
+		return UINT32_MAX;
+
+	const uint32_t meshIndex = m_scene->AddMesh(std::move(mesh));
+	// New buffers, the frames in flight do not read them
+	m_scene->GetMeshes()[meshIndex].CreateRenderResources(m_heapAllocator, m_uploadService);
+	m_pendingMeshes.push_back({ meshIndex, m_uploadService.Flush() });
+	return meshIndex;
+}
 
-	// Free upload buffers memory
-	m_scene->DestroyUploadResources();
 
-	m_geometryPass.SetScene(m_scene);
-	m_lightingPass.SetScene(m_scene);
+void Renderer::SetLightFalloff(LightFalloff falloff)
+{
+	m_lightingPass.SetFalloff(falloff);
+	if (m_lightingMode == LightingMode::TiledCompute)
+		m_tiledLightingPass.SetFalloff(falloff);
+	if (m_lightingMode == LightingMode::LightVolumes)
+		m_lightVolumesPass.SetFalloff(falloff);
+	m_clusteredForwardPass.SetFalloff(falloff);
+}
 
-	CreateRootDescriptorTableResources();
+
+void Renderer::StartRenderPathBenchmark()
+{
+	if (m_benchmarkConfiguration >= 0)
+		return;
+
+	m_benchmarkRestoreRenderPath = m_renderPath;
+	m_benchmarkRestoreDepthPrePassMode = m_depthPrePassMode;
+	m_benchmarkResults.assign(_countof(kBenchmarkConfigurations), BenchmarkResult());
+	std::fill(std::begin(m_frameBenchmarkConfigurations), std::end(m_frameBenchmarkConfigurations), -1);
+
+	m_benchmarkConfiguration = 0;
+	m_benchmarkFrame = 0;
+}
+
+
+void Renderer::SetLightingDebugView(LightingDebugView debugView)
+{
+	m_lightingPass.SetDebugView(debugView);
 }
 
 
@@ -133,6 +262,7 @@ void Renderer::LoadPipeline(HWND hwnd)
 	DxVerify(CreateDXGIFactory(IID_PPV_ARGS(&factory)));
 
 	CreateDevice(factory.Get());
+	m_heapAllocator.Initialize(m_device.Get());
 	CreateCommandQueue();
 	CreateSwapChain(factory.Get(), hwnd);
 	CreateDescriptorHeaps();
@@ -201,7 +331,7 @@ void Renderer::CreateDescriptorHeaps()
 	m_rtvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
 
 	D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {};
-	dsvHeapDesc.NumDescriptors = kSwapChainBuffersCount;
+	dsvHeapDesc.NumDescriptors = 3 * kSwapChainBuffersCount;
 	dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
 	dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
 	DxVerify(m_device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&m_dsvHeap)));
@@ -226,27 +356,53 @@ void Renderer::CreateFrameResources()
 	}
 
 	// GBuffer 
-	m_gBuffer.CreateResources(m_device.Get(), m_windowWidth, m_windowHeight);
+	m_gBuffer.CreateResources(m_device.Get(), m_heapAllocator, m_gBufferMode, m_windowWidth, m_windowHeight);
+	if (m_reportDiagnostics)
+		ReportGBufferLayout();
+
+	if (m_geometryMode == GeometryMode::VisibilityBuffer)
+		m_visibilityPass.CreateResources(m_device.Get(), m_heapAllocator, m_windowWidth, m_windowHeight);
+	if (m_lightingMode == LightingMode::TiledCompute)
+		m_tiledLightingPass.CreateResources(m_device.Get(), m_heapAllocator, m_windowWidth, m_windowHeight);
+	if (m_lightingMode == LightingMode::LightVolumes)
+		m_lightVolumesPass.CreateResources(m_device.Get(), m_heapAllocator, m_windowWidth, m_windowHeight);
+	m_clusteredForwardPass.CreateResources(m_heapAllocator, kSwapChainBuffersCount, m_windowWidth, m_windowHeight);
 
 	// Depth Stencil
 	{
-		const CD3DX12_HEAP_PROPERTIES dsHeapProperties(D3D12_HEAP_TYPE_DEFAULT);
-		auto dsResourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(kDsFormat, m_windowWidth, m_windowHeight);
+		auto dsResourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(kDsResourceFormat, m_windowWidth, m_windowHeight);
 		dsResourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
 		D3D12_CLEAR_VALUE dsClearValue = {};
 		dsClearValue.Format = kDsFormat;
 		dsClearValue.DepthStencil.Depth = 1.0f;
 		dsClearValue.DepthStencil.Stencil = 0;
 
+		D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+		dsvDesc.Format = kDsFormat;
+		dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
+
+		// Lighting pass tests stencil while it reads depth as a texture
+		D3D12_DEPTH_STENCIL_VIEW_DESC readOnlyDsvDesc = dsvDesc;
+		readOnlyDsvDesc.Flags = D3D12_DSV_FLAG_READ_ONLY_DEPTH | D3D12_DSV_FLAG_READ_ONLY_STENCIL;
+		// Light volumes mark stencil while the compact GBuffer depth is read
+		D3D12_DEPTH_STENCIL_VIEW_DESC readOnlyDepthDsvDesc = dsvDesc;
+		readOnlyDepthDsvDesc.Flags = D3D12_DSV_FLAG_READ_ONLY_DEPTH;
+
 		CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(m_dsvHeap->GetCPUDescriptorHandleForHeapStart());
+		CD3DX12_CPU_DESCRIPTOR_HANDLE readOnlyDsvHandle(dsvHandle, kSwapChainBuffersCount, m_dsvDescriptorSize);
+		CD3DX12_CPU_DESCRIPTOR_HANDLE readOnlyDepthDsvHandle(dsvHandle, 2 * kSwapChainBuffersCount, m_dsvDescriptorSize);
 		for (uint32_t n = 0; n < kSwapChainBuffersCount; n++)
 		{
-			DxVerify(m_device->CreateCommittedResource(&dsHeapProperties, D3D12_HEAP_FLAG_NONE,
-				&dsResourceDesc, D3D12_RESOURCE_STATE_DEPTH_WRITE,
-				&dsClearValue, IID_PPV_ARGS(&m_depthStencilResources[n])));
+			m_depthStencilAllocations[n] = m_heapAllocator.CreateResource(GpuHeapCategory::RenderTargets,
+				dsResourceDesc, D3D12_RESOURCE_STATE_DEPTH_WRITE, &dsClearValue, m_depthStencilResources[n]);
 
-			m_device->CreateDepthStencilView(m_depthStencilResources[n].Get(), nullptr, dsvHandle);
+			m_device->CreateDepthStencilView(m_depthStencilResources[n].Get(), &dsvDesc, dsvHandle);
 			dsvHandle.Offset(1, m_dsvDescriptorSize);
+			m_device->CreateDepthStencilView(m_depthStencilResources[n].Get(), &readOnlyDsvDesc, readOnlyDsvHandle);
+			readOnlyDsvHandle.Offset(1, m_dsvDescriptorSize);
+			m_device->CreateDepthStencilView(m_depthStencilResources[n].Get(), &readOnlyDepthDsvDesc,
+				readOnlyDepthDsvHandle);
+			readOnlyDepthDsvHandle.Offset(1, m_dsvDescriptorSize);
 		}
 
 		for (uint32_t i = 0; i < kSwapChainBuffersCount; i++)
@@ -259,13 +415,121 @@ void Renderer::CreateFrameResources()
 }
 
 
+void Renderer::ReportGBufferLayout() const
+{
+	for (uint32_t i = 0; i < static_cast<uint32_t>(GBufferMode::Count); i++)
+	{
+		const auto mode = static_cast<GBufferMode>(i);
+		OutputDebugStringA(std::format("GBuffer {}{}: {} bytes per pixel + {} depth stencil\n", GBuffer::GetModeName(mode),
+			mode == m_gBufferMode ? " (active)" : "", GBuffer::GetBytesPerPixel(mode), kDsBytesPerPixel).c_str());
+	}
+}
+
+
+void Renderer::ReportTiledLightCulling() const
+{
+	const float aspect = static_cast<float>(m_windowWidth) / static_cast<float>(m_windowHeight);
+	const Float4x4 view = m_scene->GetCamera().GetViewMatrix();
+	const Float4x4 projection = m_scene->GetCamera().GetProjectionMatrix(aspect);
+	const Matrix viewProjectionMatrix = MatrixMultiply(LoadFloat4x4(view), LoadFloat4x4(projection));
+	Float4x4 viewProjection;
+	Float4x4 inverseViewProjection;
+	StoreFloat4x4(viewProjection, viewProjectionMatrix);
+	StoreFloat4x4(inverseViewProjection, MatrixInverse(viewProjectionMatrix));
+
+	// Square falloff, the default one
+	constexpr bool kLinearFalloff = false;
+	constexpr uint32_t kTilesCount = 256;
+	const auto report = TiledLightCulling::Validate(m_scene->GetLightSources(), kLinearFalloff, viewProjection,
+		inverseViewProjection, m_windowWidth, m_windowHeight, kTilesCount);
+	OutputDebugStringA(std::format("Tiled light culling: {} missed lights in {} tiles, {} lights per tile, "
+		"{} reach the tile pixels\n", report.missedLightsCount, report.tilesCount, report.culledLightsCount,
+		report.bruteForceLightsCount).c_str());
+}
+
+
+void Renderer::ReportClusteredLightCulling() const
+{
+	const float aspect = static_cast<float>(m_windowWidth) / static_cast<float>(m_windowHeight);
+	const auto& camera = m_scene->GetCamera();
+
+	// Square falloff, the default one
+	constexpr bool kLinearFalloff = false;
+	constexpr uint32_t kSamplesCount = 65536;
+	const auto report = ClusteredLightCulling::Validate(m_scene->GetLightSources(), kLinearFalloff,
+		camera.GetViewMatrix(), camera.GetProjectionMatrix(aspect), camera.GetNearClipPlane(), camera.GetFarClipPlane(),
+		kSamplesCount);
+	OutputDebugStringA(std::format("Clustered light culling: {} missed lights in {} samples, {} lights per cluster, "
+		"{} of the clusters lit\n", report.missedLightsCount, report.samplesCount, report.lightsPerCluster,
+		report.nonEmptyClustersRatio).c_str());
+}
+
+
+void Renderer::ReportOverdrawEstimate() const
+{
+	const float aspect = static_cast<float>(m_windowWidth) / static_cast<float>(m_windowHeight);
+	std::vector<uint32_t> importOrder(m_drawItems.size());
+	std::iota(importOrder.begin(), importOrder.end(), 0);
+	std::erase_if(importOrder, [&](uint32_t objectIndex) { return !m_scene->IsObjectDrawn(objectIndex); });
+
+	const auto submissionEstimate = EstimateOverdraw(m_submissionOrder, aspect);
+	const auto importEstimate = EstimateOverdraw(importOrder, aspect);
+	const auto cost = DrawOrder::EstimateDepthPrePassCost(submissionEstimate,
+		GBuffer::GetBytesPerPixel(m_gBufferMode), kDsBytesPerPixel, m_windowWidth * m_windowHeight);
+	OutputDebugStringA(std::format("Overdraw estimate: {} in the submission order, {} in the import order, {} of the "
+		"screen covered; depth pre-pass {} MB against {} MB without, {}\n", submissionEstimate.GetOverdraw(),
+		importEstimate.GetOverdraw(),
+		static_cast<float>(submissionEstimate.coveredPixelsCount) / (DrawOrder::kRasterWidth * DrawOrder::kRasterHeight),
+		cost.withPrePass / (1024.0 * 1024.0), cost.withoutPrePass / (1024.0 * 1024.0),
+		cost.PaysOff() ? "pays off" : "does not pay off").c_str());
+}
+
+
+void Renderer::ReportIndirectCulling() const
+{
+	const auto& instances = m_indirectGeometryPass.GetInstances();
+	const uint32_t mismatchesCount = m_indirectGeometryPass.ValidateArguments();
+	OutputDebugStringA(std::format("Indirect culling: {} instances, {} arguments differ from the CPU reference\n",
+		instances.size(), mismatchesCount).c_str());
+}
+
+
 void Renderer::LoadAssets()
 {
-	m_geometryPass.Initialize(m_device.Get());
-	m_lightingPass.Initialize(m_device.Get());
+	m_uploadService.Initialize(m_device.Get(), m_heapAllocator);
+
+	const auto shadersLoadStartTime = std::chrono::high_resolution_clock::now();
+
+	m_shaderCache.Initialize();
+	m_pipelineStateCache.Initialize(m_device.Get());
+	// PSOs are compiled on worker threads while the rest of the renderer is initialized
+	m_geometryPass.Initialize(m_device.Get(), m_shaderCache, m_pipelineStateCache, m_gBufferMode);
+	m_depthPrePass.Initialize(m_device.Get(), m_shaderCache, m_pipelineStateCache);
+	m_lightingPass.Initialize(m_device.Get(), m_shaderCache, m_pipelineStateCache, m_gBufferMode);
+	if (m_geometryMode == GeometryMode::VisibilityBuffer)
+	{
+		m_visibilityPass.Initialize(m_device.Get(), m_shaderCache, m_pipelineStateCache);
+		m_visibilityResolvePass.Initialize(m_device.Get(), m_shaderCache, m_pipelineStateCache, m_gBufferMode);
+	}
+	if (m_geometryMode == GeometryMode::GBufferIndirect)
+		m_indirectGeometryPass.Initialize(m_device.Get(), m_shaderCache, m_pipelineStateCache, m_gBufferMode);
+	if (m_lightingMode == LightingMode::TiledCompute)
+		m_tiledLightingPass.Initialize(m_device.Get(), m_shaderCache, m_pipelineStateCache, m_gBufferMode);
+	if (m_lightingMode == LightingMode::LightVolumes)
+	{
+		m_lightVolumesPass.Initialize(m_device.Get(), m_shaderCache, m_pipelineStateCache, m_gBufferMode);
+		// A few KB, needed by the first frame
+		m_uploadService.WaitForFence(m_lightVolumesPass.CreateMeshes(m_heapAllocator, m_uploadService));
+	}
+	m_clusteredForwardPass.Initialize(m_device.Get(), m_shaderCache, m_pipelineStateCache);
+
+	const auto shadersLoadEndTime = std::chrono::high_resolution_clock::now();
+	OutputDebugString(std::format(L"Shaders load and PSOs dispatch time: {} ms\n",
+		std::chrono::duration<float, std::chrono::milliseconds::period>(shadersLoadEndTime - shadersLoadStartTime).count()).c_str());
 
 	CreateCommandList();
 	CreateSynchronizationResources();
+	m_gpuTimer.Initialize(m_device.Get(), m_commandQueue.Get(), kSwapChainBuffersCount);
 
 	WaitForGpu();
 }
@@ -298,14 +562,172 @@ void Renderer::CopyFrameResourcesToGpu()
 }
 
 
+void Renderer::ReleaseSupersededScenes()
+{
+	std::erase_if(m_supersededScenes, [&](const SupersededScene& superseded) {
+		if (!m_uploadService.IsCompleted(superseded.uploadFenceValue))
+			return false;
+		superseded.scene->ReleaseRendererResources(m_heapAllocator, m_releaseQueue, GetLastSubmittedFenceValue());
+		return true;
+	});
+}
+
+
+void Renderer::ActivatePendingScene()
+{
+	if (!m_pendingScene)
+		return;
+
+	// Keep rendering the current scene until the new one is on the GPU, nothing to render otherwise
+	if (m_scene && !m_uploadService.IsCompleted(m_pendingSceneUploadFenceValue))
+		return;
+
+	m_uploadService.WaitForFence(m_pendingSceneUploadFenceValue);
+
+	// The current scene may be still in use by the frames in flight
+	if (m_scene && m_scene != m_pendingScene)
+		m_scene->ReleaseRendererResources(m_heapAllocator, m_releaseQueue, GetLastSubmittedFenceValue());
+
+	m_scene = m_pendingScene;
+	m_pendingScene = nullptr;
+	// Meshes of the previous scene, released with it
+	m_pendingMeshes.clear();
+
+	m_geometryPass.SetScene(m_scene);
+	m_lightingPass.SetScene(m_scene);
+	m_visibilityResolvePass.SetScene(m_scene);
+
+	m_scene->SetMaxObjectSlotsCount(GetMaxObjectsCount());
+	if (m_scene->GetObjectSlotsCount() > GetMaxObjectsCount())
+	{
+		OutputDebugStringA(std::format("The scene has {} object slots, the geometry mode draws the first {}\n",
+			m_scene->GetObjectSlotsCount(), GetMaxObjectsCount()).c_str());
+	}
+	UpdateObjectsCapacity();
+
+	if (m_lightingMode == LightingMode::TiledCompute)
+	{
+		m_tiledLightingPass.SetScene(m_scene);
+		if (m_reportDiagnostics)
+			ReportTiledLightCulling();
+	}
+	if (m_lightingMode == LightingMode::LightVolumes)
+		m_lightVolumesPass.SetScene(m_scene);
+
+	m_clusteredForwardPass.SetScene(m_scene);
+	if (m_reportDiagnostics)
+		ReportClusteredLightCulling();
+
+	// The new scene is estimated by its first frame
+	m_framesSinceOverdrawEstimate = kOverdrawEstimateInterval;
+	m_drawItems.clear();
+	UpdateDrawOrder(static_cast<float>(m_windowWidth) / static_cast<float>(m_windowHeight));
+	if (m_reportDiagnostics)
+		ReportOverdrawEstimate();
+}
+
+
+void Renderer::ActivatePendingMeshes()
+{
+	std::erase_if(m_pendingMeshes, [&](const PendingMesh& pendingMesh) {
+		if (!m_uploadService.IsCompleted(pendingMesh.uploadFenceValue))
+			return false;
+		// Its objects are in the changed objects of the next Update, the passes pick them up from there
+		m_scene->SetMeshResident(pendingMesh.mesh);
+		return true;
+	});
+}
+
+
+void Renderer::UpdateObjectsCapacity()
+{
+	const uint32_t slotsCount = m_scene->GetObjectSlotsCount();
+	m_objectsCapacity = std::min(slotsCount + std::max(kMinObjectsHeadroom, slotsCount / 2), GetMaxObjectsCount());
+	m_geometryPass.SetObjectsCapacity(m_objectsCapacity);
+	m_visibilityResolvePass.SetObjectsCapacity(m_objectsCapacity);
+
+	// The new tables have the views of every slot, the updates pending for the previous ones are moot
+	CreateRootDescriptorTableResources();
+	m_objectDescriptorMeshes.resize(slotsCount);
+	for (uint32_t slot = 0; slot < slotsCount; slot++)
+		m_objectDescriptorMeshes[slot] = m_scene->IsObjectDrawn(slot) ? m_scene->GetObjectMeshes()[slot] : kNoMesh;
+	for (auto& slots : m_objectDescriptorUpdates)
+		slots.clear();
+
+	if (m_geometryMode == GeometryMode::GBufferIndirect)
+	{
+		m_indirectGeometryPass.ReleaseSceneResources(m_heapAllocator, m_releaseQueue, GetLastSubmittedFenceValue());
+		// Instances are small, needed by the next frame
+		m_uploadService.WaitForFence(m_indirectGeometryPass.CreateSceneResources(m_device.Get(), m_heapAllocator,
+			m_uploadService, m_scene, GeometryPassObjectConstantBuffer::GetAlignedSize(), m_objectsCapacity,
+			kSwapChainBuffersCount));
+		m_indirectValidationPending = m_reportDiagnostics;
+		m_indirectValidationFrameIndex = -1;
+	}
+}
+
+
+uint32_t Renderer::GetMaxObjectsCount() const
+{
+	return m_geometryMode == GeometryMode::VisibilityBuffer ? VisibilityBuffer::kMaxObjectsCount : UINT32_MAX;
+}
+
+
+void Renderer::UpdateObjectDescriptors()
+{
+	if (m_geometryMode != GeometryMode::VisibilityBuffer)
+		return;
+
+	// Moved objects keep their views
+	m_objectDescriptorMeshes.resize(m_scene->GetObjectSlotsCount(), kNoMesh);
+	for (const uint32_t slot : m_scene->GetChangedObjects())
+	{
+		const uint32_t mesh = m_scene->IsObjectDrawn(slot) ? m_scene->GetObjectMeshes()[slot] : kNoMesh;
+		// Past the capacity only for a scene loaded over the limit, those slots are not drawn
+		if (slot >= m_objectsCapacity || m_objectDescriptorMeshes[slot] == mesh)
+			continue;
+		m_objectDescriptorMeshes[slot] = mesh;
+		for (auto& slots : m_objectDescriptorUpdates)
+			slots.push_back(slot);
+	}
+
+	// UpdateToNextFrame waited for the last frame reading these tables
+	auto& slots = m_objectDescriptorUpdates[m_frameIndex];
+	if (slots.empty())
+		return;
+	const CD3DX12_CPU_DESCRIPTOR_HANDLE tables(m_descriptorHeap->GetCPUDescriptorHandleForHeapStart(),
+		m_visibilityResolveTablesOffset + m_frameIndex * m_visibilityResolvePass.GetDescriptorTablesDescriptorsCount(),
+		m_cbvSrvUavDescriptorSize);
+	m_visibilityResolvePass.UpdateObjectDescriptors(m_device.Get(), tables, slots);
+	slots.clear();
+}
+
+
 void Renderer::CreateRootDescriptorTableResources()
 {
 	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
 	heapDesc.NumDescriptors = kSwapChainBuffersCount * m_geometryPass.GetDescriptorTablesDescriptorsCount() + kSwapChainBuffersCount *
 		m_lightingPass.GetDescriptorTablesDescriptorsCount();
+	m_visibilityResolveTablesOffset = heapDesc.NumDescriptors;
+	if (m_geometryMode == GeometryMode::VisibilityBuffer)
+		heapDesc.NumDescriptors += kSwapChainBuffersCount * m_visibilityResolvePass.GetDescriptorTablesDescriptorsCount();
+	m_tiledLightingTablesOffset = heapDesc.NumDescriptors;
+	if (m_lightingMode == LightingMode::TiledCompute)
+		heapDesc.NumDescriptors += kSwapChainBuffersCount * m_tiledLightingPass.GetDescriptorTablesDescriptorsCount();
+	m_lightVolumesTablesOffset = heapDesc.NumDescriptors;
+	if (m_lightingMode == LightingMode::LightVolumes)
+		heapDesc.NumDescriptors += kSwapChainBuffersCount * m_lightVolumesPass.GetDescriptorTablesDescriptorsCount();
+	m_clusteredForwardTablesOffset = heapDesc.NumDescriptors;
+	heapDesc.NumDescriptors += kSwapChainBuffersCount * m_clusteredForwardPass.GetDescriptorTablesDescriptorsCount();
 	// plus one for LightSources CBV
 	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+
+	// Previous heap and constant buffers are released when the frames in flight are done with them
+	const uint64_t lastUsedFenceValue = GetLastSubmittedFenceValue();
+	if (m_descriptorHeap)
+		m_releaseQueue.Enqueue(lastUsedFenceValue, [descriptorHeap = std::move(m_descriptorHeap)]() mutable { descriptorHeap.Reset(); });
+
 	DxVerify(m_device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&m_descriptorHeap)));
 
 	auto descriptorHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_descriptorHeap->GetCPUDescriptorHandleForHeapStart());
@@ -315,15 +737,15 @@ void Renderer::CreateRootDescriptorTableResources()
 	{
 		// Create upload heaps
 		{
-			const auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-			const auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(1024 * 64); // WARNING, hardcoded size
-			DxVerify(m_device->CreateCommittedResource(
-				&heapProperties,
-				D3D12_HEAP_FLAG_NONE,
-				&resourceDesc,
-				D3D12_RESOURCE_STATE_GENERIC_READ,
-				nullptr,
-				IID_PPV_ARGS(&m_constantBufferUploadHeaps[i])));
+			if (m_constantBufferUploadHeaps[i])
+				m_heapAllocator.FreeDeferred(m_releaseQueue, lastUsedFenceValue, m_constantBufferUploadHeaps[i],
+					m_constantBufferUploadAllocations[i]);
+
+			// Object constant buffers of every slot, then the lighting ones
+			const auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(
+				m_geometryPass.GetRootResourcesSize() + m_lightingPass.GetRootResourcesSize());
+			m_constantBufferUploadAllocations[i] = m_heapAllocator.CreateResource(GpuHeapCategory::Upload,
+				resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, m_constantBufferUploadHeaps[i]);
 			m_constantBufferUploadHeaps[i]->SetName(L"Constant Buffer Upload Resource Heap");
 		}
 
@@ -335,14 +757,67 @@ void Renderer::CreateRootDescriptorTableResources()
 	for (uint32_t i = 0; i < kSwapChainBuffersCount; i++)
 	{
 		const auto cbAddress = m_constantBufferUploadHeaps[i]->GetGPUVirtualAddress() + m_geometryPass.GetRootResourcesSize();
-		m_lightingPass.SetupRootResourceDescriptors(m_device.Get(), descriptorHandle, cbAddress, m_gBuffer);
+		m_lightingPass.SetupRootResourceDescriptors(m_device.Get(), descriptorHandle, cbAddress, m_gBuffer,
+			m_depthStencilResources[i].Get());
 		descriptorHandle.Offset(m_lightingPass.GetDescriptorTablesDescriptorsCount(), m_cbvSrvUavDescriptorSize);
 	}
+
+	for (uint32_t i = 0; m_geometryMode == GeometryMode::VisibilityBuffer && i < kSwapChainBuffersCount; i++)
+	{
+		// Resolve pass reads the object matrices from the geometry pass constant buffers
+		m_visibilityResolvePass.SetupRootResourceDescriptors(m_device.Get(), descriptorHandle,
+			m_visibilityPass.GetRt(), m_constantBufferUploadHeaps[i].Get(), m_geometryPass.GetRootResourcesSize());
+		descriptorHandle.Offset(m_visibilityResolvePass.GetDescriptorTablesDescriptorsCount(), m_cbvSrvUavDescriptorSize);
+	}
+
+	for (uint32_t i = 0; m_lightingMode == LightingMode::TiledCompute && i < kSwapChainBuffersCount; i++)
+	{
+		// Same light sources constant buffer as the lighting pass
+		const auto cbAddress = m_constantBufferUploadHeaps[i]->GetGPUVirtualAddress() + m_geometryPass.GetRootResourcesSize();
+		m_tiledLightingPass.SetupRootResourceDescriptors(m_device.Get(), descriptorHandle, cbAddress,
+			m_lightingPass.GetRootResourcesSize(), m_gBuffer, m_depthStencilResources[i].Get());
+		descriptorHandle.Offset(m_tiledLightingPass.GetDescriptorTablesDescriptorsCount(), m_cbvSrvUavDescriptorSize);
+	}
+
+	for (uint32_t i = 0; m_lightingMode == LightingMode::LightVolumes && i < kSwapChainBuffersCount; i++)
+	{
+		const auto cbAddress = m_constantBufferUploadHeaps[i]->GetGPUVirtualAddress() + m_geometryPass.GetRootResourcesSize();
+		m_lightVolumesPass.SetupRootResourceDescriptors(m_device.Get(), descriptorHandle, cbAddress,
+			m_lightingPass.GetRootResourcesSize(), m_gBuffer, m_depthStencilResources[i].Get());
+		descriptorHandle.Offset(m_lightVolumesPass.GetDescriptorTablesDescriptorsCount(), m_cbvSrvUavDescriptorSize);
+	}
+
+	for (uint32_t i = 0; i < kSwapChainBuffersCount; i++)
+	{
+		const auto cbAddress = m_constantBufferUploadHeaps[i]->GetGPUVirtualAddress() + m_geometryPass.GetRootResourcesSize();
+		m_clusteredForwardPass.SetupRootResourceDescriptors(m_device.Get(), descriptorHandle, cbAddress,
+			m_lightingPass.GetRootResourcesSize(), i);
+		descriptorHandle.Offset(m_clusteredForwardPass.GetDescriptorTablesDescriptorsCount(), m_cbvSrvUavDescriptorSize);
+	}
 }
 
 
 void Renderer::UpdateData(float appAspect)
 {
+	// Moved, added and removed objects are passed to the consumers of their transforms, the constant buffers
+	// are all rewritten as they depend on the camera
+	m_scene->Update();
+	// Out of headroom, rare as the headroom grows with the scene. At the limit of the geometry mode the capacity
+	// cannot grow, Scene::AddObject refuses the objects past it.
+	if (m_scene->GetObjectSlotsCount() > m_objectsCapacity && m_objectsCapacity < GetMaxObjectsCount())
+		UpdateObjectsCapacity();
+	else if (m_geometryMode == GeometryMode::GBufferIndirect)
+	{
+		// The frames in flight cull with their own instances, UpdateToNextFrame waited for the last frame reading
+		// the ones of this frame
+		if (m_indirectGeometryPass.UpdateInstances(m_uploadService, m_scene, m_scene->GetChangedObjects(), m_frameIndex))
+			DxVerify(m_commandQueue->Wait(m_uploadService.GetFence(), m_uploadService.Flush()));
+	}
+	UpdateObjectDescriptors();
+
+	UpdateDrawOrder(appAspect);
+
+	// Mapped after UpdateObjectsCapacity, which may replace the buffer
 	uint8_t* cbDataGpu;
 	const auto readRange = CD3DX12_RANGE(0, 0);
 	DxVerify(m_constantBufferUploadHeaps[m_frameIndex]->Map(0, &readRange, reinterpret_cast<void**>(&cbDataGpu)));
@@ -350,13 +825,96 @@ void Renderer::UpdateData(float appAspect)
 	m_geometryPass.UpdateRootResources(cbDataGpu, appAspect);
 	cbDataGpu += m_geometryPass.GetRootResourcesSize();
 
-	m_lightingPass.UpdateRootResources(cbDataGpu);
+	// Light sources may change between frames
+	m_lightingPass.UpdatePermutation();
+	if (m_lightingMode == LightingMode::TiledCompute)
+		m_tiledLightingPass.UpdatePermutation();
+	if (m_lightingMode == LightingMode::LightVolumes)
+		m_lightVolumesPass.UpdatePermutation();
+	m_lightingPass.UpdateRootResources(cbDataGpu, appAspect);
 	cbDataGpu += m_lightingPass.GetRootResourcesSize();
 
+	// Light grid is built on the CPU, only when it is drawn
+	if (m_renderPath == RenderPath::ClusteredForward)
+	{
+		m_clusteredForwardPass.UpdatePermutation();
+		m_clusteredForwardPass.UpdateRootResources(m_frameIndex, appAspect);
+	}
+
 	m_constantBufferUploadHeaps[m_frameIndex]->Unmap(0, nullptr);
 }
 
 
+void Renderer::UpdateDrawOrder(float appAspect)
+{
+	const uint32_t slotsCount = m_scene->GetObjectSlotsCount();
+	const auto updateItem = [&](uint32_t i) {
+		auto& item = m_drawItems[i];
+		const auto& bounds = m_scene->GetObjectBounds()[i];
+		item.boundsMin = bounds.minCorner;
+		item.boundsMax = bounds.maxCorner;
+		item.model = m_scene->GetTransforms().Get(i);
+		item.verticesCount = m_scene->GetMesh(m_scene->GetObjectMeshes()[i]).GetVerticesCount();
+	};
+	// One item per slot. Cleared for a new scene, only the changed and the added slots change otherwise.
+	const uint32_t keptCount = std::min(static_cast<uint32_t>(m_drawItems.size()), slotsCount);
+	m_drawItems.resize(slotsCount);
+	for (uint32_t i = keptCount; i < slotsCount; i++)
+		updateItem(i);
+	for (const uint32_t i : m_scene->GetChangedObjects())
+	{
+		if (i < keptCount)
+			updateItem(i);
+	}
+	const auto& camera = m_scene->GetCamera();
+	const Float4x4 view = camera.GetViewMatrix();
+	DrawOrder::SortFrontToBack(m_drawItems, view, m_drawOrder);
+	std::erase_if(m_drawOrder, [&](uint32_t objectIndex) { return !m_scene->IsObjectDrawn(objectIndex); });
+
+	// Every object uses material 0, see GBufferEncoding.hlsli, and the pipeline of the pass is the same
+	// for every draw. The draws of a mesh end up consecutive, front to back by their depth buckets.
+	m_drawSortItems.resize(m_drawOrder.size());
+	for (uint32_t rank = 0; rank < m_drawOrder.size(); rank++)
+	{
+		const uint32_t objectIndex = m_drawOrder[rank];
+		DrawSortKey::Fields fields;
+		fields.pass = m_renderPath == RenderPath::ClusteredForward ? DrawSortKey::Pass::Forward : DrawSortKey::Pass::Geometry;
+		fields.mesh = m_scene->GetObjectMeshes()[objectIndex];
+		fields.depthBucket = DrawSortKey::QuantizeDepth(DrawOrder::GetViewDepth(m_drawItems[objectIndex], view),
+			camera.GetNearClipPlane(), camera.GetFarClipPlane());
+		m_drawSortItems[rank] = { DrawSortKey::Encode(fields), objectIndex };
+	}
+	m_drawSorter.Sort(m_drawSortItems);
+	m_submissionOrder.resize(m_drawSortItems.size());
+	for (uint32_t i = 0; i < m_drawSortItems.size(); i++)
+		m_submissionOrder[i] = m_drawSortItems[i].drawIndex;
+
+	// The forward path has no GBuffer, its bytes stand for the shading the pre-pass saves
+	if (m_depthPrePassMode == DepthPrePassMode::Auto && ++m_framesSinceOverdrawEstimate >= kOverdrawEstimateInterval)
+	{
+		const auto cost = DrawOrder::EstimateDepthPrePassCost(EstimateOverdraw(m_submissionOrder, appAspect),
+			GBuffer::GetBytesPerPixel(m_gBufferMode), kDsBytesPerPixel, m_windowWidth * m_windowHeight);
+		m_depthPrePassPaysOff = cost.PaysOff();
+		m_framesSinceOverdrawEstimate = 0;
+	}
+
+	const bool hasDepthPrePass = m_renderPath == RenderPath::ClusteredForward
+		|| m_geometryMode == GeometryMode::GBuffer;
+	m_useDepthPrePass = hasDepthPrePass && (m_depthPrePassMode == DepthPrePassMode::On
+		|| (m_depthPrePassMode == DepthPrePassMode::Auto && m_depthPrePassPaysOff));
+}
+
+
+DrawOrder::OverdrawEstimate Renderer::EstimateOverdraw(const std::vector<uint32_t>& order, float appAspect) const
+{
+	const Float4x4 view = m_scene->GetCamera().GetViewMatrix();
+	const Float4x4 projection = m_scene->GetCamera().GetProjectionMatrix(appAspect);
+	Float4x4 viewProjection;
+	StoreFloat4x4(viewProjection, MatrixMultiply(LoadFloat4x4(view), LoadFloat4x4(projection)));
+	return DrawOrder::EstimateOverdraw(m_drawItems, order, viewProjection);
+}
+
+
 void Renderer::PopulateCommandList(D3D12_VIEWPORT viewport)
 {
 	auto* commandList = m_commandList.Get();
@@ -365,32 +923,137 @@ void Renderer::PopulateCommandList(D3D12_VIEWPORT viewport)
 	DxVerify(commandList->Reset(m_commandAllocators[m_frameIndex].Get(), nullptr));
 
 	DxHelper::SetRenderTarget(commandList, viewport);
-	AddGeometryPass(commandList);
-	AddLightingPass(commandList);
-
-	const auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_swapChainRenderTargets[m_frameIndex].Get(),
-	                                                          D3D12_RESOURCE_STATE_RENDER_TARGET,
-	                                                          D3D12_RESOURCE_STATE_PRESENT);
-	commandList->ResourceBarrier(1, &barrier);
+	m_skippedStateCallsCount = 0;
+	m_gpuTimer.Begin(commandList, m_frameIndex);
+	if (m_renderPath == RenderPath::ClusteredForward)
+		AddClusteredForwardPass(commandList);
+	else
+		AddDeferredPasses(commandList);
+	m_gpuTimer.End(commandList, m_frameIndex);
 
 	DxVerify(commandList->Close());
 }
 
 
-void Renderer::AddGeometryPass(ID3D12GraphicsCommandList* commandList)
+void Renderer::AddDeferredPasses(ID3D12GraphicsCommandList* commandList)
 {
-	m_geometryPass.Setup(commandList);
+	if (m_geometryMode == GeometryMode::VisibilityBuffer)
+	{
+		AddVisibilityPass(commandList);
+		AddVisibilityResolvePass(commandList);
+	}
+	else if (m_geometryMode == GeometryMode::GBufferIndirect)
+	{
+		AddIndirectGeometryPass(commandList);
+	}
+	else
+	{
+		AddGeometryPass(commandList);
+	}
+
+	DxHelper::ResourceBarriersArray<3> barriers;
+	uint32_t barriersCount = 0;
+	if (UseTiledLighting())
+	{
+		AddTiledLightingPass(commandList);
+
+		barriers[barriersCount++] = CD3DX12_RESOURCE_BARRIER::Transition(m_swapChainRenderTargets[m_frameIndex].Get(),
+			D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PRESENT);
+		barriers[barriersCount++] = CD3DX12_RESOURCE_BARRIER::Transition(m_tiledLightingPass.GetOutput(),
+			D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		barriers[barriersCount++] = CD3DX12_RESOURCE_BARRIER::Transition(m_depthStencilResources[m_frameIndex].Get(),
+			kDepthComputeReadStates, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+	}
+	else if (UseLightVolumes())
+	{
+		AddLightVolumesPass(commandList);
 
+		barriers[barriersCount++] = CD3DX12_RESOURCE_BARRIER::Transition(m_swapChainRenderTargets[m_frameIndex].Get(),
+			D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+		if (m_gBufferMode == GBufferMode::Compact)
+		{
+			barriers[barriersCount++] = CD3DX12_RESOURCE_BARRIER::Transition(m_depthStencilResources[m_frameIndex].Get(),
+				kDepthReadStates, D3D12_RESOURCE_STATE_DEPTH_WRITE, 0);
+		}
+	}
+	else
+	{
+		AddLightingPass(commandList);
+
+		barriers[barriersCount++] = CD3DX12_RESOURCE_BARRIER::Transition(m_swapChainRenderTargets[m_frameIndex].Get(),
+		                                                                 D3D12_RESOURCE_STATE_RENDER_TARGET,
+		                                                                 D3D12_RESOURCE_STATE_PRESENT);
+		if (m_gBufferMode == GBufferMode::Compact)
+		{
+			barriers[barriersCount++] = CD3DX12_RESOURCE_BARRIER::Transition(m_depthStencilResources[m_frameIndex].Get(),
+				kDepthReadStates, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+		}
+	}
+	commandList->ResourceBarrier(barriersCount, barriers.data());
+}
+
+
+void Renderer::AddClusteredForwardPass(ID3D12GraphicsCommandList* commandList)
+{
 	ID3D12DescriptorHeap* descriptorHeaps[] = {m_descriptorHeap.Get()};
 	commandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 
-	DxHelper::ResourceBarriersArray<GBuffer::kRtCount> barriers;
-	m_gBuffer.AddBarriers(barriers.data(), D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_RENDER_TARGET);
-	commandList->ResourceBarrier(static_cast<uint32_t>(barriers.size()), barriers.data());
+	const auto presentToRtBarrier = CD3DX12_RESOURCE_BARRIER::Transition(m_swapChainRenderTargets[m_frameIndex].Get(),
+		D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	commandList->ResourceBarrier(1, &presentToRtBarrier);
+
+	const auto rtvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_swapChainRtvHeap->GetCPUDescriptorHandleForHeapStart(),
+	                                                     m_frameIndex, m_rtvDescriptorSize);
+	const auto dsvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_dsvHeap->GetCPUDescriptorHandleForHeapStart(),
+	                                                     m_frameIndex,
+	                                                     m_dsvDescriptorSize);
+
+	constexpr float kClearColor[] = {0.0f, 0.0f, 0.0f, 1.0f};
+	commandList->ClearRenderTargetView(rtvHandle, kClearColor, 0, nullptr);
+	constexpr float kClearDepth = 1.0f;
+	commandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, kClearDepth, 0,
+	                                   0, nullptr);
+
+	// Same object constant buffers as the geometry pass
+	auto objectDescriptorTable = CD3DX12_GPU_DESCRIPTOR_HANDLE(m_descriptorHeap->GetGPUDescriptorHandleForHeapStart());
+	objectDescriptorTable.Offset(m_frameIndex * m_geometryPass.GetDescriptorTablesDescriptorsCount(), m_cbvSrvUavDescriptorSize);
+
+	auto descriptorTable = CD3DX12_GPU_DESCRIPTOR_HANDLE(m_descriptorHeap->GetGPUDescriptorHandleForHeapStart());
+	descriptorTable.Offset(m_clusteredForwardTablesOffset + m_frameIndex * m_clusteredForwardPass.GetDescriptorTablesDescriptorsCount(),
+		m_cbvSrvUavDescriptorSize);
+
+	if (m_useDepthPrePass)
+	{
+		commandList->OMSetRenderTargets(0, nullptr, FALSE, &dsvHandle);
+		m_depthPrePass.Setup(commandList);
+		m_skippedStateCallsCount += m_depthPrePass.Draw(commandList, objectDescriptorTable, m_scene, m_drawOrder);
+	}
+
+	commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
+	m_clusteredForwardPass.Setup(commandList);
+	m_skippedStateCallsCount += m_clusteredForwardPass.Draw(commandList, objectDescriptorTable, descriptorTable,
+		m_submissionOrder, m_useDepthPrePass);
 
+	const auto rtToPresentBarrier = CD3DX12_RESOURCE_BARRIER::Transition(m_swapChainRenderTargets[m_frameIndex].Get(),
+		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+	commandList->ResourceBarrier(1, &rtToPresentBarrier);
+}
+
+
+void Renderer::AddGeometryPass(ID3D12GraphicsCommandList* commandList)
+{
+	ID3D12DescriptorHeap* descriptorHeaps[] = {m_descriptorHeap.Get()};
+	commandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+
+	DxHelper::ResourceBarriersArray<GBuffer::kMaxRtCount> barriers;
+	const uint32_t barriersCount = m_gBuffer.AddBarriers(barriers.data(), D3D12_RESOURCE_STATE_GENERIC_READ,
+		D3D12_RESOURCE_STATE_RENDER_TARGET);
+	commandList->ResourceBarrier(barriersCount, barriers.data());
+
+	const uint32_t rtCount = m_gBuffer.GetRtCount();
 	auto rtvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_gBuffer.m_rtvHeap->GetCPUDescriptorHandleForHeapStart());
-	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandles[m_gBuffer.kRtCount];
-	for (uint32_t i = 0; i < m_gBuffer.kRtCount; i++)
+	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandles[GBuffer::kMaxRtCount];
+	for (uint32_t i = 0; i < rtCount; i++)
 	{
 		rtvHandles[i] = rtvHandle;
 		rtvHandle.Offset(1, m_rtvDescriptorSize);
@@ -399,9 +1062,8 @@ void Renderer::AddGeometryPass(ID3D12GraphicsCommandList* commandList)
 	const auto dsvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_dsvHeap->GetCPUDescriptorHandleForHeapStart(),
 	                                                     m_frameIndex,
 	                                                     m_dsvDescriptorSize);
-	commandList->OMSetRenderTargets(m_gBuffer.kRtCount, rtvHandles, FALSE, &dsvHandle);
 
-	for (uint32_t i = 0; i < m_gBuffer.kRtCount; i++)
+	for (uint32_t i = 0; i < rtCount; i++)
 	{
 		constexpr float kClearColor[] = {0.0f, 0.0f, 0.0f, 1.0f};
 		commandList->ClearRenderTargetView(rtvHandles[i], kClearColor, 0, nullptr);
@@ -413,7 +1075,68 @@ void Renderer::AddGeometryPass(ID3D12GraphicsCommandList* commandList)
 	auto cbDescriptorTable = CD3DX12_GPU_DESCRIPTOR_HANDLE(m_descriptorHeap->GetGPUDescriptorHandleForHeapStart());
 	cbDescriptorTable.Offset(m_frameIndex * m_geometryPass.GetDescriptorTablesDescriptorsCount(), m_cbvSrvUavDescriptorSize);
 
-	m_geometryPass.Draw(commandList, cbDescriptorTable, m_scene);
+	// Depth only, the GBuffer is then written once per pixel
+	if (m_useDepthPrePass)
+	{
+		commandList->OMSetRenderTargets(0, nullptr, FALSE, &dsvHandle);
+		m_depthPrePass.Setup(commandList);
+		m_skippedStateCallsCount += m_depthPrePass.Draw(commandList, cbDescriptorTable, m_scene, m_drawOrder);
+	}
+
+	commandList->OMSetRenderTargets(rtCount, rtvHandles, FALSE, &dsvHandle);
+	m_geometryPass.Setup(commandList, m_useDepthPrePass);
+	m_skippedStateCallsCount += m_geometryPass.Draw(commandList, cbDescriptorTable, m_scene, m_submissionOrder);
+}
+
+
+void Renderer::AddIndirectGeometryPass(ID3D12GraphicsCommandList* commandList)
+{
+	const auto& camera = m_scene->GetCamera();
+	const float aspect = static_cast<float>(m_windowWidth) / static_cast<float>(m_windowHeight);
+	const Float4x4 view = camera.GetViewMatrix();
+	const Float4x4 projection = camera.GetProjectionMatrix(aspect);
+	Float4x4 viewProjection;
+	StoreFloat4x4(viewProjection, MatrixMultiply(LoadFloat4x4(view), LoadFloat4x4(projection)));
+
+	// The object constant buffers of the frame start the upload heap, see UpdateData
+	m_indirectGeometryPass.Cull(commandList, InstanceCulling::ExtractFrustum(viewProjection),
+		m_constantBufferUploadHeaps[m_frameIndex]->GetGPUVirtualAddress(), m_frameIndex);
+	if (m_indirectValidationPending)
+	{
+		m_indirectGeometryPass.CopyArgumentsForValidation(commandList);
+		m_indirectValidationPending = false;
+		m_indirectValidationFrameIndex = static_cast<int32_t>(m_frameIndex);
+	}
+
+	DxHelper::ResourceBarriersArray<GBuffer::kMaxRtCount> barriers;
+	const uint32_t barriersCount = m_gBuffer.AddBarriers(barriers.data(), D3D12_RESOURCE_STATE_GENERIC_READ,
+		D3D12_RESOURCE_STATE_RENDER_TARGET);
+	commandList->ResourceBarrier(barriersCount, barriers.data());
+
+	const uint32_t rtCount = m_gBuffer.GetRtCount();
+	auto rtvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_gBuffer.m_rtvHeap->GetCPUDescriptorHandleForHeapStart());
+	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandles[GBuffer::kMaxRtCount];
+	for (uint32_t i = 0; i < rtCount; i++)
+	{
+		rtvHandles[i] = rtvHandle;
+		rtvHandle.Offset(1, m_rtvDescriptorSize);
+	}
+
+	const auto dsvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_dsvHeap->GetCPUDescriptorHandleForHeapStart(),
+	                                                     m_frameIndex,
+	                                                     m_dsvDescriptorSize);
+
+	for (uint32_t i = 0; i < rtCount; i++)
+	{
+		constexpr float kClearColor[] = {0.0f, 0.0f, 0.0f, 1.0f};
+		commandList->ClearRenderTargetView(rtvHandles[i], kClearColor, 0, nullptr);
+	}
+	constexpr float kClearDepth = 1.0f;
+	commandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, kClearDepth, 0,
+	                                   0, nullptr);
+
+	commandList->OMSetRenderTargets(rtCount, rtvHandles, FALSE, &dsvHandle);
+	m_indirectGeometryPass.Draw(commandList);
 }
 
 
@@ -424,17 +1147,24 @@ void Renderer::AddLightingPass(ID3D12GraphicsCommandList* commandList)
 	ID3D12DescriptorHeap* descriptorHeaps[] = {m_descriptorHeap.Get()};
 	commandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 
-	DxHelper::ResourceBarriersArray<GBuffer::kRtCount + 1> barriers;
-	m_gBuffer.AddBarriers(barriers.data(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_GENERIC_READ);
-	barriers[GBuffer::kRtCount] = CD3DX12_RESOURCE_BARRIER::Transition(m_swapChainRenderTargets[m_frameIndex].Get(),
+	DxHelper::ResourceBarriersArray<GBuffer::kMaxRtCount + 2> barriers;
+	uint32_t barriersCount = m_gBuffer.AddBarriers(barriers.data(), D3D12_RESOURCE_STATE_RENDER_TARGET,
+		D3D12_RESOURCE_STATE_GENERIC_READ);
+	barriers[barriersCount++] = CD3DX12_RESOURCE_BARRIER::Transition(m_swapChainRenderTargets[m_frameIndex].Get(),
 		D3D12_RESOURCE_STATE_PRESENT,
 		D3D12_RESOURCE_STATE_RENDER_TARGET);
-	commandList->ResourceBarrier(static_cast<uint32_t>(barriers.size()), barriers.data());
+	// Compact GBuffer reconstructs positions from depth
+	if (m_gBufferMode == GBufferMode::Compact)
+	{
+		barriers[barriersCount++] = CD3DX12_RESOURCE_BARRIER::Transition(m_depthStencilResources[m_frameIndex].Get(),
+			D3D12_RESOURCE_STATE_DEPTH_WRITE, kDepthReadStates);
+	}
+	commandList->ResourceBarrier(barriersCount, barriers.data());
 
 	const auto rtvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_swapChainRtvHeap->GetCPUDescriptorHandleForHeapStart(),
 	                                                     m_frameIndex, m_rtvDescriptorSize);
 	const auto dsvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_dsvHeap->GetCPUDescriptorHandleForHeapStart(),
-	                                                     m_frameIndex,
+	                                                     kSwapChainBuffersCount + m_frameIndex,
 	                                                     m_dsvDescriptorSize);
 	commandList->OMSetRenderTargets(1, &rtvHandle, false, &dsvHandle);
 	constexpr float kClearColor[] = {0.0f, 0.0f, 0.0f, 1.0f};
@@ -449,6 +1179,236 @@ void Renderer::AddLightingPass(ID3D12GraphicsCommandList* commandList)
 }
 
 
+void Renderer::AddVisibilityPass(ID3D12GraphicsCommandList* commandList)
+{
+	m_visibilityPass.Setup(commandList);
+
+	ID3D12DescriptorHeap* descriptorHeaps[] = {m_descriptorHeap.Get()};
+	commandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+
+	const auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_visibilityPass.GetRt(),
+		D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	commandList->ResourceBarrier(1, &barrier);
+
+	const auto rtvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_visibilityPass.m_rtvHeap->GetCPUDescriptorHandleForHeapStart());
+	const auto dsvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_dsvHeap->GetCPUDescriptorHandleForHeapStart(),
+	                                                     m_frameIndex,
+	                                                     m_dsvDescriptorSize);
+	commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
+
+	// Ids are not cleared, the pixels without geometry keep stencil 0 and are never read
+	constexpr float kClearDepth = 1.0f;
+	commandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, kClearDepth, 0,
+	                                   0, nullptr);
+
+	// Same object constant buffers as the geometry pass
+	auto cbDescriptorTable = CD3DX12_GPU_DESCRIPTOR_HANDLE(m_descriptorHeap->GetGPUDescriptorHandleForHeapStart());
+	cbDescriptorTable.Offset(m_frameIndex * m_geometryPass.GetDescriptorTablesDescriptorsCount(), m_cbvSrvUavDescriptorSize);
+
+	m_visibilityPass.Draw(commandList, cbDescriptorTable, m_scene);
+}
+
+
+void Renderer::AddVisibilityResolvePass(ID3D12GraphicsCommandList* commandList)
+{
+	m_visibilityResolvePass.Setup(commandList);
+
+	DxHelper::ResourceBarriersArray<GBuffer::kMaxRtCount + 1> barriers;
+	uint32_t barriersCount = m_gBuffer.AddBarriers(barriers.data(), D3D12_RESOURCE_STATE_GENERIC_READ,
+		D3D12_RESOURCE_STATE_RENDER_TARGET);
+	barriers[barriersCount++] = CD3DX12_RESOURCE_BARRIER::Transition(m_visibilityPass.GetRt(),
+		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_GENERIC_READ);
+	commandList->ResourceBarrier(barriersCount, barriers.data());
+
+	const uint32_t rtCount = m_gBuffer.GetRtCount();
+	auto rtvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_gBuffer.m_rtvHeap->GetCPUDescriptorHandleForHeapStart());
+	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandles[GBuffer::kMaxRtCount];
+	for (uint32_t i = 0; i < rtCount; i++)
+	{
+		rtvHandles[i] = rtvHandle;
+		rtvHandle.Offset(1, m_rtvDescriptorSize);
+	}
+
+	// Stencil test only, GBuffer is not cleared: the lighting pass reads the same pixels the resolve writes
+	const auto dsvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_dsvHeap->GetCPUDescriptorHandleForHeapStart(),
+	                                                     kSwapChainBuffersCount + m_frameIndex,
+	                                                     m_dsvDescriptorSize);
+	commandList->OMSetRenderTargets(rtCount, rtvHandles, FALSE, &dsvHandle);
+
+	auto descriptorTable = CD3DX12_GPU_DESCRIPTOR_HANDLE(m_descriptorHeap->GetGPUDescriptorHandleForHeapStart());
+	descriptorTable.Offset(m_visibilityResolveTablesOffset + m_frameIndex * m_visibilityResolvePass.GetDescriptorTablesDescriptorsCount(),
+		m_cbvSrvUavDescriptorSize);
+
+	m_visibilityResolvePass.Draw(commandList, descriptorTable);
+}
+
+
+void Renderer::AddTiledLightingPass(ID3D12GraphicsCommandList* commandList)
+{
+	m_tiledLightingPass.Setup(commandList);
+
+	ID3D12DescriptorHeap* descriptorHeaps[] = {m_descriptorHeap.Get()};
+	commandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+
+	DxHelper::ResourceBarriersArray<GBuffer::kMaxRtCount + 1> barriers;
+	uint32_t barriersCount = m_gBuffer.AddBarriers(barriers.data(), D3D12_RESOURCE_STATE_RENDER_TARGET,
+		D3D12_RESOURCE_STATE_GENERIC_READ);
+	// Tiles are bounded by depth in every GBuffer mode
+	barriers[barriersCount++] = CD3DX12_RESOURCE_BARRIER::Transition(m_depthStencilResources[m_frameIndex].Get(),
+		D3D12_RESOURCE_STATE_DEPTH_WRITE, kDepthComputeReadStates);
+	commandList->ResourceBarrier(barriersCount, barriers.data());
+
+	auto descriptorTable = CD3DX12_GPU_DESCRIPTOR_HANDLE(m_descriptorHeap->GetGPUDescriptorHandleForHeapStart());
+	descriptorTable.Offset(m_tiledLightingTablesOffset + m_frameIndex * m_tiledLightingPass.GetDescriptorTablesDescriptorsCount(),
+		m_cbvSrvUavDescriptorSize);
+
+	m_tiledLightingPass.Dispatch(commandList, descriptorTable);
+
+	// Flip model swap chain buffers can not be unordered access views
+	const CD3DX12_RESOURCE_BARRIER copyBarriers[] = {
+		CD3DX12_RESOURCE_BARRIER::Transition(m_tiledLightingPass.GetOutput(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+			D3D12_RESOURCE_STATE_COPY_SOURCE),
+		CD3DX12_RESOURCE_BARRIER::Transition(m_swapChainRenderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT,
+			D3D12_RESOURCE_STATE_COPY_DEST)
+	};
+	commandList->ResourceBarrier(_countof(copyBarriers), copyBarriers);
+	commandList->CopyResource(m_swapChainRenderTargets[m_frameIndex].Get(), m_tiledLightingPass.GetOutput());
+}
+
+
+void Renderer::AddLightVolumesPass(ID3D12GraphicsCommandList* commandList)
+{
+	m_lightVolumesPass.Setup(commandList);
+
+	ID3D12DescriptorHeap* descriptorHeaps[] = {m_descriptorHeap.Get()};
+	commandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+
+	DxHelper::ResourceBarriersArray<GBuffer::kMaxRtCount + 2> barriers;
+	uint32_t barriersCount = m_gBuffer.AddBarriers(barriers.data(), D3D12_RESOURCE_STATE_RENDER_TARGET,
+		D3D12_RESOURCE_STATE_GENERIC_READ);
+	barriers[barriersCount++] = CD3DX12_RESOURCE_BARRIER::Transition(m_lightVolumesPass.GetAccumulationRt(),
+		D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	// Depth plane only, the volumes write the stencil plane
+	if (m_gBufferMode == GBufferMode::Compact)
+	{
+		barriers[barriersCount++] = CD3DX12_RESOURCE_BARRIER::Transition(m_depthStencilResources[m_frameIndex].Get(),
+			D3D12_RESOURCE_STATE_DEPTH_WRITE, kDepthReadStates, 0);
+	}
+	commandList->ResourceBarrier(barriersCount, barriers.data());
+
+	const auto accumulationRtvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(
+		m_lightVolumesPass.m_rtvHeap->GetCPUDescriptorHandleForHeapStart());
+	const auto dsvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_dsvHeap->GetCPUDescriptorHandleForHeapStart(),
+	                                                     2 * kSwapChainBuffersCount + m_frameIndex,
+	                                                     m_dsvDescriptorSize);
+	commandList->OMSetRenderTargets(1, &accumulationRtvHandle, false, &dsvHandle);
+	constexpr float kClearColor[] = {0.0f, 0.0f, 0.0f, 1.0f};
+	commandList->ClearRenderTargetView(accumulationRtvHandle, kClearColor, 0, nullptr);
+
+	auto descriptorTable = CD3DX12_GPU_DESCRIPTOR_HANDLE(m_descriptorHeap->GetGPUDescriptorHandleForHeapStart());
+	descriptorTable.Offset(m_lightVolumesTablesOffset + m_frameIndex * m_lightVolumesPass.GetDescriptorTablesDescriptorsCount(),
+		m_cbvSrvUavDescriptorSize);
+
+	m_lightVolumesPass.DrawLights(commandList, descriptorTable);
+
+	const CD3DX12_RESOURCE_BARRIER resolveBarriers[] = {
+		CD3DX12_RESOURCE_BARRIER::Transition(m_lightVolumesPass.GetAccumulationRt(), D3D12_RESOURCE_STATE_RENDER_TARGET,
+			D3D12_RESOURCE_STATE_GENERIC_READ),
+		CD3DX12_RESOURCE_BARRIER::Transition(m_swapChainRenderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT,
+			D3D12_RESOURCE_STATE_RENDER_TARGET)
+	};
+	commandList->ResourceBarrier(_countof(resolveBarriers), resolveBarriers);
+
+	const auto rtvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_swapChainRtvHeap->GetCPUDescriptorHandleForHeapStart(),
+	                                                     m_frameIndex, m_rtvDescriptorSize);
+	commandList->OMSetRenderTargets(1, &rtvHandle, false, nullptr);
+
+	m_lightVolumesPass.Resolve(commandList, descriptorTable);
+}
+
+
+bool Renderer::UseTiledLighting() const
+{
+	return m_lightingMode == LightingMode::TiledCompute && m_lightingPass.GetDebugView() == LightingDebugView::None;
+}
+
+
+bool Renderer::UseLightVolumes() const
+{
+	return m_lightingMode == LightingMode::LightVolumes && m_lightingPass.GetDebugView() == LightingDebugView::None;
+}
+
+
+void Renderer::UpdateRenderPathBenchmark()
+{
+	if (m_benchmarkConfiguration < 0)
+		return;
+
+	// The frame last recorded with this index is completed, UpdateToNextFrame waited for it
+	const int32_t completedConfiguration = m_frameBenchmarkConfigurations[m_frameIndex];
+	const double gpuMilliseconds = m_gpuTimer.GetMilliseconds(m_frameIndex);
+	if (completedConfiguration >= 0 && gpuMilliseconds >= 0.0)
+	{
+		m_benchmarkResults[completedConfiguration].gpuMilliseconds += gpuMilliseconds;
+		m_benchmarkResults[completedConfiguration].gpuFramesCount++;
+	}
+
+	if (m_benchmarkFrame == kBenchmarkWarmupFramesCount + kBenchmarkFramesCount)
+	{
+		m_benchmarkConfiguration++;
+		m_benchmarkFrame = 0;
+	}
+
+	if (m_benchmarkConfiguration == _countof(kBenchmarkConfigurations))
+	{
+		ReportRenderPathBenchmark();
+		m_renderPath = m_benchmarkRestoreRenderPath;
+		m_depthPrePassMode = m_benchmarkRestoreDepthPrePassMode;
+		m_benchmarkConfiguration = -1;
+		return;
+	}
+
+	const auto& configuration = kBenchmarkConfigurations[m_benchmarkConfiguration];
+	m_renderPath = configuration.renderPath;
+	m_depthPrePassMode = configuration.depthPrePassMode;
+	m_frameBenchmarkConfigurations[m_frameIndex] = m_benchmarkFrame < kBenchmarkWarmupFramesCount
+		? -1
+		: m_benchmarkConfiguration;
+	m_benchmarkFrame++;
+}
+
+
+void Renderer::ReportRenderPathBenchmark() const
+{
+	OutputDebugStringA(std::format("Render path benchmark, {} objects, {} point and {} spot lights:\n",
+		m_scene->GetObjectsCount(), m_scene->GetLightSources().GetPointLightSourcesCount(),
+		m_scene->GetLightSources().GetSpotLightSourcesCount()).c_str());
+
+	for (uint32_t i = 0; i < _countof(kBenchmarkConfigurations); i++)
+	{
+		const auto& result = m_benchmarkResults[i];
+		const double gpuMilliseconds = result.gpuFramesCount > 0
+			? result.gpuMilliseconds / result.gpuFramesCount
+			: 0.0;
+		const double cpuMilliseconds = result.cpuFramesCount > 0
+			? result.cpuMilliseconds / result.cpuFramesCount
+			: 0.0;
+		const uint64_t skippedStateCallsCount = result.cpuFramesCount > 0
+			? result.skippedStateCallsCount / result.cpuFramesCount
+			: 0;
+		OutputDebugStringA(std::format("  {}: {} ms GPU over {} frames, {} ms CPU to record, "
+			"{} redundant state calls skipped per frame\n", kBenchmarkConfigurations[i].name, gpuMilliseconds,
+			result.gpuFramesCount, cpuMilliseconds, skippedStateCallsCount).c_str());
+	}
+}
+
+
+uint64_t Renderer::GetLastSubmittedFenceValue() const
+{
+	return m_fenceValues[m_frameIndex] - 1;
+}
+
+
 void Renderer::WaitForGpu()
 {
 	DxVerify(m_commandQueue->Signal(m_fence.Get(), m_fenceValues[m_frameIndex]));
@@ -474,4 +1434,11 @@ void Renderer::UpdateToNextFrame()
 	}
 
 	m_fenceValues[m_frameIndex] = currentFenceValue + 1;
+
+	// The frame copying the indirect arguments has completed
+	if (m_indirectValidationFrameIndex == static_cast<int32_t>(m_frameIndex))
+	{
+		ReportIndirectCulling();
+		m_indirectValidationFrameIndex = -1;
+	}
 }
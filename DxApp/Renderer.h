@@ -1,15 +1,31 @@
 #pragma once
 
 #include <stdint.h>
+#include <vector>
 #include <d3d12.h>
 #include <d3dx12.h>
 #include <dxgi1_4.h>
 #include <wrl.h>
 
 #include "Scene.h"
+#include "ClusteredForwardPass.h"
+#include "DeferredReleaseQueue.h"
+#include "DepthPrePass.h"
+#include "DrawOrder.h"
+#include "DrawSortKey.h"
 #include "GBuffer.h"
 #include "GeometryPass.h"
+#include "GpuHeapAllocator.h"
+#include "GpuTimer.h"
+#include "IndirectGeometryPass.h"
 #include "LightingPass.h"
+#include "LightVolumesPass.h"
+#include "PipelineStateCache.h"
+#include "ShaderCache.h"
+#include "TiledLightingPass.h"
+#include "UploadService.h"
+#include "VisibilityPass.h"
+#include "VisibilityResolvePass.h"
 
 
 using namespace Microsoft::WRL;
@@ -18,27 +34,104 @@ using namespace Microsoft::WRL;
 struct CD3DX12_RESOURCE_BARRIER;
 
 
+// How the GBuffer is filled
+enum class GeometryMode : uint32_t
+{
+	// Geometry pass writes the GBuffer directly
+	GBuffer,
+	// Visibility pass writes the triangle ids, the resolve pass fetches the vertices and writes the GBuffer
+	VisibilityBuffer,
+	// Compute shader culls the instances, one ExecuteIndirect writes the GBuffer, see IndirectGeometryPass.h
+	GBufferIndirect
+};
+
+
+enum class LightingMode : uint32_t
+{
+	// Fullscreen pixel shader, every pixel evaluates every light
+	PixelShader,
+	// Compute shader culling the lights per 16x16 tile. Debug views still use the pixel shader.
+	TiledCompute,
+	// Point and spot lights rasterize stencil masked volumes, see LightVolumesPass.h. Debug views still use the pixel shader.
+	LightVolumes
+};
+
+
+// Selectable at runtime, the resources of both paths are created up front
+enum class RenderPath : uint32_t
+{
+	// Geometry and lighting modes above
+	Deferred,
+	// ClusteredForwardPass straight into the swap chain buffer, the lighting debug views are not supported
+	ClusteredForward,
+	Count
+};
+
+
+// Depth only draw before the GBuffer or the forward shading, see DepthPrePass.h.
+// The visibility buffer geometry mode has no pre-pass, its ids are as cheap to write as depth.
+enum class DepthPrePassMode : uint32_t
+{
+	Off,
+	On,
+	// Decided by the overdraw estimate of the scene bounds, see DrawOrder.h
+	Auto,
+	Count
+};
+
+
 class Renderer
 {
 public:
 	Renderer() = delete;
-	explicit Renderer(HWND hwnd, uint32_t windowWidth = 0, uint32_t windowHeight = 0);
+	// reportDiagnostics prints the GBuffer layout and checks the light culling, the overdraw estimate and the GPU
+	// culled indirect arguments of every new scene against their CPU references to the debug output
+	explicit Renderer(HWND hwnd, uint32_t windowWidth = 0, uint32_t windowHeight = 0,
+		GBufferMode gBufferMode = GBufferMode::Standard, GeometryMode geometryMode = GeometryMode::GBuffer,
+		LightingMode lightingMode = LightingMode::PixelShader, bool reportDiagnostics = false);
 	~Renderer();
 
 	void RenderScene(D3D12_VIEWPORT viewport);
 
+	// Scene resources are uploaded asynchronously, the previous scene is rendered until the upload completes
 	void SetScene(Scene* scene);
+	// Adds a mesh to the current scene and uploads it on the copy queue, its objects are drawn once the copy
+	// completes. The rest of the current scene is edited in place: the objects Scene::AddObject adds or
+	// RemoveObject removes and the light sources are picked up by the next frame, none of it waits for the GPU.
+	// UINT32_MAX without a current scene.
+	uint32_t AddMesh(SceneObject&& mesh);
+
+	void SetLightFalloff(LightFalloff falloff);
+	void SetLightingDebugView(LightingDebugView debugView);
+	void SetRenderPath(RenderPath renderPath) { m_renderPath = renderPath; }
+	[[nodiscard]] RenderPath GetRenderPath() const { return m_renderPath; }
+	void SetDepthPrePassMode(DepthPrePassMode mode) { m_depthPrePassMode = mode; }
+	[[nodiscard]] DepthPrePassMode GetDepthPrePassMode() const { return m_depthPrePassMode; }
+	// Renders the same scene with every path, reports the average GPU and CPU frame times and restores the path
+	void StartRenderPathBenchmark();
 
 private:
 	static constexpr uint32_t kSwapChainBuffersCount = 2;
+	// Frames measured per benchmark configuration, the frames after a switch are dropped
+	static constexpr uint32_t kBenchmarkFramesCount = 240;
+	static constexpr uint32_t kBenchmarkWarmupFramesCount = 8;
+	// Frames between the overdraw estimates of DepthPrePassMode::Auto
+	static constexpr uint32_t kOverdrawEstimateInterval = 30;
+	// Object slots the tables have past the ones of the scene, at least kMinObjectsHeadroom and half of them
+	static constexpr uint32_t kMinObjectsHeadroom = 256;
+	static constexpr uint32_t kNoMesh = UINT32_MAX;
 
 	ComPtr<ID3D12Device> m_device;
+	GpuHeapAllocator m_heapAllocator;
 	ComPtr<ID3D12CommandQueue> m_commandQueue;
 	ComPtr<IDXGISwapChain3> m_swapChain;
 	ComPtr<ID3D12DescriptorHeap> m_swapChainRtvHeap;
 	ComPtr<ID3D12Resource> m_swapChainRenderTargets[kSwapChainBuffersCount];
+	// kSwapChainBuffersCount writable views, then as many read only ones,
+	// then as many with read only depth and writable stencil for the light volumes
 	ComPtr<ID3D12DescriptorHeap> m_dsvHeap;
 	ComPtr<ID3D12Resource> m_depthStencilResources[kSwapChainBuffersCount];
+	GpuAllocation m_depthStencilAllocations[kSwapChainBuffersCount];
 	ComPtr<ID3D12CommandAllocator> m_commandAllocators[kSwapChainBuffersCount];
 
 	ComPtr<ID3D12GraphicsCommandList> m_commandList;
@@ -49,21 +142,116 @@ private:
 
 	ComPtr<ID3D12DescriptorHeap> m_descriptorHeap;
 	ComPtr<ID3D12Resource> m_constantBufferUploadHeaps[kSwapChainBuffersCount];
+	GpuAllocation m_constantBufferUploadAllocations[kSwapChainBuffersCount];
 
 	uint32_t m_frameIndex;
 	HANDLE m_fenceEvent;
 	ComPtr<ID3D12Fence> m_fence;
 	uint64_t m_fenceValues[kSwapChainBuffersCount] = {0};
 
-	Scene* m_scene;
+	// Objects still referenced by the frames in flight
+	DeferredReleaseQueue m_releaseQueue;
+
+	Scene* m_scene = nullptr;
+	Scene* m_pendingScene = nullptr;
+	uint64_t m_pendingSceneUploadFenceValue = 0;
+	// Pending scenes replaced by SetScene before their activation, released once their uploads complete
+	struct SupersededScene
+	{
+		Scene* scene;
+		uint64_t uploadFenceValue;
+	};
+	std::vector<SupersededScene> m_supersededScenes;
+
+	// Meshes of AddMesh in the copy queue
+	struct PendingMesh
+	{
+		uint32_t mesh;
+		uint64_t uploadFenceValue;
+	};
+	std::vector<PendingMesh> m_pendingMeshes;
+	// Object slots of the object constant buffers, descriptor tables and indirect instances. The scene grows into
+	// them, they are only recreated once its slots outgrow them. At most GetMaxObjectsCount.
+	uint32_t m_objectsCapacity = 0;
+	// Mesh the visibility resolve views of every slot reference, kNoMesh for null views
+	std::vector<uint32_t> m_objectDescriptorMeshes;
+	// Slots whose views the tables of a frame still miss, written once the GPU is done with that frame
+	std::vector<uint32_t> m_objectDescriptorUpdates[kSwapChainBuffersCount];
+
+	UploadService m_uploadService;
 
 	uint32_t m_windowWidth;
 	uint32_t m_windowHeight;
+	bool m_reportDiagnostics;
 
+	ShaderCache m_shaderCache;
+	PipelineStateCache m_pipelineStateCache;
+
+	GBufferMode m_gBufferMode;
 	GBuffer m_gBuffer;
 	GeometryPass m_geometryPass;
 	LightingPass m_lightingPass;
 
+	GeometryMode m_geometryMode;
+	VisibilityPass m_visibilityPass;
+	VisibilityResolvePass m_visibilityResolvePass;
+	IndirectGeometryPass m_indirectGeometryPass;
+	// With reportDiagnostics, the arguments of the first frame of a scene are checked against the CPU reference once
+	// that frame completes
+	bool m_indirectValidationPending = false;
+	int32_t m_indirectValidationFrameIndex = -1;
+
+	LightingMode m_lightingMode;
+	TiledLightingPass m_tiledLightingPass;
+	LightVolumesPass m_lightVolumesPass;
+
+	RenderPath m_renderPath = RenderPath::Deferred;
+	ClusteredForwardPass m_clusteredForwardPass;
+
+	// Off by default, the frame is unchanged until the pre-pass is switched on (P)
+	DepthPrePassMode m_depthPrePassMode = DepthPrePassMode::Off;
+	// Resolved from the mode every frame
+	bool m_useDepthPrePass = false;
+	// Last decision of DepthPrePassMode::Auto
+	bool m_depthPrePassPaysOff = false;
+	uint32_t m_framesSinceOverdrawEstimate = kOverdrawEstimateInterval;
+	DepthPrePass m_depthPrePass;
+	// Scene objects front to back, the depth pre-pass follows it
+	std::vector<DrawOrder::DrawItem> m_drawItems;
+	std::vector<uint32_t> m_drawOrder;
+	// Scene objects by their DrawSortKey, the passes shading the objects follow it
+	DrawSortKey::RadixSorter m_drawSorter;
+	std::vector<DrawSortKey::SortItem> m_drawSortItems;
+	std::vector<uint32_t> m_submissionOrder;
+	// Redundant state calls the passes skipped while recording the last frame
+	uint32_t m_skippedStateCallsCount = 0;
+
+	GpuTimer m_gpuTimer;
+
+	struct BenchmarkResult
+	{
+		double gpuMilliseconds = 0.0;
+		uint32_t gpuFramesCount = 0;
+		double cpuMilliseconds = 0.0;
+		uint32_t cpuFramesCount = 0;
+		uint64_t skippedStateCallsCount = 0;
+	};
+
+	// Index into the benchmark configurations, -1 while no benchmark runs
+	int32_t m_benchmarkConfiguration = -1;
+	uint32_t m_benchmarkFrame = 0;
+	std::vector<BenchmarkResult> m_benchmarkResults;
+	// Configuration each frame in flight was recorded with, -1 for the frames not measured. Reset by the start.
+	int32_t m_frameBenchmarkConfigurations[kSwapChainBuffersCount] = {};
+	RenderPath m_benchmarkRestoreRenderPath = RenderPath::Deferred;
+	DepthPrePassMode m_benchmarkRestoreDepthPrePassMode = DepthPrePassMode::Off;
+
+	// Descriptor tables of the optional passes follow the geometry and lighting ones, kSwapChainBuffersCount each
+	uint32_t m_visibilityResolveTablesOffset = 0;
+	uint32_t m_tiledLightingTablesOffset = 0;
+	uint32_t m_lightVolumesTablesOffset = 0;
+	uint32_t m_clusteredForwardTablesOffset = 0;
+
 	void LoadPipeline(HWND hwnd);
 	void EnableDebugLayer();
 	void CreateDevice(IDXGIFactory4* factory);
@@ -72,6 +260,16 @@ private:
 	void CreateDescriptorHeaps();
 	// Creates Rts, Dss, CommandAllocators
 	void CreateFrameResources();
+	// Bytes per pixel of every GBuffer mode
+	void ReportGBufferLayout() const;
+	// Tiled light culling of the scene lights against the brute force test
+	void ReportTiledLightCulling() const;
+	// Clustered light lists of the scene lights against the brute force test
+	void ReportClusteredLightCulling() const;
+	// GPU culled indirect arguments against the CPU reference
+	void ReportIndirectCulling() const;
+	// Overdraw of the submission and the import orders and the depth pre-pass decision
+	void ReportOverdrawEstimate() const;
 
 	void LoadAssets();
 	void CreateCommandList();
@@ -79,15 +277,46 @@ private:
 
 	void CopyFrameResourcesToGpu();
 
+	void ActivatePendingScene();
+	void ReleaseSupersededScenes();
+	// Makes the meshes whose upload completed resident
+	void ActivatePendingMeshes();
+	// Recreates the tables and the indirect instances with headroom past the slots of the scene, the frames in
+	// flight keep the previous ones
+	void UpdateObjectsCapacity();
+	// Object slots the geometry mode addresses, the visibility buffer ids have room for kMaxObjectsCount
+	[[nodiscard]] uint32_t GetMaxObjectsCount() const;
+	// Visibility resolve views of the changed slots, in the tables of the current frame
+	void UpdateObjectDescriptors();
+
 	void CreateRootDescriptorTableResources();
 
 	// cb data, sceneObjectsData, lightsData, etc
 	void UpdateData(float appAspect);
+	// Sorts the objects front to back and by their sort keys, resolves the depth pre-pass mode
+	void UpdateDrawOrder(float appAspect);
+	DrawOrder::OverdrawEstimate EstimateOverdraw(const std::vector<uint32_t>& order, float appAspect) const;
 
 	void PopulateCommandList(D3D12_VIEWPORT viewport);
+	void AddDeferredPasses(ID3D12GraphicsCommandList* commandList);
+	void AddClusteredForwardPass(ID3D12GraphicsCommandList* commandList);
 	void AddGeometryPass(ID3D12GraphicsCommandList* commandList);
 	void AddLightingPass(ID3D12GraphicsCommandList* commandList);
+	void AddIndirectGeometryPass(ID3D12GraphicsCommandList* commandList);
+	void AddVisibilityPass(ID3D12GraphicsCommandList* commandList);
+	void AddVisibilityResolvePass(ID3D12GraphicsCommandList* commandList);
+	void AddTiledLightingPass(ID3D12GraphicsCommandList* commandList);
+	void AddLightVolumesPass(ID3D12GraphicsCommandList* commandList);
+	// Tiled and light volumes modes fall back to the pixel shader for the debug views
+	bool UseTiledLighting() const;
+	bool UseLightVolumes() const;
+
+	// Collects the GPU time of the completed frame and moves to the next configuration
+	void UpdateRenderPathBenchmark();
+	void ReportRenderPathBenchmark() const;
 
+	// Value signaled after the last submitted frame, objects used up to now can be released after it
+	uint64_t GetLastSubmittedFenceValue() const;
 	void WaitForGpu();
 	void UpdateToNextFrame();
 };
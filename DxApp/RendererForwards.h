@@ -5,6 +5,12 @@
 
 
 static constexpr DXGI_FORMAT kDsFormat = DXGI_FORMAT_D32_FLOAT_S8X24_UINT;
+// Depth stencil resources are typeless, so the lighting pass can read depth through kDepthSrvFormat
+static constexpr DXGI_FORMAT kDsResourceFormat = DXGI_FORMAT_R32G8X24_TYPELESS;
+static constexpr DXGI_FORMAT kDepthSrvFormat = DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS;
+static constexpr uint32_t kDsBytesPerPixel = 8;
 static constexpr DXGI_FORMAT kSwapChainFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
 
-static constexpr uint8_t kGeometryStencilRef = 1;
\ No newline at end of file
+static constexpr uint8_t kGeometryStencilRef = 1;
+// Marks the pixels a light volume covers, cleared again by the same volume
+static constexpr uint8_t kLightVolumeStencilBit = 2;
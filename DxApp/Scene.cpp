@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cassert>
 #include <assimp/cimport.h>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
@@ -5,39 +7,52 @@
 #include "Scene.h"
 
 Scene::Scene(const char* path)
-	: m_camera(XMFLOAT3(-1.0f, -1.5f, 0.5f))
+	: m_camera(Float3(-1.0f, -1.5f, 0.5f))
 {
 	auto* importedScene = aiImportFile(path, aiProcessPreset_TargetRealtime_MaxQuality);
 	assert(importedScene);
 
 	if (importedScene->HasMeshes())
 	{
+		// The nodes referencing the same mesh share it
+		m_meshes.reserve(importedScene->mNumMeshes);
+		for (uint32_t i = 0; i < importedScene->mNumMeshes; i++)
+			m_meshes.push_back(SceneObject(importedScene->mMeshes[i]));
+
+		Float4x4 identity;
+		StoreFloat4x4(identity, MatrixIdentity());
+
 		struct StackEntry
 		{
 			aiNode*		node;
-			aiMatrix4x4 parentTransform;
+			uint32_t	parent;
 		};
 
+		// Depth first, the order of the scene graph
 		std::vector<StackEntry> stack;
-		stack.push_back({ importedScene->mRootNode, aiMatrix4x4() });
+		stack.push_back({ importedScene->mRootNode, SceneGraph::kNoParent });
 
 		while (!stack.empty())
 		{
 			auto entry = stack.back();
 			stack.pop_back();
 
-			auto transform = entry.node->mTransformation * entry.parentTransform;
+			// Row vectors
+			aiMatrix4x4 local = entry.node->mTransformation;
+			local.Transpose();
+			const uint32_t node = m_sceneGraph.AddNode(entry.parent, Float4x4(reinterpret_cast<const float*>(&local)));
 
+			m_nodeObjects.push_back(GetObjectSlotsCount());
 			for (uint32_t i = 0; i < entry.node->mNumMeshes; i++)
 			{
-				auto* mesh = importedScene->mMeshes[entry.node->mMeshes[i]];
-
-				m_sceneObjects.push_back(SceneObject(mesh, transform));
+				const uint32_t slot = AddObject(entry.node->mMeshes[i], identity).slot;
+				m_objectFlags[slot] |= kObjectFollowsNode;
 			}
 
 			for (uint32_t i = 0; i < entry.node->mNumChildren; i++)
-				stack.push_back({ entry.node->mChildren[i], transform });
+				stack.push_back({ entry.node->mChildren[i], node });
 		}
+		m_nodeObjects.push_back(GetObjectSlotsCount());
 	}
 
 	if (importedScene->HasLights())
@@ -50,17 +65,17 @@ Scene::Scene(const char* path)
 			{
 				case aiLightSource_AMBIENT:
 					m_lightSources.SetAmbient(AmbientLightSource(
-						XMFLOAT4(light->mColorAmbient.r, light->mColorAmbient.g, light->mColorAmbient.b, 1.0f)));
+						Float4(light->mColorAmbient.r, light->mColorAmbient.g, light->mColorAmbient.b, 1.0f)));
 					break;
 				case aiLightSource_DIRECTIONAL:
 					m_lightSources.AddDirectional(DirectionalLightSource(
-						XMFLOAT4(light->mColorDiffuse.r, light->mColorDiffuse.g, light->mColorDiffuse.b, 1.0f),
-						XMFLOAT4(light->mDirection.x, light->mDirection.y, light->mDirection.z, 1.0f)));
+						Float4(light->mColorDiffuse.r, light->mColorDiffuse.g, light->mColorDiffuse.b, 1.0f),
+						Float4(light->mDirection.x, light->mDirection.y, light->mDirection.z, 1.0f)));
 					break;
 				case aiLightSource_POINT:
 					m_lightSources.AddPoint(PointLightSource(
-						XMFLOAT4(light->mColorDiffuse.r, light->mColorDiffuse.g, light->mColorDiffuse.b, 1.0f),
-						XMFLOAT4(light->mPosition.x, light->mPosition.y, light->mPosition.z, 1.0f)));
+						Float4(light->mColorDiffuse.r, light->mColorDiffuse.g, light->mColorDiffuse.b, 1.0f),
+						Float4(light->mPosition.x, light->mPosition.y, light->mPosition.z, 1.0f)));
 					break;
 				default:
 					break;
@@ -71,35 +86,205 @@ Scene::Scene(const char* path)
 	{
 		// Create our own light sources
 		m_lightSources.SetAmbient(AmbientLightSource(
-			XMFLOAT4(0.05f, 0.05f, 0.05f, 1.0f)));
+			Float4(0.05f, 0.05f, 0.05f, 1.0f)));
 		/*m_lightSources.AddDirectional(DirectionalLightSource(
-			XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f),
-			XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f)));*/
+			Float4(1.0f, 1.0f, 1.0f, 1.0f),
+			Float4(1.0f, 0.0f, 0.0f, 1.0f)));*/
 		/*m_lightSources.AddDirectional(DirectionalLightSource(
-			XMFLOAT4(0.7f, 0.2f, 0.7f, 1.0f),
-			XMFLOAT4(-1.0f, 0.0f, 0.0f, 1.0f)));*/
+			Float4(0.7f, 0.2f, 0.7f, 1.0f),
+			Float4(-1.0f, 0.0f, 0.0f, 1.0f)));*/
 		m_lightSources.AddPoint(PointLightSource(
-			XMFLOAT4(10.0f, 0.0f, 0.0f, 1.0f),
-			XMFLOAT4(2.0f, 1.0f, 0.0f, 1.0f)));
-		m_lightSources.AddSpot(SpotLightSource(XMFLOAT4(10.0f, 10.0f, 10.0f, 1.0f), XMFLOAT4(2.0f, 1.0f, 0.0f, 1.0f),
-			XMFLOAT4(0.0f, -1.0f, 0.0f, 1.0f), XM_PIDIV4));
+			Float4(10.0f, 0.0f, 0.0f, 1.0f),
+			Float4(2.0f, 1.0f, 0.0f, 1.0f)));
+		m_lightSources.AddSpot(SpotLightSource(Float4(10.0f, 10.0f, 10.0f, 1.0f), Float4(2.0f, 1.0f, 0.0f, 1.0f),
+			Float4(0.0f, -1.0f, 0.0f, 1.0f), kPiDiv4));
+	}
+
+	// Every node is new, the first Update places every object and builds the BVH, the tree is empty
+	BuildQueryMeshes();
+	Update();
+}
+
+StaticBatching::Statistics Scene::BatchStaticObjects(const StaticBatching::Settings& settings)
+{
+	// The clusters bake the current transforms
+	Update();
+
+	const auto sources = GetObjectSources();
+	StaticBatching::Statistics statistics;
+	auto clusters = StaticBatching::Build(sources, settings, statistics);
+
+	std::vector<SceneObject> meshes;
+	meshes.reserve(clusters.size());
+	for (auto& cluster : clusters)
+		meshes.push_back(SceneObject(std::move(cluster)));
+	m_meshes = std::move(meshes);
+
+	ClearObjects();
+	m_nodeObjects.clear();
+	Float4x4 identity;
+	StoreFloat4x4(identity, MatrixIdentity());
+	for (uint32_t mesh = 0; mesh < GetMeshesCount(); mesh++)
+		AddObject(mesh, identity);
+	m_bvh.Build(m_worldBounds);
+	BuildQueryMeshes();
+	Update();
+
+	return statistics;
+}
+
+uint32_t Scene::AddMesh(SceneObject&& mesh)
+{
+	m_meshes.push_back(std::move(mesh));
+	Float4x4 identity;
+	StoreFloat4x4(identity, MatrixIdentity());
+	return m_query.AddMesh(m_meshes.back().GetBatchingSource(identity));
+}
+
+void Scene::SetMeshResident(uint32_t mesh)
+{
+	m_meshes[mesh].SetResident(true);
+	for (const uint32_t slot : m_slots.GetMeshSlots(mesh))
+		MarkPending(slot);
+}
+
+SceneObjectHandle Scene::AddObject(uint32_t mesh, const Float4x4& model)
+{
+	const uint32_t slot = m_slots.Allocate(mesh);
+	if (slot == SceneObjectSlots::kInvalidSlot)
+		return {};
+	if (slot == GetObjectSlotsCount())
+	{
+		m_transforms.Resize(slot + 1);
+		m_objectBounds.emplace_back();
+		m_worldBounds.emplace_back();
+		m_objectFlags.push_back(0);
+	}
+
+	const SceneObject& sceneObject = m_meshes[mesh];
+	m_objectBounds[slot] = { sceneObject.GetBoundsMin(), sceneObject.GetBoundsMax() };
+	m_objectFlags[slot] |= kObjectAlive;
+	SetModel(slot, model);
+	return GetHandle(slot);
+}
+
+bool Scene::RemoveObject(SceneObjectHandle handle)
+{
+	if (!m_slots.Free(handle))
+		return false;
+
+	const uint32_t slot = handle.slot;
+	m_objectFlags[slot] &= ~(kObjectAlive | kObjectFollowsNode);
+	m_worldBounds[slot] = AabbEmpty();
+	MarkPending(slot);
+	return true;
+}
+
+bool Scene::SetObjectTransform(SceneObjectHandle handle, const Float4x4& model)
+{
+	if (!IsValid(handle))
+		return false;
+	SetModel(handle.slot, model);
+	return true;
+}
+
+void Scene::Update()
+{
+	m_sceneGraph.Update(m_changedNodes);
+	if (!m_nodeObjects.empty())
+	{
+		for (const uint32_t node : m_changedNodes)
+		{
+			const auto& world = m_sceneGraph.GetWorldTransform(node);
+			for (uint32_t slot = m_nodeObjects[node]; slot < m_nodeObjects[node + 1]; slot++)
+			{
+				// Removed objects leave the node, their slots may hold other objects
+				if (m_objectFlags[slot] & kObjectFollowsNode)
+					SetModel(slot, world);
+			}
+		}
+	}
+
+	m_changedObjects.swap(m_pendingObjects);
+	m_pendingObjects.clear();
+	std::sort(m_changedObjects.begin(), m_changedObjects.end());
+	for (const uint32_t slot : m_changedObjects)
+		m_objectFlags[slot] &= ~kObjectPending;
+
+	// Also swaps in a finished background rebuild
+	m_bvh.Update(m_worldBounds, m_changedObjects);
+	m_query.SetInstances(m_bvh.GetBvh(), m_worldBounds, GetObjectMeshes(), m_transforms, m_changedObjects);
+}
+
+void Scene::SetModel(uint32_t slot, const Float4x4& model)
+{
+	m_transforms.Set(slot, model);
+	m_worldBounds[slot] = AabbTransform(m_objectBounds[slot], LoadFloat4x4(model));
+	MarkPending(slot);
+}
+
+void Scene::MarkPending(uint32_t slot)
+{
+	if (m_objectFlags[slot] & kObjectPending)
+		return;
+	m_objectFlags[slot] |= kObjectPending;
+	m_pendingObjects.push_back(slot);
+}
+
+void Scene::ClearObjects()
+{
+	m_slots.Clear();
+	m_transforms.Resize(0);
+	m_objectBounds.clear();
+	m_worldBounds.clear();
+	m_objectFlags.clear();
+	m_pendingObjects.clear();
+	m_changedObjects.clear();
+}
+
+std::vector<StaticBatching::Source> Scene::GetObjectSources() const
+{
+	std::vector<StaticBatching::Source> sources;
+	sources.reserve(GetObjectsCount());
+	for (uint32_t slot = 0; slot < GetObjectSlotsCount(); slot++)
+	{
+		if (IsObjectAlive(slot))
+			sources.push_back(m_meshes[GetObjectMeshes()[slot]].GetBatchingSource(m_transforms.Get(slot)));
 	}
+	return sources;
 }
 
-void Scene::CreateRendererResources(ID3D12Device* device, ID3D12GraphicsCommandList* commandList)
+void Scene::BuildQueryMeshes()
 {
-	for (auto& sceneObject : m_sceneObjects)
-		sceneObject.CreateRenderResources(device, commandList);
+	std::vector<StaticBatching::Source> meshes;
+	meshes.reserve(m_meshes.size());
+	Float4x4 identity;
+	StoreFloat4x4(identity, MatrixIdentity());
+	for (const auto& mesh : m_meshes)
+		meshes.push_back(mesh.GetBatchingSource(identity));
+	m_query.BuildMeshes(meshes);
+}
+
+#if defined(_WIN32)
+void Scene::CreateRendererResources(GpuHeapAllocator& heapAllocator, UploadService& uploadService)
+{
+	for (auto& mesh : m_meshes)
+	{
+		mesh.CreateRenderResources(heapAllocator, uploadService);
+		mesh.SetResident(true);
+	}
 }
 
-void Scene::DestroyUploadResources()
+void Scene::DestroyRendererResources(GpuHeapAllocator& heapAllocator)
 {
-	for (auto& sceneObject : m_sceneObjects)
-		sceneObject.DestroyUploadResources();
+	for (auto& mesh : m_meshes)
+		mesh.DestroyRendererResources(heapAllocator);
 }
 
-void Scene::DestroyRendererResources()
+void Scene::ReleaseRendererResources(GpuHeapAllocator& heapAllocator, DeferredReleaseQueue& releaseQueue,
+	uint64_t fenceValue)
 {
-	for (auto& sceneObject : m_sceneObjects)
-		sceneObject.DestroyRendererResources();
+	for (auto& mesh : m_meshes)
+		mesh.ReleaseRendererResources(heapAllocator, releaseQueue, fenceValue);
 }
+#endif
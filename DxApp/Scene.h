@@ -5,25 +5,125 @@
 #include "SceneObject.h"
 #include "Camera.h"
 #include "LightSources.h"
+#include "ObjectTransforms.h"
+#include "SceneGraph.h"
+#include "SceneObjectSlots.h"
+#include "Bvh.h"
+#include "SceneQuery.h"
 
 
+// Objects are slots of structure of arrays storage: the hot per object data the frame loops read, transform,
+// bounds, mesh and flags, has one element per slot, dead slots included. The meshes are the cold data, the
+// vertices and GPU buffers of the SceneObjects the objects reference, several objects can share one.
+// The slot of an object does not change while it lives, the renderer indexes its per object resources by slot.
 class Scene
 {
 public:
+	static constexpr uint8_t kObjectAlive = 1 << 0;
+	// Placed by the world transform of its scene graph node
+	static constexpr uint8_t kObjectFollowsNode = 1 << 1;
+	// In the changed objects of the next Update
+	static constexpr uint8_t kObjectPending = 1 << 2;
+
 	Scene() = delete;
 	explicit Scene(const char* path);
 
-	void CreateRendererResources(ID3D12Device* device, ID3D12GraphicsCommandList* commandList);
-	void DestroyUploadResources();
-	void DestroyRendererResources();
+	// Merges the objects into StaticBatching clusters, one mesh and one object each. Every object is static and
+	// drawn with the same pipeline, the scene graph moves none of them afterwards and the handles are invalidated.
+	// Has to precede CreateRendererResources.
+	StaticBatching::Statistics BatchStaticObjects(const StaticBatching::Settings& settings);
+
+#if defined(_WIN32)
+	// The meshes are resident right away, the renderer waits for the upload before drawing the scene
+	void CreateRendererResources(GpuHeapAllocator& heapAllocator, UploadService& uploadService);
+	void DestroyRendererResources(GpuHeapAllocator& heapAllocator);
+	void ReleaseRendererResources(GpuHeapAllocator& heapAllocator, DeferredReleaseQueue& releaseQueue,
+		uint64_t fenceValue);
+#endif
 
 	Camera& GetCamera() { return m_camera; }
-	std::vector<SceneObject>& GetSceneObjects() { return m_sceneObjects; }
-	uint32_t GetSceneObjectsCount() const { return static_cast<uint32_t>(m_sceneObjects.size()); }
 	LightSources& GetLightSources() { return m_lightSources; }
 
+	std::vector<SceneObject>& GetMeshes() { return m_meshes; }
+	const SceneObject& GetMesh(uint32_t mesh) const { return m_meshes[mesh]; }
+	uint32_t GetMeshesCount() const { return static_cast<uint32_t>(m_meshes.size()); }
+	// Objects can reference the mesh right away, they are drawn once it is resident, see Renderer::AddMesh
+	uint32_t AddMesh(SceneObject&& mesh);
+	// The objects of the mesh are in the changed objects of the next Update, the other slots are not visited
+	void SetMeshResident(uint32_t mesh);
+
+	// Reuses a dead slot when there is one. The object is in the changed objects of the next Update.
+	// An invalid handle when every slot up to the limit is in use.
+	SceneObjectHandle AddObject(uint32_t mesh, const SimdMath::Float4x4& model);
+	// Stale handles, of removed objects or of a reused slot, change nothing and return false
+	bool RemoveObject(SceneObjectHandle handle);
+	bool IsValid(SceneObjectHandle handle) const { return m_slots.IsValid(handle); }
+	// SceneObjectSlots::kInvalidSlot for a stale handle
+	uint32_t GetSlot(SceneObjectHandle handle) const { return m_slots.GetSlot(handle); }
+	SceneObjectHandle GetHandle(uint32_t slot) const { return m_slots.GetHandle(slot); }
+	// Until its scene graph node moves again
+	bool SetObjectTransform(SceneObjectHandle handle, const SimdMath::Float4x4& model);
+
+	// Set by the renderer, the visibility buffer ids address a limited number of objects
+	void SetMaxObjectSlotsCount(uint32_t count) { m_slots.SetMaxSlotsCount(count); }
+	uint32_t GetObjectSlotsCount() const { return static_cast<uint32_t>(m_objectFlags.size()); }
+	uint32_t GetObjectsCount() const { return m_slots.GetAliveCount(); }
+	bool IsObjectAlive(uint32_t slot) const { return m_objectFlags[slot] & kObjectAlive; }
+	// Alive with a resident mesh
+	bool IsObjectDrawn(uint32_t slot) const
+	{
+		return IsObjectAlive(slot) && m_meshes[GetObjectMeshes()[slot]].IsResident();
+	}
+
+	// Per slot
+	const ObjectTransforms::Transforms& GetTransforms() const { return m_transforms; }
+	// Object space, of the meshes
+	const std::vector<SimdMath::Aabb>& GetObjectBounds() const { return m_objectBounds; }
+	// Empty for the dead slots, nothing culls or queries them in
+	const std::vector<SimdMath::Aabb>& GetWorldBounds() const { return m_worldBounds; }
+	const std::vector<uint32_t>& GetObjectMeshes() const { return m_slots.GetMeshes(); }
+	const std::vector<uint8_t>& GetObjectFlags() const { return m_objectFlags; }
+	// Meshes of the alive objects placed by their transforms, in slot order
+	std::vector<StaticBatching::Source> GetObjectSources() const;
+
+	// Hierarchy of the imported nodes, the objects follow the world transforms of their nodes
+	SceneGraph& GetSceneGraph() { return m_sceneGraph; }
+	// Propagates the local transforms set since the last Update to the objects
+	void Update();
+	// Slots the last Update moved, added or removed, in increasing order. The bounds, culling instances and draw
+	// items of the other slots are still valid.
+	const std::vector<uint32_t>& GetChangedObjects() const { return m_changedObjects; }
+	// Over GetWorldBounds, refitted by every Update
+	const DynamicBvh& GetBvh() const { return m_bvh; }
+	// Raycasts and overlaps against the triangles of the objects, follows every Update
+	const SceneQuery& GetQuery() const { return m_query; }
+
 private:
-	std::vector<SceneObject> m_sceneObjects;
+	std::vector<SceneObject> m_meshes;
 	Camera m_camera;
 	LightSources m_lightSources;
+
+	ObjectTransforms::Transforms m_transforms;
+	std::vector<SimdMath::Aabb> m_objectBounds;
+	std::vector<SimdMath::Aabb> m_worldBounds;
+	std::vector<uint8_t> m_objectFlags;
+	// Generations, free slots, the mesh of every slot and the slots of every mesh
+	SceneObjectSlots m_slots;
+
+	DynamicBvh m_bvh;
+	SceneQuery m_query;
+
+	SceneGraph m_sceneGraph;
+	// Slots of node n are m_nodeObjects[n] to m_nodeObjects[n + 1], empty once the objects are batched
+	std::vector<uint32_t> m_nodeObjects;
+	std::vector<uint32_t> m_changedNodes;
+	std::vector<uint32_t> m_pendingObjects;
+	std::vector<uint32_t> m_changedObjects;
+
+	void SetModel(uint32_t slot, const SimdMath::Float4x4& model);
+	void MarkPending(uint32_t slot);
+	// Frees every slot
+	void ClearObjects();
+	// Triangle BVHs of the meshes, the next Update places them
+	void BuildQueryMeshes();
 };
@@ -0,0 +1,266 @@
+#include "SceneGraph.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <random>
+#include <thread>
+
+
+using namespace SimdMath;
+
+
+namespace
+{
+	// Below it the threads cost more than they save
+	constexpr uint32_t kMinParallelNodes = 4096;
+	// Subtrees up to this size are one task
+	constexpr uint32_t kTaskNodesCount = 512;
+
+	double GetMilliseconds(std::chrono::high_resolution_clock::time_point startTime)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime)
+			.count();
+	}
+}
+
+
+uint32_t SceneGraph::AddNode(uint32_t parent, const Float4x4& local)
+{
+	const uint32_t node = GetNodesCount();
+	assert(parent == kNoParent || m_subtreeEnds[parent] == node);
+
+	m_parents.push_back(parent);
+	m_subtreeEnds.push_back(node + 1);
+	for (uint32_t ancestor = parent; ancestor != kNoParent; ancestor = m_parents[ancestor])
+		m_subtreeEnds[ancestor] = node + 1;
+	m_localTransforms.push_back(local);
+	m_worldTransforms.push_back(local);
+	m_dirtyFlags.push_back(1);
+	m_isDirty = true;
+	return node;
+}
+
+
+void SceneGraph::Clear()
+{
+	m_parents.clear();
+	m_subtreeEnds.clear();
+	m_localTransforms.clear();
+	m_worldTransforms.clear();
+	m_dirtyFlags.clear();
+	m_isDirty = false;
+}
+
+
+void SceneGraph::SetLocalTransform(uint32_t node, const Float4x4& local)
+{
+	m_localTransforms[node] = local;
+	m_dirtyFlags[node] = 1;
+	m_isDirty = true;
+}
+
+
+uint32_t SceneGraph::SetParent(uint32_t node, uint32_t parent, std::vector<uint32_t>& order)
+{
+	const uint32_t end = m_subtreeEnds[node];
+	assert(parent == kNoParent || parent < node || parent >= end);
+
+	// The subtree goes after the last descendant of parent, the nodes in between rotate past it
+	const uint32_t destination = parent == kNoParent ? GetNodesCount() : m_subtreeEnds[parent];
+	order.resize(GetNodesCount());
+	for (uint32_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	uint32_t movedNode;
+	if (destination >= end)
+	{
+		std::rotate(order.begin() + node, order.begin() + end, order.begin() + destination);
+		movedNode = destination - (end - node);
+	}
+	else
+	{
+		std::rotate(order.begin() + destination, order.begin() + node, order.begin() + end);
+		movedNode = destination;
+	}
+
+	std::vector<uint32_t> newIndices(order.size());
+	for (uint32_t i = 0; i < order.size(); i++)
+		newIndices[order[i]] = i;
+	const auto reorder = [&](auto& values) {
+		auto reordered = values;
+		for (uint32_t i = 0; i < order.size(); i++)
+			reordered[i] = values[order[i]];
+		values.swap(reordered);
+	};
+	reorder(m_parents);
+	reorder(m_localTransforms);
+	reorder(m_worldTransforms);
+	reorder(m_dirtyFlags);
+	for (auto& nodeParent : m_parents)
+	{
+		if (nodeParent != kNoParent)
+			nodeParent = newIndices[nodeParent];
+	}
+	m_parents[movedNode] = parent == kNoParent ? kNoParent : newIndices[parent];
+
+	// Children follow their parents, the subtrees end past their last descendants
+	for (uint32_t i = 0; i < GetNodesCount(); i++)
+		m_subtreeEnds[i] = i + 1;
+	for (uint32_t i = GetNodesCount(); i-- > 0;)
+	{
+		if (m_parents[i] != kNoParent)
+			m_subtreeEnds[m_parents[i]] = std::max(m_subtreeEnds[m_parents[i]], m_subtreeEnds[i]);
+	}
+
+	m_dirtyFlags[movedNode] = 1;
+	m_isDirty = true;
+	return movedNode;
+}
+
+
+void SceneGraph::Update(std::vector<uint32_t>& changedNodes, uint32_t threadsCount)
+{
+	changedNodes.clear();
+	if (!m_isDirty)
+		return;
+
+	// The first dirty node of a subtree recomputes all of it, the dirty nodes below are covered
+	m_tasks.clear();
+	for (uint32_t node = 0; node < GetNodesCount();)
+	{
+		if (!m_dirtyFlags[node])
+		{
+			node++;
+			continue;
+		}
+		const uint32_t end = m_subtreeEnds[node];
+		for (uint32_t changedNode = node; changedNode < end; changedNode++)
+			changedNodes.push_back(changedNode);
+		SplitSubtree(node);
+		node = end;
+	}
+	m_isDirty = false;
+
+	if (threadsCount == 0)
+		threadsCount = std::max(1u, std::thread::hardware_concurrency());
+	if (changedNodes.size() < kMinParallelNodes)
+		threadsCount = 1;
+	threadsCount = std::min(threadsCount, static_cast<uint32_t>(m_tasks.size()));
+
+	std::atomic<uint32_t> nextTask = 0;
+	const auto worker = [&]() {
+		for (uint32_t task = nextTask++; task < m_tasks.size(); task = nextTask++)
+			UpdateSubtree(m_tasks[task]);
+	};
+
+	std::vector<std::thread> threads;
+	for (uint32_t i = 1; i < threadsCount; i++)
+		threads.emplace_back(worker);
+	worker();
+	for (auto& thread : threads)
+		thread.join();
+}
+
+
+void SceneGraph::UpdateNode(uint32_t node)
+{
+	const uint32_t parent = m_parents[node];
+	if (parent == kNoParent)
+		m_worldTransforms[node] = m_localTransforms[node];
+	else
+		StoreFloat4x4(m_worldTransforms[node],
+			LoadFloat4x4(m_localTransforms[node]) * LoadFloat4x4(m_worldTransforms[parent]));
+	m_dirtyFlags[node] = 0;
+}
+
+
+void SceneGraph::UpdateSubtree(uint32_t root)
+{
+	// Parents precede their children
+	for (uint32_t node = root; node < m_subtreeEnds[root]; node++)
+		UpdateNode(node);
+}
+
+
+void SceneGraph::SplitSubtree(uint32_t root)
+{
+	// Without recursion, chains are as deep as the scene
+	std::vector<uint32_t> stack = { root };
+	while (!stack.empty())
+	{
+		const uint32_t node = stack.back();
+		stack.pop_back();
+		if (m_subtreeEnds[node] - node <= kTaskNodesCount)
+		{
+			m_tasks.push_back(node);
+			continue;
+		}
+		UpdateNode(node);
+		for (uint32_t child = node + 1; child < m_subtreeEnds[node]; child = m_subtreeEnds[child])
+			stack.push_back(child);
+	}
+}
+
+
+SceneGraph::BenchmarkReport SceneGraph::Benchmark(uint32_t nodesCount, uint32_t movedCount)
+{
+	constexpr uint32_t kMaxDepth = 32;
+
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<float> positionDistribution(-10.0f, 10.0f);
+	std::uniform_real_distribution<float> scaleDistribution(0.9f, 1.1f);
+	std::uniform_real_distribution<float> angleDistribution(0.0f, k2Pi);
+	std::geometric_distribution<uint32_t> levelsUpDistribution(0.5);
+
+	const auto getLocal = [&]() {
+		Float4x4 local;
+		const float scale = scaleDistribution(generator);
+		StoreFloat4x4(local, MatrixScaling(scale, scale, scale) * MatrixRotationY(angleDistribution(generator))
+			* MatrixTranslation(positionDistribution(generator), positionDistribution(generator),
+				positionDistribution(generator)));
+		return local;
+	};
+
+	// Nodes from the root to the last added one, the next node is a child of one of them
+	SceneGraph graph;
+	std::vector<uint32_t> path;
+	for (uint32_t i = 0; i < nodesCount; i++)
+	{
+		if (!path.empty())
+		{
+			const uint32_t levelsUp = path.size() >= kMaxDepth ? 1 : levelsUpDistribution(generator);
+			path.resize(std::max<size_t>(path.size() - std::min<size_t>(levelsUp, path.size()), 1));
+		}
+		path.push_back(graph.AddNode(path.empty() ? kNoParent : path.back(), getLocal()));
+	}
+
+	BenchmarkReport report;
+	report.nodesCount = nodesCount;
+	report.threadsCount = std::max(1u, std::thread::hardware_concurrency());
+
+	std::vector<uint32_t> changedNodes;
+	const auto markAll = [&]() {
+		for (uint32_t node = 0; node < nodesCount; node++)
+			graph.SetLocalTransform(node, graph.GetLocalTransform(node));
+	};
+
+	markAll();
+	auto startTime = std::chrono::high_resolution_clock::now();
+	graph.Update(changedNodes, 1);
+	report.fullMilliseconds = GetMilliseconds(startTime);
+
+	markAll();
+	startTime = std::chrono::high_resolution_clock::now();
+	graph.Update(changedNodes);
+	report.fullParallelMilliseconds = GetMilliseconds(startTime);
+
+	std::uniform_int_distribution<uint32_t> nodeDistribution(0, std::max(nodesCount, 1u) - 1);
+	for (uint32_t i = 0; i < movedCount && nodesCount > 0; i++)
+		graph.SetLocalTransform(nodeDistribution(generator), getLocal());
+	startTime = std::chrono::high_resolution_clock::now();
+	graph.Update(changedNodes);
+	report.partialMilliseconds = GetMilliseconds(startTime);
+	report.changedCount = static_cast<uint32_t>(changedNodes.size());
+	return report;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "SimdMath.h"
+
+
+// Transform hierarchy in a flat array sorted depth first: parents precede their children and the descendants
+// of every node follow it contiguously. Local transforms can be set at any time, Update recomputes the world
+// transforms of the changed subtrees only and spreads the independent subtrees over threads.
+class SceneGraph
+{
+public:
+	static constexpr uint32_t kNoParent = UINT32_MAX;
+
+	// Depth first: parent is kNoParent, the last added node or one of its ancestors
+	uint32_t AddNode(uint32_t parent, const SimdMath::Float4x4& local);
+	void Clear();
+
+	uint32_t GetNodesCount() const { return static_cast<uint32_t>(m_parents.size()); }
+	uint32_t GetParent(uint32_t node) const { return m_parents[node]; }
+	// One past the last descendant
+	uint32_t GetSubtreeEnd(uint32_t node) const { return m_subtreeEnds[node]; }
+
+	const SimdMath::Float4x4& GetLocalTransform(uint32_t node) const { return m_localTransforms[node]; }
+	// The node and its descendants get new world transforms in the next Update
+	void SetLocalTransform(uint32_t node, const SimdMath::Float4x4& local);
+	// Moves the subtree of node under parent as its last child, or to the end as a root for kNoParent. parent is
+	// not in the subtree. The local transforms are kept, the subtree gets new world transforms in the next Update.
+	// The nodes between the old and the new place shift, order gets the previous index of every node: owners of
+	// per node data remap it. Returns the new index of node.
+	uint32_t SetParent(uint32_t node, uint32_t parent, std::vector<uint32_t>& order);
+	// Of the last Update
+	const SimdMath::Float4x4& GetWorldTransform(uint32_t node) const { return m_worldTransforms[node]; }
+
+	// changedNodes gets the nodes of the recomputed subtrees in increasing order.
+	// threadsCount 0 is the hardware concurrency, small updates stay on the calling thread.
+	void Update(std::vector<uint32_t>& changedNodes, uint32_t threadsCount = 0);
+
+	struct BenchmarkReport
+	{
+		uint32_t nodesCount = 0;
+		uint32_t changedCount = 0;
+		uint32_t threadsCount = 0;
+		// Every node dirty
+		double fullMilliseconds = 0.0;
+		double fullParallelMilliseconds = 0.0;
+		// The subtrees of the moved nodes dirty
+		double partialMilliseconds = 0.0;
+	};
+
+	// Random tree of nodesCount nodes 32 deep at most, movedCount local transforms changed for the
+	// partial update. Timing only, SceneGraphTests.cpp checks the transforms.
+	static BenchmarkReport Benchmark(uint32_t nodesCount, uint32_t movedCount);
+
+private:
+	std::vector<uint32_t> m_parents;
+	std::vector<uint32_t> m_subtreeEnds;
+	std::vector<SimdMath::Float4x4> m_localTransforms;
+	std::vector<SimdMath::Float4x4> m_worldTransforms;
+	// Bytes, threads write the flags of different subtrees
+	std::vector<uint8_t> m_dirtyFlags;
+	bool m_isDirty = false;
+
+	// Roots of subtrees to recompute, for the threads. The nodes above them are computed.
+	std::vector<uint32_t> m_tasks;
+
+	void UpdateNode(uint32_t node);
+	void UpdateSubtree(uint32_t root);
+	// Computes the large subtrees down to the subtrees a task takes
+	void SplitSubtree(uint32_t root);
+};
@@ -1,26 +1,41 @@
+#include <algorithm>
+#include <cfloat>
+#if defined(_WIN32)
 #include <d3dx12.h>
 
 #include "DxHelpers.h"
+#endif
 #include "SceneObject.h"
+#if defined(_WIN32)
+#include "UploadService.h"
+#endif
 
 
-using namespace DirectX;
+using namespace SimdMath;
+#if defined(_WIN32)
 using namespace DxHelper;
+#endif
 
 
-SceneObject::SceneObject(aiMesh* mesh, aiMatrix4x4 transformMatrix)
+SceneObject::SceneObject(aiMesh* mesh)
 {
 	m_vertices.resize(mesh->mNumVertices);
+	m_boundsMin = Float3(FLT_MAX, FLT_MAX, FLT_MAX);
+	m_boundsMax = Float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
 	for (uint32_t n = 0; n < mesh->mNumVertices; n++)
 	{
 		const auto& position = mesh->mVertices[n];
 		const auto& color = mesh->mColors[0][n];
 		const auto& normal = mesh->mNormals[n];
 
-		m_vertices[n].position = XMFLOAT4(position.x, position.y, position.z, 1.0f);
+		m_vertices[n].position = Float4(position.x, position.y, position.z, 1.0f);
+		m_boundsMin = Float3(std::min(m_boundsMin.x, position.x), std::min(m_boundsMin.y, position.y),
+			std::min(m_boundsMin.z, position.z));
+		m_boundsMax = Float3(std::max(m_boundsMax.x, position.x), std::max(m_boundsMax.y, position.y),
+			std::max(m_boundsMax.z, position.z));
 		if (mesh->HasVertexColors(0))
-			m_vertices[n].color = XMFLOAT4(color.r, color.g, color.b, color.a);
-		m_vertices[n].normal = XMFLOAT4(normal.x, normal.y, normal.z, 0.0f);
+			m_vertices[n].color = Float4(color.r, color.g, color.b, color.a);
+		m_vertices[n].normal = Float4(normal.x, normal.y, normal.z, 0.0f);
 	}
 
 	// Support only triangles
@@ -34,60 +49,57 @@ SceneObject::SceneObject(aiMesh* mesh, aiMatrix4x4 transformMatrix)
 			m_indices.push_back(primitive.mIndices[n]);
 		}
 	}
+}
+
 
-	m_transformMatrix = XMFLOAT4X4(reinterpret_cast<const float*>(&transformMatrix.Transpose()));
+SceneObject::SceneObject(StaticBatching::Cluster&& cluster)
+	: m_vertices(std::move(cluster.vertices)), m_indices(std::move(cluster.indices)), m_boundsMin(cluster.boundsMin),
+	m_boundsMax(cluster.boundsMax)
+{
+}
+
+
+StaticBatching::Source SceneObject::GetBatchingSource(const Float4x4& model) const
+{
+	StaticBatching::Source source;
+	source.vertices = m_vertices.data();
+	source.verticesCount = GetVerticesCount();
+	source.indices = m_indices.data();
+	source.indicesCount = GetIndicesCount();
+	source.model = model;
+	source.boundsMin = m_boundsMin;
+	source.boundsMax = m_boundsMax;
+	return source;
 }
 
 
-void SceneObject::CreateRenderResources(ID3D12Device* device, ID3D12GraphicsCommandList* commandList)
+#if defined(_WIN32)
+void SceneObject::CreateRenderResources(GpuHeapAllocator& heapAllocator, UploadService& uploadService)
 {
 	const uint32_t vertexBufferSize = static_cast<uint32_t>(m_vertices.size()) * sizeof(Vertex);
+	const uint32_t positionBufferSize = static_cast<uint32_t>(m_vertices.size()) * sizeof(Float3);
 	const uint32_t indexBufferSize = static_cast<uint32_t>(m_indices.size()) * sizeof(uint32_t);
 
-	const auto vertexBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(vertexBufferSize);
-	const auto indexBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(indexBufferSize);
+	// The depth pre-pass fetches 12 bytes per vertex instead of the whole vertex
+	std::vector<Float3> positions(m_vertices.size());
+	for (uint32_t n = 0; n < m_vertices.size(); n++)
+		positions[n] = Float3(m_vertices[n].position.x, m_vertices[n].position.y, m_vertices[n].position.z);
 
-	// Create and fill upload heaps
-	{
-		const auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-		DxVerify(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &vertexBufferDesc,
-			D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-			IID_PPV_ARGS(&m_vertexBufferUpload)));
-		DxVerify(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &indexBufferDesc,
-			D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_indexBufferUpload)));
-
-		uint8_t* dataPointer;
-		const auto readRange = CD3DX12_RANGE(0, 0);
-
-		DxVerify(m_vertexBufferUpload->Map(0, &readRange, reinterpret_cast<void**>(&dataPointer)));
-		memcpy(dataPointer, m_vertices.data(), vertexBufferSize);
-		m_vertexBufferUpload->Unmap(0, nullptr);
-
-		DxVerify(m_indexBufferUpload->Map(0, &readRange, reinterpret_cast<void**>(&dataPointer)));
-		memcpy(dataPointer, m_indices.data(), indexBufferSize);
-		m_indexBufferUpload->Unmap(0, nullptr);
-	}
+	const auto vertexBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(vertexBufferSize + positionBufferSize);
+	const auto indexBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(indexBufferSize);
 
-	// Create Default heap buffers and write copy commands to commandList
+	// Create Default heap buffers and queue copies from the staging ring.
+	// Buffers are created in the common state: copy queue promotes them to copy dest,
+	// direct queue promotes them to vertex/index buffer states
 	{
-		const auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-		DxVerify(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &vertexBufferDesc,
-			D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
-			IID_PPV_ARGS(&m_vertexBuffer)));
-		DxVerify(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &indexBufferDesc,
-			D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
-			IID_PPV_ARGS(&m_indexBuffer)));
-
-		commandList->CopyResource(m_vertexBuffer.Get(), m_vertexBufferUpload.Get());
-		commandList->CopyResource(m_indexBuffer.Get(), m_indexBufferUpload.Get());
-
-		const CD3DX12_RESOURCE_BARRIER barriers[] = {
-			CD3DX12_RESOURCE_BARRIER::Transition(m_vertexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST,
-												 D3D12_RESOURCE_STATE_GENERIC_READ),
-			CD3DX12_RESOURCE_BARRIER::Transition(m_indexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST,
-												 D3D12_RESOURCE_STATE_GENERIC_READ)
-		};
-		commandList->ResourceBarrier(2, barriers);
+		m_vertexBufferAllocation = heapAllocator.CreateResource(GpuHeapCategory::Buffers, vertexBufferDesc,
+			D3D12_RESOURCE_STATE_COMMON, nullptr, m_vertexBuffer);
+		m_indexBufferAllocation = heapAllocator.CreateResource(GpuHeapCategory::Buffers, indexBufferDesc,
+			D3D12_RESOURCE_STATE_COMMON, nullptr, m_indexBuffer);
+
+		uploadService.UploadBuffer(m_vertexBuffer.Get(), 0, m_vertices.data(), vertexBufferSize);
+		uploadService.UploadBuffer(m_vertexBuffer.Get(), vertexBufferSize, positions.data(), positionBufferSize);
+		uploadService.UploadBuffer(m_indexBuffer.Get(), 0, m_indices.data(), indexBufferSize);
 	}
 
 	// Create vertex and index buffer descriptors
@@ -96,6 +108,10 @@ void SceneObject::CreateRenderResources(ID3D12Device* device, ID3D12GraphicsComm
 		m_vertexBufferView.SizeInBytes = vertexBufferSize;
 		m_vertexBufferView.StrideInBytes = sizeof(Vertex);
 
+		m_positionBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress() + vertexBufferSize;
+		m_positionBufferView.SizeInBytes = positionBufferSize;
+		m_positionBufferView.StrideInBytes = sizeof(Float3);
+
 		m_indexBufferView.BufferLocation = m_indexBuffer->GetGPUVirtualAddress();
 		m_indexBufferView.SizeInBytes = indexBufferSize;
 		m_indexBufferView.Format = DXGI_FORMAT_R32_UINT;
@@ -103,17 +119,27 @@ void SceneObject::CreateRenderResources(ID3D12Device* device, ID3D12GraphicsComm
 }
 
 
-void SceneObject::DestroyUploadResources()
+void SceneObject::DestroyRendererResources(GpuHeapAllocator& heapAllocator)
 {
-	m_vertexBufferUpload.Reset();
-	m_indexBufferUpload.Reset();
+	m_isResident = false;
+	m_vertexBufferView = {};
+	m_positionBufferView = {};
+	m_vertexBuffer.Reset();
+	heapAllocator.Free(m_vertexBufferAllocation);
+	m_indexBufferView = {};
+	m_indexBuffer.Reset();
+	heapAllocator.Free(m_indexBufferAllocation);
 }
 
 
-void SceneObject::DestroyRendererResources()
+void SceneObject::ReleaseRendererResources(GpuHeapAllocator& heapAllocator, DeferredReleaseQueue& releaseQueue,
+	uint64_t fenceValue)
 {
+	m_isResident = false;
 	m_vertexBufferView = {};
-	m_vertexBufferUpload.Reset();
+	m_positionBufferView = {};
+	heapAllocator.FreeDeferred(releaseQueue, fenceValue, m_vertexBuffer, m_vertexBufferAllocation);
 	m_indexBufferView = {};
-	m_indexBufferUpload.Reset();
+	heapAllocator.FreeDeferred(releaseQueue, fenceValue, m_indexBuffer, m_indexBufferAllocation);
 }
+#endif
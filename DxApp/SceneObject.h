@@ -1,53 +1,92 @@
 #pragma once
 
-#include <wrl.h>
 #include <chrono>
 #include <cstdint>
-#include <DirectXMath.h>
+#include <vector>
+#include "SimdMath.h"
+#if defined(_WIN32)
+#include <wrl.h>
 #include <d3d12.h>
+#endif
 
 #include <assimp/cimport.h>
 #include <assimp/scene.h>
 
+#if defined(_WIN32)
+#include "GpuHeapAllocator.h"
+#endif
+#include "StaticBatching.h"
+
+
+#if defined(_WIN32)
+class UploadService;
 
 using namespace Microsoft::WRL;
+#endif
 
-// Static scene object
+// Mesh of the scene objects: the vertices, the indices and their GPU buffers. The objects placing it are in Scene.
 class SceneObject
 {
 public:
+	using Vertex = StaticBatching::Vertex;
+
 	SceneObject() = delete;
-	explicit SceneObject(aiMesh* mesh, aiMatrix4x4 transformMatrix);
+	explicit SceneObject(aiMesh* mesh);
+	// World space vertices of the batched objects, placed with the identity
+	explicit SceneObject(StaticBatching::Cluster&& cluster);
 
-	void CreateRenderResources(ID3D12Device* device, ID3D12GraphicsCommandList* commandList);
-	void DestroyUploadResources();
-	void DestroyRendererResources();
+#if defined(_WIN32)
+	void CreateRenderResources(GpuHeapAllocator& heapAllocator, UploadService& uploadService);
+	void DestroyRendererResources(GpuHeapAllocator& heapAllocator);
+	// Same as DestroyRendererResources, but the GPU memory is freed only after fenceValue is completed
+	void ReleaseRendererResources(GpuHeapAllocator& heapAllocator, DeferredReleaseQueue& releaseQueue,
+		uint64_t fenceValue);
+#endif
 
+	uint32_t GetVerticesCount() const { return static_cast<uint32_t>(m_vertices.size()); }
 	uint32_t GetIndicesCount() const { return static_cast<uint32_t>(m_indices.size()); }
 
-	D3D12_VERTEX_BUFFER_VIEW& GetVertexBufferView() { return m_vertexBufferView; }
-	D3D12_INDEX_BUFFER_VIEW& GetIndexBufferView() { return m_indexBufferView; }
+	// Object space data the GPU buffers are created from
+	const std::vector<Vertex>& GetVertices() const { return m_vertices; }
+	const std::vector<uint32_t>& GetIndices() const { return m_indices; }
 
-	DirectX::XMFLOAT4X4& GetTransformMatrix() { return m_transformMatrix; }
+#if defined(_WIN32)
+	// Raw buffers for the passes fetching vertices in the shaders
+	ID3D12Resource* GetVertexBuffer() const { return m_vertexBuffer.Get(); }
+	ID3D12Resource* GetIndexBuffer() const { return m_indexBuffer.Get(); }
 
-private:
-	struct Vertex
-	{
-		DirectX::XMFLOAT4 position;
-		DirectX::XMFLOAT4 color;
-		DirectX::XMFLOAT4 normal;
-	};
+	const D3D12_VERTEX_BUFFER_VIEW& GetVertexBufferView() const { return m_vertexBufferView; }
+	// Positions only, for the depth pre-pass. They follow the vertices in the same buffer.
+	const D3D12_VERTEX_BUFFER_VIEW& GetPositionBufferView() const { return m_positionBufferView; }
+	const D3D12_INDEX_BUFFER_VIEW& GetIndexBufferView() const { return m_indexBufferView; }
+#endif
+
+	// The upload of the GPU buffers is completed, the objects of the mesh can be drawn
+	bool IsResident() const { return m_isResident; }
+	void SetResident(bool isResident) { m_isResident = isResident; }
 
+	// References the vertices and indices, placed by model
+	StaticBatching::Source GetBatchingSource(const SimdMath::Float4x4& model) const;
+	// Object space bounds of the vertices
+	const SimdMath::Float3& GetBoundsMin() const { return m_boundsMin; }
+	const SimdMath::Float3& GetBoundsMax() const { return m_boundsMax; }
+
+private:
 	std::vector<Vertex> m_vertices;
 	std::vector<uint32_t> m_indices;
 
+#if defined(_WIN32)
 	// DirectX resources:
-	ComPtr<ID3D12Resource> m_vertexBufferUpload;
-	ComPtr<ID3D12Resource> m_indexBufferUpload;
 	ComPtr<ID3D12Resource> m_vertexBuffer;
 	ComPtr<ID3D12Resource> m_indexBuffer;
+	GpuAllocation m_vertexBufferAllocation;
+	GpuAllocation m_indexBufferAllocation;
 	D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
+	D3D12_VERTEX_BUFFER_VIEW m_positionBufferView;
 	D3D12_INDEX_BUFFER_VIEW m_indexBufferView;
+#endif
 
-	DirectX::XMFLOAT4X4 m_transformMatrix;
+	SimdMath::Float3 m_boundsMin;
+	SimdMath::Float3 m_boundsMax;
+	bool m_isResident = false;
 };
@@ -0,0 +1,79 @@
+#include "SceneObjectSlots.h"
+
+
+uint32_t SceneObjectSlots::Allocate(uint32_t mesh)
+{
+	uint32_t slot;
+	if (!m_freeSlots.empty())
+	{
+		slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+	else
+	{
+		if (GetSlotsCount() >= m_maxSlotsCount)
+			return kInvalidSlot;
+		slot = GetSlotsCount();
+		m_alive.push_back(0);
+		m_meshes.push_back(0);
+		m_meshSlotPositions.push_back(0);
+		if (slot == m_generations.size())
+			m_generations.push_back(0);
+	}
+
+	// Meshes added since the last object have no list yet
+	if (mesh >= m_meshSlots.size())
+		m_meshSlots.resize(mesh + 1);
+	m_meshSlotPositions[slot] = static_cast<uint32_t>(m_meshSlots[mesh].size());
+	m_meshSlots[mesh].push_back(slot);
+
+	m_meshes[slot] = mesh;
+	m_alive[slot] = 1;
+	m_aliveCount++;
+	return slot;
+}
+
+bool SceneObjectSlots::Free(SceneObjectHandle handle)
+{
+	if (!IsValid(handle))
+		return false;
+
+	const uint32_t slot = handle.slot;
+	auto& meshSlots = m_meshSlots[m_meshes[slot]];
+	const uint32_t lastSlot = meshSlots.back();
+	meshSlots[m_meshSlotPositions[slot]] = lastSlot;
+	m_meshSlotPositions[lastSlot] = m_meshSlotPositions[slot];
+	meshSlots.pop_back();
+
+	m_alive[slot] = 0;
+	m_generations[slot]++;
+	m_freeSlots.push_back(slot);
+	m_aliveCount--;
+	return true;
+}
+
+void SceneObjectSlots::Clear()
+{
+	for (uint32_t slot = 0; slot < GetSlotsCount(); slot++)
+	{
+		if (IsAlive(slot))
+			m_generations[slot]++;
+	}
+	m_alive.clear();
+	m_meshes.clear();
+	m_freeSlots.clear();
+	m_aliveCount = 0;
+	m_meshSlots.clear();
+	m_meshSlotPositions.clear();
+}
+
+bool SceneObjectSlots::IsValid(SceneObjectHandle handle) const
+{
+	return handle.slot < GetSlotsCount() && IsAlive(handle.slot) && m_generations[handle.slot] == handle.generation;
+}
+
+const std::vector<uint32_t>& SceneObjectSlots::GetMeshSlots(uint32_t mesh) const
+{
+	static const std::vector<uint32_t> kNoSlots;
+	return mesh < m_meshSlots.size() ? m_meshSlots[mesh] : kNoSlots;
+}
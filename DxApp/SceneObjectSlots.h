@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+
+// Names a scene object until it is removed, the slot is reused with the next generation afterwards
+struct SceneObjectHandle
+{
+	uint32_t slot = UINT32_MAX;
+	uint32_t generation = 0;
+
+	bool operator==(const SceneObjectHandle&) const = default;
+};
+
+
+// Slot bookkeeping of Scene, without its per slot data: the handle generations, the free slots and the alive
+// slots referencing each mesh. Stale handles are refused, they change nothing.
+class SceneObjectSlots
+{
+public:
+	static constexpr uint32_t kInvalidSlot = UINT32_MAX;
+
+	// Reuses the last freed slot when there is one, appends a slot otherwise. kInvalidSlot when the slots are
+	// at the limit and none is free.
+	uint32_t Allocate(uint32_t mesh);
+	// False for a stale or invalid handle
+	bool Free(SceneObjectHandle handle);
+	// Frees every slot, the handles of the cleared slots stay invalid
+	void Clear();
+	// Slots appended past it are refused, the existing ones are kept
+	void SetMaxSlotsCount(uint32_t count) { m_maxSlotsCount = count; }
+
+	bool IsValid(SceneObjectHandle handle) const;
+	// kInvalidSlot for a stale or invalid handle
+	uint32_t GetSlot(SceneObjectHandle handle) const { return IsValid(handle) ? handle.slot : kInvalidSlot; }
+	SceneObjectHandle GetHandle(uint32_t slot) const { return { slot, m_generations[slot] }; }
+
+	uint32_t GetSlotsCount() const { return static_cast<uint32_t>(m_alive.size()); }
+	uint32_t GetAliveCount() const { return m_aliveCount; }
+	bool IsAlive(uint32_t slot) const { return m_alive[slot] != 0; }
+	// Per slot, stale for the dead slots
+	const std::vector<uint32_t>& GetMeshes() const { return m_meshes; }
+	// Alive slots referencing the mesh, unordered
+	const std::vector<uint32_t>& GetMeshSlots(uint32_t mesh) const;
+
+private:
+	std::vector<uint8_t> m_alive;
+	std::vector<uint32_t> m_meshes;
+	// Outlive the slots, the handles of a cleared storage stay invalid
+	std::vector<uint32_t> m_generations;
+	std::vector<uint32_t> m_freeSlots;
+	uint32_t m_aliveCount = 0;
+	uint32_t m_maxSlotsCount = UINT32_MAX;
+	// Alive slots of each mesh and the position of every alive slot in the list of its mesh
+	std::vector<std::vector<uint32_t>> m_meshSlots;
+	std::vector<uint32_t> m_meshSlotPositions;
+};
@@ -0,0 +1,790 @@
+#include "SceneQuery.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <random>
+
+
+using namespace SimdMath;
+
+
+// 4 rays, lane i of every vector is ray i
+struct SceneQuery::RayPacket
+{
+	Vector origin[3];
+	Vector direction[3];
+	Vector inverseDirection[3];
+	// -origin * inverseDirection, the slab distances are one multiply-add
+	Vector scaledOrigin[3];
+	// Lanes parallel to the slabs of the axis, their directions were clamped
+	Vector isParallel[3];
+};
+
+
+struct SceneQuery::PacketHits
+{
+	// Max distances of the rays, then of their closest hits
+	Vector distance;
+	uint32_t objects[kPacketSize];
+	uint32_t triangles[kPacketSize];
+	float u[kPacketSize];
+	float v[kPacketSize];
+	uint32_t anyHitLanes = 0;
+};
+
+
+namespace
+{
+	// Below it the directions are clamped, the slab distances stay finite
+	constexpr float kMinDirection = 1e-30f;
+	constexpr float kMinDeterminant = 1e-30f;
+
+	double GetSeconds(std::chrono::high_resolution_clock::time_point startTime)
+	{
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+
+	// Shared by both levels, the mesh traversals start above the entries of the top level one
+	std::vector<uint32_t>& GetTraversalStack()
+	{
+		thread_local std::vector<uint32_t> stack;
+		return stack;
+	}
+
+	void SetInverseDirection(SceneQuery::RayPacket& packet);
+
+	Vector Replicate(const Float3& value, uint32_t axis)
+	{
+		return VectorReplicate((&value.x)[axis]);
+	}
+
+	// Lanes entering the box before their max distances
+	uint32_t IntersectBox(const SceneQuery::RayPacket& packet, Vector maxDistance, const Aabb& box,
+		Vector& nearDistance)
+	{
+		nearDistance = VectorZero();
+		Vector farDistance = maxDistance;
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			const Vector distance0 = VectorMultiplyAdd(Replicate(box.minCorner, axis), packet.inverseDirection[axis],
+				packet.scaledOrigin[axis]);
+			const Vector distance1 = VectorMultiplyAdd(Replicate(box.maxCorner, axis), packet.inverseDirection[axis],
+				packet.scaledOrigin[axis]);
+			nearDistance = VectorMax(nearDistance, VectorMin(distance0, distance1));
+			// A parallel ray starting on the far face leaves the slab at 0, it never leaves a slab it starts in
+			const Vector slabFarDistance = VectorMax(distance0, distance1);
+			farDistance = VectorMin(farDistance, VectorSelect(slabFarDistance, maxDistance,
+				VectorAndInt(packet.isParallel[axis], VectorGreaterOrEqual(slabFarDistance, VectorZero()))));
+		}
+		return VectorMoveMask(VectorLessOrEqual(nearDistance, farDistance));
+	}
+
+	// Both children some lane enters, the nearer one on top
+	void PushChildren(const std::vector<Bvh::Node>& nodes, const Bvh::Node& node, const SceneQuery::RayPacket& packet,
+		Vector maxDistance, uint32_t activeLanes, std::vector<uint32_t>& stack)
+	{
+		Vector leftNear;
+		Vector rightNear;
+		const uint32_t leftLanes = IntersectBox(packet, maxDistance, nodes[node.first].bounds, leftNear) & activeLanes;
+		const uint32_t rightLanes = IntersectBox(packet, maxDistance, nodes[node.first + 1].bounds, rightNear)
+			& activeLanes;
+		if (leftLanes && rightLanes)
+		{
+			const uint32_t bothLanes = leftLanes & rightLanes;
+			bool isLeftNearer = std::popcount(leftLanes) >= std::popcount(rightLanes);
+			if (bothLanes)
+			{
+				const uint32_t lane = std::countr_zero(bothLanes);
+				isLeftNearer = VectorGetByIndex(leftNear, lane) <= VectorGetByIndex(rightNear, lane);
+			}
+			stack.push_back(isLeftNearer ? node.first + 1 : node.first);
+			stack.push_back(isLeftNearer ? node.first : node.first + 1);
+		}
+		else if (leftLanes)
+		{
+			stack.push_back(node.first);
+		}
+		else if (rightLanes)
+		{
+			stack.push_back(node.first + 1);
+		}
+	}
+
+	// Moller-Trumbore, the lanes hitting the front or the back of the triangle in (0, maxDistance)
+	Vector IntersectTriangle(const SceneQuery::RayPacket& packet, Vector maxDistance, const Float3& vertex,
+		const Float3& edge1, const Float3& edge2, Vector& distance, Vector& u, Vector& v)
+	{
+		const Vector* direction = packet.direction;
+		const Vector e1[3] = { Replicate(edge1, 0), Replicate(edge1, 1), Replicate(edge1, 2) };
+		const Vector e2[3] = { Replicate(edge2, 0), Replicate(edge2, 1), Replicate(edge2, 2) };
+
+		const Vector p[3] = { direction[1] * e2[2] - direction[2] * e2[1], direction[2] * e2[0] - direction[0] * e2[2],
+			direction[0] * e2[1] - direction[1] * e2[0] };
+		const Vector determinant = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+		const Vector inverseDeterminant = VectorReplicate(1.0f) / determinant;
+
+		const Vector t[3] = { packet.origin[0] - Replicate(vertex, 0), packet.origin[1] - Replicate(vertex, 1),
+			packet.origin[2] - Replicate(vertex, 2) };
+		u = (t[0] * p[0] + t[1] * p[1] + t[2] * p[2]) * inverseDeterminant;
+		const Vector q[3] = { t[1] * e1[2] - t[2] * e1[1], t[2] * e1[0] - t[0] * e1[2], t[0] * e1[1] - t[1] * e1[0] };
+		v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) * inverseDeterminant;
+		distance = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inverseDeterminant;
+
+		const Vector zero = VectorZero();
+		Vector mask = VectorGreater(VectorAbs(determinant), VectorReplicate(kMinDeterminant));
+		mask = VectorAndInt(mask, VectorAndInt(VectorGreaterOrEqual(u, zero), VectorGreaterOrEqual(v, zero)));
+		mask = VectorAndInt(mask, VectorLessOrEqual(u + v, VectorReplicate(1.0f)));
+		return VectorAndInt(mask, VectorAndInt(VectorGreater(distance, zero), VectorLess(distance, maxDistance)));
+	}
+
+	void SetInverseDirection(SceneQuery::RayPacket& packet)
+	{
+		const Vector minDirection = VectorReplicate(kMinDirection);
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			packet.isParallel[axis] = VectorLess(VectorAbs(packet.direction[axis]), minDirection);
+			const Vector direction = VectorSelect(packet.direction[axis], minDirection, packet.isParallel[axis]);
+			packet.inverseDirection[axis] = VectorReplicate(1.0f) / direction;
+			packet.scaledOrigin[axis] = -(packet.origin[axis] * packet.inverseDirection[axis]);
+		}
+	}
+
+	// The missing lanes repeat the last ray
+	SceneQuery::RayPacket LoadPacket(const SceneQuery::Ray* rays, uint32_t raysCount, Vector& maxDistance)
+	{
+		Float4 values[7];
+		for (uint32_t lane = 0; lane < SceneQuery::kPacketSize; lane++)
+		{
+			const SceneQuery::Ray& ray = rays[std::min(lane, raysCount - 1)];
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				(&values[axis].x)[lane] = (&ray.origin.x)[axis];
+				(&values[3 + axis].x)[lane] = (&ray.direction.x)[axis];
+			}
+			(&values[6].x)[lane] = ray.maxDistance;
+		}
+
+		SceneQuery::RayPacket packet;
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			packet.origin[axis] = LoadFloat4(values[axis]);
+			packet.direction[axis] = LoadFloat4(values[3 + axis]);
+		}
+		SetInverseDirection(packet);
+		maxDistance = LoadFloat4(values[6]);
+		return packet;
+	}
+
+	// Row vectors, the origins are points and the directions vectors
+	SceneQuery::RayPacket TransformPacket(const SceneQuery::RayPacket& packet, const Float4x4& matrix)
+	{
+		SceneQuery::RayPacket result;
+		for (uint32_t column = 0; column < 3; column++)
+		{
+			const Vector row0 = VectorReplicate(matrix.m[0][column]);
+			const Vector row1 = VectorReplicate(matrix.m[1][column]);
+			const Vector row2 = VectorReplicate(matrix.m[2][column]);
+			const Vector row3 = VectorReplicate(matrix.m[3][column]);
+			result.origin[column] = VectorMultiplyAdd(packet.origin[0], row0,
+				VectorMultiplyAdd(packet.origin[1], row1, VectorMultiplyAdd(packet.origin[2], row2, row3)));
+			result.direction[column] = VectorMultiplyAdd(packet.direction[0], row0,
+				VectorMultiplyAdd(packet.direction[1], row1, VectorMultiply(packet.direction[2], row2)));
+		}
+		SetInverseDirection(result);
+		return result;
+	}
+
+	// Separating axes of the box faces, the triangle plane and the edge cross products
+	bool TriangleIntersectsBox(Vector vertex0, Vector vertex1, Vector vertex2, Vector center, Vector extents)
+	{
+		Float3 vertices[3];
+		StoreFloat3(vertices[0], vertex0 - center);
+		StoreFloat3(vertices[1], vertex1 - center);
+		StoreFloat3(vertices[2], vertex2 - center);
+		Float3 halfSize;
+		StoreFloat3(halfSize, extents);
+		const float* e = &halfSize.x;
+
+		const auto isSeparating = [&](const Float3& axis) {
+			float minProjection = FLT_MAX;
+			float maxProjection = -FLT_MAX;
+			for (const Float3& vertex : vertices)
+			{
+				const float projection = vertex.x * axis.x + vertex.y * axis.y + vertex.z * axis.z;
+				minProjection = std::min(minProjection, projection);
+				maxProjection = std::max(maxProjection, projection);
+			}
+			const float radius = e[0] * std::abs(axis.x) + e[1] * std::abs(axis.y) + e[2] * std::abs(axis.z);
+			return minProjection > radius || maxProjection < -radius;
+		};
+
+		const Float3 axes[3] = { Float3(1.0f, 0.0f, 0.0f), Float3(0.0f, 1.0f, 0.0f), Float3(0.0f, 0.0f, 1.0f) };
+		for (const Float3& axis : axes)
+		{
+			if (isSeparating(axis))
+				return false;
+		}
+
+		Float3 edges[3];
+		StoreFloat3(edges[0], vertex1 - vertex0);
+		StoreFloat3(edges[1], vertex2 - vertex1);
+		StoreFloat3(edges[2], vertex0 - vertex2);
+		const auto cross = [](const Float3& a, const Float3& b) {
+			return Float3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+		};
+		if (isSeparating(cross(edges[0], edges[1])))
+			return false;
+		for (const Float3& axis : axes)
+		{
+			for (const Float3& edge : edges)
+			{
+				if (isSeparating(cross(axis, edge)))
+					return false;
+			}
+		}
+		return true;
+	}
+
+	// Closest point of the triangle to the center, Ericson's Real-Time Collision Detection 5.1.5
+	bool TriangleIntersectsSphere(Vector a, Vector b, Vector c, Vector center, float radius)
+	{
+		const auto dot = [](Vector x, Vector y) { return VectorGetX(Vector3Dot(x, y)); };
+		const auto isInside = [&](Vector point) {
+			const Vector offset = point - center;
+			return dot(offset, offset) <= radius * radius;
+		};
+
+		const Vector ab = b - a;
+		const Vector ac = c - a;
+		const Vector ap = center - a;
+		const float d1 = dot(ab, ap);
+		const float d2 = dot(ac, ap);
+		if (d1 <= 0.0f && d2 <= 0.0f)
+			return isInside(a);
+
+		const Vector bp = center - b;
+		const float d3 = dot(ab, bp);
+		const float d4 = dot(ac, bp);
+		if (d3 >= 0.0f && d4 <= d3)
+			return isInside(b);
+
+		const float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+			return isInside(a + ab * (d1 / (d1 - d3)));
+
+		const Vector cp = center - c;
+		const float d5 = dot(ab, cp);
+		const float d6 = dot(ac, cp);
+		if (d6 >= 0.0f && d5 <= d6)
+			return isInside(c);
+
+		const float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+			return isInside(a + ac * (d2 / (d2 - d6)));
+
+		const float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+			return isInside(b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))));
+
+		// Degenerate triangles have no inside
+		const float denominator = va + vb + vc;
+		if (denominator == 0.0f)
+			return false;
+		return isInside(a + ab * (vb / denominator) + ac * (vc / denominator));
+	}
+}
+
+
+void SceneQuery::BuildMeshes(const std::vector<StaticBatching::Source>& meshes)
+{
+	m_meshes.clear();
+	m_meshes.reserve(meshes.size());
+	m_bvh = nullptr;
+	m_worldBounds = nullptr;
+	m_objectMeshes = nullptr;
+	m_models.clear();
+	m_inverseModels.clear();
+
+	for (const auto& mesh : meshes)
+		AddMesh(mesh);
+}
+
+uint32_t SceneQuery::AddMesh(const StaticBatching::Source& source)
+{
+	const uint32_t trianglesCount = source.indicesCount / 3;
+	const auto getPosition = [&](uint32_t triangle, uint32_t corner) {
+		return LoadFloat4(source.vertices[source.indices[triangle * 3 + corner]].position);
+	};
+
+	std::vector<Aabb> boxes(trianglesCount);
+	for (uint32_t triangle = 0; triangle < trianglesCount; triangle++)
+	{
+		Aabb box = AabbEmpty();
+		for (uint32_t corner = 0; corner < 3; corner++)
+			box = AabbAddPoint(box, getPosition(triangle, corner));
+		boxes[triangle] = box;
+	}
+
+	Mesh& mesh = m_meshes.emplace_back();
+	mesh.bvh.Build(boxes);
+	mesh.triangles.resize(trianglesCount);
+	for (uint32_t item = 0; item < trianglesCount; item++)
+	{
+		const uint32_t triangle = mesh.bvh.GetItems()[item];
+		const Vector vertex = getPosition(triangle, 0);
+		Triangle& value = mesh.triangles[item];
+		StoreFloat3(value.vertex, vertex);
+		StoreFloat3(value.edge1, getPosition(triangle, 1) - vertex);
+		StoreFloat3(value.edge2, getPosition(triangle, 2) - vertex);
+		value.index = triangle;
+	}
+	return static_cast<uint32_t>(m_meshes.size() - 1);
+}
+
+
+void SceneQuery::SetInstances(const Bvh& bvh, const std::vector<Aabb>& worldBounds,
+	const std::vector<uint32_t>& objectMeshes, const ObjectTransforms::Transforms& models,
+	const std::vector<uint32_t>& changedObjects)
+{
+	assert(worldBounds.size() == models.GetCount() && objectMeshes.size() == models.GetCount());
+	m_bvh = &bvh;
+	m_worldBounds = &worldBounds;
+	m_objectMeshes = &objectMeshes;
+
+	const auto updateObject = [&](uint32_t object) {
+		m_models[object] = models.Get(object);
+		StoreFloat4x4(m_inverseModels[object], MatrixInverse(LoadFloat4x4(m_models[object])));
+	};
+	// The objects past the previous count are new, changed or not
+	const uint32_t keptCount = std::min(static_cast<uint32_t>(m_models.size()), models.GetCount());
+	m_models.resize(models.GetCount());
+	m_inverseModels.resize(models.GetCount());
+	for (uint32_t object = keptCount; object < models.GetCount(); object++)
+		updateObject(object);
+	for (const uint32_t object : changedObjects)
+	{
+		if (object < keptCount)
+			updateObject(object);
+	}
+}
+
+
+SceneQuery::Hit SceneQuery::RayFirstHit(const Ray& ray) const
+{
+	Hit hit;
+	RayFirstHit(&ray, 1, &hit);
+	return hit;
+}
+
+
+bool SceneQuery::RayAnyHit(const Ray& ray) const
+{
+	bool hit = false;
+	RayAnyHit(&ray, 1, &hit);
+	return hit;
+}
+
+
+void SceneQuery::RayFirstHit(const Ray* rays, uint32_t raysCount, Hit* hits) const
+{
+	for (uint32_t first = 0; first < raysCount; first += kPacketSize)
+	{
+		const uint32_t count = std::min(kPacketSize, raysCount - first);
+		PacketHits packetHits;
+		const RayPacket packet = LoadPacket(rays + first, count, packetHits.distance);
+		std::fill(std::begin(packetHits.objects), std::end(packetHits.objects), kNoObject);
+		TracePacket(packet, (1u << count) - 1, false, packetHits);
+
+		Float4 distances;
+		StoreFloat4(distances, packetHits.distance);
+		for (uint32_t lane = 0; lane < count; lane++)
+		{
+			Hit& hit = hits[first + lane];
+			hit = Hit();
+			if (packetHits.objects[lane] == kNoObject)
+				continue;
+			hit.object = packetHits.objects[lane];
+			hit.triangle = packetHits.triangles[lane];
+			hit.distance = (&distances.x)[lane];
+			hit.u = packetHits.u[lane];
+			hit.v = packetHits.v[lane];
+		}
+	}
+}
+
+
+void SceneQuery::RayAnyHit(const Ray* rays, uint32_t raysCount, bool* hits) const
+{
+	for (uint32_t first = 0; first < raysCount; first += kPacketSize)
+	{
+		const uint32_t count = std::min(kPacketSize, raysCount - first);
+		PacketHits packetHits;
+		const RayPacket packet = LoadPacket(rays + first, count, packetHits.distance);
+		TracePacket(packet, (1u << count) - 1, true, packetHits);
+		for (uint32_t lane = 0; lane < count; lane++)
+			hits[first + lane] = (packetHits.anyHitLanes >> lane) & 1;
+	}
+}
+
+
+void SceneQuery::OverlapBox(const Aabb& box, std::vector<uint32_t>& objects) const
+{
+	const Vector minCorner = LoadFloat3(box.minCorner);
+	const Vector maxCorner = LoadFloat3(box.maxCorner);
+	const Vector half = VectorReplicate(0.5f);
+	const Vector center = (minCorner + maxCorner) * half;
+	const Vector extents = (maxCorner - minCorner) * half;
+	Overlap(box, [&](Vector vertex0, Vector vertex1, Vector vertex2) {
+		return TriangleIntersectsBox(vertex0, vertex1, vertex2, center, extents);
+	}, objects);
+}
+
+
+void SceneQuery::OverlapSphere(const Float3& center, float radius, std::vector<uint32_t>& objects) const
+{
+	const Aabb box = { Float3(center.x - radius, center.y - radius, center.z - radius),
+		Float3(center.x + radius, center.y + radius, center.z + radius) };
+	const Vector sphereCenter = LoadFloat3(center);
+	Overlap(box, [&](Vector vertex0, Vector vertex1, Vector vertex2) {
+		return TriangleIntersectsSphere(vertex0, vertex1, vertex2, sphereCenter, radius);
+	}, objects);
+}
+
+
+void SceneQuery::TracePacket(const RayPacket& packet, uint32_t activeLanes, bool isAnyHit, PacketHits& hits) const
+{
+	if (!m_bvh || m_bvh->GetNodes().empty())
+		return;
+	const auto& nodes = m_bvh->GetNodes();
+	const auto& items = m_bvh->GetItems();
+
+	Vector nearDistance;
+	if (!(IntersectBox(packet, hits.distance, nodes[0].bounds, nearDistance) & activeLanes))
+		return;
+
+	auto& stack = GetTraversalStack();
+	const size_t stackBase = stack.size();
+	stack.push_back(0);
+	while (stack.size() > stackBase && activeLanes)
+	{
+		const Bvh::Node& node = nodes[stack.back()];
+		stack.pop_back();
+		if (node.itemsCount == 0)
+		{
+			PushChildren(nodes, node, packet, hits.distance, activeLanes, stack);
+			continue;
+		}
+		for (uint32_t i = node.first; i < node.first + node.itemsCount && activeLanes; i++)
+		{
+			const uint32_t object = items[i];
+			if (IntersectBox(packet, hits.distance, (*m_worldBounds)[object], nearDistance) & activeLanes)
+				TraceMesh(object, packet, isAnyHit, activeLanes, hits);
+		}
+	}
+	stack.resize(stackBase);
+}
+
+
+void SceneQuery::TraceMesh(uint32_t object, const RayPacket& worldPacket, bool isAnyHit, uint32_t& activeLanes,
+	PacketHits& hits) const
+{
+	const Mesh& mesh = m_meshes[(*m_objectMeshes)[object]];
+	const auto& nodes = mesh.bvh.GetNodes();
+	if (nodes.empty())
+		return;
+
+	// Affine transforms keep the distances in direction lengths
+	const RayPacket packet = TransformPacket(worldPacket, m_inverseModels[object]);
+	Vector nearDistance;
+	if (!(IntersectBox(packet, hits.distance, nodes[0].bounds, nearDistance) & activeLanes))
+		return;
+
+	auto& stack = GetTraversalStack();
+	const size_t stackBase = stack.size();
+	stack.push_back(0);
+	while (stack.size() > stackBase && activeLanes)
+	{
+		const Bvh::Node& node = nodes[stack.back()];
+		stack.pop_back();
+		if (node.itemsCount == 0)
+		{
+			PushChildren(nodes, node, packet, hits.distance, activeLanes, stack);
+			continue;
+		}
+		for (uint32_t i = node.first; i < node.first + node.itemsCount; i++)
+		{
+			const Triangle& triangle = mesh.triangles[i];
+			Vector distance;
+			Vector u;
+			Vector v;
+			const Vector mask = IntersectTriangle(packet, hits.distance, triangle.vertex, triangle.edge1,
+				triangle.edge2, distance, u, v);
+			const uint32_t hitLanes = VectorMoveMask(mask) & activeLanes;
+			if (!hitLanes)
+				continue;
+
+			if (isAnyHit)
+			{
+				hits.anyHitLanes |= hitLanes;
+				activeLanes &= ~hitLanes;
+				if (!activeLanes)
+					break;
+				continue;
+			}
+
+			hits.distance = VectorSelect(hits.distance, distance, mask);
+			Float4 hitU;
+			Float4 hitV;
+			StoreFloat4(hitU, u);
+			StoreFloat4(hitV, v);
+			for (uint32_t lanes = hitLanes; lanes; lanes &= lanes - 1)
+			{
+				const uint32_t lane = std::countr_zero(lanes);
+				hits.objects[lane] = object;
+				hits.triangles[lane] = triangle.index;
+				hits.u[lane] = (&hitU.x)[lane];
+				hits.v[lane] = (&hitV.x)[lane];
+			}
+		}
+	}
+	stack.resize(stackBase);
+}
+
+
+template <typename TriangleTest>
+void SceneQuery::Overlap(const Aabb& box, const TriangleTest& triangleTest, std::vector<uint32_t>& objects) const
+{
+	objects.clear();
+	if (!m_bvh || m_bvh->GetNodes().empty())
+		return;
+	const auto& nodes = m_bvh->GetNodes();
+	const auto& items = m_bvh->GetItems();
+
+	// The triangles are tested in world space, the object space box only culls the nodes
+	const auto overlapsMesh = [&](uint32_t object, std::vector<uint32_t>& stack) {
+		const Mesh& mesh = m_meshes[(*m_objectMeshes)[object]];
+		const auto& meshNodes = mesh.bvh.GetNodes();
+		if (meshNodes.empty())
+			return false;
+		const Aabb objectBox = AabbTransform(box, LoadFloat4x4(m_inverseModels[object]));
+		const Matrix model = LoadFloat4x4(m_models[object]);
+
+		const size_t stackBase = stack.size();
+		stack.push_back(0);
+		while (stack.size() > stackBase)
+		{
+			const Bvh::Node& node = meshNodes[stack.back()];
+			stack.pop_back();
+			if (!AabbIntersectsAabb(node.bounds, objectBox))
+				continue;
+			if (node.itemsCount == 0)
+			{
+				stack.push_back(node.first);
+				stack.push_back(node.first + 1);
+				continue;
+			}
+			for (uint32_t i = node.first; i < node.first + node.itemsCount; i++)
+			{
+				const Triangle& triangle = mesh.triangles[i];
+				const Vector vertex = LoadFloat3(triangle.vertex);
+				if (triangleTest(Vector3TransformCoord(vertex, model),
+					Vector3TransformCoord(vertex + LoadFloat3(triangle.edge1), model),
+					Vector3TransformCoord(vertex + LoadFloat3(triangle.edge2), model)))
+				{
+					stack.resize(stackBase);
+					return true;
+				}
+			}
+		}
+		return false;
+	};
+
+	auto& stack = GetTraversalStack();
+	const size_t stackBase = stack.size();
+	stack.push_back(0);
+	while (stack.size() > stackBase)
+	{
+		const Bvh::Node& node = nodes[stack.back()];
+		stack.pop_back();
+		if (!AabbIntersectsAabb(node.bounds, box))
+			continue;
+		if (node.itemsCount == 0)
+		{
+			stack.push_back(node.first);
+			stack.push_back(node.first + 1);
+			continue;
+		}
+		for (uint32_t i = node.first; i < node.first + node.itemsCount; i++)
+		{
+			const uint32_t object = items[i];
+			if (AabbIntersectsAabb((*m_worldBounds)[object], box) && overlapsMesh(object, stack))
+				objects.push_back(object);
+		}
+	}
+}
+
+
+SceneQuery::BenchmarkReport SceneQuery::Benchmark(uint32_t objectsCount, uint32_t raysCount)
+{
+	constexpr float kSceneSize = 200.0f;
+	constexpr uint32_t kSegmentsCount = 16;
+	constexpr uint32_t kRingsCount = 16;
+	constexpr uint32_t kOverlapsCount = 1024;
+
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<float> positionDistribution(0.0f, kSceneSize);
+	std::uniform_real_distribution<float> scaleDistribution(1.0f, 5.0f);
+	std::uniform_real_distribution<float> angleDistribution(0.0f, k2Pi);
+	std::uniform_real_distribution<float> unitDistribution(-1.0f, 1.0f);
+
+	// Unit sphere, the poles are rings of degenerate triangles
+	std::vector<StaticBatching::Vertex> vertices;
+	for (uint32_t ring = 0; ring <= kRingsCount; ring++)
+	{
+		const float polar = kPi * ring / kRingsCount;
+		for (uint32_t segment = 0; segment <= kSegmentsCount; segment++)
+		{
+			const float azimuth = k2Pi * segment / kSegmentsCount;
+			StaticBatching::Vertex vertex = {};
+			vertex.position = Float4(std::sin(polar) * std::cos(azimuth), std::cos(polar),
+				std::sin(polar) * std::sin(azimuth), 1.0f);
+			vertices.push_back(vertex);
+		}
+	}
+	std::vector<uint32_t> indices;
+	for (uint32_t ring = 0; ring < kRingsCount; ring++)
+	{
+		for (uint32_t segment = 0; segment < kSegmentsCount; segment++)
+		{
+			const uint32_t first = ring * (kSegmentsCount + 1) + segment;
+			const uint32_t below = first + kSegmentsCount + 1;
+			indices.insert(indices.end(), { first, below, first + 1, first + 1, below, below + 1 });
+		}
+	}
+
+	BenchmarkReport report;
+	report.objectsCount = objectsCount;
+	report.trianglesCount = objectsCount * static_cast<uint32_t>(indices.size() / 3);
+	report.raysCount = raysCount;
+
+	StaticBatching::Source mesh;
+	mesh.vertices = vertices.data();
+	mesh.verticesCount = static_cast<uint32_t>(vertices.size());
+	mesh.indices = indices.data();
+	mesh.indicesCount = static_cast<uint32_t>(indices.size());
+	const Aabb meshBounds = { Float3(-1.0f, -1.0f, -1.0f), Float3(1.0f, 1.0f, 1.0f) };
+
+	ObjectTransforms::Transforms models;
+	models.Resize(objectsCount);
+	std::vector<Aabb> worldBounds(objectsCount);
+	for (uint32_t object = 0; object < objectsCount; object++)
+	{
+		const Matrix model = MatrixScaling(scaleDistribution(generator), scaleDistribution(generator),
+			scaleDistribution(generator)) * MatrixRotationY(angleDistribution(generator))
+			* MatrixTranslation(positionDistribution(generator), positionDistribution(generator),
+				positionDistribution(generator));
+		Float4x4 value;
+		StoreFloat4x4(value, model);
+		models.Set(object, value);
+		worldBounds[object] = AabbTransform(meshBounds, model);
+	}
+
+	SceneQuery query;
+	query.BuildMeshes({ mesh });
+	Bvh bvh;
+	bvh.Build(worldBounds);
+	const std::vector<uint32_t> objectMeshes(objectsCount, 0);
+	query.SetInstances(bvh, worldBounds, objectMeshes, models, {});
+
+	const auto measure = [&](const std::vector<Ray>& rays, bool isAnyHit, BenchmarkReport::Result& result) {
+		std::vector<Hit> hits(rays.size());
+		std::unique_ptr<bool[]> anyHits(new bool[rays.size()]);
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+		if (isAnyHit)
+			query.RayAnyHit(rays.data(), raysCount, anyHits.get());
+		else
+			query.RayFirstHit(rays.data(), raysCount, hits.data());
+		result.packetRaysPerSecond = raysCount / std::max(GetSeconds(startTime), 1e-9);
+
+		startTime = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < raysCount; i++)
+		{
+			if (isAnyHit)
+				anyHits[i] = query.RayAnyHit(rays[i]);
+			else
+				hits[i] = query.RayFirstHit(rays[i]);
+		}
+		result.singleRaysPerSecond = raysCount / std::max(GetSeconds(startTime), 1e-9);
+	};
+
+	// A camera in a corner looking at the center, 2x2 pixel quads are the packets
+	const uint32_t width = std::max(2u, static_cast<uint32_t>(std::sqrt(static_cast<float>(raysCount))) & ~1u);
+	std::vector<Ray> rays(raysCount);
+	{
+		const Vector eye = VectorReplicate(-0.25f * kSceneSize);
+		const Vector forward = Vector3Normalize(VectorReplicate(0.5f * kSceneSize) - eye);
+		const Vector right = Vector3Normalize(Vector3Cross(forward, VectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+		const Vector up = Vector3Cross(right, forward);
+		const float tangent = std::tan(ConvertToRadians(30.0f));
+		for (uint32_t i = 0; i < raysCount; i++)
+		{
+			const uint32_t quad = i / 4;
+			const uint32_t quadsPerRow = width / 2;
+			const uint32_t x = (quad % quadsPerRow) * 2 + (i & 1);
+			const uint32_t y = (quad / quadsPerRow) * 2 + ((i >> 1) & 1);
+			const float screenX = (2.0f * (x + 0.5f) / width - 1.0f) * tangent;
+			const float screenY = (1.0f - 2.0f * (y + 0.5f) / width) * tangent;
+			StoreFloat3(rays[i].origin, eye);
+			StoreFloat3(rays[i].direction, forward + right * screenX + up * screenY);
+		}
+	}
+	measure(rays, false, report.coherentFirstHit);
+
+	const auto getPosition = [&]() {
+		return Float3(positionDistribution(generator), positionDistribution(generator),
+			positionDistribution(generator));
+	};
+	for (Ray& ray : rays)
+	{
+		ray.origin = getPosition();
+		ray.direction = Float3(unitDistribution(generator), unitDistribution(generator), unitDistribution(generator));
+		ray.maxDistance = FLT_MAX;
+	}
+	measure(rays, false, report.randomFirstHit);
+
+	for (Ray& ray : rays)
+	{
+		ray.origin = getPosition();
+		StoreFloat3(ray.direction, LoadFloat3(getPosition()) - LoadFloat3(ray.origin));
+		ray.maxDistance = 1.0f;
+	}
+	measure(rays, true, report.randomAnyHit);
+
+	// Boxes and spheres of about the size of the objects
+	std::vector<Aabb> boxes(kOverlapsCount);
+	std::vector<Float4> spheres(kOverlapsCount);
+	for (uint32_t i = 0; i < kOverlapsCount; i++)
+	{
+		const Float3 center = getPosition();
+		const float size = scaleDistribution(generator);
+		boxes[i] = { Float3(center.x - size, center.y - size, center.z - size),
+			Float3(center.x + size, center.y + size, center.z + size) };
+		spheres[i] = Float4(center.x, center.y, center.z, size);
+	}
+	std::vector<std::vector<uint32_t>> boxObjects(kOverlapsCount);
+	std::vector<std::vector<uint32_t>> sphereObjects(kOverlapsCount);
+	auto startTime = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < kOverlapsCount; i++)
+	{
+		query.OverlapBox(boxes[i], boxObjects[i]);
+		query.OverlapSphere(Float3(spheres[i].x, spheres[i].y, spheres[i].z), spheres[i].w, sphereObjects[i]);
+	}
+	report.overlapsPerSecond = 2 * kOverlapsCount / std::max(GetSeconds(startTime), 1e-9);
+
+	return report;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdint.h>
+#include <cfloat>
+#include <vector>
+#include "Bvh.h"
+#include "ObjectTransforms.h"
+#include "SimdMath.h"
+#include "StaticBatching.h"
+
+
+// Ray and overlap queries against the scene geometry over two levels of Bvh: the scene BVH over the world bounds
+// of the objects on top, a BVH over the object space triangles of every mesh below. Rays reaching an object go
+// to its object space, their distances do not change. Rays are traced in packets of 4, one ray per SimdMath lane,
+// every node is tested against the whole packet. Queries are const and can run on any threads between updates.
+class SceneQuery
+{
+public:
+	static constexpr uint32_t kNoObject = UINT32_MAX;
+	static constexpr uint32_t kPacketSize = 4;
+
+	struct Ray
+	{
+		SimdMath::Float3 origin;
+		// Distances are in lengths of the direction, it does not need to be normalized
+		SimdMath::Float3 direction;
+		float maxDistance = FLT_MAX;
+	};
+
+	struct Hit
+	{
+		uint32_t object = kNoObject;
+		// Index of the first of its indices / 3
+		uint32_t triangle = 0;
+		float distance = FLT_MAX;
+		// Barycentrics of the second and third vertices
+		float u = 0.0f;
+		float v = 0.0f;
+	};
+
+	// Bottom levels of the meshes from their vertices and indices, the models are ignored. Drops the instances.
+	void BuildMeshes(const std::vector<StaticBatching::Source>& meshes);
+	// Bottom level of one more mesh, returns its index
+	uint32_t AddMesh(const StaticBatching::Source& mesh);
+	// Top level: bvh over worldBounds and the meshes of the objects, all three outlive the queries, and the models
+	// of the objects. Only the changed objects and the ones past the previous objects count are updated. Objects
+	// with empty bounds are never reached.
+	void SetInstances(const Bvh& bvh, const std::vector<SimdMath::Aabb>& worldBounds,
+		const std::vector<uint32_t>& objectMeshes, const ObjectTransforms::Transforms& models,
+		const std::vector<uint32_t>& changedObjects);
+
+	Hit RayFirstHit(const Ray& ray) const;
+	bool RayAnyHit(const Ray& ray) const;
+	// In packets, raysCount does not have to be a multiple of kPacketSize
+	void RayFirstHit(const Ray* rays, uint32_t raysCount, Hit* hits) const;
+	void RayAnyHit(const Ray* rays, uint32_t raysCount, bool* hits) const;
+
+	// Objects with a triangle touching the world space box or sphere, in no particular order
+	void OverlapBox(const SimdMath::Aabb& box, std::vector<uint32_t>& objects) const;
+	void OverlapSphere(const SimdMath::Float3& center, float radius, std::vector<uint32_t>& objects) const;
+
+	struct BenchmarkReport
+	{
+		struct Result
+		{
+			// One thread, so per core
+			double packetRaysPerSecond = 0.0;
+			double singleRaysPerSecond = 0.0;
+		};
+
+		uint32_t objectsCount = 0;
+		uint32_t trianglesCount = 0;
+		uint32_t raysCount = 0;
+		// Primary rays of a camera
+		Result coherentFirstHit;
+		// Random origins and directions
+		Result randomFirstHit;
+		// Random segments
+		Result randomAnyHit;
+		double overlapsPerSecond = 0.0;
+	};
+
+	// Randomly placed and scaled instances of a sphere of 512 triangles. Timing only, SceneQueryTests.cpp checks the
+	// queries.
+	static BenchmarkReport Benchmark(uint32_t objectsCount, uint32_t raysCount);
+
+	// Traversal state, in SceneQuery.cpp
+	struct RayPacket;
+	struct PacketHits;
+
+private:
+	// Object space, the first vertex and the edges to the others
+	struct Triangle
+	{
+		SimdMath::Float3 vertex;
+		SimdMath::Float3 edge1;
+		SimdMath::Float3 edge2;
+		uint32_t index;
+	};
+
+	struct Mesh
+	{
+		Bvh bvh;
+		// In the order of bvh.GetItems, the leaves index them directly
+		std::vector<Triangle> triangles;
+	};
+
+	std::vector<Mesh> m_meshes;
+	const Bvh* m_bvh = nullptr;
+	const std::vector<SimdMath::Aabb>* m_worldBounds = nullptr;
+	const std::vector<uint32_t>* m_objectMeshes = nullptr;
+	std::vector<SimdMath::Float4x4> m_models;
+	std::vector<SimdMath::Float4x4> m_inverseModels;
+
+	void TracePacket(const RayPacket& packet, uint32_t activeLanes, bool isAnyHit, PacketHits& hits) const;
+	// Updates the hits of the lanes hitting a closer triangle, any hit clears the lanes that hit
+	void TraceMesh(uint32_t object, const RayPacket& worldPacket, bool isAnyHit, uint32_t& activeLanes,
+		PacketHits& hits) const;
+	// triangleTest gets the world space vertices
+	template <typename TriangleTest>
+	void Overlap(const SimdMath::Aabb& box, const TriangleTest& triangleTest, std::vector<uint32_t>& objects) const;
+};
@@ -0,0 +1,246 @@
+#include "ShaderCache.h"
+
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <d3dcompiler.h>
+
+#include "DxHelpers.h"
+#include "Hash.h"
+
+
+using namespace Microsoft::WRL;
+
+
+namespace
+{
+	constexpr const char* kShaderListFileName = "ShaderList.txt";
+	constexpr const char* kManifestFileName = "Manifest.txt";
+	// Has to match SHADER_MODEL in CompileShaders.py
+	constexpr const char* kOfflineShaderModel = "_6_0";
+
+#if defined(SHADER_CACHE_RUNTIME_COMPILATION)
+	// 5.1 for the unbounded resource arrays
+	constexpr const char* kRuntimeShaderModel = "_5_1";
+
+	std::string ReadFile(const std::filesystem::path& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		std::ostringstream stream;
+		stream << file.rdbuf();
+		return stream.str();
+	}
+
+	bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+	}
+
+	// Same scan as INCLUDE_PATTERN in CompileShaders.py: preorder, every file once
+	void CollectDependencies(const std::filesystem::path& path, std::vector<std::filesystem::path>& dependencies)
+	{
+		for (const auto& dependency : dependencies)
+		{
+			if (dependency == path)
+				return;
+		}
+		dependencies.push_back(path);
+
+		const std::string source = ReadFile(path);
+		std::istringstream lines(source);
+		std::string line;
+		while (std::getline(lines, line))
+		{
+			size_t position = 0;
+			while (position < line.size() && IsSpace(line[position]))
+				position++;
+
+			constexpr std::string_view kInclude = "#include";
+			if (line.compare(position, kInclude.size(), kInclude) != 0)
+				continue;
+			position += kInclude.size();
+
+			const size_t quoteBegin = position;
+			while (position < line.size() && IsSpace(line[position]))
+				position++;
+			if (position == quoteBegin || position >= line.size() || line[position] != '"')
+				continue;
+
+			const size_t quoteEnd = line.find('"', position + 1);
+			if (quoteEnd == std::string::npos || quoteEnd == position + 1)
+				continue;
+
+			const auto includePath = path.parent_path() / line.substr(position + 1, quoteEnd - position - 1);
+			CollectDependencies(includePath.lexically_normal(), dependencies);
+		}
+	}
+#endif
+}
+
+
+void ShaderCache::Initialize(const std::string& shadersDirectory, const std::string& cacheDirectory)
+{
+	m_shadersDirectory = shadersDirectory;
+	m_cacheDirectory = cacheDirectory;
+
+	ReadShaderList();
+	ReadManifest();
+}
+
+
+D3D12_SHADER_BYTECODE ShaderCache::GetShader(const std::string& name, uint32_t permutationKey)
+{
+	const auto listEntry = m_shaderList.find(name);
+	assert(listEntry != m_shaderList.end());
+	const auto& permutations = listEntry->second.permutations;
+	assert(permutations.HasPermutations() || permutationKey == 0);
+
+	const std::string variantName = permutations.HasPermutations()
+		? ShaderPermutationLayout::GetPermutationName(name, permutationKey)
+		: name;
+
+	auto& shader = m_shaders[variantName];
+
+	if (!shader)
+	{
+		const auto manifestEntry = m_manifest.find(variantName);
+
+#if defined(SHADER_CACHE_RUNTIME_COMPILATION)
+		const auto defines = permutations.HasPermutations()
+			? permutations.GetDefines(permutationKey)
+			: std::vector<std::string>();
+		const bool isUpToDate = manifestEntry != m_manifest.end()
+			&& manifestEntry->second.contentHash == ComputeContentHash(listEntry->second, defines);
+
+		if (isUpToDate)
+			shader = LoadBlob(m_cacheDirectory + manifestEntry->second.fileName);
+		if (!shader)
+		{
+			std::cout << "ShaderCache: compiling " << variantName << " at runtime\n";
+			shader = CompileAtRuntime(listEntry->second, defines);
+		}
+#else
+		if (manifestEntry != m_manifest.end())
+			shader = LoadBlob(m_cacheDirectory + manifestEntry->second.fileName);
+		if (!shader)
+		{
+			std::cout << "ShaderCache: " << variantName << " is not compiled, run Shaders/CompileShaders.py\n";
+			DxVerify(E_FAIL);
+			return {};
+		}
+#endif
+	}
+
+	return { shader->GetBufferPointer(), shader->GetBufferSize() };
+}
+
+
+const ShaderPermutationLayout& ShaderCache::GetPermutationLayout(const std::string& name) const
+{
+	const auto listEntry = m_shaderList.find(name);
+	assert(listEntry != m_shaderList.end());
+
+	return listEntry->second.permutations;
+}
+
+
+void ShaderCache::ReadShaderList()
+{
+	std::ifstream file(m_shadersDirectory + kShaderListFileName);
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::istringstream stream(line);
+		std::string name;
+		std::string permutations;
+		ShaderListEntry entry;
+		if (stream >> name >> entry.path >> entry.entryPoint >> entry.stage >> permutations)
+		{
+			entry.permutations = ShaderPermutationLayout(permutations);
+			m_shaderList[name] = std::move(entry);
+		}
+	}
+}
+
+
+void ShaderCache::ReadManifest()
+{
+	// No manifest means shaders were never compiled offline
+	std::ifstream file(m_cacheDirectory + kManifestFileName);
+	std::string name;
+	std::string contentHash;
+	std::string fileName;
+	while (file >> name >> contentHash >> fileName)
+		m_manifest[name] = { std::stoull(contentHash, nullptr, 16), fileName };
+}
+
+
+ComPtr<ID3DBlob> ShaderCache::LoadBlob(const std::string& path) const
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+		return nullptr;
+
+	const auto size = static_cast<size_t>(file.tellg());
+	file.seekg(0);
+
+	ComPtr<ID3DBlob> blob;
+	DxVerify(D3DCreateBlob(size, &blob));
+	file.read(static_cast<char*>(blob->GetBufferPointer()), size);
+
+	return blob;
+}
+
+
+#if defined(SHADER_CACHE_RUNTIME_COMPILATION)
+uint64_t ShaderCache::ComputeContentHash(const ShaderListEntry& entry, const std::vector<std::string>& defines) const
+{
+	std::vector<std::filesystem::path> dependencies;
+	CollectDependencies(std::filesystem::path(m_shadersDirectory + entry.path).lexically_normal(), dependencies);
+
+	uint64_t hash = Hash::kFnvOffsetBasis;
+	for (const auto& dependency : dependencies)
+	{
+		const std::string source = ReadFile(dependency);
+		hash = Hash::Fnv1a64(source.data(), source.size(), hash);
+	}
+	hash = Hash::Fnv1a64(entry.entryPoint, hash);
+	hash = Hash::Fnv1a64(entry.stage + kOfflineShaderModel, hash);
+	for (const auto& define : defines)
+		hash = Hash::Fnv1a64(define, hash);
+
+	return hash;
+}
+
+
+ComPtr<ID3DBlob> ShaderCache::CompileAtRuntime(const ShaderListEntry& entry,
+	const std::vector<std::string>& defines) const
+{
+	// Enable better shader debugging with the graphics debugging tools.
+	constexpr uint32_t kCompileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION | D3DCOMPILE_PACK_MATRIX_COLUMN_MAJOR;
+
+	const std::filesystem::path path = m_shadersDirectory + entry.path;
+	const std::string profile = entry.stage + kRuntimeShaderModel;
+
+	// Null terminated, same "DEFINE=1" as CompileShaders.py
+	std::vector<D3D_SHADER_MACRO> macros;
+	for (const auto& define : defines)
+		macros.push_back({ define.c_str(), "1" });
+	macros.push_back({ nullptr, nullptr });
+
+	ComPtr<ID3DBlob> shader;
+	ComPtr<ID3DBlob> errors;
+	const HRESULT result = D3DCompileFromFile(path.wstring().c_str(), macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE,
+		entry.entryPoint.c_str(), profile.c_str(), kCompileFlags, 0, &shader, &errors);
+	if (errors)
+		std::cout << static_cast<const char*>(errors->GetBufferPointer()) << "\n";
+	DxVerify(result);
+
+	return shader;
+}
+#endif
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <d3d12.h>
+#include <d3dcommon.h>
+#include <wrl.h>
+
+#include "ShaderPermutationLayout.h"
+
+
+#if defined(_DEBUG)
+	// Stale or missing blobs are compiled from the sources instead of failing
+	#define SHADER_CACHE_RUNTIME_COMPILATION 1
+#endif
+
+
+// Loads shaders compiled offline by Shaders/CompileShaders.py.
+// Shaders are referenced by their name from Shaders/ShaderList.txt, blobs are looked up through ShaderCache/Manifest.txt.
+class ShaderCache
+{
+public:
+	static constexpr const char* kShadersDirectory = "Shaders/";
+	static constexpr const char* kCacheDirectory = "ShaderCache/";
+
+	ShaderCache() = default;
+
+	void Initialize(const std::string& shadersDirectory = kShadersDirectory,
+		const std::string& cacheDirectory = kCacheDirectory);
+
+	// Bytecode stays valid for the cache lifetime.
+	// permutationKey selects the variant of a shader with permutations, see GetPermutationLayout.
+	D3D12_SHADER_BYTECODE GetShader(const std::string& name, uint32_t permutationKey = 0);
+	const ShaderPermutationLayout& GetPermutationLayout(const std::string& name) const;
+
+private:
+	struct ShaderListEntry
+	{
+		std::string path;
+		std::string entryPoint;
+		std::string stage;
+		ShaderPermutationLayout permutations;
+	};
+
+	struct ManifestEntry
+	{
+		uint64_t contentHash;
+		std::string fileName;
+	};
+
+	std::string m_shadersDirectory;
+	std::string m_cacheDirectory;
+
+	std::unordered_map<std::string, ShaderListEntry> m_shaderList;
+	std::unordered_map<std::string, ManifestEntry> m_manifest;
+	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3DBlob>> m_shaders;
+
+	void ReadShaderList();
+	void ReadManifest();
+
+	Microsoft::WRL::ComPtr<ID3DBlob> LoadBlob(const std::string& path) const;
+#if defined(SHADER_CACHE_RUNTIME_COMPILATION)
+	uint64_t ComputeContentHash(const ShaderListEntry& entry, const std::vector<std::string>& defines) const;
+	Microsoft::WRL::ComPtr<ID3DBlob> CompileAtRuntime(const ShaderListEntry& entry,
+		const std::vector<std::string>& defines) const;
+#endif
+};
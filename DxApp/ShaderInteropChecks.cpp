@@ -0,0 +1,10 @@
+// Static asserts of the Shaders/Shared layouts against the DXC reflection, CheckLayouts.py writes them
+// in the shader compilation step. Release and CI builds require them, a Debug build without dxc compiles the
+// shaders at runtime and only warns.
+#if __has_include("ShaderCache/LayoutChecks.generated.h")
+#include "ShaderCache/LayoutChecks.generated.h"
+#elif defined(NDEBUG) || defined(DXAPP_REQUIRE_LAYOUT_CHECKS)
+#error "ShaderCache/LayoutChecks.generated.h is missing, run Shaders/CheckLayouts.py, it needs dxc"
+#else
+#pragma message("ShaderCache/LayoutChecks.generated.h is missing, the shader layouts are not checked")
+#endif
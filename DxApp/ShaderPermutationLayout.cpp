@@ -0,0 +1,143 @@
+#include "ShaderPermutationLayout.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdio>
+
+
+namespace
+{
+	std::vector<std::string_view> Split(std::string_view string, char separator)
+	{
+		std::vector<std::string_view> parts;
+		size_t begin = 0;
+		while (begin <= string.size())
+		{
+			const size_t end = std::min(string.find(separator, begin), string.size());
+			parts.push_back(string.substr(begin, end - begin));
+			begin = end + 1;
+		}
+		return parts;
+	}
+}
+
+
+ShaderPermutationLayout::ShaderPermutationLayout(std::string_view description)
+{
+	if (description.empty() || description == kNoPermutations)
+		return;
+
+	uint32_t shift = 0;
+	for (const auto groupDescription : Split(description, ','))
+	{
+		Group group;
+		for (const auto define : Split(groupDescription, '|'))
+		{
+			assert(!define.empty());
+			group.defines.emplace_back(define);
+		}
+
+		// Value 0 is "none", define i is value i + 1
+		const uint32_t bitsCount = std::bit_width(group.defines.size());
+		group.shift = shift;
+		group.mask = ((1u << bitsCount) - 1) << shift;
+		shift += bitsCount;
+		assert(shift <= 32);
+
+		m_keyMask |= group.mask;
+		m_groups.push_back(std::move(group));
+	}
+}
+
+
+uint32_t ShaderPermutationLayout::GetPermutationsCount() const
+{
+	uint32_t count = 1;
+	for (const auto& group : m_groups)
+		count *= static_cast<uint32_t>(group.defines.size()) + 1;
+	return count;
+}
+
+
+std::vector<uint32_t> ShaderPermutationLayout::EnumerateKeys() const
+{
+	std::vector<uint32_t> keys;
+	keys.reserve(GetPermutationsCount());
+
+	// Groups are packed from bit 0, so walking every key up to the mask and skipping the out of range
+	// group values is cheap for the handful of bits a shader has and gives sorted keys for free
+	for (uint64_t key = 0; key <= m_keyMask; key++)
+	{
+		if (IsValidKey(static_cast<uint32_t>(key)))
+			keys.push_back(static_cast<uint32_t>(key));
+	}
+
+	return keys;
+}
+
+
+bool ShaderPermutationLayout::IsValidKey(uint32_t key) const
+{
+	if ((key & ~m_keyMask) != 0)
+		return false;
+
+	for (const auto& group : m_groups)
+	{
+		if (((key & group.mask) >> group.shift) > group.defines.size())
+			return false;
+	}
+
+	return true;
+}
+
+
+bool ShaderPermutationLayout::HasDefine(std::string_view define) const
+{
+	for (const auto& group : m_groups)
+	{
+		if (std::find(group.defines.begin(), group.defines.end(), define) != group.defines.end())
+			return true;
+	}
+	return false;
+}
+
+
+uint32_t ShaderPermutationLayout::GetDefineKey(std::string_view define) const
+{
+	for (const auto& group : m_groups)
+	{
+		for (uint32_t i = 0; i < group.defines.size(); i++)
+		{
+			if (group.defines[i] == define)
+				return (i + 1) << group.shift;
+		}
+	}
+
+	assert(false);
+	return 0;
+}
+
+
+std::vector<std::string> ShaderPermutationLayout::GetDefines(uint32_t key) const
+{
+	assert(IsValidKey(key));
+
+	std::vector<std::string> defines;
+	for (const auto& group : m_groups)
+	{
+		const uint32_t value = (key & group.mask) >> group.shift;
+		if (value != 0)
+			defines.push_back(group.defines[value - 1]);
+	}
+
+	return defines;
+}
+
+
+std::string ShaderPermutationLayout::GetPermutationName(const std::string& shaderName, uint32_t key)
+{
+	char suffix[16];
+	std::snprintf(suffix, sizeof(suffix), ".%x", key);
+	return shaderName + suffix;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// Feature bits of a shader, parsed from the permutations column of Shaders/ShaderList.txt.
+// Column is a comma separated list of groups, a group is one define or '|' separated mutually exclusive defines:
+//   DIRECTIONAL_LIGHTS,POINT_LIGHTS,DEBUG_VIEW_NORMAL|DEBUG_VIEW_ROUGHNESS
+// Every group takes the smallest bit field that holds "none" plus its options, the key is the union of the fields.
+// Key 0 is the variant without any define. Shaders/CompileShaders.py enumerates keys the same way, keep them in sync.
+class ShaderPermutationLayout
+{
+public:
+	static constexpr std::string_view kNoPermutations = "-";
+
+	ShaderPermutationLayout() = default;
+	explicit ShaderPermutationLayout(std::string_view description);
+
+	[[nodiscard]] bool HasPermutations() const { return !m_groups.empty(); }
+	[[nodiscard]] uint32_t GetPermutationsCount() const;
+	// Every valid key, in increasing order
+	[[nodiscard]] std::vector<uint32_t> EnumerateKeys() const;
+	[[nodiscard]] bool IsValidKey(uint32_t key) const;
+
+	[[nodiscard]] bool HasDefine(std::string_view define) const;
+	// Key bits that enable the define, asserts that the define is a part of the layout
+	[[nodiscard]] uint32_t GetDefineKey(std::string_view define) const;
+	// Enabled defines, in declaration order
+	[[nodiscard]] std::vector<std::string> GetDefines(uint32_t key) const;
+
+	// Name of the variant in ShaderCache/Manifest.txt
+	static std::string GetPermutationName(const std::string& shaderName, uint32_t key);
+
+private:
+	struct Group
+	{
+		std::vector<std::string> defines;
+		uint32_t shift;
+		uint32_t mask;
+	};
+
+	std::vector<Group> m_groups;
+	uint32_t m_keyMask = 0;
+};
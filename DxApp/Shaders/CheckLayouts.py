@@ -0,0 +1,228 @@
+#!/usr/bin/env python3
+# Checks the structs of Shaders/Shared, compiled both as HLSL and as C++, for the same constant buffer layout.
+# Every struct is put into a constant buffer of a DXC library, the offsets are read back from the reflection
+# in the disassembly and written as static_asserts on the C++ offsets to LayoutChecks.generated.h.
+# ShaderInteropChecks.cpp includes it in the Windows build, --cxx compiles it with a host compiler instead.
+# Prints the padding of every struct, the bytes of the 16 byte registers no member uses.
+#
+# Usage: CheckLayouts.py [--dxc path] [--cxx compiler] [--output dir]
+
+import argparse
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+
+SHADERS_DIRECTORY = os.path.dirname(os.path.abspath(__file__))
+SHARED_DIRECTORY = os.path.join(SHADERS_DIRECTORY, "Shared")
+INTEROP_HEADER = "ShaderInterop.h"
+GENERATED_HEADER = "LayoutChecks.generated.h"
+REGISTER_SIZE = 16
+
+STRUCT_PATTERN = re.compile(r"^struct\s+(\w+)\s*$", re.MULTILINE)
+
+# Disassembly lines of the "Buffer Definitions" section, after the leading "; "
+CBUFFER_LINE = re.compile(r"^cbuffer\s+(\w+)$")
+STRUCT_BEGIN_LINE = re.compile(r"^struct\s+(\S+)$")
+STRUCT_END_LINE = re.compile(r"^\}\s*(\w*)(?:\[(\d+)\])?;+\s*;\s*Offset:\s*(\d+)(?:\s+Size:\s*(\d+))?$")
+MEMBER_LINE = re.compile(
+    r"^(?:(?:row_major|column_major)\s+)?(\w+)\s+(\w+)(?:\[(\d+)\])?;+\s*;\s*Offset:\s*(\d+)(?:\s+Size:\s*(\d+))?$")
+
+SCALAR_SIZES = {"float": 4, "int": 4, "uint": 4, "bool": 4}
+
+
+def get_type_size(type_name):
+    match = re.match(r"^(float|int|uint|bool)(\d)?(?:x(\d))?$", type_name)
+    if not match:
+        raise ValueError("unsupported member type {}".format(type_name))
+    scalar_size = SCALAR_SIZES[match.group(1)]
+    rows = int(match.group(2) or 1)
+    if match.group(3) is None:
+        return scalar_size * rows
+    # Column major matrix, one register per column but the last
+    columns = int(match.group(3))
+    return (columns - 1) * REGISTER_SIZE + rows * scalar_size
+
+
+def align(value, alignment):
+    return (value + alignment - 1) // alignment * alignment
+
+
+def find_structs():
+    structs = []
+    for file_name in sorted(os.listdir(SHARED_DIRECTORY)):
+        if not file_name.endswith(".h") or file_name == INTEROP_HEADER:
+            continue
+        path = os.path.join(SHARED_DIRECTORY, file_name)
+        with open(path) as file:
+            for name in STRUCT_PATTERN.findall(file.read()):
+                structs.append((path, name))
+    return structs
+
+
+def write_probe(structs, path):
+    with open(path, "w", newline="\n") as file:
+        for header in sorted({header for header, _ in structs}):
+            file.write('#include "{}"\n'.format(header.replace("\\", "/")))
+        for _, name in structs:
+            file.write("cbuffer {0}Probe {{ {0} {0}Value; }};\n".format(name))
+
+
+# Returns {cbuffer name: (root node, size)}, nodes are dicts of name, type, count, offset, children
+def parse_reflection(disassembly):
+    cbuffers = {}
+    cbuffer_name = None
+    stack = []
+    for line in disassembly.splitlines():
+        line = line.lstrip(";").strip()
+        if cbuffer_name is None:
+            match = CBUFFER_LINE.match(line)
+            if match:
+                cbuffer_name = match.group(1)
+            continue
+
+        match = STRUCT_BEGIN_LINE.match(line)
+        if match:
+            stack.append({"type": match.group(1), "children": []})
+            continue
+
+        match = STRUCT_END_LINE.match(line)
+        if match:
+            node = stack.pop()
+            node.update(name=match.group(1), count=int(match.group(2) or 0), offset=int(match.group(3)))
+            if stack:
+                stack[-1]["children"].append(node)
+            else:
+                cbuffers[cbuffer_name] = (node, int(match.group(4) or 0))
+                cbuffer_name = None
+            continue
+
+        match = MEMBER_LINE.match(line)
+        if match and stack:
+            stack[-1]["children"].append({"type": match.group(1), "name": match.group(2),
+                                          "count": int(match.group(3) or 0), "offset": int(match.group(4))})
+    return cbuffers
+
+
+# Size of one element, arrays of the constant buffers start every element at a register
+def get_element_size(node):
+    if "children" not in node:
+        return get_type_size(node["type"])
+    size = 0
+    for child in node["children"]:
+        # Reflection offsets are from the start of the constant buffer
+        size = max(size, child["offset"] - node["offset"] + get_size(child))
+    return size
+
+
+def get_size(node):
+    element_size = get_element_size(node)
+    if node["count"] == 0:
+        return element_size
+    return align(element_size, REGISTER_SIZE) * (node["count"] - 1) + element_size
+
+
+# Yields (member path, offset, size) of every scalar, vector and matrix, array elements included
+def expand_members(node, offset, path):
+    element_size = get_element_size(node)
+    elements = [(offset, path)] if node["count"] == 0 else [
+        (offset + align(element_size, REGISTER_SIZE) * i, "{}[{}]".format(path, i)) for i in range(node["count"])]
+    for element_offset, element_path in elements:
+        if "children" not in node:
+            yield element_path, element_offset, element_size
+            continue
+        for child in node["children"]:
+            child_path = "{}.{}".format(element_path, child["name"]) if element_path else child["name"]
+            yield from expand_members(child, element_offset + child["offset"] - node["offset"], child_path)
+
+
+def report_padding(name, size, members):
+    registers_count = align(size, REGISTER_SIZE) // REGISTER_SIZE
+    used = sum(member_size for _, _, member_size in members)
+    padding = registers_count * REGISTER_SIZE - used
+    print("{}: {} bytes, {} registers, {} bytes of padding".format(name, size, registers_count, padding))
+
+    end = 0
+    previous = "the start"
+    for path, offset, member_size in sorted(members, key=lambda member: member[1]):
+        if offset > end:
+            print("    {} bytes after {}".format(offset - end, previous))
+        end = max(end, offset + member_size)
+        previous = path
+    if registers_count * REGISTER_SIZE > end:
+        print("    {} bytes after {}".format(registers_count * REGISTER_SIZE - end, previous))
+
+
+def write_checks(structs, layouts, path):
+    output_directory = os.path.dirname(os.path.abspath(path))
+    with open(path, "w", newline="\n") as file:
+        file.write("// Generated by Shaders/CheckLayouts.py from the DXC reflection, do not edit\n")
+        file.write("#pragma once\n\n#include <stddef.h>\n\n")
+        for header in sorted({header for header, _ in structs}):
+            file.write('#include "{}"\n'.format(os.path.relpath(header, output_directory).replace("\\", "/")))
+        file.write("\n")
+        for name, (size, members) in layouts.items():
+            file.write('static_assert(sizeof(ShaderInterop::{0}) == {1}, "{0} is {1} bytes in HLSL");\n'.format(
+                name, size))
+            for member_path, offset, _ in members:
+                file.write('static_assert(offsetof(ShaderInterop::{0}, {1}) == {2}, '
+                           '"{0}::{1} is at {2} in HLSL");\n'.format(name, member_path, offset))
+            file.write("\n")
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--dxc", default=os.environ.get("DXC", "dxc"))
+    parser.add_argument("--cxx", help="compiles the checks with this C++ compiler, the C++ build does it otherwise")
+    parser.add_argument("--output", default=os.path.join(SHADERS_DIRECTORY, "..", "ShaderCache"))
+    args = parser.parse_args()
+
+    if shutil.which(args.dxc) is None and not os.path.isfile(args.dxc):
+        print("dxc not found, pass --dxc or set DXC", file=sys.stderr)
+        return 1
+
+    structs = find_structs()
+    with tempfile.TemporaryDirectory() as directory:
+        probe_path = os.path.join(directory, "LayoutProbe.hlsl")
+        disassembly_path = os.path.join(directory, "LayoutProbe.txt")
+        write_probe(structs, probe_path)
+        # Libraries keep the unreferenced constant buffers
+        command = [args.dxc, "-nologo", "-T", "lib_6_3", "-Zpc", "-Fc", disassembly_path, probe_path]
+        if subprocess.call(command) != 0:
+            return 1
+        with open(disassembly_path) as file:
+            cbuffers = parse_reflection(file.read())
+
+    layouts = {}
+    for _, name in structs:
+        probe = cbuffers.get(name + "Probe")
+        if probe is None or len(probe[0]["children"]) != 1:
+            print("{} is missing from the reflection".format(name), file=sys.stderr)
+            return 1
+        value = probe[0]["children"][0]
+        members = list(expand_members(dict(value, count=0), 0, ""))
+        layouts[name] = (probe[1] or get_size(dict(value, count=0)), members)
+        report_padding(name, layouts[name][0], members)
+
+    os.makedirs(args.output, exist_ok=True)
+    checks_path = os.path.join(args.output, GENERATED_HEADER)
+    write_checks(structs, layouts, checks_path)
+
+    if args.cxx:
+        with tempfile.TemporaryDirectory() as directory:
+            source_path = os.path.join(directory, "LayoutChecks.cpp")
+            with open(source_path, "w", newline="\n") as file:
+                file.write('#include "{}"\n'.format(os.path.abspath(checks_path).replace("\\", "/")))
+            command = [args.cxx, "-std=c++17", "-fsyntax-only", source_path]
+            if subprocess.call(command) != 0:
+                return 1
+        print("C++ layouts match")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
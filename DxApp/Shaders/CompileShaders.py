@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+# Compiles every shader from ShaderList.txt to SM6 DXIL with DXC and writes the ShaderCache manifest.
+# Shaders with a permutations column are compiled once per feature key, see ShaderPermutationLayout.h.
+# Blob names contain the content hash, ShaderCache computes the same hash to detect stale blobs.
+#
+# Usage: CompileShaders.py [--dxc path] [--output dir] [--debug] [--jobs count]
+
+import argparse
+import concurrent.futures
+import os
+import re
+import shutil
+import subprocess
+import sys
+
+
+SHADERS_DIRECTORY = os.path.dirname(os.path.abspath(__file__))
+SHADER_MODEL = "6_0"
+
+FNV_OFFSET_BASIS = 14695981039346656037
+FNV_PRIME = 1099511628211
+INCLUDE_PATTERN = re.compile(rb'^\s*#include\s+"([^"]+)"', re.MULTILINE)
+
+
+# Same as Hash::Fnv1a64
+def fnv1a64(data, value=FNV_OFFSET_BASIS):
+    for byte in data:
+        value ^= byte
+        value = (value * FNV_PRIME) & 0xFFFFFFFFFFFFFFFF
+    return value
+
+
+def collect_dependencies(path, dependencies):
+    if path in dependencies:
+        return
+    dependencies.append(path)
+
+    with open(path, "rb") as file:
+        source = file.read()
+    for include in INCLUDE_PATTERN.findall(source):
+        collect_dependencies(os.path.normpath(os.path.join(os.path.dirname(path), include.decode())), dependencies)
+
+
+# Same as ShaderPermutationLayout, returns groups as (defines, shift, mask)
+def parse_permutations(description):
+    groups = []
+    if description == "-":
+        return groups
+
+    shift = 0
+    for group_description in description.split(","):
+        defines = group_description.split("|")
+        bits_count = len(defines).bit_length()
+        groups.append((defines, shift, ((1 << bits_count) - 1) << shift))
+        shift += bits_count
+    return groups
+
+
+def enumerate_permutations(groups):
+    key_mask = 0
+    for _, _, mask in groups:
+        key_mask |= mask
+
+    for key in range(key_mask + 1):
+        defines = []
+        for group_defines, shift, mask in groups:
+            value = (key & mask) >> shift
+            if value > len(group_defines):
+                break
+            if value != 0:
+                defines.append(group_defines[value - 1])
+        else:
+            yield key, defines
+
+
+# Same as ShaderCache::ComputeContentHash
+def compute_content_hash(entry, defines):
+    dependencies = []
+    collect_dependencies(os.path.normpath(os.path.join(SHADERS_DIRECTORY, entry["path"])), dependencies)
+
+    value = FNV_OFFSET_BASIS
+    for dependency in dependencies:
+        with open(dependency, "rb") as file:
+            value = fnv1a64(file.read(), value)
+    value = fnv1a64(entry["entryPoint"].encode(), value)
+    value = fnv1a64(get_profile(entry).encode(), value)
+    for define in defines:
+        value = fnv1a64(define.encode(), value)
+    return value
+
+
+def get_profile(entry):
+    return "{}_{}".format(entry["stage"], SHADER_MODEL)
+
+
+def read_shader_list():
+    entries = []
+    with open(os.path.join(SHADERS_DIRECTORY, "ShaderList.txt")) as file:
+        for line in file:
+            line = line.strip()
+            if not line or line.startswith("#"):
+                continue
+            name, path, entry_point, stage, permutations = line.split()
+            entries.append({"name": name, "path": path, "entryPoint": entry_point, "stage": stage,
+                            "permutations": parse_permutations(permutations)})
+    return entries
+
+
+# One (name, entry, defines) item per blob
+def enumerate_variants(entries):
+    for entry in entries:
+        if not entry["permutations"]:
+            yield entry["name"], entry, []
+            continue
+        for key, defines in enumerate_permutations(entry["permutations"]):
+            yield "{}.{:x}".format(entry["name"], key), entry, defines
+
+
+def compile_variant(args, name, entry, defines, blob_path):
+    command = [args.dxc, "-nologo", "-T", get_profile(entry), "-E", entry["entryPoint"], "-Zpc", "-Fo", blob_path]
+    command += ["-Zi", "-Qembed_debug", "-Od"] if args.debug else ["-O3", "-Qstrip_debug", "-Qstrip_reflect"]
+    for define in defines:
+        command += ["-D", "{}=1".format(define)]
+    command.append(os.path.join(SHADERS_DIRECTORY, entry["path"]))
+
+    print("Compiling {} ({}) {}".format(name, get_profile(entry), " ".join(defines)))
+    return subprocess.call(command)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--dxc", default=os.environ.get("DXC", "dxc"))
+    parser.add_argument("--output", default=os.path.join(SHADERS_DIRECTORY, "..", "ShaderCache"))
+    parser.add_argument("--debug", action="store_true")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count())
+    args = parser.parse_args()
+
+    if shutil.which(args.dxc) is None and not os.path.isfile(args.dxc):
+        print("dxc not found, pass --dxc or set DXC", file=sys.stderr)
+        return 1
+
+    os.makedirs(args.output, exist_ok=True)
+
+    manifest = []
+    compilations = []
+    for name, entry, defines in enumerate_variants(read_shader_list()):
+        content_hash = compute_content_hash(entry, defines)
+        blob_name = "{}.{:016x}.dxil".format(name, content_hash)
+        blob_path = os.path.join(args.output, blob_name)
+        manifest.append("{}\t{:016x}\t{}\n".format(name, content_hash, blob_name))
+
+        if not os.path.isfile(blob_path):
+            compilations.append((name, entry, defines, blob_path))
+
+    # Permutations multiply the blobs count, dxc runs in its own process so threads are enough
+    with concurrent.futures.ThreadPoolExecutor(max_workers=args.jobs) as executor:
+        results = list(executor.map(lambda compilation: compile_variant(args, *compilation), compilations))
+    if any(result != 0 for result in results):
+        return 1
+
+    with open(os.path.join(args.output, "Manifest.txt"), "w", newline="\n") as file:
+        file.writelines(manifest)
+
+    # Blobs of the previous shader versions
+    blob_names = {line.split("\t")[2].strip() for line in manifest}
+    for file_name in os.listdir(args.output):
+        if file_name.endswith(".dxil") and file_name not in blob_names:
+            os.remove(os.path.join(args.output, file_name))
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,21 @@
+#include "../Shared/SceneObjectData.h"
+
+
+// Position only stream, see SceneObject::GetPositionBufferView
+struct VertexAttributes
+{
+    float3 position : POSITION;
+};
+
+cbuffer ConstantBuffer : register(b0)
+{
+    SceneObjectData sceneData;
+}
+
+float4 vs_main(in VertexAttributes input) : SV_POSITION
+{
+    // Same operations as GeometryPass_vs, the passes after it test depth EQUAL
+    precise const float3 worldPosition = mul(sceneData.model, float4(input.position, 1.0f)).xyz;
+    precise const float4 position = mul(sceneData.vp, float4(worldPosition, 1.0f));
+    return position;
+}
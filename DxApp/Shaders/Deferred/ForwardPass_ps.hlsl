@@ -0,0 +1,58 @@
+#include "GeometryPass.hlsli"
+#include "Lighting.hlsli"
+
+
+// Clustered forward shading, see ClusteredLightCulling.h for the grid. Reuses GeometryPass_vs, the depth pre-pass
+// draws with the same vertex shader so the depth test can be EQUAL.
+// The surface is the one the geometry pass would write, the lighting is the one of LightingPass_ps.
+
+
+cbuffer ClusterConstants : register(b1)
+{
+	uint3 GridSize;
+	float DepthSliceScale;
+	float2 ScreenSize;
+	float DepthSliceBias;
+};
+
+// offset, count into LightIndices
+StructuredBuffer<uint2> LightGrid : register(t4);
+// Point lights first, then spot lights
+StructuredBuffer<uint> LightIndices : register(t5);
+
+
+uint GetClusterIndex(float4 position)
+{
+	// w of the pixel position is the view distance
+	const uint2 tile = min(uint2(position.xy / ScreenSize * float2(GridSize.xy)), GridSize.xy - 1);
+	const float slice = floor(log(max(position.w, 1e-7f)) * DepthSliceScale + DepthSliceBias);
+	const uint z = uint(clamp(slice, 0.0f, float(GridSize.z - 1)));
+	return tile.x + (tile.y + z * GridSize.y) * GridSize.x;
+}
+
+
+void ps_main(in PixelAttributes attributes, out float4 outputColor : SV_Target)
+{
+	const Surface surface = MakeSurface(attributes.worldPosition, normalize(attributes.normal), attributes.color,
+		kRoughness, kMetalness, kMaterialFresnelIndices[kMaterialIndex]);
+	const float3 view = normalize(CameraPosition.xyz - surface.position);
+
+	float3 radiance = GetAmbientRadiance(surface);
+
+#if defined(DIRECTIONAL_LIGHTS)
+	for (uint i = 0; i < LightSources.directionalLightSourcesCount; i++)
+		radiance += GetDirectionalLightRadiance(i, surface, view);
+#endif
+
+	const uint2 cluster = LightGrid[GetClusterIndex(attributes.deviceCoordinatesPosition)];
+	const uint pointLightsCount = LightSources.pointLightSourcesCount;
+	for (uint j = 0; j < cluster.y; j++)
+	{
+		const uint lightIndex = LightIndices[cluster.x + j];
+		radiance += lightIndex < pointLightsCount
+			? GetPointLightRadiance(lightIndex, surface, view)
+			: GetSpotLightRadiance(lightIndex - pointLightsCount, surface, view);
+	}
+
+	outputColor = ToOutputColor(radiance);
+}
@@ -0,0 +1,57 @@
+#ifndef GBUFFER_ENCODING_INCLUDES
+#define GBUFFER_ENCODING_INCLUDES
+
+// Compact GBuffer encoding, GBufferEncoding.cpp is the CPU reference, keep them in sync
+
+
+// TODO per object materials, every object uses material 0 for now
+static const uint kMaterialsCount = 1;
+static const float3 kMaterialFresnelIndices[kMaterialsCount] = { float3(0.6f, 0.7f, 0.8f) };
+
+// TODO cbuffer with roughness, metal, material index
+static const uint kMaterialIndex = 0;
+static const float kRoughness = 0.1f;
+static const float kMetalness = 0.0f;
+
+
+float2 SignNotZero(float2 value)
+{
+	return float2(value.x >= 0.0f ? 1.0f : -1.0f, value.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+// Octahedral mapping of a unit vector to [-1, 1]^2, stored in R16G16_SNORM
+float2 EncodeOctahedralNormal(float3 normal)
+{
+	normal /= abs(normal.x) + abs(normal.y) + abs(normal.z);
+	// Lower hemisphere is folded over the diagonals
+	return normal.z >= 0.0f ? normal.xy : (1.0f - abs(normal.yx)) * SignNotZero(normal.xy);
+}
+
+float3 DecodeOctahedralNormal(float2 encoded)
+{
+	float3 normal = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	const float fold = saturate(-normal.z);
+	normal.xy -= SignNotZero(normal.xy) * fold;
+	return normalize(normal);
+}
+
+// Material index in the alpha of the R8G8B8A8_UNORM surface color target
+float EncodeMaterialIndex(uint materialIndex)
+{
+	return materialIndex / 255.0f;
+}
+
+uint DecodeMaterialIndex(float encoded)
+{
+	return uint(encoded * 255.0f + 0.5f);
+}
+
+// uv of the pixel center with y down, depth as stored in the depth buffer
+float3 ReconstructPosition(float2 uv, float depth, float4x4 inverseViewProjection)
+{
+	const float4 clipPosition = float4(uv.x * 2.0f - 1.0f, 1.0f - uv.y * 2.0f, depth, 1.0f);
+	const float4 position = mul(inverseViewProjection, clipPosition);
+	return position.xyz / position.w;
+}
+
+#endif
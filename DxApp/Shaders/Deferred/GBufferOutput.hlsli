@@ -0,0 +1,45 @@
+#ifndef GBUFFER_OUTPUT_INCLUDES
+#define GBUFFER_OUTPUT_INCLUDES
+
+#include "GBufferEncoding.hlsli"
+
+// GBuffer targets written by the geometry pass and the visibility buffer resolve
+
+
+// COMPACT_GBUFFER permutation matches GBufferMode::Compact, see GBuffer.h for the targets
+#if defined(COMPACT_GBUFFER)
+struct OutputAttributes
+{
+	// a - material index
+	float4 surfaceColorMaterial : SV_Target0;
+	float2 normal : SV_Target1;
+	float2 roughnessMetalness : SV_Target2;
+};
+#else
+struct OutputAttributes
+{
+	float4 surfaceColor : SV_Target0;
+	float4 positionRoughness : SV_Target1;
+	float4 normalMetalness : SV_Target2;
+	float4 fresnelIndices : SV_Target3;
+};
+#endif
+
+
+OutputAttributes EncodeGBuffer(float3 color, float3 worldPosition, float3 normal)
+{
+	OutputAttributes output;
+#if defined(COMPACT_GBUFFER)
+	output.surfaceColorMaterial = float4(color, EncodeMaterialIndex(kMaterialIndex));
+	output.normal = EncodeOctahedralNormal(normalize(normal));
+	output.roughnessMetalness = float2(kRoughness, kMetalness);
+#else
+	output.surfaceColor = float4(color, 1.0f);
+	output.positionRoughness = float4(worldPosition, kRoughness);
+	output.normalMetalness = float4(normal, kMetalness);
+	output.fresnelIndices = float4(kMaterialFresnelIndices[kMaterialIndex], 1.0f);
+#endif
+	return output;
+}
+
+#endif
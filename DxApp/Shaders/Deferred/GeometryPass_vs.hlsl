@@ -1,4 +1,5 @@
 #include "GeometryPass.hlsli"
+#include "../Shared/SceneObjectData.h"
 
 
 struct VertexAttributes
@@ -8,17 +9,6 @@ struct VertexAttributes
     float4 normal : NORMAL;
 };
 
-struct SceneObjectData
-{
-    float4x4 model;
-    float4x4 view;
-    float4x4 projection;
-
-    float4x4 mvp;
-
-    float4x4 vp;
-};
-
 cbuffer ConstantBuffer : register(b0)
 {
     SceneObjectData sceneData;
@@ -26,8 +16,11 @@ cbuffer ConstantBuffer : register(b0)
 
 void vs_main(in VertexAttributes input, out PixelAttributes output)
 {
-    output.worldPosition = mul(sceneData.model, input.position).xyz;
-    output.deviceCoordinatesPosition = mul(sceneData.vp, float4(output.worldPosition, 1.0f));
+    // precise keeps the depth bit exact with DepthPrePass_vs
+    precise const float3 worldPosition = mul(sceneData.model, input.position).xyz;
+    precise const float4 position = mul(sceneData.vp, float4(worldPosition, 1.0f));
+    output.worldPosition = worldPosition;
+    output.deviceCoordinatesPosition = position;
     output.color = input.color.xyz;
     output.normal = mul(sceneData.model, input.normal).xyz; // normal.w = 0 here, so translation ignored
 }
\ No newline at end of file
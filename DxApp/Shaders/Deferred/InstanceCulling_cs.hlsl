@@ -0,0 +1,107 @@
+// GPU driven geometry: culls the scene instances against the view frustum and writes the indirect arguments
+// of the visible ones. InstanceCulling.cpp is the CPU reference, keep them in sync.
+// One thread per instance. Each group compacts its visible instances with a prefix sum and appends them at an
+// offset taken from the count with one atomic, so the groups land in any order: compare the arguments with the
+// reference as sorted lists. IndirectGeometryPass zeroes the count before the dispatch.
+
+
+static const uint kGroupSize = 256;
+
+// InstanceCulling::IndirectCommand, 64 bytes
+struct IndirectCommand
+{
+	uint2 objectDataAddress;
+	uint2 vertexBufferLocation;
+	uint vertexBufferSize;
+	uint vertexBufferStride;
+	uint2 indexBufferLocation;
+	uint indexBufferSize;
+	uint indexBufferFormat;
+	uint indexCountPerInstance;
+	uint instanceCount;
+	uint startIndexLocation;
+	int baseVertexLocation;
+	uint startInstanceLocation;
+	uint padding;
+};
+
+// InstanceCulling::Instance, world space bounds
+struct Instance
+{
+	float3 center;
+	uint objectDataOffset;
+	float3 extents;
+	uint padding;
+	IndirectCommand command;
+};
+
+cbuffer CullingConstants : register(b0)
+{
+	// Left, right, bottom, top, near, far
+	float4 FrustumPlanes[6];
+	// Object constant buffers of the frame
+	uint2 ObjectDataAddress;
+	uint InstancesCount;
+};
+
+StructuredBuffer<Instance> Instances : register(t0);
+RWStructuredBuffer<IndirectCommand> Commands : register(u0);
+RWByteAddressBuffer CommandsCount : register(u1);
+
+groupshared uint VisibleCounts[kGroupSize];
+groupshared uint GroupCommandsOffset;
+
+
+bool IsVisible(Instance instance)
+{
+	[unroll]
+	for (uint i = 0; i < 6; i++)
+	{
+		const float4 plane = FrustumPlanes[i];
+		// Same operation order as the reference
+		const float distance = plane.x * instance.center.x + plane.y * instance.center.y
+			+ plane.z * instance.center.z + plane.w;
+		const float radius = abs(plane.x) * instance.extents.x + abs(plane.y) * instance.extents.y
+			+ abs(plane.z) * instance.extents.z;
+		if (distance + radius < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+uint2 AddAddress(uint2 address, uint offset)
+{
+	const uint low = address.x + offset;
+	return uint2(low, address.y + (low < address.x ? 1 : 0));
+}
+
+
+[numthreads(kGroupSize, 1, 1)]
+void cs_main(uint3 groupId : SV_GroupID, uint threadIndex : SV_GroupIndex)
+{
+	const uint instanceIndex = groupId.x * kGroupSize + threadIndex;
+	const bool visible = instanceIndex < InstancesCount && IsVisible(Instances[instanceIndex]);
+
+	// Inclusive prefix sum of the visible flags
+	VisibleCounts[threadIndex] = visible ? 1 : 0;
+	GroupMemoryBarrierWithGroupSync();
+	for (uint offset = 1; offset < kGroupSize; offset <<= 1)
+	{
+		const uint value = threadIndex >= offset ? VisibleCounts[threadIndex - offset] : 0;
+		GroupMemoryBarrierWithGroupSync();
+		VisibleCounts[threadIndex] += value;
+		GroupMemoryBarrierWithGroupSync();
+	}
+
+	// The last thread holds the total of the group
+	if (threadIndex == kGroupSize - 1)
+		CommandsCount.InterlockedAdd(0, VisibleCounts[threadIndex], GroupCommandsOffset);
+	GroupMemoryBarrierWithGroupSync();
+
+	if (visible)
+	{
+		IndirectCommand command = Instances[instanceIndex].command;
+		command.objectDataAddress = AddAddress(ObjectDataAddress, Instances[instanceIndex].objectDataOffset);
+		Commands[GroupCommandsOffset + VisibleCounts[threadIndex] - 1] = command;
+	}
+}
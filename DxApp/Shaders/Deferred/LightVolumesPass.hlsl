@@ -0,0 +1,68 @@
+#include "LightingPass.hlsli"
+#include "Lighting.hlsli"
+
+// Deferred lighting by light volumes, see LightVolumesPass.h for the stencil sequence.
+// Radiance is accumulated in linear space, resolve_ps_main applies the gamma.
+
+
+cbuffer VolumeConstants : register(b1)
+{
+	// LightVolumes::GetPointLightTransform or GetSpotLightTransform
+	float4x4 VolumeTransform;
+	// Point lights first, then spot lights
+	uint LightIndex;
+};
+
+Texture2D<float4> AccumulatedRadiance : register(t4);
+
+
+float4 vs_main(in float3 position : POSITION) : SV_POSITION
+{
+	const float4 worldPosition = mul(VolumeTransform, float4(position, 1.0f));
+	return mul(ViewProjection, worldPosition);
+}
+
+
+void light_ps_main(in float4 position : SV_POSITION, out float4 outputRadiance : SV_Target)
+{
+	// Accumulation target is bound for the output, the size comes from the GBuffer
+	float2 screenSize;
+#if defined(COMPACT_GBUFFER)
+	SurfaceColorMaterial.GetDimensions(screenSize.x, screenSize.y);
+#else
+	SurfaceColor.GetDimensions(screenSize.x, screenSize.y);
+#endif
+
+	const Surface surface = LoadSurface(int2(position.xy), position.xy / screenSize);
+	const float3 view = normalize(CameraPosition.xyz - surface.position);
+
+	// Shading is exact, the volume only bounds the pixels
+	const uint pointLightsCount = LightSources.pointLightSourcesCount;
+	const float3 radiance = LightIndex < pointLightsCount
+		? GetPointLightRadiance(LightIndex, surface, view)
+		: GetSpotLightRadiance(LightIndex - pointLightsCount, surface, view);
+
+	outputRadiance = float4(radiance, 0.0f);
+}
+
+
+void ambient_ps_main(in PixelAttributes attributes, out float4 outputRadiance : SV_Target)
+{
+	const Surface surface = LoadSurface(int2(attributes.position.xy), attributes.uv);
+
+	float3 radiance = GetAmbientRadiance(surface);
+
+#if defined(DIRECTIONAL_LIGHTS)
+	const float3 view = normalize(CameraPosition.xyz - surface.position);
+	for (uint i = 0; i < LightSources.directionalLightSourcesCount; i++)
+		radiance += GetDirectionalLightRadiance(i, surface, view);
+#endif
+
+	outputRadiance = float4(radiance, 1.0f);
+}
+
+
+void resolve_ps_main(in PixelAttributes attributes, out float4 outputColor : SV_Target)
+{
+	outputColor = ToOutputColor(AccumulatedRadiance.Load(int3(attributes.position.xy, 0)).xyz);
+}
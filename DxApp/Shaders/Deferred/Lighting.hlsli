@@ -0,0 +1,216 @@
+#ifndef LIGHTING_INCLUDES
+#define LIGHTING_INCLUDES
+
+// Pbr calculations ported from https://github.com/hypelive/VulkanApp/blob/master/VulkanApp/shaders/pbr.frag
+// Shared by the lighting pixel shader and the tiled lighting compute shader
+
+#include "GBufferEncoding.hlsli"
+#include "../Shared/LightSourcesData.h"
+
+
+// Permutation defines, see ShaderList.txt:
+// DIRECTIONAL_LIGHTS, POINT_LIGHTS, SPOT_LIGHTS - light loops compiled in, counts are still read from LightSources
+// LINEAR_FALOFF - linear instead of squared distance falloff
+// DEBUG_VIEW_* - outputs a GBuffer channel instead of the lighting
+// COMPACT_GBUFFER - reads GBufferMode::Compact targets, position is reconstructed from depth
+#if !defined(LINEAR_FALOFF)
+	#define SQR_FALOFF 1
+#endif
+
+static const float kPi = 3.1415926538f;
+static const float kGamma = 2.2f;
+static const float kInvGamma = 1.0f / kGamma;
+
+
+static const float kLutSize = 64.0f;
+static const float kLutScale = (kLutSize - 1.0f) / kLutSize;
+static const float kLutBias = 0.5f / kLutSize;
+
+
+cbuffer ConstantBuffer : register(b0)
+{
+	float4 CameraPosition;
+	float4x4 InverseViewProjection;
+	float4x4 ViewProjection;
+	LightSourcesStruct LightSources;
+};
+
+#if defined(COMPACT_GBUFFER)
+Texture2D<float4> SurfaceColorMaterial : register(t0);
+Texture2D<float2> Normal : register(t1);
+Texture2D<float2> RoughnessMetalness : register(t2);
+Texture2D<float> Depth : register(t3);
+#else
+Texture2D<float4> SurfaceColor : register(t0);
+Texture2D<float4> PositionRoughness : register(t1);
+Texture2D<float4> NormalMetalness : register(t2);
+Texture2D<float4> FresnelIndices : register(t3);
+#endif
+
+// https://en.wikipedia.org/wiki/Schlick%27s_approximation
+float3 GetFresnelReflectance(float3 n, float3 l, float3 F0)
+{
+	const float NdotL = dot(n, l);
+
+	return F0 + (1 - F0) * pow(1 - max(0, NdotL), 5);
+}
+
+
+float GetMaskingShadowing(float3 l, float3 v, float3 m, float roughness)
+{
+	const float MdotV = dot(m, v);
+	const float MdotL = dot(m, l);
+	const float sqrMdotV = MdotV * MdotV;
+	const float numerator = float(MdotV > 0 && MdotL > 0);
+
+	return numerator / sqrt(1 + roughness * roughness * (1 - sqrMdotV) / sqrMdotV);
+}
+
+float GetNormalDistribution(float3 n, float3 m, float roughness)
+{
+	const float NdotM = dot(n, m);
+	const float sqrAlpha = roughness * roughness;
+
+	const float temp = 1 + NdotM * NdotM * (sqrAlpha - 1);
+	return float(NdotM > 0) * sqrAlpha / (kPi * temp * temp);
+}
+
+
+float3 GetBrdf(float3 n, float3 v, float3 l, float3 F0, float3 rho, float roughness)
+{
+	const float3 h = normalize(l + v);
+	const float3 F = GetFresnelReflectance(n, l, F0);
+	const float G = GetMaskingShadowing(l, v, h, roughness);
+	const float D = GetNormalDistribution(n, h, roughness);
+
+	const float3 specular = F * G * D / (4 * max(1e-7f, abs(dot(n, l))) * abs(dot(n, v)));
+	const float3 diffuse = (1 - F) * rho / kPi;
+
+	return specular + diffuse;
+}
+
+
+struct Surface
+{
+	float3 position;
+	float3 normal;
+	float3 surfaceColor;
+	float roughness;
+	float metalness;
+	float3 F0;
+	float3 rho;
+};
+
+
+Surface MakeSurface(float3 position, float3 normal, float3 surfaceColor, float roughness, float metalness,
+	float3 fresnelIndices)
+{
+	Surface surface;
+	surface.position = position;
+	surface.normal = normal;
+	surface.surfaceColor = surfaceColor;
+	surface.roughness = roughness;
+	surface.metalness = metalness;
+	surface.F0 = lerp(fresnelIndices, surfaceColor, metalness);
+	surface.rho = lerp(surfaceColor, float3(0.0f, 0.0f, 0.0f), metalness);
+	return surface;
+}
+
+
+// uv of the pixel center, used to reconstruct the position in the compact mode
+Surface LoadSurface(int2 pixel, float2 uv)
+{
+	Surface surface;
+	const int3 location = int3(pixel, 0);
+
+#if defined(COMPACT_GBUFFER)
+	const float4 surfaceColorMaterial = SurfaceColorMaterial.Load(location);
+	surface.surfaceColor = surfaceColorMaterial.xyz;
+	surface.position = ReconstructPosition(uv, Depth.Load(location), InverseViewProjection);
+	surface.normal = DecodeOctahedralNormal(Normal.Load(location));
+
+	const float2 roughnessMetalness = RoughnessMetalness.Load(location);
+	surface.roughness = roughnessMetalness.x;
+	surface.metalness = roughnessMetalness.y;
+
+	const float3 fresnelIndices = kMaterialFresnelIndices[min(DecodeMaterialIndex(surfaceColorMaterial.w), kMaterialsCount - 1)];
+#else
+	surface.surfaceColor = SurfaceColor.Load(location).xyz;
+
+	const float4 positionRoughness = PositionRoughness.Load(location);
+	surface.position = positionRoughness.xyz;
+	surface.roughness = positionRoughness.w;
+
+	const float4 normalMetalness = NormalMetalness.Load(location);
+	surface.normal = normalize(normalMetalness.xyz);
+	surface.metalness = normalMetalness.w;
+
+	const float3 fresnelIndices = FresnelIndices.Load(location).xyz;
+#endif
+
+	return MakeSurface(surface.position, surface.normal, surface.surfaceColor, surface.roughness, surface.metalness,
+		fresnelIndices);
+}
+
+
+float GetDistanceAttenuation(float3 pointOffset)
+{
+	const float sqrLenght = max(1.0f, dot(pointOffset, pointOffset));
+#if defined(LINEAR_FALOFF)
+	return 1 / sqrt(sqrLenght);
+#elif defined(SQR_FALOFF)
+	return 1 / sqrLenght;
+#endif
+}
+
+
+float3 GetAmbientRadiance(Surface surface)
+{
+	return LightSources.ambient.color.xyz * surface.rho;
+}
+
+
+float3 GetDirectionalLightRadiance(uint index, Surface surface, float3 view)
+{
+	const float3 lightDirection = LightSources.directionalSources[index].direction.xyz;
+	const float3 brdf = GetBrdf(surface.normal, view, lightDirection, surface.F0, surface.rho, surface.roughness);
+
+	return LightSources.directionalSources[index].color.xyz * max(0, dot(lightDirection, surface.normal)) * brdf;
+}
+
+
+float3 GetPointLightRadiance(uint index, Surface surface, float3 view)
+{
+	const float3 pointOffset = LightSources.pointLightSources[index].position.xyz - surface.position;
+	const float pointIntensity = GetDistanceAttenuation(pointOffset);
+
+	const float3 lightDirection = normalize(pointOffset);
+	const float3 brdf = GetBrdf(surface.normal, view, lightDirection, surface.F0, surface.rho, surface.roughness);
+
+	return LightSources.pointLightSources[index].color.xyz * pointIntensity * max(0, dot(lightDirection, surface.normal)) * brdf;
+}
+
+
+float3 GetSpotLightRadiance(uint index, Surface surface, float3 view)
+{
+	const float3 pointOffset = LightSources.spotLightSources[index].position.xyz - surface.position;
+	const float3 spotDirection = LightSources.spotLightSources[index].direction;
+	const float3 lightDirection = normalize(pointOffset);
+
+	// Step function
+	// TODO new function for attenuation
+	const float angleAttenuation = dot(-lightDirection, spotDirection) >= LightSources.spotLightSources[index].minLdotDir;
+	const float pointIntensity = GetDistanceAttenuation(pointOffset);
+
+	const float3 brdf = GetBrdf(surface.normal, view, lightDirection, surface.F0, surface.rho, surface.roughness);
+
+	return LightSources.spotLightSources[index].color.xyz * pointIntensity * angleAttenuation * max(0, dot(lightDirection, surface.normal)) * brdf;
+}
+
+
+float4 ToOutputColor(float3 radiance)
+{
+	return float4(pow(radiance, kInvGamma), 1.0f);
+}
+
+#endif
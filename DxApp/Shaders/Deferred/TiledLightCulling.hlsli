@@ -0,0 +1,58 @@
+#ifndef TILED_LIGHT_CULLING_INCLUDES
+#define TILED_LIGHT_CULLING_INCLUDES
+
+#include "GBufferEncoding.hlsli"
+
+// Light vs tile tests of the tiled lighting, TiledLightCulling.cpp is the CPU reference, keep them in sync
+
+
+static const uint kTileSize = 16;
+// Radiance below it is dropped, bounds the range of the point and spot lights
+static const float kLightRadianceCutoff = 1.0f / 1024.0f;
+
+
+struct Aabb
+{
+	float3 minCorner;
+	float3 maxCorner;
+};
+
+
+// Distance where the light color times the distance attenuation falls under kLightRadianceCutoff
+float GetLightRange(float3 color, bool linearFalloff)
+{
+	const float intensity = max(color.x, max(color.y, color.z));
+	// Attenuation is clamped to 1 up to the distance 1
+	return max(1.0f, linearFalloff ? intensity / kLightRadianceCutoff : sqrt(intensity / kLightRadianceCutoff));
+}
+
+// World space box around the part of the view frustum the tile covers between the depths
+Aabb ComputeTileBounds(uint2 tile, uint2 screenSize, float minDepth, float maxDepth, float4x4 inverseViewProjection)
+{
+	const float2 uvMin = float2(tile * kTileSize) / float2(screenSize);
+	const float2 uvMax = min(float2((tile + 1) * kTileSize) / float2(screenSize), 1.0f);
+
+	Aabb bounds;
+	bounds.minCorner = float3(3.402823466e+38f, 3.402823466e+38f, 3.402823466e+38f);
+	bounds.maxCorner = -bounds.minCorner;
+
+	[unroll]
+	for (uint i = 0; i < 8; i++)
+	{
+		const float2 uv = float2((i & 1) ? uvMax.x : uvMin.x, (i & 2) ? uvMax.y : uvMin.y);
+		const float depth = (i & 4) ? maxDepth : minDepth;
+		const float3 corner = ReconstructPosition(uv, depth, inverseViewProjection);
+		bounds.minCorner = min(bounds.minCorner, corner);
+		bounds.maxCorner = max(bounds.maxCorner, corner);
+	}
+
+	return bounds;
+}
+
+bool SphereIntersectsAabb(float3 center, float radius, Aabb bounds)
+{
+	const float3 offset = center - clamp(center, bounds.minCorner, bounds.maxCorner);
+	return dot(offset, offset) <= radius * radius;
+}
+
+#endif
@@ -0,0 +1,137 @@
+#include "Lighting.hlsli"
+#include "TiledLightCulling.hlsli"
+
+
+// Same permutations as LightingPass_ps except the debug views.
+// Every 16x16 tile bounds its depths, culls the point and spot lights against the bounds in groupshared memory
+// and shades its pixels with the lights left.
+
+
+// Point lights first, then spot lights
+static const uint kTileLightsCapacity = LightSourcesStruct::kMaxPointLightSourcesCount
+	+ LightSourcesStruct::kMaxSpotLightSourcesCount;
+static const uint kTileThreadsCount = kTileSize * kTileSize;
+
+
+// Depth of the tile pixels in every GBuffer mode, the compact mode reads it through Depth as well
+Texture2D<float> TileDepth : register(t4);
+RWTexture2D<float4> Output : register(u0);
+
+groupshared uint TileMinDepth;
+groupshared uint TileMaxDepth;
+groupshared uint TileLightsCount;
+groupshared uint TileLightIndices[kTileLightsCapacity];
+
+
+bool IsLightInTile(uint lightIndex, Aabb bounds)
+{
+#if defined(LINEAR_FALOFF)
+	const bool linearFalloff = true;
+#else
+	const bool linearFalloff = false;
+#endif
+
+#if defined(POINT_LIGHTS)
+	if (lightIndex < LightSourcesStruct::kMaxPointLightSourcesCount)
+	{
+		if (lightIndex >= LightSources.pointLightSourcesCount)
+			return false;
+		const PointLightSource light = LightSources.pointLightSources[lightIndex];
+		return SphereIntersectsAabb(light.position.xyz, GetLightRange(light.color.xyz, linearFalloff), bounds);
+	}
+#endif
+
+#if defined(SPOT_LIGHTS)
+	if (lightIndex >= LightSourcesStruct::kMaxPointLightSourcesCount)
+	{
+		const uint spotIndex = lightIndex - LightSourcesStruct::kMaxPointLightSourcesCount;
+		if (spotIndex >= LightSources.spotLightSourcesCount)
+			return false;
+		// Bounding sphere of the cone is the sphere of the light range
+		const SpotLightSource light = LightSources.spotLightSources[spotIndex];
+		return SphereIntersectsAabb(light.position.xyz, GetLightRange(light.color.xyz, linearFalloff), bounds);
+	}
+#endif
+
+	return false;
+}
+
+
+[numthreads(kTileSize, kTileSize, 1)]
+void cs_main(uint3 dispatchThreadId : SV_DispatchThreadID, uint3 groupId : SV_GroupID, uint groupIndex : SV_GroupIndex)
+{
+	if (groupIndex == 0)
+	{
+		TileMinDepth = 0xffffffff;
+		TileMaxDepth = 0;
+		TileLightsCount = 0;
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	uint2 screenSize;
+	TileDepth.GetDimensions(screenSize.x, screenSize.y);
+	const uint2 pixel = dispatchThreadId.xy;
+	const bool isInsideScreen = all(pixel < screenSize);
+
+	// Depth 1 is the cleared value, nothing to shade there
+	const float depth = isInsideScreen ? TileDepth.Load(int3(pixel, 0)) : 1.0f;
+	const bool isCovered = depth < 1.0f;
+	// Non negative floats order as their bits
+	if (isCovered)
+	{
+		InterlockedMin(TileMinDepth, asuint(depth));
+		InterlockedMax(TileMaxDepth, asuint(depth));
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	if (TileMinDepth <= TileMaxDepth)
+	{
+		const Aabb bounds = ComputeTileBounds(groupId.xy, screenSize, asfloat(TileMinDepth), asfloat(TileMaxDepth),
+			InverseViewProjection);
+
+		for (uint lightIndex = groupIndex; lightIndex < kTileLightsCapacity; lightIndex += kTileThreadsCount)
+		{
+			if (IsLightInTile(lightIndex, bounds))
+			{
+				uint slot;
+				InterlockedAdd(TileLightsCount, 1, slot);
+				TileLightIndices[slot] = lightIndex;
+			}
+		}
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	if (!isInsideScreen)
+		return;
+	if (!isCovered)
+	{
+		Output[pixel] = float4(0.0f, 0.0f, 0.0f, 1.0f);
+		return;
+	}
+
+	const float2 uv = (float2(pixel) + 0.5f) / float2(screenSize);
+	const Surface surface = LoadSurface(int2(pixel), uv);
+	const float3 view = normalize(CameraPosition.xyz - surface.position);
+
+	float3 radiance = GetAmbientRadiance(surface);
+
+#if defined(DIRECTIONAL_LIGHTS)
+	for (uint i = 0; i < LightSources.directionalLightSourcesCount; i++)
+		radiance += GetDirectionalLightRadiance(i, surface, view);
+#endif
+
+	for (uint j = 0; j < TileLightsCount; j++)
+	{
+		const uint lightIndex = TileLightIndices[j];
+#if defined(POINT_LIGHTS)
+		if (lightIndex < LightSourcesStruct::kMaxPointLightSourcesCount)
+			radiance += GetPointLightRadiance(lightIndex, surface, view);
+#endif
+#if defined(SPOT_LIGHTS)
+		if (lightIndex >= LightSourcesStruct::kMaxPointLightSourcesCount)
+			radiance += GetSpotLightRadiance(lightIndex - LightSourcesStruct::kMaxPointLightSourcesCount, surface, view);
+#endif
+	}
+
+	Output[pixel] = ToOutputColor(radiance);
+}
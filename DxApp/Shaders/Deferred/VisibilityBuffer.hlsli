@@ -0,0 +1,52 @@
+#ifndef VISIBILITY_BUFFER_INCLUDES
+#define VISIBILITY_BUFFER_INCLUDES
+
+// Visibility buffer id packing and attribute reconstruction, VisibilityBuffer.cpp is the CPU reference, keep them in sync
+
+
+static const uint kTriangleIndexBits = 22;
+static const uint kTriangleIndexMask = (1u << kTriangleIndexBits) - 1;
+
+
+uint PackVisibilityId(uint objectIndex, uint triangleIndex)
+{
+	return (objectIndex << kTriangleIndexBits) | (triangleIndex & kTriangleIndexMask);
+}
+
+uint GetObjectIndex(uint visibilityId)
+{
+	return visibilityId >> kTriangleIndexBits;
+}
+
+uint GetTriangleIndex(uint visibilityId)
+{
+	return visibilityId & kTriangleIndexMask;
+}
+
+// Perspective correct barycentrics of the pixel, pixelNdc is the pixel center in normalized device coordinates
+float3 ComputeBarycentrics(float4 clipPosition0, float4 clipPosition1, float4 clipPosition2, float2 pixelNdc)
+{
+	const float3 invW = 1.0f / float3(clipPosition0.w, clipPosition1.w, clipPosition2.w);
+	const float2 ndc0 = clipPosition0.xy * invW.x;
+	const float2 ndc1 = clipPosition1.xy * invW.y;
+	const float2 ndc2 = clipPosition2.xy * invW.z;
+
+	// Screen space barycentrics, linear in ndc
+	const float2 edge1 = ndc1 - ndc0;
+	const float2 edge2 = ndc2 - ndc0;
+	const float2 offset = pixelNdc - ndc0;
+	const float invDeterminant = 1.0f / (edge1.x * edge2.y - edge1.y * edge2.x);
+	const float screen1 = (offset.x * edge2.y - offset.y * edge2.x) * invDeterminant;
+	const float screen2 = (edge1.x * offset.y - edge1.y * offset.x) * invDeterminant;
+
+	// Attributes are linear in 1 / w
+	const float3 perspective = float3(1.0f - screen1 - screen2, screen1, screen2) * invW;
+	return perspective / (perspective.x + perspective.y + perspective.z);
+}
+
+float3 Interpolate(float3 value0, float3 value1, float3 value2, float3 barycentrics)
+{
+	return value0 * barycentrics.x + value1 * barycentrics.y + value2 * barycentrics.z;
+}
+
+#endif
@@ -0,0 +1,13 @@
+#include "VisibilityBuffer.hlsli"
+
+
+cbuffer ObjectConstants : register(b1)
+{
+	uint ObjectIndex;
+};
+
+
+uint ps_main(in float4 position : SV_POSITION, in uint primitiveId : SV_PrimitiveID) : SV_Target
+{
+	return PackVisibilityId(ObjectIndex, primitiveId);
+}
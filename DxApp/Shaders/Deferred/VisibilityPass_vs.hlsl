@@ -0,0 +1,19 @@
+#include "../Shared/SceneObjectData.h"
+
+
+// Position only, the other attributes are fetched by the resolve pass
+struct VertexAttributes
+{
+    float4 position : POSITION;
+};
+
+cbuffer ConstantBuffer : register(b0)
+{
+    SceneObjectData sceneData;
+}
+
+float4 vs_main(in VertexAttributes input) : SV_POSITION
+{
+    // Same transform as VisibilityResolvePass_ps, so the reconstructed barycentrics match the rasterized triangle
+    return mul(sceneData.mvp, input.position);
+}
@@ -0,0 +1,78 @@
+#include "LightingPass.hlsli"
+#include "../Shared/SceneObjectData.h"
+#include "GBufferOutput.hlsli"
+#include "VisibilityBuffer.hlsli"
+
+
+// Fetches the triangle of every covered pixel and writes the GBuffer as the geometry pass would.
+// COMPACT_GBUFFER permutation matches GBufferMode::Compact.
+
+
+// SceneObject::Vertex
+static const uint kVertexStride = 48;
+static const uint kVertexColorOffset = 16;
+static const uint kVertexNormalOffset = 32;
+
+// SceneObjectData offsets
+static const uint kModelOffset = 0;
+static const uint kMvpOffset = 192;
+
+
+cbuffer ResolveConstants : register(b0)
+{
+	// GeometryPassObjectConstantBuffer::GetAlignedSize()
+	uint ObjectDataStride;
+};
+
+Texture2D<uint> VisibilityIds : register(t0);
+// Geometry pass constant buffers of the frame
+ByteAddressBuffer ObjectsData : register(t1);
+// Vertex and index buffer of every scene object, interleaved
+ByteAddressBuffer MeshBuffers[] : register(t0, space1);
+
+
+// Matrices are stored for row vectors, loading the rows keeps mul(matrix, vector) semantics of the cbuffers
+float4x4 LoadMatrix(uint address)
+{
+	return transpose(float4x4(asfloat(ObjectsData.Load4(address)), asfloat(ObjectsData.Load4(address + 16)),
+		asfloat(ObjectsData.Load4(address + 32)), asfloat(ObjectsData.Load4(address + 48))));
+}
+
+
+void ps_main(in PixelAttributes attributes, out OutputAttributes output)
+{
+	const uint visibilityId = VisibilityIds.Load(int3(attributes.position.xy, 0));
+	const uint objectIndex = GetObjectIndex(visibilityId);
+	const uint triangleIndex = GetTriangleIndex(visibilityId);
+
+	const uint objectDataAddress = objectIndex * ObjectDataStride;
+	const float4x4 model = LoadMatrix(objectDataAddress + kModelOffset);
+	const float4x4 mvp = LoadMatrix(objectDataAddress + kMvpOffset);
+
+	const ByteAddressBuffer vertices = MeshBuffers[NonUniformResourceIndex(objectIndex * 2)];
+	const ByteAddressBuffer indices = MeshBuffers[NonUniformResourceIndex(objectIndex * 2 + 1)];
+	const uint3 triangleIndices = indices.Load3(triangleIndex * 12);
+
+	float4 clipPositions[3];
+	float3 worldPositions[3];
+	float3 colors[3];
+	float3 normals[3];
+	[unroll]
+	for (uint i = 0; i < 3; i++)
+	{
+		const uint vertexAddress = triangleIndices[i] * kVertexStride;
+		const float4 position = asfloat(vertices.Load4(vertexAddress));
+		clipPositions[i] = mul(mvp, position);
+		worldPositions[i] = mul(model, position).xyz;
+		colors[i] = asfloat(vertices.Load3(vertexAddress + kVertexColorOffset));
+		// normal.w = 0, so translation ignored
+		normals[i] = mul(model, float4(asfloat(vertices.Load3(vertexAddress + kVertexNormalOffset)), 0.0f)).xyz;
+	}
+
+	const float2 pixelNdc = float2(attributes.uv.x * 2.0f - 1.0f, 1.0f - attributes.uv.y * 2.0f);
+	const float3 barycentrics = ComputeBarycentrics(clipPositions[0], clipPositions[1], clipPositions[2], pixelNdc);
+
+	output = EncodeGBuffer(Interpolate(colors[0], colors[1], colors[2], barycentrics),
+		Interpolate(worldPositions[0], worldPositions[1], worldPositions[2], barycentrics),
+		Interpolate(normals[0], normals[1], normals[2], barycentrics));
+}
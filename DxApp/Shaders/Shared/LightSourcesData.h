@@ -0,0 +1,122 @@
+#ifndef LIGHT_SOURCES_DATA_INCLUDES
+#define LIGHT_SOURCES_DATA_INCLUDES
+
+#include "ShaderInterop.h"
+
+#if defined(SHADER_INTEROP_CPP)
+#include <math.h>
+#endif
+
+
+SHADER_INTEROP_BEGIN
+
+// Light sources as the lighting constant buffers hold them, w of the vectors unused.
+// Every struct repeats the color, a C++ base with members would leave the derived structs without offsetof.
+
+struct AmbientLightSource
+{
+	float4 color;
+
+#if defined(SHADER_INTEROP_CPP)
+	AmbientLightSource() : color{0.0f, 0.0f, 0.0f, 1.0f} { }
+
+	AmbientLightSource(float4 lightColor) : color(lightColor) { }
+#endif
+};
+
+
+struct DirectionalLightSource
+{
+	float4 color;
+	float4 direction;
+
+#if defined(SHADER_INTEROP_CPP)
+	DirectionalLightSource() : color{0.0f, 0.0f, 0.0f, 1.0f}, direction{0.0f, 0.0f, 0.0f, 1.0f} { }
+
+	DirectionalLightSource(float4 lightColor, float4 lightDirection) :
+		color(lightColor), direction(lightDirection)
+	{
+	}
+#endif
+};
+
+
+struct PointLightSource
+{
+	float4 color;
+	float4 position;
+
+#if defined(SHADER_INTEROP_CPP)
+	PointLightSource() : color{0.0f, 0.0f, 0.0f, 1.0f}, position{0.0f, 0.0f, 0.0f, 1.0f} { }
+
+	PointLightSource(float4 lightColor, float4 lightPosition) :
+		color(lightColor), position(lightPosition)
+	{
+	}
+#endif
+};
+
+
+struct SpotLightSource
+{
+	float4 color;
+	float4 position;
+	float3 direction;
+	float minLdotDir;
+
+#if defined(SHADER_INTEROP_CPP)
+	SpotLightSource() :
+		color{0.0f, 0.0f, 0.0f, 1.0f}, position{0.0f, 0.0f, 0.0f, 1.0f}, direction{1.0f, 0.0f, 0.0f}, minLdotDir(0.0f)
+	{
+	}
+
+	// angle in radians from [0, pi]
+	SpotLightSource(float4 lightColor, float4 lightPosition, float4 lightDirection, float angle) :
+		color(lightColor), position(lightPosition),
+		direction{lightDirection.x, lightDirection.y, lightDirection.z}, minLdotDir(cosf(angle))
+	{
+	}
+#endif
+};
+
+
+struct RectLightSource
+{
+	float4 color;
+	float4 vertexPositions[4];
+
+#if defined(SHADER_INTEROP_CPP)
+	RectLightSource() : color{0.0f, 0.0f, 0.0f, 1.0f}
+	{
+		for (uint32_t i = 0; i < 4; i++)
+			vertexPositions[i] = float4{0.0f, 0.0f, 0.0f, 1.0f};
+	}
+
+	RectLightSource(float4 lightColor, const float4 lightVertexPositions[4]) : color(lightColor)
+	{
+		for (uint32_t i = 0; i < 4; i++)
+			vertexPositions[i] = lightVertexPositions[i];
+	}
+#endif
+};
+
+
+struct LightSourcesStruct
+{
+	SHADER_INTEROP_CONSTANT uint kMaxDirectionalLightSourcesCount = 2;
+	SHADER_INTEROP_CONSTANT uint kMaxPointLightSourcesCount = 4;
+	SHADER_INTEROP_CONSTANT uint kMaxSpotLightSourcesCount = 4;
+
+	AmbientLightSource ambient;
+	DirectionalLightSource directionalSources[kMaxDirectionalLightSourcesCount];
+	PointLightSource pointLightSources[kMaxPointLightSourcesCount];
+	SpotLightSource spotLightSources[kMaxSpotLightSourcesCount];
+
+	uint directionalLightSourcesCount;
+	uint pointLightSourcesCount;
+	uint spotLightSourcesCount;
+};
+
+SHADER_INTEROP_END
+
+#endif
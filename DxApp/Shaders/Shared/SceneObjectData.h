@@ -0,0 +1,27 @@
+#ifndef SCENE_OBJECT_DATA_INCLUDES
+#define SCENE_OBJECT_DATA_INCLUDES
+
+#include "ShaderInterop.h"
+
+
+SHADER_INTEROP_BEGIN
+
+// Per object constant buffer of the geometry, depth pre-pass and visibility passes, GeometryPassObjectConstantBuffer
+struct SceneObjectData
+{
+	float4x4 model;
+	float4x4 view;
+	float4x4 projection;
+
+	float4x4 mvp;
+
+	float4x4 vp;
+
+#if defined(SHADER_INTEROP_CPP)
+	static uint32_t GetAlignedSize() { return (sizeof(SceneObjectData) + 255) & ~255; }
+#endif
+};
+
+SHADER_INTEROP_END
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef SHADER_INTEROP_INCLUDES
+#define SHADER_INTEROP_INCLUDES
+
+// Base of the headers in Shaders/Shared, they compile both as HLSL and as C++.
+// C++ sees the HLSL vector types as the SimdMath storage types of the same size, inside the ShaderInterop namespace.
+// Structs are laid out for constant buffers: no inheritance, vectors do not cross 16 byte boundaries,
+// arrays of structs have sizes multiple of 16. CheckLayouts.py verifies the offsets with the DXC reflection.
+
+// DXC parses HLSL as a C++ dialect
+#if defined(__cplusplus) && !defined(__HLSL_VERSION)
+#define SHADER_INTEROP_CPP 1
+#endif
+
+#if defined(SHADER_INTEROP_CPP)
+
+#include <stdint.h>
+#include "../../SimdMath.h"
+
+#define SHADER_INTEROP_BEGIN namespace ShaderInterop {
+#define SHADER_INTEROP_END }
+#define SHADER_INTEROP_CONSTANT static constexpr
+
+namespace ShaderInterop
+{
+	using uint = uint32_t;
+
+	using float2 = SimdMath::Float2;
+	using float3 = SimdMath::Float3;
+	using float4 = SimdMath::Float4;
+	using float4x4 = SimdMath::Float4x4;
+}
+
+#else
+
+#define SHADER_INTEROP_BEGIN
+#define SHADER_INTEROP_END
+#define SHADER_INTEROP_CONSTANT static const
+
+#endif
+
+#endif
@@ -0,0 +1,306 @@
+#include "SimdMath.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+#if __has_include(<DirectXMath.h>)
+#include <DirectXMath.h>
+#define SIMD_MATH_HAS_DIRECTXMATH 1
+#endif
+
+
+namespace SimdMath
+{
+	Matrix MatrixInverse(const Matrix& matrix)
+	{
+		Float4x4 source;
+		StoreFloat4x4(source, matrix);
+		const float* m = &source.m[0][0];
+
+		float inverse[16];
+		inverse[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14]
+			+ m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+		inverse[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14]
+			- m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+		inverse[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13]
+			+ m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+		inverse[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13]
+			- m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+		inverse[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14]
+			- m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+		inverse[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14]
+			+ m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+		inverse[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13]
+			- m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+		inverse[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13]
+			+ m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+		inverse[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14]
+			+ m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+		inverse[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14]
+			- m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+		inverse[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13]
+			+ m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+		inverse[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13]
+			- m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+		inverse[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10]
+			- m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+		inverse[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10]
+			+ m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+		inverse[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9]
+			- m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+		inverse[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9]
+			+ m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+		const float determinant = m[0] * inverse[0] + m[1] * inverse[4] + m[2] * inverse[8] + m[3] * inverse[12];
+		const Vector scale = VectorReplicate(1.0f / determinant);
+
+		const Float4x4 adjugate(inverse);
+		const Matrix result = LoadFloat4x4(adjugate);
+		return { { VectorMultiply(result.r[0], scale), VectorMultiply(result.r[1], scale),
+			VectorMultiply(result.r[2], scale), VectorMultiply(result.r[3], scale) } };
+	}
+
+
+	Matrix MatrixLookAtRH(Vector eyePosition, Vector focusPosition, Vector upDirection)
+	{
+		// Rows of the rotation are the camera axes, the view looks along -z
+		const Vector zAxis = Vector3Normalize(VectorSubtract(eyePosition, focusPosition));
+		const Vector xAxis = Vector3Normalize(Vector3Cross(upDirection, zAxis));
+		const Vector yAxis = Vector3Cross(zAxis, xAxis);
+
+		const Vector negativeEye = VectorNegate(eyePosition);
+		const Vector keepXyz = VectorSelectControl(1, 1, 1, 0);
+		Matrix result;
+		result.r[0] = VectorSelect(Vector3Dot(xAxis, negativeEye), xAxis, keepXyz);
+		result.r[1] = VectorSelect(Vector3Dot(yAxis, negativeEye), yAxis, keepXyz);
+		result.r[2] = VectorSelect(Vector3Dot(zAxis, negativeEye), zAxis, keepXyz);
+		result.r[3] = VectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+		return MatrixTranspose(result);
+	}
+
+
+	Matrix MatrixPerspectiveFovRH(float fovAngleY, float aspectRatio, float nearZ, float farZ)
+	{
+		const float height = cosf(0.5f * fovAngleY) / sinf(0.5f * fovAngleY);
+		const float width = height / aspectRatio;
+		const float range = farZ / (nearZ - farZ);
+		return { { VectorSet(width, 0.0f, 0.0f, 0.0f), VectorSet(0.0f, height, 0.0f, 0.0f),
+			VectorSet(0.0f, 0.0f, range, -1.0f), VectorSet(0.0f, 0.0f, range * nearZ, 0.0f) } };
+	}
+
+
+	void ExtractFrustumPlanes(const Float4x4& viewProjection, Float4 planes[6])
+	{
+		// Clip coordinates are dot products with the matrix columns
+		const Matrix columns = MatrixTranspose(LoadFloat4x4(viewProjection));
+		const Vector& x = columns.r[0];
+		const Vector& y = columns.r[1];
+		const Vector& z = columns.r[2];
+		const Vector& w = columns.r[3];
+
+		StoreFloat4(planes[0], VectorAdd(w, x));
+		StoreFloat4(planes[1], VectorSubtract(w, x));
+		StoreFloat4(planes[2], VectorAdd(w, y));
+		StoreFloat4(planes[3], VectorSubtract(w, y));
+		StoreFloat4(planes[4], z);
+		StoreFloat4(planes[5], VectorSubtract(w, z));
+	}
+
+
+	const char* GetBackendName()
+	{
+#if defined(SIMD_MATH_SSE) && defined(SIMD_MATH_FMA)
+		return "SSE2 + FMA";
+#elif defined(SIMD_MATH_SSE)
+		return "SSE2";
+#elif defined(SIMD_MATH_NEON)
+		return "NEON";
+#else
+		return "scalar";
+#endif
+	}
+
+
+	namespace
+	{
+		constexpr uint32_t kRepeatsCount = 16;
+
+		double GetMilliseconds(std::chrono::high_resolution_clock::time_point start)
+		{
+			return std::chrono::duration<double, std::chrono::milliseconds::period>(
+				std::chrono::high_resolution_clock::now() - start).count();
+		}
+
+		double GetPerSecond(uint32_t count, std::chrono::high_resolution_clock::time_point start)
+		{
+			return static_cast<double>(count) * kRepeatsCount * 1000.0 / std::max(GetMilliseconds(start), 1e-3);
+		}
+
+		struct BenchmarkData
+		{
+			std::vector<Float4x4> models;
+			std::vector<Float3> points;
+			std::vector<Aabb> boxes;
+			Float4x4 viewProjection;
+			Float4 planes[6];
+
+			std::vector<Float3> transformed;
+			std::vector<Float4x4> products;
+			uint32_t visibleCount = 0;
+		};
+
+		BenchmarkReport::Result RunSimdMath(BenchmarkData& data, uint32_t count)
+		{
+			BenchmarkReport::Result result;
+			result.isMeasured = true;
+
+			auto startTime = std::chrono::high_resolution_clock::now();
+			for (uint32_t repeat = 0; repeat < kRepeatsCount; repeat++)
+			{
+				for (uint32_t i = 0; i < count; i++)
+				{
+					StoreFloat3(data.transformed[i],
+						Vector3TransformCoord(LoadFloat3(data.points[i]), LoadFloat4x4(data.models[i])));
+				}
+			}
+			result.transformsPerSecond = GetPerSecond(count, startTime);
+
+			startTime = std::chrono::high_resolution_clock::now();
+			const Matrix viewProjection = LoadFloat4x4(data.viewProjection);
+			for (uint32_t repeat = 0; repeat < kRepeatsCount; repeat++)
+			{
+				for (uint32_t i = 0; i < count; i++)
+					StoreFloat4x4(data.products[i], MatrixMultiply(LoadFloat4x4(data.models[i]), viewProjection));
+			}
+			result.matrixMultipliesPerSecond = GetPerSecond(count, startTime);
+
+			startTime = std::chrono::high_resolution_clock::now();
+			for (uint32_t repeat = 0; repeat < kRepeatsCount; repeat++)
+			{
+				data.visibleCount = 0;
+				for (uint32_t i = 0; i < count; i++)
+				{
+					Vector center;
+					Vector extents;
+					AabbTransform(data.boxes[i], LoadFloat4x4(data.models[i]), center, extents);
+					data.visibleCount += AabbIntersectsPlanes(center, extents, data.planes, 6) ? 1 : 0;
+				}
+			}
+			result.boxTestsPerSecond = GetPerSecond(count, startTime);
+			return result;
+		}
+
+#if defined(SIMD_MATH_HAS_DIRECTXMATH)
+		BenchmarkReport::Result RunDirectXMath(BenchmarkData& data, uint32_t count)
+		{
+			using namespace DirectX;
+
+			BenchmarkReport::Result result;
+			result.isMeasured = true;
+
+			auto startTime = std::chrono::high_resolution_clock::now();
+			for (uint32_t repeat = 0; repeat < kRepeatsCount; repeat++)
+			{
+				for (uint32_t i = 0; i < count; i++)
+				{
+					XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&data.transformed[i]),
+						XMVector3TransformCoord(XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&data.points[i])),
+							XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(&data.models[i]))));
+				}
+			}
+			result.transformsPerSecond = GetPerSecond(count, startTime);
+
+			startTime = std::chrono::high_resolution_clock::now();
+			const XMMATRIX viewProjection = XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(&data.viewProjection));
+			for (uint32_t repeat = 0; repeat < kRepeatsCount; repeat++)
+			{
+				for (uint32_t i = 0; i < count; i++)
+				{
+					XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(&data.products[i]), XMMatrixMultiply(
+						XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(&data.models[i])), viewProjection));
+				}
+			}
+			result.matrixMultipliesPerSecond = GetPerSecond(count, startTime);
+
+			startTime = std::chrono::high_resolution_clock::now();
+			for (uint32_t repeat = 0; repeat < kRepeatsCount; repeat++)
+			{
+				data.visibleCount = 0;
+				for (uint32_t i = 0; i < count; i++)
+				{
+					const XMMATRIX model = XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(&data.models[i]));
+					XMMATRIX absoluteModel;
+					for (uint32_t row = 0; row < 4; row++)
+						absoluteModel.r[row] = XMVectorAbs(model.r[row]);
+					const XMVECTOR minCorner = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&data.boxes[i].minCorner));
+					const XMVECTOR maxCorner = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&data.boxes[i].maxCorner));
+					const XMVECTOR center = XMVector3TransformCoord(XMVectorScale(XMVectorAdd(minCorner, maxCorner), 0.5f),
+						model);
+					const XMVECTOR extents = XMVector3TransformNormal(
+						XMVectorScale(XMVectorSubtract(maxCorner, minCorner), 0.5f), absoluteModel);
+
+					bool isVisible = true;
+					for (const Float4& plane : data.planes)
+					{
+						const XMVECTOR planeVector = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&plane));
+						const XMVECTOR distance = XMVectorAdd(XMPlaneDotCoord(planeVector, center),
+							XMVector3Dot(XMVectorAbs(planeVector), extents));
+						if (XMVectorGetX(distance) < 0.0f)
+						{
+							isVisible = false;
+							break;
+						}
+					}
+					data.visibleCount += isVisible ? 1 : 0;
+				}
+			}
+			result.boxTestsPerSecond = GetPerSecond(count, startTime);
+			return result;
+		}
+#endif
+	}
+
+
+	BenchmarkReport Benchmark(uint32_t count)
+	{
+		std::mt19937 generator(0);
+		std::uniform_real_distribution<float> positionDistribution(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> angleDistribution(0.0f, k2Pi);
+		std::uniform_real_distribution<float> scaleDistribution(0.5f, 2.0f);
+
+		BenchmarkData data;
+		data.models.resize(count);
+		data.points.resize(count);
+		data.boxes.resize(count);
+		data.transformed.resize(count);
+		data.products.resize(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const float scale = scaleDistribution(generator);
+			const Matrix model = MatrixMultiply(MatrixMultiply(MatrixScaling(scale, scale, scale),
+				MatrixRotationY(angleDistribution(generator))), MatrixTranslation(positionDistribution(generator),
+				positionDistribution(generator), positionDistribution(generator)));
+			StoreFloat4x4(data.models[i], model);
+			data.points[i] = Float3(positionDistribution(generator), positionDistribution(generator),
+				positionDistribution(generator));
+			data.boxes[i] = { Float3(-1.0f, -1.0f, -1.0f), Float3(1.0f, 1.0f, 1.0f) };
+		}
+
+		const Matrix view = MatrixLookAtRH(VectorSet(0.0f, 10.0f, 150.0f, 1.0f), VectorZero(),
+			VectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		const Matrix projection = MatrixPerspectiveFovRH(ConvertToRadians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+		StoreFloat4x4(data.viewProjection, MatrixMultiply(view, projection));
+		ExtractFrustumPlanes(data.viewProjection, data.planes);
+
+		BenchmarkReport report;
+		report.count = count;
+		report.simdMath = RunSimdMath(data, count);
+
+#if defined(SIMD_MATH_HAS_DIRECTXMATH)
+		report.directXMath = RunDirectXMath(data, count);
+#endif
+		return report;
+	}
+}
@@ -0,0 +1,822 @@
+#pragma once
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+
+// Thin vector math layer of the CPU side, in place of DirectXMath so that the scene, camera, culling and constant
+// code builds on any platform. Names, conventions and storage layouts follow DirectXMath: row vectors,
+// v * M transforms, right handed view matrices with depth in [0, 1].
+// Float* types are storage, Vector and Matrix are registers. The backend is SSE2 on x86 (FMA when the compiler
+// targets it), NEON on ARM and scalar elsewhere or with SIMD_MATH_NO_INTRINSICS defined.
+#if !defined(SIMD_MATH_NO_INTRINSICS) && (defined(_M_X64) || defined(__SSE2__) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SIMD_MATH_SSE 1
+#include <immintrin.h>
+// MSVC does not define __FMA__, /arch:AVX2 implies it
+#if defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define SIMD_MATH_FMA 1
+#endif
+#elif !defined(SIMD_MATH_NO_INTRINSICS) && (defined(__ARM_NEON) || defined(_M_ARM64) || defined(_M_ARM))
+#define SIMD_MATH_NEON 1
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_M_ARM64)
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif
+#else
+#define SIMD_MATH_SCALAR 1
+#endif
+
+
+namespace SimdMath
+{
+	static constexpr float kPi = 3.141592654f;
+	static constexpr float k2Pi = 6.283185307f;
+	static constexpr float kPiDiv2 = 1.570796327f;
+	static constexpr float kPiDiv4 = 0.785398163f;
+
+	constexpr float ConvertToRadians(float degrees) { return degrees * (kPi / 180.0f); }
+	constexpr float ConvertToDegrees(float radians) { return radians * (180.0f / kPi); }
+
+	struct Float2
+	{
+		float x;
+		float y;
+
+		Float2() = default;
+		constexpr Float2(float _x, float _y) : x(_x), y(_y) {}
+		explicit Float2(const float* values) : x(values[0]), y(values[1]) {}
+	};
+
+	struct Float3
+	{
+		float x;
+		float y;
+		float z;
+
+		Float3() = default;
+		constexpr Float3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+		explicit Float3(const float* values) : x(values[0]), y(values[1]), z(values[2]) {}
+	};
+
+	struct Float4
+	{
+		float x;
+		float y;
+		float z;
+		float w;
+
+		Float4() = default;
+		constexpr Float4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+		explicit Float4(const float* values) : x(values[0]), y(values[1]), z(values[2]), w(values[3]) {}
+	};
+
+	struct alignas(16) Float4A : public Float4
+	{
+		using Float4::Float4;
+	};
+
+	struct Float4x4
+	{
+		union
+		{
+			struct
+			{
+				float _11, _12, _13, _14;
+				float _21, _22, _23, _24;
+				float _31, _32, _33, _34;
+				float _41, _42, _43, _44;
+			};
+			float m[4][4];
+		};
+
+		Float4x4() = default;
+		constexpr Float4x4(float m00, float m01, float m02, float m03, float m10, float m11, float m12, float m13,
+			float m20, float m21, float m22, float m23, float m30, float m31, float m32, float m33)
+			: _11(m00), _12(m01), _13(m02), _14(m03), _21(m10), _22(m11), _23(m12), _24(m13),
+			_31(m20), _32(m21), _33(m22), _34(m23), _41(m30), _42(m31), _43(m32), _44(m33) {}
+		explicit Float4x4(const float* values) { memcpy(m, values, sizeof(m)); }
+
+		float operator()(uint32_t row, uint32_t column) const { return m[row][column]; }
+		float& operator()(uint32_t row, uint32_t column) { return m[row][column]; }
+	};
+
+	static_assert(sizeof(Float3) == 12 && sizeof(Float4) == 16 && sizeof(Float4A) == 16 && sizeof(Float4x4) == 64);
+
+#if defined(SIMD_MATH_SSE)
+	using NativeVector = __m128;
+#elif defined(SIMD_MATH_NEON)
+	using NativeVector = float32x4_t;
+#else
+	union NativeVector
+	{
+		float f[4];
+		uint32_t u[4];
+	};
+#endif
+
+	struct Vector
+	{
+		NativeVector v;
+	};
+
+	struct Matrix
+	{
+		Vector r[4];
+	};
+
+	// Box storage, the same corners as the shaders
+	struct Aabb
+	{
+		Float3 minCorner;
+		Float3 maxCorner;
+	};
+
+
+	// Loads and stores. Float3 loads w as 0.
+
+	inline Vector LoadFloat4(const Float4& source)
+	{
+#if defined(SIMD_MATH_SSE)
+		return { _mm_loadu_ps(&source.x) };
+#elif defined(SIMD_MATH_NEON)
+		return { vld1q_f32(&source.x) };
+#else
+		return { { { source.x, source.y, source.z, source.w } } };
+#endif
+	}
+
+	inline Vector LoadFloat4A(const Float4A& source)
+	{
+#if defined(SIMD_MATH_SSE)
+		return { _mm_load_ps(&source.x) };
+#else
+		return LoadFloat4(source);
+#endif
+	}
+
+	inline Vector LoadFloat3(const Float3& source)
+	{
+#if defined(SIMD_MATH_SSE)
+		// __m128i may alias the floats, double does not for GCC and Clang
+		const __m128 xy = _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&source.x)));
+		return { _mm_movelh_ps(xy, _mm_load_ss(&source.z)) };
+#elif defined(SIMD_MATH_NEON)
+		return { vcombine_f32(vld1_f32(&source.x), vld1_lane_f32(&source.z, vdup_n_f32(0.0f), 0)) };
+#else
+		return { { { source.x, source.y, source.z, 0.0f } } };
+#endif
+	}
+
+	inline void StoreFloat4(Float4& destination, Vector value)
+	{
+#if defined(SIMD_MATH_SSE)
+		_mm_storeu_ps(&destination.x, value.v);
+#elif defined(SIMD_MATH_NEON)
+		vst1q_f32(&destination.x, value.v);
+#else
+		memcpy(&destination.x, value.v.f, sizeof(Float4));
+#endif
+	}
+
+	inline void StoreFloat4A(Float4A& destination, Vector value)
+	{
+#if defined(SIMD_MATH_SSE)
+		_mm_store_ps(&destination.x, value.v);
+#else
+		StoreFloat4(destination, value);
+#endif
+	}
+
+	inline void StoreFloat3(Float3& destination, Vector value)
+	{
+#if defined(SIMD_MATH_SSE)
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(&destination.x), _mm_castps_si128(value.v));
+		_mm_store_ss(&destination.z, _mm_movehl_ps(value.v, value.v));
+#elif defined(SIMD_MATH_NEON)
+		vst1_f32(&destination.x, vget_low_f32(value.v));
+		vst1q_lane_f32(&destination.z, value.v, 2);
+#else
+		memcpy(&destination.x, value.v.f, sizeof(Float3));
+#endif
+	}
+
+	// Raw lane bits, the comparison masks are all ones or all zeros
+	inline void StoreInt4(uint32_t* destination, Vector value)
+	{
+#if defined(SIMD_MATH_SSE)
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(destination), _mm_castps_si128(value.v));
+#elif defined(SIMD_MATH_NEON)
+		vst1q_u32(destination, vreinterpretq_u32_f32(value.v));
+#else
+		memcpy(destination, value.v.u, sizeof(value.v.u));
+#endif
+	}
+
+	inline Matrix LoadFloat4x4(const Float4x4& source)
+	{
+		Matrix result;
+		for (uint32_t i = 0; i < 4; i++)
+			result.r[i] = LoadFloat4(*reinterpret_cast<const Float4*>(source.m[i]));
+		return result;
+	}
+
+	inline void StoreFloat4x4(Float4x4& destination, const Matrix& value)
+	{
+		for (uint32_t i = 0; i < 4; i++)
+			StoreFloat4(*reinterpret_cast<Float4*>(destination.m[i]), value.r[i]);
+	}
+
+
+	// Vector construction and lane access
+
+	inline Vector VectorSet(float x, float y, float z, float w)
+	{
+#if defined(SIMD_MATH_SSE)
+		return { _mm_set_ps(w, z, y, x) };
+#elif defined(SIMD_MATH_NEON)
+		const float values[4] = { x, y, z, w };
+		return { vld1q_f32(values) };
+#else
+		return { { { x, y, z, w } } };
+#endif
+	}
+
+	inline Vector VectorZero()
+	{
+#if defined(SIMD_MATH_SSE)
+		return { _mm_setzero_ps() };
+#elif defined(SIMD_MATH_NEON)
+		return { vdupq_n_f32(0.0f) };
+#else
+		return { { { 0.0f, 0.0f, 0.0f, 0.0f } } };
+#endif
+	}
+
+	inline Vector VectorReplicate(float value)
+	{
+#if defined(SIMD_MATH_SSE)
+		return { _mm_set1_ps(value) };
+#elif defined(SIMD_MATH_NEON)
+		return { vdupq_n_f32(value) };
+#else
+		return { { { value, value, value, value } } };
+#endif
+	}
+
+	inline Vector VectorTrueInt()
+	{
+#if defined(SIMD_MATH_SSE)
+		return { _mm_castsi128_ps(_mm_set1_epi32(-1)) };
+#elif defined(SIMD_MATH_NEON)
+		return { vreinterpretq_f32_u32(vdupq_n_u32(0xFFFFFFFFu)) };
+#else
+		NativeVector result;
+		result.u[0] = result.u[1] = result.u[2] = result.u[3] = 0xFFFFFFFFu;
+		return { result };
+#endif
+	}
+
+	// Mask of all ones in the lanes with non zero arguments, for VectorSelect and the bitwise operations
+	inline Vector VectorSelectControl(uint32_t x, uint32_t y, uint32_t z, uint32_t w)
+	{
+		const uint32_t lanes[4] = { x ? 0xFFFFFFFFu : 0u, y ? 0xFFFFFFFFu : 0u, z ? 0xFFFFFFFFu : 0u,
+			w ? 0xFFFFFFFFu : 0u };
+#if defined(SIMD_MATH_SSE)
+		return { _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes))) };
+#elif defined(SIMD_MATH_NEON)
+		return { vreinterpretq_f32_u32(vld1q_u32(lanes)) };
+#else
+		NativeVector result;
+		memcpy(result.u, lanes, sizeof(lanes));
+		return { result };
+#endif
+	}
+
+	inline Vector VectorFalseInt()
+	{
+		return VectorZero();
+	}
+
+	// Lane i of the result is lane I of value, template arguments are lane indices
+	template <uint32_t X, uint32_t Y, uint32_t Z, uint32_t W>
+	inline Vector VectorSwizzle(Vector value)
+	{
+		static_assert(X < 4 && Y < 4 && Z < 4 && W < 4);
+#if defined(SIMD_MATH_SSE)
+		return { _mm_shuffle_ps(value.v, value.v, _MM_SHUFFLE(W, Z, Y, X)) };
+#elif defined(SIMD_MATH_NEON)
+		float lanes[4];
+		vst1q_f32(lanes, value.v);
+		const float values[4] = { lanes[X], lanes[Y], lanes[Z], lanes[W] };
+		return { vld1q_f32(values) };
+#else
+		return { { { value.v.f[X], value.v.f[Y], value.v.f[Z], value.v.f[W] } } };
+#endif
+	}
+
+	template <uint32_t Lane>
+	inline Vector VectorSplat(Vector value)
+	{
+#if defined(SIMD_MATH_NEON)
+		return { vdupq_n_f32(vgetq_lane_f32(value.v, Lane)) };
+#else
+		return VectorSwizzle<Lane, Lane, Lane, Lane>(value);
+#endif
+	}
+
+	template <uint32_t Lane>
+	inline float VectorGet(Vector value)
+	{
+#if defined(SIMD_MATH_SSE)
+		return _mm_cvtss_f32(VectorSplat<Lane>(value).v);
+#elif defined(SIMD_MATH_NEON)
+		return vgetq_lane_f32(value.v, Lane);
+#else
+		return value.v.f[Lane];
+#endif
+	}
+
+	inline float VectorGetX(Vector value) { return VectorGet<0>(value); }
+	inline float VectorGetY(Vector value) { return VectorGet<1>(value); }
+	inline float VectorGetZ(Vector value) { return VectorGet<2>(value); }
+	inline float VectorGetW(Vector value) { return VectorGet<3>(value); }
+
+	inline float VectorGetByIndex(Vector value, uint32_t index)
+	{
+		Float4 lanes;
+		StoreFloat4(lanes, value);
+		return (&lanes.x)[index];
+	}
+
+
+	// Per lane arithmetic
+
+	inline Vector VectorAdd(Vector a, Vector b)
+	{
+#if defined(SIMD_MATH_SSE)
+		return { _mm_add_ps(a.v, b.v) };
+#elif defined(SIMD_MATH_NEON)
+		return { vaddq_f32(a.v, b.v) };
+#else
+		return { { { a.v.f[0] + b.v.f[0], a.v.f[1] + b.v.f[1], a.v.f[2] + b.v.f[2], a.v.f[3] + b.v.f[3] } } };
+#endif
+	}
+
+	inline Vector VectorSubtract(Vector a, Vector b)
+	{
+#if defined(SIMD_MATH_SSE)
+		return { _mm_sub_ps(a.v, b.v) };
+#elif defined(SIMD_MATH_NEON)
+		return { vsubq_f32(a.v, b.v) };
+#else
+		return { { { a.v.f[0] - b.v.f[0], a.v.f[1] - b.v.f[1], a.v.f[2] - b.v.f[2], a.v.f[3] - b.v.f[3] } } };
+#endif
+	}
+
+	inline Vector VectorMultiply(Vector a, Vector b)
+	{
+#if defined(SIMD_MATH_SSE)
+		return { _mm_mul_ps(a.v, b.v) };
+#elif defined(SIMD_MATH_NEON)
+		return { vmulq_f32(a.v, b.v) };
+#else
+		return { { { a.v.f[0] * b.v.f[0], a.v.f[1] * b.v.f[1], a.v.f[2] * b.v.f[2], a.v.f[3] * b.v.f[3] } } };
+#endif
+	}
+
+	inline Vector VectorDivide(Vector a, Vector b)
+	{
+#if defined(SIMD_MATH_SSE)
+		return { _mm_div_ps(a.v, b.v) };
+#elif defined(SIMD_MATH_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+		return { vdivq_f32(a.v, b.v) };
+#else
+		Float4 lanesA;
+		Float4 lanesB;
+		StoreFloat4(lanesA, a);
+		StoreFloat4(lanesB, b);
+		return VectorSet(lanesA.x / lanesB.x, lanesA.y / lanesB.y, lanesA.z / lanesB.z, lanesA.w / lanesB.w);
+#endif
+	}
+
+	// a * b + c, fused where the target has FMA
+	inline Vector VectorMultiplyAdd(Vector a, Vector b, Vector c)
+	{
+#if defined(SIMD_MATH_FMA)
+		return { _mm_fmadd_ps(a.v, b.v, c.v) };
+#elif defined(SIMD_MATH_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+		return { vfmaq_f32(c.v, a.v, b.v) };
+#else
+		return VectorAdd(VectorMultiply(a, b), c);
+#endif
+	}
+
+	inline Vector VectorScale(Vector value, float scale)
+	{
+		return VectorMultiply(value, VectorReplicate(scale));
+	}
+
+	inline Vector VectorNegate(Vector value)
+	{
+		return VectorSubtract(VectorZero(), value);
+	}
+
+	inline Vector VectorMin(Vector a, Vector b)
+	{
+#if defined(SIMD_MATH_SSE)
+		return { _mm_min_ps(a.v, b.v) };
+#elif defined(SIMD_MATH_NEON)
+		return { vminq_f32(a.v, b.v) };
+#else
+		NativeVector result;
+		for (uint32_t i = 0; i < 4; i++)
+			result.f[i] = a.v.f[i] < b.v.f[i] ? a.v.f[i] : b.v.f[i];
+		return { result };
+#endif
+	}
+
+	inline Vector VectorMax(Vector a, Vector b)
+	{
+#if defined(SIMD_MATH_SSE)
+		return { _mm_max_ps(a.v, b.v) };
+#elif defined(SIMD_MATH_NEON)
+		return { vmaxq_f32(a.v, b.v) };
+#else
+		NativeVector result;
+		for (uint32_t i = 0; i < 4; i++)
+			result.f[i] = a.v.f[i] > b.v.f[i] ? a.v.f[i] : b.v.f[i];
+		return { result };
+#endif
+	}
+
+	inline Vector VectorSqrt(Vector value)
+	{
+#if defined(SIMD_MATH_SSE)
+		return { _mm_sqrt_ps(value.v) };
+#elif defined(SIMD_MATH_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+		return { vsqrtq_f32(value.v) };
+#else
+		Float4 lanes;
+		StoreFloat4(lanes, value);
+		return VectorSet(sqrtf(lanes.x), sqrtf(lanes.y), sqrtf(lanes.z), sqrtf(lanes.w));
+#endif
+	}
+
+	inline Vector VectorAbs(Vector value)
+	{
+		return VectorMax(value, VectorNegate(value));
+	}
+
+
+	// Comparisons return lane masks for the bitwise operations and VectorSelect
+
+#if defined(SIMD_MATH_SSE)
+#define SIMD_MATH_COMPARE(name, sseOperation, neonOperation, operator_) \
+	inline Vector name(Vector a, Vector b) { return { sseOperation(a.v, b.v) }; }
+#elif defined(SIMD_MATH_NEON)
+#define SIMD_MATH_COMPARE(name, sseOperation, neonOperation, operator_) \
+	inline Vector name(Vector a, Vector b) { return { vreinterpretq_f32_u32(neonOperation(a.v, b.v)) }; }
+#else
+#define SIMD_MATH_COMPARE(name, sseOperation, neonOperation, operator_) \
+	inline Vector name(Vector a, Vector b) \
+	{ \
+		NativeVector result; \
+		for (uint32_t i = 0; i < 4; i++) \
+			result.u[i] = a.v.f[i] operator_ b.v.f[i] ? 0xFFFFFFFFu : 0u; \
+		return { result }; \
+	}
+#endif
+
+	SIMD_MATH_COMPARE(VectorEqual, _mm_cmpeq_ps, vceqq_f32, ==)
+	SIMD_MATH_COMPARE(VectorGreater, _mm_cmpgt_ps, vcgtq_f32, >)
+	SIMD_MATH_COMPARE(VectorGreaterOrEqual, _mm_cmpge_ps, vcgeq_f32, >=)
+	SIMD_MATH_COMPARE(VectorLess, _mm_cmplt_ps, vcltq_f32, <)
+	SIMD_MATH_COMPARE(VectorLessOrEqual, _mm_cmple_ps, vcleq_f32, <=)
+
+#undef SIMD_MATH_COMPARE
+
+	inline Vector VectorAndInt(Vector a, Vector b)
+	{
+#if defined(SIMD_MATH_SSE)
+		return { _mm_and_ps(a.v, b.v) };
+#elif defined(SIMD_MATH_NEON)
+		return { vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a.v), vreinterpretq_u32_f32(b.v))) };
+#else
+		NativeVector result;
+		for (uint32_t i = 0; i < 4; i++)
+			result.u[i] = a.v.u[i] & b.v.u[i];
+		return { result };
+#endif
+	}
+
+	inline Vector VectorOrInt(Vector a, Vector b)
+	{
+#if defined(SIMD_MATH_SSE)
+		return { _mm_or_ps(a.v, b.v) };
+#elif defined(SIMD_MATH_NEON)
+		return { vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a.v), vreinterpretq_u32_f32(b.v))) };
+#else
+		NativeVector result;
+		for (uint32_t i = 0; i < 4; i++)
+			result.u[i] = a.v.u[i] | b.v.u[i];
+		return { result };
+#endif
+	}
+
+	// Lanes of b where the control bits are set, of a elsewhere
+	inline Vector VectorSelect(Vector a, Vector b, Vector control)
+	{
+#if defined(SIMD_MATH_SSE)
+		return { _mm_or_ps(_mm_andnot_ps(control.v, a.v), _mm_and_ps(control.v, b.v)) };
+#elif defined(SIMD_MATH_NEON)
+		return { vbslq_f32(vreinterpretq_u32_f32(control.v), b.v, a.v) };
+#else
+		NativeVector result;
+		for (uint32_t i = 0; i < 4; i++)
+			result.u[i] = (a.v.u[i] & ~control.v.u[i]) | (b.v.u[i] & control.v.u[i]);
+		return { result };
+#endif
+	}
+
+	// Bit i is the top bit of lane i, the lanes of a comparison result
+	inline uint32_t VectorMoveMask(Vector control)
+	{
+#if defined(SIMD_MATH_SSE)
+		return static_cast<uint32_t>(_mm_movemask_ps(control.v));
+#elif defined(SIMD_MATH_NEON)
+		const uint32x4_t bits = vshrq_n_u32(vreinterpretq_u32_f32(control.v), 31);
+		return vgetq_lane_u32(bits, 0) | (vgetq_lane_u32(bits, 1) << 1) | (vgetq_lane_u32(bits, 2) << 2)
+			| (vgetq_lane_u32(bits, 3) << 3);
+#else
+		uint32_t result = 0;
+		for (uint32_t i = 0; i < 4; i++)
+			result |= (control.v.u[i] >> 31) << i;
+		return result;
+#endif
+	}
+
+
+	// 3D vectors, the w lane is ignored by the dot products
+
+	// Replicated to every lane
+	inline Vector Vector3Dot(Vector a, Vector b)
+	{
+		const Vector product = VectorMultiply(a, b);
+#if defined(SIMD_MATH_SSE)
+		__m128 sum = _mm_add_ss(product.v, VectorSplat<1>(product).v);
+		sum = _mm_add_ss(sum, VectorSplat<2>(product).v);
+		return VectorSplat<0>({ sum });
+#else
+		return VectorReplicate(VectorGetX(product) + VectorGetY(product) + VectorGetZ(product));
+#endif
+	}
+
+	inline Vector Vector3Cross(Vector a, Vector b)
+	{
+		const Vector result = VectorSubtract(
+			VectorMultiply(VectorSwizzle<1, 2, 0, 3>(a), VectorSwizzle<2, 0, 1, 3>(b)),
+			VectorMultiply(VectorSwizzle<2, 0, 1, 3>(a), VectorSwizzle<1, 2, 0, 3>(b)));
+		// w is 0 even for infinite inputs
+		return VectorAndInt(result, VectorSelectControl(1, 1, 1, 0));
+	}
+
+	inline Vector Vector3Length(Vector value)
+	{
+		return VectorSqrt(Vector3Dot(value, value));
+	}
+
+	// Divides all four lanes by the length of xyz, zero length gives zero
+	inline Vector Vector3Normalize(Vector value)
+	{
+		const Vector length = Vector3Length(value);
+		return VectorSelect(VectorDivide(value, length), VectorZero(), VectorEqual(length, VectorZero()));
+	}
+
+	// (x, y, z, 1) * matrix divided by its w
+	inline Vector Vector3TransformCoord(Vector value, const Matrix& matrix)
+	{
+		Vector result = VectorMultiplyAdd(VectorSplat<2>(value), matrix.r[2], matrix.r[3]);
+		result = VectorMultiplyAdd(VectorSplat<1>(value), matrix.r[1], result);
+		result = VectorMultiplyAdd(VectorSplat<0>(value), matrix.r[0], result);
+		return VectorDivide(result, VectorSplat<3>(result));
+	}
+
+	// (x, y, z, 0) * matrix
+	inline Vector Vector3TransformNormal(Vector value, const Matrix& matrix)
+	{
+		Vector result = VectorMultiply(VectorSplat<2>(value), matrix.r[2]);
+		result = VectorMultiplyAdd(VectorSplat<1>(value), matrix.r[1], result);
+		return VectorMultiplyAdd(VectorSplat<0>(value), matrix.r[0], result);
+	}
+
+	inline Vector Vector4Transform(Vector value, const Matrix& matrix)
+	{
+		Vector result = VectorMultiply(VectorSplat<0>(value), matrix.r[0]);
+		result = VectorMultiplyAdd(VectorSplat<1>(value), matrix.r[1], result);
+		result = VectorMultiplyAdd(VectorSplat<2>(value), matrix.r[2], result);
+		return VectorMultiplyAdd(VectorSplat<3>(value), matrix.r[3], result);
+	}
+
+
+	// Matrices
+
+	inline Matrix MatrixIdentity()
+	{
+		return { { VectorSet(1.0f, 0.0f, 0.0f, 0.0f), VectorSet(0.0f, 1.0f, 0.0f, 0.0f),
+			VectorSet(0.0f, 0.0f, 1.0f, 0.0f), VectorSet(0.0f, 0.0f, 0.0f, 1.0f) } };
+	}
+
+	// a then b
+	inline Matrix MatrixMultiply(const Matrix& a, const Matrix& b)
+	{
+		return { { Vector4Transform(a.r[0], b), Vector4Transform(a.r[1], b), Vector4Transform(a.r[2], b),
+			Vector4Transform(a.r[3], b) } };
+	}
+
+	inline Matrix MatrixTranspose(const Matrix& matrix)
+	{
+#if defined(SIMD_MATH_SSE)
+		const __m128 xy01 = _mm_shuffle_ps(matrix.r[0].v, matrix.r[1].v, _MM_SHUFFLE(1, 0, 1, 0));
+		const __m128 zw01 = _mm_shuffle_ps(matrix.r[0].v, matrix.r[1].v, _MM_SHUFFLE(3, 2, 3, 2));
+		const __m128 xy23 = _mm_shuffle_ps(matrix.r[2].v, matrix.r[3].v, _MM_SHUFFLE(1, 0, 1, 0));
+		const __m128 zw23 = _mm_shuffle_ps(matrix.r[2].v, matrix.r[3].v, _MM_SHUFFLE(3, 2, 3, 2));
+		return { { { _mm_shuffle_ps(xy01, xy23, _MM_SHUFFLE(2, 0, 2, 0)) },
+			{ _mm_shuffle_ps(xy01, xy23, _MM_SHUFFLE(3, 1, 3, 1)) },
+			{ _mm_shuffle_ps(zw01, zw23, _MM_SHUFFLE(2, 0, 2, 0)) },
+			{ _mm_shuffle_ps(zw01, zw23, _MM_SHUFFLE(3, 1, 3, 1)) } } };
+#elif defined(SIMD_MATH_NEON)
+		const float32x4x2_t rows02 = vzipq_f32(matrix.r[0].v, matrix.r[2].v);
+		const float32x4x2_t rows13 = vzipq_f32(matrix.r[1].v, matrix.r[3].v);
+		const float32x4x2_t xy = vzipq_f32(rows02.val[0], rows13.val[0]);
+		const float32x4x2_t zw = vzipq_f32(rows02.val[1], rows13.val[1]);
+		return { { { xy.val[0] }, { xy.val[1] }, { zw.val[0] }, { zw.val[1] } } };
+#else
+		Matrix result;
+		for (uint32_t row = 0; row < 4; row++)
+		{
+			for (uint32_t column = 0; column < 4; column++)
+				result.r[row].v.f[column] = matrix.r[column].v.f[row];
+		}
+		return result;
+#endif
+	}
+
+	inline Matrix MatrixTranslation(float x, float y, float z)
+	{
+		Matrix result = MatrixIdentity();
+		result.r[3] = VectorSet(x, y, z, 1.0f);
+		return result;
+	}
+
+	inline Matrix MatrixScaling(float x, float y, float z)
+	{
+		return { { VectorSet(x, 0.0f, 0.0f, 0.0f), VectorSet(0.0f, y, 0.0f, 0.0f), VectorSet(0.0f, 0.0f, z, 0.0f),
+			VectorSet(0.0f, 0.0f, 0.0f, 1.0f) } };
+	}
+
+	inline Matrix MatrixRotationY(float angle)
+	{
+		const float sine = sinf(angle);
+		const float cosine = cosf(angle);
+		return { { VectorSet(cosine, 0.0f, -sine, 0.0f), VectorSet(0.0f, 1.0f, 0.0f, 0.0f),
+			VectorSet(sine, 0.0f, cosine, 0.0f), VectorSet(0.0f, 0.0f, 0.0f, 1.0f) } };
+	}
+
+	// Absolute values of every element, the extents of transformed boxes go through it
+	inline Matrix MatrixAbs(const Matrix& matrix)
+	{
+		return { { VectorAbs(matrix.r[0]), VectorAbs(matrix.r[1]), VectorAbs(matrix.r[2]), VectorAbs(matrix.r[3]) } };
+	}
+
+	// Cofactor expansion, a singular matrix gives non finite elements
+	Matrix MatrixInverse(const Matrix& matrix);
+	Matrix MatrixLookAtRH(Vector eyePosition, Vector focusPosition, Vector upDirection);
+	Matrix MatrixPerspectiveFovRH(float fovAngleY, float aspectRatio, float nearZ, float farZ);
+
+
+	// Planes are (normal, distance), points p with dot(normal, p) + distance >= 0 are in front
+
+	inline Vector PlaneDotCoord(Vector plane, Vector point)
+	{
+		return VectorAdd(Vector3Dot(plane, point), VectorSplat<3>(plane));
+	}
+
+	inline Vector PlaneNormalize(Vector plane)
+	{
+		return VectorDivide(plane, Vector3Length(plane));
+	}
+
+	// Left, right, bottom, top, near, far planes of the clip volume of viewProjection, not normalized
+	void ExtractFrustumPlanes(const Float4x4& viewProjection, Float4 planes[6]);
+
+
+	// Boxes
+
+	inline Aabb AabbEmpty()
+	{
+		return { Float3(FLT_MAX, FLT_MAX, FLT_MAX),
+			Float3(-FLT_MAX, -FLT_MAX, -FLT_MAX) };
+	}
+
+	inline Aabb AabbAddPoint(const Aabb& box, Vector point)
+	{
+		Aabb result;
+		StoreFloat3(result.minCorner, VectorMin(LoadFloat3(box.minCorner), point));
+		StoreFloat3(result.maxCorner, VectorMax(LoadFloat3(box.maxCorner), point));
+		return result;
+	}
+
+	inline Aabb AabbMerge(const Aabb& a, const Aabb& b)
+	{
+		Aabb result;
+		StoreFloat3(result.minCorner, VectorMin(LoadFloat3(a.minCorner), LoadFloat3(b.minCorner)));
+		StoreFloat3(result.maxCorner, VectorMax(LoadFloat3(a.maxCorner), LoadFloat3(b.maxCorner)));
+		return result;
+	}
+
+	// Touching boxes overlap
+	inline bool AabbIntersectsAabb(const Aabb& a, const Aabb& b)
+	{
+		const Vector overlaps = VectorAndInt(VectorLessOrEqual(LoadFloat3(a.minCorner), LoadFloat3(b.maxCorner)),
+			VectorLessOrEqual(LoadFloat3(b.minCorner), LoadFloat3(a.maxCorner)));
+		return (VectorMoveMask(overlaps) & 0x7) == 0x7;
+	}
+
+	// Center and half extents of the box around the transformed box: the extents go through the absolute
+	// values of the linear part
+	inline void AabbTransform(const Aabb& box, const Matrix& matrix, Vector& center, Vector& extents)
+	{
+		const Vector minCorner = LoadFloat3(box.minCorner);
+		const Vector maxCorner = LoadFloat3(box.maxCorner);
+		const Vector half = VectorReplicate(0.5f);
+		center = Vector3TransformCoord(VectorMultiply(VectorAdd(minCorner, maxCorner), half), matrix);
+		extents = Vector3TransformNormal(VectorMultiply(VectorSubtract(maxCorner, minCorner), half), MatrixAbs(matrix));
+	}
+
+	inline Aabb AabbTransform(const Aabb& box, const Matrix& matrix)
+	{
+		Vector center;
+		Vector extents;
+		AabbTransform(box, matrix, center, extents);
+		Aabb result;
+		StoreFloat3(result.minCorner, VectorSubtract(center, extents));
+		StoreFloat3(result.maxCorner, VectorAdd(center, extents));
+		return result;
+	}
+
+	// False when the box is fully behind one of the planes
+	inline bool AabbIntersectsPlanes(Vector center, Vector extents, const Float4* planes, uint32_t planesCount)
+	{
+		for (uint32_t i = 0; i < planesCount; i++)
+		{
+			const Vector plane = LoadFloat4(planes[i]);
+			const Vector distance = PlaneDotCoord(plane, center);
+			const Vector radius = Vector3Dot(VectorAbs(plane), extents);
+			if (VectorGetX(VectorAdd(distance, radius)) < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+
+	// Operators of DirectXMath, per lane
+
+	inline Vector operator+(Vector a, Vector b) { return VectorAdd(a, b); }
+	inline Vector operator-(Vector a, Vector b) { return VectorSubtract(a, b); }
+	inline Vector operator*(Vector a, Vector b) { return VectorMultiply(a, b); }
+	inline Vector operator/(Vector a, Vector b) { return VectorDivide(a, b); }
+	inline Vector operator*(Vector a, float b) { return VectorScale(a, b); }
+	inline Vector operator*(float a, Vector b) { return VectorScale(b, a); }
+	inline Vector operator-(Vector a) { return VectorNegate(a); }
+	inline Vector& operator+=(Vector& a, Vector b) { return a = VectorAdd(a, b); }
+	inline Vector& operator-=(Vector& a, Vector b) { return a = VectorSubtract(a, b); }
+	inline Vector& operator*=(Vector& a, float b) { return a = VectorScale(a, b); }
+	inline Matrix operator*(const Matrix& a, const Matrix& b) { return MatrixMultiply(a, b); }
+
+
+	const char* GetBackendName();
+
+	struct BenchmarkReport
+	{
+		struct Result
+		{
+			bool isMeasured = false;
+			double transformsPerSecond = 0.0;
+			double matrixMultipliesPerSecond = 0.0;
+			double boxTestsPerSecond = 0.0;
+		};
+
+		uint32_t count = 0;
+		Result simdMath;
+		// Where DirectXMath.h is available
+		Result directXMath;
+	};
+
+	// Point transforms, matrix products and frustum box tests over count random inputs on the calling thread.
+	// Timing only, SimdMathTests.cpp checks the results.
+	BenchmarkReport Benchmark(uint32_t count);
+} // namespace SimdMath
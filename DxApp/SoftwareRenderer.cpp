@@ -0,0 +1,607 @@
+#include "SoftwareRenderer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+#include "Brdf.h"
+#include "GBufferEncoding.h"
+#include "LightSources.h"
+
+
+using namespace SimdMath;
+
+
+namespace
+{
+	constexpr float kInvGamma = 1.0f / 2.2f;
+	// Vertices transformed per task
+	constexpr uint32_t kTransformBlockSize = 4096;
+
+	double GetMilliseconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::chrono::milliseconds::period>(
+			std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	Float3 Add(const Float3& a, const Float3& b)
+	{
+		return Float3(a.x + b.x, a.y + b.y, a.z + b.z);
+	}
+
+	Float3 Subtract(const Float3& a, const Float3& b)
+	{
+		return Float3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	Float3 Scale(const Float3& a, float scale)
+	{
+		return Float3(a.x * scale, a.y * scale, a.z * scale);
+	}
+
+	float Dot(const Float3& a, const Float3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	Float3 Normalize(const Float3& vector)
+	{
+		return Scale(vector, 1.0f / std::sqrt(Dot(vector, vector)));
+	}
+
+	Float3 Lerp(const Float3& a, const Float3& b, float t)
+	{
+		return Add(a, Scale(Subtract(b, a), t));
+	}
+
+	Float3 ToFloat3(const Float4& vector)
+	{
+		return Float3(vector.x, vector.y, vector.z);
+	}
+
+	// Value read back from a UNORM8 target
+	float QuantizeUnorm8(float value)
+	{
+		return std::round(std::clamp(value, 0.0f, 1.0f) * 255.0f) / 255.0f;
+	}
+
+	uint32_t FloatToUnorm8(float value)
+	{
+		// NaN is converted to 0
+		return value > 0.0f ? static_cast<uint32_t>(std::lround(std::min(value, 1.0f) * 255.0f)) : 0;
+	}
+
+	float GetDistanceAttenuation(const Float3& pointOffset)
+	{
+		return 1.0f / std::max(1.0f, Dot(pointOffset, pointOffset));
+	}
+}
+
+
+SoftwareRenderer::SoftwareRenderer(uint32_t width, uint32_t height, uint32_t threadsCount)
+	: m_width(width), m_height(height),
+	m_threadsCount(threadsCount > 0 ? threadsCount : std::max(1u, std::thread::hardware_concurrency())),
+	m_tilesX((width + kTileSize - 1) / kTileSize), m_tilesY((height + kTileSize - 1) / kTileSize)
+{
+	m_bins.resize(m_threadsCount);
+	for (auto& bins : m_bins)
+		bins.tiles.resize(m_tilesX * m_tilesY);
+	m_tileGBuffers.resize(m_threadsCount);
+	m_tileSurfaces.resize(m_threadsCount);
+	m_image.resize(m_width * m_height);
+	m_depth.resize(m_width * m_height);
+}
+
+
+void SoftwareRenderer::Render(const std::vector<StaticBatching::Source>& objects, const LightSources& lightSources,
+	const View& view)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+	TransformVertices(objects, view.viewProjection);
+	m_timings.transformMilliseconds = GetMilliseconds(startTime);
+
+	startTime = std::chrono::high_resolution_clock::now();
+	BinTriangles(objects);
+	m_timings.binningMilliseconds = GetMilliseconds(startTime);
+
+	startTime = std::chrono::high_resolution_clock::now();
+	ParallelFor(m_tilesX * m_tilesY, [&](uint32_t tileIndex, uint32_t threadIndex) {
+		RasterizeTile(tileIndex, m_tileGBuffers[threadIndex]);
+		ShadeTile(tileIndex, m_tileGBuffers[threadIndex], m_tileSurfaces[threadIndex], lightSources, view.position);
+	});
+	m_timings.tilesMilliseconds = GetMilliseconds(startTime);
+}
+
+
+bool SoftwareRenderer::WriteImage(const std::filesystem::path& path) const
+{
+	std::ofstream file(path, std::ios::binary);
+	const std::string header = "P6\n" + std::to_string(m_width) + " " + std::to_string(m_height) + "\n255\n";
+	file.write(header.data(), header.size());
+
+	std::vector<uint8_t> row(m_width * 3);
+	for (uint32_t y = 0; y < m_height; y++)
+	{
+		for (uint32_t x = 0; x < m_width; x++)
+		{
+			const uint32_t texel = m_image[x + y * m_width];
+			row[x * 3] = static_cast<uint8_t>(texel);
+			row[x * 3 + 1] = static_cast<uint8_t>(texel >> 8);
+			row[x * 3 + 2] = static_cast<uint8_t>(texel >> 16);
+		}
+		file.write(reinterpret_cast<const char*>(row.data()), row.size());
+	}
+	return file.good();
+}
+
+
+void SoftwareRenderer::ParallelFor(uint32_t count, const std::function<void(uint32_t, uint32_t)>& function) const
+{
+	std::atomic<uint32_t> nextIndex = 0;
+	const auto worker = [&](uint32_t threadIndex) {
+		for (uint32_t index = nextIndex++; index < count; index = nextIndex++)
+			function(index, threadIndex);
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(m_threadsCount - 1);
+	for (uint32_t i = 1; i < m_threadsCount; i++)
+		threads.emplace_back(worker, i);
+	worker(0);
+	for (auto& thread : threads)
+		thread.join();
+}
+
+
+void SoftwareRenderer::TransformVertices(const std::vector<StaticBatching::Source>& objects,
+	const Float4x4& viewProjection)
+{
+	m_vertexOffsets.resize(objects.size() + 1);
+	m_triangleOffsets.resize(objects.size() + 1);
+	m_vertexOffsets[0] = 0;
+	m_triangleOffsets[0] = 0;
+	for (uint32_t i = 0; i < objects.size(); i++)
+	{
+		m_vertexOffsets[i + 1] = m_vertexOffsets[i] + objects[i].verticesCount;
+		m_triangleOffsets[i + 1] = m_triangleOffsets[i] + objects[i].indicesCount / 3;
+	}
+	m_vertices.resize(m_vertexOffsets.back());
+	m_trianglesCount = m_triangleOffsets.back();
+
+	const Matrix viewProjectionMatrix = LoadFloat4x4(viewProjection);
+
+	const uint32_t blocksCount = (m_vertexOffsets.back() + kTransformBlockSize - 1) / kTransformBlockSize;
+	ParallelFor(blocksCount, [&](uint32_t blockIndex, uint32_t) {
+		const uint32_t begin = blockIndex * kTransformBlockSize;
+		const uint32_t end = std::min(begin + kTransformBlockSize, m_vertexOffsets.back());
+		uint32_t objectIndex = static_cast<uint32_t>(
+			std::upper_bound(m_vertexOffsets.begin(), m_vertexOffsets.end(), begin) - m_vertexOffsets.begin()) - 1;
+
+		for (uint32_t vertexIndex = begin; vertexIndex < end;)
+		{
+			const Matrix model = LoadFloat4x4(objects[objectIndex].model);
+			const StaticBatching::Vertex* vertices = objects[objectIndex].vertices;
+			const uint32_t objectEnd = std::min(end, m_vertexOffsets[objectIndex + 1]);
+
+			// Same operations as GeometryPass_vs.hlsl
+			for (; vertexIndex < objectEnd; vertexIndex++)
+			{
+				const auto& vertex = vertices[vertexIndex - m_vertexOffsets[objectIndex]];
+				auto& clipVertex = m_vertices[vertexIndex];
+
+				Float4 worldPosition;
+				StoreFloat4(worldPosition, Vector4Transform(LoadFloat4(vertex.position), model));
+				worldPosition.w = 1.0f;
+				StoreFloat4(clipVertex.position, Vector4Transform(LoadFloat4(worldPosition), viewProjectionMatrix));
+
+				Float4 normal;
+				StoreFloat4(normal, Vector4Transform(LoadFloat4(vertex.normal), model));
+				clipVertex.attributes.worldPosition = ToFloat3(worldPosition);
+				clipVertex.attributes.color = ToFloat3(vertex.color);
+				clipVertex.attributes.normal = ToFloat3(normal);
+			}
+			objectIndex++;
+		}
+	});
+}
+
+
+void SoftwareRenderer::BinTriangles(const std::vector<StaticBatching::Source>& objects)
+{
+	// Every worker bins a contiguous range of the triangles, so the bins are the same for any timing
+	ParallelFor(m_threadsCount, [&](uint32_t binsIndex, uint32_t) {
+		auto& bins = m_bins[binsIndex];
+		bins.triangles.clear();
+		for (auto& tile : bins.tiles)
+			tile.clear();
+
+		const uint64_t begin = m_trianglesCount * binsIndex / m_threadsCount;
+		const uint64_t end = m_trianglesCount * (binsIndex + 1) / m_threadsCount;
+		if (begin == end)
+			return;
+		uint32_t objectIndex = static_cast<uint32_t>(
+			std::upper_bound(m_triangleOffsets.begin(), m_triangleOffsets.end(), begin) - m_triangleOffsets.begin()) - 1;
+
+		for (uint64_t triangleIndex = begin; triangleIndex < end;)
+		{
+			const uint32_t* indices = objects[objectIndex].indices;
+			const ClipVertex* vertices = m_vertices.data() + m_vertexOffsets[objectIndex];
+			const uint64_t objectEnd = std::min(end, m_triangleOffsets[objectIndex + 1]);
+
+			for (; triangleIndex < objectEnd; triangleIndex++)
+			{
+				const uint32_t* triangleIndices = indices + (triangleIndex - m_triangleOffsets[objectIndex]) * 3;
+				const ClipVertex* triangle[3] = { &vertices[triangleIndices[0]], &vertices[triangleIndices[1]],
+					&vertices[triangleIndices[2]] };
+
+				// Outside of one clip plane
+				bool isOutside = false;
+				for (uint32_t plane = 0; plane < 5 && !isOutside; plane++)
+				{
+					isOutside = true;
+					for (const ClipVertex* vertex : triangle)
+					{
+						const Float4& p = vertex->position;
+						const float distance = plane == 0 ? p.w - p.x : plane == 1 ? p.w + p.x : plane == 2 ? p.w - p.y
+							: plane == 3 ? p.w + p.y : p.w - p.z;
+						isOutside &= distance < 0.0f;
+					}
+				}
+				if (isOutside)
+					continue;
+
+				// Near plane z >= 0, the polygon left is a fan of at most two triangles
+				ClipVertex polygon[4];
+				uint32_t polygonSize = 0;
+				for (uint32_t i = 0; i < 3; i++)
+				{
+					const ClipVertex& a = *triangle[i];
+					const ClipVertex& b = *triangle[(i + 1) % 3];
+					if (a.position.z >= 0.0f)
+						polygon[polygonSize++] = a;
+					if ((a.position.z >= 0.0f) != (b.position.z >= 0.0f))
+					{
+						const float t = a.position.z / (a.position.z - b.position.z);
+						ClipVertex& clipped = polygon[polygonSize++];
+						StoreFloat4(clipped.position, VectorAdd(LoadFloat4(a.position),
+							VectorScale(VectorSubtract(LoadFloat4(b.position), LoadFloat4(a.position)), t)));
+						clipped.attributes.worldPosition = Lerp(a.attributes.worldPosition, b.attributes.worldPosition, t);
+						clipped.attributes.color = Lerp(a.attributes.color, b.attributes.color, t);
+						clipped.attributes.normal = Lerp(a.attributes.normal, b.attributes.normal, t);
+					}
+				}
+
+				for (uint32_t i = 2; i < polygonSize; i++)
+					SetupTriangle(polygon[0], polygon[i - 1], polygon[i], bins);
+			}
+			objectIndex++;
+		}
+	});
+}
+
+
+void SoftwareRenderer::SetupTriangle(const ClipVertex& vertex0, const ClipVertex& vertex1, const ClipVertex& vertex2,
+	Bins& bins) const
+{
+	const ClipVertex* vertices[3] = { &vertex0, &vertex1, &vertex2 };
+	float x[3];
+	float y[3];
+	float z[3];
+	float inverseW[3];
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		const Float4& position = vertices[i]->position;
+		inverseW[i] = 1.0f / position.w;
+		// y goes down the render target
+		x[i] = (position.x * inverseW[i] * 0.5f + 0.5f) * static_cast<float>(m_width);
+		y[i] = (0.5f - position.y * inverseW[i] * 0.5f) * static_cast<float>(m_height);
+		z[i] = position.z * inverseW[i];
+	}
+
+	// Front faces are counter clockwise on the render target, see GeometryPass.cpp
+	const float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+	if (!(area < 0.0f))
+		return;
+	// Clockwise from now on, the edge functions are positive inside
+	std::swap(vertices[1], vertices[2]);
+	std::swap(x[1], x[2]);
+	std::swap(y[1], y[2]);
+	std::swap(z[1], z[2]);
+	std::swap(inverseW[1], inverseW[2]);
+
+	const float minX = std::max(std::floor(std::min({ x[0], x[1], x[2] })), 0.0f);
+	const float minY = std::max(std::floor(std::min({ y[0], y[1], y[2] })), 0.0f);
+	const float maxX = std::min(std::ceil(std::max({ x[0], x[1], x[2] })), static_cast<float>(m_width - 1));
+	const float maxY = std::min(std::ceil(std::max({ y[0], y[1], y[2] })), static_cast<float>(m_height - 1));
+	if (minX > maxX || minY > maxY)
+		return;
+
+	Triangle& triangle = bins.triangles.emplace_back();
+	triangle.inverseArea = 1.0f / -area;
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		// Edge i is opposite to vertex i. The coefficients are computed from the vertices in the same order for
+		// both triangles sharing the edge, so that they only differ in the sign and the pixels right on the edge
+		// go to exactly one of them.
+		uint32_t a = (i + 1) % 3;
+		uint32_t b = (i + 2) % 3;
+		const bool isReversed = x[a] > x[b] || (x[a] == x[b] && y[a] > y[b]);
+		if (isReversed)
+			std::swap(a, b);
+		const float sign = isReversed ? -1.0f : 1.0f;
+		const float dx = x[b] - x[a];
+		const float dy = y[b] - y[a];
+		triangle.edgeA[i] = -dy * sign;
+		triangle.edgeB[i] = dx * sign;
+		triangle.edgeC[i] = (dy * x[a] - dx * y[a]) * sign;
+		// Top edges are horizontal going right, left edges go up
+		triangle.isTopLeft[i] = dy * sign < 0.0f || (dy == 0.0f && dx * sign > 0.0f);
+
+		triangle.inverseW[i] = inverseW[i];
+		triangle.attributes[i] = vertices[i]->attributes;
+	}
+
+	// Barycentrics are the edge functions over the area, the edge gradients sum to 0
+	triangle.depthPlane[0] = (triangle.edgeA[1] * (z[1] - z[0]) + triangle.edgeA[2] * (z[2] - z[0])) * triangle.inverseArea;
+	triangle.depthPlane[1] = (triangle.edgeB[1] * (z[1] - z[0]) + triangle.edgeB[2] * (z[2] - z[0])) * triangle.inverseArea;
+	triangle.depthPlane[2] = z[0];
+	triangle.x0 = x[0];
+	triangle.y0 = y[0];
+
+	triangle.minX = static_cast<uint32_t>(minX);
+	triangle.minY = static_cast<uint32_t>(minY);
+	triangle.maxX = static_cast<uint32_t>(maxX);
+	triangle.maxY = static_cast<uint32_t>(maxY);
+
+	const uint32_t triangleIndex = static_cast<uint32_t>(bins.triangles.size() - 1);
+	for (uint32_t tileY = triangle.minY / kTileSize; tileY <= triangle.maxY / kTileSize; tileY++)
+	{
+		for (uint32_t tileX = triangle.minX / kTileSize; tileX <= triangle.maxX / kTileSize; tileX++)
+			bins.tiles[tileX + tileY * m_tilesX].push_back(triangleIndex);
+	}
+}
+
+
+void SoftwareRenderer::RasterizeTile(uint32_t tileIndex, TileGBuffer& gBuffer) const
+{
+	const uint32_t originX = (tileIndex % m_tilesX) * kTileSize;
+	const uint32_t originY = (tileIndex / m_tilesX) * kTileSize;
+	const uint32_t lastX = std::min(originX + kTileSize, m_width) - 1;
+	const uint32_t lastY = std::min(originY + kTileSize, m_height) - 1;
+
+	// Cleared as the depth stencil view
+	std::fill(std::begin(gBuffer.depth), std::end(gBuffer.depth), 1.0f);
+
+	const Vector zero = VectorZero();
+	const Vector laneOffsets = VectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+
+	for (const auto& bins : m_bins)
+	{
+		for (const uint32_t triangleIndex : bins.tiles[tileIndex])
+		{
+			const Triangle& triangle = bins.triangles[triangleIndex];
+			const uint32_t beginX = std::max(triangle.minX, originX);
+			const uint32_t endX = std::min(triangle.maxX, lastX) + 1;
+			const uint32_t beginY = std::max(triangle.minY, originY);
+			const uint32_t endY = std::min(triangle.maxY, lastY) + 1;
+
+			Vector edgeA[3];
+			Vector topLeft[3];
+			for (uint32_t i = 0; i < 3; i++)
+			{
+				edgeA[i] = VectorReplicate(triangle.edgeA[i]);
+				topLeft[i] = triangle.isTopLeft[i] ? VectorTrueInt() : VectorFalseInt();
+			}
+			const Vector depthA = VectorReplicate(triangle.depthPlane[0]);
+			const Vector x0 = VectorReplicate(triangle.x0);
+			const Vector endXVector = VectorReplicate(static_cast<float>(endX));
+
+			for (uint32_t y = beginY; y < endY; y++)
+			{
+				const float centerY = static_cast<float>(y) + 0.5f;
+				Vector rowEdges[3];
+				for (uint32_t i = 0; i < 3; i++)
+					rowEdges[i] = VectorReplicate(triangle.edgeB[i] * centerY + triangle.edgeC[i]);
+				const Vector rowDepth = VectorReplicate(triangle.depthPlane[1] * (centerY - triangle.y0)
+					+ triangle.depthPlane[2]);
+
+				// Quads of 4 pixels aligned in the tile
+				for (uint32_t x = originX + ((beginX - originX) & ~3u); x < endX; x += 4)
+				{
+					const Vector centerX = VectorAdd(VectorReplicate(static_cast<float>(x)), laneOffsets);
+
+					Vector edges[3];
+					Vector inside = VectorLess(centerX, endXVector);
+					for (uint32_t i = 0; i < 3; i++)
+					{
+						edges[i] = VectorMultiplyAdd(edgeA[i], centerX, rowEdges[i]);
+						inside = VectorAndInt(inside, VectorOrInt(VectorGreater(edges[i], zero),
+							VectorAndInt(VectorEqual(edges[i], zero), topLeft[i])));
+					}
+
+					float* depthTexels = &gBuffer.depth[(x - originX) + (y - originY) * kTileSize];
+					const Vector depth = VectorMultiplyAdd(depthA, VectorSubtract(centerX, x0), rowDepth);
+					const Vector previousDepth = LoadFloat4A(*reinterpret_cast<const Float4A*>(depthTexels));
+					const Vector passed = VectorAndInt(inside, VectorAndInt(VectorLess(depth, previousDepth),
+						VectorGreaterOrEqual(depth, zero)));
+
+					uint32_t passedLanes[4];
+					StoreInt4(passedLanes, passed);
+					if ((passedLanes[0] | passedLanes[1] | passedLanes[2] | passedLanes[3]) == 0)
+						continue;
+					StoreFloat4A(*reinterpret_cast<Float4A*>(depthTexels), VectorSelect(previousDepth, depth, passed));
+
+					// Perspective correct attributes of the passed pixels
+					for (uint32_t lane = 0; lane < 4; lane++)
+					{
+						if (!passedLanes[lane])
+							continue;
+
+						float weights[3];
+						float inverseW = 0.0f;
+						for (uint32_t i = 0; i < 3; i++)
+						{
+							weights[i] = VectorGetByIndex(edges[i], lane) * triangle.inverseArea * triangle.inverseW[i];
+							inverseW += weights[i];
+						}
+
+						Attributes& attributes = gBuffer.attributes[(x + lane - originX) + (y - originY) * kTileSize];
+						attributes = {};
+						for (uint32_t i = 0; i < 3; i++)
+						{
+							const float weight = weights[i] / inverseW;
+							const Attributes& vertexAttributes = triangle.attributes[i];
+							attributes.worldPosition = Add(attributes.worldPosition,
+								Scale(vertexAttributes.worldPosition, weight));
+							attributes.color = Add(attributes.color, Scale(vertexAttributes.color, weight));
+							attributes.normal = Add(attributes.normal, Scale(vertexAttributes.normal, weight));
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+
+void SoftwareRenderer::ShadeTile(uint32_t tileIndex, const TileGBuffer& gBuffer, TileSurfaces& surfaces,
+	const LightSources& lightSources, const Float3& cameraPosition)
+{
+	const uint32_t originX = (tileIndex % m_tilesX) * kTileSize;
+	const uint32_t originY = (tileIndex / m_tilesX) * kTileSize;
+	const uint32_t endX = std::min(originX + kTileSize, m_width);
+	const uint32_t endY = std::min(originY + kTileSize, m_height);
+
+	// Material of GBufferOutput.hlsli, as read back from the UNORM8 targets
+	const Float3& fresnelIndices = GBufferEncoding::kMaterialFresnelIndices[GBufferEncoding::kMaterialIndex];
+	const Float3 quantizedFresnelIndices(QuantizeUnorm8(fresnelIndices.x), QuantizeUnorm8(fresnelIndices.y),
+		QuantizeUnorm8(fresnelIndices.z));
+	const Float4& ambient = lightSources.GetAmbient().color;
+
+	surfaces.count = 0;
+	for (uint32_t y = originY; y < endY; y++)
+	{
+		for (uint32_t x = originX; x < endX; x++)
+		{
+			const uint32_t tileTexel = (x - originX) + (y - originY) * kTileSize;
+			const float depth = gBuffer.depth[tileTexel];
+			m_depth[x + y * m_width] = depth;
+			if (depth == 1.0f)
+			{
+				m_image[x + y * m_width] = 0xff000000;
+				continue;
+			}
+
+			const Attributes& attributes = gBuffer.attributes[tileTexel];
+			const Float3 surfaceColor(QuantizeUnorm8(attributes.color.x), QuantizeUnorm8(attributes.color.y),
+				QuantizeUnorm8(attributes.color.z));
+			const Float3 normal = Normalize(attributes.normal);
+			const Float3 F0 = Lerp(quantizedFresnelIndices, surfaceColor, GBufferEncoding::kMetalness);
+			const Float3 rho = Lerp(surfaceColor, Float3(0.0f, 0.0f, 0.0f), GBufferEncoding::kMetalness);
+			const Float3 view = Normalize(Subtract(cameraPosition, attributes.worldPosition));
+
+			const uint32_t i = surfaces.count++;
+			surfaces.texels[i] = x + y * m_width;
+			const Float3* vectors[] = { &attributes.worldPosition, &normal, &view, &F0, &rho };
+			float (*arrays[])[TileSurfaces::kCapacity] = { surfaces.position, surfaces.normal, surfaces.view,
+				surfaces.F0, surfaces.rho };
+			for (uint32_t v = 0; v < std::size(vectors); v++)
+			{
+				arrays[v][0][i] = vectors[v]->x;
+				arrays[v][1][i] = vectors[v]->y;
+				arrays[v][2][i] = vectors[v]->z;
+			}
+			surfaces.roughness[i] = GBufferEncoding::kRoughness;
+			surfaces.radiance[0][i] = ambient.x * rho.x;
+			surfaces.radiance[1][i] = ambient.y * rho.y;
+			surfaces.radiance[2][i] = ambient.z * rho.z;
+		}
+	}
+	if (surfaces.count == 0)
+		return;
+
+	const auto getSurfaceVector = [](const float (&arrays)[3][TileSurfaces::kCapacity], uint32_t i) {
+		return Float3(arrays[0][i], arrays[1][i], arrays[2][i]);
+	};
+	const auto setLight = [&](uint32_t i, const Float3& direction, float intensity) {
+		surfaces.light[0][i] = direction.x;
+		surfaces.light[1][i] = direction.y;
+		surfaces.light[2][i] = direction.z;
+		surfaces.lightScale[i] = intensity * std::max(0.0f, Dot(direction, getSurfaceVector(surfaces.normal, i)));
+	};
+
+	for (uint32_t l = 0; l < lightSources.GetDirectionalLightSourcesCount(); l++)
+	{
+		const auto& light = lightSources.GetDirectionalLightSource(l);
+		for (uint32_t i = 0; i < surfaces.count; i++)
+			setLight(i, ToFloat3(light.direction), 1.0f);
+		AddLightRadiance(surfaces, light.color);
+	}
+
+	for (uint32_t l = 0; l < lightSources.GetPointLightSourcesCount(); l++)
+	{
+		const auto& light = lightSources.GetPointLightSource(l);
+		for (uint32_t i = 0; i < surfaces.count; i++)
+		{
+			const Float3 pointOffset = Subtract(ToFloat3(light.position), getSurfaceVector(surfaces.position, i));
+			setLight(i, Normalize(pointOffset), GetDistanceAttenuation(pointOffset));
+		}
+		AddLightRadiance(surfaces, light.color);
+	}
+
+	for (uint32_t l = 0; l < lightSources.GetSpotLightSourcesCount(); l++)
+	{
+		const auto& light = lightSources.GetSpotLightSource(l);
+		for (uint32_t i = 0; i < surfaces.count; i++)
+		{
+			const Float3 pointOffset = Subtract(ToFloat3(light.position), getSurfaceVector(surfaces.position, i));
+			const Float3 lightDirection = Normalize(pointOffset);
+			// Step function, as the shader
+			const float angleAttenuation = static_cast<float>(
+				-Dot(lightDirection, light.direction) >= light.minLdotDir);
+			setLight(i, lightDirection, GetDistanceAttenuation(pointOffset) * angleAttenuation);
+		}
+		AddLightRadiance(surfaces, light.color);
+	}
+
+	for (uint32_t i = 0; i < surfaces.count; i++)
+	{
+		m_image[surfaces.texels[i]] = FloatToUnorm8(std::pow(surfaces.radiance[0][i], kInvGamma))
+			| (FloatToUnorm8(std::pow(surfaces.radiance[1][i], kInvGamma)) << 8)
+			| (FloatToUnorm8(std::pow(surfaces.radiance[2][i], kInvGamma)) << 16) | 0xff000000;
+	}
+}
+
+
+void SoftwareRenderer::AddLightRadiance(TileSurfaces& surfaces, const Float4& color)
+{
+	// Lights facing away from the whole tile and the spot lights missing it
+	if (std::all_of(surfaces.lightScale, surfaces.lightScale + surfaces.count, [](float scale) { return scale == 0.0f; }))
+		return;
+
+	Brdf::Samples samples;
+	for (uint32_t c = 0; c < 3; c++)
+	{
+		samples.normal[c] = surfaces.normal[c];
+		samples.view[c] = surfaces.view[c];
+		samples.light[c] = surfaces.light[c];
+		samples.F0[c] = surfaces.F0[c];
+		samples.rho[c] = surfaces.rho[c];
+		samples.brdf[c] = surfaces.brdf[c];
+	}
+	samples.roughness = surfaces.roughness;
+	samples.count = surfaces.count;
+	Brdf::Evaluate(samples);
+
+	const float colors[] = { color.x, color.y, color.z };
+	for (uint32_t c = 0; c < 3; c++)
+	{
+		for (uint32_t i = 0; i < surfaces.count; i++)
+			surfaces.radiance[c][i] += colors[c] * surfaces.lightScale[i] * surfaces.brdf[c][i];
+	}
+}
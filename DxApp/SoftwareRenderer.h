@@ -0,0 +1,164 @@
+#pragma once
+
+#include <stdint.h>
+#include <filesystem>
+#include <functional>
+#include <vector>
+#include "SimdMath.h"
+#include "StaticBatching.h"
+
+
+class LightSources;
+
+// Headless CPU reference of GeometryPass -> GBuffer -> LightingPass, for golden images and benchmarks without
+// a device. Follows GBufferMode::Standard and the lighting pixel shader with the square falloff. Takes the meshes
+// placed by their models and the light sources, not the Scene, and builds without D3D12 or assimp.
+// Triangles are set up and binned into tiles by the worker threads, each tile is rasterized 4 pixels at a time
+// into its own GBuffer and lit by one thread, every light evaluates Brdf::Evaluate over the covered pixels at once.
+// Same rules as the GPU: D3D depth in [0, 1], LESS in the submission order, back faces culled, pixel centers
+// sampled with the top-left rule. Pixels no triangle covers are black.
+class SoftwareRenderer
+{
+public:
+	static constexpr uint32_t kTileSize = 64;
+
+	struct Timings
+	{
+		double transformMilliseconds = 0.0;
+		double binningMilliseconds = 0.0;
+		// Rasterization and lighting of the tiles
+		double tilesMilliseconds = 0.0;
+
+		[[nodiscard]] double GetTotalMilliseconds() const
+		{
+			return transformMilliseconds + binningMilliseconds + tilesMilliseconds;
+		}
+	};
+
+	struct View
+	{
+		// Row vectors, view then projection
+		SimdMath::Float4x4 viewProjection;
+		SimdMath::Float3 position;
+	};
+
+	SoftwareRenderer() = delete;
+	// threadsCount 0 uses every hardware thread
+	explicit SoftwareRenderer(uint32_t width, uint32_t height, uint32_t threadsCount = 0);
+
+	// Draws the objects in their order, each with its model. The bounds of the sources are not used.
+	void Render(const std::vector<StaticBatching::Source>& objects, const LightSources& lightSources,
+		const View& view);
+
+	// Binary PPM of the image
+	bool WriteImage(const std::filesystem::path& path) const;
+
+	[[nodiscard]] uint32_t GetWidth() const { return m_width; }
+	[[nodiscard]] uint32_t GetHeight() const { return m_height; }
+	// R8G8B8A8_UNORM texels, the swap chain format
+	[[nodiscard]] const std::vector<uint32_t>& GetImage() const { return m_image; }
+	[[nodiscard]] const std::vector<float>& GetDepth() const { return m_depth; }
+	[[nodiscard]] const Timings& GetTimings() const { return m_timings; }
+	[[nodiscard]] uint64_t GetTrianglesCount() const { return m_trianglesCount; }
+
+private:
+	// Interpolated attributes, see GeometryPass.hlsli
+	struct Attributes
+	{
+		SimdMath::Float3 worldPosition;
+		SimdMath::Float3 color;
+		SimdMath::Float3 normal;
+	};
+
+	struct ClipVertex
+	{
+		SimdMath::Float4 position;
+		Attributes attributes;
+	};
+
+	// Screen space triangle, edges are positive inside
+	struct Triangle
+	{
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		bool isTopLeft[3];
+		// Depth is depthPlane[0] * (x - x0) + depthPlane[1] * (y - y0) + depthPlane[2], relative to vertex 0
+		// it keeps the precision of slivers
+		float depthPlane[3];
+		float x0;
+		float y0;
+		float inverseArea;
+		float inverseW[3];
+		Attributes attributes[3];
+		uint32_t minX;
+		uint32_t minY;
+		uint32_t maxX;
+		uint32_t maxY;
+	};
+
+	// Triangles of one worker, binned per tile. Tiles walk the workers in order, which keeps the submission order.
+	struct Bins
+	{
+		std::vector<Triangle> triangles;
+		std::vector<std::vector<uint32_t>> tiles;
+	};
+
+	// Same layout as LightingPass reads it
+	struct TileGBuffer
+	{
+		alignas(16) float depth[kTileSize * kTileSize];
+		Attributes attributes[kTileSize * kTileSize];
+	};
+
+	// Covered pixels of a tile as the structures of arrays Brdf::Evaluate reads
+	struct TileSurfaces
+	{
+		static constexpr uint32_t kCapacity = kTileSize * kTileSize;
+
+		uint32_t count;
+		uint32_t texels[kCapacity];
+		float position[3][kCapacity];
+		float normal[3][kCapacity];
+		float view[3][kCapacity];
+		float F0[3][kCapacity];
+		float rho[3][kCapacity];
+		float roughness[kCapacity];
+		// Direction and color scale of the light being added, the scale includes N dot L
+		float light[3][kCapacity];
+		float lightScale[kCapacity];
+		float brdf[3][kCapacity];
+		float radiance[3][kCapacity];
+	};
+
+	uint32_t m_width;
+	uint32_t m_height;
+	uint32_t m_threadsCount;
+	uint32_t m_tilesX;
+	uint32_t m_tilesY;
+
+	std::vector<ClipVertex> m_vertices;
+	// First vertex and first triangle of every object
+	std::vector<uint32_t> m_vertexOffsets;
+	std::vector<uint64_t> m_triangleOffsets;
+	std::vector<Bins> m_bins;
+	std::vector<TileGBuffer> m_tileGBuffers;
+	std::vector<TileSurfaces> m_tileSurfaces;
+	std::vector<uint32_t> m_image;
+	std::vector<float> m_depth;
+
+	Timings m_timings;
+	uint64_t m_trianglesCount = 0;
+
+	// Calls function(index, threadIndex) for every index on the worker threads
+	void ParallelFor(uint32_t count, const std::function<void(uint32_t, uint32_t)>& function) const;
+
+	void TransformVertices(const std::vector<StaticBatching::Source>& objects,
+		const SimdMath::Float4x4& viewProjection);
+	void BinTriangles(const std::vector<StaticBatching::Source>& objects);
+	void SetupTriangle(const ClipVertex& vertex0, const ClipVertex& vertex1, const ClipVertex& vertex2, Bins& bins) const;
+	void RasterizeTile(uint32_t tileIndex, TileGBuffer& gBuffer) const;
+	void ShadeTile(uint32_t tileIndex, const TileGBuffer& gBuffer, TileSurfaces& surfaces,
+		const LightSources& lightSources, const SimdMath::Float3& cameraPosition);
+	static void AddLightRadiance(TileSurfaces& surfaces, const SimdMath::Float4& color);
+};
@@ -0,0 +1,80 @@
+#include "StagingRing.h"
+
+#include <cassert>
+
+
+StagingRing::StagingRing(uint64_t size)
+{
+	Reset(size);
+}
+
+
+void StagingRing::Reset(uint64_t size)
+{
+	m_batches.clear();
+	m_size = size;
+	m_head = 0;
+	m_tail = 0;
+	m_closedHead = 0;
+}
+
+
+uint64_t StagingRing::Allocate(uint64_t size, uint64_t alignment)
+{
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+	assert(m_size % alignment == 0);
+
+	if (size == 0 || size > m_size)
+		return kInvalidOffset;
+
+	const uint64_t offset = m_head % m_size;
+	uint64_t alignedOffset = (offset + alignment - 1) & ~(alignment - 1);
+	uint64_t padding = alignedOffset - offset;
+
+	// Allocation does not fit before the end, skip the tail of the buffer
+	if (alignedOffset + size > m_size)
+	{
+		padding = m_size - offset;
+		alignedOffset = 0;
+	}
+
+	if (m_head + padding + size - m_tail > m_size)
+		return kInvalidOffset;
+
+	m_head += padding + size;
+	return alignedOffset;
+}
+
+
+void StagingRing::CloseBatch(uint64_t fenceValue)
+{
+	if (!HasOpenAllocations())
+		return;
+
+	assert(m_batches.empty() || m_batches.back().fenceValue < fenceValue);
+	m_batches.push_back({ fenceValue, m_head });
+	m_closedHead = m_head;
+}
+
+
+void StagingRing::Retire(uint64_t completedFenceValue)
+{
+	while (!m_batches.empty() && m_batches.front().fenceValue <= completedFenceValue)
+	{
+		m_tail = m_batches.front().end;
+		m_batches.pop_front();
+	}
+}
+
+
+bool StagingRing::HasOpenAllocations() const
+{
+	return m_head != m_closedHead;
+}
+
+
+uint64_t StagingRing::GetOldestPendingFenceValue() const
+{
+	assert(!m_batches.empty());
+	return m_batches.front().fenceValue;
+}
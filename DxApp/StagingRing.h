@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+
+// Ring allocator over a single staging buffer. Allocations are grouped into batches,
+// each batch is tagged with the fence value that signals its completion.
+// Does not touch any D3D objects, offsets are relative to the staging buffer start.
+class StagingRing
+{
+public:
+	static constexpr uint64_t kInvalidOffset = UINT64_MAX;
+
+	StagingRing() = default;
+	explicit StagingRing(uint64_t size);
+
+	void Reset(uint64_t size);
+
+	// Returns kInvalidOffset if there is no free space until some batches are retired
+	uint64_t Allocate(uint64_t size, uint64_t alignment);
+	// All allocations since the previous CloseBatch belong to the batch with this fenceValue
+	void CloseBatch(uint64_t fenceValue);
+	// Frees space of every batch with fenceValue <= completedFenceValue
+	void Retire(uint64_t completedFenceValue);
+
+	uint64_t GetSize() const { return m_size; }
+	uint64_t GetUsedSize() const { return m_head - m_tail; }
+	bool HasOpenAllocations() const;
+	bool HasPendingBatches() const { return !m_batches.empty(); }
+	uint64_t GetOldestPendingFenceValue() const;
+
+private:
+	struct Batch
+	{
+		uint64_t fenceValue;
+		uint64_t end;
+	};
+
+	std::deque<Batch> m_batches;
+
+	uint64_t m_size = 0;
+	// Monotonic positions, wrapped by m_size on use
+	uint64_t m_head = 0;
+	uint64_t m_tail = 0;
+	uint64_t m_closedHead = 0;
+};
@@ -0,0 +1,226 @@
+#include "StaticBatching.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <iterator>
+#include <random>
+
+
+using namespace SimdMath;
+
+
+namespace
+{
+	struct WorldBounds
+	{
+		Float3 min;
+		Float3 max;
+		Float3 center;
+	};
+
+	float GetAxis(const Float3& vector, uint32_t axis)
+	{
+		return axis == 0 ? vector.x : (axis == 1 ? vector.y : vector.z);
+	}
+
+	void Extend(WorldBounds& bounds, const Float3& min, const Float3& max)
+	{
+		bounds.min = Float3(std::min(bounds.min.x, min.x), std::min(bounds.min.y, min.y), std::min(bounds.min.z, min.z));
+		bounds.max = Float3(std::max(bounds.max.x, max.x), std::max(bounds.max.y, max.y), std::max(bounds.max.z, max.z));
+	}
+
+	WorldBounds GetEmptyBounds()
+	{
+		return { Float3(FLT_MAX, FLT_MAX, FLT_MAX), Float3(-FLT_MAX, -FLT_MAX, -FLT_MAX), Float3(0.0f, 0.0f, 0.0f) };
+	}
+
+	// Box around the transformed object space box, the extents go through the absolute rotation and scale
+	WorldBounds GetWorldBounds(const StaticBatching::Source& source)
+	{
+		Vector center;
+		Vector extents;
+		AabbTransform({ source.boundsMin, source.boundsMax }, LoadFloat4x4(source.model), center, extents);
+
+		WorldBounds bounds;
+		StoreFloat3(bounds.min, VectorSubtract(center, extents));
+		StoreFloat3(bounds.max, VectorAdd(center, extents));
+		StoreFloat3(bounds.center, center);
+		return bounds;
+	}
+
+	float GetMaxExtent(const Float3& min, const Float3& max)
+	{
+		return std::max({ max.x - min.x, max.y - min.y, max.z - min.z });
+	}
+
+	// Transformed positions, normals by the inverse transpose. Winding is kept, the rasterizer sees the same triangles.
+	void Bake(const StaticBatching::Source& source, StaticBatching::Cluster& cluster)
+	{
+		const Matrix model = LoadFloat4x4(source.model);
+		const Matrix normalMatrix = MatrixTranspose(MatrixInverse(model));
+
+		const uint32_t baseVertex = static_cast<uint32_t>(cluster.vertices.size());
+		for (uint32_t i = 0; i < source.verticesCount; i++)
+		{
+			const auto& vertex = source.vertices[i];
+			StaticBatching::Vertex baked;
+			const Float3 position(vertex.position.x, vertex.position.y, vertex.position.z);
+			StoreFloat4(baked.position, Vector3TransformCoord(LoadFloat3(position), model));
+			baked.position.w = 1.0f;
+			baked.color = vertex.color;
+			const Float3 normal(vertex.normal.x, vertex.normal.y, vertex.normal.z);
+			StoreFloat4(baked.normal, Vector3Normalize(Vector3TransformNormal(LoadFloat3(normal), normalMatrix)));
+			baked.normal.w = 0.0f;
+			cluster.vertices.push_back(baked);
+		}
+
+		for (uint32_t i = 0; i < source.indicesCount; i++)
+			cluster.indices.push_back(baseVertex + source.indices[i]);
+	}
+}
+
+
+namespace StaticBatching
+{
+	float Statistics::GetDrawCallReduction() const
+	{
+		return clustersCount > 0 ? static_cast<float>(sourcesCount) / static_cast<float>(clustersCount) : 0.0f;
+	}
+
+
+	std::vector<Cluster> Build(const std::vector<Source>& sources, const Settings& settings, Statistics& statistics)
+	{
+		const auto startTime = std::chrono::high_resolution_clock::now();
+
+		std::vector<WorldBounds> bounds(sources.size());
+		for (uint32_t i = 0; i < sources.size(); i++)
+			bounds[i] = GetWorldBounds(sources[i]);
+
+		std::vector<uint32_t> order(sources.size());
+		for (uint32_t i = 0; i < order.size(); i++)
+			order[i] = i;
+
+		// Median splits along the longest axis of the centers until the ranges fit, ranges are taken in order
+		// so the clusters follow the space
+		struct Range
+		{
+			uint32_t begin;
+			uint32_t end;
+		};
+		std::vector<Range> stack;
+		if (!order.empty())
+			stack.push_back({ 0, static_cast<uint32_t>(order.size()) });
+
+		std::vector<Cluster> clusters;
+		while (!stack.empty())
+		{
+			const Range range = stack.back();
+			stack.pop_back();
+
+			WorldBounds rangeBounds = GetEmptyBounds();
+			WorldBounds centerBounds = GetEmptyBounds();
+			uint64_t verticesCount = 0;
+			for (uint32_t i = range.begin; i < range.end; i++)
+			{
+				const auto& objectBounds = bounds[order[i]];
+				Extend(rangeBounds, objectBounds.min, objectBounds.max);
+				Extend(centerBounds, objectBounds.center, objectBounds.center);
+				verticesCount += sources[order[i]].verticesCount;
+			}
+
+			const bool fits = GetMaxExtent(rangeBounds.min, rangeBounds.max) <= settings.maxClusterExtent
+				&& verticesCount <= settings.maxClusterVerticesCount;
+			if (range.end - range.begin > 1 && !fits)
+			{
+				const Float3 size(centerBounds.max.x - centerBounds.min.x, centerBounds.max.y - centerBounds.min.y,
+					centerBounds.max.z - centerBounds.min.z);
+				const uint32_t axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+				const uint32_t middle = range.begin + (range.end - range.begin) / 2;
+				// Ties by the index keep the split deterministic
+				std::nth_element(order.begin() + range.begin, order.begin() + middle, order.begin() + range.end,
+					[&](uint32_t a, uint32_t b) {
+						const float centerA = GetAxis(bounds[a].center, axis);
+						const float centerB = GetAxis(bounds[b].center, axis);
+						return centerA < centerB || (centerA == centerB && a < b);
+					});
+				stack.push_back({ middle, range.end });
+				stack.push_back({ range.begin, middle });
+				continue;
+			}
+
+			Cluster& cluster = clusters.emplace_back();
+			cluster.vertices.reserve(verticesCount);
+			cluster.boundsMin = rangeBounds.min;
+			cluster.boundsMax = rangeBounds.max;
+			cluster.sourceIndices.assign(order.begin() + range.begin, order.begin() + range.end);
+			std::sort(cluster.sourceIndices.begin(), cluster.sourceIndices.end());
+			for (const uint32_t sourceIndex : cluster.sourceIndices)
+				Bake(sources[sourceIndex], cluster);
+		}
+
+		statistics.sourcesCount = static_cast<uint32_t>(sources.size());
+		statistics.clustersCount = static_cast<uint32_t>(clusters.size());
+		statistics.verticesCount = 0;
+		for (const auto& cluster : clusters)
+			statistics.verticesCount += cluster.vertices.size();
+		statistics.milliseconds = std::chrono::duration<double, std::chrono::milliseconds::period>(
+			std::chrono::high_resolution_clock::now() - startTime).count();
+		return clusters;
+	}
+
+
+	BenchmarkReport Benchmark(uint32_t objectsCount, float sceneSize, const Settings& settings)
+	{
+		// Unit box, every corner has its own direction as the normal
+		Vertex boxVertices[8];
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			const float x = (i & 1) ? 0.5f : -0.5f;
+			const float y = (i & 2) ? 0.5f : -0.5f;
+			const float z = (i & 4) ? 0.5f : -0.5f;
+			boxVertices[i].position = Float4(x, y, z, 1.0f);
+			boxVertices[i].color = Float4(1.0f, 1.0f, 1.0f, 1.0f);
+			const float length = std::sqrt(x * x + y * y + z * z);
+			boxVertices[i].normal = Float4(x / length, y / length, z / length, 0.0f);
+		}
+		constexpr uint32_t kBoxIndices[] = {
+			0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5, 0, 4, 5, 0, 5, 1,
+			2, 3, 7, 2, 7, 6, 0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3
+		};
+
+		std::mt19937 generator(0);
+		std::uniform_real_distribution<float> positionDistribution(0.0f, sceneSize);
+		std::uniform_real_distribution<float> scaleDistribution(0.2f, 2.0f);
+		std::uniform_real_distribution<float> angleDistribution(0.0f, k2Pi);
+
+		std::vector<Source> sources(objectsCount);
+		for (auto& source : sources)
+		{
+			source.vertices = boxVertices;
+			source.verticesCount = std::size(boxVertices);
+			source.indices = kBoxIndices;
+			source.indicesCount = std::size(kBoxIndices);
+			source.boundsMin = Float3(-0.5f, -0.5f, -0.5f);
+			source.boundsMax = Float3(0.5f, 0.5f, 0.5f);
+			const float scale = scaleDistribution(generator);
+			const Matrix model = MatrixMultiply(MatrixMultiply(MatrixScaling(scale, scale, scale),
+				MatrixRotationY(angleDistribution(generator))),
+				MatrixTranslation(positionDistribution(generator), scale * 0.5f, positionDistribution(generator)));
+			StoreFloat4x4(source.model, model);
+		}
+
+		BenchmarkReport report;
+		const auto clusters = Build(sources, settings, report.statistics);
+
+		for (const auto& cluster : clusters)
+		{
+			const float extent = GetMaxExtent(cluster.boundsMin, cluster.boundsMax);
+			report.maxClusterExtent = std::max(report.maxClusterExtent, extent);
+			report.maxClusterVerticesCount = std::max(report.maxClusterVerticesCount,
+				static_cast<uint32_t>(cluster.vertices.size()));
+		}
+		return report;
+	}
+} // namespace StaticBatching
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "SimdMath.h"
+
+
+// Load time merge of static objects sharing the pipeline: objects are split into spatially coherent clusters,
+// their world transforms are baked into the vertices and every cluster is drawn once with the identity transform.
+// Clusters are bounded by their extent and vertices count, so they are still culled and sorted as objects.
+namespace StaticBatching
+{
+	// Layout of the SceneObject vertices
+	struct Vertex
+	{
+		SimdMath::Float4 position;
+		SimdMath::Float4 color;
+		SimdMath::Float4 normal;
+	};
+
+	// Not owned, has to outlive Build
+	struct Source
+	{
+		const Vertex* vertices = nullptr;
+		uint32_t verticesCount = 0;
+		const uint32_t* indices = nullptr;
+		uint32_t indicesCount = 0;
+		SimdMath::Float4x4 model;
+		// Object space bounds
+		SimdMath::Float3 boundsMin;
+		SimdMath::Float3 boundsMax;
+	};
+
+	struct Settings
+	{
+		// Largest world space size of a cluster bounds along any axis
+		float maxClusterExtent = 32.0f;
+		uint32_t maxClusterVerticesCount = 65536;
+	};
+
+	// World space vertices of the sources, in the source order
+	struct Cluster
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		std::vector<uint32_t> sourceIndices;
+		SimdMath::Float3 boundsMin;
+		SimdMath::Float3 boundsMax;
+	};
+
+	struct Statistics
+	{
+		uint32_t sourcesCount = 0;
+		uint32_t clustersCount = 0;
+		uint64_t verticesCount = 0;
+		double milliseconds = 0.0;
+
+		// Draws of the sources per draw of the clusters
+		[[nodiscard]] float GetDrawCallReduction() const;
+	};
+
+	// Sources larger than the limits stay alone, they are not split
+	std::vector<Cluster> Build(const std::vector<Source>& sources, const Settings& settings, Statistics& statistics);
+
+	struct BenchmarkReport
+	{
+		Statistics statistics;
+		float maxClusterExtent = 0.0f;
+		uint32_t maxClusterVerticesCount = 0;
+	};
+
+	// Random boxes scattered over a square sceneSize wide. Timing only, StaticBatchingTests.cpp checks the clusters.
+	BenchmarkReport Benchmark(uint32_t objectsCount, float sceneSize, const Settings& settings);
+} // namespace StaticBatching
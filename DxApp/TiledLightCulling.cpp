@@ -0,0 +1,196 @@
+#include "TiledLightCulling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "GBufferEncoding.h"
+#include "LightSources.h"
+
+
+using namespace SimdMath;
+
+
+namespace
+{
+	float Distance(const Float3& a, const Float3& b)
+	{
+		const float x = a.x - b.x;
+		const float y = a.y - b.y;
+		const float z = a.z - b.z;
+		return std::sqrt(x * x + y * y + z * z);
+	}
+
+	Float3 Lerp(const Float3& a, const Float3& b, float t)
+	{
+		return { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t };
+	}
+
+	// Depth buffer value of a world position
+	float ProjectDepth(const Float3& position, const Float4x4& viewProjection)
+	{
+		Float4 clipPosition;
+		StoreFloat4(clipPosition, Vector4Transform(VectorSet(position.x, position.y, position.z, 1.0f),
+			LoadFloat4x4(viewProjection)));
+		return clipPosition.z / clipPosition.w;
+	}
+
+	Float3 GetLightPosition(const LightSources& lightSources, uint32_t lightIndex)
+	{
+		const Float4& position = lightIndex < LightSources::kMaxPointLightSourcesCount
+			? lightSources.GetPointLightSource(lightIndex).position
+			: lightSources.GetSpotLightSource(lightIndex - LightSources::kMaxPointLightSourcesCount).position;
+		return { position.x, position.y, position.z };
+	}
+
+	const Float4& GetLightColor(const LightSources& lightSources, uint32_t lightIndex)
+	{
+		return lightIndex < LightSources::kMaxPointLightSourcesCount
+			? lightSources.GetPointLightSource(lightIndex).color
+			: lightSources.GetSpotLightSource(lightIndex - LightSources::kMaxPointLightSourcesCount).color;
+	}
+
+	// Indices of the lights the scene has
+	std::vector<uint32_t> GetLightIndices(const LightSources& lightSources)
+	{
+		std::vector<uint32_t> lightIndices;
+		for (uint32_t i = 0; i < lightSources.GetPointLightSourcesCount(); i++)
+			lightIndices.push_back(i);
+		for (uint32_t i = 0; i < lightSources.GetSpotLightSourcesCount(); i++)
+			lightIndices.push_back(LightSources::kMaxPointLightSourcesCount + i);
+		return lightIndices;
+	}
+}
+
+
+namespace TiledLightCulling
+{
+	float GetLightRange(const Float4& color, bool linearFalloff)
+	{
+		const float intensity = std::max({ color.x, color.y, color.z });
+		// Attenuation is clamped to 1 up to the distance 1
+		return std::max(1.0f, linearFalloff
+			? intensity / kLightRadianceCutoff
+			: std::sqrt(intensity / kLightRadianceCutoff));
+	}
+
+
+	Aabb ComputeTileBounds(uint32_t tileX, uint32_t tileY, uint32_t screenWidth, uint32_t screenHeight,
+		float minDepth, float maxDepth, const Float4x4& inverseViewProjection)
+	{
+		const Float2 uvMin = { static_cast<float>(tileX * kTileSize) / static_cast<float>(screenWidth),
+			static_cast<float>(tileY * kTileSize) / static_cast<float>(screenHeight) };
+		const Float2 uvMax = {
+			std::min(static_cast<float>((tileX + 1) * kTileSize) / static_cast<float>(screenWidth), 1.0f),
+			std::min(static_cast<float>((tileY + 1) * kTileSize) / static_cast<float>(screenHeight), 1.0f) };
+
+		Aabb bounds = AabbEmpty();
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			const Float2 uv = { (i & 1) ? uvMax.x : uvMin.x, (i & 2) ? uvMax.y : uvMin.y };
+			const float depth = (i & 4) ? maxDepth : minDepth;
+			const Float3 corner = GBufferEncoding::ReconstructPosition(uv, depth, inverseViewProjection);
+			bounds = AabbAddPoint(bounds, LoadFloat3(corner));
+		}
+
+		return bounds;
+	}
+
+
+	bool SphereIntersectsAabb(const Float3& center, float radius, const Aabb& bounds)
+	{
+		const Float3 closestPoint = { std::clamp(center.x, bounds.minCorner.x, bounds.maxCorner.x),
+			std::clamp(center.y, bounds.minCorner.y, bounds.maxCorner.y),
+			std::clamp(center.z, bounds.minCorner.z, bounds.maxCorner.z) };
+		return Distance(center, closestPoint) <= radius;
+	}
+
+
+	std::vector<uint32_t> CullLights(const LightSources& lightSources, bool linearFalloff, const Aabb& bounds)
+	{
+		std::vector<uint32_t> tileLightIndices;
+		for (const uint32_t lightIndex : GetLightIndices(lightSources))
+		{
+			// Bounding sphere of the spot cone is the sphere of the light range
+			if (SphereIntersectsAabb(GetLightPosition(lightSources, lightIndex),
+				GetLightRange(GetLightColor(lightSources, lightIndex), linearFalloff), bounds))
+			{
+				tileLightIndices.push_back(lightIndex);
+			}
+		}
+		return tileLightIndices;
+	}
+
+
+	ValidationReport Validate(const LightSources& lightSources, bool linearFalloff, const Float4x4& viewProjection,
+		const Float4x4& inverseViewProjection, uint32_t screenWidth, uint32_t screenHeight, uint32_t tilesCount)
+	{
+		ValidationReport report;
+		report.tilesCount = tilesCount;
+
+		const uint32_t tilesX = (screenWidth + kTileSize - 1) / kTileSize;
+		const uint32_t tilesY = (screenHeight + kTileSize - 1) / kTileSize;
+		const std::vector<uint32_t> lightIndices = GetLightIndices(lightSources);
+
+		std::mt19937 generator(0);
+		std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+		std::vector<Float3> positions;
+		for (uint32_t tile = 0; tile < tilesCount; tile++)
+		{
+			const uint32_t tileX = static_cast<uint32_t>(distribution(generator) * static_cast<float>(tilesX - 1));
+			const uint32_t tileY = static_cast<uint32_t>(distribution(generator) * static_cast<float>(tilesY - 1));
+
+			// Surfaces closer to the camera are more common, some tiles get depth discontinuities
+			const float baseDistance = std::pow(distribution(generator), 3.0f) * 0.1f;
+			const float distanceSpread = distribution(generator) < 0.5f ? 0.0f : 0.05f;
+
+			positions.clear();
+			float minDepth = 1.0f;
+			float maxDepth = 0.0f;
+			for (uint32_t y = tileY * kTileSize; y < std::min((tileY + 1) * kTileSize, screenHeight); y++)
+			{
+				for (uint32_t x = tileX * kTileSize; x < std::min((tileX + 1) * kTileSize, screenWidth); x++)
+				{
+					const Float2 uv = { (static_cast<float>(x) + 0.5f) / static_cast<float>(screenWidth),
+						(static_cast<float>(y) + 0.5f) / static_cast<float>(screenHeight) };
+					const Float3 nearPosition = GBufferEncoding::ReconstructPosition(uv, 0.0f, inverseViewProjection);
+					const Float3 farPosition = GBufferEncoding::ReconstructPosition(uv, 1.0f, inverseViewProjection);
+					const Float3 position = Lerp(nearPosition, farPosition,
+						baseDistance + distanceSpread * distribution(generator));
+
+					const float depth = ProjectDepth(position, viewProjection);
+					minDepth = std::min(minDepth, depth);
+					maxDepth = std::max(maxDepth, depth);
+					positions.push_back(position);
+				}
+			}
+
+			const auto bounds = ComputeTileBounds(tileX, tileY, screenWidth, screenHeight, minDepth, maxDepth,
+				inverseViewProjection);
+			const auto tileLightIndices = CullLights(lightSources, linearFalloff, bounds);
+			report.culledLightsCount += static_cast<float>(tileLightIndices.size());
+
+			for (const uint32_t lightIndex : lightIndices)
+			{
+				const Float3 lightPosition = GetLightPosition(lightSources, lightIndex);
+				const float lightRange = GetLightRange(GetLightColor(lightSources, lightIndex), linearFalloff);
+				const bool reachesTile = std::any_of(positions.begin(), positions.end(),
+					[&](const Float3& position) { return Distance(position, lightPosition) <= lightRange; });
+				if (!reachesTile)
+					continue;
+
+				report.bruteForceLightsCount += 1.0f;
+				if (std::find(tileLightIndices.begin(), tileLightIndices.end(), lightIndex) == tileLightIndices.end())
+					report.missedLightsCount++;
+			}
+		}
+
+		if (tilesCount > 0)
+		{
+			report.bruteForceLightsCount /= static_cast<float>(tilesCount);
+			report.culledLightsCount /= static_cast<float>(tilesCount);
+		}
+		return report;
+	}
+} // namespace TiledLightCulling
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "SimdMath.h"
+
+
+class LightSources;
+
+// CPU reference of the tiled lighting light culling, Shaders/Deferred/TiledLightCulling.hlsli has to stay in sync.
+// Light indices are point lights first, then spot lights, as in TiledLightingPass_cs.hlsl.
+namespace TiledLightCulling
+{
+	static constexpr uint32_t kTileSize = 16;
+	static constexpr float kLightRadianceCutoff = 1.0f / 1024.0f;
+
+	using Aabb = SimdMath::Aabb;
+
+	// Distance where the light color times the distance attenuation falls under kLightRadianceCutoff
+	float GetLightRange(const SimdMath::Float4& color, bool linearFalloff);
+
+	// Matrices follow SimdMath row vector convention
+	Aabb ComputeTileBounds(uint32_t tileX, uint32_t tileY, uint32_t screenWidth, uint32_t screenHeight,
+		float minDepth, float maxDepth, const SimdMath::Float4x4& inverseViewProjection);
+
+	bool SphereIntersectsAabb(const SimdMath::Float3& center, float radius, const Aabb& bounds);
+
+	std::vector<uint32_t> CullLights(const LightSources& lightSources, bool linearFalloff, const Aabb& bounds);
+
+	struct ValidationReport
+	{
+		uint32_t tilesCount = 0;
+		// Lights reaching a tile pixel by the brute force test, but culled. Has to be 0.
+		uint32_t missedLightsCount = 0;
+		// Averages over the tiles
+		float bruteForceLightsCount = 0.0f;
+		float culledLightsCount = 0.0f;
+	};
+
+	// Culls random tiles of a synthetic depth buffer and checks every tile pixel against every light
+	ValidationReport Validate(const LightSources& lightSources, bool linearFalloff,
+		const SimdMath::Float4x4& viewProjection, const SimdMath::Float4x4& inverseViewProjection,
+		uint32_t screenWidth, uint32_t screenHeight, uint32_t tilesCount);
+} // namespace TiledLightCulling
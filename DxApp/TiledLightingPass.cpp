@@ -0,0 +1,205 @@
+#include "TiledLightingPass.h"
+
+#include "RendererForwards.h"
+#include "DxHelpers.h"
+#include "Scene.h"
+#include "ShaderCache.h"
+#include "TiledLightCulling.h"
+
+using namespace Microsoft::WRL;
+
+namespace
+{
+	// GBuffer targets, then the depth the tiles are bounded with
+	constexpr uint32_t kSrvCount = GBuffer::kSrvCount + 1;
+}
+
+
+TiledLightingPass::TiledLightingPass(ID3D12Device* device, ShaderCache& shaderCache,
+	PipelineStateCache& pipelineStateCache, GBufferMode gBufferMode)
+{
+	Initialize(device, shaderCache, pipelineStateCache, gBufferMode);
+}
+
+
+void TiledLightingPass::Initialize(ID3D12Device* device, ShaderCache& shaderCache,
+	PipelineStateCache& pipelineStateCache, GBufferMode gBufferMode)
+{
+	m_shaderCache = &shaderCache;
+	m_pipelineStateCache = &pipelineStateCache;
+	m_gBufferMode = gBufferMode;
+
+	CreateRootSignature(device);
+	ResolvePermutationKeys();
+	UpdatePermutation();
+
+	m_cbvSrvUavDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+
+void TiledLightingPass::CreateResources(ID3D12Device* device, GpuHeapAllocator& heapAllocator, uint32_t windowWidth,
+	uint32_t windowHeight)
+{
+	m_outputWidth = windowWidth;
+	m_outputHeight = windowHeight;
+
+	const auto resourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(kOutputFormat, windowWidth, windowHeight,
+		1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+
+	m_outputAllocation = heapAllocator.CreateResource(GpuHeapCategory::RenderTargets, resourceDesc,
+		D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, m_output);
+	m_output->SetName(L"TiledLightingPass::Output");
+}
+
+
+void TiledLightingPass::DestroyResources(GpuHeapAllocator& heapAllocator)
+{
+	m_output.Reset();
+	heapAllocator.Free(m_outputAllocation);
+}
+
+
+void TiledLightingPass::SetScene(Scene* scene)
+{
+	m_scene = scene;
+	UpdatePermutation();
+}
+
+
+void TiledLightingPass::SetFalloff(LightFalloff falloff)
+{
+	m_falloff = falloff;
+	UpdatePermutation();
+}
+
+
+void TiledLightingPass::UpdatePermutation()
+{
+	// No scene yet, the variant without lights is the cheapest to prepare
+	static const LightSources kDefaultLightSources;
+	const auto& lightSources = m_scene ? m_scene->GetLightSources() : kDefaultLightSources;
+
+	m_permutationKey = LightingPass::SelectPermutationKey(m_permutationKeys, lightSources, m_falloff, m_gBufferMode);
+
+	auto& pipelineStateObject = m_pipelineStateObjects[m_permutationKey];
+	if (!pipelineStateObject.valid())
+		pipelineStateObject = CreatePipelineStateObject(m_permutationKey);
+}
+
+
+void TiledLightingPass::SetupRootResourceDescriptors(ID3D12Device* device,
+	CD3DX12_CPU_DESCRIPTOR_HANDLE rootParameters, D3D12_GPU_VIRTUAL_ADDRESS lightingDataAddress,
+	uint32_t lightingDataSize, const GBuffer& gBuffer, ID3D12Resource* depthStencil) const
+{
+	D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
+	cbvDesc.BufferLocation = lightingDataAddress;
+	cbvDesc.SizeInBytes = lightingDataSize;
+	device->CreateConstantBufferView(&cbvDesc, rootParameters);
+	rootParameters.Offset(1, m_cbvSrvUavDescriptorSize);
+
+	for (uint32_t i = 0; i < gBuffer.GetRtCount(); i++)
+	{
+		device->CreateShaderResourceView(gBuffer.GetRt(i), nullptr, rootParameters);
+		rootParameters.Offset(1, m_cbvSrvUavDescriptorSize);
+	}
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC depthSrvDesc = {};
+	depthSrvDesc.Format = kDepthSrvFormat;
+	depthSrvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	depthSrvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	depthSrvDesc.Texture2D.MipLevels = 1;
+
+	// Compact mode has a target less and reads depth in the place of the 4th one, as LightingPass does
+	if (gBuffer.GetMode() == GBufferMode::Compact)
+		device->CreateShaderResourceView(depthStencil, &depthSrvDesc, rootParameters);
+	rootParameters.Offset(GBuffer::kSrvCount - gBuffer.GetRtCount(), m_cbvSrvUavDescriptorSize);
+
+	device->CreateShaderResourceView(depthStencil, &depthSrvDesc, rootParameters);
+	rootParameters.Offset(1, m_cbvSrvUavDescriptorSize);
+
+	device->CreateUnorderedAccessView(m_output.Get(), nullptr, nullptr, rootParameters);
+}
+
+
+void TiledLightingPass::Setup(ID3D12GraphicsCommandList* commandList) const
+{
+	commandList->SetPipelineState(m_pipelineStateObjects.at(m_permutationKey).get().Get());
+	commandList->SetComputeRootSignature(m_rootSignature.Get());
+}
+
+
+void TiledLightingPass::Dispatch(ID3D12GraphicsCommandList* commandList,
+	CD3DX12_GPU_DESCRIPTOR_HANDLE rootParameters) const
+{
+	commandList->SetComputeRootDescriptorTable(0, rootParameters);
+
+	constexpr uint32_t kTileSize = TiledLightCulling::kTileSize;
+	commandList->Dispatch((m_outputWidth + kTileSize - 1) / kTileSize, (m_outputHeight + kTileSize - 1) / kTileSize, 1);
+}
+
+
+uint32_t TiledLightingPass::GetDescriptorTablesDescriptorsCount() const
+{
+	return 1 + kSrvCount + 1;
+}
+
+
+void TiledLightingPass::CreateRootSignature(ID3D12Device* device)
+{
+	D3D12_DESCRIPTOR_RANGE descriptorRanges[3] = {};
+	descriptorRanges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+	descriptorRanges[0].NumDescriptors = 1;
+	descriptorRanges[0].BaseShaderRegister = 0;
+	descriptorRanges[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+	descriptorRanges[0].RegisterSpace = 0;
+
+	descriptorRanges[1].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+	descriptorRanges[1].NumDescriptors = kSrvCount;
+	descriptorRanges[1].BaseShaderRegister = 0;
+	descriptorRanges[1].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+	descriptorRanges[1].RegisterSpace = 0;
+
+	descriptorRanges[2].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+	descriptorRanges[2].NumDescriptors = 1;
+	descriptorRanges[2].BaseShaderRegister = 0;
+	descriptorRanges[2].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+	descriptorRanges[2].RegisterSpace = 0;
+
+	D3D12_ROOT_DESCRIPTOR_TABLE descriptorTable = {};
+	descriptorTable.NumDescriptorRanges = _countof(descriptorRanges);
+	descriptorTable.pDescriptorRanges = descriptorRanges;
+
+	D3D12_ROOT_PARAMETER rootParameters[1] = {};
+	rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+	rootParameters[0].DescriptorTable = descriptorTable;
+	rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
+	rootSignatureDesc.Init(_countof(rootParameters), rootParameters, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_NONE);
+
+	ComPtr<ID3DBlob> signature;
+	ComPtr<ID3DBlob> error;
+
+	DxVerify(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature,
+		&error));
+	DxVerify(device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
+		IID_PPV_ARGS(&m_rootSignature)));
+	m_rootSignatureHash = PipelineStateCache::HashRootSignature(signature->GetBufferPointer(), signature->GetBufferSize());
+}
+
+
+void TiledLightingPass::ResolvePermutationKeys()
+{
+	m_permutationKeys = LightingPermutation::ResolveKeys(
+		m_shaderCache->GetPermutationLayout("TiledLightingPass_cs"));
+}
+
+
+PipelineStateFuture TiledLightingPass::CreatePipelineStateObject(uint32_t permutationKey)
+{
+	D3D12_COMPUTE_PIPELINE_STATE_DESC psoDesc = {};
+	psoDesc.pRootSignature = m_rootSignature.Get();
+	psoDesc.CS = m_shaderCache->GetShader("TiledLightingPass_cs", permutationKey);
+
+	return m_pipelineStateCache->CreateComputePipelineStateAsync(psoDesc, m_rootSignatureHash);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+#include <unordered_map>
+#include <d3d12.h>
+#include <d3dx12.h>
+#include <wrl.h>
+
+#include "GBuffer.h"
+#include "GpuHeapAllocator.h"
+#include "LightingPass.h"
+#include "PipelineStateCache.h"
+
+
+class Scene;
+class ShaderCache;
+
+// Compute shader lighting in 16x16 tiles: every tile culls the point and spot lights against its depth bounds,
+// see TiledLightCulling.h. Writes an output texture the size of the screen, debug views stay on LightingPass.
+class TiledLightingPass
+{
+public:
+	// Copied to the swap chain buffer
+	static constexpr DXGI_FORMAT kOutputFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
+
+	TiledLightingPass() = default;
+	explicit TiledLightingPass(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache,
+		GBufferMode gBufferMode);
+	// PSOs are created asynchronously, the first Setup with a new permutation waits for it.
+	// Caches have to outlive the pass.
+	void Initialize(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache,
+		GBufferMode gBufferMode);
+	~TiledLightingPass() = default;
+
+	// Output is created in the unordered access state
+	void CreateResources(ID3D12Device* device, GpuHeapAllocator& heapAllocator, uint32_t windowWidth,
+		uint32_t windowHeight);
+	void DestroyResources(GpuHeapAllocator& heapAllocator);
+
+	void SetScene(Scene* scene);
+	void SetFalloff(LightFalloff falloff);
+	// Picks the shader variant for the current light sources, has to be called before Setup when lights change
+	void UpdatePermutation();
+	// lightingDataAddress is the LightingPass constant buffer, the passes share it.
+	// depthStencil has to be in a non pixel shader resource state during Dispatch.
+	void SetupRootResourceDescriptors(ID3D12Device* device, CD3DX12_CPU_DESCRIPTOR_HANDLE rootParameters,
+		D3D12_GPU_VIRTUAL_ADDRESS lightingDataAddress, uint32_t lightingDataSize, const GBuffer& gBuffer,
+		ID3D12Resource* depthStencil) const;
+	void Setup(ID3D12GraphicsCommandList* commandList) const;
+	void Dispatch(ID3D12GraphicsCommandList* commandList, CD3DX12_GPU_DESCRIPTOR_HANDLE rootParameters) const;
+
+	[[nodiscard]] uint32_t GetDescriptorTablesDescriptorsCount() const;
+	[[nodiscard]] ID3D12Resource* GetOutput() const { return m_output.Get(); }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12RootSignature> m_rootSignature;
+	uint64_t m_rootSignatureHash = 0;
+	Scene* m_scene = nullptr;
+
+	ShaderCache* m_shaderCache = nullptr;
+	PipelineStateCache* m_pipelineStateCache = nullptr;
+	LightingPass::PermutationKeys m_permutationKeys;
+	GBufferMode m_gBufferMode = GBufferMode::Standard;
+	LightFalloff m_falloff = LightFalloff::Square;
+	uint32_t m_permutationKey = 0;
+	std::unordered_map<uint32_t, PipelineStateFuture> m_pipelineStateObjects;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_output;
+	GpuAllocation m_outputAllocation;
+	uint32_t m_outputWidth = 0;
+	uint32_t m_outputHeight = 0;
+
+	uint32_t m_cbvSrvUavDescriptorSize = 0;
+
+	void CreateRootSignature(ID3D12Device* device);
+	void ResolvePermutationKeys();
+	PipelineStateFuture CreatePipelineStateObject(uint32_t permutationKey);
+};
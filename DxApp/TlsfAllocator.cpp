@@ -0,0 +1,297 @@
+#include "TlsfAllocator.h"
+
+#include <bit>
+#include <cassert>
+
+
+namespace
+{
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+
+float TlsfAllocator::Statistics::GetFragmentation() const
+{
+	const uint64_t freeSize = totalSize - usedSize;
+	if (freeSize == 0)
+		return 0.0f;
+
+	return 1.0f - static_cast<float>(static_cast<double>(largestFreeBlockSize) / static_cast<double>(freeSize));
+}
+
+
+TlsfAllocator::TlsfAllocator(uint64_t size)
+{
+	Reset(size);
+}
+
+
+void TlsfAllocator::Reset(uint64_t size)
+{
+	assert(size >= kMinAlignment && size % kMinAlignment == 0);
+
+	m_blocks.clear();
+	m_unusedBlocks.clear();
+
+	m_firstLevelBitmap = 0;
+	for (uint32_t firstLevel = 0; firstLevel < kFirstLevelCount; firstLevel++)
+	{
+		m_secondLevelBitmaps[firstLevel] = 0;
+		for (uint32_t secondLevel = 0; secondLevel < kSecondLevelCount; secondLevel++)
+			m_freeLists[firstLevel][secondLevel] = kNullBlock;
+	}
+
+	m_size = size;
+	m_usedSize = 0;
+	m_allocationsCount = 0;
+
+	InsertFreeBlock(CreateBlock(0, size));
+}
+
+
+TlsfAllocator::Allocation TlsfAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+	if (size == 0)
+		return {};
+
+	size = AlignUp(size, kMinAlignment);
+	alignment = alignment < kMinAlignment ? kMinAlignment : alignment;
+
+	// Offsets are always kMinAlignment aligned, so the worst padding is alignment - kMinAlignment
+	const uint64_t searchSize = size + alignment - kMinAlignment;
+	if (searchSize > m_size)
+		return {};
+
+	uint32_t blockIndex = FindFreeBlock(searchSize);
+	if (blockIndex == kNullBlock)
+		return {};
+
+	RemoveFreeBlock(blockIndex);
+
+	const uint64_t padding = AlignUp(m_blocks[blockIndex].offset, alignment) - m_blocks[blockIndex].offset;
+	if (padding > 0)
+	{
+		// Previous physical block is used (free neighbours are always merged), keep padding as a separate free block
+		const uint32_t paddingBlockIndex = blockIndex;
+		SplitBlock(paddingBlockIndex, padding);
+		blockIndex = m_blocks[paddingBlockIndex].nextPhysical;
+		InsertFreeBlock(paddingBlockIndex);
+	}
+
+	if (m_blocks[blockIndex].size - size >= kMinAlignment)
+	{
+		SplitBlock(blockIndex, size);
+		InsertFreeBlock(m_blocks[blockIndex].nextPhysical);
+	}
+
+	Block& block = m_blocks[blockIndex];
+	block.isFree = false;
+
+	m_usedSize += block.size;
+	m_allocationsCount++;
+
+	return { block.offset, block.size, blockIndex };
+}
+
+
+void TlsfAllocator::Free(uint32_t handle)
+{
+	assert(handle < m_blocks.size() && !m_blocks[handle].isFree);
+
+	uint32_t blockIndex = handle;
+	m_blocks[blockIndex].isFree = true;
+
+	m_usedSize -= m_blocks[blockIndex].size;
+	m_allocationsCount--;
+
+	const uint32_t nextIndex = m_blocks[blockIndex].nextPhysical;
+	if (nextIndex != kNullBlock && m_blocks[nextIndex].isFree)
+	{
+		RemoveFreeBlock(nextIndex);
+		MergeWithNext(blockIndex);
+	}
+
+	const uint32_t prevIndex = m_blocks[blockIndex].prevPhysical;
+	if (prevIndex != kNullBlock && m_blocks[prevIndex].isFree)
+	{
+		RemoveFreeBlock(prevIndex);
+		MergeWithNext(prevIndex);
+		blockIndex = prevIndex;
+	}
+
+	InsertFreeBlock(blockIndex);
+}
+
+
+TlsfAllocator::Statistics TlsfAllocator::GetStatistics() const
+{
+	Statistics statistics;
+	statistics.totalSize = m_size;
+	statistics.usedSize = m_usedSize;
+	statistics.allocationsCount = m_allocationsCount;
+
+	for (uint32_t firstLevel = 0; firstLevel < kFirstLevelCount; firstLevel++)
+	{
+		for (uint32_t secondLevel = 0; secondLevel < kSecondLevelCount; secondLevel++)
+		{
+			for (uint32_t blockIndex = m_freeLists[firstLevel][secondLevel]; blockIndex != kNullBlock;
+				 blockIndex = m_blocks[blockIndex].nextFree)
+			{
+				statistics.freeBlocksCount++;
+				if (m_blocks[blockIndex].size > statistics.largestFreeBlockSize)
+					statistics.largestFreeBlockSize = m_blocks[blockIndex].size;
+			}
+		}
+	}
+
+	return statistics;
+}
+
+
+void TlsfAllocator::MapInsert(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+	// size >= kMinAlignment, so firstLevel is always >= kSecondLevelLog2
+	firstLevel = static_cast<uint32_t>(std::bit_width(size)) - 1;
+	secondLevel = static_cast<uint32_t>(size >> (firstLevel - kSecondLevelLog2)) - kSecondLevelCount;
+}
+
+
+void TlsfAllocator::MapSearch(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+	// Round up to the next list, so any block in the found list is big enough
+	const uint32_t log2Size = static_cast<uint32_t>(std::bit_width(size)) - 1;
+	const uint64_t roundedSize = size + (uint64_t(1) << (log2Size - kSecondLevelLog2)) - 1;
+	MapInsert(roundedSize, firstLevel, secondLevel);
+}
+
+
+uint32_t TlsfAllocator::FindFreeBlock(uint64_t size) const
+{
+	uint32_t firstLevel;
+	uint32_t secondLevel;
+	MapSearch(size, firstLevel, secondLevel);
+
+	uint32_t secondLevelMap = m_secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+	if (secondLevelMap == 0)
+	{
+		if (firstLevel + 1 >= kFirstLevelCount)
+			return kNullBlock;
+
+		const uint64_t firstLevelMap = m_firstLevelBitmap & (~uint64_t(0) << (firstLevel + 1));
+		if (firstLevelMap == 0)
+			return kNullBlock;
+
+		firstLevel = static_cast<uint32_t>(std::countr_zero(firstLevelMap));
+		secondLevelMap = m_secondLevelBitmaps[firstLevel];
+	}
+	secondLevel = static_cast<uint32_t>(std::countr_zero(secondLevelMap));
+
+	return m_freeLists[firstLevel][secondLevel];
+}
+
+
+uint32_t TlsfAllocator::CreateBlock(uint64_t offset, uint64_t size)
+{
+	const Block block = { offset, size, kNullBlock, kNullBlock, kNullBlock, kNullBlock, true };
+
+	if (!m_unusedBlocks.empty())
+	{
+		const uint32_t blockIndex = m_unusedBlocks.back();
+		m_unusedBlocks.pop_back();
+		m_blocks[blockIndex] = block;
+		return blockIndex;
+	}
+
+	m_blocks.push_back(block);
+	return static_cast<uint32_t>(m_blocks.size() - 1);
+}
+
+
+void TlsfAllocator::DestroyBlock(uint32_t blockIndex)
+{
+	m_unusedBlocks.push_back(blockIndex);
+}
+
+
+void TlsfAllocator::InsertFreeBlock(uint32_t blockIndex)
+{
+	uint32_t firstLevel;
+	uint32_t secondLevel;
+	MapInsert(m_blocks[blockIndex].size, firstLevel, secondLevel);
+
+	Block& block = m_blocks[blockIndex];
+	block.isFree = true;
+	block.prevFree = kNullBlock;
+	block.nextFree = m_freeLists[firstLevel][secondLevel];
+	if (block.nextFree != kNullBlock)
+		m_blocks[block.nextFree].prevFree = blockIndex;
+
+	m_freeLists[firstLevel][secondLevel] = blockIndex;
+	m_firstLevelBitmap |= uint64_t(1) << firstLevel;
+	m_secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+}
+
+
+void TlsfAllocator::RemoveFreeBlock(uint32_t blockIndex)
+{
+	uint32_t firstLevel;
+	uint32_t secondLevel;
+	MapInsert(m_blocks[blockIndex].size, firstLevel, secondLevel);
+
+	const Block& block = m_blocks[blockIndex];
+	if (block.prevFree != kNullBlock)
+		m_blocks[block.prevFree].nextFree = block.nextFree;
+	if (block.nextFree != kNullBlock)
+		m_blocks[block.nextFree].prevFree = block.prevFree;
+
+	if (m_freeLists[firstLevel][secondLevel] == blockIndex)
+	{
+		m_freeLists[firstLevel][secondLevel] = block.nextFree;
+		if (block.nextFree == kNullBlock)
+		{
+			m_secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+			if (m_secondLevelBitmaps[firstLevel] == 0)
+				m_firstLevelBitmap &= ~(uint64_t(1) << firstLevel);
+		}
+	}
+}
+
+
+void TlsfAllocator::SplitBlock(uint32_t blockIndex, uint64_t size)
+{
+	assert(m_blocks[blockIndex].size > size);
+
+	const uint32_t remainderIndex = CreateBlock(m_blocks[blockIndex].offset + size, m_blocks[blockIndex].size - size);
+	Block& block = m_blocks[blockIndex];
+	Block& remainder = m_blocks[remainderIndex];
+
+	remainder.prevPhysical = blockIndex;
+	remainder.nextPhysical = block.nextPhysical;
+	if (block.nextPhysical != kNullBlock)
+		m_blocks[block.nextPhysical].prevPhysical = remainderIndex;
+
+	block.nextPhysical = remainderIndex;
+	block.size = size;
+}
+
+
+void TlsfAllocator::MergeWithNext(uint32_t blockIndex)
+{
+	const uint32_t nextIndex = m_blocks[blockIndex].nextPhysical;
+	assert(nextIndex != kNullBlock);
+
+	Block& block = m_blocks[blockIndex];
+	const Block& next = m_blocks[nextIndex];
+
+	block.size += next.size;
+	block.nextPhysical = next.nextPhysical;
+	if (next.nextPhysical != kNullBlock)
+		m_blocks[next.nextPhysical].prevPhysical = blockIndex;
+
+	DestroyBlock(nextIndex);
+}
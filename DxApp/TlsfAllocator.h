@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+
+// Two-level segregated fit allocator over an abstract [0, size) range.
+// Knows nothing about D3D, GpuHeapAllocator uses it to place resources inside ID3D12Heaps.
+// Every operation is O(1) except GetStatistics.
+class TlsfAllocator
+{
+public:
+	static constexpr uint32_t kInvalidHandle = UINT32_MAX;
+	static constexpr uint64_t kMinAlignment = 256;
+
+	struct Allocation
+	{
+		uint64_t offset = 0;
+		uint64_t size = 0;
+		uint32_t handle = kInvalidHandle;
+
+		bool IsValid() const { return handle != kInvalidHandle; }
+	};
+
+	struct Statistics
+	{
+		uint64_t totalSize = 0;
+		uint64_t usedSize = 0;
+		uint32_t allocationsCount = 0;
+		uint32_t freeBlocksCount = 0;
+		uint64_t largestFreeBlockSize = 0;
+
+		// 0 when all free space is one block, close to 1 when it is scattered
+		float GetFragmentation() const;
+	};
+
+	TlsfAllocator() = default;
+	explicit TlsfAllocator(uint64_t size);
+
+	void Reset(uint64_t size);
+
+	// alignment has to be a power of two, returns invalid allocation if no free block fits
+	Allocation Allocate(uint64_t size, uint64_t alignment = kMinAlignment);
+	void Free(uint32_t handle);
+
+	uint64_t GetSize() const { return m_size; }
+	uint64_t GetUsedSize() const { return m_usedSize; }
+	bool IsEmpty() const { return m_allocationsCount == 0; }
+	Statistics GetStatistics() const;
+
+private:
+	static constexpr uint32_t kSecondLevelLog2 = 4;
+	static constexpr uint32_t kSecondLevelCount = 1 << kSecondLevelLog2;
+	static constexpr uint32_t kFirstLevelCount = 64;
+	static constexpr uint32_t kNullBlock = UINT32_MAX;
+
+	struct Block
+	{
+		uint64_t offset;
+		uint64_t size;
+		uint32_t prevPhysical;
+		uint32_t nextPhysical;
+		uint32_t prevFree;
+		uint32_t nextFree;
+		bool isFree;
+	};
+
+	std::vector<Block> m_blocks;
+	std::vector<uint32_t> m_unusedBlocks;
+
+	uint64_t m_firstLevelBitmap = 0;
+	uint32_t m_secondLevelBitmaps[kFirstLevelCount] = {};
+	uint32_t m_freeLists[kFirstLevelCount][kSecondLevelCount];
+
+	uint64_t m_size = 0;
+	uint64_t m_usedSize = 0;
+	uint32_t m_allocationsCount = 0;
+
+	static void MapInsert(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+	static void MapSearch(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+
+	uint32_t FindFreeBlock(uint64_t size) const;
+	uint32_t CreateBlock(uint64_t offset, uint64_t size);
+	void DestroyBlock(uint32_t blockIndex);
+	void InsertFreeBlock(uint32_t blockIndex);
+	void RemoveFreeBlock(uint32_t blockIndex);
+	// Cuts [offset + size, end) of the block into a new free block
+	void SplitBlock(uint32_t blockIndex, uint64_t size);
+	// Merges the next physical block into this one
+	void MergeWithNext(uint32_t blockIndex);
+};
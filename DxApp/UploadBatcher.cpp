@@ -0,0 +1,103 @@
+#include "UploadBatcher.h"
+
+#include <algorithm>
+#include <cassert>
+
+
+void UploadBatcher::Reset(UploadQueue* queue, uint64_t stagingSize, uint64_t maxBatchSize)
+{
+	assert(!m_isRecording);
+	m_queue = queue;
+	m_stagingRing.Reset(stagingSize);
+	m_maxBatchSize = maxBatchSize;
+	m_batchSize = 0;
+}
+
+
+uint64_t UploadBatcher::GetChunkSize(uint64_t size) const
+{
+	// Big buffers are split, so any size fits the staging ring
+	return std::min(size, std::min(m_maxBatchSize, m_stagingRing.GetSize() / 2));
+}
+
+
+uint64_t UploadBatcher::BeginCopy(uint64_t chunkSize)
+{
+	const uint64_t stagingOffset = AllocateStaging(chunkSize);
+	if (!m_isRecording)
+	{
+		m_queue->BeginBatch();
+		m_isRecording = true;
+	}
+	return stagingOffset;
+}
+
+
+void UploadBatcher::EndCopy(uint64_t chunkSize)
+{
+	m_batchSize += chunkSize;
+	if (m_batchSize >= m_maxBatchSize)
+		Flush();
+}
+
+
+uint64_t UploadBatcher::Flush()
+{
+	if (!m_isRecording)
+		return m_nextFenceValue - 1;
+
+	const uint64_t fenceValue = m_nextFenceValue++;
+	m_queue->SubmitBatch(fenceValue);
+	m_stagingRing.CloseBatch(fenceValue);
+
+	m_isRecording = false;
+	m_batchSize = 0;
+
+	return fenceValue;
+}
+
+
+bool UploadBatcher::IsCompleted(uint64_t fenceValue) const
+{
+	return m_queue->GetCompletedFenceValue() >= fenceValue;
+}
+
+
+void UploadBatcher::WaitForFence(uint64_t fenceValue)
+{
+	if (!IsCompleted(fenceValue))
+		m_queue->WaitForFence(fenceValue);
+}
+
+
+void UploadBatcher::WaitForIdle()
+{
+	WaitForFence(Flush());
+	Retire();
+}
+
+
+void UploadBatcher::Retire()
+{
+	m_stagingRing.Retire(m_queue->GetCompletedFenceValue());
+}
+
+
+uint64_t UploadBatcher::AllocateStaging(uint64_t size)
+{
+	Retire();
+
+	uint64_t offset = m_stagingRing.Allocate(size, kStagingAlignment);
+	while (offset == StagingRing::kInvalidOffset)
+	{
+		// Ring is full, submit what we have and wait for the oldest batch
+		Flush();
+		assert(m_stagingRing.HasPendingBatches());
+		WaitForFence(m_stagingRing.GetOldestPendingFenceValue());
+		Retire();
+
+		offset = m_stagingRing.Allocate(size, kStagingAlignment);
+	}
+
+	return offset;
+}
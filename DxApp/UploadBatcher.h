@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+
+#include "StagingRing.h"
+
+
+// Copy queue and fence of the uploads. UploadService submits to a D3D12 copy queue, the tests simulate one.
+class UploadQueue
+{
+public:
+	virtual ~UploadQueue() = default;
+
+	// Copies recorded from now on belong to a new batch
+	virtual void BeginBatch() = 0;
+	// Submits the batch, the fence reaches fenceValue once its copies complete
+	virtual void SubmitBatch(uint64_t fenceValue) = 0;
+	virtual uint64_t GetCompletedFenceValue() const = 0;
+	virtual void WaitForFence(uint64_t fenceValue) = 0;
+};
+
+
+// Splits uploads into chunks of a staging ring and groups them into batches of at most maxBatchSize bytes.
+// Space of a batch is reused once the queue fence passes the value the batch was submitted with,
+// a full ring submits the open batch and waits for the oldest one.
+class UploadBatcher
+{
+public:
+	static constexpr uint64_t kStagingAlignment = 16;
+
+	UploadBatcher() = default;
+
+	void Reset(UploadQueue* queue, uint64_t stagingSize, uint64_t maxBatchSize);
+
+	// Size of the next chunk of an upload of size bytes
+	uint64_t GetChunkSize(uint64_t size) const;
+	// Staging offset of a chunk, the caller records its copy then calls EndCopy
+	uint64_t BeginCopy(uint64_t chunkSize);
+	void EndCopy(uint64_t chunkSize);
+
+	// Submits the open batch, returns the fence value that signals the completion of every copy so far
+	uint64_t Flush();
+	[[nodiscard]] bool IsCompleted(uint64_t fenceValue) const;
+	void WaitForFence(uint64_t fenceValue);
+	void WaitForIdle();
+	// Frees staging space of the completed batches
+	void Retire();
+
+	[[nodiscard]] bool IsRecording() const { return m_isRecording; }
+	const StagingRing& GetStagingRing() const { return m_stagingRing; }
+
+private:
+	UploadQueue* m_queue = nullptr;
+	StagingRing m_stagingRing;
+	uint64_t m_maxBatchSize = 0;
+	bool m_isRecording = false;
+	uint64_t m_batchSize = 0;
+	uint64_t m_nextFenceValue = 1;
+
+	uint64_t AllocateStaging(uint64_t size);
+};
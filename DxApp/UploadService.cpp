@@ -0,0 +1,158 @@
+#include "UploadService.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "DxHelpers.h"
+
+
+using namespace Microsoft::WRL;
+
+
+D3D12UploadQueue::~D3D12UploadQueue()
+{
+	if (m_fenceEvent)
+		CloseHandle(m_fenceEvent);
+}
+
+
+void D3D12UploadQueue::Initialize(ID3D12Device* device)
+{
+	m_device = device;
+
+	D3D12_COMMAND_QUEUE_DESC commandQueueDesc = {};
+	commandQueueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	DxVerify(m_device->CreateCommandQueue(&commandQueueDesc, IID_PPV_ARGS(&m_copyQueue)));
+	m_copyQueue->SetName(L"UploadService::CopyQueue");
+
+	m_commandAllocators.push_back({});
+	DxVerify(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY,
+		IID_PPV_ARGS(&m_commandAllocators[0].allocator)));
+	m_commandAllocators[0].fenceValue = 0;
+
+	DxVerify(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, m_commandAllocators[0].allocator.Get(),
+		nullptr, IID_PPV_ARGS(&m_commandList)));
+	DxVerify(m_commandList->Close());
+
+	DxVerify(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
+	m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	if (m_fenceEvent == nullptr)
+	{
+		DxVerify(HRESULT_FROM_WIN32(GetLastError()));
+	}
+}
+
+
+void D3D12UploadQueue::BeginBatch()
+{
+	const uint64_t completedFenceValue = m_fence->GetCompletedValue();
+
+	const auto freeAllocator = std::find_if(m_commandAllocators.begin(), m_commandAllocators.end(),
+		[completedFenceValue](const CommandAllocatorEntry& entry) {
+			return entry.fenceValue <= completedFenceValue;
+		});
+
+	if (freeAllocator != m_commandAllocators.end())
+	{
+		m_recordingAllocatorIndex = static_cast<uint32_t>(freeAllocator - m_commandAllocators.begin());
+		DxVerify(freeAllocator->allocator->Reset());
+	}
+	else
+	{
+		m_recordingAllocatorIndex = static_cast<uint32_t>(m_commandAllocators.size());
+		m_commandAllocators.push_back({});
+		DxVerify(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY,
+			IID_PPV_ARGS(&m_commandAllocators.back().allocator)));
+	}
+	// Not reusable until this batch is submitted
+	m_commandAllocators[m_recordingAllocatorIndex].fenceValue = UINT64_MAX;
+
+	DxVerify(m_commandList->Reset(m_commandAllocators[m_recordingAllocatorIndex].allocator.Get(), nullptr));
+}
+
+
+void D3D12UploadQueue::SubmitBatch(uint64_t fenceValue)
+{
+	DxVerify(m_commandList->Close());
+
+	ID3D12CommandList* commandLists[] = { m_commandList.Get() };
+	m_copyQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
+	DxVerify(m_copyQueue->Signal(m_fence.Get(), fenceValue));
+
+	m_commandAllocators[m_recordingAllocatorIndex].fenceValue = fenceValue;
+}
+
+
+uint64_t D3D12UploadQueue::GetCompletedFenceValue() const
+{
+	return m_fence->GetCompletedValue();
+}
+
+
+void D3D12UploadQueue::WaitForFence(uint64_t fenceValue)
+{
+	DxVerify(m_fence->SetEventOnCompletion(fenceValue, m_fenceEvent));
+	WaitForSingleObject(m_fenceEvent, INFINITE);
+}
+
+
+void D3D12UploadQueue::WaitOnGpu(ID3D12Fence* fence, uint64_t fenceValue)
+{
+	DxVerify(m_copyQueue->Wait(fence, fenceValue));
+}
+
+
+UploadService::~UploadService()
+{
+	if (m_queue.GetFence())
+		WaitForIdle();
+}
+
+
+void UploadService::Initialize(ID3D12Device* device, GpuHeapAllocator& heapAllocator, uint64_t stagingSize)
+{
+	m_queue.Initialize(device);
+
+	const auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(stagingSize);
+	m_stagingBufferAllocation = heapAllocator.CreateResource(GpuHeapCategory::Upload, resourceDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, m_stagingBuffer);
+	m_stagingBuffer->SetName(L"UploadService::StagingBuffer");
+
+	// Upload heap stays mapped for the whole lifetime
+	const auto readRange = CD3DX12_RANGE(0, 0);
+	DxVerify(m_stagingBuffer->Map(0, &readRange, reinterpret_cast<void**>(&m_stagingData)));
+	m_batcher.Reset(&m_queue, stagingSize, kMaxBatchSize);
+}
+
+
+void UploadService::Destroy(GpuHeapAllocator& heapAllocator)
+{
+	WaitForIdle();
+
+	m_stagingBuffer->Unmap(0, nullptr);
+	m_stagingData = nullptr;
+	m_stagingBuffer.Reset();
+	heapAllocator.Free(m_stagingBufferAllocation);
+}
+
+
+void UploadService::UploadBuffer(ID3D12Resource* destination, uint64_t destinationOffset, const void* data,
+	uint64_t size)
+{
+	const auto* source = static_cast<const uint8_t*>(data);
+
+	while (size > 0)
+	{
+		const uint64_t chunkSize = m_batcher.GetChunkSize(size);
+		const uint64_t stagingOffset = m_batcher.BeginCopy(chunkSize);
+
+		memcpy(m_stagingData + stagingOffset, source, chunkSize);
+		m_queue.GetCommandList()->CopyBufferRegion(destination, destinationOffset, m_stagingBuffer.Get(),
+			stagingOffset, chunkSize);
+		m_batcher.EndCopy(chunkSize);
+
+		source += chunkSize;
+		destinationOffset += chunkSize;
+		size -= chunkSize;
+	}
+}
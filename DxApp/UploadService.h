@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <d3d12.h>
+#include <d3dx12.h>
+#include <wrl.h>
+
+#include "GpuHeapAllocator.h"
+#include "UploadBatcher.h"
+
+
+// D3D12 copy queue of UploadService. Recorded copies are submitted by SubmitBatch, command allocators are reused
+// once the batches recorded into them complete.
+class D3D12UploadQueue : public UploadQueue
+{
+public:
+	D3D12UploadQueue() = default;
+	~D3D12UploadQueue() override;
+
+	void Initialize(ID3D12Device* device);
+
+	void BeginBatch() override;
+	void SubmitBatch(uint64_t fenceValue) override;
+	uint64_t GetCompletedFenceValue() const override;
+	void WaitForFence(uint64_t fenceValue) override;
+
+	void WaitOnGpu(ID3D12Fence* fence, uint64_t fenceValue);
+	ID3D12GraphicsCommandList* GetCommandList() const { return m_commandList.Get(); }
+	ID3D12Fence* GetFence() const { return m_fence.Get(); }
+
+private:
+	struct CommandAllocatorEntry
+	{
+		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator;
+		uint64_t fenceValue;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_copyQueue;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_commandList;
+	std::vector<CommandAllocatorEntry> m_commandAllocators;
+	uint32_t m_recordingAllocatorIndex = 0;
+
+	Microsoft::WRL::ComPtr<ID3D12Fence> m_fence;
+	HANDLE m_fenceEvent = nullptr;
+};
+
+
+// Streams buffer data to default heap resources through a copy queue.
+// Copies are recorded into batches over one persistently mapped staging buffer, see UploadBatcher,
+// a batch is complete when the copy fence reaches the value returned by Flush.
+// Destination buffers have to be created in D3D12_RESOURCE_STATE_COMMON, they decay back to it
+// after the copy and get implicitly promoted to read states on the direct queue.
+class UploadService
+{
+public:
+	static constexpr uint64_t kDefaultStagingSize = 64 * 1024 * 1024;
+	static constexpr uint64_t kMaxBatchSize = 16 * 1024 * 1024;
+
+	UploadService() = default;
+	~UploadService();
+
+	void Initialize(ID3D12Device* device, GpuHeapAllocator& heapAllocator, uint64_t stagingSize = kDefaultStagingSize);
+	void Destroy(GpuHeapAllocator& heapAllocator);
+
+	void UploadBuffer(ID3D12Resource* destination, uint64_t destinationOffset, const void* data, uint64_t size);
+	// Submits the recorded copies, returns the copy fence value that signals their completion
+	uint64_t Flush() { return m_batcher.Flush(); }
+
+	[[nodiscard]] bool IsCompleted(uint64_t fenceValue) const { return m_batcher.IsCompleted(fenceValue); }
+	void WaitForFence(uint64_t fenceValue) { m_batcher.WaitForFence(fenceValue); }
+	void WaitForIdle() { m_batcher.WaitForIdle(); }
+	// Copies submitted from now on start once fence reaches fenceValue on the GPU, for destinations other queues
+	// may still read
+	void WaitOnGpu(ID3D12Fence* fence, uint64_t fenceValue) { m_queue.WaitOnGpu(fence, fenceValue); }
+	// Frees staging space of the completed batches
+	void Retire() { m_batcher.Retire(); }
+
+	ID3D12Fence* GetFence() const { return m_queue.GetFence(); }
+
+private:
+	D3D12UploadQueue m_queue;
+	UploadBatcher m_batcher;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_stagingBuffer;
+	GpuAllocation m_stagingBufferAllocation;
+	uint8_t* m_stagingData = nullptr;
+};
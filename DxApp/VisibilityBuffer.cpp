@@ -0,0 +1,47 @@
+#include "VisibilityBuffer.h"
+
+
+using namespace SimdMath;
+
+
+namespace VisibilityBuffer
+{
+	Float3 ComputeBarycentrics(const Float4 (&clipPositions)[3], const Float2& pixelNdc)
+	{
+		float invW[3];
+		Float2 ndc[3];
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			invW[i] = 1.0f / clipPositions[i].w;
+			ndc[i] = { clipPositions[i].x * invW[i], clipPositions[i].y * invW[i] };
+		}
+
+		// Screen space barycentrics, linear in ndc
+		const Float2 edge1 = { ndc[1].x - ndc[0].x, ndc[1].y - ndc[0].y };
+		const Float2 edge2 = { ndc[2].x - ndc[0].x, ndc[2].y - ndc[0].y };
+		const Float2 offset = { pixelNdc.x - ndc[0].x, pixelNdc.y - ndc[0].y };
+		const float invDeterminant = 1.0f / (edge1.x * edge2.y - edge1.y * edge2.x);
+		const float screen1 = (offset.x * edge2.y - offset.y * edge2.x) * invDeterminant;
+		const float screen2 = (edge1.x * offset.y - edge1.y * offset.x) * invDeterminant;
+		const float screen0 = 1.0f - screen1 - screen2;
+
+		// Attributes are linear in 1 / w
+		const float perspective0 = screen0 * invW[0];
+		const float perspective1 = screen1 * invW[1];
+		const float perspective2 = screen2 * invW[2];
+		const float invSum = 1.0f / (perspective0 + perspective1 + perspective2);
+
+		return { perspective0 * invSum, perspective1 * invSum, perspective2 * invSum };
+	}
+
+
+	Float4 Interpolate(const Float4 (&values)[3], const Float3& barycentrics)
+	{
+		return {
+			values[0].x * barycentrics.x + values[1].x * barycentrics.y + values[2].x * barycentrics.z,
+			values[0].y * barycentrics.x + values[1].y * barycentrics.y + values[2].y * barycentrics.z,
+			values[0].z * barycentrics.x + values[1].z * barycentrics.y + values[2].z * barycentrics.z,
+			values[0].w * barycentrics.x + values[1].w * barycentrics.y + values[2].w * barycentrics.z
+		};
+	}
+} // namespace VisibilityBuffer
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+#include "SimdMath.h"
+
+
+// CPU reference of the visibility buffer encoding and attribute reconstruction,
+// Shaders/Deferred/VisibilityBuffer.hlsli has to stay in sync.
+namespace VisibilityBuffer
+{
+	// 4M triangles per object, 1024 objects. Pixels without geometry are never read, the stencil masks them out.
+	static constexpr uint32_t kTriangleIndexBits = 22;
+	static constexpr uint32_t kObjectIndexBits = 32 - kTriangleIndexBits;
+	static constexpr uint32_t kMaxTrianglesCount = 1u << kTriangleIndexBits;
+	static constexpr uint32_t kMaxObjectsCount = 1u << kObjectIndexBits;
+
+	constexpr uint32_t PackId(uint32_t objectIndex, uint32_t triangleIndex)
+	{
+		return (objectIndex << kTriangleIndexBits) | (triangleIndex & (kMaxTrianglesCount - 1));
+	}
+
+	constexpr uint32_t GetObjectIndex(uint32_t id)
+	{
+		return id >> kTriangleIndexBits;
+	}
+
+	constexpr uint32_t GetTriangleIndex(uint32_t id)
+	{
+		return id & (kMaxTrianglesCount - 1);
+	}
+
+	// Perspective correct barycentrics of a point of the triangle given by its clip space vertices.
+	// pixelNdc is the pixel center in normalized device coordinates.
+	SimdMath::Float3 ComputeBarycentrics(const SimdMath::Float4 (&clipPositions)[3],
+		const SimdMath::Float2& pixelNdc);
+
+	SimdMath::Float4 Interpolate(const SimdMath::Float4 (&values)[3], const SimdMath::Float3& barycentrics);
+} // namespace VisibilityBuffer
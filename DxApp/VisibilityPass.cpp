@@ -0,0 +1,175 @@
+#include "VisibilityPass.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "RendererForwards.h"
+#include "DxHelpers.h"
+#include "Scene.h"
+#include "ShaderCache.h"
+#include "VisibilityBuffer.h"
+
+using namespace Microsoft::WRL;
+
+namespace
+{
+	// Referenced by the PSO desc until the asynchronous PSO creation is done.
+	// Same vertex buffers as the geometry pass, only the position is read.
+	const D3D12_INPUT_ELEMENT_DESC kInputElementDescs[] = {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+	};
+}
+
+VisibilityPass::VisibilityPass(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache)
+{
+	Initialize(device, shaderCache, pipelineStateCache);
+}
+
+void VisibilityPass::Initialize(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache)
+{
+	CreateRootSignature(device);
+	CreatePipelineStateObject(shaderCache, pipelineStateCache);
+
+	m_cbvSrvUavDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+void VisibilityPass::CreateResources(ID3D12Device* device, GpuHeapAllocator& heapAllocator, uint32_t windowWidth,
+	uint32_t windowHeight)
+{
+	D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {};
+	rtvHeapDesc.NumDescriptors = 1;
+	rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+	rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+	DxVerify(device->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&m_rtvHeap)));
+
+	const auto resourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(kRtFormat, windowWidth, windowHeight,
+		1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+
+	m_allocation = heapAllocator.CreateResource(GpuHeapCategory::RenderTargets, resourceDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, m_renderTarget);
+	m_renderTarget->SetName(L"VisibilityPass::VisibilityRt");
+	device->CreateRenderTargetView(m_renderTarget.Get(), nullptr, m_rtvHeap->GetCPUDescriptorHandleForHeapStart());
+}
+
+void VisibilityPass::DestroyResources(GpuHeapAllocator& heapAllocator)
+{
+	m_renderTarget.Reset();
+	heapAllocator.Free(m_allocation);
+}
+
+void VisibilityPass::Setup(ID3D12GraphicsCommandList* commandList) const
+{
+	commandList->SetPipelineState(m_pipelineStateObject.get().Get());
+	commandList->SetGraphicsRootSignature(m_rootSignature.Get());
+}
+
+void VisibilityPass::Draw(ID3D12GraphicsCommandList* commandList, CD3DX12_GPU_DESCRIPTOR_HANDLE rootParameters, Scene* scene) const
+{
+	commandList->OMSetStencilRef(kGeometryStencilRef);
+	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	// The object index of the visibility ids is the slot, the ids have no room for the slots past the limit
+	const auto& objectMeshes = scene->GetObjectMeshes();
+	const uint32_t objectsCount = std::min(scene->GetObjectSlotsCount(), VisibilityBuffer::kMaxObjectsCount);
+	for (uint32_t objectIndex = 0; objectIndex < objectsCount; objectIndex++)
+	{
+		if (!scene->IsObjectDrawn(objectIndex))
+			continue;
+
+		const auto& mesh = scene->GetMesh(objectMeshes[objectIndex]);
+		assert(mesh.GetIndicesCount() / 3 <= VisibilityBuffer::kMaxTrianglesCount);
+
+		commandList->SetGraphicsRootDescriptorTable(0,
+			CD3DX12_GPU_DESCRIPTOR_HANDLE(rootParameters, objectIndex, m_cbvSrvUavDescriptorSize));
+		commandList->SetGraphicsRoot32BitConstant(1, objectIndex, 0);
+
+		commandList->IASetVertexBuffers(0, 1, &mesh.GetVertexBufferView());
+		commandList->IASetIndexBuffer(&mesh.GetIndexBufferView());
+
+		commandList->DrawIndexedInstanced(mesh.GetIndicesCount(), 1, 0, 0, 0);
+	}
+}
+
+void VisibilityPass::CreateRootSignature(ID3D12Device* device)
+{
+	// Same object CBV table as the geometry pass
+	D3D12_DESCRIPTOR_RANGE descriptorRanges[1] = {};
+	descriptorRanges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+	descriptorRanges[0].NumDescriptors = 1;
+	descriptorRanges[0].BaseShaderRegister = 0;
+	descriptorRanges[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+	descriptorRanges[0].RegisterSpace = 0;
+
+	D3D12_ROOT_DESCRIPTOR_TABLE descriptorTable = {};
+	descriptorTable.NumDescriptorRanges = 1;
+	descriptorTable.pDescriptorRanges = descriptorRanges;
+
+	D3D12_ROOT_PARAMETER rootParameters[2] = {};
+	rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+	rootParameters[0].DescriptorTable = descriptorTable;
+	rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+
+	// Object index
+	rootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	rootParameters[1].Constants.ShaderRegister = 1;
+	rootParameters[1].Constants.RegisterSpace = 0;
+	rootParameters[1].Constants.Num32BitValues = 1;
+	rootParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
+	rootSignatureDesc.Init(_countof(rootParameters), rootParameters, 0, nullptr,
+		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+	ComPtr<ID3DBlob> signature;
+	ComPtr<ID3DBlob> error;
+
+	DxVerify(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature,
+		&error));
+	DxVerify(device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
+		IID_PPV_ARGS(&m_rootSignature)));
+	m_rootSignatureHash = PipelineStateCache::HashRootSignature(signature->GetBufferPointer(), signature->GetBufferSize());
+}
+
+void VisibilityPass::CreatePipelineStateObject(ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache)
+{
+	const D3D12_SHADER_BYTECODE vertexShader = shaderCache.GetShader("VisibilityPass_vs");
+	const D3D12_SHADER_BYTECODE pixelShader = shaderCache.GetShader("VisibilityPass_ps");
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+
+	psoDesc.InputLayout = { kInputElementDescs, _countof(kInputElementDescs) };
+	psoDesc.pRootSignature = m_rootSignature.Get();
+	psoDesc.VS = vertexShader;
+	psoDesc.PS = pixelShader;
+
+	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+	psoDesc.RasterizerState.FrontCounterClockwise = true;
+	psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+
+	// Same depth and stencil as the geometry pass, the stencil masks the pixels the resolve pass writes
+	psoDesc.DepthStencilState.DepthEnable = true;
+	psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+	psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+	psoDesc.DepthStencilState.StencilEnable = true;
+	psoDesc.DepthStencilState.StencilReadMask = 0xff;
+	psoDesc.DepthStencilState.StencilWriteMask = 0xff;
+	psoDesc.DepthStencilState.FrontFace.StencilFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+	psoDesc.DepthStencilState.FrontFace.StencilPassOp = D3D12_STENCIL_OP_REPLACE;
+	psoDesc.DepthStencilState.FrontFace.StencilFailOp = D3D12_STENCIL_OP_REPLACE;
+	psoDesc.DepthStencilState.FrontFace.StencilDepthFailOp = D3D12_STENCIL_OP_KEEP;
+	psoDesc.DepthStencilState.BackFace.StencilFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+	psoDesc.DepthStencilState.BackFace.StencilPassOp = D3D12_STENCIL_OP_REPLACE;
+	psoDesc.DepthStencilState.BackFace.StencilFailOp = D3D12_STENCIL_OP_REPLACE;
+	psoDesc.DepthStencilState.BackFace.StencilDepthFailOp = D3D12_STENCIL_OP_KEEP;
+
+	psoDesc.DSVFormat = kDsFormat;
+	psoDesc.SampleMask = UINT_MAX;
+	psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+
+	psoDesc.NumRenderTargets = 1;
+	psoDesc.RTVFormats[0] = kRtFormat;
+	psoDesc.SampleDesc.Count = 1;
+
+	m_pipelineStateObject = pipelineStateCache.CreateGraphicsPipelineStateAsync(psoDesc, m_rootSignatureHash);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include <d3d12.h>
+#include <d3dx12.h>
+#include <wrl.h>
+
+#include "GpuHeapAllocator.h"
+#include "PipelineStateCache.h"
+
+
+class Scene;
+class ShaderCache;
+
+// Rasterizes the scene to depth and a 32 bit object/triangle id per pixel, see VisibilityBuffer.h for the packing
+class VisibilityPass
+{
+public:
+	static constexpr DXGI_FORMAT kRtFormat = DXGI_FORMAT_R32_UINT;
+
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
+
+	VisibilityPass() = default;
+	explicit VisibilityPass(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache);
+	// PSO is created asynchronously, the first Setup waits for it
+	void Initialize(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache);
+	~VisibilityPass() = default;
+
+	void CreateResources(ID3D12Device* device, GpuHeapAllocator& heapAllocator, uint32_t windowWidth,
+		uint32_t windowHeight);
+	void DestroyResources(GpuHeapAllocator& heapAllocator);
+
+	void Setup(ID3D12GraphicsCommandList* commandList) const;
+	// rootParameters are the geometry pass descriptor tables, one object CBV each
+	void Draw(ID3D12GraphicsCommandList* commandList, CD3DX12_GPU_DESCRIPTOR_HANDLE rootParameters, Scene* scene) const;
+
+	[[nodiscard]] ID3D12Resource* GetRt() const { return m_renderTarget.Get(); }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12RootSignature> m_rootSignature;
+	uint64_t m_rootSignatureHash = 0;
+	PipelineStateFuture m_pipelineStateObject;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_renderTarget;
+	GpuAllocation m_allocation;
+
+	uint32_t m_cbvSrvUavDescriptorSize = 0;
+
+	void CreateRootSignature(ID3D12Device* device);
+	void CreatePipelineStateObject(ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache);
+};
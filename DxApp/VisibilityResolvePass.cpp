@@ -0,0 +1,218 @@
+#include "VisibilityResolvePass.h"
+
+#include "RendererForwards.h"
+#include "DxHelpers.h"
+#include "GeometryPassObjectConstantBuffer.h"
+#include "Scene.h"
+#include "ShaderCache.h"
+
+using namespace Microsoft::WRL;
+
+namespace
+{
+	// Visibility buffer and objects data
+	constexpr uint32_t kFrameSrvCount = 2;
+	// Vertex and index buffer
+	constexpr uint32_t kObjectSrvCount = 2;
+	// Null views of the slots drawing nothing have one element
+	constexpr uint32_t kNullViewSize = sizeof(uint32_t);
+
+	void CreateRawBufferView(ID3D12Device* device, ID3D12Resource* buffer, uint32_t size,
+		D3D12_CPU_DESCRIPTOR_HANDLE descriptor)
+	{
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = size / sizeof(uint32_t);
+		srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_RAW;
+		device->CreateShaderResourceView(buffer, &srvDesc, descriptor);
+	}
+}
+
+VisibilityResolvePass::VisibilityResolvePass(ID3D12Device* device, ShaderCache& shaderCache,
+	PipelineStateCache& pipelineStateCache, GBufferMode gBufferMode)
+{
+	Initialize(device, shaderCache, pipelineStateCache, gBufferMode);
+}
+
+void VisibilityResolvePass::Initialize(ID3D12Device* device, ShaderCache& shaderCache,
+	PipelineStateCache& pipelineStateCache, GBufferMode gBufferMode)
+{
+	CreateRootSignature(device);
+	CreatePipelineStateObject(shaderCache, pipelineStateCache, gBufferMode);
+
+	m_cbvSrvUavDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+void VisibilityResolvePass::SetScene(Scene* scene)
+{
+	m_scene = scene;
+}
+
+void VisibilityResolvePass::SetupRootResourceDescriptors(ID3D12Device* device,
+	CD3DX12_CPU_DESCRIPTOR_HANDLE rootParameters, ID3D12Resource* visibilityBuffer, ID3D12Resource* objectsData,
+	uint32_t objectsDataSize) const
+{
+	device->CreateShaderResourceView(visibilityBuffer, nullptr, rootParameters);
+	rootParameters.Offset(1, m_cbvSrvUavDescriptorSize);
+
+	CreateRawBufferView(device, objectsData, objectsDataSize, rootParameters);
+	rootParameters.Offset(1, m_cbvSrvUavDescriptorSize);
+
+	// Indexed by the object index of the visibility id, the slot
+	for (uint32_t slot = 0; slot < m_objectsCapacity; slot++)
+	{
+		SetupObjectDescriptors(device, rootParameters, slot);
+		rootParameters.Offset(kObjectSrvCount, m_cbvSrvUavDescriptorSize);
+	}
+}
+
+void VisibilityResolvePass::UpdateObjectDescriptors(ID3D12Device* device, CD3DX12_CPU_DESCRIPTOR_HANDLE rootParameters,
+	const std::vector<uint32_t>& slots) const
+{
+	for (const uint32_t slot : slots)
+	{
+		SetupObjectDescriptors(device,
+			CD3DX12_CPU_DESCRIPTOR_HANDLE(rootParameters, kFrameSrvCount + kObjectSrvCount * slot, m_cbvSrvUavDescriptorSize),
+			slot);
+	}
+}
+
+void VisibilityResolvePass::SetupObjectDescriptors(ID3D12Device* device, CD3DX12_CPU_DESCRIPTOR_HANDLE descriptors,
+	uint32_t slot) const
+{
+	// Null views for the slots drawing nothing
+	ID3D12Resource* vertexBuffer = nullptr;
+	ID3D12Resource* indexBuffer = nullptr;
+	if (slot < m_scene->GetObjectSlotsCount() && m_scene->IsObjectDrawn(slot))
+	{
+		const auto& mesh = m_scene->GetMesh(m_scene->GetObjectMeshes()[slot]);
+		vertexBuffer = mesh.GetVertexBuffer();
+		indexBuffer = mesh.GetIndexBuffer();
+	}
+
+	CreateRawBufferView(device, vertexBuffer,
+		vertexBuffer ? static_cast<uint32_t>(vertexBuffer->GetDesc().Width) : kNullViewSize, descriptors);
+	descriptors.Offset(1, m_cbvSrvUavDescriptorSize);
+
+	CreateRawBufferView(device, indexBuffer,
+		indexBuffer ? static_cast<uint32_t>(indexBuffer->GetDesc().Width) : kNullViewSize, descriptors);
+}
+
+void VisibilityResolvePass::Setup(ID3D12GraphicsCommandList* commandList) const
+{
+	commandList->SetPipelineState(m_pipelineStateObject.get().Get());
+	commandList->SetGraphicsRootSignature(m_rootSignature.Get());
+}
+
+void VisibilityResolvePass::Draw(ID3D12GraphicsCommandList* commandList,
+	CD3DX12_GPU_DESCRIPTOR_HANDLE rootParameters) const
+{
+	commandList->SetGraphicsRoot32BitConstant(0, GeometryPassObjectConstantBuffer::GetAlignedSize(), 0);
+	commandList->SetGraphicsRootDescriptorTable(1, rootParameters);
+
+	commandList->OMSetStencilRef(kGeometryStencilRef);
+	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	commandList->DrawInstanced(6, 1, 0, 0);
+}
+
+uint32_t VisibilityResolvePass::GetDescriptorTablesDescriptorsCount() const
+{
+	return kFrameSrvCount + kObjectSrvCount * m_objectsCapacity;
+}
+
+void VisibilityResolvePass::CreateRootSignature(ID3D12Device* device)
+{
+	D3D12_DESCRIPTOR_RANGE descriptorRanges[2] = {};
+	descriptorRanges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+	descriptorRanges[0].NumDescriptors = kFrameSrvCount;
+	descriptorRanges[0].BaseShaderRegister = 0;
+	descriptorRanges[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+	descriptorRanges[0].RegisterSpace = 0;
+
+	// Mesh buffers of the scene, the count changes with the scene
+	descriptorRanges[1].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+	descriptorRanges[1].NumDescriptors = UINT_MAX;
+	descriptorRanges[1].BaseShaderRegister = 0;
+	descriptorRanges[1].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+	descriptorRanges[1].RegisterSpace = 1;
+
+	D3D12_ROOT_DESCRIPTOR_TABLE descriptorTable = {};
+	descriptorTable.NumDescriptorRanges = 2;
+	descriptorTable.pDescriptorRanges = descriptorRanges;
+
+	D3D12_ROOT_PARAMETER rootParameters[2] = {};
+	// Objects data stride
+	rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	rootParameters[0].Constants.ShaderRegister = 0;
+	rootParameters[0].Constants.RegisterSpace = 0;
+	rootParameters[0].Constants.Num32BitValues = 1;
+	rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	rootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+	rootParameters[1].DescriptorTable = descriptorTable;
+	rootParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
+	rootSignatureDesc.Init(_countof(rootParameters), rootParameters, 0, nullptr,
+		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+	ComPtr<ID3DBlob> signature;
+	ComPtr<ID3DBlob> error;
+
+	DxVerify(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature,
+		&error));
+	DxVerify(device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
+		IID_PPV_ARGS(&m_rootSignature)));
+	m_rootSignatureHash = PipelineStateCache::HashRootSignature(signature->GetBufferPointer(), signature->GetBufferSize());
+}
+
+void VisibilityResolvePass::CreatePipelineStateObject(ShaderCache& shaderCache,
+	PipelineStateCache& pipelineStateCache, GBufferMode gBufferMode)
+{
+	const uint32_t pixelShaderKey = gBufferMode == GBufferMode::Compact
+		? shaderCache.GetPermutationLayout("VisibilityResolvePass_ps").GetDefineKey("COMPACT_GBUFFER")
+		: 0;
+
+	// Fullscreen quad of the lighting pass
+	const D3D12_SHADER_BYTECODE vertexShader = shaderCache.GetShader("LightingPass_vs");
+	const D3D12_SHADER_BYTECODE pixelShader = shaderCache.GetShader("VisibilityResolvePass_ps", pixelShaderKey);
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+
+	psoDesc.InputLayout = { nullptr, 0 };
+	psoDesc.pRootSignature = m_rootSignature.Get();
+	psoDesc.VS = vertexShader;
+	psoDesc.PS = pixelShader;
+
+	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+	psoDesc.RasterizerState.FrontCounterClockwise = true;
+	psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+
+	// Only the pixels the visibility pass covered, depth stencil is bound read only
+	psoDesc.DepthStencilState.DepthEnable = false;
+	psoDesc.DepthStencilState.StencilEnable = true;
+	psoDesc.DepthStencilState.StencilReadMask = 0xff;
+	psoDesc.DepthStencilState.StencilWriteMask = 0;
+	psoDesc.DepthStencilState.FrontFace.StencilFunc = D3D12_COMPARISON_FUNC_EQUAL;
+	psoDesc.DepthStencilState.FrontFace.StencilPassOp = D3D12_STENCIL_OP_KEEP;
+	psoDesc.DepthStencilState.FrontFace.StencilFailOp = D3D12_STENCIL_OP_KEEP;
+	psoDesc.DepthStencilState.FrontFace.StencilDepthFailOp = D3D12_STENCIL_OP_KEEP;
+	psoDesc.DepthStencilState.BackFace.StencilFunc = D3D12_COMPARISON_FUNC_EQUAL;
+	psoDesc.DepthStencilState.BackFace.StencilPassOp = D3D12_STENCIL_OP_KEEP;
+	psoDesc.DepthStencilState.BackFace.StencilFailOp = D3D12_STENCIL_OP_KEEP;
+	psoDesc.DepthStencilState.BackFace.StencilDepthFailOp = D3D12_STENCIL_OP_KEEP;
+
+	psoDesc.DSVFormat = kDsFormat;
+	psoDesc.SampleMask = UINT_MAX;
+	psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+
+	psoDesc.NumRenderTargets = GBuffer::GetRtCount(gBufferMode);
+	memcpy(psoDesc.RTVFormats, GBuffer::GetRtFormats(gBufferMode), sizeof(DXGI_FORMAT) * psoDesc.NumRenderTargets);
+	psoDesc.SampleDesc.Count = 1;
+
+	m_pipelineStateObject = pipelineStateCache.CreateGraphicsPipelineStateAsync(psoDesc, m_rootSignatureHash);
+}
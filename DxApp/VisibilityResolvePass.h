@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <d3d12.h>
+#include <d3dx12.h>
+#include <wrl.h>
+
+#include "GBuffer.h"
+#include "PipelineStateCache.h"
+
+
+class Scene;
+class ShaderCache;
+
+// Fullscreen pass turning the visibility buffer into the GBuffer: fetches the triangle of every covered pixel,
+// interpolates its vertex attributes and writes the material as the geometry pass would
+class VisibilityResolvePass
+{
+public:
+	VisibilityResolvePass() = default;
+	explicit VisibilityResolvePass(ID3D12Device* device, ShaderCache& shaderCache,
+		PipelineStateCache& pipelineStateCache, GBufferMode gBufferMode);
+	// PSO is created asynchronously, the first Setup waits for it
+	void Initialize(ID3D12Device* device, ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache,
+		GBufferMode gBufferMode);
+	~VisibilityResolvePass() = default;
+
+	void SetScene(Scene* scene);
+	// Object slots the tables have views for, past the slots count of the scene
+	void SetObjectsCapacity(uint32_t objectsCapacity) { m_objectsCapacity = objectsCapacity; }
+	// objectsData holds the geometry pass constant buffers of the frame, objectsDataSize bytes from its start
+	void SetupRootResourceDescriptors(ID3D12Device* device, CD3DX12_CPU_DESCRIPTOR_HANDLE rootParameters,
+		ID3D12Resource* visibilityBuffer, ID3D12Resource* objectsData, uint32_t objectsDataSize) const;
+	// Rewrites the views of the slots in the tables at rootParameters, the GPU must be done with them
+	void UpdateObjectDescriptors(ID3D12Device* device, CD3DX12_CPU_DESCRIPTOR_HANDLE rootParameters,
+		const std::vector<uint32_t>& slots) const;
+	void Setup(ID3D12GraphicsCommandList* commandList) const;
+	void Draw(ID3D12GraphicsCommandList* commandList, CD3DX12_GPU_DESCRIPTOR_HANDLE rootParameters) const;
+
+	[[nodiscard]] uint32_t GetDescriptorTablesDescriptorsCount() const;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12RootSignature> m_rootSignature;
+	uint64_t m_rootSignatureHash = 0;
+	PipelineStateFuture m_pipelineStateObject;
+	Scene* m_scene = nullptr;
+	uint32_t m_objectsCapacity = 0;
+
+	uint32_t m_cbvSrvUavDescriptorSize = 0;
+
+	void SetupObjectDescriptors(ID3D12Device* device, CD3DX12_CPU_DESCRIPTOR_HANDLE descriptors, uint32_t slot) const;
+	void CreateRootSignature(ID3D12Device* device);
+	void CreatePipelineStateObject(ShaderCache& shaderCache, PipelineStateCache& pipelineStateCache,
+		GBufferMode gBufferMode);
+};
@@ -0,0 +1,55 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+
+WorkerPool::WorkerPool(uint32_t threadsCount)
+{
+	if (threadsCount == 0)
+		threadsCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+	m_threads.reserve(threadsCount);
+	for (uint32_t i = 0; i < threadsCount; i++)
+		m_threads.emplace_back([this]() { Run(); });
+}
+
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_isStopping = true;
+	}
+	m_condition.notify_all();
+	for (auto& thread : m_threads)
+		thread.join();
+}
+
+
+void WorkerPool::Enqueue(std::function<void()> task)
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+	}
+	m_condition.notify_one();
+}
+
+
+void WorkerPool::Run()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock lock(m_mutex);
+			m_condition.wait(lock, [this]() { return m_isStopping || !m_tasks.empty(); });
+			// Stopping drains the queue first
+			if (m_tasks.empty())
+				return;
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+		}
+		task();
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+// Fixed set of threads taking the submitted tasks in submission order, however many are queued.
+// Tasks must not wait for other tasks of the pool. The destructor runs the queued tasks, then joins.
+class WorkerPool
+{
+public:
+	// 0 leaves a core of the hardware threads to the caller, one thread at least
+	explicit WorkerPool(uint32_t threadsCount = 0);
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+	~WorkerPool();
+
+	template <typename Function>
+	std::future<std::invoke_result_t<Function>> Submit(Function&& function)
+	{
+		// std::function needs a copyable callable
+		auto task = std::make_shared<std::packaged_task<std::invoke_result_t<Function>()>>(
+			std::forward<Function>(function));
+		auto future = task->get_future();
+		Enqueue([task]() { (*task)(); });
+		return future;
+	}
+
+	uint32_t GetThreadsCount() const { return static_cast<uint32_t>(m_threads.size()); }
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::deque<std::function<void()>> m_tasks;
+	bool m_isStopping = false;
+	std::vector<std::thread> m_threads;
+
+	void Enqueue(std::function<void()> task);
+	void Run();
+};
@@ -0,0 +1,224 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Brdf.h"
+
+
+using SimdMath::Float3;
+
+
+namespace
+{
+	constexpr float kGuard = -1.0f;
+
+	Float3 Normalize(const Float3& vector)
+	{
+		const float inverseLength = 1.0f / std::sqrt(vector.x * vector.x + vector.y * vector.y + vector.z * vector.z);
+		return Float3(vector.x * inverseLength, vector.y * inverseLength, vector.z * inverseLength);
+	}
+
+	bool IsNear(const Float3& value, const Float3& reference, float tolerance)
+	{
+		const auto isNear = [&](float a, float b) {
+			return std::abs(a - b) <= tolerance * std::max(1.0f, std::abs(b));
+		};
+		return isNear(value.x, reference.x) && isNear(value.y, reference.y) && isNear(value.z, reference.z);
+	}
+
+	// Structures of arrays behind Brdf::Samples, the brdf arrays are kGuard past the samples
+	struct SampleArrays
+	{
+		std::vector<float> vectors[5][3];
+		std::vector<float> roughness;
+		std::vector<float> brdf[3];
+
+		void Add(const Float3& n, const Float3& v, const Float3& l, const Float3& F0, const Float3& rho, float r)
+		{
+			const Float3* values[] = { &n, &v, &l, &F0, &rho };
+			for (uint32_t i = 0; i < std::size(values); i++)
+			{
+				vectors[i][0].push_back(values[i]->x);
+				vectors[i][1].push_back(values[i]->y);
+				vectors[i][2].push_back(values[i]->z);
+			}
+			roughness.push_back(r);
+		}
+
+		uint32_t GetCount() const { return static_cast<uint32_t>(roughness.size()); }
+
+		Brdf::Samples GetSamples(uint32_t count, uint32_t guardsCount)
+		{
+			Brdf::Samples samples;
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				samples.normal[c] = vectors[0][c].data();
+				samples.view[c] = vectors[1][c].data();
+				samples.light[c] = vectors[2][c].data();
+				samples.F0[c] = vectors[3][c].data();
+				samples.rho[c] = vectors[4][c].data();
+				brdf[c].assign(count + guardsCount, kGuard);
+				samples.brdf[c] = brdf[c].data();
+			}
+			samples.roughness = roughness.data();
+			samples.count = count;
+			return samples;
+		}
+
+		Float3 Get(const std::vector<float> (&arrays)[3], uint32_t i) const
+		{
+			return Float3(arrays[0][i], arrays[1][i], arrays[2][i]);
+		}
+
+		Float3 GetReference(uint32_t i) const
+		{
+			return Brdf::GetBrdf(Get(vectors[0], i), Get(vectors[1], i), Get(vectors[2], i), Get(vectors[3], i),
+				Get(vectors[4], i), roughness[i]);
+		}
+	};
+}
+
+
+TEST(BrdfTerms)
+{
+	const Float3 n(0.0f, 0.0f, 1.0f);
+	const Float3 F0(0.04f, 0.5f, 1.0f);
+
+	// Fresnel: F0 facing the light, 1 at and below the horizon
+	CHECK(IsNear(Brdf::GetFresnelReflectance(n, n, F0), F0, 1e-6f));
+	CHECK(IsNear(Brdf::GetFresnelReflectance(n, Float3(1.0f, 0.0f, 0.0f), F0), Float3(1.0f, 1.0f, 1.0f), 1e-6f));
+	CHECK(IsNear(Brdf::GetFresnelReflectance(n, Float3(0.0f, 0.6f, -0.8f), F0), Float3(1.0f, 1.0f, 1.0f), 1e-6f));
+
+	// Masking and shadowing: none along the microfacet normal, full when either direction is behind it
+	const Float3 m = Normalize(Float3(0.0f, 1.0f, 1.0f));
+	CHECK(std::abs(Brdf::GetMaskingShadowing(n, m, m, 0.7f) - 1.0f) < 1e-6f);
+	CHECK(std::abs(Brdf::GetMaskingShadowing(n, n, m, 0.0f) - 1.0f) < 1e-6f);
+	CHECK(Brdf::GetMaskingShadowing(n, Float3(0.0f, -1.0f, -0.1f), m, 0.7f) == 0.0f);
+	CHECK(Brdf::GetMaskingShadowing(Float3(0.0f, -1.0f, -0.1f), n, m, 0.7f) == 0.0f);
+	// More masking as the view leaves the microfacet normal
+	CHECK(Brdf::GetMaskingShadowing(n, Normalize(Float3(1.0f, 0.0f, 0.1f)), m, 0.7f) <
+		Brdf::GetMaskingShadowing(n, n, m, 0.7f));
+
+	// Normal distribution: 1 / (pi alpha^2) along the normal, 0 below the surface, and the projected
+	// microfacet area integrates to 1 over the hemisphere
+	for (const float roughness : { 0.2f, 0.5f, 1.0f })
+	{
+		const float peak = Brdf::GetNormalDistribution(n, n, roughness);
+		CHECK(std::abs(peak * Brdf::kPi * roughness * roughness - 1.0f) < 1e-5f);
+		CHECK(Brdf::GetNormalDistribution(n, Float3(0.0f, 0.6f, -0.8f), roughness) == 0.0f);
+
+		constexpr uint32_t kStepsCount = 20000;
+		const double step = 0.5 * Brdf::kPi / kStepsCount;
+		double integral = 0.0;
+		for (uint32_t i = 0; i < kStepsCount; i++)
+		{
+			const double theta = (i + 0.5) * step;
+			const Float3 direction(static_cast<float>(std::sin(theta)), 0.0f, static_cast<float>(std::cos(theta)));
+			integral += Brdf::GetNormalDistribution(n, direction, roughness) * std::cos(theta) * std::sin(theta) * step;
+		}
+		CHECK(std::abs(integral * 2.0 * Brdf::kPi - 1.0) < 1e-3);
+	}
+
+	// Without reflectance only the Lambertian term is left, with full reflectance only the peak specular
+	const Float3 rho(0.2f, 0.4f, 0.8f);
+	const Float3 lambert(rho.x / Brdf::kPi, rho.y / Brdf::kPi, rho.z / Brdf::kPi);
+	CHECK(IsNear(Brdf::GetBrdf(n, n, n, Float3(0.0f, 0.0f, 0.0f), rho, 0.5f), lambert, 1e-6f));
+	const float specular = 1.0f / (4.0f * Brdf::kPi * 0.5f * 0.5f);
+	CHECK(IsNear(Brdf::GetBrdf(n, n, n, Float3(1.0f, 1.0f, 1.0f), rho, 0.5f),
+		Float3(specular, specular, specular), 1e-5f));
+	// The light at the horizon is clamped away from the division by 0
+	const Float3 horizon = Brdf::GetBrdf(n, n, Float3(1.0f, 0.0f, 0.0f), F0, rho, 0.5f);
+	CHECK(std::isfinite(horizon.x) && std::isfinite(horizon.y) && std::isfinite(horizon.z));
+}
+
+
+TEST(BrdfEvaluate)
+{
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<float> signedDistribution(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> unitDistribution(0.0f, 1.0f);
+	const auto getUpperDirection = [&](const Float3& n) {
+		Float3 direction;
+		do
+		{
+			direction = Float3(signedDistribution(generator), signedDistribution(generator),
+				signedDistribution(generator));
+		} while (direction.x * direction.x + direction.y * direction.y + direction.z * direction.z < 1e-2f);
+		direction = Normalize(direction);
+		if (direction.x * n.x + direction.y * n.y + direction.z * n.z < 0.0f)
+			direction = Float3(-direction.x, -direction.y, -direction.z);
+		return direction;
+	};
+
+	// Random samples mixed with the edge cases: the light at and below the horizon, view and light along the
+	// normal, the roughness limits
+	const Float3 up(0.0f, 0.0f, 1.0f);
+	const Float3 edgeLights[] = { Float3(1.0f, 0.0f, 0.0f), Float3(0.0f, 0.6f, -0.8f), up };
+	const float edgeRoughness[] = { 0.05f, 1.0f };
+	SampleArrays arrays;
+	for (uint32_t i = 0; i < 48; i++)
+	{
+		const Float3 F0(unitDistribution(generator), unitDistribution(generator), unitDistribution(generator));
+		const Float3 rho(unitDistribution(generator), unitDistribution(generator), unitDistribution(generator));
+		if (i % 4 == 3)
+		{
+			const Float3& light = edgeLights[(i / 4) % std::size(edgeLights)];
+			arrays.Add(up, up, light, F0, rho, edgeRoughness[(i / 4) % std::size(edgeRoughness)]);
+			continue;
+		}
+		const Float3 n = Normalize(getUpperDirection(up));
+		arrays.Add(n, getUpperDirection(n), getUpperDirection(n), F0, rho, 0.05f + 0.95f * unitDistribution(generator));
+	}
+
+	// Every instruction set, the ones the CPU lacks fall back. The counts cover the tails of both widths.
+	constexpr uint32_t kGuardsCount = 16;
+	const uint32_t counts[] = { 0, 1, 7, 8, 9, 15, 16, 17, 31, 33, arrays.GetCount() };
+	for (uint32_t set = 0; set < static_cast<uint32_t>(Brdf::InstructionSet::Count); set++)
+	{
+		const auto instructionSet = static_cast<Brdf::InstructionSet>(set);
+		bool isValid = true;
+		for (const uint32_t count : counts)
+		{
+			const Brdf::Samples samples = arrays.GetSamples(count, kGuardsCount);
+			Brdf::Evaluate(samples, instructionSet);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const Float3 brdf = arrays.Get(arrays.brdf, i);
+				const Float3 reference = arrays.GetReference(i);
+				isValid &= std::isfinite(brdf.x) && std::isfinite(brdf.y) && std::isfinite(brdf.z);
+				// pow(x, 5) is the only difference of the wide path
+				isValid &= IsNear(brdf, reference, 1e-4f);
+			}
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				isValid &= std::all_of(arrays.brdf[c].begin() + count, arrays.brdf[c].end(),
+					[](float value) { return value == kGuard; });
+			}
+		}
+		if (!isValid)
+			std::printf("BRDF %s differs from the scalar functions\n", Brdf::GetName(instructionSet));
+		CHECK(isValid);
+	}
+}
+
+
+TEST(BrdfBenchmark)
+{
+	const uint32_t samplesCount = context.GetSize(4096, 65536);
+	const auto report = Brdf::Benchmark(samplesCount);
+	for (uint32_t set = 0; set < static_cast<uint32_t>(Brdf::InstructionSet::Count); set++)
+	{
+		const auto& result = report.results[set];
+		if (!result.isSupported)
+			continue;
+		std::printf("BRDF %s: %.1f M samples/s per core\n", Brdf::GetName(static_cast<Brdf::InstructionSet>(set)),
+			result.samplesPerSecond / 1e6);
+	}
+
+	CHECK(report.samplesCount == samplesCount);
+	CHECK(report.results[static_cast<uint32_t>(Brdf::InstructionSet::Scalar)].isSupported);
+}
@@ -0,0 +1,377 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "Bvh.h"
+#include "SceneQuery.h"
+
+
+using namespace SimdMath;
+
+
+namespace
+{
+	Aabb MakeBox(const Float3& center, float size)
+	{
+		return { Float3(center.x - size, center.y - size, center.z - size),
+			Float3(center.x + size, center.y + size, center.z + size) };
+	}
+
+	std::vector<Aabb> MakeBoxes(uint32_t count, float sceneSize, std::mt19937& generator)
+	{
+		std::uniform_real_distribution<float> positionDistribution(0.0f, sceneSize);
+		std::uniform_real_distribution<float> sizeDistribution(0.5f, 5.0f);
+		std::vector<Aabb> boxes;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const Float3 center(positionDistribution(generator), positionDistribution(generator),
+				positionDistribution(generator));
+			boxes.push_back(MakeBox(center, sizeDistribution(generator)));
+		}
+		return boxes;
+	}
+
+	bool Contains(const Aabb& outer, const Aabb& inner)
+	{
+		const Aabb merged = AabbMerge(outer, inner);
+		return memcmp(&merged, &outer, sizeof(Aabb)) == 0;
+	}
+
+	// Every item in one leaf, inside the bounds of its ancestors
+	bool IsValidTree(const Bvh& tree, const std::vector<Aabb>& boxes)
+	{
+		if (tree.GetItemsCount() != boxes.size())
+			return false;
+		if (tree.GetNodes().empty())
+			return boxes.empty();
+
+		std::vector<uint32_t> leafCounts(boxes.size(), 0);
+		std::vector<std::pair<uint32_t, uint32_t>> stack = { { 0, UINT32_MAX } };
+		bool areBoundsValid = true;
+		while (!stack.empty())
+		{
+			const auto [node, parent] = stack.back();
+			stack.pop_back();
+			const Bvh::Node& value = tree.GetNodes()[node];
+			if (parent != UINT32_MAX)
+				areBoundsValid &= Contains(tree.GetNodes()[parent].bounds, value.bounds);
+			if (value.itemsCount == 0)
+			{
+				stack.push_back({ value.first, node });
+				stack.push_back({ value.first + 1, node });
+				continue;
+			}
+			for (uint32_t i = value.first; i < value.first + value.itemsCount; i++)
+			{
+				const uint32_t item = tree.GetItems()[i];
+				leafCounts[item]++;
+				areBoundsValid &= Contains(value.bounds, boxes[item]);
+			}
+		}
+		return areBoundsValid
+			&& std::all_of(leafCounts.begin(), leafCounts.end(), [](uint32_t count) { return count == 1; });
+	}
+
+	// Against testing every box, in increasing order
+	bool CullsAsBoxes(const Bvh& tree, const std::vector<Aabb>& boxes, const Float4* planes, uint32_t planesCount)
+	{
+		std::vector<uint32_t> visibleItems;
+		tree.Cull(boxes, planes, planesCount, visibleItems);
+		std::sort(visibleItems.begin(), visibleItems.end());
+		std::vector<uint32_t> expectedItems;
+		for (uint32_t i = 0; i < boxes.size(); i++)
+		{
+			const Vector minCorner = LoadFloat3(boxes[i].minCorner);
+			const Vector maxCorner = LoadFloat3(boxes[i].maxCorner);
+			if (AabbIntersectsPlanes((minCorner + maxCorner) * 0.5f, (maxCorner - minCorner) * 0.5f, planes,
+				planesCount))
+			{
+				expectedItems.push_back(i);
+			}
+		}
+		return visibleItems == expectedItems;
+	}
+}
+
+
+TEST(BvhEmpty)
+{
+	const std::vector<Aabb> noBoxes;
+	const Float4 plane(1.0f, 0.0f, 0.0f, 0.0f);
+	std::vector<uint32_t> visibleItems = { 7 };
+
+	Bvh bvh;
+	bvh.Build(noBoxes);
+	CHECK(bvh.GetNodes().empty() && bvh.GetItems().empty() && bvh.GetItemsCount() == 0);
+	CHECK(bvh.GetSahCost() == 0.0f);
+	bvh.Cull(noBoxes, &plane, 1, visibleItems);
+	CHECK(visibleItems.empty());
+	bvh.Refit(noBoxes, {});
+	bvh.RefitAll(noBoxes);
+	bvh.Insert(noBoxes);
+	CHECK(bvh.GetNodes().empty() && IsValidTree(bvh, noBoxes));
+
+	// Inserting into an empty tree builds it
+	std::mt19937 generator(0);
+	const std::vector<Aabb> boxes = MakeBoxes(20, 100.0f, generator);
+	bvh.Insert(boxes);
+	CHECK(IsValidTree(bvh, boxes) && bvh.GetSahCost() > 0.0f);
+	bvh.Build(noBoxes);
+	CHECK(bvh.GetNodes().empty() && bvh.GetItemsCount() == 0);
+
+	// A single box and boxes of no volume, the surface areas are 0
+	const std::vector<Aabb> single = { MakeBox(Float3(1.0f, 2.0f, 3.0f), 1.0f) };
+	bvh.Build(single);
+	CHECK(bvh.GetNodes().size() == 1 && IsValidTree(bvh, single));
+	const std::vector<Aabb> points(20, MakeBox(Float3(1.0f, 2.0f, 3.0f), 0.0f));
+	bvh.Build(points);
+	CHECK(IsValidTree(bvh, points) && bvh.GetSahCost() == 0.0f);
+	CHECK(CullsAsBoxes(bvh, points, &plane, 1));
+
+	// The dynamic tree grows from nothing and shrinks back to it
+	DynamicBvh dynamicBvh;
+	dynamicBvh.Build(noBoxes);
+	dynamicBvh.Update(noBoxes, {});
+	CHECK(dynamicBvh.GetBvh().GetItemsCount() == 0 && dynamicBvh.GetCostRatio() == 1.0f);
+	dynamicBvh.Update(boxes, {});
+	CHECK(IsValidTree(dynamicBvh.GetBvh(), boxes));
+	dynamicBvh.Update(noBoxes, {});
+	CHECK(dynamicBvh.GetBvh().GetNodes().empty() && !dynamicBvh.IsRebuilding());
+
+	// Queries over an empty scene find nothing
+	SceneQuery query;
+	query.BuildMeshes({});
+	const std::vector<uint32_t> noObjects;
+	ObjectTransforms::Transforms noModels;
+	query.SetInstances(dynamicBvh.GetBvh(), noBoxes, noObjects, noModels, {});
+	SceneQuery::Ray ray;
+	ray.origin = Float3(0.0f, 0.0f, 0.0f);
+	ray.direction = Float3(1.0f, 0.0f, 0.0f);
+	CHECK(query.RayFirstHit(ray).object == SceneQuery::kNoObject && !query.RayAnyHit(ray));
+	std::vector<uint32_t> objects = { 7 };
+	query.OverlapBox(MakeBox(Float3(0.0f, 0.0f, 0.0f), 1e6f), objects);
+	CHECK(objects.empty());
+}
+
+
+TEST(BvhCull)
+{
+	std::mt19937 generator(0);
+	constexpr float kSceneSize = 1000.0f;
+	std::vector<Aabb> boxes = MakeBoxes(5000, kSceneSize, generator);
+	Bvh bvh;
+	bvh.Build(boxes);
+	CHECK(IsValidTree(bvh, boxes));
+
+	Float4x4 viewProjection;
+	StoreFloat4x4(viewProjection, MatrixLookAtRH(VectorZero(), VectorReplicate(kSceneSize * 0.5f),
+		VectorSet(0.0f, 1.0f, 0.0f, 0.0f)) * MatrixPerspectiveFovRH(ConvertToRadians(45.0f), 1.0f, 1.0f, kSceneSize));
+	Float4 frustum[6];
+	ExtractFrustumPlanes(viewProjection, frustum);
+	CHECK(CullsAsBoxes(bvh, boxes, frustum, 6));
+
+	// Planes parallel to the faces of the boxes, some of the boxes touch them
+	for (uint32_t i = 0; i < 16; i++)
+		boxes[i] = { Float3(100.0f + i, 0.0f, 0.0f), Float3(200.0f, 10.0f, 10.0f) };
+	std::vector<uint32_t> movedItems(16);
+	for (uint32_t i = 0; i < 16; i++)
+		movedItems[i] = i;
+	bvh.Refit(boxes, movedItems);
+	CHECK(IsValidTree(bvh, boxes));
+	const Float4 slab[] = { Float4(1.0f, 0.0f, 0.0f, -200.0f), Float4(-1.0f, 0.0f, 0.0f, 100.0f) };
+	CHECK(CullsAsBoxes(bvh, boxes, slab, 2));
+	const Float4 face(0.0f, -1.0f, 0.0f, 0.0f);
+	CHECK(CullsAsBoxes(bvh, boxes, &face, 1));
+
+	// A few moving items refit along their paths, a half of them every node
+	std::uniform_real_distribution<float> velocityDistribution(-5.0f, 5.0f);
+	for (const uint32_t movingCount : { 10u, 2500u })
+	{
+		movedItems.resize(movingCount);
+		for (uint32_t i = 0; i < movingCount; i++)
+			movedItems[i] = i * 2;
+		for (uint32_t frame = 0; frame < 10; frame++)
+		{
+			for (const uint32_t item : movedItems)
+			{
+				const Vector velocity = VectorSet(velocityDistribution(generator), velocityDistribution(generator),
+					velocityDistribution(generator), 0.0f);
+				StoreFloat3(boxes[item].minCorner, LoadFloat3(boxes[item].minCorner) + velocity);
+				StoreFloat3(boxes[item].maxCorner, LoadFloat3(boxes[item].maxCorner) + velocity);
+			}
+			bvh.Refit(boxes, movedItems);
+		}
+		CHECK(IsValidTree(bvh, boxes));
+		CHECK(CullsAsBoxes(bvh, boxes, frustum, 6));
+	}
+
+	// Boxes sharing a center take the split of any half
+	const std::vector<Aabb> sameCenters(100, MakeBox(Float3(5.0f, 5.0f, 5.0f), 1.0f));
+	bvh.Build(sameCenters);
+	CHECK(IsValidTree(bvh, sameCenters) && bvh.GetNodes().size() > 1);
+	CHECK(CullsAsBoxes(bvh, sameCenters, frustum, 6));
+}
+
+
+TEST(BvhRayParallelToSlab)
+{
+	// A quad in the plane x = 5, y from 0 to 1 and z from 1.7 to 2.3: its bounds have no width along x. The
+	// traversal clamps the zero components of the directions, the slab tests stay finite.
+	StaticBatching::Vertex vertices[4] = {};
+	vertices[0].position = Float4(5.0f, 0.0f, 2.3f, 1.0f);
+	vertices[1].position = Float4(5.0f, 1.0f, 2.3f, 1.0f);
+	vertices[2].position = Float4(5.0f, 0.0f, 1.7f, 1.0f);
+	vertices[3].position = Float4(5.0f, 1.0f, 1.7f, 1.0f);
+	const uint32_t indices[] = { 0, 1, 2, 3, 2, 1 };
+	StaticBatching::Source mesh;
+	mesh.vertices = vertices;
+	mesh.verticesCount = 4;
+	mesh.indices = indices;
+	mesh.indicesCount = 6;
+
+	SceneQuery query;
+	query.BuildMeshes({ mesh });
+	const std::vector<Aabb> worldBounds = { { Float3(5.0f, 0.0f, 1.7f), Float3(5.0f, 1.0f, 2.3f) } };
+	const std::vector<uint32_t> objectMeshes = { 0 };
+	ObjectTransforms::Transforms models;
+	models.Resize(1);
+	Float4x4 identity;
+	StoreFloat4x4(identity, MatrixIdentity());
+	models.Set(0, identity);
+	DynamicBvh bvh;
+	bvh.Build(worldBounds);
+	query.SetInstances(bvh.GetBvh(), worldBounds, objectMeshes, models, {});
+
+	struct Case
+	{
+		SceneQuery::Ray ray;
+		bool isHit;
+	};
+	const auto makeRay = [](const Float3& origin, const Float3& direction, float maxDistance = FLT_MAX) {
+		SceneQuery::Ray ray;
+		ray.origin = origin;
+		ray.direction = direction;
+		ray.maxDistance = maxDistance;
+		return ray;
+	};
+	const Float3 alongX(1.0f, 0.0f, 0.0f);
+	const Case cases[] = {
+		// Parallel to the y and z slabs, inside them
+		{ makeRay(Float3(0.0f, 0.5f, 2.0f), alongX), true },
+		{ makeRay(Float3(10.0f, 0.5f, 2.0f), Float3(-1.0f, 0.0f, 0.0f)), true },
+		{ makeRay(Float3(0.0f, 0.5f, 2.0f), Float3(1.0f, -0.0f, -0.0f)), true },
+		// Outside them, on either side
+		{ makeRay(Float3(0.0f, 0.5f, 2.5f), alongX), false },
+		{ makeRay(Float3(0.0f, 0.5f, 1.5f), alongX), false },
+		{ makeRay(Float3(0.0f, -0.5f, 2.0f), alongX), false },
+		{ makeRay(Float3(0.0f, 1.5f, 2.0f), Float3(1.0f, -0.0f, 0.0f)), false },
+		// Right on the faces of the bounds, through the edges of the quad
+		{ makeRay(Float3(0.0f, 0.5f, 2.3f), alongX), true },
+		{ makeRay(Float3(0.0f, 0.5f, 1.7f), alongX), true },
+		{ makeRay(Float3(0.0f, 0.5f, 2.3f), Float3(1.0f, -0.0f, -0.0f)), true },
+		// Short of the quad
+		{ makeRay(Float3(0.0f, 0.5f, 2.0f), alongX, 4.5f), false },
+		// Inside the slab of no width, in the plane of the quad
+		{ makeRay(Float3(5.0f, -1.0f, 2.0f), Float3(0.0f, 1.0f, 0.0f)), false },
+	};
+
+	std::vector<SceneQuery::Ray> rays;
+	bool isSingleValid = true;
+	for (const Case& test : cases)
+	{
+		const SceneQuery::Hit hit = query.RayFirstHit(test.ray);
+		const bool isHit = hit.object != SceneQuery::kNoObject;
+		isSingleValid &= isHit == test.isHit && query.RayAnyHit(test.ray) == test.isHit;
+		isSingleValid &= !isHit || (hit.object == 0 && std::abs(hit.distance - 5.0f) < 1e-5f);
+		rays.push_back(test.ray);
+	}
+	CHECK(isSingleValid);
+
+	// In packets, the last one partial
+	std::vector<SceneQuery::Hit> hits(rays.size());
+	query.RayFirstHit(rays.data(), static_cast<uint32_t>(rays.size()), hits.data());
+	std::unique_ptr<bool[]> anyHits(new bool[rays.size()]);
+	query.RayAnyHit(rays.data(), static_cast<uint32_t>(rays.size()), anyHits.get());
+	bool isPacketValid = true;
+	for (uint32_t i = 0; i < rays.size(); i++)
+		isPacketValid &= (hits[i].object != SceneQuery::kNoObject) == cases[i].isHit && anyHits[i] == cases[i].isHit;
+	CHECK(isPacketValid);
+}
+
+
+TEST(BvhBenchmark)
+{
+	const uint32_t itemsCount = context.GetSize(10000, 100000);
+	constexpr uint32_t kFramesCount = 30;
+	const auto report = DynamicBvh::Benchmark(itemsCount, kFramesCount);
+	for (const auto& result : report.results)
+	{
+		std::printf("BVH of %u items, %.0f%% moving: refit %.3f ms per frame, rebuild %.2f ms, SAH cost x%.2f after %u "
+			"frames\n", report.itemsCount, result.movingShare * 100.0f, result.refitMilliseconds,
+			result.rebuildMilliseconds, result.costRatio, report.framesCount);
+		CHECK(result.costRatio > 0.0f);
+	}
+
+	CHECK(report.itemsCount == itemsCount);
+	CHECK(!report.results.empty());
+}
+
+
+TEST(BvhInsert)
+{
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> positionDistribution(0.0f, 200.0f);
+	const auto addBox = [&](std::vector<Aabb>& boxes) {
+		const Float3 center(positionDistribution(generator), positionDistribution(generator),
+			positionDistribution(generator));
+		boxes.push_back({ Float3(center.x - 1.0f, center.y - 1.0f, center.z - 1.0f),
+			Float3(center.x + 1.0f, center.y + 1.0f, center.z + 1.0f) });
+	};
+
+	std::vector<Aabb> boxes;
+	for (uint32_t i = 0; i < 1000; i++)
+		addBox(boxes);
+	DynamicBvh bvh;
+	bvh.SetRebuildCostRatio(FLT_MAX);
+	bvh.Build(boxes);
+	const uint32_t builtNodesCount = static_cast<uint32_t>(bvh.GetBvh().GetNodes().size());
+
+	// Objects added one per frame and in bursts, the tree grows in place
+	std::vector<uint32_t> movedItems;
+	for (uint32_t frame = 0; frame < 50; frame++)
+	{
+		movedItems.clear();
+		for (uint32_t i = 0; i < (frame % 10 == 0 ? 100u : 1u); i++)
+		{
+			movedItems.push_back(static_cast<uint32_t>(boxes.size()));
+			addBox(boxes);
+		}
+		bvh.Update(boxes, movedItems);
+	}
+	const Bvh& tree = bvh.GetBvh();
+	CHECK(tree.GetItemsCount() == boxes.size());
+	CHECK(tree.GetNodes().size() > builtNodesCount);
+	CHECK(bvh.GetRebuildsCount() == 0 && !bvh.IsRebuilding());
+
+	CHECK(IsValidTree(tree, boxes));
+
+	// The added items raised the cost, the next rebuild covers them
+	const float costRatio = bvh.GetCostRatio();
+	std::printf("BVH of %zu items, %zu of them inserted: SAH cost x%.2f\n", boxes.size(), boxes.size() - 1000,
+		costRatio);
+	CHECK(costRatio > 1.0f);
+	bvh.SetRebuildCostRatio(1.0f);
+	movedItems.clear();
+	bvh.Update(boxes, movedItems);
+	CHECK(bvh.IsRebuilding());
+	while (bvh.GetRebuildsCount() == 0)
+		bvh.Update(boxes, movedItems);
+	CHECK(bvh.GetBvh().GetItemsCount() == boxes.size());
+	CHECK(bvh.GetCostRatio() <= 1.0f + 1e-3f);
+}
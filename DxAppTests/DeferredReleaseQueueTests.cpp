@@ -0,0 +1,76 @@
+#include "Test.h"
+
+#include <vector>
+
+#include "DeferredReleaseQueue.h"
+
+
+namespace
+{
+	// Fence of the frames in flight, moved by the test instead of a GPU
+	struct SimulatedFence
+	{
+		uint64_t nextValue = 1;
+		uint64_t completedValue = 0;
+
+		uint64_t Signal() { return nextValue++; }
+	};
+}
+
+
+TEST(DeferredReleaseQueue)
+{
+	SimulatedFence fence;
+	std::vector<uint32_t> released;
+	{
+		DeferredReleaseQueue queue;
+		const auto enqueue = [&](uint64_t fenceValue, uint32_t id) {
+			queue.Enqueue(fenceValue, [&released, id]() { released.push_back(id); });
+		};
+
+		const uint64_t firstFrame = fence.Signal();
+		enqueue(firstFrame, 0);
+		enqueue(firstFrame, 1);
+		const uint64_t secondFrame = fence.Signal();
+		const uint64_t thirdFrame = fence.Signal();
+		enqueue(thirdFrame, 3);
+		// Out of fence order, runs before the third frame ones
+		enqueue(secondFrame, 2);
+		CHECK(queue.GetSize() == 4);
+
+		// Nothing before the GPU passes the fence
+		CHECK(queue.Process(fence.completedValue) == 0);
+		CHECK(released.empty());
+
+		fence.completedValue = firstFrame;
+		CHECK(queue.Process(fence.completedValue) == 2);
+		CHECK((released == std::vector<uint32_t>{ 0, 1 }));
+		// Processing the same value again releases nothing more
+		CHECK(queue.Process(fence.completedValue) == 0);
+
+		fence.completedValue = thirdFrame;
+		CHECK(queue.Process(fence.completedValue) == 2);
+		CHECK((released == std::vector<uint32_t>{ 0, 1, 2, 3 }));
+		CHECK(queue.GetSize() == 0);
+
+		// A release may enqueue another one, kept until its own fence
+		const uint64_t fourthFrame = fence.Signal();
+		queue.Enqueue(fourthFrame, [&]() {
+			released.push_back(4);
+			enqueue(fence.Signal(), 5);
+		});
+		fence.completedValue = fourthFrame;
+		CHECK(queue.Process(fence.completedValue) == 1);
+		CHECK(released.size() == 5 && queue.GetSize() == 1);
+
+		// Shutdown, the GPU is idle and the rest goes in fence order
+		enqueue(fence.Signal(), 6);
+		queue.Flush();
+		CHECK(queue.GetSize() == 0);
+		CHECK((released == std::vector<uint32_t>{ 0, 1, 2, 3, 4, 5, 6 }));
+
+		enqueue(fence.Signal(), 7);
+		// The destructor flushes
+	}
+	CHECK(released.size() == 8 && released.back() == 7);
+}
@@ -0,0 +1,90 @@
+#include "Test.h"
+
+#include <cstdio>
+#include <numeric>
+#include <vector>
+
+#include "DrawOrder.h"
+
+
+using namespace SimdMath;
+
+
+namespace
+{
+	// Unit boxes in a row along the view direction, every one hiding most of the ones behind it
+	std::vector<DrawOrder::DrawItem> CreateRow(uint32_t count)
+	{
+		std::vector<DrawOrder::DrawItem> items(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			auto& item = items[i];
+			item.boundsMin = Float3(-1.0f, -1.0f, -1.0f);
+			item.boundsMax = Float3(1.0f, 1.0f, 1.0f);
+			StoreFloat4x4(item.model, MatrixTranslation(0.0f, 0.0f, -3.0f * static_cast<float>(i)));
+			item.verticesCount = 24;
+		}
+		return items;
+	}
+
+	void GetCamera(Float4x4& view, Float4x4& viewProjection)
+	{
+		const Matrix viewMatrix = MatrixLookAtRH(VectorSet(0.0f, 0.5f, 10.0f, 1.0f), VectorSet(0.0f, 0.0f, -10.0f, 1.0f),
+			VectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		StoreFloat4x4(view, viewMatrix);
+		StoreFloat4x4(viewProjection, MatrixMultiply(viewMatrix,
+			MatrixPerspectiveFovRH(ConvertToRadians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f)));
+	}
+}
+
+
+TEST(DrawOrderFrontToBack)
+{
+	const auto items = CreateRow(8);
+	Float4x4 view;
+	Float4x4 viewProjection;
+	GetCamera(view, viewProjection);
+
+	std::vector<uint32_t> order;
+	DrawOrder::SortFrontToBack(items, view, order);
+	std::vector<uint32_t> expectedOrder(items.size());
+	std::iota(expectedOrder.begin(), expectedOrder.end(), 0);
+	CHECK(order == expectedOrder);
+
+	const std::vector<uint32_t> backToFront(expectedOrder.rbegin(), expectedOrder.rend());
+	const auto frontToBackEstimate = DrawOrder::EstimateOverdraw(items, order, viewProjection);
+	const auto backToFrontEstimate = DrawOrder::EstimateOverdraw(items, backToFront, viewProjection);
+	std::printf("Overdraw of %zu boxes in a row: %g front to back, %g back to front\n", items.size(),
+		frontToBackEstimate.GetOverdraw(), backToFrontEstimate.GetOverdraw());
+
+	// The order changes what is shaded, not what is covered or rasterized
+	CHECK(frontToBackEstimate.coveredPixelsCount > 0);
+	CHECK(frontToBackEstimate.coveredPixelsCount == backToFrontEstimate.coveredPixelsCount);
+	CHECK(frontToBackEstimate.rasterizedPixelsCount == backToFrontEstimate.rasterizedPixelsCount);
+	CHECK(frontToBackEstimate.verticesCount == 8 * 24);
+	CHECK(frontToBackEstimate.shadedPixelsCount < backToFrontEstimate.shadedPixelsCount);
+	CHECK(frontToBackEstimate.shadedPixelsCount >= frontToBackEstimate.coveredPixelsCount);
+	CHECK(backToFrontEstimate.shadedPixelsCount <= backToFrontEstimate.rasterizedPixelsCount);
+	CHECK(backToFrontEstimate.GetOverdraw() > 1.5f);
+}
+
+
+TEST(DrawOrderSingleBox)
+{
+	const auto items = CreateRow(1);
+	Float4x4 view;
+	Float4x4 viewProjection;
+	GetCamera(view, viewProjection);
+
+	// The front faces of a box cover every pixel once
+	const auto estimate = DrawOrder::EstimateOverdraw(items, { 0 }, viewProjection);
+	CHECK(estimate.coveredPixelsCount > 0);
+	CHECK(estimate.rasterizedPixelsCount == estimate.coveredPixelsCount);
+	CHECK(estimate.shadedPixelsCount == estimate.coveredPixelsCount);
+	CHECK(estimate.GetOverdraw() == 1.0f);
+
+	// Without overdraw the pre-pass only adds work
+	constexpr uint32_t kScreenPixelsCount = 1920 * 1080;
+	const auto cost = DrawOrder::EstimateDepthPrePassCost(estimate, 16, 4, kScreenPixelsCount);
+	CHECK(!cost.PaysOff());
+}
@@ -0,0 +1,168 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "DrawSortKey.h"
+
+
+namespace
+{
+	// The order of std::stable_sort by key, ties in the input order
+	bool IsStableOrder(const std::vector<DrawSortKey::SortItem>& input,
+		const std::vector<DrawSortKey::SortItem>& sorted)
+	{
+		auto expected = input;
+		std::stable_sort(expected.begin(), expected.end(),
+			[](const DrawSortKey::SortItem& a, const DrawSortKey::SortItem& b) { return a.key < b.key; });
+		return std::equal(expected.begin(), expected.end(), sorted.begin(), sorted.end(),
+			[](const DrawSortKey::SortItem& a, const DrawSortKey::SortItem& b) {
+				return a.key == b.key && a.drawIndex == b.drawIndex;
+			});
+	}
+
+	bool SortsStably(DrawSortKey::RadixSorter& sorter, const std::vector<DrawSortKey::SortItem>& items)
+	{
+		auto sorted = items;
+		sorter.Sort(sorted);
+		return IsStableOrder(items, sorted);
+	}
+}
+
+
+TEST(DrawSortKeyEncoding)
+{
+	using namespace DrawSortKey;
+
+	Fields fields;
+	fields.pass = Pass::Forward;
+	fields.pipeline = 1023;
+	fields.material = 513;
+	fields.mesh = 65535;
+	fields.depthBucket = 0xabcdef;
+	const Fields decoded = Decode(Encode(fields));
+	CHECK(decoded.pass == fields.pass && decoded.pipeline == fields.pipeline && decoded.material == fields.material);
+	CHECK(decoded.mesh == fields.mesh && decoded.depthBucket == fields.depthBucket);
+
+	// Wider values are masked to their field and do not leak into the next one
+	Fields wide;
+	wide.mesh = 0x12345;
+	wide.depthBucket = 0xff000001;
+	const Fields masked = Decode(Encode(wide));
+	CHECK(masked.mesh == 0x2345 && masked.depthBucket == 1 && masked.material == 0);
+
+	// A more significant field outweighs every less significant one
+	Fields low;
+	low.mesh = 65535;
+	low.depthBucket = 0xffffff;
+	Fields high;
+	high.material = 1;
+	CHECK(Encode(low) < Encode(high));
+	Fields prePass = low;
+	prePass.pass = Pass::DepthPrePass;
+	prePass.pipeline = 1023;
+	CHECK(Encode(prePass) < Encode(Fields()));
+
+	CHECK(QuantizeDepth(0.1f, 0.1f, 100.0f) == 0);
+	CHECK(QuantizeDepth(100.0f, 0.1f, 100.0f) == (1u << kDepthBucketBits) - 1);
+	// Clamped out of the clip planes
+	CHECK(QuantizeDepth(-5.0f, 0.1f, 100.0f) == 0);
+	CHECK(QuantizeDepth(1e6f, 0.1f, 100.0f) == (1u << kDepthBucketBits) - 1);
+	CHECK(QuantizeDepth(10.0f, 0.1f, 100.0f) < QuantizeDepth(10.5f, 0.1f, 100.0f));
+}
+
+
+TEST(DrawSortKeyRadixSort)
+{
+	using DrawSortKey::SortItem;
+
+	DrawSortKey::RadixSorter sorter;
+	std::vector<SortItem> empty;
+	sorter.Sort(empty);
+	CHECK(empty.empty());
+	CHECK(SortsStably(sorter, { { 42, 0 } }));
+
+	// Every key equal: every digit is skipped, the input order stays
+	std::vector<SortItem> equalKeys(100);
+	for (uint32_t i = 0; i < equalKeys.size(); i++)
+		equalKeys[i] = { 0x0123456789abcdefull, i };
+	CHECK(SortsStably(sorter, equalKeys));
+
+	// Few distinct keys, the duplicates keep their input order
+	std::mt19937 generator(0);
+	std::vector<SortItem> duplicates(1000);
+	for (uint32_t i = 0; i < duplicates.size(); i++)
+		duplicates[i] = { static_cast<uint64_t>(generator() % 5) << 40, i };
+	CHECK(SortsStably(sorter, duplicates));
+
+	// Keys differing in the top and the bottom digit only, an odd and an even number of sorted digits
+	std::vector<SortItem> extremes;
+	for (uint32_t i = 0; i < 64; i++)
+		extremes.push_back({ (static_cast<uint64_t>(generator() % 3) << 56) | (generator() % 3), i });
+	CHECK(SortsStably(sorter, extremes));
+	std::vector<SortItem> topDigit;
+	for (uint32_t i = 0; i < 64; i++)
+		topDigit.push_back({ static_cast<uint64_t>(63 - i) << 56, i });
+	CHECK(SortsStably(sorter, topDigit));
+	topDigit.push_back({ ~0ull, 64 });
+	topDigit.push_back({ 0, 65 });
+	CHECK(SortsStably(sorter, topDigit));
+
+	// Random full width keys, the scratch buffer is reused between sizes
+	for (const uint32_t count : { 1000u, 10u, 5000u })
+	{
+		std::vector<SortItem> items(count);
+		for (uint32_t i = 0; i < count; i++)
+			items[i] = { (static_cast<uint64_t>(generator()) << 32) | generator(), i };
+		CHECK(SortsStably(sorter, items));
+	}
+}
+
+
+TEST(DrawSortKeyStateChanges)
+{
+	using namespace DrawSortKey;
+
+	CHECK(CountStateChanges({}).GetTotal() == 0);
+
+	Fields fields;
+	fields.pipeline = 3;
+	fields.material = 7;
+	fields.mesh = 11;
+	// The first draw sets every state, the same state again sets nothing
+	std::vector<SortItem> items = { { Encode(fields), 0 } };
+	fields.depthBucket = 5;
+	items.push_back({ Encode(fields), 1 });
+	StateChanges changes = CountStateChanges(items);
+	CHECK(changes.pipelinesCount == 1 && changes.materialsCount == 1 && changes.meshesCount == 1);
+
+	// Another pass needs another pipeline even with the same pipeline index
+	fields.pass = Pass::Forward;
+	items.push_back({ Encode(fields), 2 });
+	fields.mesh = 12;
+	items.push_back({ Encode(fields), 3 });
+	changes = CountStateChanges(items);
+	CHECK(changes.pipelinesCount == 2 && changes.materialsCount == 1 && changes.meshesCount == 2);
+}
+
+
+TEST(DrawSortKeyBenchmark)
+{
+	constexpr uint32_t kPipelinesCount = 8;
+	constexpr uint32_t kMaterialsCount = 64;
+	constexpr uint32_t kMeshesCount = 1024;
+	const uint32_t drawsCount = context.GetSize(10000, 100000);
+	const uint32_t iterationsCount = context.GetSize(2, 10);
+	const auto report = DrawSortKey::Benchmark(drawsCount, kPipelinesCount, kMaterialsCount, kMeshesCount,
+		iterationsCount);
+	std::printf("Draw sort: %u keys in %.3f ms, std::stable_sort %.3f ms; state changes %u unsorted, %u sorted\n",
+		report.drawsCount, report.radixSortMilliseconds, report.stdSortMilliseconds,
+		report.unsortedStateChanges.GetTotal(), report.sortedStateChanges.GetTotal());
+
+	CHECK(report.drawsCount == drawsCount);
+	// Every state is bound once at most
+	CHECK(report.sortedStateChanges.pipelinesCount <= kPipelinesCount);
+	CHECK(report.sortedStateChanges.GetTotal() < report.unsortedStateChanges.GetTotal());
+}
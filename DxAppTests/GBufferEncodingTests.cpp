@@ -0,0 +1,62 @@
+#include "Test.h"
+
+#include <cmath>
+#include <cstdio>
+
+#include "GBufferEncoding.h"
+
+
+using namespace SimdMath;
+
+
+TEST(GBufferEncodingPrecision)
+{
+	// Typical camera, the position errors grow with the far / near ratio
+	const Matrix projection = MatrixPerspectiveFovRH(ConvertToRadians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+	Float4x4 viewProjection;
+	Float4x4 inverseViewProjection;
+	StoreFloat4x4(viewProjection, projection);
+	StoreFloat4x4(inverseViewProjection, MatrixInverse(projection));
+
+	const uint32_t samplesCount = context.GetSize(4096, 65536);
+	const auto precision = GBufferEncoding::MeasurePrecision(viewProjection, inverseViewProjection,
+		Float3(0.0f, 0.0f, 0.0f), samplesCount);
+	std::printf("GBuffer Compact precision: normal %g deg, roughness/metalness %g, relative position %g\n",
+		ConvertToDegrees(precision.maxNormalError), precision.maxRoughnessMetalnessError,
+		precision.maxRelativePositionError);
+
+	// 16 bit octahedral normals, 8 bit unorm roughness and metalness
+	CHECK(ConvertToDegrees(precision.maxNormalError) < 0.1f);
+	CHECK(precision.maxRoughnessMetalnessError <= 0.5f / 255.0f + 1e-6f);
+	CHECK(precision.maxRelativePositionError < 1e-3f);
+}
+
+
+TEST(GBufferEncodingRoundTrip)
+{
+	const Float3 normals[] = { Float3(0.0f, 0.0f, 1.0f), Float3(0.0f, 0.0f, -1.0f), Float3(1.0f, 0.0f, 0.0f),
+		Float3(0.0f, -1.0f, 0.0f), Float3(0.57735f, -0.57735f, -0.57735f) };
+	for (const Float3& normal : normals)
+	{
+		const Float3 decoded = GBufferEncoding::DecodeOctahedralNormal(
+			GBufferEncoding::UnpackSnorm16x2(GBufferEncoding::PackSnorm16x2(
+				GBufferEncoding::EncodeOctahedralNormal(normal))));
+		const float cosine = decoded.x * normal.x + decoded.y * normal.y + decoded.z * normal.z;
+		CHECK(cosine > 0.99999f);
+	}
+
+	for (uint32_t materialIndex = 0; materialIndex < 256; materialIndex++)
+	{
+		CHECK(GBufferEncoding::DecodeMaterialIndex(GBufferEncoding::EncodeMaterialIndex(materialIndex))
+			== materialIndex);
+	}
+
+	// Pixel center of the middle of the screen at the far plane, the camera looks along -z
+	const Matrix projection = MatrixPerspectiveFovRH(ConvertToRadians(60.0f), 1.0f, 1.0f, 100.0f);
+	Float4x4 inverseProjection;
+	StoreFloat4x4(inverseProjection, MatrixInverse(projection));
+	const Float3 position = GBufferEncoding::ReconstructPosition(Float2(0.5f, 0.5f), 1.0f, inverseProjection);
+	CHECK(std::abs(position.x) < 1e-3f);
+	CHECK(std::abs(position.y) < 1e-3f);
+	CHECK(std::abs(position.z + 100.0f) < 1e-2f);
+}
@@ -0,0 +1,175 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "InstanceCulling.h"
+
+
+using namespace SimdMath;
+
+
+namespace
+{
+	// Clip space test of the 8 corners of the world bounds: hidden when all of them are out of the same plane
+	bool IsVisibleReference(const InstanceCulling::Instance& instance, const Float4x4& viewProjection)
+	{
+		const Matrix viewProjectionMatrix = LoadFloat4x4(viewProjection);
+		uint32_t outsideMasks = 0x3f;
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			const Float3& c = instance.center;
+			const Float3& e = instance.extents;
+			Float4 clip;
+			StoreFloat4(clip, Vector4Transform(VectorSet((i & 1) ? c.x + e.x : c.x - e.x,
+				(i & 2) ? c.y + e.y : c.y - e.y, (i & 4) ? c.z + e.z : c.z - e.z, 1.0f), viewProjectionMatrix));
+			const uint32_t outsideMask = (clip.x < -clip.w ? 0x1 : 0) | (clip.x > clip.w ? 0x2 : 0)
+				| (clip.y < -clip.w ? 0x4 : 0) | (clip.y > clip.w ? 0x8 : 0) | (clip.z < 0.0f ? 0x10 : 0)
+				| (clip.z > clip.w ? 0x20 : 0);
+			outsideMasks &= outsideMask;
+		}
+		return outsideMasks == 0;
+	}
+
+	// What InstanceCulling_cs.hlsl writes: every group compacts its visible instances and appends them
+	// at the count, the groups in the order they finish
+	std::vector<InstanceCulling::IndirectCommand> CullByGroups(const std::vector<InstanceCulling::Instance>& instances,
+		const InstanceCulling::Frustum& frustum, uint64_t objectDataAddress, std::mt19937& generator)
+	{
+		const uint32_t instancesCount = static_cast<uint32_t>(instances.size());
+		const uint32_t groupsCount = (instancesCount + InstanceCulling::kGroupSize - 1) / InstanceCulling::kGroupSize;
+		std::vector<uint32_t> groupOrder(groupsCount);
+		std::iota(groupOrder.begin(), groupOrder.end(), 0);
+		std::shuffle(groupOrder.begin(), groupOrder.end(), generator);
+
+		std::vector<InstanceCulling::IndirectCommand> commands;
+		for (const uint32_t group : groupOrder)
+		{
+			const uint32_t end = std::min((group + 1) * InstanceCulling::kGroupSize, instancesCount);
+			for (uint32_t i = group * InstanceCulling::kGroupSize; i < end; i++)
+			{
+				if (!InstanceCulling::IsVisible(instances[i], frustum))
+					continue;
+				commands.push_back(instances[i].command);
+				commands.back().objectDataAddress = objectDataAddress + instances[i].objectDataOffset;
+			}
+		}
+		return commands;
+	}
+}
+
+
+TEST(InstanceCulling)
+{
+	const uint32_t instancesCount = context.GetSize(4096, 65536);
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<float> positionDistribution(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> scaleDistribution(0.1f, 5.0f);
+	std::uniform_real_distribution<float> angleDistribution(0.0f, k2Pi);
+
+	std::vector<InstanceCulling::Instance> instances(instancesCount);
+	for (uint32_t i = 0; i < instancesCount; i++)
+	{
+		const float scale = scaleDistribution(generator);
+		Float4x4 model;
+		StoreFloat4x4(model, MatrixMultiply(MatrixMultiply(MatrixScaling(scale, scale, scale),
+			MatrixRotationY(angleDistribution(generator))), MatrixTranslation(positionDistribution(generator),
+			positionDistribution(generator), positionDistribution(generator))));
+		InstanceCulling::IndirectCommand command;
+		command.indexCountPerInstance = 36;
+		command.instanceCount = 1;
+		command.startIndexLocation = i;
+		instances[i] = InstanceCulling::CreateInstance(Float3(-1.0f, -1.0f, -1.0f), Float3(1.0f, 1.0f, 1.0f), model,
+			i * 256, command);
+	}
+
+	Float4x4 viewProjection;
+	StoreFloat4x4(viewProjection, MatrixMultiply(MatrixLookAtRH(VectorSet(0.0f, 10.0f, 50.0f, 1.0f), VectorZero(),
+		VectorSet(0.0f, 1.0f, 0.0f, 0.0f)), MatrixPerspectiveFovRH(ConvertToRadians(60.0f), 16.0f / 9.0f, 0.1f,
+		100.0f)));
+
+	constexpr uint64_t kObjectDataAddress = 0x10000;
+	std::vector<InstanceCulling::IndirectCommand> commands;
+	const uint32_t visibleCount = InstanceCulling::Cull(instances, InstanceCulling::ExtractFrustum(viewProjection),
+		kObjectDataAddress, commands);
+	std::printf("Instance culling: %u of %u instances visible\n", visibleCount, instancesCount);
+
+	// Visible instances of the clip space test, compared with the reference as sorted lists
+	std::vector<InstanceCulling::IndirectCommand> expectedCommands;
+	for (uint32_t i = 0; i < instancesCount; i++)
+	{
+		if (!IsVisibleReference(instances[i], viewProjection))
+			continue;
+		expectedCommands.push_back(instances[i].command);
+		expectedCommands.back().objectDataAddress = kObjectDataAddress + instances[i].objectDataOffset;
+	}
+	commands.resize(visibleCount);
+	CHECK(visibleCount > 0 && visibleCount < instancesCount);
+	CHECK(visibleCount == expectedCommands.size());
+	CHECK(InstanceCulling::CountMismatches(commands, expectedCommands) == 0);
+}
+
+
+TEST(InstanceCullingGroupOrder)
+{
+	// Partial last group
+	const uint32_t instancesCount = 5 * InstanceCulling::kGroupSize + 17;
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> positionDistribution(-60.0f, 60.0f);
+
+	std::vector<InstanceCulling::Instance> instances(instancesCount);
+	for (uint32_t i = 0; i < instancesCount; i++)
+	{
+		Float4x4 model;
+		StoreFloat4x4(model, MatrixTranslation(positionDistribution(generator), positionDistribution(generator),
+			positionDistribution(generator)));
+		InstanceCulling::IndirectCommand command;
+		command.indexCountPerInstance = 36;
+		command.instanceCount = 1;
+		instances[i] = InstanceCulling::CreateInstance(Float3(-1.0f, -1.0f, -1.0f), Float3(1.0f, 1.0f, 1.0f), model,
+			i * 256, command);
+	}
+
+	Float4x4 viewProjection;
+	StoreFloat4x4(viewProjection, MatrixMultiply(MatrixLookAtRH(VectorSet(0.0f, 0.0f, 40.0f, 1.0f), VectorZero(),
+		VectorSet(0.0f, 1.0f, 0.0f, 0.0f)), MatrixPerspectiveFovRH(ConvertToRadians(60.0f), 1.0f, 0.1f, 100.0f)));
+	const auto frustum = InstanceCulling::ExtractFrustum(viewProjection);
+
+	constexpr uint64_t kObjectDataAddress = 0x10000;
+	std::vector<InstanceCulling::IndirectCommand> referenceCommands;
+	const uint32_t referenceCount = InstanceCulling::Cull(instances, frustum, kObjectDataAddress, referenceCommands);
+	referenceCommands.resize(referenceCount);
+	CHECK(referenceCount > 0 && referenceCount < instancesCount);
+
+	// Same set whatever the group order, not the same list
+	bool isSameOrder = true;
+	for (uint32_t run = 0; run < 4; run++)
+	{
+		auto commands = CullByGroups(instances, frustum, kObjectDataAddress, generator);
+		auto expectedCommands = referenceCommands;
+		isSameOrder &= commands == referenceCommands;
+		CHECK(commands.size() == referenceCount);
+		CHECK(InstanceCulling::CountMismatches(commands, expectedCommands) == 0);
+	}
+	CHECK(!isSameOrder);
+
+	// A changed, a missing and an extra command are each found
+	auto commands = CullByGroups(instances, frustum, kObjectDataAddress, generator);
+	auto expectedCommands = referenceCommands;
+	commands.front().indexCountPerInstance++;
+	CHECK(InstanceCulling::CountMismatches(commands, expectedCommands) == 2);
+	commands.pop_back();
+	CHECK(InstanceCulling::CountMismatches(commands, expectedCommands) == 3);
+	commands.push_back(commands.back());
+	CHECK(InstanceCulling::CountMismatches(commands, expectedCommands) == 4);
+
+	// Empty lists, and no instances at all
+	std::vector<InstanceCulling::IndirectCommand> none;
+	std::vector<InstanceCulling::IndirectCommand> noneReference;
+	CHECK(InstanceCulling::CountMismatches(none, noneReference) == 0);
+	CHECK(InstanceCulling::CountMismatches(none, expectedCommands) == referenceCount);
+	CHECK(CullByGroups({}, frustum, kObjectDataAddress, generator).empty());
+}
@@ -0,0 +1,152 @@
+#include "Test.h"
+
+#include <cstdio>
+#include <random>
+
+#include "ClusteredLightCulling.h"
+#include "LightSources.h"
+#include "TiledLightCulling.h"
+
+
+using namespace SimdMath;
+
+
+namespace
+{
+	constexpr uint32_t kScreenWidth = 1920;
+	constexpr uint32_t kScreenHeight = 1080;
+	constexpr float kNearClipPlane = 0.1f;
+	constexpr float kFarClipPlane = 100.0f;
+
+	// As many lights as the constant buffers hold, in the first 15 units in front of the camera of GetCamera where
+	// the validation places its surfaces. Dim enough to reach a few units with the square falloff.
+	LightSources CreateLightSources()
+	{
+		std::mt19937 generator(0);
+		std::uniform_real_distribution<float> xDistribution(-8.0f, 8.0f);
+		std::uniform_real_distribution<float> yDistribution(-2.0f, 10.0f);
+		std::uniform_real_distribution<float> zDistribution(15.0f, 28.0f);
+		std::uniform_real_distribution<float> directionDistribution(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> colorDistribution(0.01f, 0.04f);
+		std::uniform_real_distribution<float> angleDistribution(0.1f, 1.2f);
+
+		LightSources lightSources;
+		for (uint32_t i = 0; i < LightSources::kMaxPointLightSourcesCount; i++)
+		{
+			lightSources.AddPoint(PointLightSource(
+				Float4(colorDistribution(generator), colorDistribution(generator), colorDistribution(generator), 1.0f),
+				Float4(xDistribution(generator), yDistribution(generator), zDistribution(generator), 1.0f)));
+		}
+		for (uint32_t i = 0; i < LightSources::kMaxSpotLightSourcesCount; i++)
+		{
+			Float3 direction;
+			StoreFloat3(direction, Vector3Normalize(VectorSet(directionDistribution(generator),
+				directionDistribution(generator), directionDistribution(generator), 0.0f)));
+			lightSources.AddSpot(SpotLightSource(
+				Float4(colorDistribution(generator), colorDistribution(generator), colorDistribution(generator), 1.0f),
+				Float4(xDistribution(generator), yDistribution(generator), zDistribution(generator), 1.0f),
+				Float4(direction.x, direction.y, direction.z, 0.0f), angleDistribution(generator)));
+		}
+		return lightSources;
+	}
+
+	void GetCamera(Float4x4& view, Float4x4& projection)
+	{
+		StoreFloat4x4(view, MatrixLookAtRH(VectorSet(0.0f, 5.0f, 30.0f, 1.0f), VectorZero(),
+			VectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+		StoreFloat4x4(projection, MatrixPerspectiveFovRH(ConvertToRadians(60.0f),
+			static_cast<float>(kScreenWidth) / kScreenHeight, kNearClipPlane, kFarClipPlane));
+	}
+}
+
+
+TEST(TiledLightCulling)
+{
+	const LightSources lightSources = CreateLightSources();
+	Float4x4 view;
+	Float4x4 projection;
+	GetCamera(view, projection);
+	const Matrix viewProjectionMatrix = MatrixMultiply(LoadFloat4x4(view), LoadFloat4x4(projection));
+	Float4x4 viewProjection;
+	Float4x4 inverseViewProjection;
+	StoreFloat4x4(viewProjection, viewProjectionMatrix);
+	StoreFloat4x4(inverseViewProjection, MatrixInverse(viewProjectionMatrix));
+
+	const uint32_t tilesCount = context.GetSize(64, 256);
+	for (const bool linearFalloff : { false, true })
+	{
+		const auto report = TiledLightCulling::Validate(lightSources, linearFalloff, viewProjection,
+			inverseViewProjection, kScreenWidth, kScreenHeight, tilesCount);
+		std::printf("Tiled light culling, %s falloff: %u missed lights in %u tiles, %g lights per tile, %g reach the "
+			"tile pixels\n", linearFalloff ? "linear" : "square", report.missedLightsCount, report.tilesCount,
+			report.culledLightsCount, report.bruteForceLightsCount);
+
+		CHECK(report.tilesCount == tilesCount);
+		CHECK(report.bruteForceLightsCount > 0.0f);
+		CHECK(report.missedLightsCount == 0);
+		CHECK(report.culledLightsCount >= report.bruteForceLightsCount);
+	}
+}
+
+
+TEST(TiledLightCullingBounds)
+{
+	LightSources lightSources;
+	// Range of a white light, the same for both
+	lightSources.AddPoint(PointLightSource(Float4(1.0f, 1.0f, 1.0f, 1.0f), Float4(0.0f, 0.0f, 0.0f, 1.0f)));
+	lightSources.AddPoint(PointLightSource(Float4(1.0f, 1.0f, 1.0f, 1.0f), Float4(1000.0f, 0.0f, 0.0f, 1.0f)));
+	const float range = TiledLightCulling::GetLightRange(Float4(1.0f, 1.0f, 1.0f, 1.0f), false);
+	CHECK(range > 0.0f);
+
+	// A box touching the sphere of the first light
+	const TiledLightCulling::Aabb bounds = { Float3(range * 0.99f, -1.0f, -1.0f), Float3(range + 1.0f, 1.0f, 1.0f) };
+	const auto lights = TiledLightCulling::CullLights(lightSources, false, bounds);
+	CHECK(lights.size() == 1 && lights[0] == 0);
+
+	const TiledLightCulling::Aabb farBounds = { Float3(range * 1.01f, -1.0f, -1.0f),
+		Float3(range + 1.0f, 1.0f, 1.0f) };
+	CHECK(TiledLightCulling::CullLights(lightSources, false, farBounds).empty());
+}
+
+
+TEST(ClusteredLightCulling)
+{
+	const LightSources lightSources = CreateLightSources();
+	Float4x4 view;
+	Float4x4 projection;
+	GetCamera(view, projection);
+
+	const uint32_t samplesCount = context.GetSize(16384, 65536);
+	for (const bool linearFalloff : { false, true })
+	{
+		const auto report = ClusteredLightCulling::Validate(lightSources, linearFalloff, view, projection,
+			kNearClipPlane, kFarClipPlane, samplesCount);
+		std::printf("Clustered light culling, %s falloff: %u missed lights in %u samples, %g lights per cluster, %g "
+			"of the clusters lit\n", linearFalloff ? "linear" : "square", report.missedLightsCount,
+			report.samplesCount, report.lightsPerCluster, report.nonEmptyClustersRatio);
+
+		CHECK(report.samplesCount == samplesCount);
+		CHECK(report.missedLightsCount == 0);
+		CHECK(report.nonEmptyClustersRatio > 0.0f && report.nonEmptyClustersRatio < 1.0f);
+		CHECK(report.lightsPerCluster < static_cast<float>(lightSources.GetPointLightSourcesCount()
+			+ lightSources.GetSpotLightSourcesCount()));
+	}
+}
+
+
+TEST(ClusteredLightCullingSlices)
+{
+	const auto slicing = ClusteredLightCulling::GetDepthSlicing(kNearClipPlane, kFarClipPlane);
+	CHECK(ClusteredLightCulling::GetDepthSlice(kNearClipPlane * 0.5f, slicing) == 0);
+	CHECK(ClusteredLightCulling::GetDepthSlice(kFarClipPlane * 2.0f, slicing)
+		== ClusteredLightCulling::kClustersZ - 1);
+
+	// Increasing with the distance
+	uint32_t previousSlice = 0;
+	for (float distance = kNearClipPlane; distance < kFarClipPlane; distance *= 1.1f)
+	{
+		const uint32_t slice = ClusteredLightCulling::GetDepthSlice(distance, slicing);
+		CHECK(slice >= previousSlice);
+		previousSlice = slice;
+	}
+}
@@ -0,0 +1,36 @@
+#include "Test.h"
+
+#include <cstdio>
+
+#include "LightVolumes.h"
+
+
+TEST(LightVolumesCoverage)
+{
+	const uint32_t samplesCount = context.GetSize(16384, 65536);
+	const auto sphereReport = LightVolumes::ValidateSphere(LightVolumes::CreateSphere(
+		LightVolumes::kSphereRingsCount, LightVolumes::kSphereSegmentsCount), samplesCount);
+	const auto coneReport = LightVolumes::ValidateCone(LightVolumes::CreateCone(LightVolumes::kConeSegmentsCount),
+		samplesCount);
+	std::printf("Light volumes: sphere %u of %u samples uncovered, %g of the volume; cone %u of %u samples "
+		"uncovered, %g of the volume\n", sphereReport.uncoveredSamplesCount, sphereReport.samplesCount,
+		sphereReport.volumeRatio, coneReport.uncoveredSamplesCount, coneReport.samplesCount, coneReport.volumeRatio);
+
+	CHECK(sphereReport.uncoveredSamplesCount == 0);
+	CHECK(coneReport.uncoveredSamplesCount == 0);
+	// Bounding, but not much larger
+	CHECK(sphereReport.volumeRatio >= 1.0f && sphereReport.volumeRatio < 1.15f);
+	CHECK(coneReport.volumeRatio >= 1.0f && coneReport.volumeRatio < 1.05f);
+}
+
+
+TEST(LightVolumesCoarseMeshes)
+{
+	// The check itself catches meshes too coarse to bound their volume
+	const auto sphereReport = LightVolumes::ValidateSphere(LightVolumes::CreateSphere(2, 3), 4096);
+	const auto coneReport = LightVolumes::ValidateCone(LightVolumes::CreateCone(3), 4096);
+	CHECK(sphereReport.uncoveredSamplesCount == 0);
+	CHECK(coneReport.uncoveredSamplesCount == 0);
+	CHECK(sphereReport.volumeRatio > 1.5f);
+	CHECK(coneReport.volumeRatio > 1.5f);
+}
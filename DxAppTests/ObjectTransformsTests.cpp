@@ -0,0 +1,184 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "ObjectTransforms.h"
+#include "Shaders/Shared/SceneObjectData.h"
+
+
+using namespace SimdMath;
+
+
+namespace
+{
+	bool IsNear(const Float4x4& value, const Float4x4& expected, float tolerance)
+	{
+		for (uint32_t e = 0; e < 16; e++)
+		{
+			const float reference = expected.m[e / 4][e % 4];
+			if (std::abs(value.m[e / 4][e % 4] - reference) > tolerance * std::max(1.0f, std::abs(reference)))
+				return false;
+		}
+		return true;
+	}
+
+	bool IsEqual(const Float4x4& a, const Float4x4& b)
+	{
+		return std::memcmp(&a, &b, sizeof(Float4x4)) == 0;
+	}
+}
+
+
+TEST(ObjectTransformsStorage)
+{
+	ObjectTransforms::Transforms models;
+	models.Resize(3);
+	CHECK(models.GetCount() == 3);
+	Float4x4 model;
+	for (uint32_t e = 0; e < 16; e++)
+		model.m[e / 4][e % 4] = static_cast<float>(e + 1);
+	models.Set(1, model);
+	CHECK(IsEqual(models.Get(1), model));
+
+	// One array per element, the objects follow each other in it
+	bool isStructureOfArrays = true;
+	for (uint32_t e = 0; e < 16; e++)
+	{
+		const float* elements = models.GetElements(e);
+		isStructureOfArrays &= elements[0] == 0.0f && elements[1] == static_cast<float>(e + 1) && elements[2] == 0.0f;
+	}
+	CHECK(isStructureOfArrays);
+
+	// Growing keeps the models
+	models.Resize(20);
+	CHECK(models.GetCount() == 20 && IsEqual(models.Get(1), model));
+}
+
+
+TEST(ObjectTransformsKernels)
+{
+	using ShaderInterop::SceneObjectData;
+
+	constexpr uint32_t kModelsCount = 40;
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<float> positionDistribution(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> scaleDistribution(0.1f, 10.0f);
+	std::uniform_real_distribution<float> angleDistribution(0.0f, k2Pi);
+	ObjectTransforms::Transforms models;
+	models.Resize(kModelsCount);
+	for (uint32_t i = 0; i < kModelsCount; i++)
+	{
+		Float4x4 model;
+		StoreFloat4x4(model, MatrixScaling(scaleDistribution(generator), scaleDistribution(generator),
+			scaleDistribution(generator)) * MatrixRotationY(angleDistribution(generator))
+			* MatrixTranslation(positionDistribution(generator), positionDistribution(generator),
+				positionDistribution(generator)));
+		models.Set(i, model);
+	}
+	Float4x4 view;
+	Float4x4 projection;
+	StoreFloat4x4(view, MatrixLookAtRH(VectorSet(-150.0f, 50.0f, 20.0f, 1.0f), VectorZero(),
+		VectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+	StoreFloat4x4(projection, MatrixPerspectiveFovRH(ConvertToRadians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f));
+	Float4x4 vp;
+	StoreFloat4x4(vp, MatrixMultiply(LoadFloat4x4(view), LoadFloat4x4(projection)));
+
+	// Every kernel, the ones the CPU lacks fall back. The counts cover the AVX2 tail, the padding of the constant
+	// buffers is not written.
+	constexpr uint8_t kGuard = 0xcd;
+	const uint32_t stride = SceneObjectData::GetAlignedSize();
+	const uint32_t counts[] = { 0, 1, 7, 8, 9, 16, 17, 31, kModelsCount };
+	for (uint32_t k = 0; k < static_cast<uint32_t>(ObjectTransforms::Kernel::Count); k++)
+	{
+		const auto kernel = static_cast<ObjectTransforms::Kernel>(k);
+		bool isWritten = true;
+		bool isPaddingKept = true;
+		for (const uint32_t count : counts)
+		{
+			std::vector<uint8_t> buffer((kModelsCount + 1) * stride, kGuard);
+			uint8_t* destination = buffer.data() + (stride - reinterpret_cast<uintptr_t>(buffer.data()) % stride);
+			ObjectTransforms::WriteObjectData(models, count, view, projection, destination, stride, kernel);
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const uint8_t* object = destination + i * stride;
+				const auto& data = *reinterpret_cast<const SceneObjectData*>(object);
+				const Float4x4 model = models.Get(i);
+				isWritten &= IsEqual(data.model, model) && IsEqual(data.view, view);
+				isWritten &= IsEqual(data.projection, projection) && IsEqual(data.vp, vp);
+				Float4x4 mvp;
+				StoreFloat4x4(mvp, MatrixMultiply(LoadFloat4x4(model), LoadFloat4x4(vp)));
+				isWritten &= IsNear(data.mvp, mvp, 1e-5f);
+				isPaddingKept &= std::all_of(object + sizeof(SceneObjectData), object + stride,
+					[](uint8_t value) { return value == kGuard; });
+			}
+		}
+		if (!isWritten)
+			std::printf("Object transforms %s differ from SimdMath\n", ObjectTransforms::GetName(kernel));
+		CHECK(isWritten);
+		CHECK(isPaddingKept);
+	}
+}
+
+
+TEST(ObjectTransformsWriteCount)
+{
+	using ShaderInterop::SceneObjectData;
+
+	// Not a multiple of the 8 objects of the AVX2 kernel, the buffer fits count objects and a guard
+	constexpr uint32_t kModelsCount = 37;
+	constexpr uint32_t kCount = 21;
+	ObjectTransforms::Transforms models;
+	models.Resize(kModelsCount);
+	for (uint32_t i = 0; i < kModelsCount; i++)
+	{
+		Float4x4 model;
+		StoreFloat4x4(model, MatrixTranslation(static_cast<float>(i), 1.0f, 2.0f));
+		models.Set(i, model);
+	}
+	Float4x4 identity;
+	StoreFloat4x4(identity, MatrixIdentity());
+
+	constexpr uint8_t kGuard = 0xcd;
+	const uint32_t stride = SceneObjectData::GetAlignedSize();
+	for (uint32_t k = 0; k < static_cast<uint32_t>(ObjectTransforms::Kernel::Count); k++)
+	{
+		std::vector<uint8_t> buffer((kModelsCount + 1) * stride, kGuard);
+		uint8_t* destination = buffer.data() + (stride - reinterpret_cast<uintptr_t>(buffer.data()) % stride);
+		ObjectTransforms::WriteObjectData(models, kCount, identity, identity, destination, stride,
+			static_cast<ObjectTransforms::Kernel>(k));
+
+		bool isWritten = true;
+		for (uint32_t i = 0; i < kCount; i++)
+		{
+			const auto& data = *reinterpret_cast<const SceneObjectData*>(destination + i * stride);
+			isWritten &= data.model.m[3][0] == static_cast<float>(i) && data.mvp.m[3][0] == static_cast<float>(i);
+		}
+		CHECK(isWritten);
+		uint8_t* end = destination + kCount * stride;
+		CHECK(std::all_of(end, buffer.data() + buffer.size(), [](uint8_t value) { return value == kGuard; }));
+	}
+}
+
+
+TEST(ObjectTransformsBenchmark)
+{
+	const uint32_t objectsCount = context.GetSize(10000, 100000);
+	const auto report = ObjectTransforms::Benchmark(objectsCount);
+	for (uint32_t kernel = 0; kernel < static_cast<uint32_t>(ObjectTransforms::Kernel::Count); kernel++)
+	{
+		const auto& result = report.results[kernel];
+		if (!result.isSupported)
+			continue;
+		std::printf("Object transforms %s: %.0f objects/ms\n",
+			ObjectTransforms::GetName(static_cast<ObjectTransforms::Kernel>(kernel)), result.objectsPerMillisecond);
+	}
+
+	CHECK(report.objectsCount == objectsCount);
+	CHECK(report.results[static_cast<uint32_t>(ObjectTransforms::Kernel::Scalar)].isSupported);
+}
@@ -0,0 +1,347 @@
+#include "Test.h"
+
+#include <cstdio>
+#include <functional>
+#include <unordered_set>
+#include <vector>
+
+#include "PipelineStateKey.h"
+
+
+namespace
+{
+	// Mirrors of the D3D12 pipeline descriptions, the fields PipelineStateKey reads with the same names.
+	// Enums are plain integers here, they hash the same way.
+	struct ShaderBytecode
+	{
+		const void* pShaderBytecode = nullptr;
+		size_t BytecodeLength = 0;
+	};
+
+	struct SoDeclarationEntry
+	{
+		uint32_t Stream = 0;
+		const char* SemanticName = nullptr;
+		uint32_t SemanticIndex = 0;
+		uint8_t StartComponent = 0;
+		uint8_t ComponentCount = 0;
+		uint8_t OutputSlot = 0;
+	};
+
+	struct StreamOutputDesc
+	{
+		const SoDeclarationEntry* pSODeclaration = nullptr;
+		uint32_t NumEntries = 0;
+		const uint32_t* pBufferStrides = nullptr;
+		uint32_t NumStrides = 0;
+		uint32_t RasterizedStream = 0;
+	};
+
+	struct RenderTargetBlendDesc
+	{
+		int32_t BlendEnable = 0;
+		int32_t LogicOpEnable = 0;
+		int32_t SrcBlend = 2;
+		int32_t DestBlend = 1;
+		int32_t BlendOp = 1;
+		int32_t SrcBlendAlpha = 2;
+		int32_t DestBlendAlpha = 1;
+		int32_t BlendOpAlpha = 1;
+		int32_t LogicOp = 4;
+		uint8_t RenderTargetWriteMask = 0xf;
+	};
+
+	struct BlendDesc
+	{
+		int32_t AlphaToCoverageEnable = 0;
+		int32_t IndependentBlendEnable = 0;
+		RenderTargetBlendDesc RenderTarget[8];
+	};
+
+	struct RasterizerDesc
+	{
+		int32_t FillMode = 3;
+		int32_t CullMode = 3;
+		int32_t FrontCounterClockwise = 0;
+		int32_t DepthBias = 0;
+		float DepthBiasClamp = 0.0f;
+		float SlopeScaledDepthBias = 0.0f;
+		int32_t DepthClipEnable = 1;
+		int32_t MultisampleEnable = 0;
+		int32_t AntialiasedLineEnable = 0;
+		uint32_t ForcedSampleCount = 0;
+		int32_t ConservativeRaster = 0;
+	};
+
+	struct DepthStencilOpDesc
+	{
+		int32_t StencilFailOp = 1;
+		int32_t StencilDepthFailOp = 1;
+		int32_t StencilPassOp = 1;
+		int32_t StencilFunc = 8;
+	};
+
+	struct DepthStencilDesc
+	{
+		int32_t DepthEnable = 1;
+		int32_t DepthWriteMask = 1;
+		int32_t DepthFunc = 2;
+		int32_t StencilEnable = 0;
+		uint8_t StencilReadMask = 0xff;
+		uint8_t StencilWriteMask = 0xff;
+		DepthStencilOpDesc FrontFace;
+		DepthStencilOpDesc BackFace;
+	};
+
+	struct InputElementDesc
+	{
+		const char* SemanticName = nullptr;
+		uint32_t SemanticIndex = 0;
+		int32_t Format = 0;
+		uint32_t InputSlot = 0;
+		uint32_t AlignedByteOffset = 0;
+		int32_t InputSlotClass = 0;
+		uint32_t InstanceDataStepRate = 0;
+	};
+
+	struct InputLayoutDesc
+	{
+		const InputElementDesc* pInputElementDescs = nullptr;
+		uint32_t NumElements = 0;
+	};
+
+	struct SampleDescription
+	{
+		uint32_t Count = 1;
+		uint32_t Quality = 0;
+	};
+
+	struct GraphicsPipelineDesc
+	{
+		ShaderBytecode VS;
+		ShaderBytecode PS;
+		ShaderBytecode DS;
+		ShaderBytecode HS;
+		ShaderBytecode GS;
+		StreamOutputDesc StreamOutput;
+		BlendDesc BlendState;
+		uint32_t SampleMask = UINT32_MAX;
+		RasterizerDesc RasterizerState;
+		DepthStencilDesc DepthStencilState;
+		InputLayoutDesc InputLayout;
+		int32_t IBStripCutValue = 0;
+		int32_t PrimitiveTopologyType = 3;
+		uint32_t NumRenderTargets = 0;
+		int32_t RTVFormats[8] = {};
+		int32_t DSVFormat = 0;
+		SampleDescription SampleDesc;
+		uint32_t NodeMask = 0;
+		int32_t Flags = 0;
+	};
+
+	struct ComputePipelineDesc
+	{
+		ShaderBytecode CS;
+		uint32_t NodeMask = 0;
+		int32_t Flags = 0;
+	};
+
+	// A geometry pass like description, its pointed to data owned here so copies can be changed
+	struct GraphicsFixture
+	{
+		std::vector<uint8_t> vertexShader = { 0x44, 0x58, 0x42, 0x43, 1, 2, 3, 4 };
+		std::vector<uint8_t> pixelShader = { 0x44, 0x58, 0x42, 0x43, 5, 6, 7, 8 };
+		std::vector<InputElementDesc> inputElements;
+		GraphicsPipelineDesc desc;
+
+		GraphicsFixture()
+		{
+			inputElements.push_back({ "POSITION", 0, 6, 0, 0, 0, 0 });
+			inputElements.push_back({ "NORMAL", 0, 6, 0, 12, 0, 0 });
+			inputElements.push_back({ "TEXCOORD", 0, 16, 0, 24, 0, 0 });
+			Update();
+			desc.NumRenderTargets = 3;
+			desc.RTVFormats[0] = 28;
+			desc.RTVFormats[1] = 10;
+			desc.RTVFormats[2] = 24;
+			desc.DSVFormat = 40;
+		}
+
+		GraphicsFixture(const GraphicsFixture& other)
+			: vertexShader(other.vertexShader), pixelShader(other.pixelShader), inputElements(other.inputElements),
+			  desc(other.desc)
+		{
+			Update();
+		}
+
+		void Update()
+		{
+			desc.VS = { vertexShader.data(), vertexShader.size() };
+			desc.PS = { pixelShader.data(), pixelShader.size() };
+			desc.InputLayout = { inputElements.data(), static_cast<uint32_t>(inputElements.size()) };
+		}
+
+		uint64_t GetKey(uint64_t rootSignatureHash = 1) const
+		{
+			return PipelineStateKey::HashGraphicsDesc(desc, rootSignatureHash);
+		}
+	};
+}
+
+
+TEST(PipelineStateKeyEqualDescs)
+{
+	// Same contents at other addresses
+	const GraphicsFixture fixture;
+	const GraphicsFixture copy = fixture;
+	CHECK(copy.desc.VS.pShaderBytecode != fixture.desc.VS.pShaderBytecode);
+	CHECK(copy.GetKey() == fixture.GetKey());
+	CHECK(fixture.GetKey(1) != fixture.GetKey(2));
+
+	ComputePipelineDesc compute;
+	const uint8_t bytecode[] = { 0x44, 0x58, 0x42, 0x43, 9 };
+	const uint8_t sameBytecode[] = { 0x44, 0x58, 0x42, 0x43, 9 };
+	compute.CS = { bytecode, sizeof(bytecode) };
+	ComputePipelineDesc sameCompute = compute;
+	sameCompute.CS.pShaderBytecode = sameBytecode;
+	CHECK(PipelineStateKey::HashComputeDesc(compute, 1) == PipelineStateKey::HashComputeDesc(sameCompute, 1));
+	sameCompute.CS.BytecodeLength--;
+	CHECK(PipelineStateKey::HashComputeDesc(compute, 1) != PipelineStateKey::HashComputeDesc(sameCompute, 1));
+	sameCompute = compute;
+	sameCompute.Flags = 1;
+	CHECK(PipelineStateKey::HashComputeDesc(compute, 1) != PipelineStateKey::HashComputeDesc(sameCompute, 1));
+
+	CHECK(PipelineStateKey::GetName(0x0123456789abcdefull) == L"0123456789abcdef");
+	CHECK(PipelineStateKey::GetName(0x2a) == L"000000000000002a");
+}
+
+
+TEST(PipelineStateKeyFieldChanges)
+{
+	const GraphicsFixture fixture;
+	static const SoDeclarationEntry streamOutputEntries[] = { { 0, "SV_Position", 0, 0, 4, 0 } };
+	static const SoDeclarationEntry otherStreamOutputEntries[] = { { 0, "SV_Position", 0, 0, 3, 0 } };
+	static const uint32_t strides[] = { 16 };
+
+	using Change = std::function<void(GraphicsFixture&)>;
+	const std::vector<Change> changes = {
+		[](GraphicsFixture& f) { f.vertexShader.back()++; },
+		[](GraphicsFixture& f) { f.pixelShader.push_back(0); },
+		// Bytes moved from one shader to the next
+		[](GraphicsFixture& f) {
+			f.pixelShader.insert(f.pixelShader.begin(), f.vertexShader.back());
+			f.vertexShader.pop_back();
+		},
+		[](GraphicsFixture& f) { f.pixelShader.clear(); },
+		[](GraphicsFixture& f) { f.desc.GS = f.desc.PS; },
+		[](GraphicsFixture& f) {
+			f.desc.StreamOutput.pSODeclaration = streamOutputEntries;
+			f.desc.StreamOutput.NumEntries = 1;
+		},
+		[](GraphicsFixture& f) {
+			f.desc.StreamOutput.pSODeclaration = otherStreamOutputEntries;
+			f.desc.StreamOutput.NumEntries = 1;
+		},
+		[](GraphicsFixture& f) {
+			f.desc.StreamOutput.pBufferStrides = strides;
+			f.desc.StreamOutput.NumStrides = 1;
+		},
+		[](GraphicsFixture& f) { f.desc.StreamOutput.RasterizedStream = 1; },
+		[](GraphicsFixture& f) { f.desc.BlendState.AlphaToCoverageEnable = 1; },
+		[](GraphicsFixture& f) { f.desc.BlendState.IndependentBlendEnable = 1; },
+		[](GraphicsFixture& f) { f.desc.BlendState.RenderTarget[0].BlendEnable = 1; },
+		[](GraphicsFixture& f) { f.desc.BlendState.RenderTarget[0].LogicOpEnable = 1; },
+		[](GraphicsFixture& f) { f.desc.BlendState.RenderTarget[0].SrcBlend = 5; },
+		[](GraphicsFixture& f) { f.desc.BlendState.RenderTarget[0].DestBlend = 6; },
+		[](GraphicsFixture& f) { f.desc.BlendState.RenderTarget[0].BlendOp = 2; },
+		[](GraphicsFixture& f) { f.desc.BlendState.RenderTarget[0].SrcBlendAlpha = 5; },
+		[](GraphicsFixture& f) { f.desc.BlendState.RenderTarget[0].DestBlendAlpha = 6; },
+		[](GraphicsFixture& f) { f.desc.BlendState.RenderTarget[0].BlendOpAlpha = 2; },
+		[](GraphicsFixture& f) { f.desc.BlendState.RenderTarget[0].LogicOp = 5; },
+		[](GraphicsFixture& f) { f.desc.BlendState.RenderTarget[0].RenderTargetWriteMask = 0x7; },
+		[](GraphicsFixture& f) { f.desc.BlendState.RenderTarget[7].RenderTargetWriteMask = 0x7; },
+		[](GraphicsFixture& f) { f.desc.SampleMask = 1; },
+		[](GraphicsFixture& f) { f.desc.RasterizerState.FillMode = 2; },
+		[](GraphicsFixture& f) { f.desc.RasterizerState.CullMode = 1; },
+		[](GraphicsFixture& f) { f.desc.RasterizerState.FrontCounterClockwise = 1; },
+		[](GraphicsFixture& f) { f.desc.RasterizerState.DepthBias = 1; },
+		[](GraphicsFixture& f) { f.desc.RasterizerState.DepthBiasClamp = 0.5f; },
+		[](GraphicsFixture& f) { f.desc.RasterizerState.SlopeScaledDepthBias = 0.5f; },
+		[](GraphicsFixture& f) { f.desc.RasterizerState.DepthClipEnable = 0; },
+		[](GraphicsFixture& f) { f.desc.RasterizerState.MultisampleEnable = 1; },
+		[](GraphicsFixture& f) { f.desc.RasterizerState.AntialiasedLineEnable = 1; },
+		[](GraphicsFixture& f) { f.desc.RasterizerState.ForcedSampleCount = 4; },
+		[](GraphicsFixture& f) { f.desc.RasterizerState.ConservativeRaster = 1; },
+		[](GraphicsFixture& f) { f.desc.DepthStencilState.DepthEnable = 0; },
+		[](GraphicsFixture& f) { f.desc.DepthStencilState.DepthWriteMask = 0; },
+		[](GraphicsFixture& f) { f.desc.DepthStencilState.DepthFunc = 4; },
+		[](GraphicsFixture& f) { f.desc.DepthStencilState.StencilEnable = 1; },
+		[](GraphicsFixture& f) { f.desc.DepthStencilState.StencilReadMask = 0x0f; },
+		[](GraphicsFixture& f) { f.desc.DepthStencilState.StencilWriteMask = 0x0f; },
+		[](GraphicsFixture& f) { f.desc.DepthStencilState.FrontFace.StencilFailOp = 2; },
+		[](GraphicsFixture& f) { f.desc.DepthStencilState.FrontFace.StencilDepthFailOp = 2; },
+		[](GraphicsFixture& f) { f.desc.DepthStencilState.FrontFace.StencilPassOp = 2; },
+		[](GraphicsFixture& f) { f.desc.DepthStencilState.FrontFace.StencilFunc = 3; },
+		[](GraphicsFixture& f) { f.desc.DepthStencilState.BackFace.StencilFunc = 3; },
+		[](GraphicsFixture& f) { f.inputElements[1].SemanticName = "NORMAM"; },
+		[](GraphicsFixture& f) { f.inputElements[1].SemanticIndex = 1; },
+		[](GraphicsFixture& f) { f.inputElements[1].Format = 2; },
+		[](GraphicsFixture& f) { f.inputElements[1].InputSlot = 1; },
+		[](GraphicsFixture& f) { f.inputElements[1].AlignedByteOffset = 16; },
+		[](GraphicsFixture& f) { f.inputElements[1].InputSlotClass = 1; },
+		[](GraphicsFixture& f) { f.inputElements[1].InstanceDataStepRate = 1; },
+		[](GraphicsFixture& f) { f.inputElements.pop_back(); },
+		[](GraphicsFixture& f) { f.desc.IBStripCutValue = 1; },
+		[](GraphicsFixture& f) { f.desc.PrimitiveTopologyType = 2; },
+		[](GraphicsFixture& f) { f.desc.NumRenderTargets = 2; },
+		[](GraphicsFixture& f) { f.desc.RTVFormats[2] = 2; },
+		[](GraphicsFixture& f) { f.desc.DSVFormat = 45; },
+		[](GraphicsFixture& f) { f.desc.SampleDesc.Count = 4; },
+		[](GraphicsFixture& f) { f.desc.SampleDesc.Quality = 1; },
+		[](GraphicsFixture& f) { f.desc.NodeMask = 1; },
+		[](GraphicsFixture& f) { f.desc.Flags = 1; },
+	};
+
+	// Each change gets its own key, different from the others too
+	std::unordered_set<uint64_t> keys = { fixture.GetKey() };
+	for (uint32_t i = 0; i < changes.size(); i++)
+	{
+		GraphicsFixture changed = fixture;
+		changes[i](changed);
+		changed.Update();
+		if (!keys.insert(changed.GetKey()).second)
+		{
+			std::printf("Change %u does not change the key\n", i);
+			CHECK(false);
+		}
+	}
+	CHECK(keys.size() == changes.size() + 1);
+
+	// Render targets past NumRenderTargets are ignored
+	GraphicsFixture unused = fixture;
+	unused.desc.RTVFormats[5] = 2;
+	CHECK(unused.GetKey() == fixture.GetKey());
+}
+
+
+TEST(PipelineStateKeyRegistry)
+{
+	PipelineStateKey::Registry registry;
+	CHECK(!registry.IsKnown(1) && !registry.IsDirty());
+
+	registry.OnLoaded(1);
+	CHECK(registry.IsKnown(1) && !registry.IsDirty());
+
+	// Only the first of two equal descs created in parallel is stored
+	CHECK(registry.OnCreated(2));
+	registry.OnStored();
+	CHECK(!registry.OnCreated(2));
+	// A key loaded from the library is not stored again
+	CHECK(!registry.OnCreated(1));
+	CHECK(registry.IsKnown(2) && registry.IsDirty());
+
+	CHECK(registry.GetStatistics().hitsCount == 1);
+	CHECK(registry.GetStatistics().missesCount == 3);
+	registry.OnSaved();
+	CHECK(!registry.IsDirty());
+}
@@ -0,0 +1,227 @@
+#include "Test.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "SceneGraph.h"
+
+
+using namespace SimdMath;
+
+
+namespace
+{
+	Float4x4 GetTransform(float x, float angle, float scale)
+	{
+		Float4x4 transform;
+		StoreFloat4x4(transform, MatrixScaling(scale, scale, scale) * MatrixRotationY(angle)
+			* MatrixTranslation(x, 1.0f, -2.0f));
+		return transform;
+	}
+
+	bool IsEqual(const Float4x4& a, const Float4x4& b)
+	{
+		return std::memcmp(&a, &b, sizeof(Float4x4)) == 0;
+	}
+
+	// Parents precede their children and the descendants of every node follow it up to its subtree end
+	bool IsDepthFirst(const SceneGraph& graph)
+	{
+		for (uint32_t node = 0; node < graph.GetNodesCount(); node++)
+		{
+			const uint32_t parent = graph.GetParent(node);
+			if (graph.GetSubtreeEnd(node) <= node || graph.GetSubtreeEnd(node) > graph.GetNodesCount())
+				return false;
+			if (parent != SceneGraph::kNoParent && (parent >= node || graph.GetSubtreeEnd(parent) < node + 1))
+				return false;
+			for (uint32_t descendant = node + 1; descendant < graph.GetSubtreeEnd(node); descendant++)
+			{
+				uint32_t ancestor = graph.GetParent(descendant);
+				while (ancestor != SceneGraph::kNoParent && ancestor > node)
+					ancestor = graph.GetParent(ancestor);
+				if (ancestor != node)
+					return false;
+			}
+		}
+		return true;
+	}
+
+	// Local times the world transform of the parent, recomputed from the roots with the same operations
+	bool HasWorldTransforms(const SceneGraph& graph)
+	{
+		std::vector<Float4x4> worlds(graph.GetNodesCount());
+		for (uint32_t node = 0; node < graph.GetNodesCount(); node++)
+		{
+			const uint32_t parent = graph.GetParent(node);
+			worlds[node] = graph.GetLocalTransform(node);
+			if (parent != SceneGraph::kNoParent)
+				StoreFloat4x4(worlds[node], LoadFloat4x4(worlds[node]) * LoadFloat4x4(worlds[parent]));
+			if (!IsEqual(graph.GetWorldTransform(node), worlds[node]))
+				return false;
+		}
+		return true;
+	}
+}
+
+
+TEST(SceneGraphUpdate)
+{
+	// Roots 0 and 4: 0 has the children 1 and 3, 1 has 2, 4 has 5
+	SceneGraph graph;
+	const uint32_t root = graph.AddNode(SceneGraph::kNoParent, GetTransform(1.0f, 0.5f, 2.0f));
+	const uint32_t child = graph.AddNode(root, GetTransform(2.0f, 1.0f, 0.5f));
+	const uint32_t grandchild = graph.AddNode(child, GetTransform(3.0f, 1.5f, 1.0f));
+	const uint32_t sibling = graph.AddNode(root, GetTransform(4.0f, 2.0f, 1.0f));
+	const uint32_t secondRoot = graph.AddNode(SceneGraph::kNoParent, GetTransform(5.0f, 2.5f, 1.0f));
+	graph.AddNode(secondRoot, GetTransform(6.0f, 3.0f, 1.0f));
+	CHECK(graph.GetNodesCount() == 6 && IsDepthFirst(graph));
+	CHECK(graph.GetSubtreeEnd(root) == 4 && graph.GetSubtreeEnd(child) == 3 && graph.GetSubtreeEnd(secondRoot) == 6);
+
+	// Every added node is changed once
+	std::vector<uint32_t> changedNodes;
+	graph.Update(changedNodes);
+	CHECK((changedNodes == std::vector<uint32_t>{ 0, 1, 2, 3, 4, 5 }));
+	CHECK(HasWorldTransforms(graph));
+	graph.Update(changedNodes);
+	CHECK(changedNodes.empty());
+
+	// The changed subtrees only, a dirty node inside a dirty subtree adds nothing
+	graph.SetLocalTransform(grandchild, GetTransform(7.0f, 0.0f, 1.0f));
+	graph.SetLocalTransform(child, GetTransform(8.0f, 0.0f, 1.0f));
+	graph.SetLocalTransform(secondRoot + 1, GetTransform(9.0f, 0.0f, 1.0f));
+	graph.Update(changedNodes);
+	CHECK((changedNodes == std::vector<uint32_t>{ child, grandchild, secondRoot + 1 }));
+	CHECK(HasWorldTransforms(graph));
+	graph.SetLocalTransform(sibling, graph.GetLocalTransform(sibling));
+	graph.SetLocalTransform(root, graph.GetLocalTransform(root));
+	graph.Update(changedNodes);
+	CHECK((changedNodes == std::vector<uint32_t>{ 0, 1, 2, 3 }));
+
+	graph.Clear();
+	graph.Update(changedNodes);
+	CHECK(graph.GetNodesCount() == 0 && changedNodes.empty());
+}
+
+
+TEST(SceneGraphParallelUpdate)
+{
+	// Deep and wide enough for the tasks of several threads
+	constexpr uint32_t kNodesCount = 20000;
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+	std::geometric_distribution<uint32_t> levelsUpDistribution(0.5);
+	SceneGraph graph;
+	std::vector<uint32_t> path;
+	for (uint32_t i = 0; i < kNodesCount; i++)
+	{
+		if (!path.empty())
+		{
+			const uint32_t levelsUp = path.size() >= 32 ? 1 : levelsUpDistribution(generator);
+			path.resize(std::max<size_t>(path.size() - std::min<size_t>(levelsUp, path.size()), 1));
+		}
+		const Float4x4 local = GetTransform(distribution(generator), distribution(generator),
+			0.9f + 0.2f * distribution(generator));
+		path.push_back(graph.AddNode(path.empty() ? SceneGraph::kNoParent : path.back(), local));
+	}
+	CHECK(IsDepthFirst(graph));
+
+	std::vector<uint32_t> changedNodes;
+	graph.Update(changedNodes, 4);
+	CHECK(changedNodes.size() == kNodesCount && HasWorldTransforms(graph));
+
+	// Partial updates on threads match the recomputation from the roots
+	std::uniform_int_distribution<uint32_t> nodeDistribution(0, kNodesCount - 1);
+	for (uint32_t i = 0; i < 100; i++)
+		graph.SetLocalTransform(nodeDistribution(generator), GetTransform(distribution(generator), 0.0f, 1.0f));
+	graph.SetLocalTransform(0, GetTransform(1.0f, 1.0f, 1.0f));
+	graph.Update(changedNodes, 4);
+	CHECK(changedNodes.size() >= graph.GetSubtreeEnd(0) && HasWorldTransforms(graph));
+}
+
+
+TEST(SceneGraphReparent)
+{
+	// Roots 0 and 4: 0 has the children 1 and 3, 1 has 2, 4 has 5 and 5 has 6
+	SceneGraph graph;
+	std::vector<Float4x4> locals;
+	const uint32_t parents[] = { SceneGraph::kNoParent, 0, 1, 0, SceneGraph::kNoParent, 4, 5 };
+	for (uint32_t i = 0; i < std::size(parents); i++)
+	{
+		locals.push_back(GetTransform(static_cast<float>(i), 0.25f * i, 1.0f + 0.1f * i));
+		graph.AddNode(parents[i], locals.back());
+	}
+	std::vector<uint32_t> changedNodes;
+	graph.Update(changedNodes);
+
+	// Forward: the subtree of 1 under 5, after 6. The nodes in between move back by its size.
+	std::vector<uint32_t> order;
+	uint32_t moved = graph.SetParent(1, 5, order);
+	CHECK((order == std::vector<uint32_t>{ 0, 3, 4, 5, 6, 1, 2 }));
+	CHECK(moved == 5 && graph.GetParent(moved) == 3 && graph.GetParent(moved + 1) == moved);
+	CHECK(IsDepthFirst(graph) && graph.GetSubtreeEnd(0) == 2 && graph.GetSubtreeEnd(2) == 7);
+	bool isLocalKept = true;
+	for (uint32_t node = 0; node < graph.GetNodesCount(); node++)
+		isLocalKept &= IsEqual(graph.GetLocalTransform(node), locals[order[node]]);
+	CHECK(isLocalKept);
+	// Only the moved subtree changes
+	graph.Update(changedNodes);
+	CHECK((changedNodes == std::vector<uint32_t>{ 5, 6 }) && HasWorldTransforms(graph));
+
+	// Backward: the subtree of 3 (was 5) under the first root, the root in between moves forward
+	const auto reorder = [&]() {
+		std::vector<Float4x4> reordered(locals.size());
+		for (uint32_t node = 0; node < order.size(); node++)
+			reordered[node] = locals[order[node]];
+		locals.swap(reordered);
+	};
+	reorder();
+	moved = graph.SetParent(3, 0, order);
+	CHECK((order == std::vector<uint32_t>{ 0, 1, 3, 4, 5, 6, 2 }));
+	CHECK(moved == 2 && graph.GetParent(moved) == 0 && graph.GetSubtreeEnd(0) == 6);
+	CHECK(IsDepthFirst(graph));
+	graph.Update(changedNodes);
+	CHECK((changedNodes == std::vector<uint32_t>{ 2, 3, 4, 5 }) && HasWorldTransforms(graph));
+
+	// To a root at the end
+	reorder();
+	moved = graph.SetParent(2, SceneGraph::kNoParent, order);
+	CHECK((order == std::vector<uint32_t>{ 0, 1, 6, 2, 3, 4, 5 }));
+	CHECK(moved == 3 && graph.GetParent(moved) == SceneGraph::kNoParent && IsDepthFirst(graph));
+	// A leaf under the next root, which was a leaf too
+	reorder();
+	moved = graph.SetParent(1, 2, order);
+	CHECK((order == std::vector<uint32_t>{ 0, 2, 1, 3, 4, 5, 6 }));
+	CHECK(moved == 2 && graph.GetParent(moved) == 1 && graph.GetSubtreeEnd(0) == 1 && IsDepthFirst(graph));
+	// Under the same parent again, nothing moves
+	reorder();
+	moved = graph.SetParent(moved, graph.GetParent(moved), order);
+	CHECK(moved == 2 && graph.GetParent(moved) == 1 && IsDepthFirst(graph));
+	bool isIdentity = true;
+	for (uint32_t node = 0; node < order.size(); node++)
+		isIdentity &= order[node] == node;
+	CHECK(isIdentity);
+
+	isLocalKept = true;
+	for (uint32_t node = 0; node < graph.GetNodesCount(); node++)
+		isLocalKept &= IsEqual(graph.GetLocalTransform(node), locals[order[node]]);
+	CHECK(isLocalKept);
+	graph.Update(changedNodes);
+	CHECK(HasWorldTransforms(graph));
+}
+
+
+TEST(SceneGraphBenchmark)
+{
+	const uint32_t nodesCount = context.GetSize(10000, 100000);
+	constexpr uint32_t kMovedCount = 100;
+	const auto report = SceneGraph::Benchmark(nodesCount, kMovedCount);
+	std::printf("Scene graph of %u nodes: full update %.2f ms, %.2f ms on %u threads, %u moved nodes update %u nodes "
+		"in %.3f ms\n", report.nodesCount, report.fullMilliseconds, report.fullParallelMilliseconds,
+		report.threadsCount, kMovedCount, report.changedCount, report.partialMilliseconds);
+
+	CHECK(report.nodesCount == nodesCount);
+	CHECK(report.changedCount >= kMovedCount);
+	CHECK(report.changedCount <= nodesCount);
+}
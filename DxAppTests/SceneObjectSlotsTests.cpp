@@ -0,0 +1,94 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "SceneObjectSlots.h"
+
+
+namespace
+{
+	bool HasMeshSlots(const SceneObjectSlots& slots, uint32_t mesh, std::vector<uint32_t> expected)
+	{
+		auto meshSlots = slots.GetMeshSlots(mesh);
+		std::sort(meshSlots.begin(), meshSlots.end());
+		std::sort(expected.begin(), expected.end());
+		return meshSlots == expected;
+	}
+}
+
+
+TEST(SceneObjectSlots)
+{
+	SceneObjectSlots slots;
+	const SceneObjectHandle a = slots.GetHandle(slots.Allocate(0));
+	const SceneObjectHandle b = slots.GetHandle(slots.Allocate(0));
+	const SceneObjectHandle c = slots.GetHandle(slots.Allocate(1));
+	CHECK(slots.GetSlotsCount() == 3 && slots.GetAliveCount() == 3);
+	CHECK(slots.IsValid(a) && slots.IsValid(b) && slots.IsValid(c));
+	CHECK(HasMeshSlots(slots, 0, { a.slot, b.slot }) && HasMeshSlots(slots, 1, { c.slot }));
+	CHECK(slots.GetMeshSlots(7).empty());
+	CHECK(!slots.IsValid(SceneObjectHandle()) && slots.GetSlot(SceneObjectHandle()) == SceneObjectSlots::kInvalidSlot);
+
+	// Removing the same handle twice: the second one changes nothing
+	CHECK(slots.Free(a));
+	CHECK(!slots.IsValid(a) && slots.GetSlot(a) == SceneObjectSlots::kInvalidSlot);
+	CHECK(!slots.Free(a));
+	CHECK(slots.GetAliveCount() == 2);
+	CHECK(HasMeshSlots(slots, 0, { b.slot }) && HasMeshSlots(slots, 1, { c.slot }));
+
+	// The slot is reused once, with the next generation
+	const SceneObjectHandle reused = slots.GetHandle(slots.Allocate(1));
+	CHECK(reused.slot == a.slot && reused.generation != a.generation);
+	const SceneObjectHandle appended = slots.GetHandle(slots.Allocate(1));
+	CHECK(appended.slot == 3 && slots.GetSlotsCount() == 4);
+
+	// The old handle of the reused slot removes nothing, the new one does
+	CHECK(!slots.Free(a));
+	CHECK(slots.IsValid(reused) && slots.GetAliveCount() == 4);
+	CHECK(slots.GetMeshes()[reused.slot] == 1);
+	CHECK(HasMeshSlots(slots, 0, { b.slot }) && HasMeshSlots(slots, 1, { c.slot, reused.slot, appended.slot }));
+	CHECK(slots.Free(reused));
+	CHECK(!slots.Free(reused));
+	CHECK(slots.GetAliveCount() == 3);
+	CHECK(HasMeshSlots(slots, 1, { c.slot, appended.slot }));
+
+	// Freed once each, two allocations take both free slots and the third appends
+	CHECK(slots.Free(b));
+	const uint32_t first = slots.Allocate(0);
+	const uint32_t second = slots.Allocate(0);
+	CHECK(std::min(first, second) == 0 && std::max(first, second) == 1);
+	CHECK(slots.Allocate(0) == 4);
+
+	// Clearing invalidates every handle, the generations outlive the slots
+	const SceneObjectHandle beforeClear = slots.GetHandle(std::min(first, second));
+	slots.Clear();
+	CHECK(slots.GetSlotsCount() == 0 && slots.GetAliveCount() == 0);
+	CHECK(!slots.IsValid(beforeClear) && !slots.Free(beforeClear) && !slots.Free(c));
+	const SceneObjectHandle afterClear = slots.GetHandle(slots.Allocate(0));
+	CHECK(afterClear.slot == beforeClear.slot && afterClear.generation != beforeClear.generation);
+	CHECK(!slots.IsValid(beforeClear) && slots.IsValid(afterClear));
+}
+
+
+TEST(SceneObjectSlotsLimit)
+{
+	SceneObjectSlots slots;
+	slots.SetMaxSlotsCount(3);
+	const SceneObjectHandle a = slots.GetHandle(slots.Allocate(0));
+	slots.Allocate(0);
+	slots.Allocate(0);
+	CHECK(slots.Allocate(0) == SceneObjectSlots::kInvalidSlot);
+	CHECK(slots.GetSlotsCount() == 3 && slots.GetAliveCount() == 3 && slots.GetMeshSlots(0).size() == 3);
+
+	// Free slots are still reused at the limit
+	CHECK(slots.Free(a));
+	CHECK(slots.Allocate(1) == a.slot);
+	CHECK(slots.Allocate(1) == SceneObjectSlots::kInvalidSlot);
+
+	// A limit below the slots count keeps them, only appending is refused
+	slots.SetMaxSlotsCount(1);
+	CHECK(slots.GetSlotsCount() == 3 && slots.GetAliveCount() == 3);
+	slots.SetMaxSlotsCount(4);
+	CHECK(slots.Allocate(1) == 3);
+}
@@ -0,0 +1,406 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "SceneQuery.h"
+
+
+using namespace SimdMath;
+
+
+namespace
+{
+	// Cube from -1 to 1, 2 triangles per face
+	struct Cube
+	{
+		StaticBatching::Vertex vertices[8] = {};
+		std::vector<uint32_t> indices;
+
+		Cube()
+		{
+			// Vertex i has its x, y and z at 1 for the bits 1, 2 and 4 of i
+			for (uint32_t i = 0; i < 8; i++)
+				vertices[i].position = Float4(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f, 1.0f);
+			// Faces with the first and last corners opposite
+			const uint32_t faces[6][4] = { { 0, 2, 4, 6 }, { 1, 3, 5, 7 }, { 0, 1, 4, 5 }, { 2, 3, 6, 7 },
+				{ 0, 1, 2, 3 }, { 4, 5, 6, 7 } };
+			for (const auto& face : faces)
+				indices.insert(indices.end(), { face[0], face[1], face[2], face[3], face[2], face[1] });
+		}
+
+		StaticBatching::Source GetSource() const
+		{
+			StaticBatching::Source source;
+			source.vertices = vertices;
+			source.verticesCount = 8;
+			source.indices = indices.data();
+			source.indicesCount = static_cast<uint32_t>(indices.size());
+			return source;
+		}
+	};
+
+	// Cubes placed by their models, the query over them
+	struct CubeScene
+	{
+		Cube cube;
+		ObjectTransforms::Transforms models;
+		std::vector<Aabb> worldBounds;
+		std::vector<uint32_t> objectMeshes;
+		Bvh bvh;
+		SceneQuery query;
+
+		explicit CubeScene(const std::vector<Matrix>& objectModels)
+		{
+			query.BuildMeshes({ cube.GetSource() });
+			models.Resize(static_cast<uint32_t>(objectModels.size()));
+			worldBounds.resize(objectModels.size());
+			objectMeshes.assign(objectModels.size(), 0);
+			for (uint32_t object = 0; object < objectModels.size(); object++)
+				Move(object, objectModels[object]);
+			bvh.Build(worldBounds);
+			query.SetInstances(bvh, worldBounds, objectMeshes, models, {});
+		}
+
+		void Move(uint32_t object, const Matrix& model)
+		{
+			Float4x4 value;
+			StoreFloat4x4(value, model);
+			models.Set(object, value);
+			worldBounds[object] = AabbTransform({ Float3(-1.0f, -1.0f, -1.0f), Float3(1.0f, 1.0f, 1.0f) }, model);
+		}
+
+		// World space corners of a triangle
+		void GetTriangle(uint32_t object, uint32_t triangle, double corners[3][3]) const
+		{
+			const Matrix model = LoadFloat4x4(models.Get(object));
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				Float3 position;
+				StoreFloat3(position, Vector3TransformCoord(
+					LoadFloat4(cube.vertices[cube.indices[triangle * 3 + corner]].position), model));
+				corners[corner][0] = position.x;
+				corners[corner][1] = position.y;
+				corners[corner][2] = position.z;
+			}
+		}
+	};
+
+	SceneQuery::Ray MakeRay(const Float3& origin, const Float3& direction, float maxDistance = FLT_MAX)
+	{
+		SceneQuery::Ray ray;
+		ray.origin = origin;
+		ray.direction = direction;
+		ray.maxDistance = maxDistance;
+		return ray;
+	}
+
+	// Scalar Moller-Trumbore in doubles, the distance of a hit in (0, maxDistance) or a negative one
+	double IntersectTriangle(const SceneQuery::Ray& ray, const double corners[3][3])
+	{
+		const double origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+		const double direction[3] = { ray.direction.x, ray.direction.y, ray.direction.z };
+		double edge1[3];
+		double edge2[3];
+		double toOrigin[3];
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			edge1[axis] = corners[1][axis] - corners[0][axis];
+			edge2[axis] = corners[2][axis] - corners[0][axis];
+			toOrigin[axis] = origin[axis] - corners[0][axis];
+		}
+		const auto cross = [](const double a[3], const double b[3], double result[3]) {
+			result[0] = a[1] * b[2] - a[2] * b[1];
+			result[1] = a[2] * b[0] - a[0] * b[2];
+			result[2] = a[0] * b[1] - a[1] * b[0];
+		};
+		const auto dot = [](const double a[3], const double b[3]) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; };
+
+		double p[3];
+		cross(direction, edge2, p);
+		const double determinant = dot(edge1, p);
+		if (std::abs(determinant) < 1e-12)
+			return -1.0;
+		double q[3];
+		cross(toOrigin, edge1, q);
+		const double u = dot(toOrigin, p) / determinant;
+		const double v = dot(direction, q) / determinant;
+		const double distance = dot(edge2, q) / determinant;
+		if (u < 0.0 || v < 0.0 || u + v > 1.0 || distance <= 0.0 || distance >= ray.maxDistance)
+			return -1.0;
+		return distance;
+	}
+
+	// Closest hit over every triangle of every object
+	SceneQuery::Hit ReferenceFirstHit(const CubeScene& scene, const SceneQuery::Ray& ray)
+	{
+		SceneQuery::Hit hit;
+		for (uint32_t object = 0; object < scene.worldBounds.size(); object++)
+		{
+			for (uint32_t triangle = 0; triangle < scene.cube.indices.size() / 3; triangle++)
+			{
+				double corners[3][3];
+				scene.GetTriangle(object, triangle, corners);
+				const double distance = IntersectTriangle(ray, corners);
+				if (distance > 0.0 && distance < hit.distance)
+				{
+					hit.object = object;
+					hit.triangle = triangle;
+					hit.distance = static_cast<float>(distance);
+				}
+			}
+		}
+		return hit;
+	}
+
+	bool IsNear(float a, float b)
+	{
+		return std::abs(a - b) <= 1e-4f * std::max(1.0f, std::abs(b));
+	}
+
+	// Same object and distance, the barycentrics of the hit triangle give the point at the distance
+	bool IsHit(const CubeScene& scene, const SceneQuery::Ray& ray, const SceneQuery::Hit& hit, uint32_t object,
+		float distance)
+	{
+		if (hit.object != object || !IsNear(hit.distance, distance))
+			return false;
+		double corners[3][3];
+		scene.GetTriangle(object, hit.triangle, corners);
+		bool isOnTriangle = hit.u >= -1e-5f && hit.v >= -1e-5f && hit.u + hit.v <= 1.0f + 1e-5f;
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			const double point = corners[0][axis] + hit.u * (corners[1][axis] - corners[0][axis])
+				+ hit.v * (corners[2][axis] - corners[0][axis]);
+			const double expected = (&ray.origin.x)[axis] + distance * static_cast<double>((&ray.direction.x)[axis]);
+			isOnTriangle &= std::abs(point - expected) <= 1e-3 * std::max(1.0, std::abs(expected));
+		}
+		return isOnTriangle;
+	}
+
+	bool IsSameHit(const SceneQuery::Hit& a, const SceneQuery::Hit& b)
+	{
+		return a.object == b.object && a.triangle == b.triangle && a.distance == b.distance && a.u == b.u
+			&& a.v == b.v;
+	}
+
+	bool HasObjects(std::vector<uint32_t> objects, const std::vector<uint32_t>& expected)
+	{
+		std::sort(objects.begin(), objects.end());
+		return objects == expected;
+	}
+
+	// A unit cube at the origin, one twice as large at x = 10 and a unit one turned by 45 degrees at z = 10
+	std::vector<Matrix> GetKnownModels()
+	{
+		return { MatrixIdentity(), MatrixScaling(2.0f, 2.0f, 2.0f) * MatrixTranslation(10.0f, 0.0f, 0.0f),
+			MatrixRotationY(ConvertToRadians(45.0f)) * MatrixTranslation(0.0f, 0.0f, 10.0f) };
+	}
+}
+
+
+TEST(SceneQueryRays)
+{
+	CubeScene scene(GetKnownModels());
+	const SceneQuery& query = scene.query;
+	constexpr uint32_t kNone = SceneQuery::kNoObject;
+	const float sqrt2 = std::sqrt(2.0f);
+
+	struct Case
+	{
+		SceneQuery::Ray ray;
+		uint32_t object;
+		float distance;
+	};
+	const Case cases[] = {
+		// Down onto the top of the unit cube, the distances are in lengths of the direction
+		{ MakeRay(Float3(0.2f, 0.3f, 5.0f), Float3(0.0f, 0.0f, -1.0f)), 0, 4.0f },
+		{ MakeRay(Float3(0.2f, 0.3f, 5.0f), Float3(0.0f, 0.0f, -2.0f)), 0, 2.0f },
+		// Short of it and just past it
+		{ MakeRay(Float3(0.2f, 0.3f, 5.0f), Float3(0.0f, 0.0f, -1.0f), 3.9f), kNone, 0.0f },
+		{ MakeRay(Float3(0.2f, 0.3f, 5.0f), Float3(0.0f, 0.0f, -1.0f), 4.1f), 0, 4.0f },
+		// Away from it, and past it
+		{ MakeRay(Float3(0.2f, 0.3f, -5.0f), Float3(0.0f, 0.0f, -1.0f)), kNone, 0.0f },
+		{ MakeRay(Float3(0.2f, 5.0f, 0.3f), Float3(1.0f, 0.0f, 0.0f)), kNone, 0.0f },
+		// From inside, the back faces count
+		{ MakeRay(Float3(0.1f, 0.3f, -0.2f), Float3(1.0f, 0.0f, 0.0f)), 0, 0.9f },
+		// Through both cubes along x, the nearer one first from either side
+		{ MakeRay(Float3(-5.0f, 0.5f, 0.3f), Float3(1.0f, 0.0f, 0.0f)), 0, 4.0f },
+		{ MakeRay(Float3(20.0f, 0.5f, 0.3f), Float3(-1.0f, 0.0f, 0.0f)), 1, 8.0f },
+		// Into the turned cube, its faces are at x + |z - 10| = sqrt(2)
+		{ MakeRay(Float3(5.0f, 0.3f, 10.2f), Float3(-1.0f, 0.0f, 0.0f)), 2, 5.0f - (sqrt2 - 0.2f) },
+		// Through the corner of its world bounds, outside of the cube
+		{ MakeRay(Float3(1.3f, 5.0f, 10.5f), Float3(0.0f, -1.0f, 0.0f)), kNone, 0.0f },
+	};
+
+	std::vector<SceneQuery::Ray> rays;
+	for (const Case& test : cases)
+	{
+		const SceneQuery::Hit hit = query.RayFirstHit(test.ray);
+		CHECK(test.object == kNone ? hit.object == kNone : IsHit(scene, test.ray, hit, test.object, test.distance));
+		CHECK(query.RayAnyHit(test.ray) == (test.object != kNone));
+		rays.push_back(test.ray);
+	}
+
+	// Moving the unit cube down, only the changed object is updated
+	scene.Move(0, MatrixTranslation(0.0f, 0.0f, -3.0f));
+	scene.bvh.RefitAll(scene.worldBounds);
+	scene.query.SetInstances(scene.bvh, scene.worldBounds, scene.objectMeshes, scene.models, { 0 });
+	CHECK(IsHit(scene, cases[0].ray, query.RayFirstHit(cases[0].ray), 0, 7.0f));
+	// From where it was, on to the large cube
+	CHECK(IsHit(scene, cases[6].ray, query.RayFirstHit(cases[6].ray), 1, 7.9f));
+	CHECK(IsHit(scene, cases[9].ray, query.RayFirstHit(cases[9].ray), 2, cases[9].distance));
+
+	// Packets of every size give the hits of single rays
+	bool isPacketValid = true;
+	for (uint32_t count = 1; count <= rays.size(); count++)
+	{
+		std::vector<SceneQuery::Hit> hits(count);
+		std::unique_ptr<bool[]> anyHits(new bool[count]);
+		query.RayFirstHit(rays.data(), count, hits.data());
+		query.RayAnyHit(rays.data(), count, anyHits.get());
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const SceneQuery::Hit hit = query.RayFirstHit(rays[i]);
+			isPacketValid &= IsSameHit(hits[i], hit) && anyHits[i] == (hit.object != kNone);
+		}
+	}
+	CHECK(isPacketValid);
+}
+
+
+TEST(SceneQueryRaysReference)
+{
+	// Overlapping random cubes, random rays and segments against testing every triangle
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<float> positionDistribution(0.0f, 30.0f);
+	std::uniform_real_distribution<float> scaleDistribution(0.5f, 3.0f);
+	std::uniform_real_distribution<float> angleDistribution(0.0f, k2Pi);
+	std::uniform_real_distribution<float> unitDistribution(-1.0f, 1.0f);
+	const auto getPosition = [&]() {
+		return Float3(positionDistribution(generator), positionDistribution(generator),
+			positionDistribution(generator));
+	};
+
+	std::vector<Matrix> models;
+	for (uint32_t object = 0; object < 40; object++)
+	{
+		const Float3 position = getPosition();
+		models.push_back(MatrixScaling(scaleDistribution(generator), scaleDistribution(generator),
+			scaleDistribution(generator)) * MatrixRotationY(angleDistribution(generator))
+			* MatrixTranslation(position.x, position.y, position.z));
+	}
+	CubeScene scene(models);
+
+	const uint32_t raysCount = context.GetSize(1000, 10000);
+	std::vector<SceneQuery::Ray> rays(raysCount);
+	for (uint32_t i = 0; i < raysCount; i++)
+	{
+		rays[i].origin = getPosition();
+		if (i % 2)
+		{
+			StoreFloat3(rays[i].direction, LoadFloat3(getPosition()) - LoadFloat3(rays[i].origin));
+			rays[i].maxDistance = 1.0f;
+		}
+		else
+		{
+			rays[i].direction = Float3(unitDistribution(generator), unitDistribution(generator),
+				unitDistribution(generator));
+		}
+	}
+	std::vector<SceneQuery::Hit> hits(raysCount);
+	std::unique_ptr<bool[]> anyHits(new bool[raysCount]);
+	scene.query.RayFirstHit(rays.data(), raysCount, hits.data());
+	scene.query.RayAnyHit(rays.data(), raysCount, anyHits.get());
+
+	uint32_t hitsCount = 0;
+	bool isValid = true;
+	for (uint32_t i = 0; i < raysCount; i++)
+	{
+		const SceneQuery::Hit reference = ReferenceFirstHit(scene, rays[i]);
+		const bool isHit = reference.object != SceneQuery::kNoObject;
+		hitsCount += isHit;
+		// Objects sharing the hit point may swap, the distance may not
+		isValid &= isHit ? IsNear(hits[i].distance, reference.distance)
+			&& IsHit(scene, rays[i], hits[i], hits[i].object, reference.distance) : hits[i].object == reference.object;
+		isValid &= anyHits[i] == isHit;
+	}
+	CHECK(isValid);
+	// Both hits and misses were tested
+	CHECK(hitsCount > raysCount / 10 && hitsCount < raysCount * 9 / 10);
+}
+
+
+TEST(SceneQueryOverlaps)
+{
+	CubeScene scene(GetKnownModels());
+	const SceneQuery& query = scene.query;
+	const auto overlapBox = [&](const Float3& minCorner, const Float3& maxCorner) {
+		std::vector<uint32_t> objects;
+		query.OverlapBox({ minCorner, maxCorner }, objects);
+		return objects;
+	};
+	const auto overlapSphere = [&](const Float3& center, float radius) {
+		std::vector<uint32_t> objects;
+		query.OverlapSphere(center, radius, objects);
+		return objects;
+	};
+
+	// Inside the unit cube touches no triangle, across its face does
+	CHECK(HasObjects(overlapBox(Float3(-0.5f, -0.5f, -0.5f), Float3(0.5f, 0.5f, 0.5f)), {}));
+	CHECK(HasObjects(overlapBox(Float3(0.5f, -0.5f, -0.5f), Float3(1.5f, 0.5f, 0.5f)), { 0 }));
+	CHECK(HasObjects(overlapBox(Float3(1.001f, -0.5f, -0.5f), Float3(7.999f, 0.5f, 0.5f)), {}));
+	CHECK(HasObjects(overlapBox(Float3(0.999f, -0.5f, -0.5f), Float3(8.001f, 0.5f, 0.5f)), { 0, 1 }));
+	// Containing every cube whole
+	CHECK(HasObjects(overlapBox(Float3(-20.0f, -20.0f, -20.0f), Float3(20.0f, 20.0f, 20.0f)), { 0, 1, 2 }));
+	// In the world bounds of the turned cube, inside it and then across its face at x + |z - 10| = sqrt(2)
+	CHECK(HasObjects(overlapBox(Float3(1.2f, -0.1f, 9.9f), Float3(1.3f, 0.1f, 10.1f)), {}));
+	CHECK(HasObjects(overlapBox(Float3(1.3f, -0.1f, 9.95f), Float3(1.5f, 0.1f, 10.05f)), { 2 }));
+	// Between the faces of the turned cube and its world bounds
+	CHECK(HasObjects(overlapBox(Float3(1.0f, -0.1f, 11.0f), Float3(1.4f, 0.1f, 11.4f)), {}));
+
+	// Inside the unit cube, then reaching its faces
+	CHECK(HasObjects(overlapSphere(Float3(0.0f, 0.0f, 0.0f), 0.99f), {}));
+	CHECK(HasObjects(overlapSphere(Float3(0.0f, 0.0f, 0.0f), 1.01f), { 0 }));
+	// Between the cubes, 2 from the unit one and 5 from the large one
+	CHECK(HasObjects(overlapSphere(Float3(3.0f, 0.0f, 0.0f), 1.9f), {}));
+	CHECK(HasObjects(overlapSphere(Float3(3.0f, 0.0f, 0.0f), 2.1f), { 0 }));
+	CHECK(HasObjects(overlapSphere(Float3(3.0f, 0.0f, 0.0f), 5.1f), { 0, 1 }));
+	// Off the corner of the unit cube, sqrt(3) away, its bounding box overlaps the cube in both cases
+	CHECK(HasObjects(overlapSphere(Float3(2.0f, 2.0f, 2.0f), 1.7f), {}));
+	CHECK(HasObjects(overlapSphere(Float3(2.0f, 2.0f, 2.0f), 1.76f), { 0 }));
+	// Off the corner of the turned cube at x = sqrt(2), 0.586 away
+	CHECK(HasObjects(overlapSphere(Float3(2.0f, 0.0f, 10.0f), 0.55f), {}));
+	CHECK(HasObjects(overlapSphere(Float3(2.0f, 0.0f, 10.0f), 0.62f), { 2 }));
+
+	// The results are replaced, not appended to
+	std::vector<uint32_t> objects = { 7 };
+	query.OverlapSphere(Float3(100.0f, 0.0f, 0.0f), 1.0f, objects);
+	CHECK(objects.empty());
+}
+
+
+TEST(SceneQueryBenchmark)
+{
+	const uint32_t objectsCount = context.GetSize(200, 1000);
+	const uint32_t raysCount = context.GetSize(8192, 65536);
+	const auto report = SceneQuery::Benchmark(objectsCount, raysCount);
+	const auto printResult = [&](const char* name, const SceneQuery::BenchmarkReport::Result& result) {
+		std::printf("Scene query of %u objects, %u triangles, %u %s rays: %.2f Mrays/s per core in packets, %.2f "
+			"Mrays/s one at a time\n", report.objectsCount, report.trianglesCount, report.raysCount, name,
+			result.packetRaysPerSecond * 1e-6, result.singleRaysPerSecond * 1e-6);
+		CHECK(result.packetRaysPerSecond > 0.0 && result.singleRaysPerSecond > 0.0);
+	};
+	printResult("coherent first hit", report.coherentFirstHit);
+	printResult("random first hit", report.randomFirstHit);
+	printResult("random any hit", report.randomAnyHit);
+	std::printf("Scene query box and sphere overlaps: %.0f per second\n", report.overlapsPerSecond);
+
+	CHECK(report.objectsCount == objectsCount);
+	CHECK(report.raysCount == raysCount);
+	CHECK(report.overlapsPerSecond > 0.0);
+}
@@ -0,0 +1,148 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "LightSources.h"
+#include "LightingPermutation.h"
+#include "ShaderPermutationLayout.h"
+
+
+namespace
+{
+	// Permutation columns of Shaders/ShaderList.txt
+	constexpr const char* kLightingPassLayout =
+		"DIRECTIONAL_LIGHTS,POINT_LIGHTS,SPOT_LIGHTS,LINEAR_FALOFF,COMPACT_GBUFFER";
+	constexpr const char* kDebugViewLayout =
+		"DEBUG_VIEW_SURFACE_COLOR|DEBUG_VIEW_NORMAL|DEBUG_VIEW_ROUGHNESS|DEBUG_VIEW_METALNESS,COMPACT_GBUFFER";
+}
+
+
+TEST(ShaderPermutationLayoutEnumeration)
+{
+	const ShaderPermutationLayout none(ShaderPermutationLayout::kNoPermutations);
+	CHECK(!none.HasPermutations());
+	CHECK(none.GetPermutationsCount() == 1);
+	CHECK((none.EnumerateKeys() == std::vector<uint32_t>{ 0 }));
+
+	// Independent defines, every combination
+	const ShaderPermutationLayout lighting(kLightingPassLayout);
+	CHECK(lighting.HasPermutations());
+	CHECK(lighting.GetPermutationsCount() == 32);
+	const auto lightingKeys = lighting.EnumerateKeys();
+	CHECK(lightingKeys.size() == 32 && lightingKeys.front() == 0 && lightingKeys.back() == 31);
+
+	// 4 exclusive defines and none take 3 bits, values 5 to 7 are not keys
+	const ShaderPermutationLayout debugView(kDebugViewLayout);
+	CHECK(debugView.GetPermutationsCount() == 10);
+	const auto debugViewKeys = debugView.EnumerateKeys();
+	CHECK(debugViewKeys.size() == 10);
+	CHECK(std::is_sorted(debugViewKeys.begin(), debugViewKeys.end()));
+	CHECK(std::all_of(debugViewKeys.begin(), debugViewKeys.end(),
+		[&](uint32_t key) { return debugView.IsValidKey(key); }));
+	CHECK(!debugView.IsValidKey(5) && !debugView.IsValidKey(7) && !debugView.IsValidKey(8 | 6));
+	CHECK(!debugView.IsValidKey(16));
+
+	// Every key names a different set of defines
+	std::set<std::vector<std::string>> defineSets;
+	for (const uint32_t key : debugViewKeys)
+		defineSets.insert(debugView.GetDefines(key));
+	CHECK(defineSets.size() == debugViewKeys.size());
+
+	CHECK(ShaderPermutationLayout::GetPermutationName("LightingPass_ps", 0) == "LightingPass_ps.0");
+	CHECK(ShaderPermutationLayout::GetPermutationName("LightingPass_ps", 26) == "LightingPass_ps.1a");
+}
+
+
+TEST(ShaderPermutationLayoutDefines)
+{
+	// One bit per define, in declaration order
+	const ShaderPermutationLayout lighting(kLightingPassLayout);
+	CHECK(lighting.GetDefineKey("DIRECTIONAL_LIGHTS") == 1);
+	CHECK(lighting.GetDefineKey("POINT_LIGHTS") == 2);
+	CHECK(lighting.GetDefineKey("SPOT_LIGHTS") == 4);
+	CHECK(lighting.GetDefineKey("LINEAR_FALOFF") == 8);
+	CHECK(lighting.GetDefineKey("COMPACT_GBUFFER") == 16);
+	CHECK(lighting.HasDefine("SPOT_LIGHTS") && !lighting.HasDefine("DEBUG_VIEW_NORMAL"));
+	CHECK((lighting.GetDefines(2 | 16) == std::vector<std::string>{ "POINT_LIGHTS", "COMPACT_GBUFFER" }));
+	CHECK(lighting.GetDefines(0).empty());
+
+	// Exclusive defines are values of one field, the next group starts past it
+	const ShaderPermutationLayout debugView(kDebugViewLayout);
+	CHECK(debugView.GetDefineKey("DEBUG_VIEW_SURFACE_COLOR") == 1);
+	CHECK(debugView.GetDefineKey("DEBUG_VIEW_NORMAL") == 2);
+	CHECK(debugView.GetDefineKey("DEBUG_VIEW_ROUGHNESS") == 3);
+	CHECK(debugView.GetDefineKey("DEBUG_VIEW_METALNESS") == 4);
+	CHECK(debugView.GetDefineKey("COMPACT_GBUFFER") == 8);
+	CHECK((debugView.GetDefines(3 | 8) == std::vector<std::string>{ "DEBUG_VIEW_ROUGHNESS", "COMPACT_GBUFFER" }));
+
+	// Two exclusive defines fit 2 bits
+	const ShaderPermutationLayout pair("A|B,C");
+	CHECK(pair.GetDefineKey("B") == 2 && pair.GetDefineKey("C") == 4);
+	CHECK(pair.GetPermutationsCount() == 6 && !pair.IsValidKey(3));
+}
+
+
+TEST(LightingPermutationKeys)
+{
+	const ShaderPermutationLayout lighting(kLightingPassLayout);
+	const auto keys = LightingPermutation::ResolveKeys(lighting);
+	CHECK(keys.directionalLights == 1 && keys.pointLights == 2 && keys.spotLights == 4);
+	CHECK(keys.linearFalloff == 8 && keys.compactGBuffer == 16);
+
+	// Defines a shader lacks resolve to 0
+	const ShaderPermutationLayout forward("DIRECTIONAL_LIGHTS,LINEAR_FALOFF");
+	const auto forwardKeys = LightingPermutation::ResolveKeys(forward);
+	CHECK(forwardKeys.directionalLights == 1 && forwardKeys.linearFalloff == 2);
+	CHECK(forwardKeys.pointLights == 0 && forwardKeys.spotLights == 0 && forwardKeys.compactGBuffer == 0);
+
+	LightSources none;
+	CHECK(LightingPermutation::SelectKey(keys, none, LightFalloff::Square, false) == 0);
+	// The falloff only matters with point or spot lights
+	CHECK(LightingPermutation::SelectKey(keys, none, LightFalloff::Linear, true) == keys.compactGBuffer);
+
+	LightSources directional;
+	directional.AddDirectional({});
+	CHECK(LightingPermutation::SelectKey(keys, directional, LightFalloff::Linear, false) == keys.directionalLights);
+
+	LightSources attenuated;
+	attenuated.AddPoint({});
+	attenuated.AddSpot({});
+	CHECK(LightingPermutation::SelectKey(keys, attenuated, LightFalloff::Linear, false) ==
+		(keys.pointLights | keys.spotLights | keys.linearFalloff));
+	CHECK(LightingPermutation::SelectKey(keys, attenuated, LightFalloff::Square, true) ==
+		(keys.pointLights | keys.spotLights | keys.compactGBuffer));
+
+	// The superset is a compiled variant and covers every selection with the same falloff and GBuffer
+	bool isCovered = true;
+	for (uint32_t lightTypes = 0; lightTypes < 8; lightTypes++)
+	{
+		LightSources lightSources;
+		if (lightTypes & 1)
+			lightSources.AddDirectional({});
+		if (lightTypes & 2)
+			lightSources.AddPoint({});
+		if (lightTypes & 4)
+			lightSources.AddSpot({});
+		for (const LightFalloff falloff : { LightFalloff::Square, LightFalloff::Linear })
+		{
+			for (const bool isCompactGBuffer : { false, true })
+			{
+				const uint32_t key = LightingPermutation::SelectKey(keys, lightSources, falloff, isCompactGBuffer);
+				const uint32_t superset = LightingPermutation::GetSupersetKey(keys, falloff, isCompactGBuffer);
+				isCovered &= lighting.IsValidKey(key) && lighting.IsValidKey(superset);
+				isCovered &= (key & ~superset) == 0;
+				// Same GBuffer layout, the falloff of the attenuated lights matches
+				isCovered &= (key & keys.compactGBuffer) == (superset & keys.compactGBuffer);
+				const bool isLinear = falloff == LightFalloff::Linear;
+				isCovered &= (superset & keys.linearFalloff) == (isLinear ? keys.linearFalloff : 0);
+				isCovered &= (key & keys.linearFalloff) == 0 || (superset & keys.linearFalloff) != 0;
+			}
+		}
+	}
+	CHECK(isCovered);
+	CHECK(LightingPermutation::GetSupersetKey(keys, LightFalloff::Square, false) ==
+		(keys.directionalLights | keys.pointLights | keys.spotLights));
+}
@@ -0,0 +1,270 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#if __has_include(<DirectXMath.h>)
+#include <DirectXMath.h>
+#define SIMD_MATH_TESTS_HAS_DIRECTXMATH 1
+#endif
+
+#include "SimdMath.h"
+
+
+using namespace SimdMath;
+
+
+namespace
+{
+	Float4x4 GetRandomMatrix(std::mt19937& generator)
+	{
+		std::uniform_real_distribution<float> distribution(-2.0f, 2.0f);
+		Float4x4 matrix;
+		for (uint32_t element = 0; element < 16; element++)
+			matrix.m[element / 4][element % 4] = distribution(generator);
+		// Diagonally dominant, so far from singular
+		for (uint32_t i = 0; i < 4; i++)
+			matrix.m[i][i] += 10.0f;
+		return matrix;
+	}
+
+	float GetError(float value, float expected)
+	{
+		return std::abs(value - expected) / std::max(1.0f, std::abs(expected));
+	}
+}
+
+
+TEST(SimdMathAgainstScalar)
+{
+	constexpr uint32_t kMatricesCount = 256;
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<float> distribution(-100.0f, 100.0f);
+
+	float maxError = 0.0f;
+	for (uint32_t i = 0; i < kMatricesCount; i++)
+	{
+		const Float4x4 a = GetRandomMatrix(generator);
+		const Float4x4 b = GetRandomMatrix(generator);
+		const Float3 point(distribution(generator), distribution(generator), distribution(generator));
+
+		// Row vectors, as DirectXMath
+		Float4x4 product;
+		StoreFloat4x4(product, MatrixMultiply(LoadFloat4x4(a), LoadFloat4x4(b)));
+		for (uint32_t row = 0; row < 4; row++)
+		{
+			for (uint32_t column = 0; column < 4; column++)
+			{
+				float expected = 0.0f;
+				for (uint32_t k = 0; k < 4; k++)
+					expected += a.m[row][k] * b.m[k][column];
+				maxError = std::max(maxError, GetError(product.m[row][column], expected));
+			}
+		}
+
+		Float3 transformed;
+		StoreFloat3(transformed, Vector3TransformCoord(LoadFloat3(point), LoadFloat4x4(a)));
+		const float pointArray[4] = { point.x, point.y, point.z, 1.0f };
+		float expected[4] = {};
+		for (uint32_t column = 0; column < 4; column++)
+		{
+			for (uint32_t k = 0; k < 4; k++)
+				expected[column] += pointArray[k] * a.m[k][column];
+		}
+		maxError = std::max({ maxError, GetError(transformed.x, expected[0] / expected[3]),
+			GetError(transformed.y, expected[1] / expected[3]), GetError(transformed.z, expected[2] / expected[3]) });
+
+		Float4x4 identity;
+		StoreFloat4x4(identity, MatrixMultiply(MatrixInverse(LoadFloat4x4(a)), LoadFloat4x4(a)));
+		for (uint32_t element = 0; element < 16; element++)
+		{
+			maxError = std::max(maxError,
+				GetError(identity.m[element / 4][element % 4], element / 4 == element % 4 ? 1.0f : 0.0f));
+		}
+	}
+	std::printf("SimdMath %s against scalar code: max error %g\n", GetBackendName(), maxError);
+	CHECK(maxError < 1e-5f);
+}
+
+
+TEST(SimdMathFrustum)
+{
+	const Matrix view = MatrixLookAtRH(VectorSet(0.0f, 0.0f, 10.0f, 1.0f), VectorZero(),
+		VectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	const Matrix projection = MatrixPerspectiveFovRH(ConvertToRadians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+	Float4x4 viewProjection;
+	StoreFloat4x4(viewProjection, MatrixMultiply(view, projection));
+	Float4 planes[6];
+	ExtractFrustumPlanes(viewProjection, planes);
+
+	const auto isVisible = [&](const Float3& center, float extent) {
+		return AabbIntersectsPlanes(LoadFloat3(center), VectorReplicate(extent), planes, 6);
+	};
+	// In front of the camera, behind it, past the far plane and far off to the side
+	CHECK(isVisible(Float3(0.0f, 0.0f, 0.0f), 1.0f));
+	CHECK(!isVisible(Float3(0.0f, 0.0f, 20.0f), 1.0f));
+	CHECK(!isVisible(Float3(0.0f, 0.0f, -200.0f), 1.0f));
+	CHECK(!isVisible(Float3(100.0f, 0.0f, 0.0f), 1.0f));
+	// Straddling the left plane
+	CHECK(isVisible(Float3(-10.0f, 0.0f, 0.0f), 5.0f));
+}
+
+
+TEST(SimdMathAabb)
+{
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<float> distribution(-10.0f, 10.0f);
+
+	// The transformed box is the bounds of the 8 transformed corners, flat and point boxes included
+	const Aabb boxes[] = { { Float3(-1.0f, -2.0f, -3.0f), Float3(4.0f, 5.0f, 6.0f) },
+		{ Float3(1.0f, 1.0f, -1.0f), Float3(2.0f, 1.0f, 1.0f) },
+		{ Float3(3.0f, 3.0f, 3.0f), Float3(3.0f, 3.0f, 3.0f) } };
+	float maxError = 0.0f;
+	for (uint32_t i = 0; i < 64; i++)
+	{
+		// Any affine transform, rotated, scaled, sheared and mirrored
+		Float4x4 affine;
+		for (uint32_t element = 0; element < 16; element++)
+			affine.m[element / 4][element % 4] = element % 4 == 3 ? 0.0f : distribution(generator);
+		affine.m[3][3] = 1.0f;
+		const Matrix model = LoadFloat4x4(affine);
+		for (const Aabb& box : boxes)
+		{
+			Aabb expected = AabbEmpty();
+			for (uint32_t corner = 0; corner < 8; corner++)
+			{
+				const Float3 point((corner & 1) ? box.maxCorner.x : box.minCorner.x,
+					(corner & 2) ? box.maxCorner.y : box.minCorner.y, (corner & 4) ? box.maxCorner.z : box.minCorner.z);
+				expected = AabbAddPoint(expected, Vector3TransformCoord(LoadFloat3(point), model));
+			}
+			const Aabb transformed = AabbTransform(box, model);
+			maxError = std::max({ maxError, GetError(transformed.minCorner.x, expected.minCorner.x),
+				GetError(transformed.minCorner.y, expected.minCorner.y),
+				GetError(transformed.minCorner.z, expected.minCorner.z),
+				GetError(transformed.maxCorner.x, expected.maxCorner.x),
+				GetError(transformed.maxCorner.y, expected.maxCorner.y),
+				GetError(transformed.maxCorner.z, expected.maxCorner.z) });
+		}
+	}
+	CHECK(maxError < 1e-5f);
+
+	// Planes keep the side their normal points to. A box touching a plane from behind is kept, the distance has
+	// to be negative to cull it, so does a box on two planes at once.
+	const Float4 planes[] = { Float4(1.0f, 0.0f, 0.0f, 0.0f), Float4(0.0f, -2.0f, 0.0f, 4.0f) };
+	const auto isVisible = [&](const Float3& center, const Float3& extents) {
+		return AabbIntersectsPlanes(LoadFloat3(center), LoadFloat3(extents), planes, 2);
+	};
+	CHECK(isVisible(Float3(5.0f, 0.0f, 0.0f), Float3(1.0f, 1.0f, 1.0f)));
+	CHECK(isVisible(Float3(-1.0f, 0.0f, 0.0f), Float3(1.0f, 1.0f, 1.0f)));
+	CHECK(!isVisible(Float3(-1.0f, 0.0f, 0.0f), Float3(0.75f, 1.0f, 1.0f)));
+	CHECK(isVisible(Float3(-1.0f, 3.0f, 0.0f), Float3(1.0f, 1.0f, 1.0f)));
+	CHECK(!isVisible(Float3(5.0f, 3.5f, 0.0f), Float3(1.0f, 1.0f, 1.0f)));
+	// Points are kept on the planes and culled right behind them
+	CHECK(isVisible(Float3(0.0f, 2.0f, 0.0f), Float3(0.0f, 0.0f, 0.0f)));
+	CHECK(!isVisible(Float3(-0.25f, 0.0f, 0.0f), Float3(0.0f, 0.0f, 0.0f)));
+	CHECK(!isVisible(Float3(0.0f, 2.25f, 0.0f), Float3(0.0f, 0.0f, 0.0f)));
+	// No planes, nothing is culled
+	CHECK(AabbIntersectsPlanes(VectorReplicate(-1e6f), VectorZero(), planes, 0));
+}
+
+
+TEST(SimdMathAgainstDirectXMath)
+{
+#if defined(SIMD_MATH_TESTS_HAS_DIRECTXMATH)
+	using namespace DirectX;
+
+	constexpr uint32_t kCount = 4096;
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<float> positionDistribution(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> angleDistribution(0.0f, k2Pi);
+	std::uniform_real_distribution<float> scaleDistribution(0.5f, 2.0f);
+
+	const Matrix view = MatrixLookAtRH(VectorSet(0.0f, 10.0f, 150.0f, 1.0f), VectorZero(),
+		VectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	const Matrix projection = MatrixPerspectiveFovRH(ConvertToRadians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+	Float4x4 viewProjection;
+	StoreFloat4x4(viewProjection, MatrixMultiply(view, projection));
+	Float4 planes[6];
+	ExtractFrustumPlanes(viewProjection, planes);
+	const XMMATRIX dxViewProjection = XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(&viewProjection));
+
+	float maxError = 0.0f;
+	uint32_t visibilityMismatchesCount = 0;
+	for (uint32_t i = 0; i < kCount; i++)
+	{
+		const float scale = scaleDistribution(generator);
+		Float4x4 model;
+		StoreFloat4x4(model, MatrixMultiply(MatrixMultiply(MatrixScaling(scale, scale, scale),
+			MatrixRotationY(angleDistribution(generator))), MatrixTranslation(positionDistribution(generator),
+			positionDistribution(generator), positionDistribution(generator))));
+		const Float3 point(positionDistribution(generator), positionDistribution(generator),
+			positionDistribution(generator));
+		const XMMATRIX dxModel = XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(&model));
+
+		Float3 transformed;
+		StoreFloat3(transformed, Vector3TransformCoord(LoadFloat3(point), LoadFloat4x4(model)));
+		Float3 dxTransformed;
+		XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&dxTransformed),
+			XMVector3TransformCoord(XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&point)), dxModel));
+		maxError = std::max({ maxError, GetError(transformed.x, dxTransformed.x),
+			GetError(transformed.y, dxTransformed.y), GetError(transformed.z, dxTransformed.z) });
+
+		Float4x4 product;
+		StoreFloat4x4(product, MatrixMultiply(LoadFloat4x4(model), LoadFloat4x4(viewProjection)));
+		Float4x4 dxProduct;
+		XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(&dxProduct), XMMatrixMultiply(dxModel, dxViewProjection));
+		for (uint32_t element = 0; element < 16; element++)
+		{
+			maxError = std::max(maxError,
+				GetError(product.m[element / 4][element % 4], dxProduct.m[element / 4][element % 4]));
+		}
+
+		const Aabb box = { Float3(-1.0f, -1.0f, -1.0f), Float3(1.0f, 1.0f, 1.0f) };
+		Vector center;
+		Vector extents;
+		AabbTransform(box, LoadFloat4x4(model), center, extents);
+		const bool isVisible = AabbIntersectsPlanes(center, extents, planes, 6);
+		XMMATRIX absoluteModel;
+		for (uint32_t row = 0; row < 4; row++)
+			absoluteModel.r[row] = XMVectorAbs(dxModel.r[row]);
+		const XMVECTOR dxCenter = XMVector3TransformCoord(XMVectorZero(), dxModel);
+		const XMVECTOR dxExtents = XMVector3TransformNormal(XMVectorReplicate(1.0f), absoluteModel);
+		bool isDxVisible = true;
+		for (const Float4& plane : planes)
+		{
+			const XMVECTOR planeVector = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&plane));
+			const XMVECTOR distance = XMVectorAdd(XMPlaneDotCoord(planeVector, dxCenter),
+				XMVector3Dot(XMVectorAbs(planeVector), dxExtents));
+			isDxVisible &= XMVectorGetX(distance) >= 0.0f;
+		}
+		visibilityMismatchesCount += isVisible != isDxVisible ? 1 : 0;
+	}
+	std::printf("SimdMath against DirectXMath: max error %g, %u box tests differ\n", maxError,
+		visibilityMismatchesCount);
+	CHECK(maxError < 1e-4f);
+	// Box tests are exact up to the rounding of the boxes right on a plane
+	CHECK(visibilityMismatchesCount <= kCount / 1000);
+#else
+	// Nothing to compare with
+	static_cast<void>(context);
+	std::printf("DirectXMath.h is not available, skipped\n");
+#endif
+}
+
+
+TEST(SimdMathBenchmark)
+{
+	const uint32_t itemsCount = context.GetSize(10000, 100000);
+	const auto report = SimdMath::Benchmark(itemsCount);
+	const auto printResult = [](const char* name, const SimdMath::BenchmarkReport::Result& result) {
+		std::printf("%s: %.1f M transforms/s, %.1f M matrix products/s, %.1f M box tests/s\n", name,
+			result.transformsPerSecond / 1e6, result.matrixMultipliesPerSecond / 1e6, result.boxTestsPerSecond / 1e6);
+	};
+	printResult(GetBackendName(), report.simdMath);
+	if (report.directXMath.isMeasured)
+		printResult("DirectXMath", report.directXMath);
+	CHECK(report.simdMath.isMeasured);
+	CHECK(report.count == itemsCount);
+}
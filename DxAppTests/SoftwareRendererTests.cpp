@@ -0,0 +1,209 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "LightSources.h"
+#include "SoftwareRenderer.h"
+
+
+using namespace SimdMath;
+
+
+namespace
+{
+	constexpr uint32_t kWidth = 160;
+	constexpr uint32_t kHeight = 120;
+
+	// Checked in next to this file. A failing run writes its image to the working directory, to be inspected and
+	// copied over it when the change is intended.
+	std::filesystem::path GetGoldenPath()
+	{
+		return std::filesystem::path(__FILE__).parent_path() / "Golden" / "SoftwareRenderer.ppm";
+	}
+
+	StaticBatching::Vertex MakeVertex(const Float3& position, const Float3& color, const Float3& normal)
+	{
+		StaticBatching::Vertex vertex;
+		vertex.position = Float4(position.x, position.y, position.z, 1.0f);
+		vertex.color = Float4(color.x, color.y, color.z, 1.0f);
+		vertex.normal = Float4(normal.x, normal.y, normal.z, 0.0f);
+		return vertex;
+	}
+
+	// Meshes of the test scene and the objects placing them
+	struct TestScene
+	{
+		std::vector<StaticBatching::Vertex> groundVertices;
+		std::vector<uint32_t> groundIndices;
+		std::vector<StaticBatching::Vertex> cubeVertices;
+		std::vector<uint32_t> cubeIndices;
+		std::vector<StaticBatching::Source> objects;
+		LightSources lightSources;
+		SoftwareRenderer::View view;
+
+		TestScene()
+		{
+			// Ground from -10 to 10 facing up, a color per corner
+			const Float3 up(0.0f, 1.0f, 0.0f);
+			groundVertices = { MakeVertex(Float3(-10.0f, 0.0f, -10.0f), Float3(0.9f, 0.9f, 0.9f), up),
+				MakeVertex(Float3(10.0f, 0.0f, -10.0f), Float3(0.2f, 0.6f, 0.9f), up),
+				MakeVertex(Float3(-10.0f, 0.0f, 10.0f), Float3(0.9f, 0.6f, 0.2f), up),
+				MakeVertex(Float3(10.0f, 0.0f, 10.0f), Float3(0.3f, 0.9f, 0.3f), up) };
+			// Counter clockwise seen from above
+			groundIndices = { 0, 2, 1, 1, 2, 3 };
+
+			// Cube from -1 to 1 with flat faces
+			const Float3 normals[6] = { Float3(1.0f, 0.0f, 0.0f), Float3(-1.0f, 0.0f, 0.0f), Float3(0.0f, 1.0f, 0.0f),
+				Float3(0.0f, -1.0f, 0.0f), Float3(0.0f, 0.0f, 1.0f), Float3(0.0f, 0.0f, -1.0f) };
+			for (const Float3& normal : normals)
+			{
+				// Two axes of the face, tangent cross bitangent is the normal
+				const Float3 tangent = normal.y != 0.0f ? Float3(normal.y, 0.0f, 0.0f)
+					: Float3(-normal.z, 0.0f, normal.x);
+				const Float3 bitangent(normal.y * tangent.z - normal.z * tangent.y,
+					normal.z * tangent.x - normal.x * tangent.z, normal.x * tangent.y - normal.y * tangent.x);
+				const uint32_t first = static_cast<uint32_t>(cubeVertices.size());
+				for (const float s : { -1.0f, 1.0f })
+				{
+					for (const float t : { -1.0f, 1.0f })
+					{
+						const Float3 position(normal.x + s * tangent.x + t * bitangent.x,
+							normal.y + s * tangent.y + t * bitangent.y, normal.z + s * tangent.z + t * bitangent.z);
+						cubeVertices.push_back(MakeVertex(position, Float3(0.8f, 0.25f, 0.2f), normal));
+					}
+				}
+				cubeIndices.insert(cubeIndices.end(), { first, first + 2, first + 1, first + 1, first + 2, first + 3 });
+			}
+
+			const auto addObject = [&](const std::vector<StaticBatching::Vertex>& vertices,
+				const std::vector<uint32_t>& indices, const Matrix& model) {
+				StaticBatching::Source source;
+				source.vertices = vertices.data();
+				source.verticesCount = static_cast<uint32_t>(vertices.size());
+				source.indices = indices.data();
+				source.indicesCount = static_cast<uint32_t>(indices.size());
+				StoreFloat4x4(source.model, model);
+				objects.push_back(source);
+			};
+			addObject(groundVertices, groundIndices, MatrixIdentity());
+			addObject(cubeVertices, cubeIndices, MatrixRotationY(ConvertToRadians(30.0f))
+				* MatrixTranslation(0.0f, 1.0f, 0.0f));
+			addObject(cubeVertices, cubeIndices, MatrixScaling(0.5f, 0.5f, 0.5f) * MatrixTranslation(2.5f, 0.5f, 1.5f));
+			// In the bottom right corner, crossing the near plane
+			addObject(cubeVertices, cubeIndices, MatrixScaling(0.03f, 0.03f, 0.03f)
+				* MatrixTranslation(0.06f, 2.92f, 5.925f));
+
+			lightSources.SetAmbient(AmbientLightSource(Float4(0.05f, 0.05f, 0.06f, 1.0f)));
+			lightSources.AddDirectional(DirectionalLightSource(Float4(0.4f, 0.4f, 0.35f, 1.0f),
+				Float4(0.0f, 0.8f, 0.6f, 0.0f)));
+			lightSources.AddPoint(PointLightSource(Float4(2.0f, 2.0f, 3.0f, 1.0f), Float4(-2.0f, 1.5f, 2.0f, 1.0f)));
+			lightSources.AddSpot(SpotLightSource(Float4(6.0f, 5.0f, 3.0f, 1.0f), Float4(2.5f, 3.0f, 1.5f, 1.0f),
+				Float4(0.0f, -1.0f, 0.0f, 0.0f), 0.9f));
+
+			const Matrix viewProjection = MatrixLookAtRH(VectorSet(0.0f, 3.0f, 6.0f, 1.0f),
+				VectorSet(0.0f, 0.5f, 0.0f, 1.0f), VectorSet(0.0f, 1.0f, 0.0f, 0.0f))
+				* MatrixPerspectiveFovRH(ConvertToRadians(60.0f), static_cast<float>(kWidth) / kHeight, 0.1f, 100.0f);
+			StoreFloat4x4(view.viewProjection, viewProjection);
+			view.position = Float3(0.0f, 3.0f, 6.0f);
+		}
+	};
+
+	// R8G8B8A8 texels of a binary PPM, empty when it can not be read
+	std::vector<uint32_t> ReadImage(const std::filesystem::path& path, uint32_t width, uint32_t height)
+	{
+		std::ifstream file(path, std::ios::binary);
+		std::string format;
+		uint32_t fileWidth = 0;
+		uint32_t fileHeight = 0;
+		uint32_t maxValue = 0;
+		file >> format >> fileWidth >> fileHeight >> maxValue;
+		file.get();
+		if (!file || format != "P6" || fileWidth != width || fileHeight != height || maxValue != 255)
+			return {};
+
+		std::vector<uint8_t> bytes(width * height * 3);
+		file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+		if (!file)
+			return {};
+		std::vector<uint32_t> image(width * height);
+		for (uint32_t i = 0; i < image.size(); i++)
+			image[i] = bytes[i * 3] | (bytes[i * 3 + 1] << 8) | (bytes[i * 3 + 2] << 16) | 0xff000000;
+		return image;
+	}
+
+	// Largest channel difference of a texel
+	uint32_t GetDifference(uint32_t a, uint32_t b)
+	{
+		uint32_t difference = 0;
+		for (uint32_t shift = 0; shift < 24; shift += 8)
+			difference = std::max<uint32_t>(difference, std::abs(static_cast<int>((a >> shift) & 0xff)
+				- static_cast<int>((b >> shift) & 0xff)));
+		return difference;
+	}
+}
+
+
+TEST(SoftwareRendererGolden)
+{
+	TestScene scene;
+	SoftwareRenderer renderer(kWidth, kHeight, 3);
+	renderer.Render(scene.objects, scene.lightSources, scene.view);
+	const auto& image = renderer.GetImage();
+
+	// The BRDF kernels and FMA differ between CPUs by a few units, and an edge may move by a pixel
+	const std::vector<uint32_t> golden = ReadImage(GetGoldenPath(), kWidth, kHeight);
+	CHECK(!golden.empty());
+	uint32_t differentCount = 0;
+	uint32_t maxDifference = 0;
+	for (uint32_t i = 0; i < golden.size(); i++)
+	{
+		const uint32_t difference = GetDifference(image[i], golden[i]);
+		differentCount += difference > 2;
+		maxDifference = std::max(maxDifference, difference);
+	}
+	std::printf("Software renderer against %s: %u texels differ, by up to %u\n", GetGoldenPath().string().c_str(),
+		differentCount, maxDifference);
+	const bool isMatching = !golden.empty() && differentCount <= kWidth * kHeight / 200;
+	CHECK(isMatching);
+	if (!isMatching)
+	{
+		CHECK(renderer.WriteImage("SoftwareRenderer.ppm"));
+		std::printf("Rendered image written to %s\n",
+			std::filesystem::absolute("SoftwareRenderer.ppm").string().c_str());
+	}
+}
+
+
+TEST(SoftwareRendererThreads)
+{
+	// The bins keep the submission order, the image and the depth do not depend on the threads
+	TestScene scene;
+	SoftwareRenderer reference(kWidth, kHeight, 1);
+	reference.Render(scene.objects, scene.lightSources, scene.view);
+	CHECK(reference.GetTrianglesCount() == 2 + 3 * 12);
+	for (const uint32_t threadsCount : { 2u, 7u })
+	{
+		SoftwareRenderer renderer(kWidth, kHeight, threadsCount);
+		renderer.Render(scene.objects, scene.lightSources, scene.view);
+		CHECK(renderer.GetImage() == reference.GetImage());
+		CHECK(renderer.GetDepth() == reference.GetDepth());
+	}
+
+	// Rendering again reuses the bins, an empty frame clears everything
+	SoftwareRenderer renderer(kWidth, kHeight, 2);
+	renderer.Render(scene.objects, scene.lightSources, scene.view);
+	renderer.Render({}, scene.lightSources, scene.view);
+	CHECK(renderer.GetTrianglesCount() == 0);
+	CHECK(std::all_of(renderer.GetImage().begin(), renderer.GetImage().end(),
+		[](uint32_t texel) { return texel == 0xff000000; }));
+	CHECK(std::all_of(renderer.GetDepth().begin(), renderer.GetDepth().end(),
+		[](float depth) { return depth == 1.0f; }));
+	renderer.Render(scene.objects, scene.lightSources, scene.view);
+	CHECK(renderer.GetImage() == reference.GetImage());
+}
@@ -0,0 +1,221 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <vector>
+
+#include "StaticBatching.h"
+
+
+using namespace SimdMath;
+
+
+namespace
+{
+	struct Box
+	{
+		StaticBatching::Vertex vertices[8];
+		uint32_t indices[36] = {
+			0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5, 0, 4, 5, 0, 5, 1,
+			2, 3, 7, 2, 7, 6, 0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3
+		};
+
+		// Unit box, every corner has its own direction as the normal
+		Box()
+		{
+			for (uint32_t i = 0; i < 8; i++)
+			{
+				const float x = (i & 1) ? 0.5f : -0.5f;
+				const float y = (i & 2) ? 0.5f : -0.5f;
+				const float z = (i & 4) ? 0.5f : -0.5f;
+				vertices[i].position = Float4(x, y, z, 1.0f);
+				vertices[i].color = Float4(static_cast<float>(i), 0.0f, 0.0f, 1.0f);
+				const float length = std::sqrt(x * x + y * y + z * z);
+				vertices[i].normal = Float4(x / length, y / length, z / length, 0.0f);
+			}
+		}
+	};
+
+	StaticBatching::Source MakeSource(const Box& box, const Matrix& model)
+	{
+		StaticBatching::Source source;
+		source.vertices = box.vertices;
+		source.verticesCount = std::size(box.vertices);
+		source.indices = box.indices;
+		source.indicesCount = std::size(box.indices);
+		source.boundsMin = Float3(-0.5f, -0.5f, -0.5f);
+		source.boundsMax = Float3(0.5f, 0.5f, 0.5f);
+		StoreFloat4x4(source.model, model);
+		return source;
+	}
+
+	StaticBatching::Source MakeSource(const Box& box, float x, float scale = 1.0f)
+	{
+		return MakeSource(box, MatrixMultiply(MatrixScaling(scale, scale, scale), MatrixTranslation(x, 0.0f, 0.0f)));
+	}
+
+	bool IsNear(const Float4& a, const Float4& b, float tolerance)
+	{
+		return std::abs(a.x - b.x) <= tolerance && std::abs(a.y - b.y) <= tolerance &&
+			std::abs(a.z - b.z) <= tolerance && std::abs(a.w - b.w) <= tolerance;
+	}
+
+	// Every source in exactly one cluster, each cluster within the limits unless it holds a single source
+	bool IsPartition(const std::vector<StaticBatching::Cluster>& clusters, uint32_t sourcesCount,
+		const StaticBatching::Settings& settings)
+	{
+		std::vector<uint32_t> sourceClustersCount(sourcesCount, 0);
+		for (const auto& cluster : clusters)
+		{
+			for (const uint32_t sourceIndex : cluster.sourceIndices)
+			{
+				if (sourceIndex >= sourcesCount)
+					return false;
+				sourceClustersCount[sourceIndex]++;
+			}
+			const float extent = std::max({ cluster.boundsMax.x - cluster.boundsMin.x,
+				cluster.boundsMax.y - cluster.boundsMin.y, cluster.boundsMax.z - cluster.boundsMin.z });
+			const bool fits = extent <= settings.maxClusterExtent
+				&& cluster.vertices.size() <= settings.maxClusterVerticesCount;
+			if (cluster.sourceIndices.empty() || (cluster.sourceIndices.size() > 1 && !fits))
+				return false;
+		}
+		return std::all_of(sourceClustersCount.begin(), sourceClustersCount.end(),
+			[](uint32_t count) { return count == 1; });
+	}
+}
+
+
+TEST(StaticBatchingBake)
+{
+	const Box box;
+	std::vector<StaticBatching::Source> sources;
+	for (uint32_t i = 0; i < 6; i++)
+	{
+		const float angle = 0.5f * static_cast<float>(i);
+		const Matrix model = MatrixMultiply(MatrixMultiply(MatrixScaling(2.0f, 1.0f, 1.0f), MatrixRotationY(angle)),
+			MatrixTranslation(3.0f * static_cast<float>(i), 1.0f, -2.0f));
+		sources.push_back(MakeSource(box, model));
+	}
+
+	StaticBatching::Statistics statistics;
+	const auto clusters = StaticBatching::Build(sources, StaticBatching::Settings(), statistics);
+	CHECK(clusters.size() == 1 && statistics.clustersCount == 1 && statistics.sourcesCount == 6);
+	CHECK(statistics.verticesCount == 6 * std::size(box.vertices));
+	const auto& cluster = clusters[0];
+	CHECK(cluster.vertices.size() == 6 * std::size(box.vertices));
+	CHECK(cluster.indices.size() == 6 * std::size(box.indices));
+	CHECK((cluster.sourceIndices == std::vector<uint32_t>{ 0, 1, 2, 3, 4, 5 }));
+
+	// Sources follow each other in the source order, the indices are offset by the vertices before them
+	bool isBaked = true;
+	for (uint32_t sourceIndex = 0; sourceIndex < sources.size(); sourceIndex++)
+	{
+		const Matrix model = LoadFloat4x4(sources[sourceIndex].model);
+		const Matrix normalMatrix = MatrixTranspose(MatrixInverse(model));
+		const uint32_t baseVertex = sourceIndex * static_cast<uint32_t>(std::size(box.vertices));
+		for (uint32_t i = 0; i < std::size(box.vertices); i++)
+		{
+			const auto& baked = cluster.vertices[baseVertex + i];
+			const auto& vertex = box.vertices[i];
+			Float4 position;
+			StoreFloat4(position, Vector3TransformCoord(LoadFloat3(Float3(vertex.position.x, vertex.position.y,
+				vertex.position.z)), model));
+			position.w = 1.0f;
+			Float4 normal;
+			StoreFloat4(normal, Vector3Normalize(Vector3TransformNormal(LoadFloat3(Float3(vertex.normal.x,
+				vertex.normal.y, vertex.normal.z)), normalMatrix)));
+			normal.w = 0.0f;
+			isBaked &= IsNear(baked.position, position, 1e-5f) && IsNear(baked.normal, normal, 1e-5f);
+			isBaked &= baked.color.x == vertex.color.x;
+			// Inside the cluster bounds
+			const Float4 boundsMin(cluster.boundsMin.x, cluster.boundsMin.y, cluster.boundsMin.z, 1.0f);
+			const Float4 boundsMax(cluster.boundsMax.x, cluster.boundsMax.y, cluster.boundsMax.z, 1.0f);
+			isBaked &= baked.position.x >= boundsMin.x - 1e-4f && baked.position.x <= boundsMax.x + 1e-4f;
+			isBaked &= baked.position.y >= boundsMin.y - 1e-4f && baked.position.y <= boundsMax.y + 1e-4f;
+			isBaked &= baked.position.z >= boundsMin.z - 1e-4f && baked.position.z <= boundsMax.z + 1e-4f;
+		}
+		const uint32_t baseIndex = sourceIndex * static_cast<uint32_t>(std::size(box.indices));
+		for (uint32_t i = 0; i < std::size(box.indices); i++)
+			isBaked &= cluster.indices[baseIndex + i] == baseVertex + box.indices[i];
+	}
+	CHECK(isBaked);
+
+	// The normals go through the inverse transpose: the corner (1, 1, 1) of a box twice as wide leans to y and z
+	const Float4 expected(1.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.0f);
+	CHECK(IsNear(cluster.vertices[7].normal, expected, 1e-5f));
+}
+
+
+TEST(StaticBatchingLimits)
+{
+	const Box box;
+	StaticBatching::Statistics statistics;
+
+	// Empty input, no clusters
+	CHECK(StaticBatching::Build({}, StaticBatching::Settings(), statistics).empty());
+	CHECK(statistics.sourcesCount == 0 && statistics.clustersCount == 0 && statistics.verticesCount == 0);
+	CHECK(statistics.GetDrawCallReduction() == 0.0f);
+
+	// Four boxes in a row span 4 units along x and 32 vertices: exactly at both limits they make one cluster
+	std::vector<StaticBatching::Source> row;
+	for (uint32_t i = 0; i < 4; i++)
+		row.push_back(MakeSource(box, static_cast<float>(i)));
+	StaticBatching::Settings atLimits;
+	atLimits.maxClusterExtent = 4.0f;
+	atLimits.maxClusterVerticesCount = 32;
+	auto clusters = StaticBatching::Build(row, atLimits, statistics);
+	CHECK(clusters.size() == 1 && clusters[0].vertices.size() == 32);
+	CHECK(clusters[0].boundsMin.x == -0.5f && clusters[0].boundsMax.x == 3.5f);
+	CHECK(statistics.GetDrawCallReduction() == 4.0f);
+
+	// One vertex or a bit of extent less splits the row, the halves follow the space
+	StaticBatching::Settings belowVertices = atLimits;
+	belowVertices.maxClusterVerticesCount = 31;
+	clusters = StaticBatching::Build(row, belowVertices, statistics);
+	CHECK(clusters.size() == 2 && IsPartition(clusters, 4, belowVertices));
+	CHECK((clusters[0].sourceIndices == std::vector<uint32_t>{ 0, 1 }));
+	CHECK((clusters[1].sourceIndices == std::vector<uint32_t>{ 2, 3 }));
+	StaticBatching::Settings belowExtent = atLimits;
+	belowExtent.maxClusterExtent = 3.99f;
+	clusters = StaticBatching::Build(row, belowExtent, statistics);
+	CHECK(clusters.size() == 2 && IsPartition(clusters, 4, belowExtent));
+
+	// A box larger than the extent limit stays alone, the others still merge
+	std::vector<StaticBatching::Source> withLarge = row;
+	withLarge.push_back(MakeSource(box, 1.5f, 10.0f));
+	clusters = StaticBatching::Build(withLarge, atLimits, statistics);
+	CHECK(IsPartition(clusters, 5, atLimits));
+	const auto large = std::find_if(clusters.begin(), clusters.end(), [](const StaticBatching::Cluster& cluster) {
+		return std::find(cluster.sourceIndices.begin(), cluster.sourceIndices.end(), 4u) != cluster.sourceIndices.end();
+	});
+	CHECK(large != clusters.end() && large->sourceIndices.size() == 1 &&
+		large->boundsMax.x - large->boundsMin.x == 10.0f);
+	CHECK(clusters.size() < withLarge.size());
+
+	// Sources with more vertices than the limit are not split
+	StaticBatching::Settings fewVertices = atLimits;
+	fewVertices.maxClusterVerticesCount = 4;
+	clusters = StaticBatching::Build(row, fewVertices, statistics);
+	CHECK(clusters.size() == 4 && IsPartition(clusters, 4, fewVertices));
+	CHECK(std::all_of(clusters.begin(), clusters.end(),
+		[](const StaticBatching::Cluster& cluster) { return cluster.vertices.size() == 8; }));
+}
+
+
+TEST(StaticBatchingBenchmark)
+{
+	constexpr float kSceneSize = 1000.0f;
+	const StaticBatching::Settings settings;
+	const uint32_t objectsCount = context.GetSize(10000, 100000);
+	const auto report = StaticBatching::Benchmark(objectsCount, kSceneSize, settings);
+	std::printf("Static batching: %u objects into %u clusters (%.1fx fewer draws) in %.2f ms, largest cluster %.1f "
+		"units and %u vertices\n", report.statistics.sourcesCount, report.statistics.clustersCount,
+		report.statistics.GetDrawCallReduction(), report.statistics.milliseconds, report.maxClusterExtent,
+		report.maxClusterVerticesCount);
+
+	CHECK(report.statistics.sourcesCount == objectsCount);
+	CHECK(report.statistics.clustersCount < report.statistics.sourcesCount);
+}
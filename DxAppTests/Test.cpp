@@ -0,0 +1,99 @@
+#include "Test.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+
+namespace
+{
+	struct RegisteredTest
+	{
+		const char* name;
+		TestFunction function;
+	};
+
+	// Filled by the static initializers of the test files
+	std::vector<RegisteredTest>& GetTests()
+	{
+		static std::vector<RegisteredTest> tests;
+		return tests;
+	}
+
+	const RegisteredTest* FindTest(std::string_view name)
+	{
+		for (const auto& test : GetTests())
+		{
+			if (name == test.name)
+				return &test;
+		}
+		return nullptr;
+	}
+
+	bool RunTest(const RegisteredTest& test, bool isBenchmark)
+	{
+		TestContext context;
+		context.isBenchmark = isBenchmark;
+
+		std::printf("[ RUN  ] %s\n", test.name);
+		std::fflush(stdout);
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		test.function(context);
+		const auto endTime = std::chrono::high_resolution_clock::now();
+
+		std::printf("[ %s ] %s (%.1f ms)\n", context.failuresCount == 0 ? " OK " : "FAIL", test.name,
+			std::chrono::duration<double, std::milli>(endTime - startTime).count());
+		std::fflush(stdout);
+		return context.failuresCount == 0;
+	}
+}
+
+
+TestRegistration::TestRegistration(const char* name, TestFunction function)
+{
+	GetTests().push_back({ name, function });
+}
+
+
+void ReportCheckFailure(TestContext& context, const char* expression, const char* file, int line)
+{
+	context.failuresCount++;
+	std::printf("%s(%d): check failed: %s\n", file, line, expression);
+}
+
+
+int main(int argc, char** argv)
+{
+	bool isBenchmark = false;
+	std::vector<const RegisteredTest*> selectedTests;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--benchmark") == 0)
+		{
+			isBenchmark = true;
+			continue;
+		}
+
+		const RegisteredTest* test = FindTest(argv[i]);
+		if (!test)
+		{
+			std::printf("Unknown test %s\n", argv[i]);
+			return 1;
+		}
+		selectedTests.push_back(test);
+	}
+	if (selectedTests.empty())
+	{
+		for (const auto& test : GetTests())
+			selectedTests.push_back(&test);
+	}
+
+	uint32_t failedTestsCount = 0;
+	for (const RegisteredTest* test : selectedTests)
+		failedTestsCount += RunTest(*test, isBenchmark) ? 0 : 1;
+
+	std::printf("%zu tests, %u failed\n", selectedTests.size(), failedTestsCount);
+	return failedTestsCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+
+// Self registering checks of the CPU side modules, run by DxAppTests:
+// "DxAppTests [name...] [--benchmark]" runs the named tests or all of them. --benchmark runs the workloads at the
+// sizes the renderer used to report at startup, the tests use smaller ones by default.
+
+struct TestContext
+{
+	bool isBenchmark = false;
+	uint32_t failuresCount = 0;
+
+	uint32_t GetSize(uint32_t testSize, uint32_t benchmarkSize) const
+	{
+		return isBenchmark ? benchmarkSize : testSize;
+	}
+};
+
+using TestFunction = void (*)(TestContext& context);
+
+struct TestRegistration
+{
+	TestRegistration(const char* name, TestFunction function);
+};
+
+void ReportCheckFailure(TestContext& context, const char* expression, const char* file, int line);
+
+#define TEST(name) \
+	static void name##Test(TestContext& context); \
+	static const TestRegistration name##Registration(#name, name##Test); \
+	static void name##Test(TestContext& context)
+
+// Records the failure and carries on, the test fails once it returns
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+			ReportCheckFailure(context, #condition, __FILE__, __LINE__); \
+	} while (false)
@@ -0,0 +1,205 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "TlsfAllocator.h"
+
+
+namespace
+{
+	constexpr uint64_t kBlockSize = TlsfAllocator::kMinAlignment;
+
+	// Live allocations do not overlap and stay inside the range
+	bool AreDisjoint(std::vector<TlsfAllocator::Allocation> allocations, uint64_t size)
+	{
+		std::sort(allocations.begin(), allocations.end(),
+			[](const auto& a, const auto& b) { return a.offset < b.offset; });
+		for (uint32_t i = 0; i < allocations.size(); i++)
+		{
+			if (allocations[i].offset + allocations[i].size > size)
+				return false;
+			if (i > 0 && allocations[i - 1].offset + allocations[i - 1].size > allocations[i].offset)
+				return false;
+		}
+		return true;
+	}
+}
+
+
+TEST(TlsfAllocatorSplitMerge)
+{
+	TlsfAllocator allocator(16 * kBlockSize);
+	const auto first = allocator.Allocate(4 * kBlockSize);
+	const auto second = allocator.Allocate(4 * kBlockSize);
+	const auto third = allocator.Allocate(4 * kBlockSize);
+	CHECK(first.IsValid() && second.IsValid() && third.IsValid());
+	CHECK(first.offset == 0 && second.offset == 4 * kBlockSize && third.offset == 8 * kBlockSize);
+	CHECK(allocator.GetUsedSize() == 12 * kBlockSize);
+	// The tail left by the splits
+	CHECK(allocator.GetStatistics().freeBlocksCount == 1);
+
+	// A hole between used blocks stays separate
+	allocator.Free(second.handle);
+	auto statistics = allocator.GetStatistics();
+	CHECK(statistics.freeBlocksCount == 2 && statistics.largestFreeBlockSize == 4 * kBlockSize);
+	CHECK(statistics.GetFragmentation() > 0.0f);
+
+	// Merges with the next free block
+	allocator.Free(first.handle);
+	statistics = allocator.GetStatistics();
+	CHECK(statistics.freeBlocksCount == 2 && statistics.largestFreeBlockSize == 8 * kBlockSize);
+
+	// Merges with both neighbours into the whole range
+	allocator.Free(third.handle);
+	statistics = allocator.GetStatistics();
+	CHECK(allocator.IsEmpty() && allocator.GetUsedSize() == 0);
+	CHECK(statistics.freeBlocksCount == 1 && statistics.largestFreeBlockSize == allocator.GetSize());
+	CHECK(statistics.GetFragmentation() == 0.0f);
+}
+
+
+TEST(TlsfAllocatorAlignment)
+{
+	TlsfAllocator allocator(64 * kBlockSize);
+
+	// Sizes and alignments round up to kMinAlignment
+	const auto small = allocator.Allocate(1, 1);
+	CHECK(small.IsValid() && small.offset == 0 && small.size == kBlockSize);
+
+	constexpr uint64_t kAlignment = 16 * kBlockSize;
+	const auto aligned = allocator.Allocate(2 * kBlockSize, kAlignment);
+	CHECK(aligned.IsValid() && aligned.offset == kAlignment && aligned.size == 2 * kBlockSize);
+	// The padding before it stays free and usable
+	const auto padding = allocator.Allocate(15 * kBlockSize);
+	CHECK(padding.IsValid() && padding.offset == kBlockSize);
+
+	std::vector<TlsfAllocator::Allocation> allocations = { small, aligned, padding };
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		allocations.push_back(allocator.Allocate(kBlockSize, 4 * kBlockSize));
+		CHECK(allocations.back().IsValid() && allocations.back().offset % (4 * kBlockSize) == 0);
+	}
+	CHECK(AreDisjoint(allocations, allocator.GetSize()));
+
+	for (const auto& allocation : allocations)
+		allocator.Free(allocation.handle);
+	CHECK(allocator.GetStatistics().freeBlocksCount == 1);
+}
+
+
+TEST(TlsfAllocatorExhaustion)
+{
+	TlsfAllocator allocator(16 * kBlockSize);
+	CHECK(!allocator.Allocate(0).IsValid());
+	CHECK(!allocator.Allocate(17 * kBlockSize).IsValid());
+
+	std::vector<TlsfAllocator::Allocation> allocations;
+	for (uint32_t i = 0; i < 16; i++)
+		allocations.push_back(allocator.Allocate(kBlockSize));
+	CHECK(std::all_of(allocations.begin(), allocations.end(), [](const auto& a) { return a.IsValid(); }));
+	CHECK(allocator.GetUsedSize() == allocator.GetSize());
+	CHECK(allocator.GetStatistics().freeBlocksCount == 0);
+	CHECK(!allocator.Allocate(kBlockSize).IsValid());
+
+	// Enough free space in total, but no block fits
+	allocator.Free(allocations[3].handle);
+	allocator.Free(allocations[5].handle);
+	CHECK(!allocator.Allocate(2 * kBlockSize).IsValid());
+	// Neither does the alignment padding
+	allocator.Free(allocations[4].handle);
+	CHECK(!allocator.Allocate(2 * kBlockSize, 8 * kBlockSize).IsValid());
+	CHECK(allocator.Allocate(3 * kBlockSize).IsValid());
+}
+
+
+TEST(TlsfAllocatorReuse)
+{
+	TlsfAllocator allocator(1024 * kBlockSize);
+
+	// A freed block is found again by the same size
+	const auto first = allocator.Allocate(8 * kBlockSize);
+	const auto second = allocator.Allocate(8 * kBlockSize);
+	allocator.Allocate(8 * kBlockSize);
+	allocator.Free(second.handle);
+	const auto reused = allocator.Allocate(8 * kBlockSize);
+	CHECK(reused.offset == second.offset && reused.size == second.size);
+	CHECK(first.offset == 0);
+
+	// Random allocations and frees against the live set, then back to a single block
+	allocator.Reset(1024 * kBlockSize);
+	std::mt19937 generator(7);
+	std::uniform_int_distribution<uint32_t> sizes(1, 16);
+	std::uniform_int_distribution<uint32_t> alignmentsLog2(0, 4);
+	std::vector<TlsfAllocator::Allocation> allocations;
+	uint64_t usedSize = 0;
+	bool isConsistent = true;
+	for (uint32_t i = 0; i < 4096; i++)
+	{
+		if (!allocations.empty() && generator() % 3 == 0)
+		{
+			const uint32_t index = generator() % allocations.size();
+			usedSize -= allocations[index].size;
+			allocator.Free(allocations[index].handle);
+			allocations[index] = allocations.back();
+			allocations.pop_back();
+			continue;
+		}
+		const uint64_t alignment = kBlockSize << alignmentsLog2(generator);
+		const auto allocation = allocator.Allocate(sizes(generator) * kBlockSize, alignment);
+		if (!allocation.IsValid())
+			continue;
+		isConsistent &= allocation.offset % alignment == 0;
+		allocations.push_back(allocation);
+		usedSize += allocation.size;
+	}
+	isConsistent &= allocator.GetUsedSize() == usedSize;
+	CHECK(isConsistent);
+	CHECK(AreDisjoint(allocations, allocator.GetSize()));
+
+	for (const auto& allocation : allocations)
+		allocator.Free(allocation.handle);
+	const auto statistics = allocator.GetStatistics();
+	CHECK(allocator.IsEmpty() && statistics.freeBlocksCount == 1);
+	CHECK(statistics.largestFreeBlockSize == allocator.GetSize());
+}
+
+
+TEST(TlsfAllocatorBenchmark)
+{
+	// Resources of a scene: mostly small buffers and textures, a few big ones
+	const uint32_t operationsCount = context.GetSize(100000, 10000000);
+	constexpr uint32_t kLiveCount = 4096;
+
+	TlsfAllocator allocator(uint64_t(1) << 32);
+	std::mt19937 generator(0);
+	std::vector<uint64_t> sizes(kLiveCount);
+	for (auto& size : sizes)
+		size = (generator() % 8 == 0 ? 1 << 20 : 1 << 12) + generator() % (1 << 16);
+
+	std::vector<uint32_t> handles(kLiveCount, TlsfAllocator::kInvalidHandle);
+	uint32_t failedCount = 0;
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < operationsCount; i++)
+	{
+		// Free then allocate in a scattered order, so blocks split and merge
+		const uint32_t index = (i * 2654435761u) % kLiveCount;
+		if (handles[index] != TlsfAllocator::kInvalidHandle)
+			allocator.Free(handles[index]);
+		const auto allocation = allocator.Allocate(sizes[(index + i) % kLiveCount], 64 * 1024);
+		handles[index] = allocation.handle;
+		failedCount += allocation.IsValid() ? 0 : 1;
+	}
+	const double milliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::high_resolution_clock::now() - startTime).count();
+
+	const auto statistics = allocator.GetStatistics();
+	std::printf("TLSF: %u allocations and frees in %.2f ms, %.1f M/s; %u live, fragmentation %.3f\n",
+		operationsCount, milliseconds, operationsCount / milliseconds / 1e3, statistics.allocationsCount,
+		statistics.GetFragmentation());
+	CHECK(failedCount == 0);
+	CHECK(statistics.allocationsCount == kLiveCount);
+}
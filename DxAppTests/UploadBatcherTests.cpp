@@ -0,0 +1,118 @@
+#include "Test.h"
+
+#include <vector>
+
+#include "UploadBatcher.h"
+
+
+namespace
+{
+	// Copy queue whose fence only moves when the test completes batches or the batcher waits
+	class SimulatedUploadQueue : public UploadQueue
+	{
+	public:
+		uint32_t beginsCount = 0;
+		std::vector<uint64_t> submittedFenceValues;
+		std::vector<uint64_t> waitedFenceValues;
+		uint64_t completedFenceValue = 0;
+
+		void BeginBatch() override { beginsCount++; }
+		void SubmitBatch(uint64_t fenceValue) override { submittedFenceValues.push_back(fenceValue); }
+		uint64_t GetCompletedFenceValue() const override { return completedFenceValue; }
+		void WaitForFence(uint64_t fenceValue) override
+		{
+			waitedFenceValues.push_back(fenceValue);
+			completedFenceValue = fenceValue;
+		}
+	};
+
+	// Staging offset of every chunk
+	std::vector<uint64_t> Upload(UploadBatcher& batcher, uint64_t size)
+	{
+		std::vector<uint64_t> offsets;
+		while (size > 0)
+		{
+			const uint64_t chunkSize = batcher.GetChunkSize(size);
+			offsets.push_back(batcher.BeginCopy(chunkSize));
+			batcher.EndCopy(chunkSize);
+			size -= chunkSize;
+		}
+		return offsets;
+	}
+}
+
+
+TEST(UploadBatcherRetirement)
+{
+	SimulatedUploadQueue queue;
+	UploadBatcher batcher;
+	batcher.Reset(&queue, 1024, 512);
+
+	// Nothing recorded, nothing to wait for
+	CHECK(batcher.Flush() == 0);
+	CHECK(queue.submittedFenceValues.empty());
+
+	Upload(batcher, 100);
+	CHECK(batcher.IsRecording());
+	const uint64_t firstFenceValue = batcher.Flush();
+	Upload(batcher, 200);
+	const uint64_t secondFenceValue = batcher.Flush();
+	CHECK(firstFenceValue == 1 && secondFenceValue == 2);
+	CHECK(queue.beginsCount == 2);
+	CHECK(!batcher.IsCompleted(firstFenceValue));
+	const uint64_t usedSize = batcher.GetStagingRing().GetUsedSize();
+	CHECK(usedSize >= 300);
+
+	// Space is kept until the fence passes the batch
+	batcher.Retire();
+	CHECK(batcher.GetStagingRing().GetUsedSize() == usedSize);
+	queue.completedFenceValue = firstFenceValue;
+	batcher.Retire();
+	CHECK(batcher.IsCompleted(firstFenceValue) && !batcher.IsCompleted(secondFenceValue));
+	CHECK(batcher.GetStagingRing().GetUsedSize() < usedSize && batcher.GetStagingRing().GetUsedSize() >= 200);
+	queue.completedFenceValue = secondFenceValue;
+	batcher.Retire();
+	CHECK(batcher.GetStagingRing().GetUsedSize() == 0);
+	CHECK(queue.waitedFenceValues.empty());
+
+	// Full batches are submitted without a Flush
+	Upload(batcher, 512);
+	CHECK(!batcher.IsRecording());
+	CHECK(queue.submittedFenceValues.size() == 3);
+	batcher.WaitForIdle();
+	CHECK(queue.waitedFenceValues.size() == 1 && queue.waitedFenceValues[0] == 3);
+	CHECK(batcher.GetStagingRing().GetUsedSize() == 0);
+}
+
+
+TEST(UploadBatcherWraparound)
+{
+	SimulatedUploadQueue queue;
+	UploadBatcher batcher;
+	batcher.Reset(&queue, 1024, 1024);
+
+	// Three pending batches of 320 bytes, the fourth does not fit before the oldest one completes
+	std::vector<uint64_t> offsets;
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		offsets.push_back(Upload(batcher, 320)[0]);
+		batcher.Flush();
+	}
+	CHECK(queue.waitedFenceValues.empty());
+	offsets.push_back(Upload(batcher, 320)[0]);
+	CHECK(queue.waitedFenceValues.size() == 1 && queue.waitedFenceValues[0] == 1);
+	// Skips the tail of the ring, reuses the space of the first batch
+	CHECK(offsets[3] == 0);
+	CHECK(offsets[1] == 320 && offsets[2] == 640);
+
+	// Big uploads are split into chunks of half the ring and wait for every pending batch in order
+	const auto chunkOffsets = Upload(batcher, 1536);
+	CHECK(chunkOffsets.size() == 3);
+	for (const uint64_t offset : chunkOffsets)
+		CHECK(offset % UploadBatcher::kStagingAlignment == 0 && offset + 512 <= 1024);
+	for (uint32_t i = 1; i < queue.waitedFenceValues.size(); i++)
+		CHECK(queue.waitedFenceValues[i - 1] < queue.waitedFenceValues[i]);
+	batcher.WaitForIdle();
+	CHECK(batcher.IsCompleted(queue.submittedFenceValues.back()));
+	CHECK(batcher.GetStagingRing().GetUsedSize() == 0);
+}
@@ -0,0 +1,102 @@
+#include "Test.h"
+
+#include <cmath>
+
+#include "VisibilityBuffer.h"
+
+
+using namespace SimdMath;
+
+
+namespace
+{
+	bool IsNear(const Float3& a, const Float3& b, float tolerance)
+	{
+		return std::abs(a.x - b.x) <= tolerance && std::abs(a.y - b.y) <= tolerance &&
+			std::abs(a.z - b.z) <= tolerance;
+	}
+}
+
+
+TEST(VisibilityBufferPacking)
+{
+	using namespace VisibilityBuffer;
+
+	static_assert(kTriangleIndexBits + kObjectIndexBits == 32);
+	static_assert(kMaxObjectsCount == 1024 && kMaxTrianglesCount == 4u << 20);
+
+	const uint32_t lastObject = kMaxObjectsCount - 1;
+	const uint32_t lastTriangle = kMaxTrianglesCount - 1;
+	const uint32_t objects[] = { 0, 1, 511, lastObject };
+	const uint32_t triangles[] = { 0, 1, 12345, lastTriangle - 1, lastTriangle };
+	for (const uint32_t objectIndex : objects)
+	{
+		for (const uint32_t triangleIndex : triangles)
+		{
+			const uint32_t id = PackId(objectIndex, triangleIndex);
+			CHECK(GetObjectIndex(id) == objectIndex);
+			CHECK(GetTriangleIndex(id) == triangleIndex);
+		}
+	}
+
+	// Both limits use every bit, the fields do not overlap
+	CHECK(PackId(lastObject, lastTriangle) == 0xffffffff);
+	CHECK(PackId(lastObject, 0) == ~lastTriangle);
+	CHECK(PackId(0, lastTriangle) == lastTriangle);
+	// A triangle index past the limit wraps inside its field instead of changing the object
+	CHECK(GetObjectIndex(PackId(3, kMaxTrianglesCount)) == 3);
+	CHECK(GetTriangleIndex(PackId(3, kMaxTrianglesCount + 5)) == 5);
+}
+
+
+TEST(VisibilityBufferBarycentrics)
+{
+	using namespace VisibilityBuffer;
+
+	// w = 1, the barycentrics are the screen space ones
+	const Float4 flat[3] = { Float4(-1.0f, -1.0f, 0.5f, 1.0f), Float4(1.0f, -1.0f, 0.5f, 1.0f),
+		Float4(-1.0f, 1.0f, 0.5f, 1.0f) };
+	CHECK(IsNear(ComputeBarycentrics(flat, Float2(-1.0f, -1.0f)), Float3(1.0f, 0.0f, 0.0f), 1e-6f));
+	CHECK(IsNear(ComputeBarycentrics(flat, Float2(1.0f, -1.0f)), Float3(0.0f, 1.0f, 0.0f), 1e-6f));
+	CHECK(IsNear(ComputeBarycentrics(flat, Float2(-1.0f, 1.0f)), Float3(0.0f, 0.0f, 1.0f), 1e-6f));
+	CHECK(IsNear(ComputeBarycentrics(flat, Float2(0.0f, 0.0f)), Float3(0.0f, 0.5f, 0.5f), 1e-6f));
+	// Winding does not matter
+	const Float4 flipped[3] = { flat[0], flat[2], flat[1] };
+	CHECK(IsNear(ComputeBarycentrics(flipped, Float2(-0.5f, 0.0f)), Float3(0.25f, 0.5f, 0.25f), 1e-6f));
+
+	// Triangle receding from the camera, the barycentrics of the projected points of known world positions
+	const Matrix viewProjection =
+		MatrixLookAtRH(VectorSet(0.0f, 1.0f, 3.0f, 1.0f), VectorSet(0.0f, 0.0f, -5.0f, 1.0f),
+			VectorSet(0.0f, 1.0f, 0.0f, 0.0f)) *
+		MatrixPerspectiveFovRH(ConvertToRadians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+	const Float4 positions[3] = { Float4(-2.0f, 0.0f, -1.0f, 1.0f), Float4(2.0f, 0.0f, -1.0f, 1.0f),
+		Float4(0.5f, 0.5f, -30.0f, 1.0f) };
+	Float4 clipPositions[3];
+	for (uint32_t i = 0; i < 3; i++)
+		StoreFloat4(clipPositions[i], Vector4Transform(LoadFloat4(positions[i]), viewProjection));
+
+	const Float3 expected[] = { Float3(1.0f / 3.0f, 1.0f / 3.0f, 1.0f / 3.0f), Float3(0.8f, 0.1f, 0.1f),
+		Float3(0.1f, 0.1f, 0.8f), Float3(0.5f, 0.5f, 0.0f), Float3(0.0f, 0.25f, 0.75f) };
+	for (const Float3& barycentrics : expected)
+	{
+		const Float4 position = Interpolate(positions, barycentrics);
+		Float4 clipPosition;
+		StoreFloat4(clipPosition, Vector4Transform(LoadFloat4(position), viewProjection));
+		const Float2 pixelNdc(clipPosition.x / clipPosition.w, clipPosition.y / clipPosition.w);
+
+		const Float3 reconstructed = ComputeBarycentrics(clipPositions, pixelNdc);
+		CHECK(IsNear(reconstructed, barycentrics, 1e-4f));
+		CHECK(std::abs(reconstructed.x + reconstructed.y + reconstructed.z - 1.0f) < 1e-5f);
+
+		// The interpolated attribute is the world position of the pixel, not the screen space blend
+		const Float4 interpolated = Interpolate(positions, reconstructed);
+		CHECK(IsNear(Float3(interpolated.x, interpolated.y, interpolated.z),
+			Float3(position.x, position.y, position.z), 1e-3f));
+	}
+
+	// The screen space midpoint of the near and the far vertex is mostly the near one, 0.5 if interpolated linearly
+	const Float3 center = ComputeBarycentrics(clipPositions, Float2(
+		(clipPositions[0].x / clipPositions[0].w + clipPositions[2].x / clipPositions[2].w) * 0.5f,
+		(clipPositions[0].y / clipPositions[0].w + clipPositions[2].y / clipPositions[2].w) * 0.5f));
+	CHECK(center.x > 0.85f && std::abs(center.y) < 1e-4f);
+}
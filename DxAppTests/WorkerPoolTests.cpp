@@ -0,0 +1,53 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <vector>
+
+#include "WorkerPool.h"
+
+
+TEST(WorkerPool)
+{
+	constexpr uint32_t kThreadsCount = 3;
+	constexpr uint32_t kTasksCount = 64;
+
+	std::atomic<uint32_t> runningCount = 0;
+	std::atomic<uint32_t> maxRunningCount = 0;
+	std::atomic<uint32_t> finishedCount = 0;
+	std::vector<std::future<uint32_t>> results;
+	{
+		WorkerPool pool(kThreadsCount);
+		CHECK(pool.GetThreadsCount() == kThreadsCount);
+
+		// More tasks than threads, as many PSOs are requested at load
+		for (uint32_t i = 0; i < kTasksCount; i++)
+		{
+			results.push_back(pool.Submit([&, i]() {
+				const uint32_t running = ++runningCount;
+				uint32_t maxRunning = maxRunningCount;
+				while (running > maxRunning && !maxRunningCount.compare_exchange_weak(maxRunning, running))
+					;
+				std::this_thread::sleep_for(std::chrono::microseconds(200));
+				runningCount--;
+				finishedCount++;
+				return i * i;
+			}));
+		}
+		results[kTasksCount / 2].wait();
+		// The destructor runs the queued tasks
+	}
+	CHECK(finishedCount == kTasksCount);
+	CHECK(maxRunningCount >= 1 && maxRunningCount <= kThreadsCount);
+	bool areResultsValid = true;
+	for (uint32_t i = 0; i < kTasksCount; i++)
+		areResultsValid &= results[i].get() == i * i;
+	CHECK(areResultsValid);
+
+	// The default leaves a hardware thread to the caller
+	WorkerPool defaultPool;
+	CHECK(defaultPool.GetThreadsCount() >= 1);
+	CHECK(defaultPool.Submit([]() { return 7; }).get() == 7);
+}